@@ -74,7 +74,7 @@ GOptionEntry entries[] = {
   {"proto-lib", 'p', 0, G_OPTION_ARG_STRING, &proto_lib,
    "Absolute path of adaptor library", NULL},
   {"schema", 's', 0, G_OPTION_ARG_INT, &schema_type,
-   "Type of message schema (0=Full, 1=minimal), default=0", NULL},
+   "Type of message schema (0=Full, 1=minimal, 2=binary), default=0", NULL},
   {"no-display", 0, 0, G_OPTION_ARG_NONE, &display_off, "Disable display", NULL},
   {NULL}
 };
@@ -37,8 +37,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_nvinfer_debug);
  * have dropped references to an unseen object by 150 frames. */
 #define CLEANUP_ACCESS_CRITERIA 150
 
-/* Object history map cleanup interval. 1800 frames is a minute with a 30fps input */
-#define MAP_CLEANUP_INTERVAL 1800
+/* Object history map cleanup interval. The map of a source is swept over this
+ * many frames, a share of it on every frame. */
+#define MAP_CLEANUP_INTERVAL 150
 
 #define PROCESS_MODEL_FULL_FRAME 1
 #define PROCESS_MODEL_OBJECTS 2
@@ -50,6 +51,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_nvinfer_debug);
 #define MIN_INPUT_OBJECT_HEIGHT 16
 
 extern const int DEFAULT_REINFER_INTERVAL = G_MAXINT;
+extern const int DEFAULT_CLASSIFIER_CACHE_TTL = 300;
 
 #define IS_DETECTOR_INSTANCE(nvinfer) (nvinfer->init_params->networkType == NvDsInferNetworkType_Detector)
 #define IS_CLASSIFIER_INSTANCE(nvinfer) (nvinfer->init_params->networkType == NvDsInferNetworkType_Classifier)
@@ -66,6 +68,9 @@ static GQuark _dsmeta_quark = 0;
 #define DEFAULT_OPERATE_ON_GIE_ID -1
 #define DEFAULT_GPU_DEVICE_ID 0
 #define DEFAULT_OUTPUT_WRITE_TO_FILE FALSE
+#define DEFAULT_OUTPUT_CAPTURE_FILE NULL
+#define CAPTURE_MAX_QUEUED_BATCHES 16
+#define DEFAULT_OBJECT_HISTORY_MAX_MEMORY 0
 #define DEFAULT_OUTPUT_TENSOR_META FALSE
 
 /* By default NVIDIA Hardware allocated memory flows through the pipeline. We
@@ -106,6 +111,8 @@ static gpointer gst_nvinfer_input_queue_loop (gpointer data);
 static gpointer gst_nvinfer_output_loop (gpointer data);
 
 static void gst_nvinfer_reset_init_params (GstNvInfer * nvinfer);
+static GstStructure *gst_nvinfer_object_history_stats (GstNvInfer * nvinfer);
+static GstStructure *gst_nvinfer_classifier_cache_stats (GstNvInfer * nvinfer);
 
 /* Create enum type for the process mode property. */
 #define GST_TYPE_NVDSINFER_PROCESS_MODE (gst_nvinfer_process_mode_get_type ())
@@ -250,6 +257,15 @@ gst_nvinfer_class_init (GstNvInferClass * klass)
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
               GST_PARAM_MUTABLE_READY)));
 
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_CAPTURE_FILE,
+      g_param_spec_string ("raw-output-capture-file", "Raw Output Capture File",
+          "Path of a capture file to append the raw input and output tensors\n"
+          "\t\t\tof each batch to, with the PTS, source ID and frame number of\n"
+          "\t\t\tits frames, from a background thread",
+          DEFAULT_OUTPUT_CAPTURE_FILE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+              GST_PARAM_MUTABLE_READY)));
+
   g_object_class_install_property (gobject_class, PROP_OUTPUT_CALLBACK,
       g_param_spec_pointer ("raw-output-generated-callback",
           "Raw Output Generated Callback",
@@ -272,6 +288,31 @@ gst_nvinfer_class_init (GstNvInferClass * klass)
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
               GST_PARAM_MUTABLE_READY)));
 
+  g_object_class_install_property (gobject_class,
+      PROP_OBJECT_HISTORY_MAX_MEMORY,
+      g_param_spec_uint64 ("object-history-max-memory",
+          "Object History Max Memory",
+          "Memory in bytes the history of the tracked objects of a source may\n"
+          "\t\t\tuse, not counting the cached labels. The least recently seen\n"
+          "\t\t\tobjects are forgotten past it. 0 for no limit",
+          0, G_MAXUINT64, DEFAULT_OBJECT_HISTORY_MAX_MEMORY,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+              GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_OBJECT_HISTORY_STATS,
+      g_param_spec_boxed ("object-history-stats", "Object History Stats",
+          "Counters of the history of the tracked objects, a structure per\n"
+          "\t\t\tsource in fields named source-<id>",
+          GST_TYPE_STRUCTURE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASSIFIER_CACHE_STATS,
+      g_param_spec_boxed ("classifier-cache-stats", "Classifier Cache Stats",
+          "Counters of the classification cache set by classifier-cache-id\n"
+          "\t\t\tin the config file, for all the instances sharing it, and\n"
+          "\t\t\tthe inferences it saved this instance",
+          GST_TYPE_STRUCTURE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 
   /* Set sink and src pad capabilities */
   gst_element_class_add_pad_template (gstelement_class,
@@ -305,6 +346,7 @@ gst_nvinfer_init (GstNvInfer * nvinfer)
   nvinfer->unique_id = DEFAULT_UNIQUE_ID;
   nvinfer->process_full_frame = DEFAULT_PROCESS_MODE;
   nvinfer->config_file_path = g_strdup (DEFAULT_CONFIG_FILE_PATH);
+  nvinfer->capture_file_path = g_strdup (DEFAULT_OUTPUT_CAPTURE_FILE);
   nvinfer->operate_on_class_ids = new std::vector < gboolean >;
   nvinfer->output_tensor_meta = DEFAULT_OUTPUT_TENSOR_META;
 
@@ -316,6 +358,13 @@ gst_nvinfer_init (GstNvInfer * nvinfer)
   nvinfer->is_prop_set = new std::vector < gboolean > (PROP_LAST, FALSE);
 
   nvinfer->untracked_object_warn_pts = GST_CLOCK_TIME_NONE;
+  nvinfer->object_history_max_memory = DEFAULT_OBJECT_HISTORY_MAX_MEMORY;
+  nvinfer->classifier_cache_ttl = DEFAULT_CLASSIFIER_CACHE_TTL;
+  nvinfer->classifier_cache_policy = GST_NVINFER_CACHE_REINFER_TTL_OR_GROWTH;
+
+  /* Also guards the source info for the object-history-stats property, which
+   * may be read when the element is stopped. */
+  g_mutex_init (&nvinfer->process_lock);
 
   /* This quark is required to identify NvDsMeta when iterating through
    * the buffer metadatas */
@@ -331,6 +380,8 @@ gst_nvinfer_finalize (GObject * object)
 
   delete[]nvinfer->init_params->perClassDetectionParams;
   g_strfreev (nvinfer->init_params->outputLayerNames);
+  g_strfreev (nvinfer->init_params->customParserProperties);
+  g_strfreev (nvinfer->init_params->replayLayers);
   delete nvinfer->init_params;
 
   delete nvinfer->perClassDetectionFilterParams;
@@ -338,9 +389,13 @@ gst_nvinfer_finalize (GObject * object)
   delete nvinfer->is_prop_set;
 
   g_free (nvinfer->config_file_path);
+  g_free (nvinfer->capture_file_path);
+  g_free (nvinfer->classifier_cache_id);
 
   delete nvinfer->operate_on_class_ids;
 
+  g_mutex_clear (&nvinfer->process_lock);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -416,6 +471,10 @@ gst_nvinfer_set_property (GObject * object, guint prop_id,
     case PROP_OUTPUT_WRITE_TO_FILE:
       nvinfer->write_raw_buffers_to_file = g_value_get_boolean (value);
       break;
+    case PROP_OUTPUT_CAPTURE_FILE:
+      g_free (nvinfer->capture_file_path);
+      nvinfer->capture_file_path = g_value_dup_string (value);
+      break;
     case PROP_OUTPUT_CALLBACK:
       nvinfer->output_generated_callback =
           (gst_nvinfer_raw_output_generated_callback)
@@ -427,6 +486,9 @@ gst_nvinfer_set_property (GObject * object, guint prop_id,
     case PROP_OUTPUT_TENSOR_META:
       nvinfer->output_tensor_meta = g_value_get_boolean (value);
       break;
+    case PROP_OBJECT_HISTORY_MAX_MEMORY:
+      nvinfer->object_history_max_memory = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -482,6 +544,9 @@ gst_nvinfer_get_property (GObject * object, guint prop_id,
     case PROP_OUTPUT_WRITE_TO_FILE:
       g_value_set_boolean (value, nvinfer->write_raw_buffers_to_file);
       break;
+    case PROP_OUTPUT_CAPTURE_FILE:
+      g_value_set_string (value, nvinfer->capture_file_path);
+      break;
     case PROP_OUTPUT_CALLBACK:
       g_value_set_pointer (value,
           (gpointer) nvinfer->output_generated_callback);
@@ -492,6 +557,15 @@ gst_nvinfer_get_property (GObject * object, guint prop_id,
     case PROP_OUTPUT_TENSOR_META:
       g_value_set_boolean (value, nvinfer->output_tensor_meta);
       break;
+    case PROP_OBJECT_HISTORY_MAX_MEMORY:
+      g_value_set_uint64 (value, nvinfer->object_history_max_memory);
+      break;
+    case PROP_OBJECT_HISTORY_STATS:
+      g_value_take_boxed (value, gst_nvinfer_object_history_stats (nvinfer));
+      break;
+    case PROP_CLASSIFIER_CACHE_STATS:
+      g_value_take_boxed (value, gst_nvinfer_classifier_cache_stats (nvinfer));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -547,9 +621,139 @@ gst_nvinfer_reset_init_params (GstNvInfer * nvinfer)
 
   delete prev_params->perClassDetectionParams;
   g_strfreev (prev_params->outputLayerNames);
+  g_strfreev (prev_params->customParserProperties);
+  g_strfreev (prev_params->replayLayers);
   delete prev_params;
 }
 
+/* Creates the source info of a new source, with its object history map
+ * capped to object-history-max-memory. */
+static GstNvInferSourceInfo
+gst_nvinfer_new_source_info (GstNvInfer * nvinfer)
+{
+  GstNvInferSourceInfo source_info = GstNvInferSourceInfo ();
+
+  if (nvinfer->object_history_max_memory) {
+    guint64 max_entries = nvinfer->object_history_max_memory /
+        GstNvInferObjectHistoryMap::entry_size ();
+    source_info.object_history_map.set_max_entries (CLAMP (max_entries, 1,
+            G_MAXUINT32));
+  }
+  return source_info;
+}
+
+/* Returns the counters of the object history map of each source in a
+ * structure. */
+static GstStructure *
+gst_nvinfer_object_history_stats (GstNvInfer * nvinfer)
+{
+  GstStructure *stats = gst_structure_new_empty ("object-history-stats");
+
+  g_mutex_lock (&nvinfer->process_lock);
+  if (nvinfer->source_info) {
+    for (auto &source_iter : *(nvinfer->source_info)) {
+      GstNvInferHistoryStats source_stats =
+          source_iter.second.object_history_map.stats ();
+      gchar *name = g_strdup_printf ("source-%d", source_iter.first);
+      GstStructure *source = gst_structure_new (name,
+          "entries", G_TYPE_UINT64, source_stats.entries,
+          "max-entries", G_TYPE_UINT64, source_stats.max_entries,
+          "bytes", G_TYPE_UINT64, source_stats.bytes,
+          "hits", G_TYPE_UINT64, source_stats.hits,
+          "misses", G_TYPE_UINT64, source_stats.misses,
+          "inserts", G_TYPE_UINT64, source_stats.inserts,
+          "evicted-aged", G_TYPE_UINT64, source_stats.evicted_aged,
+          "evicted-capacity", G_TYPE_UINT64, source_stats.evicted_capacity,
+          "rejected", G_TYPE_UINT64, source_stats.rejected, NULL);
+      gst_structure_set (stats, name, GST_TYPE_STRUCTURE, source, NULL);
+      gst_structure_free (source);
+      g_free (name);
+    }
+  }
+  g_mutex_unlock (&nvinfer->process_lock);
+  return stats;
+}
+
+/* Returns the counters of the classification cache in a structure, empty if
+ * the element is stopped or does not share its results. */
+static GstStructure *
+gst_nvinfer_classifier_cache_stats (GstNvInfer * nvinfer)
+{
+  GstStructure *stats = gst_structure_new_empty ("classifier-cache-stats");
+
+  g_mutex_lock (&nvinfer->process_lock);
+  if (nvinfer->classifier_cache) {
+    GstNvInferClassificationCacheStats cache_stats =
+        (*nvinfer->classifier_cache)->stats ();
+    gst_structure_set (stats,
+        "id", G_TYPE_STRING, (*nvinfer->classifier_cache)->id ().c_str (),
+        "lookups", G_TYPE_UINT64, cache_stats.lookups,
+        "hits", G_TYPE_UINT64, cache_stats.hits,
+        "misses", G_TYPE_UINT64, cache_stats.misses,
+        "expired", G_TYPE_UINT64, cache_stats.expired,
+        "grown", G_TYPE_UINT64, cache_stats.grown,
+        "stores", G_TYPE_UINT64, cache_stats.stores,
+        "entries", G_TYPE_UINT64, cache_stats.entries,
+        "hit-rate", G_TYPE_DOUBLE, cache_stats.lookups ?
+        (gdouble) cache_stats.hits / cache_stats.lookups : 0.0,
+        "saved-inferences", G_TYPE_UINT64, nvinfer->classifier_cache_saved,
+        NULL);
+  }
+  g_mutex_unlock (&nvinfer->process_lock);
+  return stats;
+}
+
+/* Queues a batch and wakes the thread popping from the queue. Called with
+ * process_lock held. */
+static void
+gst_nvinfer_queue_push (GQueue * queue, GCond * cond,
+    GstNvInferQueueStats * stats, GstNvInferBatch * batch)
+{
+  g_queue_push_tail (queue, batch);
+  stats->pushed++;
+  stats->max_depth = MAX (stats->max_depth, g_queue_get_length (queue));
+  g_cond_signal (cond);
+}
+
+/* Pops a batch, waiting until there is one. Returns NULL once the element is
+ * stopping. Called with process_lock held. */
+static GstNvInferBatch *
+gst_nvinfer_queue_pop (GstNvInfer * nvinfer, GQueue * queue, GCond * cond,
+    GstNvInferQueueStats * stats)
+{
+  if (g_queue_is_empty (queue) && !nvinfer->stop) {
+    gint64 wait_start = g_get_monotonic_time ();
+    while (g_queue_is_empty (queue) && !nvinfer->stop)
+      g_cond_wait (cond, &nvinfer->process_lock);
+    stats->pop_waits++;
+    stats->pop_wait_us += g_get_monotonic_time () - wait_start;
+  }
+  if (nvinfer->stop)
+    return NULL;
+  return (GstNvInferBatch *) g_queue_pop_head (queue);
+}
+
+/* Waits until the input and process queues are empty. Called with
+ * process_lock held, by one thread at a time: the streaming thread, or stop
+ * once streaming has stopped. */
+static void
+gst_nvinfer_wait_queues_drained (GstNvInfer * nvinfer)
+{
+  while (!g_queue_is_empty (nvinfer->input_queue) ||
+      !g_queue_is_empty (nvinfer->process_queue))
+    g_cond_wait (&nvinfer->drain_cond, &nvinfer->process_lock);
+}
+
+/* Logs the counters of a queue between the element threads. */
+static void
+gst_nvinfer_log_queue_stats (GstNvInfer * nvinfer, const gchar * name,
+    GstNvInferQueueStats * stats)
+{
+  GST_INFO_OBJECT (nvinfer, "%s queue: %lu batches, max depth %u, "
+      "%lu pops waited %.3f ms", name, (gulong) stats->pushed,
+      stats->max_depth, (gulong) stats->pop_waits, stats->pop_wait_us / 1e3);
+}
+
 /**
  * Called when an event is recieved on the sink pad. We need to make sure
  * serialized events and buffers are pushed downstream while maintaining the order.
@@ -583,17 +787,12 @@ gst_nvinfer_sink_event (GstBaseTransform * trans, GstEvent * event)
 
     g_mutex_lock (&nvinfer->process_lock);
     /* Push the event marker batch in the processing queue. */
-    g_queue_push_tail (nvinfer->input_queue, batch);
-    g_cond_broadcast (&nvinfer->process_cond);
+    gst_nvinfer_queue_push (nvinfer->input_queue, &nvinfer->input_cond,
+        &nvinfer->input_queue_stats, batch);
 
     /* Wait for all the remaining batches in the queue including the event
      * marker to be processed. */
-    while (!g_queue_is_empty (nvinfer->input_queue)) {
-      g_cond_wait (&nvinfer->process_cond, &nvinfer->process_lock);
-    }
-    while (!g_queue_is_empty (nvinfer->process_queue)) {
-      g_cond_wait (&nvinfer->process_cond, &nvinfer->process_lock);
-    }
+    gst_nvinfer_wait_queues_drained (nvinfer);
     g_mutex_unlock (&nvinfer->process_lock);
   }
 
@@ -601,23 +800,33 @@ gst_nvinfer_sink_event (GstBaseTransform * trans, GstEvent * event)
     /* New source added in the pipeline. Create a source info instance for it. */
     guint source_id;
     gst_nvevent_parse_pad_added (event, &source_id);
-    nvinfer->source_info->emplace (source_id, GstNvInferSourceInfo ());
+    g_mutex_lock (&nvinfer->process_lock);
+    nvinfer->source_info->emplace (source_id,
+        gst_nvinfer_new_source_info (nvinfer));
+    g_mutex_unlock (&nvinfer->process_lock);
   }
 
   if ((GstNvEventType) GST_EVENT_TYPE (event) == GST_NVEVENT_PAD_DELETED) {
     /* Source removed from the pipeline. Remove the related structure. */
     guint source_id;
     gst_nvevent_parse_pad_deleted (event, &source_id);
+    g_mutex_lock (&nvinfer->process_lock);
     nvinfer->source_info->erase (source_id);
+    g_mutex_unlock (&nvinfer->process_lock);
   }
 
   if ((GstNvEventType) GST_EVENT_TYPE (event) == GST_NVEVENT_STREAM_EOS) {
-    /* Got EOS from a source. Clean up the object history map. */
+    /* Got EOS from a source. Clean up the object history map, but for the
+     * objects still being inferred on in asynchronous mode. */
     guint source_id;
     gst_nvevent_parse_stream_eos (event, &source_id);
+    g_mutex_lock (&nvinfer->process_lock);
     auto result = nvinfer->source_info->find (source_id);
     if (result != nvinfer->source_info->end ())
       result->second.object_history_map.clear ();
+    if (nvinfer->classifier_cache)
+      (*nvinfer->classifier_cache)->remove_source (source_id);
+    g_mutex_unlock (&nvinfer->process_lock);
   }
 
   if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
@@ -671,7 +880,7 @@ gst_nvinfer_start (GstBaseTransform * btrans)
   /* Ask NvDsInferContext to copy the input layer contents to host memory if
    * CPU needs to access it. */
   nvinfer->init_params->copyInputToHostBuffers =
-      (nvinfer->write_raw_buffers_to_file ||
+      (nvinfer->write_raw_buffers_to_file || nvinfer->capture_file_path ||
       (nvinfer->output_generated_callback != nullptr));
 
   /* Set the number of output buffers that should be allocated by NvDsInferContext.
@@ -710,13 +919,30 @@ for (auto & layer:*(nvinfer->layers_info)) {
 
   nvinfer->file_write_batch_num = 0;
 
+  /* Create the capture file if enabled. */
+  if (nvinfer->capture_file_path) {
+    nvinfer->capture_writer =
+        NvDsInferTensorCaptureWriterCreate (nvinfer->capture_file_path,
+        nvinfer->unique_id, nvinfer->layers_info->data (),
+        nvinfer->layers_info->size (), CAPTURE_MAX_QUEUED_BATCHES);
+    if (!nvinfer->capture_writer) {
+      GST_ELEMENT_ERROR (nvinfer, RESOURCE, OPEN_WRITE,
+          ("Could not create the capture file"),
+          ("Capture file path: %s", nvinfer->capture_file_path));
+      goto error;
+    }
+  }
+
   /* Create a queue and the associated lock and condition for synchronization.
    * We will be using this queue to maintain the list of frames/objects
    * currently given to the algorithm for processing. */
   nvinfer->process_queue = g_queue_new ();
-  g_mutex_init (&nvinfer->process_lock);
   g_cond_init (&nvinfer->process_cond);
   nvinfer->input_queue = g_queue_new ();
+  g_cond_init (&nvinfer->input_cond);
+  g_cond_init (&nvinfer->drain_cond);
+  nvinfer->input_queue_stats = GstNvInferQueueStats ();
+  nvinfer->process_queue_stats = GstNvInferQueueStats ();
 
   /* Create a buffer pool for internal memory required for scaling frames to
    * network resolution / cropping objects. The pool allocates
@@ -818,10 +1044,10 @@ for (auto & layer:*(nvinfer->layers_info)) {
   nvinfer->transform_params.transform_filter = NvBufSurfTransformInter_Default;
 
   /* Initialize the object history map for source 0. */
+  g_mutex_lock (&nvinfer->process_lock);
   nvinfer->source_info = new std::unordered_map < gint, GstNvInferSourceInfo >;
-  nvinfer->source_info->emplace (0, GstNvInferSourceInfo {
-      GstNvInferObjectHistoryMap (), 0}
-  );
+  nvinfer->source_info->emplace (0, gst_nvinfer_new_source_info (nvinfer));
+  g_mutex_unlock (&nvinfer->process_lock);
 
   if (nvinfer->classifier_async_mode) {
     if (nvinfer->process_full_frame || !IS_CLASSIFIER_INSTANCE (nvinfer)) {
@@ -832,6 +1058,24 @@ for (auto & layer:*(nvinfer->layers_info)) {
     }
   }
 
+  /* Share the classification results with the other instances running the
+   * same classifier. */
+  if (nvinfer->classifier_cache_id) {
+    if (nvinfer->process_full_frame || !IS_CLASSIFIER_INSTANCE (nvinfer)) {
+      GST_ELEMENT_WARNING (nvinfer, LIBRARY, SETTINGS,
+          ("NvInfer classification cache is applicable for secondary "
+              "classifiers only. Not sharing the results"), (nullptr));
+    } else {
+      g_mutex_lock (&nvinfer->process_lock);
+      nvinfer->classifier_cache =
+          new std::shared_ptr < GstNvInferClassificationCache > (
+          GstNvInferClassificationCache::acquire (
+              nvinfer->classifier_cache_id));
+      nvinfer->classifier_cache_saved = 0;
+      g_mutex_unlock (&nvinfer->process_lock);
+    }
+  }
+
   /* Start a thread which will pop output from the algorithm, form NvDsMeta and
    * push buffers to the next element. */
   nvinfer->output_thread =
@@ -856,6 +1100,11 @@ error:
   if (config)
     gst_structure_free (config);
 
+  if (nvinfer->capture_writer) {
+    NvDsInferTensorCaptureWriterDestroy (nvinfer->capture_writer);
+    nvinfer->capture_writer = nullptr;
+  }
+
   if (nvinfer->nvdsinfer_ctx)
     nvinfer->nvdsinfer_ctx->destroy ();
 
@@ -874,14 +1123,10 @@ gst_nvinfer_stop (GstBaseTransform * btrans)
 
   g_mutex_lock (&nvinfer->process_lock);
   /* Wait till all the items in the two queues are handled. */
-  while (!g_queue_is_empty (nvinfer->input_queue)) {
-    g_cond_wait (&nvinfer->process_cond, &nvinfer->process_lock);
-  }
-  while (!g_queue_is_empty (nvinfer->process_queue)) {
-    g_cond_wait (&nvinfer->process_cond, &nvinfer->process_lock);
-  }
+  gst_nvinfer_wait_queues_drained (nvinfer);
   nvinfer->stop = TRUE;
-  g_cond_broadcast (&nvinfer->process_cond);
+  g_cond_signal (&nvinfer->input_cond);
+  g_cond_signal (&nvinfer->process_cond);
   g_mutex_unlock (&nvinfer->process_lock);
 
   g_thread_join (nvinfer->input_queue_thread);
@@ -889,7 +1134,50 @@ gst_nvinfer_stop (GstBaseTransform * btrans)
 
   nvinfer->stop = FALSE;
 
+  gst_nvinfer_log_queue_stats (nvinfer, "Input", &nvinfer->input_queue_stats);
+  gst_nvinfer_log_queue_stats (nvinfer, "Process",
+      &nvinfer->process_queue_stats);
+
+  /* Write the queued batches and close the capture file. */
+  if (nvinfer->capture_writer) {
+    NvDsInferTensorCaptureWriterStats stats;
+    NvDsInferTensorCaptureWriterGetStats (nvinfer->capture_writer, &stats);
+    NvDsInferTensorCaptureWriterDestroy (nvinfer->capture_writer);
+    nvinfer->capture_writer = nullptr;
+    if (stats.droppedBatches || stats.failedBatches)
+      GST_WARNING_OBJECT (nvinfer, "Capture file %s: %lu batches written, "
+          "%lu dropped, %lu failed", nvinfer->capture_file_path,
+          (gulong) stats.writtenBatches, (gulong) stats.droppedBatches,
+          (gulong) stats.failedBatches);
+  }
+
+  g_mutex_lock (&nvinfer->process_lock);
+  for (auto &source_iter : *(nvinfer->source_info)) {
+    GstNvInferHistoryStats stats =
+        source_iter.second.object_history_map.stats ();
+    if (stats.inserts)
+      GST_INFO_OBJECT (nvinfer, "Source %d object history: %lu entries, "
+          "%lu bytes, %lu hits, %lu misses, %lu evicted aged, %lu evicted "
+          "at capacity, %lu rejected", source_iter.first,
+          (gulong) stats.entries, (gulong) stats.bytes, (gulong) stats.hits,
+          (gulong) stats.misses, (gulong) stats.evicted_aged,
+          (gulong) stats.evicted_capacity, (gulong) stats.rejected);
+  }
   delete nvinfer->source_info;
+  nvinfer->source_info = nullptr;
+
+  if (nvinfer->classifier_cache) {
+    GstNvInferClassificationCacheStats stats =
+        (*nvinfer->classifier_cache)->stats ();
+    GST_INFO_OBJECT (nvinfer, "Classification cache %s: %lu lookups, "
+        "%.1f%% hits, %lu inferences saved by this instance",
+        (*nvinfer->classifier_cache)->id ().c_str (), (gulong) stats.lookups,
+        stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0,
+        (gulong) nvinfer->classifier_cache_saved);
+    delete nvinfer->classifier_cache;
+    nvinfer->classifier_cache = nullptr;
+  }
+  g_mutex_unlock (&nvinfer->process_lock);
   delete nvinfer->layers_info;
   delete nvinfer->output_layers_info;
 
@@ -906,9 +1194,10 @@ gst_nvinfer_stop (GstBaseTransform * btrans)
   gst_object_unref (nvinfer->pool);
 
   g_queue_free (nvinfer->process_queue);
-  g_mutex_clear (&nvinfer->process_lock);
   g_cond_clear (&nvinfer->process_cond);
   g_queue_free (nvinfer->input_queue);
+  g_cond_clear (&nvinfer->input_cond);
+  g_cond_clear (&nvinfer->drain_cond);
 
   /* Destroy the INvInferContext instance. */
   nvinfer->nvdsinfer_ctx->destroy ();
@@ -1038,11 +1327,10 @@ gst_nvinfer_input_queue_loop (gpointer data)
     NvDsInferStatus status;
 
     /* Wait if input queue is empty. */
-    if (g_queue_is_empty (nvinfer->input_queue)) {
-      g_cond_wait (&nvinfer->process_cond, &nvinfer->process_lock);
-      continue;
-    }
-    batch = (GstNvInferBatch *) g_queue_pop_head (nvinfer->input_queue);
+    batch = gst_nvinfer_queue_pop (nvinfer, nvinfer->input_queue,
+        &nvinfer->input_cond, &nvinfer->input_queue_stats);
+    if (!batch)
+      break;
 
     /* Check if this is a push buffer or event marker batch. If yes, no need to
      * queue the input for inferencing. */
@@ -1096,14 +1384,18 @@ gst_nvinfer_input_queue_loop (gpointer data)
     if (status != NVDSINFER_SUCCESS) {
       GST_ELEMENT_ERROR (nvinfer, STREAM, FAILED,
           ("Failed to queue input batch for inferencing"), (nullptr));
+      /* The batch does not reach the process queue to wake a thread waiting
+       * for the queues to drain. */
+      if (g_queue_is_empty (nvinfer->input_queue))
+        g_cond_signal (&nvinfer->drain_cond);
       continue;
     }
 
 queue_batch:
     /* Push the batch info structure in the processing queue and notify the
      * output thread that a new batch has been queued. */
-    g_queue_push_tail (nvinfer->process_queue, batch);
-    g_cond_broadcast (&nvinfer->process_cond);
+    gst_nvinfer_queue_push (nvinfer->process_queue, &nvinfer->process_cond,
+        &nvinfer->process_queue_stats, batch);
   }
   g_mutex_unlock (&nvinfer->process_lock);
 
@@ -1153,8 +1445,8 @@ convert_batch_and_push_to_input_thread (GstNvInfer *nvinfer,
   g_mutex_lock (&nvinfer->process_lock);
   /* Push the batch info structure in the processing queue and notify the output
    * thread that a new batch has been queued. */
-  g_queue_push_tail (nvinfer->input_queue, batch);
-  g_cond_broadcast (&nvinfer->process_cond);
+  gst_nvinfer_queue_push (nvinfer->input_queue, &nvinfer->input_cond,
+      &nvinfer->input_queue_stats, batch);
   g_mutex_unlock (&nvinfer->process_lock);
 
   return TRUE;
@@ -1283,44 +1575,14 @@ done:
   return flow_ret;
 }
 
-/* The object history map should be trimmed periodically to keep the map size
- * in check. */
-static void
-cleanup_history_map (GstNvInfer * nvinfer, GstBuffer * inbuf)
-{
-  g_mutex_lock (&nvinfer->process_lock);
-  /* Find the history map for each source whose frames are present in the batch
-   * and trim the map. */
-  for (auto &source_iter : *(nvinfer->source_info)) {
-    GstNvInferSourceInfo &source_info = source_iter.second;
-    if (source_info.last_seen_frame_num - source_info.last_cleanup_frame_num <
-        MAP_CLEANUP_INTERVAL)
-      continue;
-    source_info.last_cleanup_frame_num = source_info.last_seen_frame_num;
-
-    /* Remove entries for objects which have not been seen for
-     * CLEANUP_ACCESS_CRITERIA */
-    auto iterator = source_info.object_history_map.begin ();
-    while (iterator != source_info.object_history_map.end ()) {
-      GstNvInferObjectHistory & history = iterator->second;
-      if (!history.under_inference &&
-          source_info.last_seen_frame_num - history.last_accessed_frame_num >
-          CLEANUP_ACCESS_CRITERIA) {
-        iterator = source_info.object_history_map.erase (iterator);
-      } else {
-        ++iterator;
-      }
-    }
-  }
-  g_mutex_unlock (&nvinfer->process_lock);
-}
-
-
-/* Function to decide if object should be inferred on. */
+/* Function to decide if object should be inferred on. If not because the
+ * classification cache has a fresh result for it, sets shared_hit and copies
+ * the result to shared_info. */
 static inline gboolean
 should_infer_object (GstNvInfer * nvinfer, GstBuffer * inbuf,
-    NvDsObjectMeta * obj_meta, gulong frame_num,
-    GstNvInferObjectHistory * history)
+    NvDsObjectMeta * obj_meta, guint source_id, gulong frame_num,
+    GstNvInferObjectHistory * history, GstNvInferObjectInfo * shared_info,
+    gboolean * shared_hit)
 {
   if (nvinfer->operate_on_gie_id > -1 &&
       obj_meta->unique_component_id != nvinfer->operate_on_gie_id)
@@ -1369,7 +1631,24 @@ should_infer_object (GstNvInfer * nvinfer, GstBuffer * inbuf,
          nvinfer->secondary_reinfer_interval)
       should_reinfer = TRUE;
 
-    return should_reinfer;
+    if (!should_reinfer)
+      return FALSE;
+  }
+
+  /* Another instance running the same classifier, or this one, may have
+   * inferred on the object recently enough. The result is no fresher than
+   * the reinfer interval allows. */
+  if (nvinfer->classifier_cache && IS_CLASSIFIER_INSTANCE (nvinfer) &&
+      obj_meta->object_id != UNTRACKED_OBJECT_ID &&
+      (*nvinfer->classifier_cache)->lookup (source_id, obj_meta->object_id,
+          frame_num, obj_meta->rect_params.width,
+          obj_meta->rect_params.height, MIN (nvinfer->classifier_cache_ttl,
+              nvinfer->secondary_reinfer_interval),
+          nvinfer->classifier_cache_policy, REINFER_AREA_THRESHOLD,
+          shared_info->attributes, shared_info->label)) {
+    *shared_hit = TRUE;
+    nvinfer->classifier_cache_saved++;
+    return FALSE;
   }
 
   return TRUE;
@@ -1420,6 +1699,13 @@ gst_nvinfer_process_objects (GstNvInfer * nvinfer, GstBuffer * inbuf,
     }
     source_info->last_seen_frame_num = frame_meta->frame_num;
 
+    /* Forget the objects not seen for CLEANUP_ACCESS_CRITERIA frames in a
+     * share of the map on every frame, rather than sweeping the whole map. */
+    g_mutex_lock (&nvinfer->process_lock);
+    source_info->object_history_map.evict_aged (frame_meta->frame_num,
+        CLEANUP_ACCESS_CRITERIA, MAP_CLEANUP_INTERVAL);
+    g_mutex_unlock (&nvinfer->process_lock);
+
     /* Iterate through all the objects. */
     for (NvDsMetaList * l_obj = frame_meta->obj_meta_list; l_obj != NULL;
         l_obj = l_obj->next) {
@@ -1427,6 +1713,8 @@ gst_nvinfer_process_objects (GstNvInfer * nvinfer, GstBuffer * inbuf,
       guint idx;
       GstNvInferObjectHistory *obj_history = nullptr;
       gulong frame_num = frame_meta->frame_num;
+      GstNvInferObjectInfo shared_info;
+      gboolean shared_hit = FALSE;
 
       /* Cannot infer on untracked objects in asynchronous mode. */
       if (nvinfer->classifier_async_mode && object_meta->object_id == UNTRACKED_OBJECT_ID) {
@@ -1448,25 +1736,34 @@ gst_nvinfer_process_objects (GstNvInfer * nvinfer, GstBuffer * inbuf,
 
       /* Find the object history if it exists only when tracking id is valid. */
       if (source_info != nullptr && object_meta->object_id != UNTRACKED_OBJECT_ID) {
-        auto search =
-            source_info->object_history_map.find (object_meta->object_id);
-        if (search != source_info->object_history_map.end ()) {
-          obj_history = &search->second;
-        }
+        obj_history = source_info->object_history_map.find (
+            object_meta->object_id, frame_num);
       }
 
-      if (!should_infer_object (nvinfer, inbuf, object_meta, frame_num,
-              obj_history)) {
+      if (!should_infer_object (nvinfer, inbuf, object_meta,
+              frame_meta->pad_index, frame_num, obj_history, &shared_info,
+              &shared_hit)) {
         /* Should not infer again. */
 
-        /* If this is a classifier and we have history we can attach the
-         * last known classification attributes. */
-        if (IS_CLASSIFIER_INSTANCE (nvinfer) && obj_history != nullptr) {
+        /* The classification cache has a fresh result for the object. Keep
+         * it as the last known result and attach it. */
+        if (shared_hit) {
+          GstNvInferFrame frame;
+          frame.obj_meta = object_meta;
+          if (obj_history != nullptr) {
+            merge_classification_output (*obj_history, shared_info);
+            attach_metadata_classifier (nvinfer, nullptr, frame,
+                obj_history->cached_info);
+          } else {
+            attach_metadata_classifier (nvinfer, nullptr, frame, shared_info);
+          }
+        } else if (IS_CLASSIFIER_INSTANCE (nvinfer) && obj_history != nullptr) {
+          /* If this is a classifier and we have history we can attach the
+           * last known classification attributes. */
           GstNvInferFrame frame;
           frame.obj_meta = object_meta;
           attach_metadata_classifier (nvinfer, nullptr, frame,
               obj_history->cached_info);
-          obj_history->last_accessed_frame_num = frame_meta->frame_num;
         }
         g_mutex_unlock (&nvinfer->process_lock);
         continue;
@@ -1480,24 +1777,28 @@ gst_nvinfer_process_objects (GstNvInfer * nvinfer, GstBuffer * inbuf,
         frame.obj_meta = object_meta;
         attach_metadata_classifier (nvinfer, nullptr, frame,
             obj_history->cached_info);
-        obj_history->last_accessed_frame_num = frame_meta->frame_num;
       }
 
       /* Object has a valid tracking id but does not have any history. Create
        * an entry in the map for the object. */
       if (source_info != nullptr && object_meta->object_id != UNTRACKED_OBJECT_ID &&
           obj_history == nullptr) {
-        auto ret_iter =
-            source_info->object_history_map.emplace (object_meta->object_id,
-            GstNvInferObjectHistory ());
-        obj_history = &ret_iter.first->second;
+        obj_history = source_info->object_history_map.insert (
+            object_meta->object_id, frame_num);
+
+        /* The map is at object-history-max-memory with only objects being
+         * inferred on. The result could not be attached in asynchronous
+         * mode. */
+        if (obj_history == nullptr && nvinfer->classifier_async_mode) {
+          g_mutex_unlock (&nvinfer->process_lock);
+          continue;
+        }
       }
 
       /* Update the object history if it is found. */
       if (obj_history != nullptr) {
         obj_history->under_inference = TRUE;
         obj_history->last_inferred_frame_num = frame_num;
-        obj_history->last_accessed_frame_num = frame_num;
         obj_history->last_inferred_coords = object_meta->rect_params;
       }
 
@@ -1548,6 +1849,10 @@ gst_nvinfer_process_objects (GstNvInfer * nvinfer, GstBuffer * inbuf,
       frame.frame_num = frame_num;
       frame.batch_index = frame_meta->batch_id;
       frame.history = obj_history;
+      frame.source_id = frame_meta->pad_index;
+      frame.object_id = object_meta->object_id;
+      frame.object_width = object_meta->rect_params.width;
+      frame.object_height = object_meta->rect_params.height;
       frame.input_surf_params =
           (nvinfer->classifier_async_mode) ? nullptr : (in_surf->surfaceList +
           frame_meta->batch_id);
@@ -1592,12 +1897,6 @@ gst_nvinfer_process_objects (GstNvInfer * nvinfer, GstBuffer * inbuf,
   }
   flow_ret = GST_FLOW_OK;
 
-  if (nvinfer->current_batch_num -
-      nvinfer->last_map_cleanup_frame_num > MAP_CLEANUP_INTERVAL) {
-    cleanup_history_map (nvinfer, inbuf);
-    nvinfer->last_map_cleanup_frame_num = nvinfer->current_batch_num;
-  }
-
 done:
   delete batch;
   return flow_ret;
@@ -1691,8 +1990,8 @@ gst_nvinfer_submit_input_buffer (GstBaseTransform * btrans,
     buf_push_batch->nvtx_complete_buf_range = buf_process_range;
 
     g_mutex_lock (&nvinfer->process_lock);
-    g_queue_push_tail (nvinfer->input_queue, buf_push_batch);
-    g_cond_broadcast (&nvinfer->process_cond);
+    gst_nvinfer_queue_push (nvinfer->input_queue, &nvinfer->input_cond,
+        &nvinfer->input_queue_stats, buf_push_batch);
     g_mutex_unlock (&nvinfer->process_lock);
   }
 
@@ -1751,6 +2050,33 @@ gst_nvinfer_output_generated_file_write (GstBuffer * buf,
   nvinfer->file_write_batch_num++;
 }
 
+/** Queues the contents of the bound input and output layers and the index of
+ * the frames of the batch for the capture file. */
+static void
+gst_nvinfer_output_capture (GstNvInferBatch * batch, GstNvInfer * nvinfer)
+{
+  std::vector < NvDsInferTensorCaptureFrameInfo > frames (batch->frames.size ());
+  std::vector < void *>buffers;
+
+  for (guint i = 0; i < batch->frames.size (); i++) {
+    GstNvInferFrame & frame = batch->frames[i];
+    NvDsInferTensorCaptureFrameInfo & info = frames[i];
+
+    info.pts = frame.frame_meta ? frame.frame_meta->buf_pts : 0;
+    info.sourceId = frame.frame_meta ? frame.frame_meta->source_id : 0;
+    info.frameNum = frame.frame_num;
+    info.objectId = frame.obj_meta ? frame.obj_meta->object_id :
+        UNTRACKED_OBJECT_ID;
+  }
+for (auto & layer:*nvinfer->layers_info)
+    buffers.push_back (layer.buffer);
+
+  if (!NvDsInferTensorCaptureWriterQueueBatch (nvinfer->capture_writer,
+          frames.data (), frames.size (), buffers.data ()))
+    GST_DEBUG_OBJECT (nvinfer, "Capture write queue full, dropped batch %lu",
+        batch->inbuf_batch_num);
+}
+
 /* Called when the last ref on the GstMiniObject inside
  * GstNvInferTensorOutputObject is removed. The batch output can be released
  * back to the NvDsInferContext. */
@@ -1789,15 +2115,15 @@ gst_nvinfer_output_loop (gpointer data)
     GstNvInferBatch *batch = nullptr;
     NvDsInferContextBatchOutput *batch_output;
 
-    /* Wait if processing queue is empty. */
-    if (g_queue_is_empty (nvinfer->process_queue)) {
-      g_cond_wait (&nvinfer->process_cond, &nvinfer->process_lock);
-      continue;
-    }
-
-    /* Pop a batch from the element's process queue. */
-    batch = (GstNvInferBatch *) g_queue_pop_head (nvinfer->process_queue);
-    g_cond_broadcast (&nvinfer->process_cond);
+    /* Pop a batch from the element's process queue. Wait if processing
+     * queue is empty. */
+    batch = gst_nvinfer_queue_pop (nvinfer, nvinfer->process_queue,
+        &nvinfer->process_cond, &nvinfer->process_queue_stats);
+    if (!batch)
+      break;
+    /* Wake a thread waiting for the queues to drain. */
+    if (g_queue_is_empty (nvinfer->process_queue))
+      g_cond_signal (&nvinfer->drain_cond);
 
     /* Event marker used for synchronization. No need to process further. */
     if (batch->event_marker) {
@@ -1876,6 +2202,11 @@ gst_nvinfer_output_loop (gpointer data)
           nvinfer->layers_info->size (), batch->frames.size (), nvinfer);
     }
 
+    /* Queue the layer contents for the capture file if enabled. */
+    if (nvinfer->capture_writer) {
+      gst_nvinfer_output_capture (batch, nvinfer);
+    }
+
     /* Call the output generated callback if specified. */
     if (nvinfer->output_generated_callback) {
       nvinfer->output_generated_callback (batch->inbuf,
@@ -1921,6 +2252,16 @@ gst_nvinfer_output_loop (gpointer data)
          * the new results. */
         auto &  info = (frame.history) ? frame.history->cached_info : new_info;
 
+        /* Share the result with the other instances running the same
+         * classifier. */
+        if (nvinfer->classifier_cache &&
+            frame.object_id != UNTRACKED_OBJECT_ID) {
+          (*nvinfer->classifier_cache)->store (frame.source_id,
+              frame.object_id, frame.frame_num, frame.object_width,
+              frame.object_height, nvinfer->classifier_cache_ttl,
+              info.attributes, info.label);
+        }
+
         /* Attach metadata only if not operating in async mode. In async mode,
          * the GstBuffer and the associated metadata are not valid here, since
          * the buffer is already pushed downstream. The metadata will be updated
@@ -15,14 +15,18 @@
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "cuda_runtime_api.h"
 #include "nvbufsurftransform.h"
 #include <nvdsinfer_context.h>
+#include <nvdsinfer_tensor_capture.h>
 
 #include "gstnvdsinfer.h"
+#include "gstnvinfer_classification_cache.h"
+#include "gstnvinfer_object_history.h"
 
 #include "gstnvdsmeta.h"
 
@@ -67,9 +71,13 @@ enum
   PROP_INTERVAL,
   PROP_GPU_DEVICE_ID,
   PROP_OUTPUT_WRITE_TO_FILE,
+  PROP_OUTPUT_CAPTURE_FILE,
   PROP_OUTPUT_CALLBACK,
   PROP_OUTPUT_CALLBACK_USERDATA,
   PROP_OUTPUT_TENSOR_META,
+  PROP_OBJECT_HISTORY_MAX_MEMORY,
+  PROP_OBJECT_HISTORY_STATS,
+  PROP_CLASSIFIER_CACHE_STATS,
   PROP_LAST
 };
 
@@ -118,10 +126,6 @@ typedef struct
   NvOSD_RectParams last_inferred_coords;
   /** Number of the frame in the stream when the object was last inferred on. */
   gulong last_inferred_frame_num;
-  /** Number of the frame in the stream when the object was last accessed. This
-   * is useful for clearing stale enteries in map of the object histories and
-   * keeping the size of the map in check. */
-  gulong last_accessed_frame_num;
   /** Cached object information. */
   GstNvInferObjectInfo cached_info;
 } GstNvInferObjectHistory;
@@ -155,6 +159,12 @@ typedef struct {
   /** Pointer to the structure holding inference history for the object. Should
    * be NULL when inferencing on frames. */
   GstNvInferObjectHistory *history;
+  /** Source, tracking ID and size of the object, to share its classification
+   * result. Not required when inferencing on frames. */
+  guint source_id = 0;
+  guint64 object_id = UNTRACKED_OBJECT_ID;
+  gfloat object_width = 0;
+  gfloat object_height = 0;
 } GstNvInferFrame;
 
 /**
@@ -181,8 +191,19 @@ typedef struct {
   nvtxRangeId_t nvtx_complete_buf_range = 0;
 } GstNvInferBatch;
 
+/** Keeps the history of the objects being inferred on in the object history
+ * map, the output thread holding a pointer to it. */
+struct GstNvInferObjectHistoryPinned
+{
+  bool operator() (const GstNvInferObjectHistory & history) const
+  {
+    return history.under_inference;
+  }
+};
+
 /** Map type for maintaing inference history for objects based on their tracking ids.*/
-typedef std::unordered_map<guint64, GstNvInferObjectHistory> GstNvInferObjectHistoryMap;
+typedef GstNvInferHistoryTable<GstNvInferObjectHistory,
+    GstNvInferObjectHistoryPinned> GstNvInferObjectHistoryMap;
 
 /**
  * Holds source-specific information.
@@ -191,12 +212,26 @@ typedef struct
 {
   /** Map of object tracking ID and the object infer history. */
   GstNvInferObjectHistoryMap object_history_map;
-  /** Frame number of the buffer when the history map was last cleaned up. */
-  gulong last_cleanup_frame_num;
   /** Frame number of the frame which . */
   gulong last_seen_frame_num;
 } GstNvInferSourceInfo;
 
+/**
+ * Counters of a queue between the element threads, logged when the element
+ * stops.
+ */
+typedef struct
+{
+  /** Batches pushed. */
+  guint64 pushed;
+  /** Largest number of queued batches. */
+  guint max_depth;
+  /** Pops which found the queue empty and waited. */
+  guint64 pop_waits;
+  /** Total time waited by these pops, in microseconds. */
+  gint64 pop_wait_us;
+} GstNvInferQueueStats;
+
 /**
  * Data type used for the refcounting and managing the usage of NvDsInferContext's
  * batch output and the output buffers contained in it. This is especially required
@@ -254,11 +289,18 @@ struct _GstNvInfer {
    * cropping object. */
   GstBufferPool *pool;
 
-  /** Processing Queue and related synchronization structures. */
+  /** Processing Queue and related synchronization structures. Both queues
+   * are guarded by process_lock; each has its own condition signalled to
+   * wake the single thread popping from it, and drain_cond is signalled to
+   * wake the thread waiting for the queues to be empty. */
   GQueue *process_queue;
   GMutex process_lock;
   GCond process_cond;
   GQueue *input_queue;
+  GCond input_cond;
+  GCond drain_cond;
+  GstNvInferQueueStats input_queue_stats;
+  GstNvInferQueueStats process_queue_stats;
 
   /** Output thread. */
   GThread *output_thread;
@@ -316,7 +358,10 @@ struct _GstNvInfer {
 
   /** Per source information. */
   std::unordered_map<gint, GstNvInferSourceInfo> *source_info;
-  gulong last_map_cleanup_frame_num;
+
+  /** Memory the object history map of a source may use, in bytes, 0 for no
+   * limit. */
+  guint64 object_history_max_memory;
 
   /** Current batch number of the input batch. */
   gulong current_batch_num;
@@ -324,6 +369,18 @@ struct _GstNvInfer {
   /** Boolean indicating if the secondary classifier should run in asynchronous mode. */
   gboolean classifier_async_mode;
 
+  /** ID of the classification cache shared with the other instances running
+   * the same secondary classifier, NULL if not sharing results. */
+  gchar *classifier_cache_id;
+  /** Frames after which a shared classification result is too old. */
+  guint classifier_cache_ttl;
+  /** When else a shared classification result is too old. */
+  GstNvInferCacheReinferPolicy classifier_cache_policy;
+  /** The shared classification cache, from start to stop. */
+  std::shared_ptr<GstNvInferClassificationCache> *classifier_cache;
+  /** Objects not inferred on thanks to a shared result. */
+  guint64 classifier_cache_saved;
+
   /** Network input information. */
   NvDsInferNetworkInfo network_info;
 
@@ -339,6 +396,13 @@ struct _GstNvInfer {
   /** Batch counter for writing buffer contents to file. */
   guint64 file_write_batch_num;
 
+  /** Path of the capture file the bound buffer contents should be written to,
+   * NULL if not captured. */
+  gchar *capture_file_path;
+
+  /** Writer appending the bound buffer contents to the capture file. */
+  NvDsInferTensorCaptureWriterHandle capture_writer;
+
   /** Pointer to the callback function and userdata for application access to
    * the bound buffer contents. */
   gst_nvinfer_raw_output_generated_callback output_generated_callback;
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "gstnvinfer_classification_cache.h"
+
+std::shared_ptr < GstNvInferClassificationCache >
+GstNvInferClassificationCache::acquire (const std::string & cache_id)
+{
+  static std::mutex registry_mutex;
+  static std::unordered_map < std::string,
+      std::weak_ptr < GstNvInferClassificationCache > >registry;
+
+  std::unique_lock < std::mutex > lock (registry_mutex);
+  std::shared_ptr < GstNvInferClassificationCache > cache =
+      registry[cache_id].lock ();
+  if (!cache) {
+    cache.reset (new GstNvInferClassificationCache (cache_id));
+    registry[cache_id] = cache;
+  }
+  return cache;
+}
+
+GstNvInferClassificationCache::SourceResults &
+GstNvInferClassificationCache::source_results (unsigned int source_id,
+    unsigned long frame_num)
+{
+  auto iter = m_sources.find (source_id);
+  if (iter == m_sources.end ())
+    iter = m_sources.emplace (source_id, SourceResults ()).first;
+
+  SourceResults & source = iter->second;
+  if (frame_num > source.frame_num)
+    source.frame_num = frame_num;
+  return source;
+}
+
+bool
+GstNvInferClassificationCache::lookup (unsigned int source_id,
+    uint64_t object_id, unsigned long frame_num, float width, float height,
+    unsigned long ttl, GstNvInferCacheReinferPolicy policy, float growth,
+    std::vector < NvDsInferAttribute > &attributes, std::string & label)
+{
+  std::unique_lock < std::mutex > lock (m_mutex);
+  m_stats.lookups++;
+
+  SourceResults & source = source_results (source_id, frame_num);
+  Result *result = source.results.find (object_id, source.frame_num);
+  if (!result) {
+    m_stats.misses++;
+    return false;
+  }
+
+  /* A result of a later frame, stored by an instance ahead of this one, is
+   * fresh. */
+  if (frame_num > result->frame_num && frame_num - result->frame_num > ttl) {
+    m_stats.expired++;
+    return false;
+  }
+  if (policy == GST_NVINFER_CACHE_REINFER_TTL_OR_GROWTH &&
+      result->width * result->height * (1 + growth) < width * height) {
+    m_stats.grown++;
+    return false;
+  }
+
+  m_stats.hits++;
+  attributes = result->attributes;
+  label = result->label;
+  return true;
+}
+
+void
+GstNvInferClassificationCache::store (unsigned int source_id,
+    uint64_t object_id, unsigned long frame_num, float width, float height,
+    unsigned long ttl, const std::vector < NvDsInferAttribute > &attributes,
+    const std::string & label)
+{
+  std::unique_lock < std::mutex > lock (m_mutex);
+  m_stats.stores++;
+  if (ttl > m_max_ttl)
+    m_max_ttl = ttl;
+
+  SourceResults & source = source_results (source_id, frame_num);
+  /* Results are kept up to twice the TTL. */
+  source.results.evict_aged (source.frame_num, m_max_ttl, m_max_ttl);
+
+  Result *result = source.results.find (object_id, source.frame_num);
+  if (!result)
+    result = source.results.insert (object_id, source.frame_num);
+  /* Keep the result of the latest frame. */
+  else if (result->frame_num > frame_num)
+    return;
+
+  result->attributes = attributes;
+  for (auto & attribute:result->attributes) {
+    if (attribute.attributeLabel)
+      attribute.attributeLabel = (char *)
+          m_labels.insert (attribute.attributeLabel).first->c_str ();
+  }
+  result->label = label;
+  result->frame_num = frame_num;
+  result->width = width;
+  result->height = height;
+}
+
+void
+GstNvInferClassificationCache::remove_source (unsigned int source_id)
+{
+  std::unique_lock < std::mutex > lock (m_mutex);
+  m_sources.erase (source_id);
+}
+
+GstNvInferClassificationCacheStats
+GstNvInferClassificationCache::stats ()
+{
+  std::unique_lock < std::mutex > lock (m_mutex);
+  GstNvInferClassificationCacheStats stats = m_stats;
+  stats.entries = 0;
+  for (auto & source:m_sources)
+    stats.entries += source.second.results.size ();
+  return stats;
+}
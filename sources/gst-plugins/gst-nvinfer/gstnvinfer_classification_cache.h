@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __GST_NVINFER_CLASSIFICATION_CACHE_H__
+#define __GST_NVINFER_CLASSIFICATION_CACHE_H__
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "nvdsinfer.h"
+#include "gstnvinfer_object_history.h"
+
+/**
+ * When a result of the classification cache is too old to be used.
+ */
+typedef enum
+{
+  /** When it is older than the TTL. */
+  GST_NVINFER_CACHE_REINFER_TTL = 0,
+  /** When it is older than the TTL or the object area has grown by the
+   * reinference area threshold since. */
+  GST_NVINFER_CACHE_REINFER_TTL_OR_GROWTH = 1,
+} GstNvInferCacheReinferPolicy;
+
+/**
+ * Counters of a classification cache, for all the instances sharing it.
+ */
+typedef struct
+{
+  /** Lookups of tracked objects. */
+  uint64_t lookups;
+  /** Lookups which found a result to use instead of inferring. */
+  uint64_t hits;
+  /** Lookups which found no result. */
+  uint64_t misses;
+  /** Lookups which found a result older than the TTL. */
+  uint64_t expired;
+  /** Lookups which found a result for a smaller object. */
+  uint64_t grown;
+  /** Results stored. */
+  uint64_t stores;
+  /** Results in the cache. */
+  uint64_t entries;
+} GstNvInferClassificationCacheStats;
+
+/**
+ * Classification results shared by the nvinfer instances of a process running
+ * the same classifier, by source and tracking ID. The instances are told to
+ * share a cache by giving it the same ID, which names the model.
+ *
+ * The labels of the attributes are copied to strings owned by the cache and
+ * kept as long as it exists, so that the attributes looked up stay valid as
+ * long as the instance holds the cache.
+ */
+class GstNvInferClassificationCache
+{
+public:
+  /** Returns the cache of cache_id, creating it if no instance holds it. */
+  static std::shared_ptr < GstNvInferClassificationCache >
+      acquire (const std::string & cache_id);
+
+  const std::string & id () const
+  {
+    return m_id;
+  }
+
+  /** Looks up the result of an object of size width x height at frame_num.
+   * Copies it and returns true if it is fresh according to ttl in frames
+   * and policy, growth being the area ratio over which an object grew. */
+  bool lookup (unsigned int source_id, uint64_t object_id,
+      unsigned long frame_num, float width, float height, unsigned long ttl,
+      GstNvInferCacheReinferPolicy policy, float growth,
+      std::vector < NvDsInferAttribute > &attributes, std::string & label);
+
+  /** Stores the result of the inference on an object of size width x height
+   * at frame_num. Results not looked up for ttl frames are evicted. */
+  void store (unsigned int source_id, uint64_t object_id,
+      unsigned long frame_num, float width, float height, unsigned long ttl,
+      const std::vector < NvDsInferAttribute > &attributes,
+      const std::string & label);
+
+  /** Removes the results of a source, at the end of its stream. */
+  void remove_source (unsigned int source_id);
+
+  GstNvInferClassificationCacheStats stats ();
+
+private:
+  typedef struct
+  {
+    std::vector < NvDsInferAttribute > attributes;
+    std::string label;
+    unsigned long frame_num;
+    float width;
+    float height;
+  } Result;
+
+  struct NeverPinned
+  {
+    bool operator() (const Result &) const
+    {
+      return false;
+    }
+  };
+
+  typedef struct
+  {
+    GstNvInferHistoryTable < Result, NeverPinned > results;
+    /* Largest frame number of the source seen, the instances sharing the
+     * cache being at different frames. */
+    unsigned long frame_num;
+  } SourceResults;
+
+  explicit GstNvInferClassificationCache (const std::string & cache_id)
+  : m_id (cache_id)
+  {
+  }
+
+  SourceResults & source_results (unsigned int source_id,
+      unsigned long frame_num);
+
+  std::string m_id;
+  std::mutex m_mutex;
+  std::unordered_map < unsigned int, SourceResults > m_sources;
+  std::unordered_set < std::string > m_labels;
+  /* Largest TTL of the instances, after which unused results are evicted. */
+  unsigned long m_max_ttl = 0;
+  GstNvInferClassificationCacheStats m_stats =
+      GstNvInferClassificationCacheStats ();
+};
+
+#endif
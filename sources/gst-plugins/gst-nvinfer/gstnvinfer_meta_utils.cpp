@@ -80,7 +80,7 @@ attach_metadata_detector (GstNvInfer * nvinfer, GstMiniObject * tensor_out_objec
     obj_meta = nvds_acquire_obj_meta_from_pool (batch_meta);
 
     obj_meta->unique_component_id = nvinfer->unique_id;
-    obj_meta->confidence = 0.0;
+    obj_meta->confidence = obj.confidence;
 
     /* This is an untracked object. Set tracking_id to -1. */
     obj_meta->object_id = UNTRACKED_OBJECT_ID;
@@ -269,6 +269,7 @@ release_segmentation_meta (gpointer data, gpointer user_data)
   } else {
     g_free (meta->class_map);
     g_free (meta->class_probabilities_map);
+    g_free (meta->class_map_runs);
   }
   delete meta;
 }
@@ -283,8 +284,13 @@ copy_segmentation_meta (gpointer data, gpointer user_data)
   meta->classes = src_meta->classes;
   meta->width = src_meta->width;
   meta->height = src_meta->height;
+  meta->map_scale = src_meta->map_scale;
+  meta->num_runs = src_meta->num_runs;
   meta->class_map = (gint *) g_memdup(src_meta->class_map, meta->width * meta->height * sizeof (gint));
-  meta->class_probabilities_map = (gfloat *) g_memdup(src_meta->class_probabilities_map, meta->classes * meta->width * meta->height * sizeof (gfloat));
+  meta->class_probabilities_map = (gfloat *) g_memdup(src_meta->class_probabilities_map,
+      meta->classes * meta->width * meta->height * meta->map_scale *
+      meta->map_scale * sizeof (gfloat));
+  meta->class_map_runs = (gint *) g_memdup(src_meta->class_map_runs, meta->num_runs * 2 * sizeof (gint));
   meta->priv_data = NULL;
 
   return meta;
@@ -305,6 +311,9 @@ attach_metadata_segmentation (GstNvInfer * nvinfer, GstMiniObject * tensor_out_o
   meta->height = segmentation_output.height;
   meta->class_map = segmentation_output.class_map;
   meta->class_probabilities_map = segmentation_output.class_probability_map;
+  meta->map_scale = segmentation_output.map_scale;
+  meta->num_runs = segmentation_output.num_runs;
+  meta->class_map_runs = segmentation_output.class_map_runs;
   meta->priv_data = gst_mini_object_ref (tensor_out_object);
 
   user_meta->user_meta_data = meta;
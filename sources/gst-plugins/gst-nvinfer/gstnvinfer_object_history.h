@@ -0,0 +1,236 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __GST_NVINFER_OBJECT_HISTORY_H__
+#define __GST_NVINFER_OBJECT_HISTORY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Counters of a history table.
+ */
+typedef struct
+{
+  /** Number of entries in the table. */
+  uint64_t entries;
+  /** Largest number of entries, 0 if not capped. */
+  uint64_t max_entries;
+  /** Approximate bytes used by the entries and the hash buckets. */
+  uint64_t bytes;
+  /** Lookups which found an entry. */
+  uint64_t hits;
+  /** Lookups which did not find an entry. */
+  uint64_t misses;
+  /** Entries inserted. */
+  uint64_t inserts;
+  /** Entries evicted for not having been accessed for max_age frames. */
+  uint64_t evicted_aged;
+  /** Least recently accessed entries evicted to insert new ones at the
+   * cap. */
+  uint64_t evicted_capacity;
+  /** Inserts refused at the cap, the entries to evict being pinned. */
+  uint64_t rejected;
+} GstNvInferHistoryStats;
+
+/**
+ * Table of the history of the objects of one source, by tracking ID.
+ *
+ * The entries are kept in a std::unordered_map: the tracking IDs are mostly
+ * consecutive and the map keeps the live ones close together. Instead of
+ * sweeping the whole map at once, the entries not accessed for max_age
+ * frames are evicted by a sweep going through a share of the buckets on each
+ * call, for a whole sweep every interval frames, so that no frame pays for
+ * the whole map. An entry is evicted between max_age and max_age + interval
+ * frames after its last access.
+ *
+ * Pointers to the values stay valid until the entry is removed. Entries for
+ * which IsPinned returns true (objects being inferred on) are never removed.
+ */
+template <typename Value, typename IsPinned>
+class GstNvInferHistoryTable
+{
+public:
+  GstNvInferHistoryTable () = default;
+  GstNvInferHistoryTable (GstNvInferHistoryTable &&) = default;
+  GstNvInferHistoryTable & operator= (GstNvInferHistoryTable &&) = default;
+
+  /** Bytes used by an entry, to convert a memory cap to a number of
+   * entries. */
+  static size_t entry_size ()
+  {
+    /* Map node with its next pointer, and a bucket. */
+    return sizeof (typename Map::value_type) + 2 * sizeof (void *);
+  }
+
+  /** Caps the number of entries, 0 for no cap. */
+  void set_max_entries (uint32_t max_entries)
+  {
+    m_max_entries = max_entries;
+  }
+
+  uint32_t size () const
+  {
+    return m_map.size ();
+  }
+
+  /** Returns the value of key and marks it as accessed at frame_num, nullptr
+   * if there is none. */
+  Value *find (uint64_t key, unsigned long frame_num)
+  {
+    auto it = m_map.find (key);
+    if (it == m_map.end ()) {
+      m_stats.misses++;
+      return nullptr;
+    }
+    m_stats.hits++;
+    it->second.last_access = frame_num;
+    return &it->second.value;
+  }
+
+  /** Inserts a default value for key, which must not be in the table,
+   * accessed at frame_num. At the cap the least recently accessed unpinned
+   * entry among the next ones of the sweep is evicted; returns nullptr if
+   * there is none. */
+  Value *insert (uint64_t key, unsigned long frame_num)
+  {
+    if (m_max_entries && m_map.size () >= m_max_entries && !evict_oldest ()) {
+      m_stats.rejected++;
+      return nullptr;
+    }
+    Entry & entry = m_map[key];
+    entry.last_access = frame_num;
+    m_stats.inserts++;
+    return &entry.value;
+  }
+
+  /** Removes the entries not accessed for more than max_age frames at
+   * frame_num in the buckets due since the previous call, for a whole sweep
+   * of the map every interval frames. */
+  void evict_aged (unsigned long frame_num, unsigned long max_age,
+      unsigned long interval)
+  {
+    /* Nothing is due for the first frame or after the frame numbers went
+     * back. */
+    if (m_sweep_started && frame_num > m_sweep_frame_num)
+      m_sweep_credit += (uint64_t) (frame_num - m_sweep_frame_num) *
+          m_map.bucket_count ();
+    m_sweep_started = true;
+    m_sweep_frame_num = frame_num;
+
+    interval = interval ? interval : 1;
+    uint64_t buckets = m_sweep_credit / interval;
+    m_sweep_credit %= interval;
+    if (buckets > m_map.bucket_count ())
+      buckets = m_map.bucket_count ();
+
+    for (; buckets > 0; buckets--) {
+      size_t bucket = next_bucket ();
+      for (auto it = m_map.begin (bucket); it != m_map.end (bucket); ++it) {
+        if (frame_num - it->second.last_access > max_age &&
+            !m_is_pinned (it->second.value))
+          m_evicted.push_back (it->first);
+      }
+    }
+    for (uint64_t key : m_evicted)
+      m_map.erase (key);
+    m_stats.evicted_aged += m_evicted.size ();
+    m_evicted.clear ();
+  }
+
+  /** Removes all the entries but the pinned ones. */
+  void clear ()
+  {
+    for (auto it = m_map.begin (); it != m_map.end ();) {
+      if (m_is_pinned (it->second.value))
+        ++it;
+      else
+        it = m_map.erase (it);
+    }
+  }
+
+  GstNvInferHistoryStats stats () const
+  {
+    GstNvInferHistoryStats stats = m_stats;
+    stats.entries = m_map.size ();
+    stats.max_entries = m_max_entries;
+    stats.bytes = m_map.size () * (sizeof (typename Map::value_type) +
+        sizeof (void *)) + m_map.bucket_count () * sizeof (void *);
+    return stats;
+  }
+
+private:
+  /* Entries looked at from the sweep position to find one to evict at the
+   * cap. */
+  static const unsigned int kCapScanBudget = 16;
+
+  typedef struct
+  {
+    unsigned long last_access;
+    Value value;
+  } Entry;
+
+  typedef std::unordered_map < uint64_t, Entry > Map;
+
+  /* Bucket at the sweep position, which then moves to the next one. The
+   * position is kept across rehashes, the sweep then skips or repeats part
+   * of the map once. */
+  size_t next_bucket ()
+  {
+    if (m_sweep_bucket >= m_map.bucket_count ())
+      m_sweep_bucket = 0;
+    return m_sweep_bucket++;
+  }
+
+  /* Evicts an entry at the cap. */
+  bool evict_oldest ()
+  {
+    bool found = false;
+    uint64_t oldest = 0;
+    unsigned long oldest_access = 0;
+    unsigned int seen = 0;
+    for (size_t i = 0; i < m_map.bucket_count () && seen < kCapScanBudget;
+        i++) {
+      size_t bucket = next_bucket ();
+      for (auto it = m_map.begin (bucket); it != m_map.end (bucket); ++it) {
+        seen++;
+        if (m_is_pinned (it->second.value))
+          continue;
+        if (!found || it->second.last_access < oldest_access) {
+          found = true;
+          oldest = it->first;
+          oldest_access = it->second.last_access;
+        }
+      }
+    }
+    if (!found)
+      return false;
+    m_map.erase (oldest);
+    m_stats.evicted_capacity++;
+    return true;
+  }
+
+  Map m_map;
+  /* Keys found aged by the sweep, erased once it is past them. */
+  std::vector < uint64_t > m_evicted;
+  size_t m_sweep_bucket = 0;
+  bool m_sweep_started = false;
+  unsigned long m_sweep_frame_num = 0;
+  /* Frames since the previous sweep times the buckets, not yet swept. */
+  uint64_t m_sweep_credit = 0;
+  uint32_t m_max_entries = 0;
+  IsPinned m_is_pinned;
+  GstNvInferHistoryStats m_stats = GstNvInferHistoryStats ();
+};
+
+#endif
@@ -22,6 +22,7 @@
     }
 
 extern const int DEFAULT_REINFER_INTERVAL;
+extern const int DEFAULT_CLASSIFIER_CACHE_TTL;
 
 /* Get the absolute path of a file mentioned in the config given a
  * file path absolute/relative to the config file. */
@@ -303,6 +304,10 @@ gst_nvinfer_parse_props (GstNvInfer * nvinfer,
 
   nvinfer->secondary_reinfer_interval = DEFAULT_REINFER_INTERVAL;
   nvinfer->init_params->networkInputFormat = NvDsInferFormat_RGB;
+  g_free (nvinfer->classifier_cache_id);
+  nvinfer->classifier_cache_id = nullptr;
+  nvinfer->classifier_cache_ttl = DEFAULT_CLASSIFIER_CACHE_TTL;
+  nvinfer->classifier_cache_policy = GST_NVINFER_CACHE_REINFER_TTL_OR_GROWTH;
 
   for (key = keys; *key; key++) {
     if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_UNIQUE_ID)) {
@@ -417,6 +422,55 @@ gst_nvinfer_parse_props (GstNvInfer * nvinfer,
             NVDSINFER_MAX_BATCH_SIZE);
         goto done;
       }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_OUTPUT_PARSE_WORKERS)) {
+      gint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_OUTPUT_PARSE_WORKERS, &error);
+      CHECK_ERROR (error);
+
+      if (val < 0 || val > NVDSINFER_MAX_BATCH_SIZE) {
+        g_printerr ("Error: %s(%d) should be in the range [%d,%d]\n",
+            CONFIG_GROUP_INFER_OUTPUT_PARSE_WORKERS, val, 0,
+            NVDSINFER_MAX_BATCH_SIZE);
+        goto done;
+      }
+      nvinfer->init_params->outputParseWorkers = val;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_LEGACY_OUTPUT_ALLOCATION)) {
+      nvinfer->init_params->legacyOutputAllocation =
+          g_key_file_get_boolean (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_LEGACY_OUTPUT_ALLOCATION, &error);
+      CHECK_ERROR (error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_TENSOR_REPLAY_DIR)) {
+      gchar *str = g_key_file_get_string (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_TENSOR_REPLAY_DIR, &error);
+      CHECK_ERROR (error);
+
+      if (!get_absolute_file_path (cfg_file_path, str,
+              nvinfer->init_params->replayTensorDir)) {
+        g_printerr ("Error: Could not parse tensor replay directory path\n");
+        g_free (str);
+        goto done;
+      }
+      g_free (str);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_TENSOR_REPLAY_LAYERS)) {
+      gsize length;
+      nvinfer->init_params->replayLayers =
+          g_key_file_get_string_list (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_TENSOR_REPLAY_LAYERS, &length, &error);
+      nvinfer->init_params->numReplayLayers = length;
+
+      CHECK_ERROR (error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_TENSOR_REPLAY_RATE)) {
+      nvinfer->init_params->replayBatchRate =
+          g_key_file_get_double (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_TENSOR_REPLAY_RATE, &error);
+      CHECK_ERROR (error);
+
+      if (nvinfer->init_params->replayBatchRate < 0) {
+        g_printerr ("Error: Negative value specified for %s(%.2f)\n",
+            CONFIG_GROUP_INFER_TENSOR_REPLAY_RATE,
+            nvinfer->init_params->replayBatchRate);
+        goto done;
+      }
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_NETWORK_MODE)) {
       guint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
           CONFIG_GROUP_INFER_NETWORK_MODE, &error);
@@ -565,6 +619,14 @@ gst_nvinfer_parse_props (GstNvInfer * nvinfer,
       g_strlcpy (nvinfer->init_params->customBBoxParseFuncName, str,
           _MAX_STR_LENGTH);
       g_free (str);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CUSTOM_PARSER_PROPERTIES)) {
+      gsize length;
+      nvinfer->init_params->customParserProperties =
+          g_key_file_get_string_list (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CUSTOM_PARSER_PROPERTIES, &length, &error);
+      nvinfer->init_params->numCustomParserProperties = length;
+
+      CHECK_ERROR (error);
     } else if (!g_strcmp0 (*key,
             CONFIG_GROUP_INFER_CUSTOM_PARSE_CLASSIFIER_FUNC)) {
       gchar *str = g_key_file_get_string (key_file, CONFIG_GROUP_PROPERTY,
@@ -700,6 +762,23 @@ gst_nvinfer_parse_props (GstNvInfer * nvinfer,
               CONFIG_GROUP_INFER_ENABLE_DBSCAN, &error))
         nvinfer->init_params->useDBScan = TRUE;
       CHECK_ERROR (error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLUSTER_MODE)) {
+      guint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CLUSTER_MODE, &error);
+      CHECK_ERROR (error);
+
+      switch (val) {
+        case NvDsInferClusterMode_OpenCV:
+        case NvDsInferClusterMode_DBSCAN:
+        case NvDsInferClusterMode_Native:
+          break;
+        default:
+          g_printerr ("Error. Invalid value for '%s':'%d'\n",
+              CONFIG_GROUP_INFER_CLUSTER_MODE, val);
+          goto done;
+          break;
+      }
+      nvinfer->init_params->clusterMode = (NvDsInferClusterMode) val;
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLASSIFIER_THRESHOLD)) {
       nvinfer->init_params->classifierThreshold =
           g_key_file_get_double (key_file, CONFIG_GROUP_PROPERTY,
@@ -712,11 +791,73 @@ gst_nvinfer_parse_props (GstNvInfer * nvinfer,
             nvinfer->init_params->classifierThreshold);
         goto done;
       }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLASSIFIER_ACTIVATION)) {
+      guint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CLASSIFIER_ACTIVATION, &error);
+      CHECK_ERROR (error);
+
+      switch (val) {
+        case NvDsInferClassifierActivation_None:
+        case NvDsInferClassifierActivation_Softmax:
+        case NvDsInferClassifierActivation_Sigmoid:
+          break;
+        default:
+          g_printerr ("Error. Invalid value for '%s':'%d'\n",
+              CONFIG_GROUP_INFER_CLASSIFIER_ACTIVATION, val);
+          goto done;
+          break;
+      }
+      nvinfer->init_params->classifierActivation =
+          (NvDsInferClassifierActivation) val;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLASSIFIER_TOP_K)) {
+      gint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CLASSIFIER_TOP_K, &error);
+      CHECK_ERROR (error);
+
+      if (val <= 0) {
+        g_printerr ("Error: %s (%d) should be > 0\n",
+            CONFIG_GROUP_INFER_CLASSIFIER_TOP_K, val);
+        goto done;
+      }
+      nvinfer->init_params->classifierTopK = val;
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLASSIFIER_ASYNC_MODE)) {
       if (g_key_file_get_boolean (key_file, CONFIG_GROUP_PROPERTY,
               CONFIG_GROUP_INFER_CLASSIFIER_ASYNC_MODE, &error))
         nvinfer->classifier_async_mode = TRUE;
       CHECK_ERROR (error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLASSIFIER_CACHE_ID)) {
+      nvinfer->classifier_cache_id =
+          g_key_file_get_string (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CLASSIFIER_CACHE_ID, &error);
+      CHECK_ERROR (error);
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_CLASSIFIER_CACHE_TTL)) {
+      gint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CLASSIFIER_CACHE_TTL, &error);
+      CHECK_ERROR (error);
+
+      if (val <= 0) {
+        g_printerr ("Error: %s (%d) should be > 0\n",
+            CONFIG_GROUP_INFER_CLASSIFIER_CACHE_TTL, val);
+        goto done;
+      }
+      nvinfer->classifier_cache_ttl = val;
+    } else if (!g_strcmp0 (*key,
+            CONFIG_GROUP_INFER_CLASSIFIER_CACHE_REINFER_POLICY)) {
+      guint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_CLASSIFIER_CACHE_REINFER_POLICY, &error);
+      CHECK_ERROR (error);
+
+      switch (val) {
+        case GST_NVINFER_CACHE_REINFER_TTL:
+        case GST_NVINFER_CACHE_REINFER_TTL_OR_GROWTH:
+          nvinfer->classifier_cache_policy =
+              (GstNvInferCacheReinferPolicy) val;
+          break;
+        default:
+          g_printerr ("Error. Invalid value for '%s':'%d'\n",
+              CONFIG_GROUP_INFER_CLASSIFIER_CACHE_REINFER_POLICY, val);
+          goto done;
+      }
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_SEGMENTATION_THRESHOLD)) {
       nvinfer->init_params->segmentationThreshold =
           g_key_file_get_double (key_file, CONFIG_GROUP_PROPERTY,
@@ -729,6 +870,22 @@ gst_nvinfer_parse_props (GstNvInfer * nvinfer,
             nvinfer->init_params->segmentationThreshold);
         goto done;
       }
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_SEGMENTATION_MAP_SCALE)) {
+      gint val = g_key_file_get_integer (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_SEGMENTATION_MAP_SCALE, &error);
+      CHECK_ERROR (error);
+
+      if (val <= 0) {
+        g_printerr ("Error: %s (%d) should be > 0\n",
+            CONFIG_GROUP_INFER_SEGMENTATION_MAP_SCALE, val);
+        goto done;
+      }
+      nvinfer->init_params->segmentationMapScale = val;
+    } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_SEGMENTATION_MAP_RLE)) {
+      nvinfer->init_params->segmentationMapRLE =
+          g_key_file_get_boolean (key_file, CONFIG_GROUP_PROPERTY,
+          CONFIG_GROUP_INFER_SEGMENTATION_MAP_RLE, &error);
+      CHECK_ERROR (error);
     } else if (!g_strcmp0 (*key, CONFIG_GROUP_INFER_INPUT_OBJECT_MIN_WIDTH)) {
       nvinfer->min_input_object_width = g_key_file_get_integer (key_file,
           CONFIG_GROUP_PROPERTY, CONFIG_GROUP_INFER_INPUT_OBJECT_MIN_WIDTH,
@@ -44,6 +44,13 @@
 #define CONFIG_GROUP_INFER_NETWORK_MODE "network-mode"
 #define CONFIG_GROUP_INFER_MODEL_ENGINE "model-engine-file"
 #define CONFIG_GROUP_INFER_INT8_CALIBRATION_FILE "int8-calib-file"
+#define CONFIG_GROUP_INFER_OUTPUT_PARSE_WORKERS "output-parse-workers"
+#define CONFIG_GROUP_INFER_LEGACY_OUTPUT_ALLOCATION "legacy-output-allocation"
+
+/** Replay of recorded output tensors in place of the inference. */
+#define CONFIG_GROUP_INFER_TENSOR_REPLAY_DIR "tensor-replay-dir"
+#define CONFIG_GROUP_INFER_TENSOR_REPLAY_LAYERS "tensor-replay-layers"
+#define CONFIG_GROUP_INFER_TENSOR_REPLAY_RATE "tensor-replay-rate"
 
 /** Generic model parameters. */
 #define CONFIG_GROUP_INFER_OUTPUT_BLOB_NAMES "output-blob-names"
@@ -60,6 +67,7 @@
 /** Custom implementation required to support a network. */
 #define CONFIG_GROUP_INFER_CUSTOM_LIB_PATH "custom-lib-path"
 #define CONFIG_GROUP_INFER_CUSTOM_PARSE_BBOX_FUNC "parse-bbox-func-name"
+#define CONFIG_GROUP_INFER_CUSTOM_PARSER_PROPERTIES "custom-parser-properties"
 #define CONFIG_GROUP_INFER_CUSTOM_PARSE_CLASSIFIER_FUNC "parse-classifier-func-name"
 #define CONFIG_GROUP_INFER_CUSTOM_NETWORK_CONFIG "custom-network-config"
 
@@ -83,13 +91,21 @@
 /** Detector specific parameters. */
 #define CONFIG_GROUP_INFER_NUM_DETECTED_CLASSES "num-detected-classes"
 #define CONFIG_GROUP_INFER_ENABLE_DBSCAN "enable-dbscan"
+#define CONFIG_GROUP_INFER_CLUSTER_MODE "cluster-mode"
 
 /** Classifier specific parameters. */
 #define CONFIG_GROUP_INFER_CLASSIFIER_THRESHOLD "classifier-threshold"
 #define CONFIG_GROUP_INFER_CLASSIFIER_ASYNC_MODE "classifier-async-mode"
+#define CONFIG_GROUP_INFER_CLASSIFIER_ACTIVATION "classifier-activation"
+#define CONFIG_GROUP_INFER_CLASSIFIER_TOP_K "classifier-top-k"
+#define CONFIG_GROUP_INFER_CLASSIFIER_CACHE_ID "classifier-cache-id"
+#define CONFIG_GROUP_INFER_CLASSIFIER_CACHE_TTL "classifier-cache-ttl"
+#define CONFIG_GROUP_INFER_CLASSIFIER_CACHE_REINFER_POLICY "classifier-cache-reinfer-policy"
 
 /** Segmentaion specific parameters. */
 #define CONFIG_GROUP_INFER_SEGMENTATION_THRESHOLD "segmentation-threshold"
+#define CONFIG_GROUP_INFER_SEGMENTATION_MAP_SCALE "segmentation-map-scale"
+#define CONFIG_GROUP_INFER_SEGMENTATION_MAP_RLE "segmentation-map-rle"
 
 /** Parameters for filtering objects based min/max size threshold when
     operating in secondary mode. */
@@ -0,0 +1,245 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks that instances giving the same ID share a classification cache, the
+ * TTL and growth re-infer policies, that the attribute labels outlive the
+ * strings they were stored from and that unused results and the results of
+ * ended streams are evicted. Then counts the inferences of two secondary
+ * classifiers on the same tracked objects, with and without sharing their
+ * results, and times the lookups.
+ *
+ * Usage: test_classification_cache [numFrames]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#include "gstnvinfer_classification_cache.h"
+
+using namespace std;
+
+static const unsigned long kTtl = 30;
+static const float kGrowth = 0.2;
+
+static vector < NvDsInferAttribute >
+make_attributes (char *label, unsigned int value)
+{
+  NvDsInferAttribute attribute;
+  attribute.attributeIndex = 0;
+  attribute.attributeValue = value;
+  attribute.attributeConfidence = 0.9;
+  attribute.attributeLabel = label;
+  return vector < NvDsInferAttribute > (1, attribute);
+}
+
+static bool
+test_sharing_and_policies ()
+{
+  auto a = GstNvInferClassificationCache::acquire ("vehicle-color");
+  auto b = GstNvInferClassificationCache::acquire ("vehicle-color");
+  auto other = GstNvInferClassificationCache::acquire ("vehicle-make");
+  if (a != b || a == other) {
+    printf ("FAILED: caches of the same and other IDs\n");
+    return false;
+  }
+
+  /* The stored label is copied. */
+  char label[] = "red";
+  a->store (0, 7, 10, 100, 50, kTtl, make_attributes (label, 3), "red car");
+  strcpy (label, "xxx");
+
+  vector < NvDsInferAttribute > attributes;
+  string text;
+  if (!b->lookup (0, 7, 20, 100, 50, kTtl, GST_NVINFER_CACHE_REINFER_TTL,
+          kGrowth, attributes, text) || attributes.size () != 1 ||
+      attributes[0].attributeValue != 3 ||
+      strcmp (attributes[0].attributeLabel, "red") || text != "red car") {
+    printf ("FAILED: shared result\n");
+    return false;
+  }
+  if (other->lookup (0, 7, 20, 100, 50, kTtl, GST_NVINFER_CACHE_REINFER_TTL,
+          kGrowth, attributes, text) ||
+      b->lookup (1, 7, 20, 100, 50, kTtl, GST_NVINFER_CACHE_REINFER_TTL,
+          kGrowth, attributes, text)) {
+    printf ("FAILED: result of another model or source\n");
+    return false;
+  }
+
+  /* Older than the TTL, or for an object grown by more than 20%. */
+  bool expired = !b->lookup (0, 7, 10 + kTtl + 1, 100, 50, kTtl,
+      GST_NVINFER_CACHE_REINFER_TTL, kGrowth, attributes, text);
+  bool grown = !b->lookup (0, 7, 20, 130, 50, kTtl,
+      GST_NVINFER_CACHE_REINFER_TTL_OR_GROWTH, kGrowth, attributes, text);
+  bool ttl_only = b->lookup (0, 7, 20, 130, 50, kTtl,
+      GST_NVINFER_CACHE_REINFER_TTL, kGrowth, attributes, text);
+  /* An instance behind the one which stored the result. */
+  bool behind = b->lookup (0, 7, 5, 100, 50, kTtl,
+      GST_NVINFER_CACHE_REINFER_TTL, kGrowth, attributes, text);
+  GstNvInferClassificationCacheStats stats = a->stats ();
+  if (!expired || !grown || !ttl_only || !behind || stats.lookups != 6 ||
+      stats.hits != 3 || stats.misses != 1 || stats.expired != 1 ||
+      stats.grown != 1 || stats.stores != 1 || stats.entries != 1) {
+    printf ("FAILED: expired %d, grown %d, TTL only %d, behind %d, "
+        "%lu hits of %lu lookups\n", expired, grown, ttl_only, behind,
+        (unsigned long) stats.hits, (unsigned long) stats.lookups);
+    return false;
+  }
+
+  /* Results unused for the TTL are evicted. */
+  for (unsigned long frame = 100; frame < 1000; frame++)
+    a->store (0, frame, frame, 100, 50, kTtl, make_attributes (label, 1),
+        "");
+  stats = a->stats ();
+  if (stats.entries > 2 * kTtl + 2) {
+    printf ("FAILED: %lu results kept\n", (unsigned long) stats.entries);
+    return false;
+  }
+
+  /* The end of the stream of a source removes its results. */
+  a->store (1, 7, 10, 100, 50, kTtl, make_attributes (label, 3), "");
+  a->remove_source (1);
+  if (b->lookup (1, 7, 10, 100, 50, kTtl, GST_NVINFER_CACHE_REINFER_TTL,
+          kGrowth, attributes, text)) {
+    printf ("FAILED: result of an ended stream\n");
+    return false;
+  }
+
+  /* A cache no instance holds is destroyed. */
+  a.reset ();
+  b.reset ();
+  if (GstNvInferClassificationCache::acquire ("vehicle-color")->stats ().
+      stores) {
+    printf ("FAILED: cache kept without instances\n");
+    return false;
+  }
+  return true;
+}
+
+/* Instances storing and looking up from several threads. */
+static bool
+test_threads ()
+{
+  auto cache = GstNvInferClassificationCache::acquire ("threads");
+  vector < thread > threads;
+  char label[] = "label";
+  for (unsigned int t = 0; t < 4; t++) {
+    threads.emplace_back ([&, t]() {
+          auto mine = GstNvInferClassificationCache::acquire ("threads");
+          vector < NvDsInferAttribute > attributes;
+          string text;
+          for (unsigned long frame = 0; frame < 20000; frame++) {
+            uint64_t object = frame % 64;
+            if (!mine->lookup (t % 2, object, frame, 10, 10, kTtl,
+                    GST_NVINFER_CACHE_REINFER_TTL, kGrowth, attributes, text))
+              mine->store (t % 2, object, frame, 10, 10, kTtl,
+                  make_attributes (label, t), "");
+          }
+        });
+  }
+  for (auto & t:threads)
+    t.join ();
+  GstNvInferClassificationCacheStats stats = cache->stats ();
+  if (stats.lookups != 80000 || stats.hits + stats.misses + stats.expired !=
+      stats.lookups || stats.entries > 128) {
+    printf ("FAILED: %lu lookups, %lu hits, %lu entries\n",
+        (unsigned long) stats.lookups, (unsigned long) stats.hits,
+        (unsigned long) stats.entries);
+    return false;
+  }
+  return true;
+}
+
+/* Two classifiers on the same objects, re-inferring them every kTtl frames,
+ * the second one after the first on each frame as in a pipeline. Returns the
+ * number of inferences. */
+static unsigned long
+count_inferences (unsigned int num_frames, bool shared, double &lookup_ns,
+    GstNvInferClassificationCacheStats & stats)
+{
+  auto cache = GstNvInferClassificationCache::acquire (shared ? "shared" :
+      "");
+  unordered_map < uint64_t, unsigned long >last_inferred[2];
+  mt19937 rng (3);
+  uniform_int_distribution < unsigned int >lifetime (30, 300);
+  vector < pair < uint64_t, unsigned int >>tracks;
+  uint64_t next_id = 0;
+  for (unsigned int i = 0; i < 50; i++)
+    tracks.push_back ({next_id++, lifetime (rng)});
+
+  char label[] = "label";
+  vector < NvDsInferAttribute > attributes;
+  string text;
+  unsigned long inferences = 0, lookups = 0;
+  double ns = 0;
+  for (unsigned long frame = 1; frame <= num_frames; frame++) {
+    for (auto & track:tracks) {
+      if (--track.second == 0)
+        track = {next_id++, lifetime (rng)};
+      for (unsigned int instance = 0; instance < 2; instance++) {
+        auto last = last_inferred[instance].find (track.first);
+        if (last != last_inferred[instance].end () &&
+            frame - last->second <= kTtl)
+          continue;
+        if (shared) {
+          auto start = chrono::steady_clock::now ();
+          bool hit = cache->lookup (0, track.first, frame, 10, 10, kTtl,
+              GST_NVINFER_CACHE_REINFER_TTL, kGrowth, attributes, text);
+          ns += chrono::duration < double, nano > (
+              chrono::steady_clock::now () - start).count ();
+          lookups++;
+          if (hit)
+            continue;
+        }
+        inferences++;
+        last_inferred[instance][track.first] = frame;
+        if (shared)
+          cache->store (0, track.first, frame, 10, 10, kTtl,
+              make_attributes (label, 1), "");
+      }
+    }
+  }
+  lookup_ns = lookups ? ns / lookups : 0;
+  stats = cache->stats ();
+  return inferences;
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int num_frames = argc > 1 ? atoi (argv[1]) : 20000;
+  bool ok = test_sharing_and_policies () && test_threads ();
+  if (ok)
+    printf ("Classification cache sharing, policies and eviction: OK\n");
+
+  double lookup_ns;
+  GstNvInferClassificationCacheStats stats;
+  unsigned long alone = count_inferences (num_frames, false, lookup_ns,
+      stats);
+  unsigned long shared = count_inferences (num_frames, true, lookup_ns,
+      stats);
+  printf ("2 classifiers, 50 objects per frame, TTL %lu frames: %lu "
+      "inferences alone, %lu sharing results (%.1f%% saved), hit rate "
+      "%.1f%%, %.0f ns per lookup\n", kTtl, alone, shared,
+      100.0 * (alone - shared) / alone,
+      stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0, lookup_ns);
+
+  if (!ok) {
+    printf ("FAILED\n");
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,294 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks GstNvInferHistoryTable against a std::unordered_map through random
+ * lookups, inserts and evictions, that pinned entries are never evicted and
+ * that the cap on the number of entries holds. Then times the object history
+ * of a source with churning tracking IDs: the table sweeping a share of the
+ * map on every frame against an unordered_map swept every 1800 frames as
+ * nvinfer did.
+ *
+ * Usage: test_object_history [numFrames]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "gstnvinfer_object_history.h"
+
+using namespace std;
+
+struct TestValue
+{
+  uint64_t key = 0;
+  bool pinned = false;
+};
+
+struct TestPinned
+{
+  bool operator() (const TestValue & value) const
+  {
+    return value.pinned;
+  }
+};
+
+typedef GstNvInferHistoryTable < TestValue, TestPinned > TestTable;
+
+static const unsigned long kMaxAge = 150;
+
+/* Random operations on keys in [0, 4096), checked against a map of the keys
+ * to their last access: the entries accessed in the last max_age frames are
+ * found, the entries never inserted are not. */
+static bool
+test_against_map (unsigned int num_ops)
+{
+  TestTable table;
+  unordered_map < uint64_t, unsigned long >reference;
+  mt19937 rng (1);
+  unsigned long frame = 0;
+
+  for (unsigned int op = 0; op < num_ops; op++) {
+    if (op % 64 == 0) {
+      frame++;
+      table.evict_aged (frame, kMaxAge, kMaxAge);
+    }
+    uint64_t key = rng () % 4096;
+    TestValue *value = table.find (key, frame);
+    auto it = reference.find (key);
+    bool expected = it != reference.end ();
+    if (value ? !expected || value->key != key :
+        expected && frame - it->second <= kMaxAge) {
+      printf ("FAILED: op %u key %lu found %d expected %d\n", op,
+          (unsigned long) key, value != nullptr, expected);
+      return false;
+    }
+    if (!value) {
+      value = table.insert (key, frame);
+      value->key = key;
+    }
+    reference[key] = frame;
+    if (table.size () > reference.size ()) {
+      printf ("FAILED: %u entries, %zu keys\n", table.size (),
+          reference.size ());
+      return false;
+    }
+  }
+
+  table.clear ();
+  GstNvInferHistoryStats stats = table.stats ();
+  if (stats.entries || stats.hits + stats.misses != num_ops ||
+      !stats.evicted_aged) {
+    printf ("FAILED: %lu entries after clear, %lu evicted\n",
+        (unsigned long) stats.entries, (unsigned long) stats.evicted_aged);
+    return false;
+  }
+  return true;
+}
+
+/* Pinned entries outlive max_age and the cap, and keep their address. */
+static bool
+test_pinned_and_cap ()
+{
+  TestTable table;
+  table.set_max_entries (100);
+  vector < TestValue * >pinned;
+  for (uint64_t key = 0; key < 10; key++) {
+    TestValue *value = table.insert (key, 0);
+    value->key = key;
+    value->pinned = true;
+    pinned.push_back (value);
+  }
+  for (unsigned long frame = 1; frame < 2000; frame++) {
+    for (uint64_t i = 0; i < 20; i++) {
+      uint64_t key = 1000 + frame * 20 + i;
+      TestValue *value = table.insert (key, frame);
+      if (!value) {
+        printf ("FAILED: insert of %lu at the cap\n", (unsigned long) key);
+        return false;
+      }
+      value->key = key;
+    }
+    table.evict_aged (frame, kMaxAge, kMaxAge);
+    if (table.size () > 100) {
+      printf ("FAILED: %u entries over the cap\n", table.size ());
+      return false;
+    }
+  }
+  for (uint64_t key = 0; key < 10; key++) {
+    if (table.find (key, 2000) != pinned[key] || pinned[key]->key != key) {
+      printf ("FAILED: pinned key %lu evicted\n", (unsigned long) key);
+      return false;
+    }
+  }
+
+  /* A table full of pinned entries refuses inserts. */
+  for (uint64_t key = 0; key < 200; key++) {
+    TestValue *value = table.insert (100000 + key, 2000);
+    if (value)
+      value->pinned = true;
+  }
+  GstNvInferHistoryStats stats = table.stats ();
+  if (stats.entries != 100 || !stats.rejected || !stats.evicted_capacity) {
+    printf ("FAILED: %lu entries, %lu rejected, %lu evicted at the cap\n",
+        (unsigned long) stats.entries, (unsigned long) stats.rejected,
+        (unsigned long) stats.evicted_capacity);
+    return false;
+  }
+  table.clear ();
+  if (table.size () != 100) {
+    printf ("FAILED: pinned entries cleared\n");
+    return false;
+  }
+  return true;
+}
+
+/* Tracks of a source: objects_per_frame objects, each tracked for
+ * min_lifetime to max_lifetime frames under a new ID. */
+class TrackChurn
+{
+public:
+  TrackChurn (unsigned int objects_per_frame, unsigned int min_lifetime,
+      unsigned int max_lifetime)
+  : m_rng (2), m_lifetime (min_lifetime, max_lifetime)
+  {
+    for (unsigned int i = 0; i < objects_per_frame; i++)
+      m_tracks.push_back ({m_next_id++, m_lifetime (m_rng)});
+  }
+
+  const vector < pair < uint64_t, unsigned int >>&next_frame ()
+  {
+    for (auto & track : m_tracks) {
+      if (--track.second == 0)
+        track = {m_next_id++, m_lifetime (m_rng)};
+    }
+    return m_tracks;
+  }
+
+private:
+  mt19937 m_rng;
+  uniform_int_distribution < unsigned int >m_lifetime;
+  uint64_t m_next_id = 0;
+  vector < pair < uint64_t, unsigned int >>m_tracks;
+};
+
+/* nvinfer before: find or emplace, sweep the whole map every 1800 frames. */
+struct MapHistory
+{
+  unordered_map < uint64_t, pair < unsigned long, TestValue >>map;
+  unsigned long last_cleanup = 0;
+
+  void frame (unsigned long frame_num,
+      const vector < pair < uint64_t, unsigned int >>&tracks)
+  {
+    for (auto & track : tracks) {
+      auto it = map.find (track.first);
+      if (it == map.end ())
+        it = map.emplace (track.first,
+            make_pair (frame_num, TestValue ())).first;
+      it->second.first = frame_num;
+    }
+    if (frame_num - last_cleanup < 1800)
+      return;
+    for (auto it = map.begin (); it != map.end ();) {
+      if (frame_num - it->second.first > kMaxAge)
+        it = map.erase (it);
+      else
+        it++;
+    }
+    last_cleanup = frame_num;
+  }
+
+  size_t size () const
+  {
+    return map.size ();
+  }
+};
+
+struct TableHistory
+{
+  TestTable table;
+
+  void frame (unsigned long frame_num,
+      const vector < pair < uint64_t, unsigned int >>&tracks)
+  {
+    for (auto & track : tracks) {
+      if (!table.find (track.first, frame_num))
+        table.insert (track.first, frame_num);
+    }
+    table.evict_aged (frame_num, kMaxAge, kMaxAge);
+  }
+
+  size_t size () const
+  {
+    return table.size ();
+  }
+};
+
+template < typename History > static void
+time_churn (const char *name, unsigned int num_frames,
+    unsigned int objects_per_frame, unsigned int min_lifetime,
+    unsigned int max_lifetime)
+{
+  History history;
+  TrackChurn churn (objects_per_frame, min_lifetime, max_lifetime);
+  vector < double >times;
+  size_t max_entries = 0;
+  times.reserve (num_frames);
+  for (unsigned long frame = 1; frame <= num_frames; frame++) {
+    auto &tracks = churn.next_frame ();
+    auto start = chrono::steady_clock::now ();
+    history.frame (frame, tracks);
+    times.push_back (chrono::duration < double, micro > (
+            chrono::steady_clock::now () - start).count ());
+    max_entries = max (max_entries, history.size ());
+  }
+  double total = 0;
+  for (double t : times)
+    total += t;
+  sort (times.begin (), times.end ());
+  printf ("  %s: %.2f us per frame, p99 %.2f us, max %.2f us, "
+      "up to %zu entries\n", name, total / num_frames,
+      times[num_frames * 99 / 100], times.back (), max_entries);
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int num_frames = argc > 1 ? atoi (argv[1]) : 20000;
+  bool ok = test_against_map (1000000) && test_pinned_and_cap ();
+  if (ok)
+    printf ("Object history lookups and evictions: OK\n");
+
+  struct
+  {
+    unsigned int objects_per_frame, min_lifetime, max_lifetime;
+  } churns[] = { {200, 30, 300}, {200, 2, 20}, {1000, 2, 20} };
+  for (auto & c : churns) {
+    printf ("%u objects per frame tracked for %u to %u frames:\n",
+        c.objects_per_frame, c.min_lifetime, c.max_lifetime);
+    time_churn < MapHistory > ("unordered_map swept every 1800 frames",
+        num_frames, c.objects_per_frame, c.min_lifetime, c.max_lifetime);
+    time_churn < TableHistory > ("table swept over 150 frames",
+        num_frames, c.objects_per_frame, c.min_lifetime, c.max_lifetime);
+  }
+
+  if (!ok) {
+    printf ("FAILED\n");
+    return -1;
+  }
+  return 0;
+}
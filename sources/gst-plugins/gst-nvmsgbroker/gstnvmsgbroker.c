@@ -12,6 +12,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
 #include <dlfcn.h>
+#include <string.h>
 #include "gstnvmsgbroker.h"
 #include "gstnvdsmeta.h"
 #include "nvdsmeta_schema.h"
@@ -30,6 +31,8 @@ static void gst_nvmsgbroker_finalize (GObject * object);
 static gboolean gst_nvmsgbroker_set_caps (GstBaseSink * sink, GstCaps * caps);
 static gboolean gst_nvmsgbroker_start (GstBaseSink * sink);
 static gboolean gst_nvmsgbroker_stop (GstBaseSink * sink);
+static gboolean gst_nvmsgbroker_unlock (GstBaseSink * sink);
+static gboolean gst_nvmsgbroker_unlock_stop (GstBaseSink * sink);
 static GstFlowReturn gst_nvmsgbroker_render (GstBaseSink * sink,
     GstBuffer * buffer);
 
@@ -51,10 +54,45 @@ nvds_msgapi_send_callback (void *data, NvDsMsgApiErrorType status)
 
   if (status != NVDS_MSGAPI_OK) {
     GST_ERROR_OBJECT (self, "error(%d) in sending data", status);
+    /* spool next messages until the adaptor accepts one again */
+    if (self->spool)
+      g_atomic_int_set (&self->outage, TRUE);
   }
   g_mutex_unlock (&self->flowLock);
 }
 
+/**
+ * Asynchronous send of a message, kept to spool it if the send fails.
+ */
+typedef struct
+{
+  GstNvMsgBroker *self;
+  GstNvMsgBrokerMsg msg;
+  /* FALSE if data was handed over to the adaptor */
+  gboolean ownsData;
+} GstNvMsgBrokerSendCtx;
+
+static void gst_nvmsgbroker_spool_store (GstNvMsgBroker * self,
+    GstNvMsgBrokerMsg * msg);
+
+static void
+nvds_msgapi_spool_send_callback (void *data, NvDsMsgApiErrorType status)
+{
+  GstNvMsgBrokerSendCtx *ctx = (GstNvMsgBrokerSendCtx *) data;
+  GstNvMsgBroker *self = ctx->self;
+
+  /* adaptor releases the payload only after the callback */
+  if (status != NVDS_MSGAPI_OK)
+    gst_nvmsgbroker_spool_store (self, &ctx->msg);
+
+  if (!ctx->ownsData)
+    ctx->msg.data = NULL;
+  gst_nvmsgbroker_msg_clear (&ctx->msg);
+
+  nvds_msgapi_send_callback (self, status);
+  g_free (ctx);
+}
+
 enum
 {
   PROP_0,
@@ -62,9 +100,57 @@ enum
   PROP_CONFIG_FILE,
   PROP_PROTOCOL_LIBRARY,
   PROP_TOPIC,
-  PROP_COMPONENT_ID
+  PROP_COMPONENT_ID,
+  PROP_QUEUE_SIZE,
+  PROP_OVERFLOW_POLICY,
+  PROP_QUEUE_DEPTH,
+  PROP_SENT,
+  PROP_DROPPED,
+  PROP_SEND_LATENCY_AVG,
+  PROP_SEND_LATENCY_MAX,
+  PROP_SPOOL_DIR,
+  PROP_SPOOL_SEGMENT_SIZE,
+  PROP_SPOOL_MAX_SIZE,
+  PROP_SPOOL_WATERMARK,
+  PROP_SPOOL_REPLAY_RATE,
+  PROP_SPOOL_RETRY_INTERVAL,
+  PROP_SPOOLED
 };
 
+#define DEFAULT_QUEUE_SIZE 1024
+#define DEFAULT_OVERFLOW_POLICY GST_NVMSGBROKER_OVERFLOW_BLOCK
+#define DEFAULT_SPOOL_SEGMENT_SIZE (16 * 1024 * 1024)
+#define DEFAULT_SPOOL_MAX_SIZE ((guint64) 1024 * 1024 * 1024)
+#define DEFAULT_SPOOL_WATERMARK 0
+#define DEFAULT_SPOOL_REPLAY_RATE 100
+#define DEFAULT_SPOOL_RETRY_INTERVAL 1000
+#define MIN_SPOOL_SEGMENT_SIZE (64 * 1024)
+
+/* Max messages sent between two calls to nvds_msgapi_do_work */
+#define SEND_BURST_SIZE 32
+/* Interval to call nvds_msgapi_do_work while callbacks are pending */
+#define DO_WORK_INTERVAL_US 1000
+
+#define GST_TYPE_NVMSGBROKER_OVERFLOW_POLICY (gst_nvmsgbroker_overflow_policy_get_type ())
+
+static GType
+gst_nvmsgbroker_overflow_policy_get_type (void)
+{
+  static GType qtype = 0;
+
+  if (qtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_NVMSGBROKER_OVERFLOW_BLOCK, "Block until queue has room", "block"},
+      {GST_NVMSGBROKER_OVERFLOW_DROP_OLDEST, "Drop oldest queued message", "drop-oldest"},
+      {GST_NVMSGBROKER_OVERFLOW_DROP_NEWEST, "Drop new message", "drop-newest"},
+      {0, NULL, NULL}
+    };
+
+    qtype = g_enum_register_static ("GstNvMsgBrokerOverflowPolicy", values);
+  }
+  return qtype;
+}
+
 static GstStaticPadTemplate gst_nvmsgbroker_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -75,26 +161,281 @@ G_DEFINE_TYPE_WITH_CODE (GstNvMsgBroker, gst_nvmsgbroker, GST_TYPE_BASE_SINK,
     GST_DEBUG_CATEGORY_INIT (gst_nvmsgbroker_debug_category, "nvmsgbroker", 0,
         "debug category for nvmsgbroker element"));
 
+static NvDsMsgApiErrorType
+gst_nvmsgbroker_send_msg (GstNvMsgBroker * self, GstNvMsgBrokerMsg * msg)
+{
+  NvDsMsgApiErrorType err;
+  GstNvMsgBrokerSendCtx *ctx = NULL;
+  nvds_msgapi_send_cb_t cb = nvds_msgapi_send_callback;
+  gpointer cbData = self;
+  gint64 latency;
+
+  if (self->asyncSend) {
+    g_mutex_lock (&self->flowLock);
+    self->pendingCbCount++;
+    g_mutex_unlock (&self->flowLock);
+
+    /* message is kept until the callback to spool it if the send fails */
+    if (self->spool) {
+      ctx = g_new0 (GstNvMsgBrokerSendCtx, 1);
+      ctx->self = self;
+      ctx->msg = *msg;
+      ctx->ownsData = TRUE;
+      cb = nvds_msgapi_spool_send_callback;
+      cbData = ctx;
+    }
+
+    if (self->nvds_msgapi_send_async_nocopy) {
+      err = self->nvds_msgapi_send_async_nocopy (self->connHandle, self->topic,
+                                        (uint8_t *) msg->data, msg->size, msg->key,
+                                        msg->key ? strlen (msg->key) : 0,
+                                        g_free, cb, cbData);
+      /* data is released by the adaptor once sent */
+      if (err == NVDS_MSGAPI_OK) {
+        msg->data = NULL;
+        if (ctx)
+          ctx->ownsData = FALSE;
+      }
+    } else if (msg->key && self->nvds_msgapi_send_async_with_key)
+      err = self->nvds_msgapi_send_async_with_key (self->connHandle, self->topic,
+                                        (uint8_t *) msg->data, msg->size,
+                                        msg->key, strlen (msg->key),
+                                        cb, cbData);
+    else
+      err = self->nvds_msgapi_send_async (self->connHandle, self->topic,
+                                        (uint8_t *) msg->data, msg->size,
+                                        cb, cbData);
+
+    if (err != NVDS_MSGAPI_OK) {
+      g_mutex_lock (&self->flowLock);
+      self->pendingCbCount--;
+      g_mutex_unlock (&self->flowLock);
+      g_free (ctx);
+    } else if (ctx) {
+      /* context owns the message now */
+      msg->data = NULL;
+      msg->key = NULL;
+    }
+  } else {
+    if (msg->key && self->nvds_msgapi_send_with_key)
+      err = self->nvds_msgapi_send_with_key (self->connHandle, self->topic,
+                                  (uint8_t *) msg->data, msg->size,
+                                  msg->key, strlen (msg->key));
+    else
+      err = self->nvds_msgapi_send (self->connHandle, self->topic,
+                                  (uint8_t *) msg->data, msg->size);
+  }
+
+  if (err == NVDS_MSGAPI_OK) {
+    latency = g_get_monotonic_time () - msg->enqueueTime;
+    GST_OBJECT_LOCK (self);
+    self->sentCount++;
+    self->sendLatencySum += latency;
+    if ((guint64) latency > self->sendLatencyMax)
+      self->sendLatencyMax = latency;
+    GST_OBJECT_UNLOCK (self);
+  }
+  return err;
+}
+
+/**
+ * Stores a copy of the message in the spool, to be sent later. Message is
+ * dropped if it doesn't fit in the spool.
+ */
+static void
+gst_nvmsgbroker_spool_store (GstNvMsgBroker * self, GstNvMsgBrokerMsg * msg)
+{
+  gboolean written;
+
+  written = gst_nvmsgbroker_spool_write (self->spool, msg);
+  /* next segment is normally prepared ahead by the sender thread */
+  if (!written && !gst_nvmsgbroker_spool_ready (self->spool) &&
+      gst_nvmsgbroker_spool_prepare (self->spool))
+    written = gst_nvmsgbroker_spool_write (self->spool, msg);
+
+  if (!written) {
+    GST_WARNING_OBJECT (self, "unable to spool message of %" G_GSIZE_FORMAT
+        " bytes, dropping it", msg->size);
+    GST_OBJECT_LOCK (self);
+    self->droppedCount++;
+    GST_OBJECT_UNLOCK (self);
+  }
+}
+
+/**
+ * Moves the message to the spool, to be sent later.
+ */
+static void
+gst_nvmsgbroker_spool_msg (GstNvMsgBroker * self, GstNvMsgBrokerMsg * msg)
+{
+  gst_nvmsgbroker_spool_store (self, msg);
+  gst_nvmsgbroker_msg_clear (msg);
+}
+
+/**
+ * Sends a message taken out of the queue. Messages rejected by the adaptor
+ * are spooled if the spool is enabled, as well as the next ones until the
+ * spool is drained, so that they're sent in order.
+ */
+static void
+gst_nvmsgbroker_handle_msg (GstNvMsgBroker * self, GstNvMsgBrokerMsg * msg)
+{
+  NvDsMsgApiErrorType err;
+
+  if (self->spool && (g_atomic_int_get (&self->outage) ||
+          gst_nvmsgbroker_spool_count (self->spool))) {
+    gst_nvmsgbroker_spool_msg (self, msg);
+    /* replay the spool faster to keep up with new messages */
+    if (!g_atomic_int_get (&self->outage))
+      self->replayCredit++;
+    return;
+  }
+
+  err = gst_nvmsgbroker_send_msg (self, msg);
+  if (err == NVDS_MSGAPI_OK) {
+    gst_nvmsgbroker_msg_clear (msg);
+    return;
+  }
+
+  if (self->spool) {
+    GST_WARNING_OBJECT (self, "error(%d) in sending data, spooling messages "
+        "until broker is available", err);
+    g_atomic_int_set (&self->outage, TRUE);
+    self->nextReplayTime = g_get_monotonic_time () +
+        self->spoolRetryInterval * G_TIME_SPAN_MILLISECOND;
+    self->replayCredit = 0;
+    gst_nvmsgbroker_spool_msg (self, msg);
+    return;
+  }
+
+  GST_ELEMENT_ERROR (self, LIBRARY, FAILED, (NULL),
+                     ("failed to send the message. err(%d)", err));
+  g_atomic_int_set (&self->sendFailed, TRUE);
+  gst_nvmsgbroker_msg_clear (msg);
+}
+
+/**
+ * Sends spooled messages at the replay rate, plus one per new message spooled
+ * behind them. While in outage, a single message is tried every retry
+ * interval.
+ */
+static void
+gst_nvmsgbroker_replay (GstNvMsgBroker * self)
+{
+  GstNvMsgBrokerMsg msg;
+  GstNvMsgBrokerSpoolPos pos;
+  NvDsMsgApiErrorType err;
+  gint64 now = g_get_monotonic_time ();
+  gint64 interval = self->spoolReplayRate ?
+      G_TIME_SPAN_SECOND / self->spoolReplayRate : 0;
+  guint sent;
+
+  /* don't accumulate credit while idle */
+  if (self->nextReplayTime < now - G_TIME_SPAN_SECOND)
+    self->nextReplayTime = now;
+
+  for (sent = 0; sent < SEND_BURST_SIZE && (self->nextReplayTime <= now ||
+          (self->replayCredit && !g_atomic_int_get (&self->outage))); sent++) {
+    if (!gst_nvmsgbroker_spool_peek (self->spool, &msg, &pos)) {
+      self->replayCredit = 0;
+      return;
+    }
+
+    err = gst_nvmsgbroker_send_msg (self, &msg);
+    gst_nvmsgbroker_msg_clear (&msg);
+
+    if (err != NVDS_MSGAPI_OK) {
+      g_atomic_int_set (&self->outage, TRUE);
+      self->nextReplayTime = now +
+          self->spoolRetryInterval * G_TIME_SPAN_MILLISECOND;
+      self->replayCredit = 0;
+      return;
+    }
+
+    gst_nvmsgbroker_spool_consume (self->spool, &pos);
+    if (g_atomic_int_get (&self->outage)) {
+      GST_INFO_OBJECT (self, "broker available, replaying %" G_GUINT64_FORMAT
+          " spooled messages", gst_nvmsgbroker_spool_count (self->spool));
+      g_atomic_int_set (&self->outage, FALSE);
+    }
+    if (self->replayCredit)
+      self->replayCredit--;
+    else
+      self->nextReplayTime += interval;
+  }
+}
+
+/**
+ * Sender thread: sends the queued messages and drives the adaptor with
+ * nvds_msgapi_do_work while callbacks are pending. Queue is drained before
+ * the thread exits.
+ */
 static gpointer
-gst_nvmsgbroker_do_work (gpointer data)
+gst_nvmsgbroker_send_thread (gpointer data)
 {
   GstNvMsgBroker *self = (GstNvMsgBroker *) data;
+  GstNvMsgBrokerMsg msg;
+  gint64 wakeTime;
+  gint pending;
+  guint sent;
+
+  while (TRUE) {
+    for (sent = 0; sent < SEND_BURST_SIZE &&
+        gst_nvmsgbroker_queue_pop (self->queue, &msg); sent++)
+      gst_nvmsgbroker_handle_msg (self, &msg);
+
+    if (sent && g_atomic_int_get (&self->producersWaiting)) {
+      g_mutex_lock (&self->flowLock);
+      g_cond_broadcast (&self->spaceCond);
+      g_mutex_unlock (&self->flowLock);
+    }
 
-  while (self->isRunning) {
     g_mutex_lock (&self->flowLock);
-    while (self->isRunning && self->pendingCbCount <= 0) {
-      g_cond_wait (&self->flowCond, &self->flowLock);
-    }
+    pending = self->pendingCbCount;
     g_mutex_unlock (&self->flowLock);
 
-    if (!self->isRunning) {
-      return NULL;
+    if (self->spool && g_atomic_int_get (&self->isRunning)) {
+      /* segment files are created here rather than by the streaming thread */
+      gst_nvmsgbroker_spool_prepare (self->spool);
+      gst_nvmsgbroker_replay (self);
     }
 
-    self->nvds_msgapi_do_work (self->connHandle);
-    // wait 10ms.
-    g_usleep (10 * 1000);
+    if (self->asyncSend && pending > 0)
+      self->nvds_msgapi_do_work (self->connHandle);
+
+    if (sent == SEND_BURST_SIZE)
+      continue;
+
+    /* Queue is drained, exit if stopping otherwise wait for new messages.
+     * Producers check senderWaiting after queueing and the queue is checked
+     * after setting it, so no wakeup is lost. */
+    g_mutex_lock (&self->flowLock);
+    g_atomic_int_set (&self->senderWaiting, TRUE);
+    if (!gst_nvmsgbroker_queue_depth (self->queue)) {
+      if (!g_atomic_int_get (&self->isRunning)) {
+        g_atomic_int_set (&self->senderWaiting, FALSE);
+        g_mutex_unlock (&self->flowLock);
+        break;
+      }
+      wakeTime = G_MAXINT64;
+      if (self->asyncSend && self->pendingCbCount > 0)
+        wakeTime = g_get_monotonic_time () + DO_WORK_INTERVAL_US;
+      if (self->spool && gst_nvmsgbroker_spool_count (self->spool))
+        wakeTime = MIN (wakeTime, self->replayCredit ? 0 :
+            self->nextReplayTime);
+
+      if (wakeTime != G_MAXINT64)
+        g_cond_wait_until (&self->flowCond, &self->flowLock, wakeTime);
+      else
+        g_cond_wait (&self->flowCond, &self->flowLock);
+    }
+    g_atomic_int_set (&self->senderWaiting, FALSE);
+    g_mutex_unlock (&self->flowLock);
   }
+
+  if (self->asyncSend)
+    self->nvds_msgapi_do_work (self->connHandle);
+
   return self;
 }
 
@@ -120,6 +461,8 @@ gst_nvmsgbroker_class_init (GstNvMsgBrokerClass * klass)
   base_sink_class->start = GST_DEBUG_FUNCPTR (gst_nvmsgbroker_start);
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_nvmsgbroker_stop);
   base_sink_class->render = GST_DEBUG_FUNCPTR (gst_nvmsgbroker_render);
+  base_sink_class->unlock = GST_DEBUG_FUNCPTR (gst_nvmsgbroker_unlock);
+  base_sink_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_nvmsgbroker_unlock_stop);
 
   g_object_class_install_property (gobject_class, PROP_PROTOCOL_LIBRARY,
       g_param_spec_string ("proto-lib", "Protocol library name",
@@ -147,6 +490,103 @@ gst_nvmsgbroker_class_init (GstNvMsgBrokerClass * klass)
       "\t\t\thaving this component id",
       0, G_MAXUINT, 0,
       (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_SIZE,
+      g_param_spec_uint ("queue-size", "Queue size",
+      "Max number of messages queued for the sender thread\n"
+      "\t\t\tRounded up to a power of two",
+      1, G_MAXINT / 2, DEFAULT_QUEUE_SIZE,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_OVERFLOW_POLICY,
+      g_param_spec_enum ("overflow-policy", "Overflow policy",
+      "Action taken when the send queue is full",
+      GST_TYPE_NVMSGBROKER_OVERFLOW_POLICY, DEFAULT_OVERFLOW_POLICY,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_QUEUE_DEPTH,
+      g_param_spec_uint ("queue-depth", "Queue depth",
+      "Number of messages waiting in the send queue",
+      0, G_MAXUINT, 0,
+      (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SENT,
+      g_param_spec_uint64 ("sent", "Sent messages",
+      "Number of messages handed over to the protocol adaptor",
+      0, G_MAXUINT64, 0,
+      (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped messages",
+      "Number of messages dropped on queue overflow",
+      0, G_MAXUINT64, 0,
+      (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SEND_LATENCY_AVG,
+      g_param_spec_uint64 ("send-latency-avg", "Average send latency",
+      "Average time in microseconds from queueing a message until it is\n"
+      "\t\t\thanded over to the protocol adaptor",
+      0, G_MAXUINT64, 0,
+      (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SEND_LATENCY_MAX,
+      g_param_spec_uint64 ("send-latency-max", "Max send latency",
+      "Max time in microseconds from queueing a message until it is\n"
+      "\t\t\thanded over to the protocol adaptor",
+      0, G_MAXUINT64, 0,
+      (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOL_DIR,
+      g_param_spec_string ("spool-dir", "Spool directory",
+      "Directory to store messages which can't be sent, to replay them\n"
+      "\t\t\tonce the broker is available. Spool is disabled if not set",
+      NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOL_SEGMENT_SIZE,
+      g_param_spec_uint64 ("spool-segment-size", "Spool segment size",
+      "Size in bytes of a spool segment file",
+      MIN_SPOOL_SEGMENT_SIZE, G_MAXUINT32, DEFAULT_SPOOL_SEGMENT_SIZE,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOL_MAX_SIZE,
+      g_param_spec_uint64 ("spool-max-size", "Spool max size",
+      "Max size in bytes of the spool, oldest messages are deleted beyond it",
+      MIN_SPOOL_SEGMENT_SIZE, G_MAXUINT64, DEFAULT_SPOOL_MAX_SIZE,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOL_WATERMARK,
+      g_param_spec_uint ("spool-watermark", "Spool watermark",
+      "Queue depth from which new messages are spooled instead of queued\n"
+      "\t\t\t0 to spool only when the queue is full",
+      0, G_MAXUINT, DEFAULT_SPOOL_WATERMARK,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOL_REPLAY_RATE,
+      g_param_spec_uint ("spool-replay-rate", "Spool replay rate",
+      "Max number of spooled messages sent per second, 0 for no limit",
+      0, G_MAXUINT, DEFAULT_SPOOL_REPLAY_RATE,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOL_RETRY_INTERVAL,
+      g_param_spec_uint ("spool-retry-interval", "Spool retry interval",
+      "Interval in ms to retry sending a spooled message while the broker\n"
+      "\t\t\tis not available",
+      1, G_MAXUINT, DEFAULT_SPOOL_RETRY_INTERVAL,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_SPOOLED,
+      g_param_spec_uint64 ("spooled", "Spooled messages",
+      "Number of messages waiting in the spool",
+      0, G_MAXUINT64, 0,
+      (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -164,9 +604,37 @@ gst_nvmsgbroker_init (GstNvMsgBroker * self)
   self->asyncSend = TRUE;
   self->lastError = NVDS_MSGAPI_OK;
   self->compId = 0;
+  self->sendThread = NULL;
+  self->flushing = FALSE;
+  self->senderWaiting = FALSE;
+  self->producersWaiting = 0;
+  self->sendFailed = FALSE;
+  self->queue = NULL;
+  self->queueSize = DEFAULT_QUEUE_SIZE;
+  self->overflowPolicy = DEFAULT_OVERFLOW_POLICY;
+  self->sentCount = 0;
+  self->droppedCount = 0;
+  self->sendLatencySum = 0;
+  self->sendLatencyMax = 0;
+  self->spool = NULL;
+  self->spoolDir = NULL;
+  self->spoolSegmentSize = DEFAULT_SPOOL_SEGMENT_SIZE;
+  self->spoolMaxSize = DEFAULT_SPOOL_MAX_SIZE;
+  self->spoolWatermark = DEFAULT_SPOOL_WATERMARK;
+  self->spoolThreshold = 0;
+  self->spoolReplayRate = DEFAULT_SPOOL_REPLAY_RATE;
+  self->spoolRetryInterval = DEFAULT_SPOOL_RETRY_INTERVAL;
+  self->outage = FALSE;
+  self->nextReplayTime = 0;
+  self->replayCredit = 0;
 
   g_mutex_init (&self->flowLock);
   g_cond_init (&self->flowCond);
+  g_cond_init (&self->spaceCond);
+
+  /* Not to hold a reference to the last buffer, payloads of a buffer which
+   * is not referenced by anyone else can be sent without copy */
+  gst_base_sink_set_last_sample_enabled (GST_BASE_SINK (self), FALSE);
 }
 
 void
@@ -206,6 +674,32 @@ gst_nvmsgbroker_set_property (GObject * object, guint property_id,
     case PROP_COMPONENT_ID:
       self->compId = g_value_get_uint (value);
       break;
+    case PROP_QUEUE_SIZE:
+      self->queueSize = g_value_get_uint (value);
+      break;
+    case PROP_OVERFLOW_POLICY:
+      self->overflowPolicy = (GstNvMsgBrokerOverflowPolicy) g_value_get_enum (value);
+      break;
+    case PROP_SPOOL_DIR:
+      if (self->spoolDir)
+        g_free (self->spoolDir);
+      self->spoolDir = (gchar *) g_value_dup_string (value);
+      break;
+    case PROP_SPOOL_SEGMENT_SIZE:
+      self->spoolSegmentSize = g_value_get_uint64 (value);
+      break;
+    case PROP_SPOOL_MAX_SIZE:
+      self->spoolMaxSize = g_value_get_uint64 (value);
+      break;
+    case PROP_SPOOL_WATERMARK:
+      self->spoolWatermark = g_value_get_uint (value);
+      break;
+    case PROP_SPOOL_REPLAY_RATE:
+      self->spoolReplayRate = g_value_get_uint (value);
+      break;
+    case PROP_SPOOL_RETRY_INTERVAL:
+      self->spoolRetryInterval = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -236,6 +730,61 @@ gst_nvmsgbroker_get_property (GObject * object, guint property_id,
     case PROP_COMPONENT_ID:
       g_value_set_uint (value, self->compId);
       break;
+    case PROP_QUEUE_SIZE:
+      g_value_set_uint (value, self->queueSize);
+      break;
+    case PROP_OVERFLOW_POLICY:
+      g_value_set_enum (value, self->overflowPolicy);
+      break;
+    case PROP_QUEUE_DEPTH:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->queue ? gst_nvmsgbroker_queue_depth (self->queue) : 0);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_SENT:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->sentCount);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_DROPPED:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->droppedCount);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_SEND_LATENCY_AVG:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->sentCount ?
+          self->sendLatencySum / self->sentCount : 0);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_SEND_LATENCY_MAX:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->sendLatencyMax);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_SPOOL_DIR:
+      g_value_set_string (value, self->spoolDir);
+      break;
+    case PROP_SPOOL_SEGMENT_SIZE:
+      g_value_set_uint64 (value, self->spoolSegmentSize);
+      break;
+    case PROP_SPOOL_MAX_SIZE:
+      g_value_set_uint64 (value, self->spoolMaxSize);
+      break;
+    case PROP_SPOOL_WATERMARK:
+      g_value_set_uint (value, self->spoolWatermark);
+      break;
+    case PROP_SPOOL_REPLAY_RATE:
+      g_value_set_uint (value, self->spoolReplayRate);
+      break;
+    case PROP_SPOOL_RETRY_INTERVAL:
+      g_value_set_uint (value, self->spoolRetryInterval);
+      break;
+    case PROP_SPOOLED:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->spool ? gst_nvmsgbroker_spool_count (self->spool) : 0);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -261,8 +810,12 @@ gst_nvmsgbroker_finalize (GObject * object)
   if (self->protoLib)
     g_free (self->protoLib);
 
+  if (self->spoolDir)
+    g_free (self->spoolDir);
+
   g_mutex_clear(&self->flowLock);
   g_cond_clear(&self->flowCond);
+  g_cond_clear(&self->spaceCond);
 
   G_OBJECT_CLASS (gst_nvmsgbroker_parent_class)->finalize (object);
 }
@@ -320,6 +873,20 @@ gst_nvmsgbroker_start (GstBaseSink * sink)
     return FALSE;
   }
 
+  /* Optional interfaces to send the message with key provided by msgconv */
+  self->nvds_msgapi_send_with_key = NULL;
+  self->nvds_msgapi_send_async_with_key = NULL;
+  self->nvds_msgapi_send_async_nocopy = NULL;
+  if (self->asyncSend) {
+    self->nvds_msgapi_send_async_with_key = (nvds_msgapi_send_async_with_key_ptr)
+        dlsym (self->libHandle, "nvds_msgapi_send_async_with_key");
+    self->nvds_msgapi_send_async_nocopy = (nvds_msgapi_send_async_nocopy_ptr)
+        dlsym (self->libHandle, "nvds_msgapi_send_async_nocopy");
+  } else
+    self->nvds_msgapi_send_with_key = (nvds_msgapi_send_with_key_ptr)
+        dlsym (self->libHandle, "nvds_msgapi_send_with_key");
+  dlerror ();
+
   self->connHandle = self->nvds_msgapi_connect (self->connStr,
                                (nvds_msgapi_connect_cb_t) nvds_msgapi_connect_callback,
                                self->configFile);
@@ -333,11 +900,43 @@ gst_nvmsgbroker_start (GstBaseSink * sink)
     return FALSE;
   }
 
-  self->isRunning = TRUE;
-  if (self->asyncSend) {
-    self->doWorkThread = g_thread_new ("doWork_thread",
-                                       gst_nvmsgbroker_do_work, (gpointer) self);
+  if (self->spoolDir) {
+    GstNvMsgBrokerSpool *spool = gst_nvmsgbroker_spool_open (self->spoolDir,
+        self->spoolSegmentSize, self->spoolMaxSize);
+    if (!spool) {
+      self->nvds_msgapi_disconnect (self->connHandle);
+      self->connHandle = NULL;
+      dlclose (self->libHandle);
+      self->libHandle = NULL;
+      GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE, (NULL),
+                         ("unable to open spool directory %s", self->spoolDir));
+      return FALSE;
+    }
+    GST_INFO_OBJECT (self, "%" G_GUINT64_FORMAT " messages in spool",
+        gst_nvmsgbroker_spool_count (spool));
+    GST_OBJECT_LOCK (self);
+    self->spool = spool;
+    GST_OBJECT_UNLOCK (self);
   }
+  self->outage = FALSE;
+  self->nextReplayTime = 0;
+  self->replayCredit = 0;
+
+  GST_OBJECT_LOCK (self);
+  self->queue = gst_nvmsgbroker_queue_new (self->queueSize);
+  self->spoolThreshold = gst_nvmsgbroker_queue_capacity (self->queue);
+  if (self->spoolWatermark && self->spoolWatermark < self->spoolThreshold)
+    self->spoolThreshold = self->spoolWatermark;
+  self->sentCount = 0;
+  self->droppedCount = 0;
+  self->sendLatencySum = 0;
+  self->sendLatencyMax = 0;
+  GST_OBJECT_UNLOCK (self);
+
+  self->sendFailed = FALSE;
+  self->isRunning = TRUE;
+  self->sendThread = g_thread_new ("nvmsgbroker_send",
+                                   gst_nvmsgbroker_send_thread, (gpointer) self);
 
   return TRUE;
 }
@@ -350,13 +949,23 @@ gst_nvmsgbroker_stop (GstBaseSink * sink)
 
   GST_DEBUG_OBJECT (self, "stop");
 
-  self->isRunning = FALSE;
+  /* sender thread exits once queued messages are sent */
+  g_mutex_lock (&self->flowLock);
+  g_atomic_int_set (&self->isRunning, FALSE);
+  g_cond_signal (&self->flowCond);
+  g_mutex_unlock (&self->flowLock);
 
-  if (self->asyncSend) {
-    g_cond_signal (&self->flowCond);
-    g_thread_join (self->doWorkThread);
+  if (self->sendThread) {
+    g_thread_join (self->sendThread);
+    self->sendThread = NULL;
   }
 
+  GST_OBJECT_LOCK (self);
+  gst_nvmsgbroker_queue_free (self->queue);
+  self->queue = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  /* messages failed at disconnect are spooled from the send callback */
   if (self->nvds_msgapi_disconnect) {
     err = self->nvds_msgapi_disconnect (self->connHandle);
     if (err != NVDS_MSGAPI_OK)
@@ -364,6 +973,12 @@ gst_nvmsgbroker_stop (GstBaseSink * sink)
     self->connHandle = NULL;
   }
 
+  /* messages left in the spool are sent by the next session */
+  GST_OBJECT_LOCK (self);
+  gst_nvmsgbroker_spool_close (self->spool);
+  self->spool = NULL;
+  GST_OBJECT_UNLOCK (self);
+
   if (self->libHandle) {
     dlclose (self->libHandle);
     self->libHandle = NULL;
@@ -371,6 +986,139 @@ gst_nvmsgbroker_stop (GstBaseSink * sink)
   return TRUE;
 }
 
+/**
+ * Returns the extra information msgconv attached for @payload to the frame,
+ * NULL if none.
+ */
+static NvDsPayloadExt *
+gst_nvmsgbroker_payload_ext (NvDsFrameMeta * frame_meta, NvDsPayload * payload)
+{
+  NvDsMetaList *l;
+  NvDsUserMeta *user_meta;
+  NvDsPayloadExt *payloadExt;
+
+  for (l = frame_meta->frame_user_meta_list; l; l = l->next) {
+    user_meta = (NvDsUserMeta *) (l->data);
+    if (!user_meta || user_meta->base_meta.meta_type != NVDS_PAYLOAD_EXT_META)
+      continue;
+
+    payloadExt = (NvDsPayloadExt *) user_meta->user_meta_data;
+    if (payloadExt && payloadExt->size >= sizeof (NvDsPayloadExt) &&
+        payloadExt->payload == payload)
+      return payloadExt;
+  }
+  return NULL;
+}
+
+/**
+ * Fills @msg with payload data to be owned by the sender. Data is taken from
+ * the payload meta if it's transferable and no one else can access the
+ * buffer, otherwise it's copied. Key is always copied.
+ */
+static void
+gst_nvmsgbroker_take_payload (GstBuffer * buf, NvDsPayload * payload,
+    NvDsPayloadExt * payloadExt, GstNvMsgBrokerMsg * msg)
+{
+  msg->size = payload->payloadSize;
+  msg->key = payloadExt ? g_strdup (payloadExt->key) : NULL;
+
+  if (!payloadExt || !(payloadExt->flags & NVDS_PAYLOAD_FLAG_TRANSFERABLE) ||
+      !gst_buffer_is_writable (buf)) {
+    msg->data = g_memdup (payload->payload, payload->payloadSize);
+    return;
+  }
+
+  msg->data = payload->payload;
+  payload->payload = NULL;
+}
+
+/**
+ * Queues the message for the sender thread according to overflow policy, or
+ * spools it if the queue depth reached the spool watermark.
+ */
+static GstFlowReturn
+gst_nvmsgbroker_queue_msg (GstNvMsgBroker * self, GstNvMsgBrokerMsg * msg)
+{
+  GstNvMsgBrokerMsg dropped;
+  gboolean flushing;
+
+  /* spool instead of waiting or dropping when the queue fills up */
+  if (self->spool) {
+    if (gst_nvmsgbroker_queue_depth (self->queue) >= self->spoolThreshold ||
+        !gst_nvmsgbroker_queue_push (self->queue, msg))
+      gst_nvmsgbroker_spool_msg (self, msg);
+    goto wakeup;
+  }
+
+  while (!gst_nvmsgbroker_queue_push (self->queue, msg)) {
+    if (self->overflowPolicy == GST_NVMSGBROKER_OVERFLOW_DROP_NEWEST) {
+      gst_nvmsgbroker_msg_clear (msg);
+      GST_OBJECT_LOCK (self);
+      self->droppedCount++;
+      GST_OBJECT_UNLOCK (self);
+      return GST_FLOW_OK;
+    }
+
+    if (self->overflowPolicy == GST_NVMSGBROKER_OVERFLOW_DROP_OLDEST) {
+      if (gst_nvmsgbroker_queue_pop (self->queue, &dropped)) {
+        gst_nvmsgbroker_msg_clear (&dropped);
+        GST_OBJECT_LOCK (self);
+        self->droppedCount++;
+        GST_OBJECT_UNLOCK (self);
+      }
+      continue;
+    }
+
+    /* Block until the sender takes messages out. Sender checks
+     * producersWaiting after taking them and the queue is checked after
+     * setting it, so no wakeup is lost. */
+    g_mutex_lock (&self->flowLock);
+    g_atomic_int_inc (&self->producersWaiting);
+    while (!self->flushing && gst_nvmsgbroker_queue_depth (self->queue) >=
+        gst_nvmsgbroker_queue_capacity (self->queue))
+      g_cond_wait (&self->spaceCond, &self->flowLock);
+    g_atomic_int_add (&self->producersWaiting, -1);
+    flushing = self->flushing;
+    g_mutex_unlock (&self->flowLock);
+
+    if (flushing) {
+      gst_nvmsgbroker_msg_clear (msg);
+      return GST_FLOW_FLUSHING;
+    }
+  }
+
+wakeup:
+  if (g_atomic_int_get (&self->senderWaiting)) {
+    g_mutex_lock (&self->flowLock);
+    g_cond_signal (&self->flowCond);
+    g_mutex_unlock (&self->flowLock);
+  }
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_nvmsgbroker_unlock (GstBaseSink * sink)
+{
+  GstNvMsgBroker *self = GST_NVMSGBROKER (sink);
+
+  g_mutex_lock (&self->flowLock);
+  self->flushing = TRUE;
+  g_cond_broadcast (&self->spaceCond);
+  g_mutex_unlock (&self->flowLock);
+  return TRUE;
+}
+
+static gboolean
+gst_nvmsgbroker_unlock_stop (GstBaseSink * sink)
+{
+  GstNvMsgBroker *self = GST_NVMSGBROKER (sink);
+
+  g_mutex_lock (&self->flowLock);
+  self->flushing = FALSE;
+  g_mutex_unlock (&self->flowLock);
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_nvmsgbroker_render (GstBaseSink * sink, GstBuffer * buf)
 {
@@ -379,11 +1127,17 @@ gst_nvmsgbroker_render (GstBaseSink * sink, GstBuffer * buf)
   NvDsBatchMeta *batch_meta = NULL;
   GstMeta *gstMeta = NULL;
   gpointer state = NULL;
-  NvDsMsgApiErrorType err;
   NvDsPayload *payload;
+  GstNvMsgBrokerMsg msg;
+  GstFlowReturn ret;
+  gint64 now = g_get_monotonic_time ();
 
   GST_DEBUG_OBJECT (self, "render");
 
+  /* error is posted by the sender thread */
+  if (g_atomic_int_get (&self->sendFailed))
+    return GST_FLOW_ERROR;
+
 #if 0
   g_mutex_lock (&self->flowLock);
   if (self->lastError != NVDS_MSGAPI_OK) {
@@ -426,35 +1180,12 @@ gst_nvmsgbroker_render (GstBaseSink * sink, GstBuffer * buf)
           if (self->compId && payload->componentId != self->compId)
             continue;
 
-          if (self->asyncSend) {
-            g_mutex_lock (&self->flowLock);
-            err = self->nvds_msgapi_send_async (self->connHandle, self->topic,
-                                                (uint8_t *) payload->payload,
-                                                payload->payloadSize,
-                                                nvds_msgapi_send_callback, self);
-
-            if (err != NVDS_MSGAPI_OK) {
-              GST_ELEMENT_ERROR (self, LIBRARY, FAILED, (NULL),
-                                 ("failed to send the message. err(%d)", err));
-
-              g_mutex_unlock (&self->flowLock);
-              return GST_FLOW_ERROR;
-            }
-            self->pendingCbCount++;
-            g_cond_signal (&self->flowCond);
-            g_mutex_unlock (&self->flowLock);
-          } else {
-            err = self->nvds_msgapi_send (self->connHandle, self->topic,
-                                          (uint8_t *) payload->payload,
-                                          payload->payloadSize);
-
-            if (err != NVDS_MSGAPI_OK) {
-              GST_ELEMENT_ERROR (self, LIBRARY, FAILED, (NULL),
-                                 ("failed to send the message. err(%d)", err));
-
-              return GST_FLOW_ERROR;
-            }
-          }
+          gst_nvmsgbroker_take_payload (buf, payload,
+              gst_nvmsgbroker_payload_ext (frame_meta, payload), &msg);
+          msg.enqueueTime = now;
+          ret = gst_nvmsgbroker_queue_msg (self, &msg);
+          if (ret != GST_FLOW_OK)
+            return ret;
         }
       }
     }
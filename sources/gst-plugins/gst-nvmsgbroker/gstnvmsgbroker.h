@@ -14,6 +14,8 @@
 
 #include <gst/base/gstbasesink.h>
 #include "nvds_msgapi.h"
+#include "gstnvmsgbroker_queue.h"
+#include "gstnvmsgbroker_spool.h"
 
 G_BEGIN_DECLS
 
@@ -23,6 +25,19 @@ G_BEGIN_DECLS
 #define GST_IS_NVMSGBROKER(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NVMSGBROKER))
 #define GST_IS_NVMSGBROKER_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_NVMSGBROKER))
 
+/**
+ * Action taken by the streaming thread when the send queue is full.
+ */
+typedef enum
+{
+  /** Wait for the sender thread to make room */
+  GST_NVMSGBROKER_OVERFLOW_BLOCK,
+  /** Drop the oldest queued message */
+  GST_NVMSGBROKER_OVERFLOW_DROP_OLDEST,
+  /** Drop the message being queued */
+  GST_NVMSGBROKER_OVERFLOW_DROP_NEWEST
+} GstNvMsgBrokerOverflowPolicy;
+
 typedef struct _GstNvMsgBroker GstNvMsgBroker;
 typedef struct _GstNvMsgBrokerClass GstNvMsgBrokerClass;
 
@@ -36,6 +51,17 @@ typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_ptr)(NvDsMsgApiHandle h_ptr
     char *topic, const uint8_t *payload, size_t nbuf,
     nvds_msgapi_send_cb_t send_callback, void *user_ptr);
 
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_with_key_ptr)(NvDsMsgApiHandle conn,
+    char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen);
+
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_with_key_ptr)(NvDsMsgApiHandle h_ptr,
+    char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen,
+    nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_nocopy_ptr)(NvDsMsgApiHandle h_ptr,
+    char *topic, uint8_t *payload, size_t nbuf, const char *key, size_t keylen,
+    void (*payload_free)(void *), nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+
 typedef void (*nvds_msgapi_do_work_ptr) (NvDsMsgApiHandle h_ptr);
 
 typedef NvDsMsgApiErrorType (*nvds_msgapi_disconnect_ptr)(NvDsMsgApiHandle conn);
@@ -51,10 +77,40 @@ struct _GstNvMsgBroker
   gchar *connStr;
   gchar *topic;
   guint compId;
+  /** Protects pendingCbCount, wakes up the sender thread (flowCond) and
+   * producers blocked on a full queue (spaceCond) */
   GMutex flowLock;
   GCond flowCond;
-  GThread *doWorkThread;
+  GCond spaceCond;
+  GThread *sendThread;
   gboolean isRunning;
+  gboolean flushing;
+  gint senderWaiting;
+  gint producersWaiting;
+  gint sendFailed;
+  GstNvMsgBrokerQueue *queue;
+  guint queueSize;
+  GstNvMsgBrokerOverflowPolicy overflowPolicy;
+  /** Disk spool for messages which couldn't be sent, NULL if disabled */
+  GstNvMsgBrokerSpool *spool;
+  gchar *spoolDir;
+  guint64 spoolSegmentSize;
+  guint64 spoolMaxSize;
+  guint spoolWatermark;
+  guint spoolThreshold;
+  guint spoolReplayRate;
+  guint spoolRetryInterval;
+  /** Set while the adaptor rejects messages, they're spooled meanwhile */
+  gint outage;
+  gint64 nextReplayTime;
+  /** Spooled messages to replay beyond the replay rate, one per new message
+   * spooled to keep ordering */
+  guint64 replayCredit;
+  /** Statistics, protected by the object lock */
+  guint64 sentCount;
+  guint64 droppedCount;
+  guint64 sendLatencySum;
+  guint64 sendLatencyMax;
   gboolean asyncSend;
   gint pendingCbCount;
   NvDsMsgApiHandle connHandle;
@@ -62,6 +118,9 @@ struct _GstNvMsgBroker
   nvds_msgapi_connect_ptr nvds_msgapi_connect;
   nvds_msgapi_send_ptr nvds_msgapi_send;
   nvds_msgapi_send_async_ptr nvds_msgapi_send_async;
+  nvds_msgapi_send_with_key_ptr nvds_msgapi_send_with_key;
+  nvds_msgapi_send_async_with_key_ptr nvds_msgapi_send_async_with_key;
+  nvds_msgapi_send_async_nocopy_ptr nvds_msgapi_send_async_nocopy;
   nvds_msgapi_do_work_ptr nvds_msgapi_do_work;
   nvds_msgapi_disconnect_ptr nvds_msgapi_disconnect;
 };
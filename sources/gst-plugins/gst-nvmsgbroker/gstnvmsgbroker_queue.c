@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "gstnvmsgbroker_queue.h"
+
+#define CACHE_LINE_SIZE 64
+
+typedef struct
+{
+  /* position the slot is free for (seq == pos) or ready at (seq == pos + 1) */
+  gint seq;
+  GstNvMsgBrokerMsg msg;
+} GstNvMsgBrokerSlot;
+
+struct _GstNvMsgBrokerQueue
+{
+  GstNvMsgBrokerSlot *slots;
+  guint mask;
+  /* keep producer and consumer positions on separate cache lines */
+  gchar pad0[CACHE_LINE_SIZE];
+  gint enqueuePos;
+  gchar pad1[CACHE_LINE_SIZE];
+  gint dequeuePos;
+  gchar pad2[CACHE_LINE_SIZE];
+};
+
+GstNvMsgBrokerQueue *
+gst_nvmsgbroker_queue_new (guint size)
+{
+  GstNvMsgBrokerQueue *queue = g_new0 (GstNvMsgBrokerQueue, 1);
+  guint capacity = 2;
+  guint i;
+
+  while (capacity < size)
+    capacity <<= 1;
+
+  queue->slots = g_new0 (GstNvMsgBrokerSlot, capacity);
+  queue->mask = capacity - 1;
+  for (i = 0; i < capacity; i++)
+    queue->slots[i].seq = (gint) i;
+
+  return queue;
+}
+
+void
+gst_nvmsgbroker_queue_free (GstNvMsgBrokerQueue * queue)
+{
+  GstNvMsgBrokerMsg msg;
+
+  if (!queue)
+    return;
+
+  while (gst_nvmsgbroker_queue_pop (queue, &msg))
+    gst_nvmsgbroker_msg_clear (&msg);
+
+  g_free (queue->slots);
+  g_free (queue);
+}
+
+gboolean
+gst_nvmsgbroker_queue_push (GstNvMsgBrokerQueue * queue,
+    const GstNvMsgBrokerMsg * msg)
+{
+  GstNvMsgBrokerSlot *slot;
+  guint pos = (guint) g_atomic_int_get (&queue->enqueuePos);
+  gint diff;
+
+  while (TRUE) {
+    slot = &queue->slots[pos & queue->mask];
+    diff = (gint) ((guint) g_atomic_int_get (&slot->seq) - pos);
+
+    if (diff == 0) {
+      if (g_atomic_int_compare_and_exchange (&queue->enqueuePos, (gint) pos,
+              (gint) (pos + 1)))
+        break;
+    } else if (diff < 0) {
+      /* slot still holds the message queued one lap earlier */
+      return FALSE;
+    }
+    pos = (guint) g_atomic_int_get (&queue->enqueuePos);
+  }
+
+  slot->msg = *msg;
+  g_atomic_int_set (&slot->seq, (gint) (pos + 1));
+  return TRUE;
+}
+
+gboolean
+gst_nvmsgbroker_queue_pop (GstNvMsgBrokerQueue * queue,
+    GstNvMsgBrokerMsg * msg)
+{
+  GstNvMsgBrokerSlot *slot;
+  guint pos = (guint) g_atomic_int_get (&queue->dequeuePos);
+  gint diff;
+
+  while (TRUE) {
+    slot = &queue->slots[pos & queue->mask];
+    diff = (gint) ((guint) g_atomic_int_get (&slot->seq) - (pos + 1));
+
+    if (diff == 0) {
+      if (g_atomic_int_compare_and_exchange (&queue->dequeuePos, (gint) pos,
+              (gint) (pos + 1)))
+        break;
+    } else if (diff < 0) {
+      /* slot not written yet */
+      return FALSE;
+    }
+    pos = (guint) g_atomic_int_get (&queue->dequeuePos);
+  }
+
+  *msg = slot->msg;
+  g_atomic_int_set (&slot->seq, (gint) (pos + queue->mask + 1));
+  return TRUE;
+}
+
+guint
+gst_nvmsgbroker_queue_depth (GstNvMsgBrokerQueue * queue)
+{
+  guint dequeuePos = (guint) g_atomic_int_get (&queue->dequeuePos);
+  guint enqueuePos = (guint) g_atomic_int_get (&queue->enqueuePos);
+  gint depth = (gint) (enqueuePos - dequeuePos);
+
+  if (depth < 0)
+    return 0;
+  return MIN ((guint) depth, queue->mask + 1);
+}
+
+guint
+gst_nvmsgbroker_queue_capacity (GstNvMsgBrokerQueue * queue)
+{
+  return queue->mask + 1;
+}
+
+void
+gst_nvmsgbroker_msg_clear (GstNvMsgBrokerMsg * msg)
+{
+  g_free (msg->data);
+  g_free (msg->key);
+  msg->data = NULL;
+  msg->key = NULL;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef _GST_NVMSGBROKER_QUEUE_H_
+#define _GST_NVMSGBROKER_QUEUE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Bounded lock-free queue of messages between the streaming thread and the
+ * sender thread of nvmsgbroker.
+ *
+ * Every slot carries a sequence number telling whether it is free for the
+ * producer or ready for the consumer of a position, so that push and pop
+ * only need one compare-and-swap on the position. Any thread may push, and
+ * pop is safe from any thread as well, which lets a producer evict the
+ * oldest message when the queue is full.
+ */
+
+/**
+ * Holds a message queued for sending. Payload data and key are owned by the
+ * message and allocated with g_malloc.
+ */
+typedef struct
+{
+  gpointer data;
+  gsize size;
+  gchar *key;
+  /** Monotonic time (us) the message was queued at */
+  gint64 enqueueTime;
+} GstNvMsgBrokerMsg;
+
+typedef struct _GstNvMsgBrokerQueue GstNvMsgBrokerQueue;
+
+/**
+ * Creates a queue holding at least @size messages. Capacity is rounded up to
+ * a power of two.
+ */
+GstNvMsgBrokerQueue *gst_nvmsgbroker_queue_new (guint size);
+
+/**
+ * Frees the queue along with the messages still queued.
+ */
+void gst_nvmsgbroker_queue_free (GstNvMsgBrokerQueue * queue);
+
+/**
+ * Queues a copy of @msg. The queue owns the message data on success.
+ *
+ * @return FALSE if the queue is full.
+ */
+gboolean gst_nvmsgbroker_queue_push (GstNvMsgBrokerQueue * queue,
+    const GstNvMsgBrokerMsg * msg);
+
+/**
+ * Takes the oldest message out of the queue. Caller owns the message data
+ * on success.
+ *
+ * @return FALSE if the queue is empty.
+ */
+gboolean gst_nvmsgbroker_queue_pop (GstNvMsgBrokerQueue * queue,
+    GstNvMsgBrokerMsg * msg);
+
+/**
+ * Returns the number of queued messages. The value is a snapshot which may
+ * be outdated by concurrent pushes and pops.
+ */
+guint gst_nvmsgbroker_queue_depth (GstNvMsgBrokerQueue * queue);
+
+guint gst_nvmsgbroker_queue_capacity (GstNvMsgBrokerQueue * queue);
+
+/**
+ * Frees data and key of the message.
+ */
+void gst_nvmsgbroker_msg_clear (GstNvMsgBrokerMsg * msg);
+
+G_END_DECLS
+
+#endif
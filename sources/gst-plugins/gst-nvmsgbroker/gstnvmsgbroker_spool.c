@@ -0,0 +1,566 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "gstnvmsgbroker_spool.h"
+
+#define SPOOL_MAGIC "NVMSGSPL"
+#define SPOOL_VERSION 1
+#define SPOOL_RECORD_MAGIC 0x4452434e   /* "NCRD" */
+#define SPOOL_HEADER_SIZE 64
+#define SPOOL_ALIGN 8
+#define SPOOL_SEGMENT_SUFFIX ".seg"
+
+#define SPOOL_ALIGN_UP(x) (((x) + SPOOL_ALIGN - 1) & ~((guint64) SPOOL_ALIGN - 1))
+
+/* Segment file header, followed by records from SPOOL_HEADER_SIZE */
+typedef struct
+{
+  gchar magic[8];
+  guint32 version;
+  guint32 reserved;
+  guint64 size;
+  /* offset of the oldest record not read yet */
+  guint64 readOffset;
+} SpoolSegmentHeader;
+
+/* Record header, followed by key and data. Magic is written last to commit
+ * the record. */
+typedef struct
+{
+  gint magic;
+  guint32 crc;
+  guint32 keyLen;
+  guint32 dataLen;
+} SpoolRecordHeader;
+
+typedef struct _SpoolSegment
+{
+  guint64 seq;
+  gchar *path;
+  guint8 *map;
+  guint64 size;
+  guint64 writeOffset;
+  /* number of records not read yet */
+  guint64 count;
+  struct _SpoolSegment *next;
+} SpoolSegment;
+
+struct _GstNvMsgBrokerSpool
+{
+  GMutex lock;
+  gchar *dir;
+  guint64 segmentSize;
+  guint maxSegments;
+  guint numSegments;
+  guint64 nextSeq;
+  /* segments oldest first, messages are read from head */
+  SpoolSegment *head;
+  SpoolSegment *tail;
+  /* segment being written, always the tail */
+  SpoolSegment *writeSeg;
+  /* empty segment to be written next, created ahead by spool_prepare so
+   * that writers don't create files */
+  SpoolSegment *spareSeg;
+  gboolean preparing;
+  guint64 count;
+  guint64 dropped;
+};
+
+static guint32 crc_table[256];
+static gsize crc_table_init = 0;
+
+static void
+spool_crc_init (void)
+{
+  guint32 i, j, c;
+
+  if (g_once_init_enter (&crc_table_init)) {
+    for (i = 0; i < 256; i++) {
+      c = i;
+      for (j = 0; j < 8; j++)
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      crc_table[i] = c;
+    }
+    g_once_init_leave (&crc_table_init, 1);
+  }
+}
+
+static guint32
+spool_crc (guint32 crc, const guint8 * buf, gsize len)
+{
+  gsize i;
+
+  crc = ~crc;
+  for (i = 0; i < len; i++)
+    crc = crc_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static guint32
+spool_record_crc (const SpoolRecordHeader * rh)
+{
+  guint32 crc;
+
+  crc = spool_crc (0, (const guint8 *) &rh->keyLen,
+      sizeof (rh->keyLen) + sizeof (rh->dataLen));
+  return spool_crc (crc, (const guint8 *) (rh + 1),
+      (gsize) rh->keyLen + rh->dataLen);
+}
+
+static SpoolSegmentHeader *
+spool_segment_header (SpoolSegment * seg)
+{
+  return (SpoolSegmentHeader *) seg->map;
+}
+
+static void
+spool_segment_free (SpoolSegment * seg, gboolean remove)
+{
+  if (seg->map) {
+    if (!remove)
+      msync (seg->map, seg->size, MS_SYNC);
+    munmap (seg->map, seg->size);
+  }
+  if (remove)
+    unlink (seg->path);
+  g_free (seg->path);
+  g_free (seg);
+}
+
+static void
+spool_append_segment (GstNvMsgBrokerSpool * spool, SpoolSegment * seg)
+{
+  if (spool->tail)
+    spool->tail->next = seg;
+  else
+    spool->head = seg;
+  spool->tail = seg;
+  spool->numSegments++;
+}
+
+/* Removes the head segment along with its unread records */
+static void
+spool_remove_head (GstNvMsgBrokerSpool * spool)
+{
+  SpoolSegment *seg = spool->head;
+
+  spool->head = seg->next;
+  if (!spool->head)
+    spool->tail = NULL;
+  if (seg == spool->writeSeg)
+    spool->writeSeg = NULL;
+  spool->numSegments--;
+  spool->count -= seg->count;
+  spool->dropped += seg->count;
+  spool_segment_free (seg, TRUE);
+}
+
+static SpoolSegment *
+spool_segment_create (const gchar * dir, guint64 seq, guint64 size)
+{
+  SpoolSegment *seg;
+  SpoolSegmentHeader *hdr;
+  gchar *path;
+  int fd;
+
+  path = g_strdup_printf ("%s/%020" G_GUINT64_FORMAT SPOOL_SEGMENT_SUFFIX,
+      dir, seq);
+  fd = open (path, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    g_warning ("nvmsgbroker spool: unable to create %s: %s", path,
+        strerror (errno));
+    g_free (path);
+    return NULL;
+  }
+
+  seg = g_new0 (SpoolSegment, 1);
+  seg->seq = seq;
+  seg->path = path;
+  seg->size = size;
+  seg->writeOffset = SPOOL_HEADER_SIZE;
+
+  if (ftruncate (fd, seg->size) < 0 ||
+      (seg->map = (guint8 *) mmap (NULL, seg->size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    g_warning ("nvmsgbroker spool: unable to map %s: %s", path,
+        strerror (errno));
+    close (fd);
+    seg->map = NULL;
+    spool_segment_free (seg, TRUE);
+    return NULL;
+  }
+  close (fd);
+
+  hdr = spool_segment_header (seg);
+  memcpy (hdr->magic, SPOOL_MAGIC, sizeof (hdr->magic));
+  hdr->version = SPOOL_VERSION;
+  hdr->size = seg->size;
+  hdr->readOffset = SPOOL_HEADER_SIZE;
+  msync (seg->map, SPOOL_HEADER_SIZE, MS_SYNC);
+  return seg;
+}
+
+/**
+ * Maps a segment of an earlier session and finds its valid records. Records
+ * are scanned until the first one not committed or not matching its checksum.
+ */
+static SpoolSegment *
+spool_segment_recover (GstNvMsgBrokerSpool * spool, guint64 seq)
+{
+  SpoolSegment *seg;
+  SpoolSegmentHeader *hdr;
+  SpoolRecordHeader *rh;
+  struct stat st;
+  guint64 offset, len;
+  int fd;
+
+  seg = g_new0 (SpoolSegment, 1);
+  seg->seq = seq;
+  seg->path = g_strdup_printf ("%s/%020" G_GUINT64_FORMAT SPOOL_SEGMENT_SUFFIX,
+      spool->dir, seq);
+
+  fd = open (seg->path, O_RDWR);
+  if (fd < 0 || fstat (fd, &st) < 0 || st.st_size < SPOOL_HEADER_SIZE) {
+    g_warning ("nvmsgbroker spool: ignoring invalid segment %s", seg->path);
+    if (fd >= 0)
+      close (fd);
+    spool_segment_free (seg, FALSE);
+    return NULL;
+  }
+  seg->size = st.st_size;
+  seg->map = (guint8 *) mmap (NULL, seg->size, PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+  close (fd);
+  if (seg->map == MAP_FAILED) {
+    g_warning ("nvmsgbroker spool: unable to map %s: %s", seg->path,
+        strerror (errno));
+    seg->map = NULL;
+    spool_segment_free (seg, FALSE);
+    return NULL;
+  }
+
+  hdr = spool_segment_header (seg);
+  if (memcmp (hdr->magic, SPOOL_MAGIC, sizeof (hdr->magic)) ||
+      hdr->version != SPOOL_VERSION || hdr->size != seg->size) {
+    g_warning ("nvmsgbroker spool: ignoring invalid segment %s", seg->path);
+    spool_segment_free (seg, FALSE);
+    return NULL;
+  }
+
+  offset = SPOOL_HEADER_SIZE;
+  while (offset + sizeof (SpoolRecordHeader) <= seg->size) {
+    rh = (SpoolRecordHeader *) (seg->map + offset);
+    if (rh->magic != SPOOL_RECORD_MAGIC)
+      break;
+    len = SPOOL_ALIGN_UP (sizeof (SpoolRecordHeader) + (guint64) rh->keyLen +
+        rh->dataLen);
+    if (offset + len > seg->size || spool_record_crc (rh) != rh->crc)
+      break;
+    if (offset >= hdr->readOffset)
+      seg->count++;
+    offset += len;
+  }
+  seg->writeOffset = offset;
+
+  if (hdr->readOffset < SPOOL_HEADER_SIZE || hdr->readOffset > offset)
+    hdr->readOffset = offset;
+
+  return seg;
+}
+
+static int
+spool_compare_seq (const void *a, const void *b)
+{
+  guint64 sa = *(const guint64 *) a, sb = *(const guint64 *) b;
+
+  return sa < sb ? -1 : sa > sb;
+}
+
+static void
+spool_recover (GstNvMsgBrokerSpool * spool, DIR * dir)
+{
+  struct dirent *entry;
+  guint64 *seqs = NULL;
+  guint numSeqs = 0, allocSeqs = 0, i;
+  SpoolSegment *seg;
+  guint64 seq;
+  gchar suffix[8];
+
+  while ((entry = readdir (dir))) {
+    if (sscanf (entry->d_name, "%20" G_GUINT64_FORMAT "%7s", &seq, suffix) != 2 ||
+        strcmp (suffix, SPOOL_SEGMENT_SUFFIX))
+      continue;
+    if (numSeqs == allocSeqs) {
+      allocSeqs = allocSeqs ? allocSeqs * 2 : 16;
+      seqs = (guint64 *) g_realloc (seqs, allocSeqs * sizeof (guint64));
+    }
+    seqs[numSeqs++] = seq;
+  }
+  qsort (seqs, numSeqs, sizeof (guint64), spool_compare_seq);
+
+  for (i = 0; i < numSeqs; i++) {
+    spool->nextSeq = seqs[i] + 1;
+    seg = spool_segment_recover (spool, seqs[i]);
+    if (!seg)
+      continue;
+    if (!seg->count) {
+      spool_segment_free (seg, TRUE);
+      continue;
+    }
+    spool_append_segment (spool, seg);
+    spool->count += seg->count;
+  }
+  g_free (seqs);
+
+  while (spool->numSegments > spool->maxSegments)
+    spool_remove_head (spool);
+}
+
+GstNvMsgBrokerSpool *
+gst_nvmsgbroker_spool_open (const gchar * dirPath, guint64 segmentSize,
+    guint64 maxSize)
+{
+  GstNvMsgBrokerSpool *spool;
+  DIR *dir;
+
+  spool_crc_init ();
+
+  if (mkdir (dirPath, 0755) < 0 && errno != EEXIST) {
+    g_warning ("nvmsgbroker spool: unable to create %s: %s", dirPath,
+        strerror (errno));
+    return NULL;
+  }
+  dir = opendir (dirPath);
+  if (!dir) {
+    g_warning ("nvmsgbroker spool: unable to open %s: %s", dirPath,
+        strerror (errno));
+    return NULL;
+  }
+
+  spool = g_new0 (GstNvMsgBrokerSpool, 1);
+  g_mutex_init (&spool->lock);
+  spool->dir = g_strdup (dirPath);
+  spool->segmentSize = SPOOL_ALIGN_UP (segmentSize);
+  /* one more segment is kept prepared ahead */
+  spool->maxSegments = MAX (2, maxSize / spool->segmentSize - 1);
+
+  spool_recover (spool, dir);
+  closedir (dir);
+
+  gst_nvmsgbroker_spool_prepare (spool);
+  return spool;
+}
+
+void
+gst_nvmsgbroker_spool_close (GstNvMsgBrokerSpool * spool)
+{
+  SpoolSegment *seg, *next;
+
+  if (!spool)
+    return;
+
+  for (seg = spool->head; seg; seg = next) {
+    next = seg->next;
+    spool_segment_free (seg, seg->count == 0);
+  }
+  if (spool->spareSeg)
+    spool_segment_free (spool->spareSeg, TRUE);
+  g_mutex_clear (&spool->lock);
+  g_free (spool->dir);
+  g_free (spool);
+}
+
+gboolean
+gst_nvmsgbroker_spool_prepare (GstNvMsgBrokerSpool * spool)
+{
+  SpoolSegment *seg;
+  guint64 seq;
+
+  g_mutex_lock (&spool->lock);
+  if (spool->spareSeg || spool->preparing) {
+    g_mutex_unlock (&spool->lock);
+    return TRUE;
+  }
+  spool->preparing = TRUE;
+  seq = spool->nextSeq++;
+  g_mutex_unlock (&spool->lock);
+
+  /* file is created and mapped without holding the lock, writers go on
+   * with the current segment meanwhile */
+  seg = spool_segment_create (spool->dir, seq, spool->segmentSize);
+
+  g_mutex_lock (&spool->lock);
+  spool->spareSeg = seg;
+  spool->preparing = FALSE;
+  g_mutex_unlock (&spool->lock);
+  return seg != NULL;
+}
+
+gboolean
+gst_nvmsgbroker_spool_ready (GstNvMsgBrokerSpool * spool)
+{
+  gboolean ready;
+
+  g_mutex_lock (&spool->lock);
+  ready = spool->spareSeg != NULL;
+  g_mutex_unlock (&spool->lock);
+  return ready;
+}
+
+gboolean
+gst_nvmsgbroker_spool_write (GstNvMsgBrokerSpool * spool,
+    const GstNvMsgBrokerMsg * msg)
+{
+  SpoolRecordHeader *rh;
+  SpoolSegment *seg;
+  guint32 keyLen = msg->key ? strlen (msg->key) : 0;
+  guint64 len;
+
+  len = SPOOL_ALIGN_UP (sizeof (SpoolRecordHeader) + (guint64) keyLen +
+      msg->size);
+  if (len > spool->segmentSize - SPOOL_HEADER_SIZE)
+    return FALSE;
+
+  g_mutex_lock (&spool->lock);
+
+  /* Segments of earlier sessions are not appended to, a partially written
+   * record may follow their last valid one */
+  seg = spool->writeSeg;
+  if (!seg || seg->writeOffset + len > seg->size) {
+    seg = spool->spareSeg;
+    if (!seg) {
+      g_mutex_unlock (&spool->lock);
+      return FALSE;
+    }
+    if (spool->writeSeg)
+      msync (spool->writeSeg->map, spool->writeSeg->size, MS_ASYNC);
+
+    spool->spareSeg = NULL;
+    spool_append_segment (spool, seg);
+    spool->writeSeg = seg;
+
+    while (spool->numSegments > spool->maxSegments)
+      spool_remove_head (spool);
+  }
+
+  rh = (SpoolRecordHeader *) (seg->map + seg->writeOffset);
+  rh->keyLen = keyLen;
+  rh->dataLen = msg->size;
+  memcpy (rh + 1, msg->key, keyLen);
+  memcpy ((guint8 *) (rh + 1) + keyLen, msg->data, msg->size);
+  rh->crc = spool_record_crc (rh);
+  g_atomic_int_set (&rh->magic, SPOOL_RECORD_MAGIC);
+
+  seg->writeOffset += len;
+  seg->count++;
+  spool->count++;
+
+  g_mutex_unlock (&spool->lock);
+  return TRUE;
+}
+
+/* Drops fully read segments other than the one being written */
+static void
+spool_skip_read_segments (GstNvMsgBrokerSpool * spool)
+{
+  SpoolSegment *seg;
+
+  while ((seg = spool->head) && !seg->count && seg != spool->writeSeg)
+    spool_remove_head (spool);
+}
+
+gboolean
+gst_nvmsgbroker_spool_peek (GstNvMsgBrokerSpool * spool,
+    GstNvMsgBrokerMsg * msg, GstNvMsgBrokerSpoolPos * pos)
+{
+  SpoolRecordHeader *rh;
+  SpoolSegment *seg;
+
+  g_mutex_lock (&spool->lock);
+  spool_skip_read_segments (spool);
+
+  seg = spool->head;
+  if (!seg || !seg->count) {
+    g_mutex_unlock (&spool->lock);
+    return FALSE;
+  }
+
+  pos->seq = seg->seq;
+  pos->offset = spool_segment_header (seg)->readOffset;
+  rh = (SpoolRecordHeader *) (seg->map + pos->offset);
+  msg->key = rh->keyLen ? g_strndup ((const gchar *) (rh + 1), rh->keyLen) : NULL;
+  msg->data = g_memdup ((const guint8 *) (rh + 1) + rh->keyLen, rh->dataLen);
+  msg->size = rh->dataLen;
+  msg->enqueueTime = g_get_monotonic_time ();
+
+  g_mutex_unlock (&spool->lock);
+  return TRUE;
+}
+
+void
+gst_nvmsgbroker_spool_consume (GstNvMsgBrokerSpool * spool,
+    const GstNvMsgBrokerSpoolPos * pos)
+{
+  SpoolSegmentHeader *hdr;
+  SpoolRecordHeader *rh;
+  SpoolSegment *seg;
+
+  g_mutex_lock (&spool->lock);
+  spool_skip_read_segments (spool);
+
+  /* record is gone if its segment was deleted since peek */
+  seg = spool->head;
+  if (seg && seg->count && seg->seq == pos->seq &&
+      spool_segment_header (seg)->readOffset == pos->offset) {
+    hdr = spool_segment_header (seg);
+    rh = (SpoolRecordHeader *) (seg->map + hdr->readOffset);
+    hdr->readOffset += SPOOL_ALIGN_UP (sizeof (SpoolRecordHeader) +
+        (guint64) rh->keyLen + rh->dataLen);
+    msync (seg->map, SPOOL_HEADER_SIZE, MS_ASYNC);
+    seg->count--;
+    spool->count--;
+    spool_skip_read_segments (spool);
+  }
+
+  g_mutex_unlock (&spool->lock);
+}
+
+guint64
+gst_nvmsgbroker_spool_count (GstNvMsgBrokerSpool * spool)
+{
+  guint64 count;
+
+  g_mutex_lock (&spool->lock);
+  count = spool->count;
+  g_mutex_unlock (&spool->lock);
+  return count;
+}
+
+guint64
+gst_nvmsgbroker_spool_dropped (GstNvMsgBrokerSpool * spool)
+{
+  guint64 dropped;
+
+  g_mutex_lock (&spool->lock);
+  dropped = spool->dropped;
+  g_mutex_unlock (&spool->lock);
+  return dropped;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef _GST_NVMSGBROKER_SPOOL_H_
+#define _GST_NVMSGBROKER_SPOOL_H_
+
+#include <glib.h>
+#include "gstnvmsgbroker_queue.h"
+
+G_BEGIN_DECLS
+
+/**
+ * Disk spool storing messages nvmsgbroker could not send, to be replayed
+ * once the broker is reachable again.
+ *
+ * Messages are appended to memory-mapped segment files of fixed size in the
+ * spool directory. A record is committed by writing its header last, and is
+ * validated by a checksum when the spool is opened again, so messages written
+ * before a crash are recovered and a partially written record is ignored.
+ * Read position is kept in the segment header, messages are replayed at least
+ * once. Segments are deleted once all their messages are read; when the spool
+ * grows beyond its max size, the oldest segment is deleted along with
+ * messages not read yet.
+ *
+ * Segment files are created ahead of time by gst_nvmsgbroker_spool_prepare,
+ * so that writing doesn't create, resize or map files.
+ *
+ * Write and prepare are safe from any thread; peek / consume are expected to
+ * be called from a single reader thread.
+ */
+
+typedef struct _GstNvMsgBrokerSpool GstNvMsgBrokerSpool;
+
+/**
+ * Position of a record returned by gst_nvmsgbroker_spool_peek.
+ */
+typedef struct
+{
+  guint64 seq;
+  guint64 offset;
+} GstNvMsgBrokerSpoolPos;
+
+/**
+ * Opens the spool in directory @dir, creating it if needed, and recovers
+ * messages of an earlier session.
+ *
+ * @param[in] segmentSize Size of a segment file in bytes.
+ * @param[in] maxSize Max total size of segment files in bytes, at least two
+ *                    segments are kept.
+ *
+ * @return NULL on failure.
+ */
+GstNvMsgBrokerSpool *gst_nvmsgbroker_spool_open (const gchar * dir,
+    guint64 segmentSize, guint64 maxSize);
+
+/**
+ * Flushes the segments to disk and closes the spool. Messages not read yet
+ * are kept for the next session.
+ */
+void gst_nvmsgbroker_spool_close (GstNvMsgBrokerSpool * spool);
+
+/**
+ * Creates the segment to be written once the current one is full, if not
+ * done yet.
+ *
+ * @return FALSE if the segment can't be created.
+ */
+gboolean gst_nvmsgbroker_spool_prepare (GstNvMsgBrokerSpool * spool);
+
+/**
+ * Returns TRUE if the segment to be written next is ready.
+ */
+gboolean gst_nvmsgbroker_spool_ready (GstNvMsgBrokerSpool * spool);
+
+/**
+ * Appends a copy of @msg to the spool. Caller keeps ownership of @msg.
+ *
+ * @return FALSE if the message can't be stored, e.g. when the current
+ * segment is full and the next one isn't prepared yet.
+ */
+gboolean gst_nvmsgbroker_spool_write (GstNvMsgBrokerSpool * spool,
+    const GstNvMsgBrokerMsg * msg);
+
+/**
+ * Copies the oldest message of the spool into @msg, without removing it.
+ * Data and key of @msg are allocated with g_malloc and owned by the caller.
+ * @pos is set to the position of the message, to be passed to
+ * gst_nvmsgbroker_spool_consume.
+ *
+ * @return FALSE if the spool is empty.
+ */
+gboolean gst_nvmsgbroker_spool_peek (GstNvMsgBrokerSpool * spool,
+    GstNvMsgBrokerMsg * msg, GstNvMsgBrokerSpoolPos * pos);
+
+/**
+ * Removes the message at @pos once it has been sent. Nothing is done if the
+ * message was deleted meanwhile to keep the spool within its max size.
+ * Read position is flushed to disk asynchronously.
+ */
+void gst_nvmsgbroker_spool_consume (GstNvMsgBrokerSpool * spool,
+    const GstNvMsgBrokerSpoolPos * pos);
+
+/**
+ * Returns the number of messages in the spool.
+ */
+guint64 gst_nvmsgbroker_spool_count (GstNvMsgBrokerSpool * spool);
+
+/**
+ * Returns the number of messages deleted to keep the spool within its max
+ * size.
+ */
+guint64 gst_nvmsgbroker_spool_dropped (GstNvMsgBrokerSpool * spool);
+
+G_END_DECLS
+
+#endif
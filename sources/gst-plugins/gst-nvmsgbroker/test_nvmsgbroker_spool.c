@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Exercises the nvmsgbroker disk spool:
+ *  - messages written by a process killed while writing are recovered in
+ *    order, up to the last complete one
+ *  - read position is kept across sessions
+ *  - spool is kept within its max size by deleting the oldest segment
+ *  - a message deleted between peek and consume doesn't make consume drop
+ *    another one
+ *
+ * Usage: test_nvmsgbroker_spool [spool directory]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "gstnvmsgbroker_spool.h"
+
+#define DEFAULT_SPOOL_DIR "/tmp/nvmsgbroker_spool_test"
+#define SEGMENT_SIZE (64 * 1024)
+#define MAX_SIZE (16 * SEGMENT_SIZE)
+
+static void
+make_msg (GstNvMsgBrokerMsg * msg, guint64 id)
+{
+  /* size varies with id so that records straddle segment ends */
+  msg->size = 32 + id % 200;
+  msg->data = g_malloc (msg->size);
+  memset (msg->data, (int) (id & 0xff), msg->size);
+  memcpy (msg->data, &id, sizeof (id));
+  msg->key = g_strdup_printf ("sensor-%" G_GUINT64_FORMAT, id % 4);
+  msg->enqueueTime = 0;
+}
+
+static gboolean
+check_msg (GstNvMsgBrokerMsg * msg, guint64 id)
+{
+  GstNvMsgBrokerMsg expected;
+  gboolean ok;
+
+  make_msg (&expected, id);
+  ok = msg->size == expected.size && !memcmp (msg->data, expected.data, msg->size) &&
+      !g_strcmp0 (msg->key, expected.key);
+  gst_nvmsgbroker_msg_clear (&expected);
+  return ok;
+}
+
+static void
+remove_spool (const char *dir)
+{
+  gchar *cmd = g_strdup_printf ("rm -rf %s", dir);
+  if (system (cmd) != 0)
+    printf ("unable to remove %s\n", dir);
+  g_free (cmd);
+}
+
+/* Writes messages until killed */
+static void
+writer (const char *dir)
+{
+  GstNvMsgBrokerSpool *spool = gst_nvmsgbroker_spool_open (dir, SEGMENT_SIZE, 1 << 30);
+  GstNvMsgBrokerMsg msg;
+  guint64 id;
+
+  for (id = 0;; id++) {
+    make_msg (&msg, id);
+    gst_nvmsgbroker_spool_prepare (spool);
+    gst_nvmsgbroker_spool_write (spool, &msg);
+    gst_nvmsgbroker_msg_clear (&msg);
+  }
+}
+
+/* Reads @count messages, expected to start from @first */
+static guint64
+read_msgs (GstNvMsgBrokerSpool * spool, guint64 first, guint64 count, int *ret)
+{
+  GstNvMsgBrokerSpoolPos pos;
+  GstNvMsgBrokerMsg msg;
+  guint64 id;
+
+  for (id = first; id < first + count &&
+      gst_nvmsgbroker_spool_peek (spool, &msg, &pos); id++) {
+    if (!check_msg (&msg, id)) {
+      printf ("FAIL: message %" G_GUINT64_FORMAT " corrupted or out of order\n", id);
+      *ret = -1;
+      gst_nvmsgbroker_msg_clear (&msg);
+      break;
+    }
+    gst_nvmsgbroker_msg_clear (&msg);
+    gst_nvmsgbroker_spool_consume (spool, &pos);
+  }
+  return id - first;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *dir = argc > 1 ? argv[1] : DEFAULT_SPOOL_DIR;
+  GstNvMsgBrokerSpool *spool;
+  GstNvMsgBrokerSpoolPos pos;
+  GstNvMsgBrokerMsg msg;
+  guint64 total, read, id;
+  int ret = 0;
+  pid_t pid;
+
+  remove_spool (dir);
+
+  /* crash while writing */
+  pid = fork ();
+  if (pid == 0)
+    writer (dir);
+  usleep (200 * 1000);
+  kill (pid, SIGKILL);
+  waitpid (pid, NULL, 0);
+
+  spool = gst_nvmsgbroker_spool_open (dir, SEGMENT_SIZE, 1 << 30);
+  if (!spool) {
+    printf ("FAIL: unable to open spool %s\n", dir);
+    return -1;
+  }
+  total = gst_nvmsgbroker_spool_count (spool);
+  printf ("recovered %" G_GUINT64_FORMAT " messages after crash\n", total);
+  if (!total) {
+    printf ("FAIL: no message recovered\n");
+    ret = -1;
+  }
+
+  /* read half, rest must be found by next session */
+  read = read_msgs (spool, 0, total / 2, &ret);
+  gst_nvmsgbroker_spool_close (spool);
+
+  spool = gst_nvmsgbroker_spool_open (dir, SEGMENT_SIZE, 1 << 30);
+  if (gst_nvmsgbroker_spool_count (spool) != total - read) {
+    printf ("FAIL: %" G_GUINT64_FORMAT " messages left after reopen, expected %"
+        G_GUINT64_FORMAT "\n", gst_nvmsgbroker_spool_count (spool), total - read);
+    ret = -1;
+  }
+  read += read_msgs (spool, read, total, &ret);
+  if (read != total) {
+    printf ("FAIL: read %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " messages\n",
+        read, total);
+    ret = -1;
+  }
+  gst_nvmsgbroker_spool_close (spool);
+
+  /* size cap */
+  remove_spool (dir);
+  spool = gst_nvmsgbroker_spool_open (dir, SEGMENT_SIZE, MAX_SIZE);
+  for (id = 0; id < 100000; id++) {
+    make_msg (&msg, id);
+    gst_nvmsgbroker_spool_prepare (spool);
+    gst_nvmsgbroker_spool_write (spool, &msg);
+    gst_nvmsgbroker_msg_clear (&msg);
+  }
+  printf ("size cap: %" G_GUINT64_FORMAT " messages kept, %" G_GUINT64_FORMAT
+      " dropped\n", gst_nvmsgbroker_spool_count (spool),
+      gst_nvmsgbroker_spool_dropped (spool));
+  if (gst_nvmsgbroker_spool_count (spool) + gst_nvmsgbroker_spool_dropped (spool) != id ||
+      gst_nvmsgbroker_spool_count (spool) * 48 > MAX_SIZE) {
+    printf ("FAIL: spool not kept within max size\n");
+    ret = -1;
+  }
+  /* oldest messages are dropped, remaining ones are the latest */
+  read = read_msgs (spool, gst_nvmsgbroker_spool_dropped (spool), id, &ret);
+  if (gst_nvmsgbroker_spool_dropped (spool) + read != id) {
+    printf ("FAIL: latest messages not kept\n");
+    ret = -1;
+  }
+
+  /* head segment deleted while its first message is being sent */
+  make_msg (&msg, id);
+  gst_nvmsgbroker_spool_prepare (spool);
+  gst_nvmsgbroker_spool_write (spool, &msg);
+  gst_nvmsgbroker_msg_clear (&msg);
+  gst_nvmsgbroker_spool_peek (spool, &msg, &pos);
+  gst_nvmsgbroker_msg_clear (&msg);
+  /* messages before it were all read or dropped */
+  total = id;
+  for (id++; gst_nvmsgbroker_spool_dropped (spool) + read <= total; id++) {
+    make_msg (&msg, id);
+    gst_nvmsgbroker_spool_prepare (spool);
+    gst_nvmsgbroker_spool_write (spool, &msg);
+    gst_nvmsgbroker_msg_clear (&msg);
+  }
+  total = gst_nvmsgbroker_spool_count (spool);
+  gst_nvmsgbroker_spool_consume (spool, &pos);
+  if (gst_nvmsgbroker_spool_count (spool) != total) {
+    printf ("FAIL: consume removed a message which wasn't sent\n");
+    ret = -1;
+  }
+  gst_nvmsgbroker_spool_close (spool);
+  remove_spool (dir);
+
+  printf ("%s\n", ret ? "FAILED" : "PASSED");
+  return ret;
+}
@@ -22,6 +22,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_nvmsgconv_debug_category);
 #define GST_CAT_DEFAULT gst_nvmsgconv_debug_category
 
 #define DEFAULT_PAYLOAD_TYPE NVDS_PAYLOAD_DEEPSTREAM
+#define DEFAULT_MAX_BATCH_EVENTS 0
+#define DEFAULT_MAX_BATCH_LATENCY 0
 
 #define GST_TYPE_NVMSGCONV_PAYLOAD_TYPE (gst_nvmsgconv_payload_get_type ())
 
@@ -34,6 +36,7 @@ gst_nvmsgconv_payload_get_type (void)
     static const GEnumValue values[] = {
       {NVDS_PAYLOAD_DEEPSTREAM, "Deepstream schema payload", "PAYLOAD_DEEPSTREAM"},
       {NVDS_PAYLOAD_DEEPSTREAM_MINIMAL, "Deepstream schema payload minimal", "PAYLOAD_DEEPSTREAM_MINIMAL"},
+      {NVDS_PAYLOAD_DEEPSTREAM_BINARY, "Deepstream schema payload binary", "PAYLOAD_DEEPSTREAM_BINARY"},
       {NVDS_PAYLOAD_RESERVED, "Reserved type", "PAYLOAD_RESERVED"},
       {NVDS_PAYLOAD_CUSTOM, "Custom schema payload", "PAYLOAD_CUSTOM"},
       {0, NULL, NULL}
@@ -53,6 +56,8 @@ static gboolean gst_nvmsgconv_set_caps (GstBaseTransform * trans,
     GstCaps * incaps, GstCaps * outcaps);
 static gboolean gst_nvmsgconv_start (GstBaseTransform * trans);
 static gboolean gst_nvmsgconv_stop (GstBaseTransform * trans);
+static gboolean gst_nvmsgconv_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
 static GstFlowReturn gst_nvmsgconv_transform_ip (GstBaseTransform * trans,
     GstBuffer * buf);
 
@@ -62,7 +67,9 @@ enum
   PROP_CONFIG_FILE,
   PROP_MSG2P_LIB_NAME,
   PROP_PAYLOAD_TYPE,
-  PROP_COMPONENT_ID
+  PROP_COMPONENT_ID,
+  PROP_MAX_BATCH_EVENTS,
+  PROP_MAX_BATCH_LATENCY
 };
 
 static GstStaticPadTemplate gst_nvmsgconv_src_template =
@@ -113,6 +120,282 @@ static gpointer gst_nvmsgconv_copy_meta (gpointer data, gpointer uData)
   return outPayload;
 }
 
+static void gst_nvmsgconv_free_batch_meta (gpointer data, gpointer uData)
+{
+  g_return_if_fail (data);
+
+  NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
+  NvDsPayload *srcPayload = (NvDsPayload *) user_meta->user_meta_data;
+
+  /* Aggregated payloads are allocated by the element, not by the library */
+  if (srcPayload) {
+    g_free (srcPayload->payload);
+    g_free (srcPayload);
+  }
+}
+
+static gboolean
+gst_nvmsgconv_attach_payload (GstNvMsgConv * self, NvDsBatchMeta * batch_meta,
+    NvDsFrameMeta * frame_meta, NvDsPayload * payload,
+    NvDsMetaReleaseFunc release_func)
+{
+  payload->componentId = self->compId;
+
+  NvDsUserMeta *user_payload_meta = nvds_acquire_user_meta_from_pool (batch_meta);
+  if (user_payload_meta) {
+    user_payload_meta->user_meta_data = (void *) payload;
+    user_payload_meta->base_meta.meta_type = NVDS_PAYLOAD_META;
+    user_payload_meta->base_meta.copy_func = (NvDsMetaCopyFunc) gst_nvmsgconv_copy_meta;
+    user_payload_meta->base_meta.release_func = release_func;
+    user_payload_meta->base_meta.uContext = (void *) self;
+    nvds_add_user_meta_to_frame (frame_meta, user_payload_meta);
+    return TRUE;
+  }
+
+  GST_ELEMENT_ERROR (self, RESOURCE, FAILED, (NULL),
+                     ("Couldn't get user meta from pool"));
+  return FALSE;
+}
+
+static gpointer gst_nvmsgconv_copy_ext_meta (gpointer data, gpointer uData)
+{
+  NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
+  NvDsPayloadExt *srcExt = (NvDsPayloadExt *) user_meta->user_meta_data;
+  NvDsPayloadExt *outExt = NULL;
+
+  if (srcExt) {
+    outExt = (NvDsPayloadExt *) g_memdup (srcExt, sizeof (NvDsPayloadExt));
+    /* copy of the payload meta is a different payload */
+    outExt->payload = NULL;
+    outExt->key = g_strdup (srcExt->key);
+  }
+  return outExt;
+}
+
+static void gst_nvmsgconv_free_ext_meta (gpointer data, gpointer uData)
+{
+  g_return_if_fail (data);
+
+  NvDsUserMeta *user_meta = (NvDsUserMeta *) data;
+  NvDsPayloadExt *payloadExt = (NvDsPayloadExt *) user_meta->user_meta_data;
+
+  if (payloadExt) {
+    g_free (payloadExt->key);
+    g_free (payloadExt);
+  }
+}
+
+/**
+ * Attaches the key and flags of the payload to the frame carrying it. Key
+ * of the payload generated for @events is provided by the converter library,
+ * if it supports it. Nothing is attached if there's neither key nor flags.
+ */
+static gboolean
+gst_nvmsgconv_attach_ext (GstNvMsgConv * self, NvDsBatchMeta * batch_meta,
+    NvDsFrameMeta * frame_meta, NvDsPayload * payload, guint flags,
+    NvDsEvent * events, guint size)
+{
+  NvDsPayloadExt *payloadExt;
+  NvDsUserMeta *user_ext_meta;
+  gchar *key = NULL;
+
+  if (events && self->msg2p_generate_key)
+    key = self->msg2p_generate_key (self->pCtx, events, size);
+
+  if (!key && !flags)
+    return TRUE;
+
+  user_ext_meta = nvds_acquire_user_meta_from_pool (batch_meta);
+  if (!user_ext_meta) {
+    g_free (key);
+    GST_ELEMENT_ERROR (self, RESOURCE, FAILED, (NULL),
+                       ("Couldn't get user meta from pool"));
+    return FALSE;
+  }
+
+  payloadExt = g_new0 (NvDsPayloadExt, 1);
+  payloadExt->size = sizeof (NvDsPayloadExt);
+  payloadExt->payload = payload;
+  payloadExt->key = key;
+  payloadExt->flags = flags;
+
+  user_ext_meta->user_meta_data = (void *) payloadExt;
+  user_ext_meta->base_meta.meta_type = NVDS_PAYLOAD_EXT_META;
+  user_ext_meta->base_meta.copy_func = (NvDsMetaCopyFunc) gst_nvmsgconv_copy_ext_meta;
+  user_ext_meta->base_meta.release_func = (NvDsMetaReleaseFunc) gst_nvmsgconv_free_ext_meta;
+  user_ext_meta->base_meta.uContext = (void *) self;
+  nvds_add_user_meta_to_frame (frame_meta, user_ext_meta);
+  return TRUE;
+}
+
+static gboolean
+gst_nvmsgconv_batching_enabled (GstNvMsgConv * self)
+{
+  return self->maxBatchEvents || self->maxBatchLatency;
+}
+
+/* Sets when the timer thread should push the pending events, 0 for never. */
+static void
+gst_nvmsgconv_batch_set_deadline (GstNvMsgConv * self, gint64 deadline)
+{
+  if (!self->batchTimerThread)
+    return;
+
+  g_mutex_lock (&self->batchTimerLock);
+  self->batchTimerDeadline = deadline;
+  g_cond_signal (&self->batchTimerCond);
+  g_mutex_unlock (&self->batchTimerLock);
+}
+
+/**
+ * Appends the payload to the pending aggregated payload and releases it.
+ * JSON payloads are aggregated into an array, binary payloads can just be
+ * concatenated as that merges the repeated events field.
+ */
+static void
+gst_nvmsgconv_batch_add (GstNvMsgConv * self, NvDsPayload * payload,
+    guint numEvents)
+{
+  gboolean isJson = self->paylodType != NVDS_PAYLOAD_DEEPSTREAM_BINARY;
+
+  if (!self->batchEvents) {
+    self->batchStartTime = g_get_monotonic_time ();
+    gst_nvmsgconv_batch_set_deadline (self, self->batchStartTime +
+        (gint64) self->maxBatchLatency * 1000);
+    if (isJson)
+      g_byte_array_append (self->batchData, (const guint8 *) "[", 1);
+  } else if (isJson) {
+    g_byte_array_append (self->batchData, (const guint8 *) ",", 1);
+  }
+
+  g_byte_array_append (self->batchData, (const guint8 *) payload->payload,
+      payload->payloadSize);
+  self->batchEvents += numEvents;
+
+  self->msg2p_release (self->pCtx, payload);
+}
+
+static gboolean
+gst_nvmsgconv_batch_flush (GstNvMsgConv * self, NvDsBatchMeta * batch_meta,
+    NvDsFrameMeta * frame_meta)
+{
+  NvDsPayload *payload;
+
+  if (!self->batchEvents)
+    return TRUE;
+
+  if (self->paylodType != NVDS_PAYLOAD_DEEPSTREAM_BINARY)
+    g_byte_array_append (self->batchData, (const guint8 *) "]", 1);
+
+  GST_LOG_OBJECT (self, "flushing %u events in %u bytes", self->batchEvents,
+      self->batchData->len);
+
+  payload = (NvDsPayload *) g_malloc0 (sizeof (NvDsPayload));
+  payload->payloadSize = self->batchData->len;
+  payload->payload = g_byte_array_free (self->batchData, FALSE);
+  self->batchData = g_byte_array_new ();
+  self->batchEvents = 0;
+  gst_nvmsgconv_batch_set_deadline (self, 0);
+
+  if (!gst_nvmsgconv_attach_payload (self, batch_meta, frame_meta, payload,
+          (NvDsMetaReleaseFunc) gst_nvmsgconv_free_batch_meta)) {
+    g_free (payload->payload);
+    g_free (payload);
+    return FALSE;
+  }
+
+  /* aggregated payload is allocated by the element */
+  if (!gst_nvmsgconv_attach_ext (self, batch_meta, frame_meta, payload,
+          NVDS_PAYLOAD_FLAG_TRANSFERABLE, NULL, 0))
+    return FALSE;
+  return TRUE;
+}
+
+static void
+gst_nvmsgconv_batch_discard (GstNvMsgConv * self)
+{
+  if (self->batchData)
+    g_byte_array_set_size (self->batchData, 0);
+  self->batchEvents = 0;
+  gst_nvmsgconv_batch_set_deadline (self, 0);
+}
+
+/**
+ * Pushes the pending aggregated payload downstream in a buffer of its own,
+ * used at EOS when there won't be any other buffer to carry it.
+ */
+static void
+gst_nvmsgconv_batch_push_pending (GstNvMsgConv * self)
+{
+  GstBuffer *buf;
+  NvDsBatchMeta *batch_meta;
+  NvDsFrameMeta *frame_meta;
+  NvDsMeta *meta;
+  GstFlowReturn ret;
+
+  if (!self->batchEvents)
+    return;
+
+  batch_meta = nvds_create_batch_meta (1);
+  frame_meta = nvds_acquire_frame_meta_from_pool (batch_meta);
+  nvds_add_frame_meta_to_batch (batch_meta, frame_meta);
+
+  if (!gst_nvmsgconv_batch_flush (self, batch_meta, frame_meta)) {
+    nvds_destroy_batch_meta (batch_meta);
+    return;
+  }
+
+  buf = gst_buffer_new ();
+  meta = gst_buffer_add_nvds_meta (buf, batch_meta, NULL,
+      nvds_batch_meta_copy_func, nvds_batch_meta_release_func);
+  meta->meta_type = NVDS_BATCH_GST_META;
+  batch_meta->base_meta.batch_meta = batch_meta;
+
+  ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (self), buf);
+  if (ret != GST_FLOW_OK)
+    GST_WARNING_OBJECT (self, "failed to push pending payload: %s",
+        gst_flow_get_name (ret));
+}
+
+/**
+ * Pushes the pending aggregated payload once max-latency has passed, when
+ * the source stalls and no buffer comes to carry it. The sink pad stream
+ * lock serializes it with the buffers and events of the streaming thread.
+ */
+static gpointer
+gst_nvmsgconv_batch_timer_loop (gpointer data)
+{
+  GstNvMsgConv *self = GST_NVMSGCONV (data);
+  GstPad *sinkpad = GST_BASE_TRANSFORM_SINK_PAD (self);
+
+  g_mutex_lock (&self->batchTimerLock);
+  while (!self->batchTimerStop) {
+    if (!self->batchTimerDeadline) {
+      g_cond_wait (&self->batchTimerCond, &self->batchTimerLock);
+      continue;
+    }
+    if (g_get_monotonic_time () < self->batchTimerDeadline) {
+      g_cond_wait_until (&self->batchTimerCond, &self->batchTimerLock,
+          self->batchTimerDeadline);
+      continue;
+    }
+    g_mutex_unlock (&self->batchTimerLock);
+
+    GST_PAD_STREAM_LOCK (sinkpad);
+    /* The streaming thread may have flushed the events meanwhile. */
+    if (self->batchEvents && g_get_monotonic_time () - self->batchStartTime >=
+        (gint64) self->maxBatchLatency * 1000) {
+      GST_LOG_OBJECT (self, "max-latency passed without buffers");
+      gst_nvmsgconv_batch_push_pending (self);
+    }
+    GST_PAD_STREAM_UNLOCK (sinkpad);
+
+    g_mutex_lock (&self->batchTimerLock);
+  }
+  g_mutex_unlock (&self->batchTimerLock);
+  return NULL;
+}
+
 static void
 gst_nvmsgconv_class_init (GstNvMsgConvClass * klass)
 {
@@ -137,6 +420,8 @@ gst_nvmsgconv_class_init (GstNvMsgConvClass * klass)
   base_transform_class->set_caps = GST_DEBUG_FUNCPTR (gst_nvmsgconv_set_caps);
   base_transform_class->start = GST_DEBUG_FUNCPTR (gst_nvmsgconv_start);
   base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_nvmsgconv_stop);
+  base_transform_class->sink_event =
+      GST_DEBUG_FUNCPTR (gst_nvmsgconv_sink_event);
   base_transform_class->transform_ip =
       GST_DEBUG_FUNCPTR (gst_nvmsgconv_transform_ip);
 
@@ -163,6 +448,23 @@ gst_nvmsgconv_class_init (GstNvMsgConvClass * klass)
       "\t\t\thaving this component id\n",
       0, G_MAXUINT, 0,
       (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_BATCH_EVENTS,
+      g_param_spec_uint ("max-events-per-payload", "Max events per payload",
+      "Aggregate events across frames and sources into one array payload\n"
+      "\t\t\tholding up to this number of events (0 = no limit).\n"
+      "\t\t\tAggregation is disabled if this and max-latency are 0\n",
+      0, G_MAXUINT, DEFAULT_MAX_BATCH_EVENTS,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_BATCH_LATENCY,
+      g_param_spec_uint ("max-latency", "Max latency",
+      "Maximum time in milliseconds events are held for aggregation\n"
+      "\t\t\tbefore the payload is flushed (0 = no limit)\n",
+      0, G_MAXUINT, DEFAULT_MAX_BATCH_LATENCY,
+      (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY)));
 }
 
 static void
@@ -174,6 +476,13 @@ gst_nvmsgconv_init (GstNvMsgConv * self)
   self->paylodType = DEFAULT_PAYLOAD_TYPE;
   self->libHandle = NULL;
   self->compId = 0;
+  self->maxBatchEvents = DEFAULT_MAX_BATCH_EVENTS;
+  self->maxBatchLatency = DEFAULT_MAX_BATCH_LATENCY;
+  self->batchData = NULL;
+  self->batchEvents = 0;
+  self->batchTimerThread = NULL;
+  g_mutex_init (&self->batchTimerLock);
+  g_cond_init (&self->batchTimerCond);
   self->dsMetaQuark = g_quark_from_static_string (NVDS_META_STRING);
 
   gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self), TRUE);
@@ -204,6 +513,12 @@ gst_nvmsgconv_set_property (GObject * object, guint property_id,
     case PROP_COMPONENT_ID:
       self->compId = g_value_get_uint (value);
       break;
+    case PROP_MAX_BATCH_EVENTS:
+      self->maxBatchEvents = g_value_get_uint (value);
+      break;
+    case PROP_MAX_BATCH_LATENCY:
+      self->maxBatchLatency = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -231,6 +546,12 @@ gst_nvmsgconv_get_property (GObject * object, guint property_id,
     case PROP_COMPONENT_ID:
       g_value_set_uint (value, self->compId);
       break;
+    case PROP_MAX_BATCH_EVENTS:
+      g_value_set_uint (value, self->maxBatchEvents);
+      break;
+    case PROP_MAX_BATCH_LATENCY:
+      g_value_set_uint (value, self->maxBatchLatency);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -247,6 +568,9 @@ gst_nvmsgconv_finalize (GObject * object)
   if (self->configFile)
     g_free (self->configFile);
 
+  g_mutex_clear (&self->batchTimerLock);
+  g_cond_clear (&self->batchTimerCond);
+
   G_OBJECT_CLASS (gst_nvmsgconv_parent_class)->finalize (object);
 }
 
@@ -265,6 +589,7 @@ static gboolean
 gst_nvmsgconv_start (GstBaseTransform * trans)
 {
   GstNvMsgConv *self = GST_NVMSGCONV (trans);
+  nvds_msg2p_payload_transferable_ptr payload_transferable = NULL;
   gchar *error;
 
   GST_DEBUG_OBJECT (self, "start");
@@ -292,12 +617,20 @@ gst_nvmsgconv_start (GstBaseTransform * trans)
         GST_ERROR_OBJECT (self, "%s", error);
         return FALSE;
       }
+
+      /* Optional, payloads are sent without key and copied by consumers if
+       * not provided */
+      self->msg2p_generate_key = (nvds_msg2p_generate_key_ptr) dlsym (self->libHandle, "nvds_msg2p_generate_key");
+      payload_transferable = (nvds_msg2p_payload_transferable_ptr) dlsym (self->libHandle, "nvds_msg2p_payload_transferable");
+      dlerror ();
     }
   } else {
     self->ctx_create = (nvds_msg2p_ctx_create_ptr) nvds_msg2p_ctx_create;
     self->ctx_destroy = (nvds_msg2p_ctx_destroy_ptr) nvds_msg2p_ctx_destroy;
     self->msg2p_generate = (nvds_msg2p_generate_ptr) nvds_msg2p_generate;
     self->msg2p_release = (nvds_msg2p_release_ptr) nvds_msg2p_release;
+    self->msg2p_generate_key = (nvds_msg2p_generate_key_ptr) nvds_msg2p_generate_key;
+    payload_transferable = (nvds_msg2p_payload_transferable_ptr) nvds_msg2p_payload_transferable;
   }
 
   self->pCtx = self->ctx_create (self->configFile, self->paylodType);
@@ -310,6 +643,29 @@ gst_nvmsgconv_start (GstBaseTransform * trans)
     GST_ERROR_OBJECT (self, "unable to create instance");
     return FALSE;
   }
+
+  self->payloadFlags = 0;
+  if (payload_transferable && payload_transferable (self->pCtx))
+    self->payloadFlags |= NVDS_PAYLOAD_FLAG_TRANSFERABLE;
+
+  /* Aggregation stays off without batchData, the properties keep the values
+   * set by the user. */
+  if (gst_nvmsgconv_batching_enabled (self)) {
+    if (self->paylodType == NVDS_PAYLOAD_CUSTOM) {
+      GST_WARNING_OBJECT (self, "payload aggregation is not supported for "
+          "custom payload type, ignoring max-events-per-payload and "
+          "max-latency");
+    } else {
+      self->batchData = g_byte_array_new ();
+      self->batchEvents = 0;
+      if (self->maxBatchLatency) {
+        self->batchTimerDeadline = 0;
+        self->batchTimerStop = FALSE;
+        self->batchTimerThread = g_thread_new ("nvmsgconv-batch-timer",
+            gst_nvmsgconv_batch_timer_loop, self);
+      }
+    }
+  }
   return TRUE;
 }
 
@@ -320,6 +676,24 @@ gst_nvmsgconv_stop (GstBaseTransform * trans)
 
   GST_DEBUG_OBJECT (self, "stop");
 
+  if (self->batchTimerThread) {
+    g_mutex_lock (&self->batchTimerLock);
+    self->batchTimerStop = TRUE;
+    g_cond_signal (&self->batchTimerCond);
+    g_mutex_unlock (&self->batchTimerLock);
+    g_thread_join (self->batchTimerThread);
+    self->batchTimerThread = NULL;
+  }
+
+  if (self->batchData) {
+    if (self->batchEvents)
+      GST_WARNING_OBJECT (self, "discarding %u pending events",
+          self->batchEvents);
+    g_byte_array_free (self->batchData, TRUE);
+    self->batchData = NULL;
+    self->batchEvents = 0;
+  }
+
   if (self->pCtx) {
     self->ctx_destroy (self->pCtx);
     self->pCtx = NULL;
@@ -333,6 +707,28 @@ gst_nvmsgconv_stop (GstBaseTransform * trans)
   return TRUE;
 }
 
+static gboolean
+gst_nvmsgconv_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvMsgConv *self = GST_NVMSGCONV (trans);
+
+  if (self->batchData) {
+    switch (GST_EVENT_TYPE (event)) {
+      case GST_EVENT_EOS:
+        gst_nvmsgconv_batch_push_pending (self);
+        break;
+      case GST_EVENT_FLUSH_STOP:
+        gst_nvmsgconv_batch_discard (self);
+        break;
+      default:
+        break;
+    }
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (gst_nvmsgconv_parent_class)->sink_event
+      (trans, event);
+}
+
 static GstFlowReturn
 gst_nvmsgconv_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 {
@@ -367,7 +763,8 @@ gst_nvmsgconv_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
       frame_meta = (NvDsFrameMeta *) (l_frame->data);
       user_meta_list = frame_meta->frame_user_meta_list;
 
-      if (self->paylodType == NVDS_PAYLOAD_DEEPSTREAM_MINIMAL) {
+      if (self->paylodType == NVDS_PAYLOAD_DEEPSTREAM_MINIMAL ||
+          self->paylodType == NVDS_PAYLOAD_DEEPSTREAM_BINARY) {
         NvDsEvent *eventList = g_new0 (NvDsEvent, g_list_length (user_meta_list));
         guint eventCount = 0;
         for (l = user_meta_list; l; l = l->next) {
@@ -388,20 +785,19 @@ gst_nvmsgconv_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
         if (eventCount) {
           payload = self->msg2p_generate (self->pCtx, eventList, eventCount);
 
-          if (payload) {
-            payload->componentId = self->compId;
-
-            NvDsUserMeta *user_payload_meta = nvds_acquire_user_meta_from_pool (batch_meta);
-            if (user_payload_meta) {
-              user_payload_meta->user_meta_data = (void *) payload;
-              user_payload_meta->base_meta.meta_type = NVDS_PAYLOAD_META;
-              user_payload_meta->base_meta.copy_func = (NvDsMetaCopyFunc) gst_nvmsgconv_copy_meta;
-              user_payload_meta->base_meta.release_func = (NvDsMetaReleaseFunc) gst_nvmsgconv_free_meta;
-              user_payload_meta->base_meta.uContext = (void *) self;
-              nvds_add_user_meta_to_frame (frame_meta, user_payload_meta);
-            } else {
-              GST_ELEMENT_ERROR (self, RESOURCE, FAILED, (NULL),
-                                 ("Couldn't get user meta from pool"));
+          if (payload && self->batchData) {
+            gst_nvmsgconv_batch_add (self, payload, eventCount);
+            if (self->maxBatchEvents && self->batchEvents >= self->maxBatchEvents &&
+                !gst_nvmsgconv_batch_flush (self, batch_meta, frame_meta)) {
+              g_free (eventList);
+              return GST_FLOW_ERROR;
+            }
+          } else if (payload) {
+            if (!gst_nvmsgconv_attach_payload (self, batch_meta, frame_meta, payload,
+                    (NvDsMetaReleaseFunc) gst_nvmsgconv_free_meta) ||
+                !gst_nvmsgconv_attach_ext (self, batch_meta, frame_meta, payload,
+                    self->payloadFlags, eventList, eventCount)) {
+              g_free (eventList);
               return GST_FLOW_ERROR;
             }
           }
@@ -424,27 +820,32 @@ gst_nvmsgconv_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 
             payload = self->msg2p_generate (self->pCtx, &event, 1);
 
-            if (payload) {
-              payload->componentId = self->compId;
-
-              NvDsUserMeta *user_payload_meta = nvds_acquire_user_meta_from_pool (batch_meta);
-              if (user_payload_meta) {
-                user_payload_meta->user_meta_data = (void *) payload;
-                user_payload_meta->base_meta.meta_type = NVDS_PAYLOAD_META;
-                user_payload_meta->base_meta.copy_func = (NvDsMetaCopyFunc) gst_nvmsgconv_copy_meta;
-                user_payload_meta->base_meta.release_func = (NvDsMetaReleaseFunc) gst_nvmsgconv_free_meta;
-                user_payload_meta->base_meta.uContext = (void *) self;
-                nvds_add_user_meta_to_frame (frame_meta, user_payload_meta);
-              } else {
-                GST_ELEMENT_ERROR (self, RESOURCE, FAILED, (NULL),
-                                   ("Couldn't get user meta from pool"));
+            if (payload && self->batchData) {
+              gst_nvmsgconv_batch_add (self, payload, 1);
+              if (self->maxBatchEvents && self->batchEvents >= self->maxBatchEvents &&
+                  !gst_nvmsgconv_batch_flush (self, batch_meta, frame_meta))
+                return GST_FLOW_ERROR;
+            } else if (payload) {
+              if (!gst_nvmsgconv_attach_payload (self, batch_meta, frame_meta, payload,
+                      (NvDsMetaReleaseFunc) gst_nvmsgconv_free_meta) ||
+                  !gst_nvmsgconv_attach_ext (self, batch_meta, frame_meta, payload,
+                      self->payloadFlags, &event, 1))
                 return GST_FLOW_ERROR;
-              }
             }
           }
         }
       }
     }
+
+    /* Flush aggregated events once the oldest one has waited long enough;
+     * payload is carried by the last frame of this batch.
+     */
+    if (self->batchData && self->batchEvents && self->maxBatchLatency && frame_meta &&
+        g_get_monotonic_time () - self->batchStartTime >=
+            (gint64) self->maxBatchLatency * 1000) {
+      if (!gst_nvmsgconv_batch_flush (self, batch_meta, frame_meta))
+        return GST_FLOW_ERROR;
+    }
   }
   return GST_FLOW_OK;
 }
@@ -34,6 +34,10 @@ typedef NvDsPayload* (*nvds_msg2p_generate_ptr) (NvDsMsg2pCtx *ctx, NvDsEvent *e
 
 typedef void (*nvds_msg2p_release_ptr) (NvDsMsg2pCtx *ctx, NvDsPayload *payload);
 
+typedef gchar* (*nvds_msg2p_generate_key_ptr) (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size);
+
+typedef gboolean (*nvds_msg2p_payload_transferable_ptr) (NvDsMsg2pCtx *ctx);
+
 struct _GstNvMsgConv
 {
   GstBaseTransform parent;
@@ -46,10 +50,29 @@ struct _GstNvMsgConv
   NvDsPayloadType paylodType;
   NvDsMsg2pCtx *pCtx;
 
+  /* Aggregation of payloads across frames / batches, disabled if both are 0 */
+  guint maxBatchEvents;
+  guint maxBatchLatency;
+  GByteArray *batchData;
+  guint batchEvents;
+  gint64 batchStartTime;
+
+  /* Pushes the aggregated events when max-latency passes without buffers. */
+  GThread *batchTimerThread;
+  GMutex batchTimerLock;
+  GCond batchTimerCond;
+  /* Monotonic time to push the pending events at, 0 if none are pending. */
+  gint64 batchTimerDeadline;
+  gboolean batchTimerStop;
+
   nvds_msg2p_ctx_create_ptr ctx_create;
   nvds_msg2p_ctx_destroy_ptr ctx_destroy;
   nvds_msg2p_generate_ptr msg2p_generate;
   nvds_msg2p_release_ptr msg2p_release;
+  /* Optional, NULL if the converter library doesn't provide payload keys */
+  nvds_msg2p_generate_key_ptr msg2p_generate_key;
+  /* Flags of the payloads generated by the converter library */
+  guint payloadFlags;
 };
 
 struct _GstNvMsgConvClass
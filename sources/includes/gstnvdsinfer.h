@@ -99,13 +99,23 @@ typedef struct
   /** Height of the segmentation output class map. */
   guint height;
   /** Pointer to the array for 2D pixel class map. The output for pixel (x,y)
-   * will be at index (y * width + x). */
+   * will be at index (y * width + x). NULL if the map is run-length encoded
+   * in class_map_runs. */
   gint* class_map;
   /** Pointer to the raw array containing the probabilities. The probability for
-   * class c and pixel (x,y) will be at index (c * width *height + y * width + x). */
+   * class c and pixel (x,y) of the network output will be at index
+   * (c * W * H + y * W + x) with W = width * map_scale, H = height * map_scale. */
   gfloat *class_probabilities_map;
   /** Private data used for the meta producer's internal memory management. */
   void *priv_data;
+  /** Downsampling factor of the class map from the network output
+   * ("segmentation-map-scale"). */
+  guint map_scale;
+  /** Number of (class, length) pairs in class_map_runs, 0 if the class map is
+   * not run-length encoded ("segmentation-map-rle"). */
+  guint num_runs;
+  /** Run-length encoded class map, in row-major order. */
+  gint *class_map_runs;
 } NvDsInferSegmentationMeta;
 
 G_END_DECLS
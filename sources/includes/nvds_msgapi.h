@@ -105,6 +105,85 @@ NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const
  */
 NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char  *topic, const uint8_t *payload, size_t nbuf, nvds_msgapi_send_cb_t send_callback, void *user_ptr);
 
+/**
+  * Send message over connection synchronously, same as @ref nvds_msgapi_send
+  * but with an explicit key for partitioning / routing of the message.
+  * This saves the adapter from looking up the key in the payload.
+  * It's optional for adapters to implement; if @a key is NULL the adapter
+  * falls back to the behavior of @ref nvds_msgapi_send. A key explicitly
+  * configured for the adapter (e.g. kafka partition-key) takes precedence
+  * over @a key.
+  *
+  * @param[in] h_ptr connection handle
+  * @param[in] topic topic to which send message
+  * @param[in] payload message data
+  * @param[in] nbuf number of bytes of data to send
+  * @param[in] key key of the message
+  * @param[in] keylen number of bytes of key
+  *
+  * @return Completion status of send operation
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen);
+
+ /**
+  * Send message over connection asynchronously, same as
+  * @ref nvds_msgapi_send_async but with an explicit key for the message.
+  * It's optional for adapters to implement.
+  *
+  * @param[in] h_ptr connection handle
+  * @param[in] topic topic to which send message
+  * @param[in] payload message data
+  * @param[in] nbuf number of bytes of data to send
+  * @param[in] key key of the message
+  * @param[in] keylen number of bytes of key
+  * @param[in] send_callback callback to be invoked when operation complets
+  * @param[in] user_ptr pointer to pass to callback for context
+  *
+  * @return Completion status of send operation
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_async_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen, nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+
+/**
+  * Send message over connection asynchronously without copying it.
+  * Ownership of the payload is transferred to the adapter if the call
+  * succeeds; the adapter releases it with @a payload_free once the send is
+  * completed, after invoking @a send_callback. On failure the payload is
+  * still owned by the caller.
+  * It's optional for adapters to implement.
+  *
+  * @param[in] h_ptr connection handle
+  * @param[in] topic topic to which send message
+  * @param[in] payload message data
+  * @param[in] nbuf number of bytes of data to send
+  * @param[in] key key of the message, as in @ref nvds_msgapi_send_with_key.
+  *                Can be NULL.
+  * @param[in] keylen number of bytes of key
+  * @param[in] payload_free function to release the payload
+  * @param[in] send_callback callback to be invoked when operation complets
+  * @param[in] user_ptr pointer to pass to callback for context
+  *
+  * @return Completion status of send operation
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_async_nocopy(NvDsMsgApiHandle h_ptr, char *topic, uint8_t *payload, size_t nbuf, const char *key, size_t keylen, void (*payload_free)(void *), nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+
+/**
+  * Send a batch of messages over connection synchronously, blocking once
+  * till all of them are completed instead of once per message.
+  * It's optional for adapters to implement.
+  *
+  * @param[in] h_ptr connection handle
+  * @param[in] topic topic to which send messages
+  * @param[in] payloads array of message data
+  * @param[in] nbufs array of number of bytes of each message
+  * @param[in] keys array of '\0' terminated keys of each message, as in
+  *                 @ref nvds_msgapi_send_with_key. Array or its entries can
+  *                 be NULL.
+  * @param[in] count number of messages
+  *
+  * @return Completion status of send operation, error if any message failed
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_batch(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t **payloads, const size_t *nbufs, const char **keys, size_t count);
+
 /**
  * Calls into the adapter to allow for execution of undnerlying protocol logic.
  * As part of this routine, adapter should service outstanding incoming and
@@ -118,6 +118,35 @@ typedef enum
     NvDsInferNetworkType_Other = 100
 } NvDsInferNetworkType;
 
+/**
+ * Enum for the clustering of the objects found by a detector.
+ */
+typedef enum
+{
+    /** OpenCV groupRectangles, per class eps and groupThreshold. */
+    NvDsInferClusterMode_OpenCV,
+    /** DBSCAN, per class eps and minBoxes. Same as setting useDBScan. */
+    NvDsInferClusterMode_DBSCAN,
+    /** Built-in grouping with the results of groupRectangles, in
+     *  O(n log n) instead of O(n^2). Objects keep their confidence. */
+    NvDsInferClusterMode_Native
+} NvDsInferClusterMode;
+
+/**
+ * Enum for the activation applied by the context to the output layers of a
+ * classifier before parsing them.
+ */
+typedef enum
+{
+    /** None, the layers are probabilities, e.g. softmax layers. */
+    NvDsInferClassifierActivation_None,
+    /** Softmax over the classes of each layer, for single label layers
+     *  output as logits. */
+    NvDsInferClassifierActivation_Softmax,
+    /** Sigmoid of each class, for multi-label layers output as logits. */
+    NvDsInferClassifierActivation_Sigmoid
+} NvDsInferClassifierActivation;
+
 /**
  * Enum for color formats.
  */
@@ -274,7 +303,7 @@ typedef struct _NvDsInferContextInitParams
     NvDsInferNetworkType networkType;
 
     /** Boolean indicating if DBScan should be used for object clustering.
-     *  OpenCV groupRectangles will be used if set to false. */
+     *  clusterMode is used if set to false. */
     int useDBScan;
 
     /** Number of classes detected by a detector network. */
@@ -320,6 +349,60 @@ typedef struct _NvDsInferContextInitParams
     /** Path to the config file for custom network creation. This can be used to
      * store custom properties required by the custom network creation function. */
     char customNetworkConfigFilePath[_PATH_MAX];
+
+    /** Clustering of the objects found by a detector. DBSCAN is used if
+     *  useDBScan is set, whatever the mode. */
+    NvDsInferClusterMode clusterMode;
+
+    /** Number of threads parsing the outputs of the frames of a batch in
+     *  parallel. 0 or 1 parses them one by one in the dequeueing thread.
+     *  Custom parsing functions must be reentrant if set to more than 1. */
+    unsigned int outputParseWorkers;
+
+    /** Boolean indicating if the frame outputs of each batch should be
+     *  allocated, and the object labels duplicated, as in earlier releases.
+     *  Otherwise they are reused across the batches and the labels point to
+     *  the strings of getLabels(). Set it for clients that modify or take
+     *  ownership of the object arrays or labels. */
+    int legacyOutputAllocation;
+
+    /** Downsampling factor of the class maps of segmentation networks, 0 or 1
+     *  for maps at the resolution of the network output. Must divide the
+     *  output width and height. */
+    unsigned int segmentationMapScale;
+    /** Boolean indicating if the class maps of segmentation networks should
+     *  be output run-length encoded instead of as pixel arrays. */
+    int segmentationMapRLE;
+
+    /** Activation applied to the float output layers of a classifier before
+     *  they are parsed, for networks built without their softmax or sigmoid
+     *  layers. Custom parsing functions get the activated layers too. */
+    NvDsInferClassifierActivation classifierActivation;
+    /** Maximum number of attributes output for each output layer of a
+     *  classifier, the classes of highest confidence above
+     *  classifierThreshold, highest first. 0 or 1 outputs the best class
+     *  only; the number of classes or more outputs every class above the
+     *  threshold, e.g. for multi-label layers. Only used by the built-in
+     *  parser. */
+    unsigned int classifierTopK;
+
+    /** Directory of output tensors recorded by nvinfer (raw-output-file-write)
+     *  to serve in place of the inference, for benchmarking the output
+     *  parsing without a GPU. The model files are not used if set. */
+    char replayTensorDir[_PATH_MAX];
+    /** Array of "name:CxHxW[:float|half|int8|int32]" descriptions of the
+     *  recorded layers, the input layer first. The data type defaults to
+     *  float. */
+    char ** replayLayers;
+    unsigned int numReplayLayers;
+    /** Number of recorded batches served per second, 0 to serve them as fast
+     *  as they are queued. */
+    float replayBatchRate;
+
+    /** Array of "key=value" properties of the custom bounding box parser
+     *  instances, if the custom library defines a stateful parser. */
+    char ** customParserProperties;
+    unsigned int numCustomParserProperties;
 } NvDsInferContextInitParams;
 
 /**
@@ -367,8 +450,12 @@ typedef struct
     unsigned int height;
     /* Index for the object class. */
     int classIndex;
-    /* String label for the detected object. */
+    /* String label for the detected object. Points to the label owned by the
+     * context, unless legacyOutputAllocation is set. Must not be modified. */
     char *label;
+    /** Confidence of the object, 0 when clustered with OpenCV groupRectangles
+     *  which does not keep it. */
+    float confidence;
 } NvDsInferObject;
 
 /**
@@ -390,11 +477,14 @@ typedef struct
 typedef struct
 {
     /** Array of attributes. Maybe more than one depending on the number of
-     * output coverage layers (multi-label classifiers) */
+     * output coverage layers (multi-label classifiers) and on classifierTopK.
+     * The attributes of a layer are ordered by decreasing confidence. */
     NvDsInferAttribute *attributes;
     /** Size of the attributes array. */
     unsigned int numAttributes;
-    /** String label for the classified output. */
+    /** String label for the classified output. Like the attributes array,
+     * reused with the batch unless legacyOutputAllocation is set. Must not be
+     * modified. */
     char *label;
 } NvDsInferClassificationOutput;
 
@@ -404,18 +494,32 @@ typedef struct
  */
 typedef struct
 {
-    /** Width of the output. Same as network width. */
+    /** Width of the class map. Same as network output width divided by
+     * map_scale. */
     unsigned int width;
-    /** Height of the output. Same as network height. */
+    /** Height of the class map. Same as network output height divided by
+     * map_scale. */
     unsigned int height;
     /** Number of classes supported by the network. */
     unsigned int classes;
     /** Pointer to the array for 2D pixel class map. The output for pixel (x,y)
-     * will be at index (y * width + x). */
+     * will be at index (y * width + x). NULL if the map is run-length encoded
+     * in class_map_runs. */
     int *class_map;
     /** Pointer to the raw array containing the probabilities. The probability for
-     * class c and pixel (x,y) will be at index (c * width *height + y * width + x). */
+     * class c and pixel (x,y) of the network output will be at index
+     * (c * W * H + y * W + x) with W = width * map_scale, H = height * map_scale. */
     float *class_probability_map;
+    /** Downsampling factor of the class map: pixel (x,y) of the map is the
+     * class of pixel (x * map_scale + map_scale / 2, y * map_scale +
+     * map_scale / 2) of the network output. */
+    unsigned int map_scale;
+    /** Number of runs in class_map_runs, 0 if the map is not run-length
+     * encoded. */
+    unsigned int num_runs;
+    /** Run-length encoded class map: num_runs (class, length) pairs covering
+     * the map in row-major order. */
+    int *class_map_runs;
 } NvDsInferSegmentationOutput;
 
 /**
@@ -42,6 +42,28 @@
  * definition to validate the function definition.
  *
  *
+ * @section customparserinstance Stateful Custom Detector Output Parser
+ *
+ * A parsing function gets the output layers, the network information and the
+ * detection parameters on each call, so it has to look its layers up each
+ * time or keep them in static variables shared by all the nvinfer instances
+ * and threads. A parser can instead keep them in instances of its own, by
+ * defining, for `parse-bbox-func-name=NAME`, the three functions `NAMECreate`
+ * (`NvDsInferParserCreateFunc`), `NAMEParse` (`NvDsInferParserParseFunc`) and
+ * `NAMEDestroy` (`NvDsInferParserDestroyFunc`).
+ *
+ * If the library defines `NAMECreate`, nvinfer creates an instance for each of
+ * its output parsing threads when the model is loaded, with the layout of the
+ * output layers, the network information, the detection parameters and the
+ * properties of the `custom-parser-properties` key of the configuration file
+ * ("key=value" strings, e.g. thresholds). An instance is only used by one
+ * thread at a time and is destroyed with the context. Otherwise the `NAME`
+ * parsing function is called as described above.
+ *
+ * The macro CHECK_CUSTOM_PARSER_PROTOTYPE() can be called after the function
+ * definitions to validate them.
+ *
+ *
  * @section iplugininterface TensorRT Plugin Factory interface for DeepStream
  *
  * Based on the type of the model (Caffe or UFF), the library
@@ -102,6 +124,8 @@
 #ifndef _NVDSINFER_CUSTOM_IMPL_H_
 #define _NVDSINFER_CUSTOM_IMPL_H_
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 #include "NvCaffeParser.h"
@@ -155,6 +179,155 @@ typedef bool (* NvDsInferParseCustomFunc) (
            NvDsInferParseDetectionParams const &detectionParams, \
            std::vector<NvDsInferObjectDetectionInfo> &objectList);
 
+/**
+ * Holds the parameters of a stateful custom bounding box parser instance.
+ */
+typedef struct
+{
+  /** Output layers of the model, in the order of the layers passed to the
+   *  parse calls. Only the layout is set, the buffers are not valid. */
+  std::vector<NvDsInferLayerInfo> outputLayersInfo;
+  /** Network information. */
+  NvDsInferNetworkInfo networkInfo;
+  /** Detection parameters required for parsing objects. */
+  NvDsInferParseDetectionParams detectionParams;
+  /** Properties of the `custom-parser-properties` key of the configuration
+   *  file, as "key=value" strings. */
+  std::vector<std::string> properties;
+} NvDsInferParserInitParams;
+
+/**
+ * Instance of a stateful custom bounding box parser, defined by the library.
+ */
+typedef void * NvDsInferParserHandle;
+
+/**
+ * Function definition for the creation of a custom parser instance.
+ *
+ * @param[in]  initParams Parameters of the instance.
+ *
+ * @return Handle of the instance, NULL on error (e.g. missing output layer).
+ */
+typedef NvDsInferParserHandle (* NvDsInferParserCreateFunc) (
+        NvDsInferParserInitParams const &initParams);
+
+/**
+ * Function definition for the parsing of the output of a batch frame with a
+ * custom parser instance.
+ *
+ * @param[in]  handle Handle of the instance.
+ * @param[in]  outputLayersInfo Vector containing information on the output
+ *            layers of the model, as in the creation parameters.
+ * @param[out] objectList Reference to a vector in which the function should add
+ *             the parsed objects.
+ */
+typedef bool (* NvDsInferParserParseFunc) (NvDsInferParserHandle handle,
+        std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+/**
+ * Function definition for the destruction of a custom parser instance.
+ *
+ * @param[in]  handle Handle of the instance.
+ */
+typedef void (* NvDsInferParserDestroyFunc) (NvDsInferParserHandle handle);
+
+/**
+ * Macro to validate the definitions of the Create, Parse and Destroy functions
+ * of a stateful custom parser. Should be called after defining the functions.
+ */
+#define CHECK_CUSTOM_PARSER_PROTOTYPE(customParser) \
+    static void checkParser_ ## customParser ( \
+           NvDsInferParserCreateFunc create = customParser ## Create, \
+           NvDsInferParserParseFunc parse = customParser ## Parse, \
+           NvDsInferParserDestroyFunc destroy = customParser ## Destroy) \
+        { checkParser_ ## customParser (); }; \
+    extern "C" NvDsInferParserHandle customParser ## Create ( \
+           NvDsInferParserInitParams const &initParams); \
+    extern "C" bool customParser ## Parse (NvDsInferParserHandle handle, \
+           std::vector<NvDsInferLayerInfo> const &outputLayersInfo, \
+           std::vector<NvDsInferObjectDetectionInfo> &objectList); \
+    extern "C" void customParser ## Destroy (NvDsInferParserHandle handle);
+
+/**
+ * Returns the value of property @a key of a custom parser instance as a float,
+ * or @a defaultValue if the property is not set or is not a number.
+ */
+static inline float
+NvDsInferParserGetPropertyFloat (NvDsInferParserInitParams const &initParams,
+        const char *key, float defaultValue)
+{
+  size_t keyLength = strlen (key);
+
+  for (std::string const &property : initParams.properties) {
+    if (property.compare (0, keyLength, key) == 0 &&
+        property.size () > keyLength && property[keyLength] == '=') {
+      const char *value = property.c_str () + keyLength + 1;
+      char *end;
+      float number = strtof (value, &end);
+      return (end != value && *end == '\0') ? number : defaultValue;
+    }
+  }
+  return defaultValue;
+}
+
+/**
+ * Parameters of the previous call to a custom parsing function, see
+ * NvDsInferParserParamsChanged.
+ */
+typedef struct
+{
+  /** Output layers, without their buffers and names. */
+  std::vector<NvDsInferLayerInfo> outputLayersInfo;
+  std::vector<std::string> layerNames;
+  NvDsInferNetworkInfo networkInfo;
+  NvDsInferParseDetectionParams detectionParams;
+} NvDsInferParserCallParams;
+
+/**
+ * Returns true if the parameters of a call to a custom parsing function differ
+ * from @a cached, the parameters of the previous call, and updates @a cached.
+ * Lets a parsing function keep a parser set up once, e.g. per thread, rather
+ * than on each call. Buffers of the output layers are not compared.
+ */
+static inline bool
+NvDsInferParserParamsChanged (NvDsInferParserCallParams &cached,
+        std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams)
+{
+  bool changed = cached.outputLayersInfo.size () != outputLayersInfo.size () ||
+      cached.networkInfo.width != networkInfo.width ||
+      cached.networkInfo.height != networkInfo.height ||
+      cached.networkInfo.channels != networkInfo.channels ||
+      cached.detectionParams.numClassesConfigured !=
+          detectionParams.numClassesConfigured ||
+      cached.detectionParams.perClassThreshold !=
+          detectionParams.perClassThreshold;
+
+  for (size_t i = 0; !changed && i < outputLayersInfo.size (); i++) {
+    NvDsInferLayerInfo const &a = cached.outputLayersInfo[i];
+    NvDsInferLayerInfo const &b = outputLayersInfo[i];
+    changed = a.dataType != b.dataType || a.isInput != b.isInput ||
+        a.dims.numDims != b.dims.numDims ||
+        memcmp (a.dims.d, b.dims.d, a.dims.numDims * sizeof (a.dims.d[0])) ||
+        cached.layerNames[i] != (b.layerName ? b.layerName : "");
+  }
+
+  if (changed) {
+    cached.outputLayersInfo = outputLayersInfo;
+    cached.layerNames.clear ();
+    for (NvDsInferLayerInfo &layer : cached.outputLayersInfo) {
+      cached.layerNames.push_back (layer.layerName ? layer.layerName : "");
+      layer.buffer = nullptr;
+      layer.layerName = nullptr;
+    }
+    cached.networkInfo = networkInfo;
+    cached.detectionParams = detectionParams;
+  }
+  return changed;
+}
+
 /**
  * Function definition for the custom classifier output parsing function.
  *
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+/**
+ * @file nvdsinfer_tensor_capture.h
+ * <b>NVIDIA DeepStream Tensor Capture API </b>
+ *
+ * @b Description: This file specifies the APIs to write the bound layer
+ * tensors of the batches of a network to a capture file and to read them back.
+ *
+ * A capture file starts with a header holding the unique ID of the network and
+ * the name, data type and dimensions of each layer. It is followed by one
+ * segment per batch holding the index of its frames (PTS, source ID, frame
+ * number and object ID) and the tensors of each layer for all the frames of
+ * the batch. Segments are appended by a background thread of the writer so
+ * that capturing does not hold up the inference. The reader maps the file in
+ * memory and gives random access to the batches without copying the tensors,
+ * each of which is 64-byte aligned; a segment truncated by a crash of the
+ * writer is ignored.
+ */
+#ifndef __NVDSINFER_TENSOR_CAPTURE_H__
+#define __NVDSINFER_TENSOR_CAPTURE_H__
+
+#include <stdint.h>
+
+#include <nvdsinfer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Version of the capture file format written. */
+#define NVDSINFER_TENSOR_CAPTURE_VERSION 1
+
+/**
+ * Opaque structure for the tensor capture writer.
+ */
+struct NvDsInferTensorCaptureWriter;
+/**
+ * Tensor capture writer handle.
+ */
+typedef struct NvDsInferTensorCaptureWriter *NvDsInferTensorCaptureWriterHandle;
+
+/**
+ * Opaque structure for the tensor capture reader.
+ */
+struct NvDsInferTensorCaptureReader;
+/**
+ * Tensor capture reader handle.
+ */
+typedef struct NvDsInferTensorCaptureReader *NvDsInferTensorCaptureReaderHandle;
+
+/**
+ * Holds the index entry of one frame (or object) of a captured batch.
+ */
+typedef struct
+{
+    /** Presentation timestamp of the frame, in nanoseconds. */
+    uint64_t pts;
+    /** Tracking ID of the object inferred on, UNTRACKED_OBJECT_ID (-1) for
+     * frames. */
+    uint64_t objectId;
+    /** ID of the source of the frame. */
+    uint32_t sourceId;
+    /** Number of the frame in its source. */
+    uint32_t frameNum;
+} NvDsInferTensorCaptureFrameInfo;
+
+/**
+ * Holds the statistics of a tensor capture writer.
+ */
+typedef struct
+{
+    /** Number of batches written to the file. */
+    uint64_t writtenBatches;
+    /** Number of batches dropped because the write queue was full. */
+    uint64_t droppedBatches;
+    /** Number of batches which could not be written. */
+    uint64_t failedBatches;
+    /** Number of bytes written to the file. */
+    uint64_t writtenBytes;
+} NvDsInferTensorCaptureWriterStats;
+
+/**
+ * Create a capture file and the writer thread appending batches to it.
+ *
+ * @param[in] filePath Path of the file, truncated if it exists.
+ * @param[in] uniqueID Unique ID of the network.
+ * @param[in] layers Array of the bound layers, in binding index order. Only
+ *                   the layer descriptions are used.
+ * @param[in] numLayers Number of bound layers.
+ * @param[in] maxQueuedBatches Number of batches queued for writing beyond
+ *                             which batches are dropped, at least 1.
+ * @return Handle to the newly created writer, NULL if the file could not be
+ *         created.
+ */
+NvDsInferTensorCaptureWriterHandle NvDsInferTensorCaptureWriterCreate(
+        const char *filePath, unsigned int uniqueID,
+        const NvDsInferLayerInfo *layers, unsigned int numLayers,
+        unsigned int maxQueuedBatches);
+
+/**
+ * Queue a batch for writing. The tensors are copied, the buffers can be
+ * reused as soon as the function returns.
+ *
+ * @param[in] handle Handle to the writer.
+ * @param[in] frames Array of the index entries of the frames of the batch.
+ * @param[in] numFrames Number of frames in the batch.
+ * @param[in] layerBuffers Array of the buffers of the layers, in binding
+ *                         index order, holding the tensors of the numFrames
+ *                         frames. The tensors of a NULL buffer are written as
+ *                         zeros.
+ * @return 1 if the batch was queued, 0 if it was dropped because
+ *         maxQueuedBatches batches are already queued.
+ */
+int NvDsInferTensorCaptureWriterQueueBatch(
+        NvDsInferTensorCaptureWriterHandle handle,
+        const NvDsInferTensorCaptureFrameInfo *frames, unsigned int numFrames,
+        void * const *layerBuffers);
+
+/**
+ * Get the statistics of a writer.
+ *
+ * @param[in] handle Handle to the writer.
+ * @param[out] stats Statistics of the batches queued so far.
+ */
+void NvDsInferTensorCaptureWriterGetStats(
+        NvDsInferTensorCaptureWriterHandle handle,
+        NvDsInferTensorCaptureWriterStats *stats);
+
+/**
+ * Write the queued batches, close the file and destroy the writer.
+ *
+ * @param[in] handle Handle to the writer to be destroyed.
+ */
+void NvDsInferTensorCaptureWriterDestroy(
+        NvDsInferTensorCaptureWriterHandle handle);
+
+/**
+ * Map a capture file in memory and index its batches.
+ *
+ * @param[in] filePath Path of the file.
+ * @return Handle to the reader, NULL if the file cannot be mapped or is not a
+ *         capture file of a supported version.
+ */
+NvDsInferTensorCaptureReaderHandle NvDsInferTensorCaptureReaderOpen(
+        const char *filePath);
+
+/**
+ * Get the unique ID of the network captured.
+ *
+ * @param[in] handle Handle to the reader.
+ * @return Unique ID of the network.
+ */
+unsigned int NvDsInferTensorCaptureReaderGetUniqueID(
+        NvDsInferTensorCaptureReaderHandle handle);
+
+/**
+ * Get the descriptions of the captured layers.
+ *
+ * @param[in] handle Handle to the reader.
+ * @param[out] layers Pointer to the array of the layers, in binding index
+ *                    order, owned by the reader. The buffers are NULL.
+ * @return Number of layers.
+ */
+unsigned int NvDsInferTensorCaptureReaderGetLayers(
+        NvDsInferTensorCaptureReaderHandle handle,
+        const NvDsInferLayerInfo **layers);
+
+/**
+ * Get the number of complete batches in the file.
+ *
+ * @param[in] handle Handle to the reader.
+ * @return Number of batches.
+ */
+uint64_t NvDsInferTensorCaptureReaderGetNumBatches(
+        NvDsInferTensorCaptureReaderHandle handle);
+
+/**
+ * Get the frames and tensors of a batch.
+ *
+ * @param[in] handle Handle to the reader.
+ * @param[in] batchIndex Index of the batch, in the order written.
+ * @param[out] frames Pointer to the array of the index entries of the frames
+ *                    of the batch, in the mapped file.
+ * @param[out] layerBuffers Array of as many pointers as layers, set to the
+ *                          tensors of the layers for all the frames of the
+ *                          batch, in the mapped file.
+ * @return Number of frames of the batch, 0 if batchIndex is out of range.
+ */
+unsigned int NvDsInferTensorCaptureReaderGetBatch(
+        NvDsInferTensorCaptureReaderHandle handle, uint64_t batchIndex,
+        const NvDsInferTensorCaptureFrameInfo **frames,
+        const void **layerBuffers);
+
+/**
+ * Unmap the file and destroy the reader. The pointers into the file are no
+ * longer valid.
+ *
+ * @param[in] handle Handle to the reader to be closed.
+ */
+void NvDsInferTensorCaptureReaderClose(
+        NvDsInferTensorCaptureReaderHandle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -96,6 +96,9 @@ typedef enum {
   /** metadata type of segmentation model output attached by gst-nvinfer.
    * Refer NvDsInferSegmentationMeta for details. */
   NVDSINFER_SEGMENTATION_META,
+  /** metadata type of extra information on a payload generated by msg
+   * converter. Refer NvDsPayloadExt for details. */
+  NVDS_PAYLOAD_EXT_META,
   /** Reserved field */
   NVDS_RESERVED_META = 4095,
   /** metadata type to be set for metadata attached by nvidia gstreamer plugins
@@ -69,6 +69,8 @@ typedef enum NvDsObjectType {
 typedef enum NvDsPayloadType {
   NVDS_PAYLOAD_DEEPSTREAM,
   NVDS_PAYLOAD_DEEPSTREAM_MINIMAL,
+  /** Compact binary encoding of all event fields, refer nvmsgconv_binary.h */
+  NVDS_PAYLOAD_DEEPSTREAM_BINARY,
   /** Reserved for future use. Use value greater than this for custom payloads. */
   NVDS_PAYLOAD_RESERVED = 0x100,
   /** To support custom payload. User need to implement nvds_msg2p_* interface */
@@ -224,7 +226,8 @@ typedef struct _NvDsEvent {
  * Holds payload meta data.
  */
 typedef struct NvDsPayload {
-  /** pointer to payload */
+  /** pointer to payload. Owned by the component who attached the payload,
+   * unless @ref NVDS_PAYLOAD_FLAG_TRANSFERABLE is set for it. */
   gpointer payload;
   /** size of payload */
   guint payloadSize;
@@ -232,6 +235,34 @@ typedef struct NvDsPayload {
   guint componentId;
 } NvDsPayload;
 
+/**
+ * Flags of a payload, refer @ref NvDsPayloadExt.
+ */
+typedef enum {
+  /** payload data is allocated with g_malloc(). A consumer of the payload
+   * meta having sole access to the buffer can take the ownership of it,
+   * setting NvDsPayload::payload to NULL. */
+  NVDS_PAYLOAD_FLAG_TRANSFERABLE = 1 << 0
+} NvDsPayloadFlags;
+
+/**
+ * Holds information on a payload which doesn't fit in @ref NvDsPayload
+ * without changing its layout. Attached by msg converter as user meta of type
+ * NVDS_PAYLOAD_EXT_META to the frame carrying the NVDS_PAYLOAD_META.
+ */
+typedef struct NvDsPayloadExt {
+  /** size of this structure, fields are only appended to it */
+  guint size;
+  /** payload the information belongs to, only to be compared with. NULL in
+   * copies of the meta. */
+  const NvDsPayload *payload;
+  /** '\0' terminated key the payload can be partitioned / routed with,
+   * e.g. sensor id, allocated with g_malloc() (Optional) */
+  gchar *key;
+  /** bitwise OR of @ref NvDsPayloadFlags */
+  guint flags;
+} NvDsPayloadExt;
+
 #ifdef __cplusplus
 }
 #endif
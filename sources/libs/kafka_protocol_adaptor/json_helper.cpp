@@ -19,7 +19,10 @@
 
 #define FREE_AND_RETURN(v,p) json_decref(p); return v
 
+#define JSON_SCAN_UNKNOWN -1
+
 int json_get_key_value(const char*, int, const char*, char*, int);
+int json_find_key_value(const char*, int, const char*, char*, int);
 
 /*
    Returns 0 if key was not found in json.
@@ -93,3 +96,151 @@ int json_get_key_value(const char *msg, int msglen, const char *path, char *valu
    }
     
 }
+
+static const char *json_skip_ws(const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    p++;
+  return p;
+}
+
+/* p points to opening quote. Returns pointer past closing quote or NULL */
+static const char *json_skip_string(const char *p, const char *end, bool *escaped)
+{
+  for (p++; p < end; p++) {
+    if (*p == '\\') {
+      *escaped = true;
+      p++;
+    } else if (*p == '"') {
+      return p + 1;
+    }
+  }
+  return NULL;
+}
+
+/* Returns pointer past the value starting at p or NULL if it's malformed */
+static const char *json_skip_value(const char *p, const char *end)
+{
+  bool escaped = false;
+  int depth = 0;
+
+  if (*p == '"')
+    return json_skip_string(p, end, &escaped);
+
+  if (*p != '{' && *p != '[') {
+    /* number, true, false or null */
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+      p++;
+    return p;
+  }
+
+  for (; p < end; p++) {
+    if (*p == '"') {
+      p = json_skip_string(p, end, &escaped);
+      if (!p)
+        return NULL;
+      p--;
+    } else if (*p == '{' || *p == '[') {
+      depth++;
+    } else if (*p == '}' || *p == ']') {
+      if (--depth == 0)
+        return p + 1;
+    }
+  }
+  return NULL;
+}
+
+/*
+   Same as json_get_key_value() but scans the message in place without
+   parsing it into a tree or allocating memory.
+   Returns JSON_SCAN_UNKNOWN if it can't tell the value (malformed message or
+   escaped characters in member names / value) and the caller should fall back
+   to json_get_key_value(). Message is only validated up to the key, and the
+   first of duplicate members is used.
+ */
+int json_find_key_value(const char *msg, int msglen, const char *path, char *value, int nbuf)
+{
+  const char *p = msg;
+  const char *end = msg + msglen;
+  const char *segment = path;
+  const char *dotptr;
+  size_t segment_len;
+  bool escaped = false;
+
+  if (nbuf <= 0)
+    return JSON_SCAN_UNKNOWN;
+
+  p = json_skip_ws(p, end);
+  if (p < end && *p == '[')
+    return 0; // array of messages; no single key
+  if (p >= end || *p != '{')
+    return JSON_SCAN_UNKNOWN;
+
+  while (true) {
+    dotptr = strchr(segment, '.');
+    segment_len = dotptr ? (size_t)(dotptr - segment) : strlen(segment);
+
+    /* find member named segment in the object at p */
+    p++;
+    while (true) {
+      const char *name;
+      size_t name_len;
+
+      p = json_skip_ws(p, end);
+      if (p >= end)
+        return JSON_SCAN_UNKNOWN;
+      if (*p == '}')
+        return 0;
+      if (*p == ',') {
+        p++;
+        continue;
+      }
+      if (*p != '"')
+        return JSON_SCAN_UNKNOWN;
+
+      name = p + 1;
+      p = json_skip_string(p, end, &escaped);
+      if (!p || escaped)
+        return JSON_SCAN_UNKNOWN;
+      name_len = p - 1 - name;
+
+      p = json_skip_ws(p, end);
+      if (p >= end || *p != ':')
+        return JSON_SCAN_UNKNOWN;
+      p = json_skip_ws(p + 1, end);
+      if (p >= end)
+        return JSON_SCAN_UNKNOWN;
+
+      if (name_len == segment_len && !memcmp(name, segment, segment_len))
+        break;
+
+      p = json_skip_value(p, end);
+      if (!p)
+        return JSON_SCAN_UNKNOWN;
+    }
+
+    if (!dotptr)
+      break;
+
+    segment = dotptr + 1;
+    if (*p != '{' || !*segment)
+      return 0;
+  }
+
+  // by the time we reach here p is at the value of last level
+  if (*p != '"')
+    return 0;
+
+  const char *str = p + 1;
+  p = json_skip_string(p, end, &escaped);
+  if (!p || escaped)
+    return JSON_SCAN_UNKNOWN;
+
+  int len = p - 1 - str;
+  if (len >= nbuf)
+    len = nbuf - 1;
+  memcpy(value, str, len);
+  value[len] = '\0';
+  return len;
+}
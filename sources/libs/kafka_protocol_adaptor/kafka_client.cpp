@@ -88,28 +88,59 @@ static void dr_msg_cb (rd_kafka_t *rk,
         break;
   };
   ((NvDsKafkaSendCompl *)(rkmessage->_private))->sendcomplete(dserr);
+}
+
+/* Maximum time the sync poll thread blocks in rd_kafka_poll() at a time.
+ * The poll returns as soon as a delivery report is served, this only bounds
+ * how long the thread keeps polling once no sync send is pending.
+ */
+#define KAFKA_SYNC_POLL_TIMEOUT_MS 100
 
-  delete ((NvDsKafkaSendCompl *)(rkmessage->_private));
+/* Time to serve delivery reports of purged messages at disconnect. */
+#define KAFKA_PURGE_TIMEOUT_MS 1000
 
-}
+/* Number of async send completions preallocated per client. */
+#define KAFKA_COMPL_POOL_SIZE 1024
 
 typedef struct {
    rd_kafka_t *producer;         /* Producer instance handle */
    rd_kafka_topic_t *topic;  /* Topic object */
    rd_kafka_conf_t *conf;  /* Temporary configuration object */
    char topic_name[255];
+   GMutex compl_lock;  /* protects sync completions and the poll thread */
+   GCond compl_cond;   /* signalled on sync completion */
+   GCond poll_cond;    /* wakes up the poll thread */
+   GThread *poll_thread;  /* polls the producer while sync sends are pending */
+   gboolean poll_stop;
+   gint sync_pending;  /* number of sync senders waiting for completion */
+   gint polling;       /* poll thread is in rd_kafka_poll() */
+   NvDsKafkaComplPool *compl_pool;  /* async send completions */
 } NvDsKafkaClientHandle;
 
-NvDsKafkaSyncSendCompl::NvDsKafkaSyncSendCompl(uint8_t *cflag) {
-  compl_flag = cflag;
+NvDsKafkaSyncSendCompl::NvDsKafkaSyncSendCompl(GMutex *mutex, GCond *cv, unsigned int count) {
+  lock = mutex;
+  cond = cv;
+  pending = count;
+  err = NVDS_MSGAPI_OK;
 }
 
 /**
  * Method that gets invoked when sync send operation is completed
  */
 void NvDsKafkaSyncSendCompl::sendcomplete(NvDsMsgApiErrorType senderr) {
-  *compl_flag = 1;
-  err = senderr;
+  g_mutex_lock(lock);
+  if (err == NVDS_MSGAPI_OK)
+    err = senderr;
+  if (pending && !--pending)
+    g_cond_broadcast(cond);
+  g_mutex_unlock(lock);
+}
+
+/**
+ * Returns true once all sends are completed; called with lock held
+ */
+bool NvDsKafkaSyncSendCompl::is_done() {
+  return pending == 0;
 }
 
 
@@ -129,9 +160,11 @@ NvDsMsgApiErrorType NvDsKafkaSyncSendCompl::get_err() {
 }
 
 
-NvDsKafkaAsyncSendCompl::NvDsKafkaAsyncSendCompl(void *ctx, nvds_msgapi_send_cb_t cb) {
+void NvDsKafkaAsyncSendCompl::init(void *ctx, nvds_msgapi_send_cb_t cb, void *data, void (*data_free)(void *)) {
   user_ptr = ctx;
   async_send_cb = cb;
+  payload = data;
+  payload_free = data_free;
 }
 
 /**
@@ -141,6 +174,63 @@ void NvDsKafkaAsyncSendCompl::sendcomplete(NvDsMsgApiErrorType senderr) {
   // simply call any registered callback
   if (async_send_cb)
     async_send_cb(user_ptr, senderr);
+  // release the payload owned by the send operation
+  if (payload_free)
+    payload_free(payload);
+  pool->release(this);
+}
+
+NvDsKafkaComplPool::NvDsKafkaComplPool(unsigned int size) {
+  g_mutex_init(&lock);
+  free_list = NULL;
+  chunks = NULL;
+  num_chunks = 0;
+  chunk_size = size ? size : 1;
+  grow();
+}
+
+NvDsKafkaComplPool::~NvDsKafkaComplPool() {
+  for (unsigned int i = 0; i < num_chunks; i++)
+    delete[] chunks[i];
+  g_free(chunks);
+  g_mutex_clear(&lock);
+}
+
+/**
+ * Adds a chunk of completions to free list; called with lock held
+ */
+void NvDsKafkaComplPool::grow() {
+  NvDsKafkaAsyncSendCompl *chunk = new NvDsKafkaAsyncSendCompl[chunk_size];
+
+  chunks = (NvDsKafkaAsyncSendCompl **) g_realloc(chunks, (num_chunks + 1) * sizeof(*chunks));
+  chunks[num_chunks++] = chunk;
+
+  for (unsigned int i = 0; i < chunk_size; i++) {
+    chunk[i].pool = this;
+    chunk[i].next = free_list;
+    free_list = &chunk[i];
+  }
+}
+
+NvDsKafkaAsyncSendCompl *NvDsKafkaComplPool::acquire() {
+  NvDsKafkaAsyncSendCompl *sc;
+
+  g_mutex_lock(&lock);
+  if (!free_list) {
+    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_DEBUG, "growing send completion pool by %u\n", chunk_size);
+    grow();
+  }
+  sc = free_list;
+  free_list = sc->next;
+  g_mutex_unlock(&lock);
+  return sc;
+}
+
+void NvDsKafkaComplPool::release(NvDsKafkaAsyncSendCompl *sc) {
+  g_mutex_lock(&lock);
+  sc->next = free_list;
+  free_list = sc;
+  g_mutex_unlock(&lock);
 }
 
 /*
@@ -202,40 +292,34 @@ void *nvds_kafka_client_init(char *brokers, char *topic) {
      kh->producer = NULL;
      kh->topic = NULL;
      kh->conf = conf;
+     g_mutex_init(&kh->compl_lock);
+     g_cond_init(&kh->compl_cond);
+     g_cond_init(&kh->poll_cond);
+     kh->poll_thread = NULL;
+     kh->poll_stop = FALSE;
+     kh->sync_pending = 0;
+     kh->polling = FALSE;
+     kh->compl_pool = new NvDsKafkaComplPool(KAFKA_COMPL_POOL_SIZE);
      snprintf(kh->topic_name, sizeof(kh->topic_name), "%s",topic);
      return (void *)kh;
 }
 
-//There could be several synchronous and asychronous send operations in flight.
-//Once a send operation callback is received the course of action  depends on if it's sync or async
-// -- if it's sync then the associated completion flag should  be set
-// -- if it's asynchronous then completion callback from the user should be called along with context
-NvDsMsgApiErrorType nvds_kafka_client_send(void *kv,  const uint8_t *payload, int len, int sync, void *ctx, nvds_msgapi_send_cb_t cb, char *key, int keylen)
+/**
+ * Enqueues the message for sending; completion is notified to scd from the
+ * delivery report callback if message is enqueued successfully.
+ * Payload is copied with RD_KAFKA_MSG_F_COPY, otherwise it has to stay valid
+ * till the completion.
+ */
+static NvDsMsgApiErrorType kafka_client_produce(NvDsKafkaClientHandle *kh, const uint8_t *payload, int len, \
+                                                char *key, int keylen, int msgflags, NvDsKafkaSendCompl *scd)
 {
-  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
-  uint8_t done = 0;
-
-  NvDsKafkaSendCompl *scd;
-  if (sync) {
-    NvDsKafkaSyncSendCompl *sc= new NvDsKafkaSyncSendCompl(&done);
-    scd = sc;
-  } else {
-    NvDsKafkaAsyncSendCompl *sc= new NvDsKafkaAsyncSendCompl(ctx, cb);
-    scd = sc;
-  }
-
-  if (!kh) {
-    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "send called on NULL handle \n");
-    return NVDS_MSGAPI_ERR;
-  }
-
   if (rd_kafka_produce(
           /* Topic object */
           kh->topic,
           /* Use builtin partitioner to select partition*/
           RD_KAFKA_PARTITION_UA,
-          /* Make a copy of the payload. */
-          RD_KAFKA_MSG_F_COPY,
+          /* Copy the payload if needed. */
+          msgflags,
           /* Message payload (value) and length */
           (void *)payload, len,
           /* Optional key and its length */
@@ -265,26 +349,150 @@ NvDsMsgApiErrorType nvds_kafka_client_send(void *kv,  const uint8_t *payload, in
            /**
              * Failed to *enqueue* message for producing.
              */
-          nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR,"Failed to schedule kafka send: %s on topic <%s>\n", rd_kafka_err2str(rd_kafka_last_error()), rd_kafka_topic_name(kh->topic));			 
+          nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR,"Failed to schedule kafka send: %s on topic <%s>\n", rd_kafka_err2str(rd_kafka_last_error()), rd_kafka_topic_name(kh->topic));
        }
        return NVDS_MSGAPI_ERR;
+  }
+  return NVDS_MSGAPI_OK;
+}
 
-     }
-     else
-     {
-       NvDsMsgApiErrorType err;
-       if  (!sync)
-          return NVDS_MSGAPI_OK;
-       else
-       {
-          while (sync && !done) {
-            usleep(1000);
-            rd_kafka_poll(kh->producer, 0/*non-blocking*/);
-          }
-          err = (scd)->get_err();
-	  return err;
-        }
-     }
+/**
+ * Serves delivery reports while sync sends are pending, so that sync
+ * senders only wait for their completion to be signalled. nvds_kafka_client_poll
+ * leaves the producer to this thread meanwhile.
+ */
+static gpointer kafka_client_poll_thread(gpointer data)
+{
+  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)data;
+
+  g_mutex_lock(&kh->compl_lock);
+  while (!kh->poll_stop) {
+    if (!kh->sync_pending) {
+      g_cond_wait(&kh->poll_cond, &kh->compl_lock);
+      continue;
+    }
+    g_atomic_int_set(&kh->polling, TRUE);
+    g_mutex_unlock(&kh->compl_lock);
+
+    rd_kafka_poll(kh->producer, KAFKA_SYNC_POLL_TIMEOUT_MS);
+
+    g_mutex_lock(&kh->compl_lock);
+    g_atomic_int_set(&kh->polling, FALSE);
+  }
+  g_mutex_unlock(&kh->compl_lock);
+  return NULL;
+}
+
+/**
+ * Blocks till the sync send(s) are completed. Delivery reports are served
+ * by the poll thread, started on first sync send.
+ */
+static NvDsMsgApiErrorType kafka_client_wait(NvDsKafkaClientHandle *kh, NvDsKafkaSyncSendCompl *sc)
+{
+  NvDsMsgApiErrorType err;
+
+  g_mutex_lock(&kh->compl_lock);
+  if (!kh->poll_thread)
+    kh->poll_thread = g_thread_new("kafka_sync_poll", kafka_client_poll_thread, kh);
+  g_atomic_int_inc(&kh->sync_pending);
+  g_cond_signal(&kh->poll_cond);
+
+  while (!sc->is_done())
+    g_cond_wait(&kh->compl_cond, &kh->compl_lock);
+
+  g_atomic_int_add(&kh->sync_pending, -1);
+  err = sc->get_err();
+  g_mutex_unlock(&kh->compl_lock);
+  return err;
+}
+
+//There could be several synchronous and asychronous send operations in flight.
+//Once a send operation callback is received the course of action  depends on if it's sync or async
+// -- if it's sync then the associated completion is signalled
+// -- if it's asynchronous then completion callback from the user should be called along with context
+NvDsMsgApiErrorType nvds_kafka_client_send(void *kv,  const uint8_t *payload, int len, int sync, void *ctx, nvds_msgapi_send_cb_t cb, char *key, int keylen)
+{
+  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
+
+  if (!kh) {
+    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "send called on NULL handle \n");
+    return NVDS_MSGAPI_ERR;
+  }
+
+  if (sync) {
+    NvDsKafkaSyncSendCompl sc(&kh->compl_lock, &kh->compl_cond);
+
+    /* payload stays valid till the completion, no need to copy it */
+    if (kafka_client_produce(kh, payload, len, key, keylen, 0, &sc) != NVDS_MSGAPI_OK)
+      return NVDS_MSGAPI_ERR;
+    return kafka_client_wait(kh, &sc);
+  } else {
+    NvDsKafkaAsyncSendCompl *sc = kh->compl_pool->acquire();
+    sc->init(ctx, cb, NULL, NULL);
+
+    if (kafka_client_produce(kh, payload, len, key, keylen, RD_KAFKA_MSG_F_COPY, sc) != NVDS_MSGAPI_OK) {
+      kh->compl_pool->release(sc);
+      return NVDS_MSGAPI_ERR;
+    }
+    return NVDS_MSGAPI_OK;
+  }
+}
+
+/**
+ * Sends asynchronously without copying the payload. Ownership of payload is
+ * transferred to the client if message is enqueued successfully; it's freed
+ * with payload_free once the send is completed, after calling cb.
+ * On error the payload is still owned by the caller.
+ */
+NvDsMsgApiErrorType nvds_kafka_client_send_nocopy(void *kv, uint8_t *payload, int len, void (*payload_free)(void *), \
+                                                  void *ctx, nvds_msgapi_send_cb_t cb, char *key, int keylen)
+{
+  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
+
+  if (!kh) {
+    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "send called on NULL handle \n");
+    return NVDS_MSGAPI_ERR;
+  }
+
+  NvDsKafkaAsyncSendCompl *sc = kh->compl_pool->acquire();
+  sc->init(ctx, cb, payload, payload_free);
+
+  if (kafka_client_produce(kh, payload, len, key, keylen, 0, sc) != NVDS_MSGAPI_OK) {
+    kh->compl_pool->release(sc);
+    return NVDS_MSGAPI_ERR;
+  }
+  return NVDS_MSGAPI_OK;
+}
+
+/**
+ * Sends count messages synchronously, blocking once till all of them are
+ * completed. keys / keylens can be NULL, as well as individual keys.
+ * Returns error if any of the messages failed.
+ */
+NvDsMsgApiErrorType nvds_kafka_client_send_batch(void *kv, const uint8_t **payloads, const int *lens, char **keys, const int *keylens, int count)
+{
+  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
+
+  if (!kh) {
+    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "send batch called on NULL handle \n");
+    return NVDS_MSGAPI_ERR;
+  }
+
+  if (count <= 0)
+    return NVDS_MSGAPI_OK;
+
+  NvDsKafkaSyncSendCompl sc(&kh->compl_lock, &kh->compl_cond, count);
+
+  for (int i = 0; i < count; i++) {
+    char *key = keys ? keys[i] : NULL;
+    int keylen = (key && keylens) ? keylens[i] : 0;
+
+    /* completion of messages that couldn't be enqueued is marked here */
+    if (kafka_client_produce(kh, payloads[i], lens[i], key, keylen, 0, &sc) != NVDS_MSGAPI_OK)
+      sc.sendcomplete(NVDS_MSGAPI_ERR);
+  }
+
+  return kafka_client_wait(kh, &sc);
 }
 
 NvDsMsgApiErrorType nvds_kafka_client_setconf(void *kv, char *key, char *val)
@@ -351,8 +559,23 @@ void nvds_kafka_client_finish(void *kv)
     nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "finish called on NULL handle\n");
     return;
   }
-    
-  rd_kafka_flush (kh->producer, 10000);
+
+  if (kh->poll_thread) {
+    g_mutex_lock(&kh->compl_lock);
+    kh->poll_stop = TRUE;
+    g_cond_signal(&kh->poll_cond);
+    g_mutex_unlock(&kh->compl_lock);
+    g_thread_join(kh->poll_thread);
+    kh->poll_thread = NULL;
+  }
+
+  if (rd_kafka_flush (kh->producer, 10000) != RD_KAFKA_RESP_ERR_NO_ERROR) {
+    /* complete messages not delivered in time with an error, so that
+     * callbacks are called and payloads owned by the client are released */
+    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "kafka flush timed out, purging undelivered messages\n");
+    rd_kafka_purge (kh->producer, RD_KAFKA_PURGE_F_QUEUE | RD_KAFKA_PURGE_F_INFLIGHT);
+    rd_kafka_flush (kh->producer, KAFKA_PURGE_TIMEOUT_MS);
+  }
 
   /* Destroy topic object */
   rd_kafka_topic_destroy(kh->topic);
@@ -360,11 +583,18 @@ void nvds_kafka_client_finish(void *kv)
   /* Destroy the producer instance */
   rd_kafka_destroy( kh->producer );
 
+  delete kh->compl_pool;
+  kh->compl_pool = NULL;
+  g_mutex_clear(&kh->compl_lock);
+  g_cond_clear(&kh->compl_cond);
+  g_cond_clear(&kh->poll_cond);
+
 }
 
 void nvds_kafka_client_poll(void *kv)
 {
   NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
-  if (kh)
+  /* producer is polled by the sync poll thread while sync sends are pending */
+  if (kh && !g_atomic_int_get(&kh->sync_pending) && !g_atomic_int_get(&kh->polling))
     rd_kafka_poll(kh->producer, 0/*non-blocking*/);
 }
@@ -9,8 +9,14 @@
  *
  */
 
+#include <glib.h>
 #include "nvds_msgapi.h"
 
+/**
+ * Completion of send operation(s), invoked from the delivery report callback.
+ * The object must not be accessed after sendcomplete() as it may get
+ * released by it or by the waiting thread.
+ */
 class NvDsKafkaSendCompl {
  public:
   virtual void sendcomplete(NvDsMsgApiErrorType);
@@ -18,30 +24,73 @@ class NvDsKafkaSendCompl {
   virtual ~NvDsKafkaSendCompl() = default;
 };
 
+/**
+ * Completion of @a count synchronous sends, signalled on @a cond once all of
+ * them are completed. Error is the first error reported, if any.
+ */
 class NvDsKafkaSyncSendCompl: public NvDsKafkaSendCompl {
  private:
-  uint8_t *compl_flag;
+  GMutex *lock;
+  GCond *cond;
+  unsigned int pending;
   NvDsMsgApiErrorType err;
 
  public:
-  NvDsKafkaSyncSendCompl(uint8_t *);
+  NvDsKafkaSyncSendCompl(GMutex *, GCond *, unsigned int count = 1);
   void sendcomplete(NvDsMsgApiErrorType);
   NvDsMsgApiErrorType get_err();
+  bool is_done();
 };
 
+class NvDsKafkaComplPool;
+
+/**
+ * Completion of asynchronous send. Objects are taken from and returned to
+ * NvDsKafkaComplPool. If the payload is owned by the send operation it's
+ * released with payload_free once the send is completed.
+ */
 class NvDsKafkaAsyncSendCompl: public NvDsKafkaSendCompl {
  private:
   void *user_ptr;
   nvds_msgapi_send_cb_t async_send_cb;
+  void *payload;
+  void (*payload_free)(void *);
+  NvDsKafkaComplPool *pool;
+  NvDsKafkaAsyncSendCompl *next;
+
+  friend class NvDsKafkaComplPool;
 
  public:
-  NvDsKafkaAsyncSendCompl(void *ctx, nvds_msgapi_send_cb_t cb);
+  void init(void *ctx, nvds_msgapi_send_cb_t cb, void *data, void (*data_free)(void *));
   void sendcomplete(NvDsMsgApiErrorType);
 };
 
+/**
+ * Preallocated pool of async send completions, grows in chunks of the
+ * initial size if all of them are in use.
+ */
+class NvDsKafkaComplPool {
+ private:
+  GMutex lock;
+  NvDsKafkaAsyncSendCompl *free_list;
+  NvDsKafkaAsyncSendCompl **chunks;
+  unsigned int num_chunks;
+  unsigned int chunk_size;
+
+  void grow();
+
+ public:
+  NvDsKafkaComplPool(unsigned int size);
+  ~NvDsKafkaComplPool();
+  NvDsKafkaAsyncSendCompl *acquire();
+  void release(NvDsKafkaAsyncSendCompl *);
+};
+
 void *nvds_kafka_client_init(char *brokers, char *topic);
 NvDsMsgApiErrorType nvds_kafka_client_launch(void *kh);
 NvDsMsgApiErrorType nvds_kafka_client_send(void *kh, const uint8_t *payload, int len, int sync, void *ctx, nvds_msgapi_send_cb_t cb,  char *key, int keylen);
+NvDsMsgApiErrorType nvds_kafka_client_send_nocopy(void *kh, uint8_t *payload, int len, void (*payload_free)(void *), void *ctx, nvds_msgapi_send_cb_t cb,  char *key, int keylen);
+NvDsMsgApiErrorType nvds_kafka_client_send_batch(void *kh, const uint8_t **payloads, const int *lens, char **keys, const int *keylens, int count);
 NvDsMsgApiErrorType nvds_kafka_client_setconf(void *kh, char *key, char *val);
 void nvds_kafka_client_poll(void *kv);
 void nvds_kafka_client_finish(void *kv);
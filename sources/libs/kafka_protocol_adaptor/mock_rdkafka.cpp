@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/**
+ * Stand-in for the librdkafka producer APIs used by kafka_client.cpp, to
+ * measure the adaptor without a kafka broker. Linked instead of -lrdkafka by
+ * the test programs.
+ *
+ * Messages are "delivered" after a fixed latency and their delivery reports
+ * are served from rd_kafka_poll() / rd_kafka_flush() as librdkafka does.
+ * rd_kafka_purge() fails all messages in flight.
+ * Supported settings (rd_kafka_conf_set):
+ *   mock.delivery.latency.us       - delivery latency in microseconds
+ *   queue.buffering.max.messages   - max messages in flight before
+ *                                    RD_KAFKA_RESP_ERR__QUEUE_FULL
+ * Other settings are accepted and ignored.
+ * Message bookkeeping is recycled so that the mock doesn't allocate memory per
+ * message except to copy payload / key, to let tests count allocations of the
+ * adaptor.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "rdkafka.h"
+
+#define MOCK_DEFAULT_QUEUE_MAX 100000
+
+struct rd_kafka_conf_s {
+  void (*dr_msg_cb) (rd_kafka_t *rk, const rd_kafka_message_t *rkmessage, void *opaque);
+  gint64 latency_us;
+  size_t queue_max;
+};
+
+struct rd_kafka_topic_s {
+  rd_kafka_t *rk;
+  char *name;
+};
+
+typedef struct MockMessage {
+  rd_kafka_message_t msg;
+  gint64 due_time;
+  gboolean free_payload;
+  struct MockMessage *next;
+} MockMessage;
+
+struct rd_kafka_s {
+  rd_kafka_conf_s conf;
+  GMutex lock;
+  GCond cond;
+  /* messages in flight in order of delivery */
+  MockMessage *head;
+  MockMessage *tail;
+  size_t queued;
+  /* recycled messages */
+  MockMessage *free_list;
+};
+
+static void mock_release_message(MockMessage *m)
+{
+  if (m->free_payload)
+    free(m->msg.payload);
+  free(m->msg.key);
+}
+
+static __thread rd_kafka_resp_err_t mock_last_error = RD_KAFKA_RESP_ERR_NO_ERROR;
+
+rd_kafka_conf_t *rd_kafka_conf_new(void)
+{
+  rd_kafka_conf_t *conf = (rd_kafka_conf_t *) calloc(1, sizeof(rd_kafka_conf_t));
+  conf->queue_max = MOCK_DEFAULT_QUEUE_MAX;
+  return conf;
+}
+
+void rd_kafka_conf_destroy(rd_kafka_conf_t *conf)
+{
+  free(conf);
+}
+
+rd_kafka_conf_res_t rd_kafka_conf_set(rd_kafka_conf_t *conf, const char *name,
+    const char *value, char *errstr, size_t errstr_size)
+{
+  if (!strcmp(name, "mock.delivery.latency.us"))
+    conf->latency_us = atoll(value);
+  else if (!strcmp(name, "queue.buffering.max.messages"))
+    conf->queue_max = atoll(value);
+  return RD_KAFKA_CONF_OK;
+}
+
+void rd_kafka_conf_set_dr_msg_cb(rd_kafka_conf_t *conf,
+    void (*dr_msg_cb) (rd_kafka_t *rk, const rd_kafka_message_t *rkmessage, void *opaque))
+{
+  conf->dr_msg_cb = dr_msg_cb;
+}
+
+rd_kafka_t *rd_kafka_new(rd_kafka_type_t type, rd_kafka_conf_t *conf,
+    char *errstr, size_t errstr_size)
+{
+  rd_kafka_t *rk = (rd_kafka_t *) calloc(1, sizeof(rd_kafka_t));
+
+  rk->conf = *conf;
+  g_mutex_init(&rk->lock);
+  g_cond_init(&rk->cond);
+  /* takes ownership of conf as librdkafka does */
+  rd_kafka_conf_destroy(conf);
+  return rk;
+}
+
+void rd_kafka_destroy(rd_kafka_t *rk)
+{
+  MockMessage *m, *next;
+
+  for (m = rk->head; m; m = next) {
+    next = m->next;
+    mock_release_message(m);
+    free(m);
+  }
+  for (m = rk->free_list; m; m = next) {
+    next = m->next;
+    free(m);
+  }
+  g_mutex_clear(&rk->lock);
+  g_cond_clear(&rk->cond);
+  free(rk);
+}
+
+rd_kafka_topic_t *rd_kafka_topic_new(rd_kafka_t *rk, const char *topic,
+    rd_kafka_topic_conf_t *conf)
+{
+  rd_kafka_topic_t *rkt = (rd_kafka_topic_t *) calloc(1, sizeof(rd_kafka_topic_t));
+  rkt->rk = rk;
+  rkt->name = strdup(topic);
+  return rkt;
+}
+
+void rd_kafka_topic_destroy(rd_kafka_topic_t *rkt)
+{
+  free(rkt->name);
+  free(rkt);
+}
+
+const char *rd_kafka_topic_name(const rd_kafka_topic_t *rkt)
+{
+  return rkt->name;
+}
+
+int rd_kafka_produce(rd_kafka_topic_t *rkt, int32_t partition, int msgflags,
+    void *payload, size_t len, const void *key, size_t keylen, void *msg_opaque)
+{
+  rd_kafka_t *rk = rkt->rk;
+  MockMessage *m;
+
+  g_mutex_lock(&rk->lock);
+  if (rk->queued >= rk->conf.queue_max) {
+    g_mutex_unlock(&rk->lock);
+    mock_last_error = RD_KAFKA_RESP_ERR__QUEUE_FULL;
+    return -1;
+  }
+  m = rk->free_list;
+  if (m)
+    rk->free_list = m->next;
+  g_mutex_unlock(&rk->lock);
+
+  if (!m)
+    m = (MockMessage *) malloc(sizeof(MockMessage));
+  memset(m, 0, sizeof(*m));
+  m->msg.rkt = rkt;
+  m->msg.partition = 0;
+  m->msg.len = len;
+  m->msg._private = msg_opaque;
+
+  if (msgflags & RD_KAFKA_MSG_F_COPY) {
+    m->msg.payload = malloc(len);
+    memcpy(m->msg.payload, payload, len);
+    m->free_payload = TRUE;
+  } else {
+    m->msg.payload = payload;
+    m->free_payload = (msgflags & RD_KAFKA_MSG_F_FREE) != 0;
+  }
+  if (key) {
+    m->msg.key = malloc(keylen);
+    memcpy(m->msg.key, key, keylen);
+    m->msg.key_len = keylen;
+  }
+
+  g_mutex_lock(&rk->lock);
+  m->due_time = g_get_monotonic_time() + rk->conf.latency_us;
+  if (rk->tail)
+    rk->tail->next = m;
+  else
+    rk->head = m;
+  rk->tail = m;
+  rk->queued++;
+  g_cond_broadcast(&rk->cond);
+  g_mutex_unlock(&rk->lock);
+
+  mock_last_error = RD_KAFKA_RESP_ERR_NO_ERROR;
+  return 0;
+}
+
+int rd_kafka_poll(rd_kafka_t *rk, int timeout_ms)
+{
+  MockMessage *delivered = NULL, *last = NULL, *m;
+  gint64 end_time = g_get_monotonic_time() + (gint64) timeout_ms * 1000;
+  int count = 0;
+
+  g_mutex_lock(&rk->lock);
+  while (true) {
+    gint64 now = g_get_monotonic_time();
+
+    /* detach messages due for delivery */
+    while (rk->head && rk->head->due_time <= now) {
+      m = rk->head;
+      rk->head = m->next;
+      if (!rk->head)
+        rk->tail = NULL;
+      rk->queued--;
+      m->next = NULL;
+      if (last)
+        last->next = m;
+      else
+        delivered = m;
+      last = m;
+      count++;
+    }
+    if (delivered || timeout_ms == 0 || now >= end_time)
+      break;
+
+    gint64 wake_time = end_time;
+    if (rk->head && rk->head->due_time < wake_time)
+      wake_time = rk->head->due_time;
+    g_cond_wait_until(&rk->cond, &rk->lock, wake_time);
+  }
+  g_mutex_unlock(&rk->lock);
+
+  for (m = delivered; m; m = m->next) {
+    if (rk->conf.dr_msg_cb)
+      rk->conf.dr_msg_cb(rk, &m->msg, NULL);
+    mock_release_message(m);
+  }
+
+  if (delivered) {
+    g_mutex_lock(&rk->lock);
+    last->next = rk->free_list;
+    rk->free_list = delivered;
+    g_mutex_unlock(&rk->lock);
+  }
+  return count;
+}
+
+rd_kafka_resp_err_t rd_kafka_flush(rd_kafka_t *rk, int timeout_ms)
+{
+  gint64 end_time = g_get_monotonic_time() + (gint64) timeout_ms * 1000;
+
+  while (true) {
+    g_mutex_lock(&rk->lock);
+    bool empty = rk->queued == 0;
+    g_mutex_unlock(&rk->lock);
+
+    if (empty)
+      return RD_KAFKA_RESP_ERR_NO_ERROR;
+    if (g_get_monotonic_time() >= end_time)
+      return RD_KAFKA_RESP_ERR__TIMED_OUT;
+    rd_kafka_poll(rk, 10);
+  }
+}
+
+rd_kafka_resp_err_t rd_kafka_purge(rd_kafka_t *rk, int purge_flags)
+{
+  MockMessage *m;
+
+  /* purged messages are reported failed on next poll */
+  g_mutex_lock(&rk->lock);
+  for (m = rk->head; m; m = m->next) {
+    m->msg.err = RD_KAFKA_RESP_ERR__PURGE_QUEUE;
+    m->due_time = 0;
+  }
+  g_cond_broadcast(&rk->cond);
+  g_mutex_unlock(&rk->lock);
+  return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+const char *rd_kafka_err2str(rd_kafka_resp_err_t err)
+{
+  switch (err) {
+    case RD_KAFKA_RESP_ERR_NO_ERROR:
+      return "Success";
+    case RD_KAFKA_RESP_ERR__QUEUE_FULL:
+      return "Local: Queue full";
+    case RD_KAFKA_RESP_ERR__TIMED_OUT:
+      return "Local: Timed out";
+    case RD_KAFKA_RESP_ERR__PURGE_QUEUE:
+      return "Local: Purged in queue";
+    default:
+      return "Mock: error";
+  }
+}
+
+rd_kafka_resp_err_t rd_kafka_last_error(void)
+{
+  return mock_last_error;
+}
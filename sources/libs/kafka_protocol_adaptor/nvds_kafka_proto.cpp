@@ -28,6 +28,7 @@
 
 
 #define MAX_FIELD_LEN 255 //maximum topic length supported by kafka is 255
+#define KAFKA_KEY_LEN 100 //maximum length of partition key looked up in payload
 
 #define NVDS_MSGAPI_VERSION "1.0"
 
@@ -37,11 +38,15 @@
 
 
 int json_get_key_value(const char *msg, int msglen, const char *key, char *value, int nbuf);
+int json_find_key_value(const char *msg, int msglen, const char *key, char *value, int nbuf);
 
 typedef struct {
   void *kh;
   char topic[MAX_FIELD_LEN];
   char partition_key_field[MAX_FIELD_LEN];
+  /* partition-key is set in config file, it then takes precedence over
+   * the key provided by the caller */
+  int partition_key_set;
 } NvDsKafkaProtoConn;
 
 /**
@@ -327,83 +332,168 @@ NvDsMsgApiHandle nvds_msgapi_connect(char *connection_str,  nvds_msgapi_connect_
   }
   strncpy(conn_ptr->topic, btopic, MAX_FIELD_LEN);
 
-  /* set key field name to default value of sensor.id */
-  strncpy(conn_ptr->partition_key_field, "sensor.id", sizeof(conn_ptr->partition_key_field));
-
+  conn_ptr->partition_key_field[0] = '\0';
   if (config_path)
     nvds_kafka_read_config(conn_ptr->kh, config_path, conn_ptr->partition_key_field, \
                         sizeof(conn_ptr->partition_key_field));
 
+  /* set key field name to default value of sensor.id if not in config */
+  conn_ptr->partition_key_set = conn_ptr->partition_key_field[0] != '\0';
+  if (!conn_ptr->partition_key_set)
+    strncpy(conn_ptr->partition_key_field, "sensor.id", sizeof(conn_ptr->partition_key_field));
+
   nvds_kafka_client_launch(conn_ptr->kh);
 
   return (NvDsMsgApiHandle)(conn_ptr);
 }
 
+/**
+ * Looks up the partition key in the json payload based on the key field
+ * from config. Scans the payload in place and only parses the payload
+ * if scanner can't tell the key value.
+ * Returns length of the key or 0 if key was not found.
+ */
+static int kafka_get_partition_key(NvDsKafkaProtoConn *conn, const uint8_t *payload, size_t nbuf, char *idval, int idlen)
+{
+  int retval;
+
+  retval = json_find_key_value((const char *)payload, nbuf, conn->partition_key_field, idval, idlen);
+  if (retval < 0)
+    retval = json_get_key_value((const char *)payload, nbuf, conn->partition_key_field, idval, idlen);
+
+  return retval;
+}
+
 //There could be several synchronous and asychronous send operations in flight.
 //Once a send operation callback is received the course of action  depends on if it's synch or async
 // -- if it's sync then the associated complletion flag should  be set
 // -- if it's asynchronous then completion callback from the user should be called
-NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf)
+// -- if payload_free is set then payload is sent without copy and released
+//    with it once send is completed (async only)
+static NvDsMsgApiErrorType kafka_proto_send(const char *fn, NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, \
+                     const char *key, size_t keylen, int sync, nvds_msgapi_send_cb_t send_callback, void *user_ptr, \
+                     void (*payload_free)(void *) = NULL)
 {
-  char idval[100];
+  NvDsKafkaProtoConn *conn = (NvDsKafkaProtoConn *) h_ptr;
+  char idval[KAFKA_KEY_LEN];
   int retval;
 
   nvds_log(NVDS_KAFKA_LOG_CAT, LOG_DEBUG, \
-    "nvds_msgapi_send: payload=%.*s, \n topic = %s, h->topic = %s\n"\
-           , nbuf, payload, topic, (((NvDsKafkaProtoConn *) h_ptr)->topic));
+    "%s: payload=%.*s, \n topic = %s, h->topic = %s\n"\
+           , fn, nbuf, payload, topic, conn->topic);
 
-  if (strcmp(topic, (((NvDsKafkaProtoConn *) h_ptr)->topic))) {
-     nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "nvds_msgapi_send: send topic has \
-                                             to match topic defined at connect.\n");
+  if (strcmp(topic, conn->topic)) {
+     nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "%s: send topic has \
+                                             to match topic defined at connect.\n", fn);
      return NVDS_MSGAPI_ERR;
   }
 
-  // parition key retrieved from config file
-  char *partition_key_field = ((NvDsKafkaProtoConn *) h_ptr)->partition_key_field;
-  retval = json_get_key_value((const char *)payload, nbuf, partition_key_field , idval, sizeof(idval));
+  if (!key || conn->partition_key_set) {
+    // parition key retrieved from config file
+    retval = kafka_get_partition_key(conn, payload, nbuf, idval, sizeof(idval));
 
-
-  if (retval)
-    return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 1, NULL, NULL, idval, strlen(idval));
-  else {
-      nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "nvds_msgapi_send: \
+    if (retval) {
+      key = idval;
+      keylen = strlen(idval);
+    } else {
+      nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "%s: \
                   no matching json field found based on kafka key config; \
-                  using default partition\n");
-
-       return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 1, NULL, NULL, NULL, 0);
+                  using default partition\n", fn);
+      key = NULL;
+      keylen = 0;
+    }
   }
+
+  if (payload_free)
+    return nvds_kafka_client_send_nocopy(conn->kh, (uint8_t *)payload, nbuf, payload_free, user_ptr, send_callback, \
+                                         (char *)key, keylen);
+  return nvds_kafka_client_send(conn->kh, payload, nbuf, sync, user_ptr, send_callback, (char *)key, keylen);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf)
+{
+  return kafka_proto_send(__func__, h_ptr, topic, payload, nbuf, NULL, 0, 1, NULL, NULL);
 }
 
 NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf,  nvds_msgapi_send_cb_t send_callback, void *user_ptr)
 {
-  char idval[100];
-  int retval;
+  return kafka_proto_send(__func__, h_ptr, topic, payload, nbuf, NULL, 0, 0, send_callback, user_ptr);
+}
 
-  nvds_log(NVDS_KAFKA_LOG_CAT, LOG_DEBUG, "nvds_msgapi_send_async: payload=%.*s, \
-      \n topic = %s, h->topic = %s\n", nbuf, payload, topic, \
-       (((NvDsKafkaProtoConn *) h_ptr)->topic));
+/**
+ * Sends with the key provided by caller instead of looking it up in payload,
+ * unless partition-key is set in config file.
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen)
+{
+  return kafka_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, 1, NULL, NULL);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, \
+                     const char *key, size_t keylen, nvds_msgapi_send_cb_t send_callback, void *user_ptr)
+{
+  return kafka_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, 0, send_callback, user_ptr);
+}
 
-  if (strcmp(topic, (((NvDsKafkaProtoConn *) h_ptr)->topic))) {
-     nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "nvds_msgapi_send_async: \
+/**
+ * Sends asynchronously taking ownership of the payload instead of copying it.
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_async_nocopy(NvDsMsgApiHandle h_ptr, char *topic, uint8_t *payload, size_t nbuf, \
+                     const char *key, size_t keylen, void (*payload_free)(void *), nvds_msgapi_send_cb_t send_callback, \
+                     void *user_ptr)
+{
+  if (!payload_free) {
+    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "nvds_msgapi_send_async_nocopy: payload_free is NULL\n");
+    return NVDS_MSGAPI_ERR;
+  }
+  return kafka_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, 0, send_callback, user_ptr, payload_free);
+}
+
+/**
+ * Sends the messages synchronously, blocking once for all of them.
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_batch(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t **payloads, const size_t *nbufs, \
+                     const char **keys, size_t count)
+{
+  NvDsKafkaProtoConn *conn = (NvDsKafkaProtoConn *) h_ptr;
+  NvDsMsgApiErrorType err;
+
+  nvds_log(NVDS_KAFKA_LOG_CAT, LOG_DEBUG, "nvds_msgapi_send_batch: %zu messages, \
+      topic = %s, h->topic = %s\n", count, topic, conn->topic);
+
+  if (strcmp(topic, conn->topic)) {
+     nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "nvds_msgapi_send_batch: \
         send topic has to match topic defined at connect.\n");
      return NVDS_MSGAPI_ERR;
   }
 
-  // parition key retrieved from config file
-  char *partition_key_field = ((NvDsKafkaProtoConn *) h_ptr)->partition_key_field;
-  retval = json_get_key_value((const char *)payload, nbuf, partition_key_field , idval, sizeof(idval));
-
-  if (retval)
-    return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 0, user_ptr, \
-             send_callback, idval, strlen(idval));
-  else {
-    nvds_log(NVDS_KAFKA_LOG_CAT, LOG_ERR, "no matching json field found \
-        based on kafka key config; using default partition\n");
-    return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 0, user_ptr, \
-                  send_callback, NULL, 0);
+  if (!count)
+    return NVDS_MSGAPI_OK;
 
+  int *lens = (int *)malloc(count * 2 * sizeof(int));
+  int *keylens = lens + count;
+  char **msgkeys = (char **)malloc(count * sizeof(char *));
+  char *idvals = (char *)malloc(count * KAFKA_KEY_LEN);
+
+  for (size_t i = 0; i < count; i++) {
+    lens[i] = nbufs[i];
+    if (keys && keys[i] && !conn->partition_key_set) {
+      msgkeys[i] = (char *)keys[i];
+      keylens[i] = strlen(keys[i]);
+    } else {
+      msgkeys[i] = idvals + i * KAFKA_KEY_LEN;
+      keylens[i] = kafka_get_partition_key(conn, payloads[i], nbufs[i], msgkeys[i], KAFKA_KEY_LEN);
+      if (!keylens[i])
+        msgkeys[i] = NULL;
+    }
   }
 
+  err = nvds_kafka_client_send_batch(conn->kh, payloads, lens, msgkeys, keylens, count);
+
+  free(idvals);
+  free(msgkeys);
+  free(lens);
+  return err;
 }
 
 void nvds_msgapi_do_work(NvDsMsgApiHandle h_ptr)
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Counts memory allocations per message made by the kafka client for
+ * async sends with copy, async sends without copy and sync sends, using the
+ * stand-in producer in mock_rdkafka.cpp. Sends without copy and sync sends
+ * are expected not to allocate, sends with copy to allocate only the copy.
+ * Also checks that payloads sent without copy and not delivered when the
+ * client finishes are released.
+ *
+ * Usage: test_kafka_alloc_count [messages]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "nvds_logger.h"
+#include "kafka_client.h"
+
+#define DEFAULT_MESSAGES 10000
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nmemb, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static __thread int counting;
+static size_t num_allocs;
+static size_t num_frees;
+
+/* Interpose allocator to count allocations of this thread while counting is
+ * set; operator new is counted as it allocates with malloc. */
+extern "C" void *malloc(size_t size)
+{
+  if (counting)
+    num_allocs++;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+  if (counting)
+    num_allocs++;
+  return __libc_calloc(nmemb, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  if (counting)
+    num_allocs++;
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+  if (counting && ptr)
+    num_frees++;
+  __libc_free(ptr);
+}
+
+static const char SEND_MSG[] = "{ \"sensor\" : { \"id\" : \"CAMERA_ID\" } }";
+
+static int completed;
+static int freed;
+
+static void send_cb(void *user_ptr, NvDsMsgApiErrorType err)
+{
+  completed++;
+}
+
+static void payload_free(void *payload)
+{
+  freed++;
+  free(payload);
+}
+
+static void start_count()
+{
+  num_allocs = num_frees = 0;
+  completed = freed = 0;
+  counting = 1;
+}
+
+static void wait_completion(void *kh, int messages)
+{
+  while (completed < messages)
+    nvds_kafka_client_poll(kh);
+  counting = 0;
+}
+
+static void report(const char *name, int messages)
+{
+  printf("%-14s %6.2f allocs/msg  %6.2f frees/msg\n", name,
+         (double) num_allocs / messages, (double) num_frees / messages);
+}
+
+int main(int argc, char *argv[])
+{
+  int messages = argc > 1 ? atoi(argv[1]) : DEFAULT_MESSAGES;
+  size_t len = strlen(SEND_MSG);
+  int ret = 0;
+
+  if (messages <= 0) {
+    printf("Usage: %s [messages]\n", argv[0]);
+    return -1;
+  }
+
+  nvds_log_open();
+  void *kh = nvds_kafka_client_init((char *)"localhost:9092", (char *)"bench");
+  nvds_kafka_client_launch(kh);
+
+  uint8_t **payloads = (uint8_t **) malloc(messages * sizeof(uint8_t *));
+
+  /* warm up pools of the client and of the mock producer */
+  for (int pass = 0; pass < 2; pass++) {
+    start_count();
+    for (int i = 0; i < messages; i++)
+      nvds_kafka_client_send(kh, (const uint8_t *)SEND_MSG, len, 0, NULL, send_cb, NULL, 0);
+    wait_completion(kh, messages);
+  }
+  report("async copy", messages);
+  if (num_allocs > (size_t) messages) {
+    printf("FAIL: async send with copy allocates more than the copy\n");
+    ret = -1;
+  }
+
+  /* payloads are allocated by the caller, freed by the client */
+  for (int i = 0; i < messages; i++) {
+    payloads[i] = (uint8_t *) malloc(len);
+    memcpy(payloads[i], SEND_MSG, len);
+  }
+  start_count();
+  for (int i = 0; i < messages; i++) {
+    if (nvds_kafka_client_send_nocopy(kh, payloads[i], len, payload_free, NULL, send_cb,
+                                      NULL, 0) != NVDS_MSGAPI_OK)
+      payload_free(payloads[i]);
+  }
+  wait_completion(kh, messages);
+  report("async nocopy", messages);
+  if (num_allocs) {
+    printf("FAIL: async send without copy allocates memory\n");
+    ret = -1;
+  }
+  if (freed != messages) {
+    printf("FAIL: %d of %d payloads released\n", freed, messages);
+    ret = -1;
+  }
+
+  /* first sync send starts the poll thread */
+  nvds_kafka_client_send(kh, (const uint8_t *)SEND_MSG, len, 1, NULL, NULL, NULL, 0);
+  start_count();
+  for (int i = 0; i < messages; i++)
+    nvds_kafka_client_send(kh, (const uint8_t *)SEND_MSG, len, 1, NULL, NULL, NULL, 0);
+  counting = 0;
+  report("sync", messages);
+  if (num_allocs) {
+    printf("FAIL: sync send allocates memory\n");
+    ret = -1;
+  }
+
+  nvds_kafka_client_finish(kh);
+
+  /* payloads not delivered when the client finishes are released by it;
+   * takes as long as the flush timeout of the client */
+  kh = nvds_kafka_client_init((char *)"localhost:9092", (char *)"bench");
+  nvds_kafka_client_setconf(kh, (char *)"mock.delivery.latency.us", (char *)"60000000");
+  nvds_kafka_client_launch(kh);
+  completed = freed = 0;
+  for (int i = 0; i < messages; i++) {
+    payloads[i] = (uint8_t *) malloc(len);
+    memcpy(payloads[i], SEND_MSG, len);
+    if (nvds_kafka_client_send_nocopy(kh, payloads[i], len, payload_free, NULL, send_cb,
+                                      NULL, 0) != NVDS_MSGAPI_OK)
+      payload_free(payloads[i]);
+  }
+  nvds_kafka_client_finish(kh);
+  if (freed != messages || completed != messages) {
+    printf("FAIL: %d of %d undelivered payloads released at finish\n", freed, messages);
+    ret = -1;
+  }
+
+  printf("%s\n", ret ? "FAILED" : "PASSED");
+  free(payloads);
+  nvds_log_close();
+  return ret;
+}
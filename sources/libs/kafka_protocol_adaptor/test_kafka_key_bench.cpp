@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Measures cpu time spent per message to find the partition key in the
+ * payload, by parsing it with jansson (json_get_key_value) and by scanning it
+ * in place (json_find_key_value), and checks both find the same key.
+ *
+ * Usage: test_kafka_key_bench [payload file] [key field] [iterations]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "nvds_logger.h"
+
+int json_get_key_value(const char *msg, int msglen, const char *key, char *value, int nbuf);
+int json_find_key_value(const char *msg, int msglen, const char *key, char *value, int nbuf);
+
+#define DEFAULT_ITERATIONS 100000
+#define DEFAULT_KEY_FIELD "sensor.id"
+
+/* Payload in the layout generated by nvmsgconv for PAYLOAD_DEEPSTREAM */
+static const char SAMPLE_MSG[] = "{\n\
+  \"messageid\" : \"84a3a0ad-7eb8-49a2-9aa7-104ded6764d0\",\n\
+  \"mdsversion\" : \"1.0\",\n\
+  \"@timestamp\" : \"2019-10-16T10:22:45.123Z\",\n\
+  \"place\" : {\n\
+    \"id\" : \"1\",\n\
+    \"name\" : \"XYZ\",\n\
+    \"type\" : \"garage\",\n\
+    \"location\" : {\n\
+      \"lat\" : 30.32,\n\
+      \"lon\" : -40.55,\n\
+      \"alt\" : 100.0\n\
+    },\n\
+    \"entrance\" : {\n\
+      \"name\" : \"walsh\",\n\
+      \"lane\" : \"lane1\",\n\
+      \"level\" : \"P2\",\n\
+      \"coordinate\" : {\n\
+        \"x\" : 1.0,\n\
+        \"y\" : 2.0,\n\
+        \"z\" : 3.0\n\
+      }\n\
+    }\n\
+  },\n\
+  \"sensor\" : {\n\
+    \"id\" : \"CAMERA_ID\",\n\
+    \"type\" : \"Camera\",\n\
+    \"description\" : \"\\\"Entrance of Garage Right Lane\\\"\",\n\
+    \"location\" : {\n\
+      \"lat\" : 45.293701447,\n\
+      \"lon\" : -75.8303914499,\n\
+      \"alt\" : 48.1557479338\n\
+    },\n\
+    \"coordinate\" : {\n\
+      \"x\" : 5.2,\n\
+      \"y\" : 10.1,\n\
+      \"z\" : 11.2\n\
+    }\n\
+  },\n\
+  \"analyticsModule\" : {\n\
+    \"id\" : \"XYZ\",\n\
+    \"description\" : \"\\\"Vehicle Detection and License Plate Recognition\\\"\",\n\
+    \"source\" : \"OpenALR\",\n\
+    \"version\" : \"1.0\"\n\
+  },\n\
+  \"object\" : {\n\
+    \"id\" : \"1\",\n\
+    \"speed\" : 0.0,\n\
+    \"direction\" : 0.0,\n\
+    \"orientation\" : 0.0,\n\
+    \"vehicle\" : {\n\
+      \"type\" : \"sedan\",\n\
+      \"make\" : \"Bugatti\",\n\
+      \"model\" : \"M\",\n\
+      \"color\" : \"blue\",\n\
+      \"confidence\" : 0.8,\n\
+      \"license\" : \"XX1234\",\n\
+      \"licenseState\" : \"CA\"\n\
+    },\n\
+    \"bbox\" : {\n\
+      \"topleftx\" : 585,\n\
+      \"toplefty\" : 472,\n\
+      \"bottomrightx\" : 642,\n\
+      \"bottomrighty\" : 518\n\
+    },\n\
+    \"location\" : {\n\
+      \"lat\" : 0.0,\n\
+      \"lon\" : 0.0,\n\
+      \"alt\" : 0.0\n\
+    },\n\
+    \"coordinate\" : {\n\
+      \"x\" : 0.0,\n\
+      \"y\" : 0.0,\n\
+      \"z\" : 0.0\n\
+    }\n\
+  },\n\
+  \"event\" : {\n\
+    \"id\" : \"4f8436ab-b65a-4ddf-8c3d-7df2d2e8d0d4\",\n\
+    \"type\" : \"moving\"\n\
+  },\n\
+  \"videoPath\" : \"\"\n\
+}";
+
+typedef int (*key_lookup_fn)(const char *msg, int msglen, const char *key, char *value, int nbuf);
+
+static double cpu_time_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double run(const char *name, key_lookup_fn fn, const char *msg, int msglen,
+                  const char *field, int iterations, char *value, int nbuf)
+{
+  double start = cpu_time_ns();
+  int len = 0;
+
+  for (int i = 0; i < iterations; i++)
+    len = fn(msg, msglen, field, value, nbuf);
+
+  double per_msg = (cpu_time_ns() - start) / iterations;
+  printf("%-24s %10.1f ns/msg   key(%d) = %s\n", name, per_msg, len, len > 0 ? value : "");
+  return per_msg;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *msg = SAMPLE_MSG;
+  char *file_msg = NULL;
+  const char *field = argc > 2 ? argv[2] : DEFAULT_KEY_FIELD;
+  int iterations = argc > 3 ? atoi(argv[3]) : DEFAULT_ITERATIONS;
+  long msglen = strlen(SAMPLE_MSG);
+  char parsed[100], scanned[100];
+
+  if (argc > 1) {
+    FILE *fp = fopen(argv[1], "rb");
+    if (!fp) {
+      printf("unable to open %s\n", argv[1]);
+      return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    msglen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    file_msg = (char *)malloc(msglen);
+    if (fread(file_msg, 1, msglen, fp) != (size_t)msglen) {
+      printf("unable to read %s\n", argv[1]);
+      fclose(fp);
+      return -1;
+    }
+    fclose(fp);
+    msg = file_msg;
+  }
+
+  if (iterations <= 0)
+    iterations = DEFAULT_ITERATIONS;
+
+  nvds_log_open();
+  printf("payload %ld bytes, key field %s, %d iterations\n", msglen, field, iterations);
+
+  memset(parsed, 0, sizeof(parsed));
+  memset(scanned, 0, sizeof(scanned));
+  double before = run("json_get_key_value", json_get_key_value, msg, msglen, field,
+                      iterations, parsed, sizeof(parsed));
+  double after = run("json_find_key_value", json_find_key_value, msg, msglen, field,
+                     iterations, scanned, sizeof(scanned));
+  printf("speedup %.1fx\n", before / after);
+
+  int ret = 0;
+  int scanlen = json_find_key_value(msg, msglen, field, scanned, sizeof(scanned));
+  if (scanlen >= 0 && strcmp(scanlen ? scanned : "", parsed)) {
+    printf("key mismatch: parsed \"%s\" scanned \"%s\"\n", parsed, scanned);
+    ret = -1;
+  } else if (scanlen < 0) {
+    printf("scanner falls back to json parser for this payload\n");
+  }
+
+  nvds_log_close();
+  free(file_msg);
+  return ret;
+}
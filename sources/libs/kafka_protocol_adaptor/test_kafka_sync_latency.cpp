@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Measures latency of synchronous sends of the kafka client against the
+ * stand-in producer in mock_rdkafka.cpp:
+ *  - poll loop: completion polled every 1ms as sync send used to do
+ *  - sync: nvds_kafka_client_send() with sync set
+ *  - batch: nvds_kafka_client_send_batch() for batches of messages
+ *
+ * Usage: test_kafka_sync_latency [delivery latency us] [messages] [batch size]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "nvds_logger.h"
+#include "kafka_client.h"
+
+#define DEFAULT_LATENCY_US 200
+#define DEFAULT_MESSAGES 2000
+#define DEFAULT_BATCH_SIZE 32
+
+static const char SEND_MSG[] = "{ \"sensor\" : { \"id\" : \"CAMERA_ID\" } }";
+
+static double time_us(clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void poll_loop_cb(void *user_ptr, NvDsMsgApiErrorType err)
+{
+  *(volatile int *) user_ptr = 1;
+}
+
+static void report(const char *name, std::vector<double> &latencies, int messages,
+                   double wall_us, double cpu_us)
+{
+  std::sort(latencies.begin(), latencies.end());
+  printf("%-10s p50 %9.1f us  p99 %9.1f us  %9.0f msgs/s  cpu %6.2f us/msg\n", name,
+         latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100],
+         messages / wall_us * 1e6, cpu_us / messages);
+}
+
+int main(int argc, char *argv[])
+{
+  int latency_us = argc > 1 ? atoi(argv[1]) : DEFAULT_LATENCY_US;
+  int messages = argc > 2 ? atoi(argv[2]) : DEFAULT_MESSAGES;
+  int batch_size = argc > 3 ? atoi(argv[3]) : DEFAULT_BATCH_SIZE;
+  char latency_str[32];
+  std::vector<double> latencies;
+  double wall, cpu;
+
+  if (messages <= 0 || batch_size <= 0) {
+    printf("Usage: %s [delivery latency us] [messages] [batch size]\n", argv[0]);
+    return -1;
+  }
+
+  nvds_log_open();
+  void *kh = nvds_kafka_client_init((char *)"localhost:9092", (char *)"bench");
+  snprintf(latency_str, sizeof(latency_str), "%d", latency_us);
+  nvds_kafka_client_setconf(kh, (char *)"mock.delivery.latency.us", latency_str);
+  if (nvds_kafka_client_launch(kh) != NVDS_MSGAPI_OK) {
+    printf("unable to launch kafka client\n");
+    return -1;
+  }
+
+  printf("delivery latency %d us, %d messages, batch size %d\n", latency_us, messages, batch_size);
+
+  wall = time_us(CLOCK_MONOTONIC);
+  cpu = time_us(CLOCK_PROCESS_CPUTIME_ID);
+  for (int i = 0; i < messages; i++) {
+    volatile int done = 0;
+    double start = time_us(CLOCK_MONOTONIC);
+    nvds_kafka_client_send(kh, (const uint8_t *)SEND_MSG, strlen(SEND_MSG), 0,
+                           (void *)&done, poll_loop_cb, NULL, 0);
+    while (!done) {
+      usleep(1000);
+      nvds_kafka_client_poll(kh);
+    }
+    latencies.push_back(time_us(CLOCK_MONOTONIC) - start);
+  }
+  report("poll loop", latencies, messages, time_us(CLOCK_MONOTONIC) - wall,
+         time_us(CLOCK_PROCESS_CPUTIME_ID) - cpu);
+
+  latencies.clear();
+  wall = time_us(CLOCK_MONOTONIC);
+  cpu = time_us(CLOCK_PROCESS_CPUTIME_ID);
+  for (int i = 0; i < messages; i++) {
+    double start = time_us(CLOCK_MONOTONIC);
+    if (nvds_kafka_client_send(kh, (const uint8_t *)SEND_MSG, strlen(SEND_MSG), 1,
+                               NULL, NULL, NULL, 0) != NVDS_MSGAPI_OK)
+      printf("sync send [%d] failed\n", i);
+    latencies.push_back(time_us(CLOCK_MONOTONIC) - start);
+  }
+  report("sync", latencies, messages, time_us(CLOCK_MONOTONIC) - wall,
+         time_us(CLOCK_PROCESS_CPUTIME_ID) - cpu);
+
+  std::vector<const uint8_t *> payloads(batch_size, (const uint8_t *)SEND_MSG);
+  std::vector<int> lens(batch_size, strlen(SEND_MSG));
+
+  /* latency of a message in batch is the latency of whole batch */
+  latencies.clear();
+  wall = time_us(CLOCK_MONOTONIC);
+  cpu = time_us(CLOCK_PROCESS_CPUTIME_ID);
+  for (int i = 0; i < messages; i += batch_size) {
+    int count = std::min(batch_size, messages - i);
+    double start = time_us(CLOCK_MONOTONIC);
+    if (nvds_kafka_client_send_batch(kh, payloads.data(), lens.data(), NULL, NULL,
+                                     count) != NVDS_MSGAPI_OK)
+      printf("batch send [%d] failed\n", i);
+    latencies.insert(latencies.end(), count, time_us(CLOCK_MONOTONIC) - start);
+  }
+  report("batch", latencies, messages, time_us(CLOCK_MONOTONIC) - wall,
+         time_us(CLOCK_PROCESS_CPUTIME_ID) - cpu);
+
+  nvds_kafka_client_finish(kh);
+  nvds_log_close();
+  return 0;
+}
@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/**
+ * Protocol adaptor which doesn't connect anywhere, to test message broker
+ * clients without a broker. Sent messages are counted and optionally written
+ * to a file. Broker outages are simulated by rejecting sends.
+ *
+ * Config file settings, in the message-broker group:
+ *   mock-outage-file     - sends are rejected while this file exists
+ *   mock-outage-period   - sends are rejected periodically, period in ms
+ *   mock-outage-duration - duration in ms of periodic outages
+ *   mock-sink-file       - file to write sent messages to, one per line
+ *   mock-latency         - broker round trip in us; async sends complete and
+ *                          sync sends return after it
+ *   mock-failure-rate    - fraction of messages failing delivery, in [0, 1]
+ *   mock-max-in-flight   - async sends are rejected while this many
+ *                          completions are pending, 0 for no limit
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include "nvds_logger.h"
+#include "nvds_msgapi.h"
+
+#define NVDS_MOCK_LOG_CAT "NVDS_MOCK_PROTO"
+
+#define MAX_FIELD_LEN 255
+
+#define NVDS_MSGAPI_VERSION "1.0"
+
+#define CONFIG_GROUP_MSG_BROKER "message-broker"
+#define CONFIG_MOCK_OUTAGE_FILE "mock-outage-file"
+#define CONFIG_MOCK_OUTAGE_PERIOD "mock-outage-period"
+#define CONFIG_MOCK_OUTAGE_DURATION "mock-outage-duration"
+#define CONFIG_MOCK_SINK_FILE "mock-sink-file"
+#define CONFIG_MOCK_LATENCY "mock-latency"
+#define CONFIG_MOCK_FAILURE_RATE "mock-failure-rate"
+#define CONFIG_MOCK_MAX_IN_FLIGHT "mock-max-in-flight"
+
+/* Completion of an async send, reported from nvds_msgapi_do_work */
+typedef struct NvDsMockCompl {
+  nvds_msgapi_send_cb_t send_callback;
+  void *user_ptr;
+  NvDsMsgApiErrorType status;
+  /* monotonic time the completion is reported at */
+  gint64 due;
+  struct NvDsMockCompl *next;
+} NvDsMockCompl;
+
+typedef struct {
+  char topic[MAX_FIELD_LEN];
+  gchar *outage_file;
+  gint64 outage_period;
+  gint64 outage_duration;
+  gint64 start_time;
+  FILE *sink;
+  gint64 latency;
+  gdouble failure_rate;
+  guint max_in_flight;
+  /* state of the generator deciding which messages fail */
+  guint64 rand_state;
+  GMutex lock;
+  /* completions to report, oldest first, and recycled ones */
+  NvDsMockCompl *compl_head;
+  NvDsMockCompl *compl_tail;
+  NvDsMockCompl *compl_free;
+  guint in_flight;
+  guint64 sent;
+  guint64 rejected;
+  guint64 failed;
+  gboolean down;
+} NvDsMockProtoConn;
+
+static void nvds_mock_read_config(NvDsMockProtoConn *conn, char *config_path)
+{
+  GKeyFile *key_file = g_key_file_new();
+  GError *error = NULL;
+  gchar *sink_file;
+
+  if (!g_key_file_load_from_file(key_file, config_path, G_KEY_FILE_NONE, &error)) {
+    nvds_log(NVDS_MOCK_LOG_CAT, LOG_ERR, "unable to load config file at path %s; error message = %s\n",
+             config_path, error->message);
+    g_error_free(error);
+    g_key_file_free(key_file);
+    return;
+  }
+
+  conn->outage_file = g_key_file_get_string(key_file, CONFIG_GROUP_MSG_BROKER,
+                                            CONFIG_MOCK_OUTAGE_FILE, NULL);
+  conn->outage_period = g_key_file_get_integer(key_file, CONFIG_GROUP_MSG_BROKER,
+                                               CONFIG_MOCK_OUTAGE_PERIOD, NULL) * G_TIME_SPAN_MILLISECOND;
+  conn->outage_duration = g_key_file_get_integer(key_file, CONFIG_GROUP_MSG_BROKER,
+                                                 CONFIG_MOCK_OUTAGE_DURATION, NULL) * G_TIME_SPAN_MILLISECOND;
+
+  conn->latency = g_key_file_get_integer(key_file, CONFIG_GROUP_MSG_BROKER, CONFIG_MOCK_LATENCY, NULL);
+  conn->failure_rate = g_key_file_get_double(key_file, CONFIG_GROUP_MSG_BROKER, CONFIG_MOCK_FAILURE_RATE, NULL);
+  conn->max_in_flight = g_key_file_get_integer(key_file, CONFIG_GROUP_MSG_BROKER, CONFIG_MOCK_MAX_IN_FLIGHT, NULL);
+
+  sink_file = g_key_file_get_string(key_file, CONFIG_GROUP_MSG_BROKER, CONFIG_MOCK_SINK_FILE, NULL);
+  if (sink_file) {
+    conn->sink = fopen(sink_file, "a");
+    if (!conn->sink)
+      nvds_log(NVDS_MOCK_LOG_CAT, LOG_ERR, "unable to open sink file %s\n", sink_file);
+    g_free(sink_file);
+  }
+
+  nvds_log(NVDS_MOCK_LOG_CAT, LOG_INFO, "mock outage file = %s; outage period = %ld ms, duration = %ld ms\n",
+           conn->outage_file ? conn->outage_file : "", (long)(conn->outage_period / G_TIME_SPAN_MILLISECOND),
+           (long)(conn->outage_duration / G_TIME_SPAN_MILLISECOND));
+  nvds_log(NVDS_MOCK_LOG_CAT, LOG_INFO, "mock latency = %ld us; failure rate = %f; max in flight = %u\n",
+           (long) conn->latency, conn->failure_rate, conn->max_in_flight);
+  g_key_file_free(key_file);
+}
+
+/* Tells whether the simulated broker is down. Called with lock held. */
+static gboolean mock_broker_down(NvDsMockProtoConn *conn)
+{
+  gboolean down = FALSE;
+
+  if (conn->outage_file && !access(conn->outage_file, F_OK))
+    down = TRUE;
+
+  if (conn->outage_period > 0 &&
+      (g_get_monotonic_time() - conn->start_time) % conn->outage_period < conn->outage_duration)
+    down = TRUE;
+
+  if (down != conn->down)
+    nvds_log(NVDS_MOCK_LOG_CAT, down ? LOG_ERR : LOG_INFO, "mock broker %s\n", down ? "down" : "up");
+  conn->down = down;
+  return down;
+}
+
+/* Tells whether the next message fails delivery. Called with lock held. */
+static gboolean mock_delivery_fails(NvDsMockProtoConn *conn)
+{
+  guint64 x;
+
+  if (conn->failure_rate <= 0)
+    return FALSE;
+
+  /* xorshift64*, failures only need to be spread, not unpredictable */
+  x = conn->rand_state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  conn->rand_state = x;
+  return ((x * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0) < conn->failure_rate;
+}
+
+NvDsMsgApiHandle nvds_msgapi_connect(char *connection_str, nvds_msgapi_connect_cb_t connect_cb, char *config_path)
+{
+  NvDsMockProtoConn *conn;
+  const char *topicptr;
+
+  nvds_log_open();
+  nvds_log(NVDS_MOCK_LOG_CAT, LOG_INFO, "nvds_msgapi_connect:connection_str = %s\n", connection_str);
+
+  if (!connection_str) {
+    nvds_log(NVDS_MOCK_LOG_CAT, LOG_ERR, "connection string not provided. Can't create connection\n");
+    return NULL;
+  }
+
+  conn = (NvDsMockProtoConn *) g_malloc0(sizeof(NvDsMockProtoConn));
+  g_mutex_init(&conn->lock);
+  conn->start_time = g_get_monotonic_time();
+  conn->rand_state = 0x9E3779B97F4A7C15ULL;
+
+  /* topic is the last field of "url;port;topic", other fields are ignored */
+  topicptr = strrchr(connection_str, ';');
+  strncpy(conn->topic, topicptr ? topicptr + 1 : connection_str, MAX_FIELD_LEN - 1);
+
+  if (config_path)
+    nvds_mock_read_config(conn, config_path);
+
+  return (NvDsMsgApiHandle) conn;
+}
+
+static NvDsMsgApiErrorType mock_proto_send(const char *fn, NvDsMsgApiHandle h_ptr, char *topic,
+                     const uint8_t *payload, size_t nbuf, const char *key, size_t keylen,
+                     nvds_msgapi_send_cb_t send_callback, void *user_ptr,
+                     void (*payload_free)(void *) = NULL)
+{
+  NvDsMockProtoConn *conn = (NvDsMockProtoConn *) h_ptr;
+  NvDsMockCompl *sc;
+  NvDsMsgApiErrorType status = NVDS_MSGAPI_OK;
+
+  if (topic && strcmp(topic, conn->topic)) {
+    nvds_log(NVDS_MOCK_LOG_CAT, LOG_ERR, "%s: send topic has to match topic defined at connect.\n", fn);
+    return NVDS_MSGAPI_ERR;
+  }
+
+  g_mutex_lock(&conn->lock);
+  if (mock_broker_down(conn)) {
+    conn->rejected++;
+    g_mutex_unlock(&conn->lock);
+    return NVDS_MSGAPI_ERR;
+  }
+
+  /* local queue full, as kafka's when the broker doesn't keep up */
+  if (send_callback && conn->max_in_flight && conn->in_flight >= conn->max_in_flight) {
+    conn->rejected++;
+    g_mutex_unlock(&conn->lock);
+    return NVDS_MSGAPI_ERR;
+  }
+
+  if (mock_delivery_fails(conn)) {
+    conn->failed++;
+    status = NVDS_MSGAPI_ERR;
+  } else {
+    conn->sent++;
+    if (conn->sink) {
+      fwrite(payload, 1, nbuf, conn->sink);
+      fputc('\n', conn->sink);
+    }
+  }
+
+  if (send_callback) {
+    sc = conn->compl_free;
+    if (sc)
+      conn->compl_free = sc->next;
+    else
+      sc = (NvDsMockCompl *) g_malloc(sizeof(NvDsMockCompl));
+    sc->send_callback = send_callback;
+    sc->user_ptr = user_ptr;
+    sc->status = status;
+    sc->due = g_get_monotonic_time() + conn->latency;
+    sc->next = NULL;
+    if (conn->compl_tail)
+      conn->compl_tail->next = sc;
+    else
+      conn->compl_head = sc;
+    conn->compl_tail = sc;
+    conn->in_flight++;
+  }
+  g_mutex_unlock(&conn->lock);
+
+  if (payload_free)
+    payload_free((void *) payload);
+
+  if (send_callback)
+    return NVDS_MSGAPI_OK;
+
+  /* sync send waits for the broker */
+  if (conn->latency > 0)
+    g_usleep(conn->latency);
+  return status;
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf)
+{
+  return mock_proto_send(__func__, h_ptr, topic, payload, nbuf, NULL, 0, NULL, NULL);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf,
+                     nvds_msgapi_send_cb_t send_callback, void *user_ptr)
+{
+  return mock_proto_send(__func__, h_ptr, topic, payload, nbuf, NULL, 0, send_callback, user_ptr);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf,
+                     const char *key, size_t keylen)
+{
+  return mock_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, NULL, NULL);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload,
+                     size_t nbuf, const char *key, size_t keylen, nvds_msgapi_send_cb_t send_callback, void *user_ptr)
+{
+  return mock_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, send_callback, user_ptr);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async_nocopy(NvDsMsgApiHandle h_ptr, char *topic, uint8_t *payload, size_t nbuf,
+                     const char *key, size_t keylen, void (*payload_free)(void *), nvds_msgapi_send_cb_t send_callback,
+                     void *user_ptr)
+{
+  if (!payload_free) {
+    nvds_log(NVDS_MOCK_LOG_CAT, LOG_ERR, "nvds_msgapi_send_async_nocopy: payload_free is NULL\n");
+    return NVDS_MSGAPI_ERR;
+  }
+  return mock_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, send_callback, user_ptr, payload_free);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_batch(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t **payloads,
+                     const size_t *nbufs, const char **keys, size_t count)
+{
+  NvDsMsgApiErrorType err;
+
+  for (size_t i = 0; i < count; i++) {
+    const char *key = keys ? keys[i] : NULL;
+    err = mock_proto_send(__func__, h_ptr, topic, payloads[i], nbufs[i], key, key ? strlen(key) : 0, NULL, NULL);
+    if (err != NVDS_MSGAPI_OK)
+      return err;
+  }
+  return NVDS_MSGAPI_OK;
+}
+
+/* Reports completions due by @until, oldest first. */
+static void mock_report_completions(NvDsMockProtoConn *conn, gint64 until)
+{
+  NvDsMockCompl *head, *sc, *last = NULL;
+  guint count = 0;
+
+  /* latency is the same for all messages, so completions are due in order */
+  g_mutex_lock(&conn->lock);
+  head = conn->compl_head;
+  for (sc = head; sc && sc->due <= until; sc = sc->next) {
+    last = sc;
+    count++;
+  }
+  if (last) {
+    conn->compl_head = last->next;
+    if (!conn->compl_head)
+      conn->compl_tail = NULL;
+    last->next = NULL;
+  }
+  g_mutex_unlock(&conn->lock);
+
+  if (!last)
+    return;
+
+  for (sc = head; sc; sc = sc->next)
+    sc->send_callback(sc->user_ptr, sc->status);
+
+  g_mutex_lock(&conn->lock);
+  last->next = conn->compl_free;
+  conn->compl_free = head;
+  conn->in_flight -= count;
+  g_mutex_unlock(&conn->lock);
+}
+
+/**
+ * Reports completion of async sends whose latency has elapsed.
+ */
+void nvds_msgapi_do_work(NvDsMsgApiHandle h_ptr)
+{
+  mock_report_completions((NvDsMockProtoConn *) h_ptr, g_get_monotonic_time());
+}
+
+NvDsMsgApiErrorType nvds_msgapi_disconnect(NvDsMsgApiHandle h_ptr)
+{
+  NvDsMockProtoConn *conn = (NvDsMockProtoConn *) h_ptr;
+  NvDsMockCompl *sc, *next;
+
+  if (!conn) {
+    nvds_log(NVDS_MOCK_LOG_CAT, LOG_DEBUG, "nvds_msgapi_disconnect called with null handle\n");
+    return NVDS_MSGAPI_OK;
+  }
+
+  /* report pending completions as the real adaptors flush on disconnect */
+  mock_report_completions(conn, G_MAXINT64);
+
+  nvds_log(NVDS_MOCK_LOG_CAT, LOG_INFO, "mock adaptor sent %lu messages, rejected %lu, failed %lu\n",
+           (unsigned long) conn->sent, (unsigned long) conn->rejected, (unsigned long) conn->failed);
+
+  for (sc = conn->compl_free; sc; sc = next) {
+    next = sc->next;
+    g_free(sc);
+  }
+  if (conn->sink)
+    fclose(conn->sink);
+  g_free(conn->outage_file);
+  g_mutex_clear(&conn->lock);
+  g_free(conn);
+  nvds_log_close();
+  return NVDS_MSGAPI_OK;
+}
+
+/**
+  * Returns version of API supported by this adaptor
+  */
+char *nvds_msgapi_getversion()
+{
+  return (char *)NVDS_MSGAPI_VERSION;
+}
@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Throughput benchmark of the messaging path: synthetic NvDsEventMsgMeta are
+ * converted to payloads with nvmsgconv, queued and sent by a sender thread
+ * the way nvmsgbroker does, through a protocol adaptor (the mock one by
+ * default, so that it runs without a broker).
+ *
+ * Usage: test_msgbroker_bench <msgconv config> [options]
+ *   -l <lib>     msgconv library (default ../nvmsgconv/libnvds_msgconv.so)
+ *   -p <lib>     protocol adaptor (default ./libnvds_mock_proto.so)
+ *   -c <file>    adaptor config, e.g. to set mock latency / failure rate
+ *   -s <str>     connection string (default "localhost;0;bench")
+ *   -t <topic>   topic (default "bench")
+ *   -n <count>   messages to send (default 200000)
+ *   -r <rate>    messages per second to generate, 0 for max (default 0)
+ *   -q <size>    send queue size (default 1024)
+ *   -m <schema>  full, minimal or binary (default full)
+ *   -y           synchronous sends
+ *
+ * Reports throughput, latency from payload generation to send completion
+ * and CPU time of the process per message.
+ */
+
+#include <stdio.h>
+#include <dlfcn.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include <glib.h>
+#include "nvds_msgapi.h"
+#include "nvmsgconv.h"
+#include "gstnvmsgbroker_queue.h"
+
+#define DEFAULT_MSGCONV_LIB "../nvmsgconv/libnvds_msgconv.so"
+#define DEFAULT_PROTO_LIB "./libnvds_mock_proto.so"
+#define DEFAULT_CONN_STR "localhost;0;bench"
+#define DEFAULT_TOPIC "bench"
+#define DEFAULT_MESSAGES 200000
+#define DEFAULT_QUEUE_SIZE 1024
+#define BATCH_SIZE 32
+#define SIGNATURE_SIZE 16
+/* same as nvmsgbroker */
+#define SEND_BURST_SIZE 32
+#define DO_WORK_INTERVAL_US 1000
+/* wait before retrying a send rejected by the adaptor */
+#define RETRY_INTERVAL_US 100
+
+typedef NvDsMsg2pCtx* (*nvds_msg2p_ctx_create_ptr) (const gchar *file, NvDsPayloadType type);
+typedef void (*nvds_msg2p_ctx_destroy_ptr) (NvDsMsg2pCtx *ctx);
+typedef NvDsPayload* (*nvds_msg2p_generate_ptr) (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size);
+typedef void (*nvds_msg2p_release_ptr) (NvDsMsg2pCtx *ctx, NvDsPayload *payload);
+typedef gchar* (*nvds_msg2p_generate_key_ptr) (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size);
+typedef gboolean (*nvds_msg2p_payload_transferable_ptr) (NvDsMsg2pCtx *ctx);
+
+typedef NvDsMsgApiHandle (*nvds_msgapi_connect_ptr) (char *connection_str,
+    nvds_msgapi_connect_cb_t connect_cb, char *config_path);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_ptr) (NvDsMsgApiHandle h_ptr,
+    char *topic, const uint8_t *payload, size_t nbuf);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_with_key_ptr) (NvDsMsgApiHandle h_ptr,
+    char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_ptr) (NvDsMsgApiHandle h_ptr,
+    char *topic, const uint8_t *payload, size_t nbuf,
+    nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_send_async_nocopy_ptr) (NvDsMsgApiHandle h_ptr,
+    char *topic, uint8_t *payload, size_t nbuf, const char *key, size_t keylen,
+    void (*payload_free) (void *), nvds_msgapi_send_cb_t send_callback, void *user_ptr);
+typedef void (*nvds_msgapi_do_work_ptr) (NvDsMsgApiHandle h_ptr);
+typedef NvDsMsgApiErrorType (*nvds_msgapi_disconnect_ptr) (NvDsMsgApiHandle h_ptr);
+
+struct MsgConvLib {
+  void *handle;
+  nvds_msg2p_ctx_create_ptr ctx_create;
+  nvds_msg2p_ctx_destroy_ptr ctx_destroy;
+  nvds_msg2p_generate_ptr generate;
+  nvds_msg2p_release_ptr release;
+  /* optional */
+  nvds_msg2p_generate_key_ptr generate_key;
+  nvds_msg2p_payload_transferable_ptr payload_transferable;
+};
+
+struct ProtoLib {
+  void *handle;
+  nvds_msgapi_connect_ptr connect;
+  nvds_msgapi_send_ptr send;
+  nvds_msgapi_send_with_key_ptr send_with_key;
+  nvds_msgapi_send_async_ptr send_async;
+  /* optional */
+  nvds_msgapi_send_async_nocopy_ptr send_async_nocopy;
+  nvds_msgapi_do_work_ptr do_work;
+  nvds_msgapi_disconnect_ptr disconnect;
+};
+
+struct Bench;
+
+/* Per message record, indexed by message number */
+struct MsgRecord {
+  Bench *bench;
+  gint64 start;
+  gint64 latency;
+};
+
+struct Bench {
+  ProtoLib proto;
+  NvDsMsgApiHandle conn;
+  char *topic;
+  bool sync;
+  guint64 count;
+  GstNvMsgBrokerQueue *queue;
+  std::vector<MsgRecord> records;
+
+  GMutex lock;
+  GCond cond;
+  gint senderWaiting;
+  gint producerWaiting;
+  gint producerDone;
+
+  /* sender thread only */
+  guint64 sent;
+  guint64 completed;
+  guint64 failed;
+  guint64 rejected;
+  guint64 inFlight;
+};
+
+struct SyntheticBatch {
+  NvDsEventMsgMeta meta[BATCH_SIZE];
+  NvDsEvent events[BATCH_SIZE];
+  NvDsVehicleObject vehicle;
+  NvDsPersonObject person;
+  NvDsFaceObject face;
+  gdouble signature[SIGNATURE_SIZE];
+};
+
+static bool
+load_msgconv (const char *path, MsgConvLib &lib)
+{
+  lib.handle = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+  if (!lib.handle) {
+    fprintf (stderr, "%s\n", dlerror ());
+    return false;
+  }
+  *(void **) (&lib.ctx_create) = dlsym (lib.handle, "nvds_msg2p_ctx_create");
+  *(void **) (&lib.ctx_destroy) = dlsym (lib.handle, "nvds_msg2p_ctx_destroy");
+  *(void **) (&lib.generate) = dlsym (lib.handle, "nvds_msg2p_generate");
+  *(void **) (&lib.release) = dlsym (lib.handle, "nvds_msg2p_release");
+  *(void **) (&lib.generate_key) = dlsym (lib.handle, "nvds_msg2p_generate_key");
+  *(void **) (&lib.payload_transferable) = dlsym (lib.handle, "nvds_msg2p_payload_transferable");
+  return lib.ctx_create && lib.ctx_destroy && lib.generate && lib.release;
+}
+
+static bool
+load_proto (const char *path, ProtoLib &lib)
+{
+  lib.handle = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+  if (!lib.handle) {
+    fprintf (stderr, "%s\n", dlerror ());
+    return false;
+  }
+  *(void **) (&lib.connect) = dlsym (lib.handle, "nvds_msgapi_connect");
+  *(void **) (&lib.send) = dlsym (lib.handle, "nvds_msgapi_send");
+  *(void **) (&lib.send_with_key) = dlsym (lib.handle, "nvds_msgapi_send_with_key");
+  *(void **) (&lib.send_async) = dlsym (lib.handle, "nvds_msgapi_send_async");
+  *(void **) (&lib.send_async_nocopy) = dlsym (lib.handle, "nvds_msgapi_send_async_nocopy");
+  *(void **) (&lib.do_work) = dlsym (lib.handle, "nvds_msgapi_do_work");
+  *(void **) (&lib.disconnect) = dlsym (lib.handle, "nvds_msgapi_disconnect");
+  return lib.connect && lib.send && lib.send_async && lib.do_work && lib.disconnect;
+}
+
+static void
+fill_batch (SyntheticBatch &b)
+{
+  static gchar ts[] = "2019-08-21T10:17:23.376Z";
+  static gchar sensor[] = "CAMERA_ID";
+  static gchar str[][16] = {"sedan", "Bugatti", "M", "blue", "CA", "CA 444",
+    "male", "black", "none", "formal", "Jon \"J\" Doe", "brown"};
+
+  memset (&b, 0, sizeof (b));
+  b.vehicle = {str[0], str[1], str[2], str[3], str[4], str[5]};
+  b.person = {str[6], str[7], str[8], str[9], 45};
+  b.face = {str[6], str[7], str[8], str[8], str[8], str[10], str[11], 31};
+  for (guint i = 0; i < SIGNATURE_SIZE; i++)
+    b.signature[i] = i / 7.0;
+
+  for (guint i = 0; i < BATCH_SIZE; i++) {
+    NvDsEventMsgMeta *m = &b.meta[i];
+    m->type = NVDS_EVENT_MOVING;
+    m->objType = (NvDsObjectType) (i % 3);
+    m->bbox = {(gint) (10 + i), (gint) (20 + i), 100, 50};
+    m->location = {45.293701447, -75.8303914499, 48.1557479338};
+    m->coordinate = {5.2 * i, 10.1, 11.2};
+    if (i % 4 == 0) {
+      m->objSignature.signature = b.signature;
+      m->objSignature.size = SIGNATURE_SIZE;
+    }
+    m->sensorId = i % 4;
+    m->sensorStr = sensor;
+    m->frameId = 1234;
+    m->confidence = 0.1 * (i % 10);
+    m->trackingId = 1000 + i;
+    m->ts = ts;
+    switch (m->objType) {
+      case NVDS_OBJECT_TYPE_VEHICLE:
+        m->extMsg = &b.vehicle;
+        m->extMsgSize = sizeof (b.vehicle);
+        break;
+      case NVDS_OBJECT_TYPE_PERSON:
+        m->extMsg = &b.person;
+        m->extMsgSize = sizeof (b.person);
+        break;
+      default:
+        m->extMsg = &b.face;
+        m->extMsgSize = sizeof (b.face);
+        break;
+    }
+    b.events[i].eventType = m->type;
+    b.events[i].metadata = m;
+  }
+}
+
+static gint64
+cpu_time_us (clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime (clock, &ts);
+  return ts.tv_sec * G_GINT64_CONSTANT (1000000) + ts.tv_nsec / 1000;
+}
+
+static void
+send_callback (void *data, NvDsMsgApiErrorType status)
+{
+  MsgRecord *record = (MsgRecord *) data;
+  Bench *bench = record->bench;
+
+  record->latency = g_get_monotonic_time () - record->start;
+  bench->completed++;
+  bench->inFlight--;
+  if (status != NVDS_MSGAPI_OK)
+    bench->failed++;
+}
+
+/* Sends @msg, retrying async sends while the adaptor applies backpressure.
+ * Sync sends can't tell a rejection from a failure and are not retried. */
+static void
+send_msg (Bench *bench, GstNvMsgBrokerMsg *msg, guint64 id)
+{
+  MsgRecord *record = &bench->records[id];
+  ProtoLib &p = bench->proto;
+  NvDsMsgApiErrorType err;
+  gsize keyLen = msg->key ? strlen (msg->key) : 0;
+
+  while (TRUE) {
+    if (bench->sync) {
+      if (msg->key && p.send_with_key)
+        err = p.send_with_key (bench->conn, bench->topic, (uint8_t *) msg->data,
+            msg->size, msg->key, keyLen);
+      else
+        err = p.send (bench->conn, bench->topic, (uint8_t *) msg->data, msg->size);
+      record->latency = g_get_monotonic_time () - record->start;
+      bench->completed++;
+      if (err != NVDS_MSGAPI_OK)
+        bench->failed++;
+      break;
+    } else {
+      record->bench = bench;
+      if (p.send_async_nocopy) {
+        err = p.send_async_nocopy (bench->conn, bench->topic, (uint8_t *) msg->data,
+            msg->size, msg->key, keyLen, g_free, send_callback, record);
+        if (err == NVDS_MSGAPI_OK)
+          msg->data = NULL;
+      } else {
+        err = p.send_async (bench->conn, bench->topic, (uint8_t *) msg->data,
+            msg->size, send_callback, record);
+      }
+      if (err == NVDS_MSGAPI_OK) {
+        bench->inFlight++;
+        break;
+      }
+    }
+    /* rejected, give the adaptor time to drain */
+    bench->rejected++;
+    p.do_work (bench->conn);
+    g_usleep (RETRY_INTERVAL_US);
+  }
+  bench->sent++;
+  gst_nvmsgbroker_msg_clear (msg);
+}
+
+/* Same scheme as the nvmsgbroker sender thread */
+static gpointer
+sender_thread (gpointer data)
+{
+  Bench *bench = (Bench *) data;
+  GstNvMsgBrokerMsg msg;
+  guint sent;
+
+  while (TRUE) {
+    for (sent = 0; sent < SEND_BURST_SIZE &&
+        gst_nvmsgbroker_queue_pop (bench->queue, &msg); sent++)
+      send_msg (bench, &msg, bench->sent);
+
+    if (sent && g_atomic_int_get (&bench->producerWaiting)) {
+      g_mutex_lock (&bench->lock);
+      g_cond_broadcast (&bench->cond);
+      g_mutex_unlock (&bench->lock);
+    }
+
+    if (bench->inFlight)
+      bench->proto.do_work (bench->conn);
+
+    if (sent == SEND_BURST_SIZE)
+      continue;
+
+    g_mutex_lock (&bench->lock);
+    g_atomic_int_set (&bench->senderWaiting, TRUE);
+    if (!gst_nvmsgbroker_queue_depth (bench->queue)) {
+      if (g_atomic_int_get (&bench->producerDone) && !bench->inFlight) {
+        g_atomic_int_set (&bench->senderWaiting, FALSE);
+        g_mutex_unlock (&bench->lock);
+        break;
+      }
+      if (bench->inFlight)
+        g_cond_wait_until (&bench->cond, &bench->lock,
+            g_get_monotonic_time () + DO_WORK_INTERVAL_US);
+      else
+        g_cond_wait (&bench->cond, &bench->lock);
+    }
+    g_atomic_int_set (&bench->senderWaiting, FALSE);
+    g_mutex_unlock (&bench->lock);
+  }
+  return NULL;
+}
+
+static void
+wakeup_sender (Bench *bench)
+{
+  if (g_atomic_int_get (&bench->senderWaiting)) {
+    g_mutex_lock (&bench->lock);
+    g_cond_signal (&bench->cond);
+    g_mutex_unlock (&bench->lock);
+  }
+}
+
+/* Queues @msg, waiting for the sender while the queue is full. */
+static void
+queue_msg (Bench *bench, GstNvMsgBrokerMsg *msg)
+{
+  while (!gst_nvmsgbroker_queue_push (bench->queue, msg)) {
+    g_mutex_lock (&bench->lock);
+    g_atomic_int_set (&bench->producerWaiting, TRUE);
+    if (gst_nvmsgbroker_queue_depth (bench->queue) >=
+        gst_nvmsgbroker_queue_capacity (bench->queue)) {
+      if (g_atomic_int_get (&bench->senderWaiting))
+        g_cond_broadcast (&bench->cond);
+      g_cond_wait_until (&bench->cond, &bench->lock,
+          g_get_monotonic_time () + DO_WORK_INTERVAL_US);
+    }
+    g_atomic_int_set (&bench->producerWaiting, FALSE);
+    g_mutex_unlock (&bench->lock);
+  }
+  wakeup_sender (bench);
+}
+
+static bool
+parse_schema (const char *name, NvDsPayloadType *type)
+{
+  if (!strcmp (name, "full"))
+    *type = NVDS_PAYLOAD_DEEPSTREAM;
+  else if (!strcmp (name, "minimal"))
+    *type = NVDS_PAYLOAD_DEEPSTREAM_MINIMAL;
+  else if (!strcmp (name, "binary"))
+    *type = NVDS_PAYLOAD_DEEPSTREAM_BINARY;
+  else
+    return false;
+  return true;
+}
+
+int main (int argc, char *argv[])
+{
+  const char *msgconvLib = DEFAULT_MSGCONV_LIB;
+  const char *protoLib = DEFAULT_PROTO_LIB;
+  char *protoConfig = NULL;
+  char connStr[] = DEFAULT_CONN_STR;
+  char *conn = connStr;
+  char topic[] = DEFAULT_TOPIC;
+  NvDsPayloadType type = NVDS_PAYLOAD_DEEPSTREAM;
+  guint queueSize = DEFAULT_QUEUE_SIZE;
+  double rate = 0;
+  static SyntheticBatch batch;
+  static Bench bench;
+  MsgConvLib msgconv;
+  NvDsMsg2pCtx *ctx;
+  gboolean transferable;
+  GThread *sender;
+  gint64 start, end, cpuStart, cpuEnd, encodeCpu = 0, t;
+  guint64 bytes = 0;
+  int opt;
+
+  bench.topic = topic;
+  bench.count = DEFAULT_MESSAGES;
+
+  while ((opt = getopt (argc, argv, "l:p:c:s:t:n:r:q:m:y")) != -1) {
+    switch (opt) {
+      case 'l': msgconvLib = optarg; break;
+      case 'p': protoLib = optarg; break;
+      case 'c': protoConfig = optarg; break;
+      case 's': conn = optarg; break;
+      case 't': bench.topic = optarg; break;
+      case 'n': bench.count = strtoull (optarg, NULL, 10); break;
+      case 'r': rate = atof (optarg); break;
+      case 'q': queueSize = atoi (optarg); break;
+      case 'm':
+        if (!parse_schema (optarg, &type)) {
+          printf ("unknown schema %s\n", optarg);
+          return -1;
+        }
+        break;
+      case 'y': bench.sync = true; break;
+      default:
+        printf ("Usage: %s <msgconv config> [-l msgconv lib] [-p proto lib] "
+            "[-c proto config] [-s conn str] [-t topic] [-n messages] "
+            "[-r rate] [-q queue size] [-m full|minimal|binary] [-y]\n", argv[0]);
+        return -1;
+    }
+  }
+  if (optind >= argc || !bench.count) {
+    printf ("Usage: %s <msgconv config> [options]\n", argv[0]);
+    return -1;
+  }
+
+  if (!load_msgconv (msgconvLib, msgconv)) {
+    printf ("unable to open %s\n", msgconvLib);
+    return -1;
+  }
+  if (!load_proto (protoLib, bench.proto)) {
+    printf ("unable to open %s\n", protoLib);
+    return -1;
+  }
+
+  ctx = msgconv.ctx_create (argv[optind], type);
+  if (!ctx) {
+    printf ("Failed to create context with %s\n", argv[optind]);
+    return -1;
+  }
+  transferable = msgconv.payload_transferable && msgconv.payload_transferable (ctx);
+  bench.conn = bench.proto.connect (conn, NULL, protoConfig);
+  if (!bench.conn) {
+    printf ("unable to connect with %s\n", conn);
+    return -1;
+  }
+
+  fill_batch (batch);
+  bench.records.resize (bench.count);
+  bench.queue = gst_nvmsgbroker_queue_new (queueSize);
+  g_mutex_init (&bench.lock);
+  g_cond_init (&bench.cond);
+
+  start = g_get_monotonic_time ();
+  cpuStart = cpu_time_us (CLOCK_PROCESS_CPUTIME_ID);
+  sender = g_thread_new ("bench-sender", sender_thread, &bench);
+
+  for (guint64 i = 0; i < bench.count; i++) {
+    GstNvMsgBrokerMsg msg;
+    NvDsPayload *payload;
+
+    if (rate > 0) {
+      gint64 due = start + (gint64) (i * 1e6 / rate);
+      t = g_get_monotonic_time ();
+      if (due > t)
+        g_usleep (due - t);
+    }
+
+    bench.records[i].start = g_get_monotonic_time ();
+    t = cpu_time_us (CLOCK_THREAD_CPUTIME_ID);
+    payload = msgconv.generate (ctx, &batch.events[i % BATCH_SIZE], 1);
+    encodeCpu += cpu_time_us (CLOCK_THREAD_CPUTIME_ID) - t;
+    if (!payload) {
+      printf ("Failed to generate payload\n");
+      return -1;
+    }
+
+    /* take over payload data if allowed, as nvmsgbroker does */
+    msg.size = payload->payloadSize;
+    msg.key = msgconv.generate_key ?
+        msgconv.generate_key (ctx, &batch.events[i % BATCH_SIZE], 1) : NULL;
+    msg.enqueueTime = bench.records[i].start;
+    if (transferable) {
+      msg.data = payload->payload;
+      payload->payload = NULL;
+    } else
+      msg.data = g_memdup (payload->payload, payload->payloadSize);
+    bytes += msg.size;
+    msgconv.release (ctx, payload);
+
+    queue_msg (&bench, &msg);
+  }
+
+  g_atomic_int_set (&bench.producerDone, TRUE);
+  g_mutex_lock (&bench.lock);
+  g_cond_broadcast (&bench.cond);
+  g_mutex_unlock (&bench.lock);
+  g_thread_join (sender);
+
+  end = g_get_monotonic_time ();
+  cpuEnd = cpu_time_us (CLOCK_PROCESS_CPUTIME_ID);
+
+  std::vector<gint64> latencies (bench.count);
+  for (guint64 i = 0; i < bench.count; i++)
+    latencies[i] = bench.records[i].latency;
+  std::sort (latencies.begin (), latencies.end ());
+
+  printf ("messages:   %lu completed (%.1f bytes/msg), %lu failed, %lu rejected sends\n",
+      (unsigned long) bench.completed, (double) bytes / bench.count,
+      (unsigned long) bench.failed, (unsigned long) bench.rejected);
+  printf ("throughput: %.0f msgs/s\n", bench.count * 1e6 / MAX (end - start, 1));
+  printf ("latency:    p50 %ld us, p99 %ld us, max %ld us\n",
+      (long) latencies[bench.count / 2], (long) latencies[bench.count * 99 / 100],
+      (long) latencies[bench.count - 1]);
+  printf ("cpu:        %.3f us/msg (encode %.3f us/msg)\n",
+      (double) (cpuEnd - cpuStart) / bench.count, (double) encodeCpu / bench.count);
+
+  bench.proto.disconnect (bench.conn);
+  gst_nvmsgbroker_queue_free (bench.queue);
+  g_cond_clear (&bench.cond);
+  g_mutex_clear (&bench.lock);
+  msgconv.ctx_destroy (ctx);
+
+  return bench.completed == bench.count ? 0 : -1;
+}
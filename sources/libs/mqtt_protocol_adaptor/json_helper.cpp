@@ -89,7 +89,7 @@ int json_get_key_value(const char *msg, int msglen, const char *path, char *valu
    } else {
      nvds_log(MQTT_JSON_PARSER, LOG_ERR, "json entry corresponding to path \
                                is not string or not found\n");
-     FREE_AND_RETURN(strlen(value),root);
+     FREE_AND_RETURN(0,root);
    }
     
 }
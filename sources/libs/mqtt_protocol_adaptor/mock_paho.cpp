@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/**
+ * Stand-in for the Paho MQTTAsync APIs used by mqtt_client.cpp, acting as an
+ * in-process broker, to measure the adaptor without a broker. Linked instead
+ * of -lpaho-mqtt3a by the test programs.
+ *
+ * As with Paho, callbacks are invoked on a thread of the client. QoS 1
+ * messages are acknowledged after a fixed latency, QoS 0 messages as soon as
+ * the thread gets to them. Messages sent while disconnected are buffered and
+ * QoS 1 messages not acknowledged yet are sent again once reconnected, as
+ * with a persistent session.
+ * Settings are read from the environment when the client is created:
+ *   MQTT_MOCK_LATENCY_US       - acknowledgement latency in microseconds
+ *   MQTT_MOCK_DISCONNECT_EVERY - connection is lost after every N messages
+ *   MQTT_MOCK_RECONNECT_MS     - time to reconnect after a connection loss
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "MQTTAsync.h"
+
+#define MOCK_DEFAULT_LATENCY_US 200
+#define MOCK_DEFAULT_RECONNECT_MS 10
+
+typedef struct MockPublish {
+  MQTTAsync_onSuccess *onSuccess;
+  MQTTAsync_onFailure *onFailure;
+  void *context;
+  void *payload;
+  int qos;
+  gint64 due_time;
+  struct MockPublish *next;
+} MockPublish;
+
+typedef struct {
+  void *context;
+  MQTTAsync_connectionLost *connection_lost;
+  MQTTAsync_connected *connected_cb;
+  int send_while_disconnected;
+  int max_buffered;
+  int max_inflight;
+  gint64 latency_us;
+  guint64 disconnect_every;
+  gint64 reconnect_us;
+
+  GMutex lock;
+  GCond cond;
+  GThread *thread;
+  gboolean running;
+  gboolean connected;
+  /* pending connect / disconnect requests */
+  MQTTAsync_connectOptions connect_req;
+  gboolean connect_pending;
+  MQTTAsync_disconnectOptions disconnect_req;
+  gboolean disconnect_pending;
+  gint64 disconnect_deadline;
+  /* messages sent and not acknowledged, in order */
+  MockPublish *head;
+  MockPublish *tail;
+  int queued;
+  int inflight;
+  guint64 published;
+  MockPublish *free_list;
+} MockClient;
+
+static gint64 mock_env(const char *name, gint64 def)
+{
+  const char *val = getenv(name);
+  return val ? atoll(val) : def;
+}
+
+/* Takes the messages due for acknowledgement; called with lock held */
+static MockPublish *mock_take_due(MockClient *mc, gint64 now, MockPublish **last)
+{
+  MockPublish *due = NULL;
+
+  *last = NULL;
+  while (mc->head && mc->head->due_time <= now) {
+    MockPublish *m = mc->head;
+    mc->head = m->next;
+    if (!mc->head)
+      mc->tail = NULL;
+    m->next = NULL;
+    if (*last)
+      (*last)->next = m;
+    else
+      due = m;
+    *last = m;
+    mc->queued--;
+    if (m->qos > 0)
+      mc->inflight--;
+    mc->published++;
+    if (mc->disconnect_every && mc->published % mc->disconnect_every == 0)
+      break;
+  }
+  return due;
+}
+
+/* Connection loss: pending messages are sent again after reconnect. */
+static void mock_connection_loss(MockClient *mc)
+{
+  MockPublish *m;
+
+  g_mutex_lock(&mc->lock);
+  mc->connected = FALSE;
+  g_mutex_unlock(&mc->lock);
+  if (mc->connection_lost)
+    mc->connection_lost(mc->context, (char *) "mock connection loss");
+
+  g_usleep(mc->reconnect_us);
+
+  g_mutex_lock(&mc->lock);
+  mc->connected = TRUE;
+  for (m = mc->head; m; m = m->next)
+    m->due_time = g_get_monotonic_time() + (m->qos ? mc->latency_us : 0);
+  g_mutex_unlock(&mc->lock);
+  if (mc->connected_cb)
+    mc->connected_cb(mc->context, (char *) "automatic reconnect");
+}
+
+static gpointer mock_thread(gpointer data)
+{
+  MockClient *mc = (MockClient *) data;
+  MQTTAsync_successData success;
+
+  memset(&success, 0, sizeof(success));
+
+  g_mutex_lock(&mc->lock);
+  while (mc->running) {
+    gint64 now = g_get_monotonic_time();
+    MockPublish *due, *last, *m;
+    bool lost;
+
+    if (mc->connect_pending) {
+      MQTTAsync_connectOptions req = mc->connect_req;
+      mc->connect_pending = FALSE;
+      mc->connected = TRUE;
+      g_mutex_unlock(&mc->lock);
+      if (req.onSuccess)
+        req.onSuccess(req.context, &success);
+      g_mutex_lock(&mc->lock);
+      continue;
+    }
+
+    due = mc->connected ? mock_take_due(mc, now, &last) : NULL;
+    if (due) {
+      lost = mc->disconnect_every && mc->published % mc->disconnect_every == 0;
+      g_cond_broadcast(&mc->cond);
+      g_mutex_unlock(&mc->lock);
+
+      for (m = due; m; m = m->next) {
+        if (m->onSuccess)
+          m->onSuccess(m->context, &success);
+        free(m->payload);
+      }
+      if (lost)
+        mock_connection_loss(mc);
+
+      g_mutex_lock(&mc->lock);
+      last->next = mc->free_list;
+      mc->free_list = due;
+      continue;
+    }
+
+    if (mc->disconnect_pending && (!mc->head || now >= mc->disconnect_deadline)) {
+      MQTTAsync_disconnectOptions req = mc->disconnect_req;
+      mc->disconnect_pending = FALSE;
+      mc->connected = FALSE;
+      g_mutex_unlock(&mc->lock);
+      if (req.onSuccess)
+        req.onSuccess(req.context, &success);
+      g_mutex_lock(&mc->lock);
+      continue;
+    }
+
+    gint64 wake_time = now + G_TIME_SPAN_SECOND;
+    if (mc->connected && mc->head && mc->head->due_time < wake_time)
+      wake_time = mc->head->due_time;
+    if (mc->disconnect_pending && mc->disconnect_deadline < wake_time)
+      wake_time = mc->disconnect_deadline;
+    g_cond_wait_until(&mc->cond, &mc->lock, wake_time);
+  }
+  g_mutex_unlock(&mc->lock);
+  return NULL;
+}
+
+int MQTTAsync_createWithOptions(MQTTAsync *handle, const char *serverURI, const char *clientId,
+    int persistence_type, void *persistence_context, MQTTAsync_createOptions *options)
+{
+  MockClient *mc = (MockClient *) calloc(1, sizeof(MockClient));
+
+  if (options) {
+    mc->send_while_disconnected = options->sendWhileDisconnected;
+    mc->max_buffered = options->maxBufferedMessages;
+  }
+  mc->latency_us = mock_env("MQTT_MOCK_LATENCY_US", MOCK_DEFAULT_LATENCY_US);
+  mc->disconnect_every = mock_env("MQTT_MOCK_DISCONNECT_EVERY", 0);
+  mc->reconnect_us = mock_env("MQTT_MOCK_RECONNECT_MS", MOCK_DEFAULT_RECONNECT_MS) * 1000;
+  g_mutex_init(&mc->lock);
+  g_cond_init(&mc->cond);
+  mc->running = TRUE;
+  mc->thread = g_thread_new("mock-paho", mock_thread, mc);
+  *handle = mc;
+  return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_create(MQTTAsync *handle, const char *serverURI, const char *clientId,
+    int persistence_type, void *persistence_context)
+{
+  return MQTTAsync_createWithOptions(handle, serverURI, clientId, persistence_type,
+      persistence_context, NULL);
+}
+
+int MQTTAsync_setCallbacks(MQTTAsync handle, void *context, MQTTAsync_connectionLost *cl,
+    MQTTAsync_messageArrived *ma, MQTTAsync_deliveryComplete *dc)
+{
+  MockClient *mc = (MockClient *) handle;
+
+  if (!ma)
+    return MQTTASYNC_FAILURE;
+  mc->context = context;
+  mc->connection_lost = cl;
+  return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_setConnected(MQTTAsync handle, void *context, MQTTAsync_connected *co)
+{
+  MockClient *mc = (MockClient *) handle;
+
+  mc->context = context;
+  mc->connected_cb = co;
+  return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_connect(MQTTAsync handle, const MQTTAsync_connectOptions *options)
+{
+  MockClient *mc = (MockClient *) handle;
+
+  g_mutex_lock(&mc->lock);
+  mc->max_inflight = options->maxInflight;
+  mc->connect_req = *options;
+  mc->connect_pending = TRUE;
+  g_cond_broadcast(&mc->cond);
+  g_mutex_unlock(&mc->lock);
+  return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_disconnect(MQTTAsync handle, const MQTTAsync_disconnectOptions *options)
+{
+  MockClient *mc = (MockClient *) handle;
+
+  g_mutex_lock(&mc->lock);
+  mc->disconnect_req = *options;
+  mc->disconnect_deadline = g_get_monotonic_time() + (gint64) options->timeout * 1000;
+  mc->disconnect_pending = TRUE;
+  g_cond_broadcast(&mc->cond);
+  g_mutex_unlock(&mc->lock);
+  return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_isConnected(MQTTAsync handle)
+{
+  MockClient *mc = (MockClient *) handle;
+  int connected;
+
+  g_mutex_lock(&mc->lock);
+  connected = mc->connected;
+  g_mutex_unlock(&mc->lock);
+  return connected;
+}
+
+int MQTTAsync_sendMessage(MQTTAsync handle, const char *destinationName,
+    const MQTTAsync_message *msg, MQTTAsync_responseOptions *response)
+{
+  MockClient *mc = (MockClient *) handle;
+  MockPublish *m;
+
+  if (msg->qos < 0 || msg->qos > 2)
+    return MQTTASYNC_BAD_QOS;
+
+  g_mutex_lock(&mc->lock);
+  if (!mc->connected && (!mc->send_while_disconnected || mc->queued >= mc->max_buffered)) {
+    g_mutex_unlock(&mc->lock);
+    return mc->send_while_disconnected ? MQTTASYNC_MAX_BUFFERED_MESSAGES : MQTTASYNC_DISCONNECTED;
+  }
+  if (msg->qos > 0 && mc->inflight >= mc->max_inflight) {
+    g_mutex_unlock(&mc->lock);
+    return MQTTASYNC_MAX_MESSAGES_INFLIGHT;
+  }
+  m = mc->free_list;
+  if (m)
+    mc->free_list = m->next;
+  else
+    m = (MockPublish *) malloc(sizeof(MockPublish));
+
+  /* payload is copied as Paho does */
+  m->payload = malloc(msg->payloadlen);
+  memcpy(m->payload, msg->payload, msg->payloadlen);
+  m->qos = msg->qos;
+  m->onSuccess = response ? response->onSuccess : NULL;
+  m->onFailure = response ? response->onFailure : NULL;
+  m->context = response ? response->context : NULL;
+  m->due_time = g_get_monotonic_time() + (msg->qos ? mc->latency_us : 0);
+  m->next = NULL;
+  if (mc->tail)
+    mc->tail->next = m;
+  else
+    mc->head = m;
+  mc->tail = m;
+  mc->queued++;
+  if (msg->qos > 0)
+    mc->inflight++;
+  g_cond_broadcast(&mc->cond);
+  g_mutex_unlock(&mc->lock);
+  return MQTTASYNC_SUCCESS;
+}
+
+void MQTTAsync_destroy(MQTTAsync *handle)
+{
+  MockClient *mc = (MockClient *) *handle;
+  MockPublish *m, *next;
+
+  if (!mc)
+    return;
+
+  g_mutex_lock(&mc->lock);
+  mc->running = FALSE;
+  g_cond_broadcast(&mc->cond);
+  g_mutex_unlock(&mc->lock);
+  g_thread_join(mc->thread);
+
+  /* messages not acknowledged are dropped without callback */
+  for (m = mc->head; m; m = next) {
+    next = m->next;
+    free(m->payload);
+    free(m);
+  }
+  for (m = mc->free_list; m; m = next) {
+    next = m->next;
+    free(m);
+  }
+  g_mutex_clear(&mc->lock);
+  g_cond_clear(&mc->cond);
+  free(mc);
+  *handle = NULL;
+}
+
+void MQTTAsync_freeMessage(MQTTAsync_message **msg)
+{
+  free((*msg)->payload);
+  free(*msg);
+  *msg = NULL;
+}
+
+void MQTTAsync_free(void *ptr)
+{
+  free(ptr);
+}
+
+const char *MQTTAsync_strerror(int code)
+{
+  switch (code) {
+    case MQTTASYNC_SUCCESS:
+      return "Success";
+    case MQTTASYNC_DISCONNECTED:
+      return "Client disconnected";
+    case MQTTASYNC_MAX_MESSAGES_INFLIGHT:
+      return "Maximum in-flight messages amount reached";
+    case MQTTASYNC_BAD_QOS:
+      return "Invalid QoS value";
+    case MQTTASYNC_MAX_BUFFERED_MESSAGES:
+      return "Maximum buffered messages amount reached";
+    default:
+      return "Mock: error";
+  }
+}
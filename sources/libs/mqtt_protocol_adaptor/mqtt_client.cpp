@@ -8,363 +8,663 @@
  * license agreement from NVIDIA Corporation is strictly prohibited.
  *
  */
-/*
- * librdkafka - Apache Kafka C library
- *
- * Copyright (c) 2017, Magnus Edenhill
- * All rights reserved.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions are met:
- *
- * 1. Redistributions of source code must retain the above copyright notice,
- *    this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright notice,
- *    this list of conditions and the following disclaimer in the documentation
- *    and/or other materials provided with the distribution.
- *
- * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
- * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
- * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
- * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
- * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
- * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
- * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
- * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
- * POSSIBILITY OF SUCH DAMAGE.
- */
 
 /**
- * kafka client based on Simple Apache Kafka producer from librdkafka
- * (https://github.com/edenhill/librdkafka)
+ * mqtt client based on the asynchronous client of Eclipse Paho
+ * (https://github.com/eclipse/paho.mqtt.c)
  */
 
 #include <stdio.h>
-#include <signal.h>
 #include <string.h>
-#include <sys/time.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <glib.h>
-#include "MQTTClient.h"
+#include "MQTTAsync.h"
 #include "nvds_logger.h"
 #include "mqtt_client.h"
 
+#define MQTT_DEFAULT_QOS 1
+#define MQTT_DEFAULT_MAX_INFLIGHT 64
+#define MQTT_DEFAULT_KEEP_ALIVE 60
+#define MQTT_DEFAULT_CONNECT_TIMEOUT 10
+#define MQTT_DEFAULT_RECONNECT_MIN 1
+#define MQTT_DEFAULT_RECONNECT_MAX 60
+#define MQTT_DEFAULT_MAX_BUFFERED 10000
+#define MQTT_DEFAULT_SEND_TIMEOUT_MS 10000
+
+/* Number of send completions allocated at a time. */
+#define MQTT_COMPL_CHUNK_SIZE 256
+
+typedef struct NvDsMqttClientHandle NvDsMqttClientHandle;
+
 /**
- * @brief Message delivery report callback.
- *
- * This callback is called exactly once per message, indicating if
- * the message was succesfully delivered
- * (rkmessage->err == RD_KAFKA_RESP_ERR_NO_ERROR) or permanently
- * failed delivery (rkmessage->err != RD_KAFKA_RESP_ERR_NO_ERROR).
- *
- * The callback is triggered from rd_kafka_poll() and executes on
- * the application's thread.
+ * Sync send(s) waited for by a sender. Referenced by the sender and by every
+ * pending send, so that a sender giving up on timeout doesn't leave pending
+ * sends with a dangling pointer.
  */
-static void dr_msg_cb (rd_kafka_t *rk,
-                       const rd_kafka_message_t *rkmessage, void *opaque) {
-  NvDsMsgApiErrorType dserr;
-  if (rkmessage->err) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Message delivery failed: %s\n", \
-	     rd_kafka_err2str(rkmessage->err));
-  }
-  else
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, "Message delivered (%zd bytes, " \
-                        "partition %d)\n", rkmessage->len, rkmessage->partition);
+typedef struct {
+  unsigned int pending;
+  unsigned int refs;
+  NvDsMsgApiErrorType err;
+} NvDsMqttSyncWait;
+
+typedef enum {
+  MQTT_COMPL_FREE,
+  /* sent, not acknowledged yet */
+  MQTT_COMPL_PENDING,
+  /* acknowledged, to be reported from poll */
+  MQTT_COMPL_DONE
+} NvDsMqttComplState;
 
-  switch (rkmessage->err) {
-    case RD_KAFKA_RESP_ERR_NO_ERROR:
-        dserr = NVDS_MSGAPI_OK;
-        break;
+/**
+ * Completion of a send, passed as context to the Paho callbacks.
+ */
+typedef struct NvDsMqttSendCompl {
+  NvDsMqttClientHandle *mh;
+  NvDsMqttComplState state;
+  /* async send */
+  nvds_msgapi_send_cb_t cb;
+  void *user_ptr;
+  NvDsMsgApiErrorType err;
+  /* sync send */
+  NvDsMqttSyncWait *wait;
+  struct NvDsMqttSendCompl *next;
+} NvDsMqttSendCompl;
+
+struct NvDsMqttClientHandle {
+  MQTTAsync client;
+  char *uri;
+  char *client_id;
+  char *username;
+  char *password;
+  char *persistence_dir;
+  int qos;
+  unsigned int max_inflight;
+  int clean_session;
+  int keep_alive;
+  int connect_timeout;
+  int reconnect_min;
+  int reconnect_max;
+  int max_buffered;
+  gint64 send_timeout;
+
+  GMutex lock;
+  /* signalled on completions and connection state changes */
+  GCond cond;
+  /* sends in the in-flight window */
+  unsigned int inflight;
+  gboolean connected;
+  gboolean connect_done;
+  gboolean disconnect_done;
+  /* completions to report, oldest first */
+  NvDsMqttSendCompl *done_head;
+  NvDsMqttSendCompl *done_tail;
+  NvDsMqttSendCompl *free_list;
+  NvDsMqttSendCompl **chunks;
+  unsigned int num_chunks;
+};
 
-   case RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_OR_PART:
-        dserr = NVDS_MSGAPI_UNKNOWN_TOPIC;
-        break;
+/**
+ * Takes a completion from the free list; called with lock held
+ */
+static NvDsMqttSendCompl *mqtt_compl_acquire(NvDsMqttClientHandle *mh)
+{
+  NvDsMqttSendCompl *sc;
 
-    default:
-        dserr = NVDS_MSGAPI_ERR;
-        break;
-  };
-  ((NvDsKafkaSendCompl *)(rkmessage->_private))->sendcomplete(dserr);
+  if (!mh->free_list) {
+    NvDsMqttSendCompl *chunk = g_new0(NvDsMqttSendCompl, MQTT_COMPL_CHUNK_SIZE);
 
-  delete ((NvDsKafkaSendCompl *)(rkmessage->_private));
+    mh->chunks = (NvDsMqttSendCompl **) g_realloc(mh->chunks, (mh->num_chunks + 1) * sizeof(*mh->chunks));
+    mh->chunks[mh->num_chunks++] = chunk;
+    for (unsigned int i = 0; i < MQTT_COMPL_CHUNK_SIZE; i++) {
+      chunk[i].mh = mh;
+      chunk[i].next = mh->free_list;
+      mh->free_list = &chunk[i];
+    }
+  }
+  sc = mh->free_list;
+  mh->free_list = sc->next;
+  sc->state = MQTT_COMPL_PENDING;
+  sc->next = NULL;
+  return sc;
+}
 
+/**
+ * Returns a completion to the free list; called with lock held
+ */
+static void mqtt_compl_release(NvDsMqttClientHandle *mh, NvDsMqttSendCompl *sc)
+{
+  sc->state = MQTT_COMPL_FREE;
+  sc->wait = NULL;
+  sc->next = mh->free_list;
+  mh->free_list = sc;
 }
 
-typedef struct {
-   rd_kafka_t *producer;         /* Producer instance handle */
-   rd_kafka_topic_t *topic;  /* Topic object */
-   rd_kafka_conf_t *conf;  /* Temporary configuration object */
-   char topic_name[255];
-} NvDsKafkaClientHandle;
-
-NvDsKafkaSyncSendCompl::NvDsKafkaSyncSendCompl(uint8_t *cflag) {
-  compl_flag = cflag;
+/**
+ * Drops a reference to wait; called with lock held
+ */
+static void mqtt_wait_unref(NvDsMqttSyncWait *wait)
+{
+  if (!--wait->refs)
+    g_free(wait);
 }
 
 /**
- * Method that gets invoked when sync send operation is completed
+ * Marks the send as completed. Invoked on a thread of Paho, once the
+ * message is acknowledged for QoS 1, or written for QoS 0.
  */
-void NvDsKafkaSyncSendCompl::sendcomplete(NvDsMsgApiErrorType senderr) {
-  *compl_flag = 1;
-  err = senderr;
+static void mqtt_send_complete(NvDsMqttSendCompl *sc, NvDsMsgApiErrorType err)
+{
+  NvDsMqttClientHandle *mh = sc->mh;
+
+  g_mutex_lock(&mh->lock);
+  mh->inflight--;
+  if (sc->wait) {
+    if (sc->wait->err == NVDS_MSGAPI_OK)
+      sc->wait->err = err;
+    sc->wait->pending--;
+    mqtt_wait_unref(sc->wait);
+    mqtt_compl_release(mh, sc);
+  } else {
+    sc->err = err;
+    sc->state = MQTT_COMPL_DONE;
+    if (mh->done_tail)
+      mh->done_tail->next = sc;
+    else
+      mh->done_head = sc;
+    mh->done_tail = sc;
+  }
+  g_cond_broadcast(&mh->cond);
+  g_mutex_unlock(&mh->lock);
+}
+
+static void mqtt_on_send_success(void *context, MQTTAsync_successData *response)
+{
+  mqtt_send_complete((NvDsMqttSendCompl *) context, NVDS_MSGAPI_OK);
 }
 
+static void mqtt_on_send_failure(void *context, MQTTAsync_failureData *response)
+{
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Message delivery failed: %d %s\n", response ? response->code : 0, \
+           (response && response->message) ? response->message : "");
+  mqtt_send_complete((NvDsMqttSendCompl *) context, NVDS_MSGAPI_ERR);
+}
 
-void NvDsKafkaSendCompl::sendcomplete(NvDsMsgApiErrorType senderr) {
-  printf("wrong class\n");
+static void mqtt_on_connect_success(void *context, MQTTAsync_successData *response)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) context;
+
+  g_mutex_lock(&mh->lock);
+  mh->connected = TRUE;
+  mh->connect_done = TRUE;
+  g_cond_broadcast(&mh->cond);
+  g_mutex_unlock(&mh->lock);
 }
 
-NvDsMsgApiErrorType NvDsKafkaSendCompl::get_err() {
-  return NVDS_MSGAPI_OK;
+static void mqtt_on_connect_failure(void *context, MQTTAsync_failureData *response)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) context;
+
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Connection to %s failed: %d %s\n", mh->uri, \
+           response ? response->code : 0, (response && response->message) ? response->message : "");
+  g_mutex_lock(&mh->lock);
+  mh->connect_done = TRUE;
+  g_cond_broadcast(&mh->cond);
+  g_mutex_unlock(&mh->lock);
 }
 
 /**
- * Method that gets invoked when sync send operation is completed
+ * Paho reconnects automatically; messages sent meanwhile are buffered and
+ * QoS 1 messages not acknowledged are sent again once the session resumes.
  */
-NvDsMsgApiErrorType NvDsKafkaSyncSendCompl::get_err() {
-  return err;
+static void mqtt_on_connection_lost(void *context, char *cause)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) context;
+
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Connection to %s lost: %s; reconnecting\n", mh->uri, cause ? cause : "");
+  g_mutex_lock(&mh->lock);
+  mh->connected = FALSE;
+  g_mutex_unlock(&mh->lock);
+}
+
+static void mqtt_on_connected(void *context, char *cause)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) context;
+
+  g_mutex_lock(&mh->lock);
+  if (mh->connect_done)
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "Reconnected to %s\n", mh->uri);
+  mh->connected = TRUE;
+  g_cond_broadcast(&mh->cond);
+  g_mutex_unlock(&mh->lock);
+}
+
+/* Required by Paho; nothing is subscribed to. */
+static int mqtt_on_message(void *context, char *topic, int topic_len, MQTTAsync_message *message)
+{
+  MQTTAsync_freeMessage(&message);
+  MQTTAsync_free(topic);
+  return 1;
+}
+
+static void mqtt_on_disconnect(void *context, MQTTAsync_successData *response)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) context;
+
+  g_mutex_lock(&mh->lock);
+  mh->disconnect_done = TRUE;
+  g_cond_broadcast(&mh->cond);
+  g_mutex_unlock(&mh->lock);
 }
 
+static void mqtt_on_disconnect_failure(void *context, MQTTAsync_failureData *response)
+{
+  mqtt_on_disconnect(context, NULL);
+}
 
-NvDsKafkaAsyncSendCompl::NvDsKafkaAsyncSendCompl(void *ctx, nvds_msgapi_send_cb_t cb) {
-  user_ptr = ctx;
-  async_send_cb = cb;
+void *nvds_mqtt_client_init(const char *uri)
+{
+  NvDsMqttClientHandle *mh;
+  char host[256];
+
+  if (!uri) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Broker uri is null. init failed\n");
+    return NULL;
+  }
+
+  mh = g_new0(NvDsMqttClientHandle, 1);
+  mh->uri = g_strdup(uri);
+  if (gethostname(host, sizeof(host)))
+    strcpy(host, "localhost");
+  host[sizeof(host) - 1] = '\0';
+  mh->client_id = g_strdup_printf("nvds-%s", host);
+  mh->qos = MQTT_DEFAULT_QOS;
+  mh->max_inflight = MQTT_DEFAULT_MAX_INFLIGHT;
+  mh->keep_alive = MQTT_DEFAULT_KEEP_ALIVE;
+  mh->connect_timeout = MQTT_DEFAULT_CONNECT_TIMEOUT;
+  mh->reconnect_min = MQTT_DEFAULT_RECONNECT_MIN;
+  mh->reconnect_max = MQTT_DEFAULT_RECONNECT_MAX;
+  mh->max_buffered = MQTT_DEFAULT_MAX_BUFFERED;
+  mh->send_timeout = MQTT_DEFAULT_SEND_TIMEOUT_MS * G_TIME_SPAN_MILLISECOND;
+  g_mutex_init(&mh->lock);
+  g_cond_init(&mh->cond);
+  return mh;
+}
+
+NvDsMsgApiErrorType nvds_mqtt_client_setconf(void *mv, const char *key, const char *val)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) mv;
+  int ival = atoi(val);
+
+  if (!strcmp(key, "qos")) {
+    if (ival != 0 && ival != 1) {
+      nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Unsupported qos %s, has to be 0 or 1\n", val);
+      return NVDS_MSGAPI_ERR;
+    }
+    mh->qos = ival;
+  } else if (!strcmp(key, "max-inflight")) {
+    mh->max_inflight = ival > 0 ? ival : 1;
+  } else if (!strcmp(key, "client-id")) {
+    g_free(mh->client_id);
+    mh->client_id = g_strdup(val);
+  } else if (!strcmp(key, "clean-session")) {
+    mh->clean_session = ival != 0;
+  } else if (!strcmp(key, "keep-alive")) {
+    mh->keep_alive = ival;
+  } else if (!strcmp(key, "connect-timeout")) {
+    mh->connect_timeout = ival;
+  } else if (!strcmp(key, "reconnect-min")) {
+    mh->reconnect_min = ival;
+  } else if (!strcmp(key, "reconnect-max")) {
+    mh->reconnect_max = ival;
+  } else if (!strcmp(key, "max-buffered")) {
+    mh->max_buffered = ival;
+  } else if (!strcmp(key, "persistence-dir")) {
+    g_free(mh->persistence_dir);
+    mh->persistence_dir = *val ? g_strdup(val) : NULL;
+  } else if (!strcmp(key, "send-timeout-ms")) {
+    mh->send_timeout = (gint64) ival * G_TIME_SPAN_MILLISECOND;
+  } else if (!strcmp(key, "username")) {
+    g_free(mh->username);
+    mh->username = g_strdup(val);
+  } else if (!strcmp(key, "password")) {
+    g_free(mh->password);
+    mh->password = g_strdup(val);
+  } else {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Unknown config setting %s\n", key);
+    return NVDS_MSGAPI_ERR;
+  }
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "set config setting %s to %s\n", key, \
+           strcmp(key, "password") ? val : "***");
+  return NVDS_MSGAPI_OK;
 }
 
 /**
- * Method that gets invoked when async send operation is completed
+  Creates the Paho client and connects to the broker, waiting for the
+  connection to be established.
  */
-void NvDsKafkaAsyncSendCompl::sendcomplete(NvDsMsgApiErrorType senderr) {
-  // simply call any registered callback
-  if (async_send_cb)
-    async_send_cb(user_ptr, senderr);
+NvDsMsgApiErrorType nvds_mqtt_client_launch(void *mv)
+{
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) mv;
+  MQTTAsync_createOptions create_opts = MQTTAsync_createOptions_initializer;
+  MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
+  gint64 end_time;
+  gboolean connected;
+  int rc;
+
+  /* sends while reconnecting are buffered by Paho */
+  create_opts.sendWhileDisconnected = 1;
+  create_opts.maxBufferedMessages = mh->max_buffered;
+
+  rc = MQTTAsync_createWithOptions(&mh->client, mh->uri, mh->client_id,
+      mh->persistence_dir ? MQTTCLIENT_PERSISTENCE_DEFAULT : MQTTCLIENT_PERSISTENCE_NONE,
+      mh->persistence_dir, &create_opts);
+  if (rc != MQTTASYNC_SUCCESS) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Failed to create mqtt client: %s\n", MQTTAsync_strerror(rc));
+    mh->client = NULL;
+    return NVDS_MSGAPI_ERR;
+  }
+
+  MQTTAsync_setCallbacks(mh->client, mh, mqtt_on_connection_lost, mqtt_on_message, NULL);
+  MQTTAsync_setConnected(mh->client, mh, mqtt_on_connected);
+
+  conn_opts.keepAliveInterval = mh->keep_alive;
+  conn_opts.cleansession = mh->clean_session;
+  /* Paho limit for QoS 1 messages, window is enforced by the adaptor */
+  conn_opts.maxInflight = mh->max_inflight;
+  conn_opts.connectTimeout = mh->connect_timeout;
+  conn_opts.username = mh->username;
+  conn_opts.password = mh->password;
+  conn_opts.automaticReconnect = 1;
+  conn_opts.minRetryInterval = mh->reconnect_min;
+  conn_opts.maxRetryInterval = mh->reconnect_max;
+  conn_opts.onSuccess = mqtt_on_connect_success;
+  conn_opts.onFailure = mqtt_on_connect_failure;
+  conn_opts.context = mh;
+
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "Connecting to mqtt broker %s as %s, qos %d, %s session\n", \
+           mh->uri, mh->client_id, mh->qos, mh->clean_session ? "clean" : "persistent");
+
+  rc = MQTTAsync_connect(mh->client, &conn_opts);
+  if (rc != MQTTASYNC_SUCCESS) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Failed to start connect: %s\n", MQTTAsync_strerror(rc));
+    MQTTAsync_destroy(&mh->client);
+    mh->client = NULL;
+    return NVDS_MSGAPI_ERR;
+  }
+
+  end_time = g_get_monotonic_time() + (mh->connect_timeout + 1) * G_TIME_SPAN_SECOND;
+  g_mutex_lock(&mh->lock);
+  while (!mh->connect_done && g_cond_wait_until(&mh->cond, &mh->lock, end_time))
+    ;
+  connected = mh->connected;
+  g_mutex_unlock(&mh->lock);
+
+  if (!connected) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Unable to connect to mqtt broker %s\n", mh->uri);
+    MQTTAsync_destroy(&mh->client);
+    mh->client = NULL;
+    return NVDS_MSGAPI_ERR;
+  }
+  return NVDS_MSGAPI_OK;
 }
 
-/*
- * The kafka protocol adaptor expects the client to manage handle usage and retirement.
- * Specifically, client has to ensure that once a handle is retired through disconnect,
- * that it does not get used for either send or do_work.
- * While the library iplements a best effort mechanism to ensure that calling into these
- * functions with retired handles is  gracefully handled, this is not done in a thread-safe
- * manner
- *
- * Also, note thatrdkafka is inherently thread safe and therefore there is no need to implement separate
- * locking mechanisms in the kafka protocol adaptor for methods calling directly in rdkafka
- *
+/**
+ * Waits for room in the in-flight window and reserves a completion for the
+ * send; called with lock held. Returns NULL on timeout.
  */
-void *nvds_kafka_client_init(char *brokers, char *topic) {
-   NvDsKafkaClientHandle *kh = NULL;
-   rd_kafka_conf_t *conf;  /* Temporary configuration object */
-   char errstr[512];
-
-   nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "Connecting to kafka broker: \
-                            %s on topic %s\n", brokers, topic);
-
-   if ((brokers == NULL) || (topic == NULL)) {
-     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Broker and/or topic is null. init failed\n");
-     return NULL;
-   }
-
-
-   /*
-     Create Kafka client configuration place-holder
-   */
-   conf = rd_kafka_conf_new();
-
-   /* Set bootstrap broker(s) as a comma-separated list of
-          host or host:port (default port 9092).
-    * librdkafka will use the bootstrap brokers to acquire the full
-          set of brokers from the cluster. */
-   if (rd_kafka_conf_set(conf, "bootstrap.servers", brokers,
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Error connecting kafka broker: %s\n",errstr);
-       return NULL;
+static NvDsMqttSendCompl *mqtt_client_reserve(NvDsMqttClientHandle *mh, gint64 end_time)
+{
+  while (mh->inflight >= mh->max_inflight) {
+    if (!g_cond_wait_until(&mh->cond, &mh->lock, end_time) && mh->inflight >= mh->max_inflight) {
+      nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Timed out waiting for room in in-flight window\n");
+      return NULL;
     }
-   //else
-   //    nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "Connection to broker succeeded\n");
-
-    /* Set the delivery report callback.
-     * This callback will be called once per message to inform
-         the application if delivery succeeded or failed.
-
-     * See dr_msg_cb() above. */
-    rd_kafka_conf_set_dr_msg_cb(conf, dr_msg_cb);
-
-    kh = (NvDsKafkaClientHandle *)(malloc(sizeof(NvDsKafkaClientHandle)));
-     if (kh == NULL) {
-       //free rkt, rk, conf
-       return NULL;
-     }
-
-     kh->producer = NULL;
-     kh->topic = NULL;
-     kh->conf = conf;
-     snprintf(kh->topic_name, sizeof(kh->topic_name), "%s",topic);
-     return (void *)kh;
+  }
+  mh->inflight++;
+  return mqtt_compl_acquire(mh);
+}
+
+/**
+ * Publishes the message, completion is notified to sc from the Paho
+ * callbacks if the message is accepted. Paho copies the payload.
+ */
+static NvDsMsgApiErrorType mqtt_client_publish(NvDsMqttClientHandle *mh, const char *topic, const uint8_t *payload, \
+                                               int len, NvDsMqttSendCompl *sc)
+{
+  MQTTAsync_message msg = MQTTAsync_message_initializer;
+  MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+  int rc;
+
+  msg.payload = (void *) payload;
+  msg.payloadlen = len;
+  msg.qos = mh->qos;
+  msg.retained = 0;
+  opts.onSuccess = mqtt_on_send_success;
+  opts.onFailure = mqtt_on_send_failure;
+  opts.context = sc;
+
+  rc = MQTTAsync_sendMessage(mh->client, topic, &msg, &opts);
+  if (rc != MQTTASYNC_SUCCESS) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Failed to publish on topic <%s>: %s\n", topic, MQTTAsync_strerror(rc));
+    g_mutex_lock(&mh->lock);
+    mh->inflight--;
+    if (sc->wait)
+      mqtt_wait_unref(sc->wait);
+    mqtt_compl_release(mh, sc);
+    g_cond_broadcast(&mh->cond);
+    g_mutex_unlock(&mh->lock);
+    return NVDS_MSGAPI_ERR;
+  }
+  return NVDS_MSGAPI_OK;
+}
+
+/**
+ * Blocks till the sync send(s) are completed or end_time is reached.
+ */
+static NvDsMsgApiErrorType mqtt_client_wait(NvDsMqttClientHandle *mh, NvDsMqttSyncWait *wait, gint64 end_time)
+{
+  NvDsMsgApiErrorType err;
+
+  g_mutex_lock(&mh->lock);
+  while (wait->pending && g_cond_wait_until(&mh->cond, &mh->lock, end_time))
+    ;
+  if (wait->pending)
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Timed out waiting for %u send(s) to complete\n", wait->pending);
+  err = wait->pending ? NVDS_MSGAPI_ERR : wait->err;
+  mqtt_wait_unref(wait);
+  g_mutex_unlock(&mh->lock);
+  return err;
 }
 
 //There could be several synchronous and asychronous send operations in flight.
-//Once a send operation callback is received the course of action  depends on if it's sync or async
-// -- if it's sync then the associated completion flag should  be set
-// -- if it's asynchronous then completion callback from the user should be called along with context
-NvDsMsgApiErrorType nvds_kafka_client_send(void *kv,  const uint8_t *payload, int len, int sync, void *ctx, nvds_msgapi_send_cb_t cb, char *key, int keylen)
+//Once a send operation is acknowledged the course of action depends on if it's sync or async
+// -- if it's sync then the waiting sender is signalled
+// -- if it's asynchronous then completion callback from the user is called from poll
+// If payload_free is set the payload is owned by the send and released with it.
+NvDsMsgApiErrorType nvds_mqtt_client_send(void *mv, const char *topic, const uint8_t *payload, int len, int sync, \
+                                          void *ctx, nvds_msgapi_send_cb_t cb, void (*payload_free)(void *))
 {
-  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
-  uint8_t done = 0;
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) mv;
+  gint64 end_time;
+  NvDsMqttSyncWait *wait = NULL;
+  NvDsMqttSendCompl *sc;
+  NvDsMsgApiErrorType err;
 
-  NvDsKafkaSendCompl *scd;
-  if (sync) {
-    NvDsKafkaSyncSendCompl *sc= new NvDsKafkaSyncSendCompl(&done);
-    scd = sc;
-  } else {
-    NvDsKafkaAsyncSendCompl *sc= new NvDsKafkaAsyncSendCompl(ctx, cb);
-    scd = sc;
+  if (!mh || !mh->client) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "send called on NULL handle \n");
+    return NVDS_MSGAPI_ERR;
   }
+  end_time = g_get_monotonic_time() + mh->send_timeout;
+
+  g_mutex_lock(&mh->lock);
+  sc = mqtt_client_reserve(mh, end_time);
+  if (sc) {
+    if (sync) {
+      wait = g_new0(NvDsMqttSyncWait, 1);
+      wait->pending = 1;
+      wait->refs = 2;
+      sc->wait = wait;
+    } else {
+      sc->cb = cb;
+      sc->user_ptr = ctx;
+    }
+  }
+  g_mutex_unlock(&mh->lock);
 
-  if (!kh) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "send called on NULL handle \n");
+  if (!sc)
     return NVDS_MSGAPI_ERR;
+
+  err = mqtt_client_publish(mh, topic, payload, len, sc);
+  if (err != NVDS_MSGAPI_OK) {
+    if (wait) {
+      g_mutex_lock(&mh->lock);
+      mqtt_wait_unref(wait);
+      g_mutex_unlock(&mh->lock);
+    }
+    return err;
   }
 
-  if (rd_kafka_produce(
-          /* Topic object */
-          kh->topic,
-          /* Use builtin partitioner to select partition*/
-          RD_KAFKA_PARTITION_UA,
-          /* Make a copy of the payload. */
-          RD_KAFKA_MSG_F_COPY,
-          /* Message payload (value) and length */
-          (void *)payload, len,
-          /* Optional key and its length */
-          key, keylen,
-          /* Message opaque, provided in
-           * delivery report callback as
-           * msg_opaque. */
-          scd) == -1) {
-
-      if (rd_kafka_last_error() ==
-           RD_KAFKA_RESP_ERR__QUEUE_FULL) {
-           /* If the internal queue is full, discard the
-	    * message and log the error.
-            * The internal queue represents both
-            * messages to be sent and messages that have
-            * been sent or failed, awaiting their
-            * delivery report callback to be called.
-            *
-            * The internal queue is limited by the
-            * configuration property
-            * queue.buffering.max.messages */
-           nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,"rd_kafka_produce: Internal queue is full, discarding payload\n");
-	   nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, "rd_kafkaproduce: Discarding payload=%.*s \n topic = %s\n",len, payload, rd_kafka_topic_name(kh->topic));
-       }
-       else
-       {
-           /**
-             * Failed to *enqueue* message for producing.
-             */
-          nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,"Failed to schedule kafka send: %s on topic <%s>\n", rd_kafka_err2str(rd_kafka_last_error()), rd_kafka_topic_name(kh->topic));			 
-       }
-       return NVDS_MSGAPI_ERR;
-
-     }
-     else
-     {
-       NvDsMsgApiErrorType err;
-       if  (!sync)
-          return NVDS_MSGAPI_OK;
-       else
-       {
-          while (sync && !done) {
-            usleep(1000);
-            rd_kafka_poll(kh->producer, 0/*non-blocking*/);
-          }
-          err = (scd)->get_err();
-	  return err;
-        }
-     }
+  /* Paho has its own copy */
+  if (payload_free)
+    payload_free((void *) payload);
+
+  if (sync)
+    return mqtt_client_wait(mh, wait, end_time);
+  return NVDS_MSGAPI_OK;
 }
 
-NvDsMsgApiErrorType nvds_kafka_client_setconf(void *kv, char *key, char *val)
+/**
+ * Sends count messages synchronously, pipelined within the in-flight window,
+ * and blocks once till all of them are completed.
+ * Returns error if any of the messages failed.
+ */
+NvDsMsgApiErrorType nvds_mqtt_client_send_batch(void *mv, const char **topics, const uint8_t **payloads, \
+                                                const int *lens, int count)
 {
-  char errstr[512];
-  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
-  
-  if (rd_kafka_conf_set(kh->conf, key, val , errstr, sizeof(errstr)) \
-           != RD_KAFKA_CONF_OK) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Error setting config setting %s; %s\n", key, errstr );
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) mv;
+  gint64 end_time;
+  NvDsMqttSyncWait *wait;
+  NvDsMqttSendCompl *sc;
+  int i;
+
+  if (!mh || !mh->client) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "send batch called on NULL handle \n");
     return NVDS_MSGAPI_ERR;
-  } else {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "set config setting %s to %s\n", key, val);
+  }
+  end_time = g_get_monotonic_time() + mh->send_timeout;
+
+  if (count <= 0)
     return NVDS_MSGAPI_OK;
+
+  wait = g_new0(NvDsMqttSyncWait, 1);
+  wait->refs = 1;
+
+  for (i = 0; i < count; i++) {
+    g_mutex_lock(&mh->lock);
+    sc = mqtt_client_reserve(mh, end_time);
+    if (sc) {
+      wait->pending++;
+      wait->refs++;
+      sc->wait = wait;
+    } else {
+      wait->err = NVDS_MSGAPI_ERR;
+    }
+    g_mutex_unlock(&mh->lock);
+
+    if (!sc)
+      break;
+
+    if (mqtt_client_publish(mh, topics[i], payloads[i], lens[i], sc) != NVDS_MSGAPI_OK) {
+      g_mutex_lock(&mh->lock);
+      wait->pending--;
+      wait->err = NVDS_MSGAPI_ERR;
+      g_mutex_unlock(&mh->lock);
+    }
   }
+
+  return mqtt_client_wait(mh, wait, end_time);
 }
 
 /**
-  Instantiates the rd_kafka_t object, which initializes the protocol
+ * Reports completed async sends to their senders.
  */
-NvDsMsgApiErrorType nvds_kafka_client_launch(void *kv)
+void nvds_mqtt_client_poll(void *mv)
 {
-   rd_kafka_t *rk;         /* Producer instance handle */
-   rd_kafka_topic_t *rkt;  /* Topic object */
-   NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
-   char errstr[512];
-
-   /*
-      * Create producer instance.
-      * NOTE: rd_kafka_new() takes ownership of the conf object
-      *       and the application must not reference it again after
-      *       this call.
-    */
-   rk = rd_kafka_new(RD_KAFKA_PRODUCER, kh->conf, errstr, sizeof(errstr));
-   if (!rk) {
-      nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Failed to create new producer: %s\n", errstr);
-      return NVDS_MSGAPI_ERR;
-   }
-
-    /* Create topic object that will be reused for each message
-         * produced.
-         *
-         * Both the producer instance (rd_kafka_t) and topic objects (topic_t)
-         * are long-lived objects that should be reused as much as possible.
-    */
-   rkt = rd_kafka_topic_new(rk, kh->topic_name, NULL);
-   if (!rkt) {
-        nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Failed to create topic object: %s\n", \
-           rd_kafka_err2str(rd_kafka_last_error()));
-        rd_kafka_destroy(rk);
-        return NVDS_MSGAPI_ERR;
-   }
-   kh->producer = rk;
-   kh->topic = rkt;
-   return NVDS_MSGAPI_OK;
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) mv;
+  NvDsMqttSendCompl *head, *sc, *next;
+
+  if (!mh)
+    return;
+
+  g_mutex_lock(&mh->lock);
+  head = mh->done_head;
+  mh->done_head = mh->done_tail = NULL;
+  g_mutex_unlock(&mh->lock);
+
+  for (sc = head; sc; sc = sc->next) {
+    if (sc->cb)
+      sc->cb(sc->user_ptr, sc->err);
+  }
+
+  if (!head)
+    return;
 
+  g_mutex_lock(&mh->lock);
+  for (sc = head; sc; sc = next) {
+    next = sc->next;
+    mqtt_compl_release(mh, sc);
+  }
+  g_mutex_unlock(&mh->lock);
 }
 
-void nvds_kafka_client_finish(void *kv)
+void nvds_mqtt_client_finish(void *mv)
 {
-  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
+  NvDsMqttClientHandle *mh = (NvDsMqttClientHandle *) mv;
+  MQTTAsync_disconnectOptions disc_opts = MQTTAsync_disconnectOptions_initializer;
+  gint64 end_time;
 
-  if (!kh) {
+  if (!mh) {
     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "finish called on NULL handle\n");
     return;
   }
-    
-  rd_kafka_flush (kh->producer, 10000);
-
-  /* Destroy topic object */
-  rd_kafka_topic_destroy(kh->topic);
 
-  /* Destroy the producer instance */
-  rd_kafka_destroy( kh->producer );
+  if (mh->client) {
+    /* gives in-flight messages time to be acknowledged */
+    disc_opts.timeout = mh->send_timeout / G_TIME_SPAN_MILLISECOND;
+    disc_opts.onSuccess = mqtt_on_disconnect;
+    disc_opts.onFailure = mqtt_on_disconnect_failure;
+    disc_opts.context = mh;
+    if (MQTTAsync_disconnect(mh->client, &disc_opts) == MQTTASYNC_SUCCESS) {
+      end_time = g_get_monotonic_time() + mh->send_timeout + G_TIME_SPAN_SECOND;
+      g_mutex_lock(&mh->lock);
+      while (!mh->disconnect_done && g_cond_wait_until(&mh->cond, &mh->lock, end_time))
+        ;
+      g_mutex_unlock(&mh->lock);
+    }
+    MQTTAsync_destroy(&mh->client);
+  }
 
-}
+  nvds_mqtt_client_poll(mh);
 
-void nvds_kafka_client_poll(void *kv)
-{
-  NvDsKafkaClientHandle *kh = (NvDsKafkaClientHandle *)kv;
-  if (kh)
-    rd_kafka_poll(kh->producer, 0/*non-blocking*/);
+  /* sends never acknowledged; with a persistent session QoS 1 messages
+   * are still delivered by the next session */
+  for (unsigned int c = 0; c < mh->num_chunks; c++) {
+    for (unsigned int i = 0; i < MQTT_COMPL_CHUNK_SIZE; i++) {
+      NvDsMqttSendCompl *sc = &mh->chunks[c][i];
+      if (sc->state == MQTT_COMPL_PENDING && !sc->wait && sc->cb)
+        sc->cb(sc->user_ptr, NVDS_MSGAPI_ERR);
+    }
+    g_free(mh->chunks[c]);
+  }
+  g_free(mh->chunks);
+
+  g_mutex_clear(&mh->lock);
+  g_cond_clear(&mh->cond);
+  g_free(mh->uri);
+  g_free(mh->client_id);
+  g_free(mh->username);
+  g_free(mh->password);
+  g_free(mh->persistence_dir);
+  g_free(mh);
 }
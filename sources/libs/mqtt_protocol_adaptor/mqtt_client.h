@@ -11,39 +11,43 @@
 
 #include "nvds_msgapi.h"
 
-class NvDsKafkaSendCompl {
- public:
-  virtual void sendcomplete(NvDsMsgApiErrorType);
-  NvDsMsgApiErrorType get_err();
-  virtual ~NvDsKafkaSendCompl() = default;
-};
-
-class NvDsKafkaSyncSendCompl: public NvDsKafkaSendCompl {
- private:
-  uint8_t *compl_flag;
-  NvDsMsgApiErrorType err;
-
- public:
-  NvDsKafkaSyncSendCompl(uint8_t *);
-  void sendcomplete(NvDsMsgApiErrorType);
-  NvDsMsgApiErrorType get_err();
-};
-
-class NvDsKafkaAsyncSendCompl: public NvDsKafkaSendCompl {
- private:
-  void *user_ptr;
-  nvds_msgapi_send_cb_t async_send_cb;
-
- public:
-  NvDsKafkaAsyncSendCompl(void *ctx, nvds_msgapi_send_cb_t cb);
-  void sendcomplete(NvDsMsgApiErrorType);
-};
+/**
+ * MQTT client based on the asynchronous client of Eclipse Paho
+ * (https://github.com/eclipse/paho.mqtt.c).
+ *
+ * Publishes are pipelined: up to max-inflight messages are sent without
+ * waiting for their acknowledgement. Completions arrive on a thread of Paho
+ * and are reported to async senders from nvds_mqtt_client_poll().
+ *
+ * Settings (nvds_mqtt_client_setconf), to be set before launch:
+ *   qos              - 0 or 1, QoS of published messages (default 1)
+ *   max-inflight     - max messages sent and not completed (default 64)
+ *   client-id        - client identifier, identifies the session on the
+ *                      broker (default nvds-<host name>)
+ *   clean-session    - 1 to start a new session on every connection,
+ *                      0 to resume the session and its QoS 1 messages
+ *                      (default 0)
+ *   keep-alive       - keep alive interval in seconds (default 60)
+ *   connect-timeout  - seconds to wait for the first connection (default 10)
+ *   reconnect-min    - first delay in seconds before reconnecting after
+ *                      a connection loss, doubled at every attempt (default 1)
+ *   reconnect-max    - max delay in seconds between reconnects (default 60)
+ *   max-buffered     - messages buffered while disconnected (default 10000)
+ *   persistence-dir  - directory keeping QoS 1 messages not acknowledged yet
+ *                      across restarts; kept in memory if not set
+ *   send-timeout-ms  - max time a send waits for room in the in-flight window
+ *                      or a sync send waits for its completion (default 10000)
+ *   username, password
+ */
 
-void *nvds_kafka_client_init(char *brokers, char *topic);
-NvDsMsgApiErrorType nvds_kafka_client_launch(void *kh);
-NvDsMsgApiErrorType nvds_kafka_client_send(void *kh, const uint8_t *payload, int len, int sync, void *ctx, nvds_msgapi_send_cb_t cb,  char *key, int keylen);
-NvDsMsgApiErrorType nvds_kafka_client_setconf(void *kh, char *key, char *val);
-void nvds_kafka_client_poll(void *kv);
-void nvds_kafka_client_finish(void *kv);
+void *nvds_mqtt_client_init(const char *uri);
+NvDsMsgApiErrorType nvds_mqtt_client_setconf(void *mh, const char *key, const char *val);
+NvDsMsgApiErrorType nvds_mqtt_client_launch(void *mh);
+NvDsMsgApiErrorType nvds_mqtt_client_send(void *mh, const char *topic, const uint8_t *payload, int len, int sync, \
+                                          void *ctx, nvds_msgapi_send_cb_t cb, void (*payload_free)(void *));
+NvDsMsgApiErrorType nvds_mqtt_client_send_batch(void *mh, const char **topics, const uint8_t **payloads, \
+                                                const int *lens, int count);
+void nvds_mqtt_client_poll(void *mh);
+void nvds_mqtt_client_finish(void *mh);
 
 #define NVDS_MQTT_LOG_CAT "NVDS_MQTT_PROTO"
@@ -1,416 +1,382 @@
+/*
+ * Copyright (c) 2018 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
 #include <string.h>
 #include <glib.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <sys/select.h>
-#include <sys/time.h>
-#include <fcntl.h>
-#include <errno.h>
-#include <sys/types.h>
-#include <netdb.h>
 #include "nvds_logger.h"
 #include "nvds_msgapi.h"
 #include "mqtt_client.h"
 
 
-#define MAX_FIELD_LEN 255 //maximum topic length supported by kafka is 255
+#define MAX_FIELD_LEN 255
+#define MQTT_SENSOR_LEN 100 //maximum length of sensor id looked up in payload
+#define MQTT_TOPIC_LEN 512 //maximum length of a topic built from template
 
 #define NVDS_MSGAPI_VERSION "1.0"
 
 #define CONFIG_GROUP_MSG_BROKER "message-broker"
-#define CONFIG_GROUP_MSG_BROKER_RDKAFKA_CFG "proto-cfg"
+#define CONFIG_GROUP_MSG_BROKER_MQTT_CFG "proto-cfg"
 #define CONFIG_GROUP_MSG_BROKER_PARTITION_KEY "partition-key"
+#define CONFIG_GROUP_MSG_BROKER_TOPIC_TEMPLATE "topic-template"
+
+#define TOPIC_TEMPLATE_TOPIC "{topic}"
+#define TOPIC_TEMPLATE_SENSOR "{sensor}"
 
 
 int json_get_key_value(const char *msg, int msglen, const char *key, char *value, int nbuf);
 
 typedef struct {
-  void *kh;
+  void *mh;
   char topic[MAX_FIELD_LEN];
+  /* json field of the sensor id, used if the sender doesn't give the key */
   char partition_key_field[MAX_FIELD_LEN];
-} NvDsKafkaProtoConn;
+  /* topic of a message, e.g. "deepstream/{sensor}/{topic}"; NULL to publish
+   * on the topic given by the sender */
+  gchar *topic_template;
+  gboolean template_has_sensor;
+} NvDsMqttProtoConn;
 
 /**
  * internal function to read settings from config file
- * Documentation needs to indicate that kafka config parameters are:
+ * mqtt config parameters are:
   (1) located within application level config file passed to connect
   (2) within the message broker group of the config file
-  (3) specified based on 'rdkafka-cfg' key
-  (4) the various options to rdkafka are specified based on 'key=value' format, within various entries semi-colon separated
+  (3) specified based on 'proto-cfg' key
+  (4) the various options are specified based on 'key=value' format, within various entries semi-colon separated
+      (settings are listed in mqtt_client.h)
+  topic-template sets the topic of the messages, where {topic} is replaced by
+  the send topic and {sensor} by the message key or the partition-key field of
+  the message.
 Eg:
 [message-broker]
 enable=1
 broker-proto-lib=/opt/nvidia/deepstream/deepstream-<version>/lib/libnvds_mqtt_proto.so
-broker-conn-str=tcp://localhost:1883;deepstream-client-id
-rdkafka-cfg="message.timeout.ms=2000"
+broker-conn-str=localhost;1883;deepstream
+proto-cfg="qos=1;max-inflight=64;client-id=site-1-edge"
+topic-template=deepstream/{sensor}/{topic}
 
  */
-static void nvds_mqtt_read_config(void *kh, char *config_path, char *partition_key_field, int field_len)
+static void nvds_mqtt_read_config(NvDsMqttProtoConn *conn, char *config_path)
 {
-  //iterate over the config params to set one by one
-  //finally call into launch function passing topic
   GKeyFile *key_file = g_key_file_new ();
-  gchar **keys = NULL;
-  gchar **key = NULL;
   GError *error = NULL;
-  char *confptr = NULL, *curptr = NULL;
+  gchar *confstr, *key_name_conf;
+  gchar **settings, **setting;
 
   if (!g_key_file_load_from_file (key_file, config_path, G_KEY_FILE_NONE,
             &error)) {
     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,  "unable to load config file at path %s; error message = %s\n", config_path, error->message);
+    g_error_free(error);
+    g_key_file_free(key_file);
     return;
   }
 
-  keys = g_key_file_get_keys(key_file, CONFIG_GROUP_MSG_BROKER, NULL, &error);
-  if (error) {
-     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,  "Error parsing config file. %s\n", error->message);
-     return;
+  key_name_conf = g_key_file_get_string (key_file, CONFIG_GROUP_MSG_BROKER,
+       CONFIG_GROUP_MSG_BROKER_PARTITION_KEY, NULL);
+  if (key_name_conf) {
+    g_strlcpy(conn->partition_key_field, key_name_conf, sizeof(conn->partition_key_field));
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO,  "mqtt sensor key field name = %s\n", conn->partition_key_field);
+    g_free(key_name_conf);
   }
-  for (key = keys; *key; key++) {
-    gchar *setvalquote;
-
-    // check if this is one of adaptor settings
-    if (!g_strcmp0(*key, CONFIG_GROUP_MSG_BROKER_RDKAFKA_CFG))
-	{
-           setvalquote = g_key_file_get_string (key_file, CONFIG_GROUP_MSG_BROKER,
-               CONFIG_GROUP_MSG_BROKER_RDKAFKA_CFG, &error);
-
-	   if (error) {
-             nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,  "Error parsing config file\n");
-	     return;
-	   }
-
-	   confptr = setvalquote;
-	   size_t conflen = strlen(confptr);
-
-	   //remove "". (string length needs to be at least 2)
-	   //Could use g_shell_unquote but it might have other side effects
-	   if ((conflen <3) || (confptr[0] != '"') || (confptr[conflen-1] != '"')) {
-             nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,  "invalid format for rdkafa \
-                               config entry. Start and end with \"\"\n");
-	     return;
-           }
-           confptr[conflen-1] = '\0'; //remove ending quote
-           confptr = confptr + 1; //remove starting quote
-	   nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO,  "kafka setting %s = %s\n", *key, confptr);
-	}
-
-       // check if this entry specifies the partition key field
-    if (!g_strcmp0(*key, CONFIG_GROUP_MSG_BROKER_PARTITION_KEY))
-        {
-           gchar *key_name_conf;
-           key_name_conf = g_key_file_get_string (key_file, CONFIG_GROUP_MSG_BROKER,
-                CONFIG_GROUP_MSG_BROKER_PARTITION_KEY, &error);
-           if (error) {
-             nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,  "Error parsing config file\n");
-             g_error_free(error);
-             return;
-           }
-           strncpy(partition_key_field, (char *)key_name_conf, field_len);
-           nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO,  "kafka partition key field name = %s\n", partition_key_field);
-           g_free(key_name_conf);
-        }
+
+  conn->topic_template = g_key_file_get_string (key_file, CONFIG_GROUP_MSG_BROKER,
+       CONFIG_GROUP_MSG_BROKER_TOPIC_TEMPLATE, NULL);
+  if (conn->topic_template) {
+    conn->template_has_sensor = strstr(conn->topic_template, TOPIC_TEMPLATE_SENSOR) != NULL;
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO,  "mqtt topic template = %s\n", conn->topic_template);
   }
 
-  if (!confptr) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG,  "No " CONFIG_GROUP_MSG_BROKER_RDKAFKA_CFG " entry found in config file.\n");
+  confstr = g_key_file_get_string (key_file, CONFIG_GROUP_MSG_BROKER,
+       CONFIG_GROUP_MSG_BROKER_MQTT_CFG, NULL);
+  if (!confstr) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG,  "No " CONFIG_GROUP_MSG_BROKER_MQTT_CFG " entry found in config file.\n");
+    g_key_file_free(key_file);
     return;
- }
-  
-  char *equalptr, *semiptr;
-  int keylen, vallen, conflen = strlen(confptr);
-  char confkey[MAX_FIELD_LEN], confval[MAX_FIELD_LEN];
-  curptr = confptr;
-
-  while (((equalptr = strchr(curptr, '=')) != NULL) && ((curptr - confptr) < conflen)) {
-     keylen = (equalptr - curptr);
-     if (keylen >= MAX_FIELD_LEN)
-       keylen = MAX_FIELD_LEN - 1;
-
-     memcpy(confkey, curptr, keylen);
-     confkey[keylen] = '\0';
-
-     if (equalptr >= (confptr + conflen)) //no more string; dangling key
-       return;
-
-     semiptr = strchr(equalptr+1, ';');
-
-     if (!semiptr) {
-       vallen = (confptr + conflen - equalptr - 1);//end of strng case
-       curptr = (confptr + conflen);
-     }
-     else {
-       curptr = semiptr + 1;
-       vallen = (semiptr - equalptr - 1);
-     }
-
-     if (vallen >= MAX_FIELD_LEN)
-       vallen = MAX_FIELD_LEN - 1;
-
-     memcpy(confval, (equalptr + 1), vallen);
-     confval[vallen] = '\0';
-
-     nvds_kafka_client_setconf(kh, confkey, confval);
-
   }
-}
 
-
-/**
- * connects to a broker based on given url and port to check if address is valid
- * Returns 0 if valid, and non-zero if invalid.
- * Also returns 0 if there is trouble resolving  the address or creating connection
- */
-static int test_kafka_broker_endpoint(char *burl, char *bport) {
-  int sockid;
-  int port = atoi(bport);
-  int flags;
-  fd_set wfds;
-  int error;
-  struct addrinfo *res, hints;
-
-  if (!port)
-    return -1;
-
-  memset(&hints, 0, sizeof (hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_STREAM;
-
-  //resolve the given url
-  if ((error = getaddrinfo(burl, bport, &hints, &res))) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "getaddrinfo returned error %d\n", error);
-
-    if ((error == EAI_FAIL) || (error == EAI_NONAME) ||  (error == EAI_NODATA)){
-      nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "count not resolve addr - permanent failure\n");
-      return error; //permanent failure to resolve
-    }
-    else 
-      return 0; //unknown error during resolve; can't invalidate address
+  //remove "", entries are semi-colon separated key=value
+  g_strstrip(confstr);
+  size_t conflen = strlen(confstr);
+  if ((conflen < 3) || (confstr[0] != '"') || (confstr[conflen-1] != '"')) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR,  "invalid format for mqtt \
+                      config entry. Start and end with \"\"\n");
+    g_free(confstr);
+    g_key_file_free(key_file);
+    return;
   }
+  confstr[conflen-1] = '\0';
 
-  //iterate through all ip addresses resolved for the url
-  for(; res != NULL; res = res->ai_next) {
-    sockid = socket(AF_INET, SOCK_STREAM, 0); //tcp socket
-
-    //make socket non-blocking
-    flags = fcntl(sockid, F_GETFL);
-    if (fcntl(sockid, F_SETFL, flags | O_NONBLOCK) == -1)
-      /* having trouble making socket non-blocking;
-        can't check network address, and so assume it is valid
-      */
-     return 0;
+  settings = g_strsplit(confstr + 1, ";", -1);
+  for (setting = settings; *setting; setting++) {
+    gchar *equalptr = strchr(*setting, '=');
 
-    if (!connect(sockid, (struct sockaddr *)res->ai_addr, res->ai_addrlen)) {
-      return 0; //connection succeeded right away
+    if (!equalptr) {
+      if (**setting)
+        nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "invalid mqtt setting %s\n", *setting);
+      continue;
     }
-    else {
-      if (errno == EINPROGRESS) { //normal for non-blocking socker
-        struct timeval conn_timeout;
-        int optval;
-        socklen_t optlen;
-
-        conn_timeout.tv_sec = 5; //give 5 sec for connection to go through
-        conn_timeout.tv_usec = 0;
-        FD_ZERO(&wfds);
-        FD_SET(sockid, &wfds);
-
-        int err = select(sockid+1, NULL, & wfds, NULL, &conn_timeout);
-        switch(err) {
-          case 0: //timeout
-            return ETIMEDOUT;
-
-          case 1: //socket unblocked; now figure out why
-            optval = -1;
-            optlen = sizeof(optval);
-            if (getsockopt(sockid, SOL_SOCKET, SO_ERROR, &optval, &optlen) == -1) {
-              /* error getting socket options; can't invalidate address */
-               return 0;
-            }
-            if (optval == 0)
-              return 0; //no error; connection succeeded
-            else
-              return optval;	 //connection failed; something wrong with address
-
-          case -1: //error in select, can't invalidate address
-            return 0;
-        }
-      } else
-        return 0; // error in connect; can't invalidate address
-    } // non-blocking connect did not succeed
+    *equalptr = '\0';
+    nvds_mqtt_client_setconf(conn->mh, g_strstrip(*setting), g_strstrip(equalptr + 1));
   }
-  return 0; //if we got here then can't invalidate
+  g_strfreev(settings);
+  g_free(confstr);
+  g_key_file_free(key_file);
 }
 
-
 /**
- * Connects to a remote kafka broker based on connection string.
+ * Connects to a mqtt broker based on connection string "url;port;topic".
+ * url can include the scheme, e.g. ssl://host, tcp:// is used otherwise.
+ * topic is used by sends which don't give one.
  */
 NvDsMsgApiHandle nvds_msgapi_connect(char *connection_str,  nvds_msgapi_connect_cb_t connect_cb, char *config_path)
 {
-  NvDsKafkaProtoConn *conn_ptr = (NvDsKafkaProtoConn *)malloc(sizeof(NvDsKafkaProtoConn));
-  char burl[MAX_FIELD_LEN], bport[MAX_FIELD_LEN], btopic[MAX_FIELD_LEN], brokerurl[MAX_FIELD_LEN];
-  int urllen, portlen, topiclen;
-  urllen = portlen = topiclen = MAX_FIELD_LEN;
-  char *portptr, *topicptr;
+  NvDsMqttProtoConn *conn_ptr;
+  gchar **fields;
+  gchar *uri;
 
   nvds_log_open();
   nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "nvds_msgapi_connect:connection_str = %s\n", connection_str);
 
-  portptr = strchr(connection_str, ';');
-
-  if (conn_ptr == NULL) { //malloc failed
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Unable to allocate memory for kafka connection handle.\
-                                                      Can't create connection\n");
+  if (!connection_str) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "connection string not provided. Can't create connection\n");
     return NULL;
   }
 
-  if (portptr == NULL) { //invalid format
+  fields = g_strsplit(connection_str, ";", 3);
+  if (g_strv_length(fields) < 2 || !*fields[0] || !atoi(fields[1])) {
     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "invalid connection string format. Can't create connection\n");
+    g_strfreev(fields);
     return NULL;
   }
 
-  topicptr = strchr(portptr+1, ';');
-
-  if (topicptr == NULL) { //invalid format
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "invalid connection string format. Can't create connection\n");
-    return NULL;
-  }
+  if (strstr(fields[0], "://"))
+    uri = g_strdup_printf("%s:%s", fields[0], fields[1]);
+  else
+    uri = g_strdup_printf("tcp://%s:%s", fields[0], fields[1]);
 
-  urllen = (portptr - connection_str);
-  if (urllen >= MAX_FIELD_LEN)
-    urllen = MAX_FIELD_LEN - 1;
+  conn_ptr = g_new0(NvDsMqttProtoConn, 1);
+  if (fields[2])
+    g_strlcpy(conn_ptr->topic, fields[2], sizeof(conn_ptr->topic));
+  g_strfreev(fields);
 
-  memcpy(burl, connection_str, urllen);
-  burl[urllen] = '\0';
-  
-  portlen = (topicptr - portptr - 1);
-  if (portlen >= MAX_FIELD_LEN)
-    portlen = MAX_FIELD_LEN - 1;
-  memcpy(bport, (portptr + 1), portlen);
-  bport[portlen] = '\0';
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "mqtt broker uri = %s; topic = %s\n", uri, conn_ptr->topic);
 
-  topiclen = (strlen(connection_str) - urllen - portlen - 2);
-  if (topiclen >=  MAX_FIELD_LEN)
-    topiclen = MAX_FIELD_LEN;
-  memcpy(btopic, (topicptr + 1), topiclen);
-  btopic[topiclen] = '\0';
+  conn_ptr->mh = nvds_mqtt_client_init(uri);
+  g_free(uri);
+  if (!conn_ptr->mh) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Unable to init mqtt client.\n");
+    g_free(conn_ptr);
+    return NULL;
+  }
 
-  nvds_log(NVDS_MQTT_LOG_CAT, LOG_INFO, "kafka broker url = %s; port = %s; topic = %s", burl, bport, btopic);
+  /* set key field name to default value of sensor.id */
+  g_strlcpy(conn_ptr->partition_key_field, "sensor.id", sizeof(conn_ptr->partition_key_field));
 
-  snprintf(brokerurl, sizeof(brokerurl), "%s:%s", burl, bport);
+  if (config_path)
+    nvds_mqtt_read_config(conn_ptr, config_path);
 
-  if (test_kafka_broker_endpoint(burl, bport)) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Invalid address or network endpoint down. kafka connect failed\n");
-    free(conn_ptr);
+  if (nvds_mqtt_client_launch(conn_ptr->mh) != NVDS_MSGAPI_OK) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Broker unreachable. mqtt connect failed\n");
+    nvds_mqtt_client_finish(conn_ptr->mh);
+    g_free(conn_ptr->topic_template);
+    g_free(conn_ptr);
     return NULL;
   }
 
-  conn_ptr->kh = nvds_kafka_client_init(brokerurl, btopic);
-  if (!conn_ptr->kh) {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "Unable to init kafka client.\n");
-    free(conn_ptr);
-    return NULL;
+  return (NvDsMsgApiHandle)(conn_ptr);
+}
+
+/* Appends at most len bytes of str to buf of size bytes holding pos bytes;
+ * characters which have a meaning in topic filters are replaced. */
+static size_t mqtt_topic_append(char *buf, size_t size, size_t pos, const char *str, size_t len, bool sanitize)
+{
+  for (size_t i = 0; i < len && str[i] && pos + 1 < size; i++) {
+    char c = str[i];
+    if (sanitize && (c == '/' || c == '+' || c == '#'))
+      c = '_';
+    buf[pos++] = c;
   }
-  strncpy(conn_ptr->topic, btopic, MAX_FIELD_LEN);
+  buf[pos] = '\0';
+  return pos;
+}
 
-  /* set key field name to default value of sensor.id */
-  strncpy(conn_ptr->partition_key_field, "sensor.id", sizeof(conn_ptr->partition_key_field));
+/**
+ * Returns the topic to publish the message on: the topic given by the
+ * sender, or the topic template expanded into buf.
+ */
+static const char *mqtt_proto_topic(NvDsMqttProtoConn *conn, const char *topic, const uint8_t *payload, size_t nbuf, \
+                                    const char *key, size_t keylen, char *buf, size_t size)
+{
+  char idval[MQTT_SENSOR_LEN];
+  const char *p;
+  size_t pos = 0;
 
-  if (config_path)
-    nvds_mqtt_read_config(conn_ptr->kh, config_path, conn_ptr->partition_key_field, \
-                        sizeof(conn_ptr->partition_key_field));
+  if (!topic || !*topic)
+    topic = conn->topic;
 
-  nvds_kafka_client_launch(conn_ptr->kh);
+  if (!conn->topic_template)
+    return topic;
 
-  return (NvDsMsgApiHandle)(conn_ptr);
+  if (conn->template_has_sensor && !key) {
+    keylen = json_get_key_value((const char *)payload, nbuf, conn->partition_key_field, idval, sizeof(idval));
+    key = keylen ? idval : "unknown";
+    keylen = strlen(key);
+  }
+
+  buf[0] = '\0';
+  for (p = conn->topic_template; *p; ) {
+    if (!strncmp(p, TOPIC_TEMPLATE_TOPIC, sizeof(TOPIC_TEMPLATE_TOPIC) - 1)) {
+      pos = mqtt_topic_append(buf, size, pos, topic, strlen(topic), false);
+      p += sizeof(TOPIC_TEMPLATE_TOPIC) - 1;
+    } else if (!strncmp(p, TOPIC_TEMPLATE_SENSOR, sizeof(TOPIC_TEMPLATE_SENSOR) - 1)) {
+      pos = mqtt_topic_append(buf, size, pos, key, keylen, true);
+      p += sizeof(TOPIC_TEMPLATE_SENSOR) - 1;
+    } else {
+      pos = mqtt_topic_append(buf, size, pos, p, 1, false);
+      p++;
+    }
+  }
+  return buf;
 }
 
 //There could be several synchronous and asychronous send operations in flight.
-//Once a send operation callback is received the course of action  depends on if it's synch or async
-// -- if it's sync then the associated complletion flag should  be set
-// -- if it's asynchronous then completion callback from the user should be called
-NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf)
+//Once a send operation is acknowledged the course of action depends on if it's synch or async
+// -- if it's sync then the send returns
+// -- if it's asynchronous then completion callback from the user is called from do_work
+// -- if payload_free is set then payload is owned by the send and released
+//    with it (async only)
+static NvDsMsgApiErrorType mqtt_proto_send(const char *fn, NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, \
+                     const char *key, size_t keylen, int sync, nvds_msgapi_send_cb_t send_callback, void *user_ptr, \
+                     void (*payload_free)(void *) = NULL)
 {
-  char idval[100];
-  int retval;
+  NvDsMqttProtoConn *conn = (NvDsMqttProtoConn *) h_ptr;
+  char topicbuf[MQTT_TOPIC_LEN];
+  const char *msgtopic;
 
   nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, \
-    "nvds_msgapi_send: payload=%.*s, \n topic = %s, h->topic = %s\n"\
-           , nbuf, payload, topic, (((NvDsKafkaProtoConn *) h_ptr)->topic));
+    "%s: payload=%.*s, \n topic = %s, h->topic = %s\n"\
+           , fn, (int) nbuf, payload, topic ? topic : "", conn->topic);
 
-  if (strcmp(topic, (((NvDsKafkaProtoConn *) h_ptr)->topic))) {
-     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "nvds_msgapi_send: send topic has \
-                                             to match topic defined at connect.\n");
-     return NVDS_MSGAPI_ERR;
+  msgtopic = mqtt_proto_topic(conn, topic, payload, nbuf, key, keylen, topicbuf, sizeof(topicbuf));
+  if (!*msgtopic) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "%s: no topic given at send nor at connect\n", fn);
+    return NVDS_MSGAPI_ERR;
   }
 
-  // parition key retrieved from config file
-  char *partition_key_field = ((NvDsKafkaProtoConn *) h_ptr)->partition_key_field;
-  retval = json_get_key_value((const char *)payload, nbuf, partition_key_field , idval, sizeof(idval));
+  return nvds_mqtt_client_send(conn->mh, msgtopic, payload, nbuf, sync, user_ptr, send_callback, payload_free);
+}
 
+NvDsMsgApiErrorType nvds_msgapi_send(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf)
+{
+  return mqtt_proto_send(__func__, h_ptr, topic, payload, nbuf, NULL, 0, 1, NULL, NULL);
+}
+
+NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf,  nvds_msgapi_send_cb_t send_callback, void *user_ptr)
+{
+  return mqtt_proto_send(__func__, h_ptr, topic, payload, nbuf, NULL, 0, 0, send_callback, user_ptr);
+}
+
+/**
+ * Sends with the sensor id provided by caller instead of looking it up in
+ * payload.
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, const char *key, size_t keylen)
+{
+  return mqtt_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, 1, NULL, NULL);
+}
 
-  if (retval)
-    return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 1, NULL, NULL, idval, strlen(idval));
-  else {
-      nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "nvds_msgapi_send: \
-                  no matching json field found based on kafka key config; \
-                  using default partition\n");
+NvDsMsgApiErrorType nvds_msgapi_send_async_with_key(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf, \
+                     const char *key, size_t keylen, nvds_msgapi_send_cb_t send_callback, void *user_ptr)
+{
+  return mqtt_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, 0, send_callback, user_ptr);
+}
 
-       return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 1, NULL, NULL, NULL, 0);
+/**
+ * Sends asynchronously taking ownership of the payload.
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_async_nocopy(NvDsMsgApiHandle h_ptr, char *topic, uint8_t *payload, size_t nbuf, \
+                     const char *key, size_t keylen, void (*payload_free)(void *), nvds_msgapi_send_cb_t send_callback, \
+                     void *user_ptr)
+{
+  if (!payload_free) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "nvds_msgapi_send_async_nocopy: payload_free is NULL\n");
+    return NVDS_MSGAPI_ERR;
   }
+  return mqtt_proto_send(__func__, h_ptr, topic, payload, nbuf, key, keylen, 0, send_callback, user_ptr, payload_free);
 }
 
-NvDsMsgApiErrorType nvds_msgapi_send_async(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t *payload, size_t nbuf,  nvds_msgapi_send_cb_t send_callback, void *user_ptr)
+/**
+ * Sends the messages synchronously, blocking once for all of them.
+ */
+NvDsMsgApiErrorType nvds_msgapi_send_batch(NvDsMsgApiHandle h_ptr, char *topic, const uint8_t **payloads, const size_t *nbufs, \
+                     const char **keys, size_t count)
 {
-  char idval[100];
-  int retval;
+  NvDsMqttProtoConn *conn = (NvDsMqttProtoConn *) h_ptr;
+  NvDsMsgApiErrorType err;
 
-  nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, "nvds_msgapi_send_async: payload=%.*s, \
-      \n topic = %s, h->topic = %s\n", nbuf, payload, topic, \
-       (((NvDsKafkaProtoConn *) h_ptr)->topic));
+  nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, "nvds_msgapi_send_batch: %zu messages, \
+      topic = %s, h->topic = %s\n", count, topic ? topic : "", conn->topic);
 
-  if (strcmp(topic, (((NvDsKafkaProtoConn *) h_ptr)->topic))) {
-     nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "nvds_msgapi_send_async: \
-        send topic has to match topic defined at connect.\n");
-     return NVDS_MSGAPI_ERR;
-  }
+  if (!count)
+    return NVDS_MSGAPI_OK;
 
-  // parition key retrieved from config file
-  char *partition_key_field = ((NvDsKafkaProtoConn *) h_ptr)->partition_key_field;
-  retval = json_get_key_value((const char *)payload, nbuf, partition_key_field , idval, sizeof(idval));
+  int *lens = (int *)g_malloc(count * sizeof(int));
+  const char **topics = (const char **)g_malloc(count * sizeof(char *));
+  char *topicbufs = conn->topic_template ? (char *)g_malloc(count * MQTT_TOPIC_LEN) : NULL;
 
-  if (retval)
-    return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 0, user_ptr, \
-             send_callback, idval, strlen(idval));
-  else {
-    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "no matching json field found \
-        based on kafka key config; using default partition\n");
-    return nvds_kafka_client_send(((NvDsKafkaProtoConn *) h_ptr)->kh, payload, nbuf, 0, user_ptr, \
-                  send_callback, NULL, 0);
+  for (size_t i = 0; i < count; i++) {
+    const char *key = keys ? keys[i] : NULL;
 
+    lens[i] = nbufs[i];
+    topics[i] = mqtt_proto_topic(conn, topic, payloads[i], nbufs[i], key, key ? strlen(key) : 0, \
+                                 topicbufs ? topicbufs + i * MQTT_TOPIC_LEN : NULL, MQTT_TOPIC_LEN);
   }
 
+  if (!*topics[0]) {
+    nvds_log(NVDS_MQTT_LOG_CAT, LOG_ERR, "nvds_msgapi_send_batch: no topic given at send nor at connect\n");
+    err = NVDS_MSGAPI_ERR;
+  } else {
+    err = nvds_mqtt_client_send_batch(conn->mh, topics, payloads, lens, count);
+  }
+
+  g_free(topicbufs);
+  g_free(topics);
+  g_free(lens);
+  return err;
 }
 
+/**
+ * Reports completions of async sends; messages are sent and acknowledged
+ * on the threads of Paho.
+ */
 void nvds_msgapi_do_work(NvDsMsgApiHandle h_ptr)
 {
   nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, "nvds_msgapi_do_work\n");
-  nvds_kafka_client_poll(((NvDsKafkaProtoConn *) h_ptr)->kh);
+  nvds_mqtt_client_poll(((NvDsMqttProtoConn *) h_ptr)->mh);
 }
 
 NvDsMsgApiErrorType nvds_msgapi_disconnect(NvDsMsgApiHandle h_ptr)
 {
-  if (!h_ptr) {
+  NvDsMqttProtoConn *conn = (NvDsMqttProtoConn *) h_ptr;
+
+  if (!conn) {
     nvds_log(NVDS_MQTT_LOG_CAT, LOG_DEBUG, "nvds_msgapi_disconnect called with null handle\n");
     return NVDS_MSGAPI_OK;
   }
 
-  nvds_kafka_client_finish(((NvDsKafkaProtoConn *) h_ptr)->kh);
-  (((NvDsKafkaProtoConn *) h_ptr)->kh) = NULL;
+  nvds_mqtt_client_finish(conn->mh);
+  conn->mh = NULL;
+  g_free(conn->topic_template);
+  g_free(conn);
   nvds_log_close();
   return NVDS_MSGAPI_OK;
 }
@@ -422,5 +388,3 @@ char *nvds_msgapi_getversion()
 {
   return (char *)NVDS_MSGAPI_VERSION;
 }
-
-
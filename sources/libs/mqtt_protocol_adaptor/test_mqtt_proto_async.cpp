@@ -19,8 +19,8 @@
 #define NVDS_VERSION 4.0
 #define SO_PATH "/opt/nvidia/deepstream/deepstream-NVDS_VERSION/lib/"
 
-#define PROTO_SO "libnvds_kafka_proto.so"
-#define KAFKA_PROTO_PATH SO_PATH PROTO_SO
+#define PROTO_SO "libnvds_mqtt_proto.so"
+#define MQTT_PROTO_PATH SO_PATH PROTO_SO
 #define CFG_FILE "./config.txt"
 
 void sample_msgapi_connect_cb(NvDsMsgApiHandle *h_ptr, NvDsMsgApiEventType ds_evt)
@@ -48,7 +48,7 @@ int main()
 				        size_t nbuf, nvds_msgapi_send_cb_t send_callback, void *user_ptr);
    void (*msgapi_do_work_ptr) (NvDsMsgApiHandle h_ptr); 
    NvDsMsgApiErrorType (*msgapi_disconnect_ptr)(NvDsMsgApiHandle h_ptr);
-   void *so_handle = dlopen(KAFKA_PROTO_PATH, RTLD_LAZY);
+   void *so_handle = dlopen(MQTT_PROTO_PATH, RTLD_LAZY);
    char *error;
    const char SEND_MSG[]= "{ \
    \"messageid\" : \"84a3a0ad-7eb8-49a2-9aa7-104ded6764d0_c788ea9efa50\", \
@@ -118,8 +118,8 @@ int main()
 	exit(-1);
     }
 
-   // set kafka broker appropriately
-   conn_handle = msgapi_connect_ptr((char *)"yourserver.yourdomain.net;9092;yourtopic",(nvds_msgapi_connect_cb_t) sample_msgapi_connect_cb, (char *)CFG_FILE);
+   // set mqtt broker appropriately
+   conn_handle = msgapi_connect_ptr((char *)"localhost;1883;yourtopic",(nvds_msgapi_connect_cb_t) sample_msgapi_connect_cb, (char *)CFG_FILE);
     if (!conn_handle) {
       printf("Connect failed. Exiting\n");
       exit(-1);
@@ -20,8 +20,8 @@
 #define NVDS_VERSION 4.0
 #define SO_PATH "/opt/nvidia/deepstream/deepstream-NVDS_VERSION/lib/"
 
-#define PROTO_SO "libnvds_kafka_proto.so"
-#define KAFKA_PROTO_PATH SO_PATH PROTO_SO
+#define PROTO_SO "libnvds_mqtt_proto.so"
+#define MQTT_PROTO_PATH SO_PATH PROTO_SO
 #define CFG_FILE "./config.txt"
 
 void sample_msgapi_connect_cb(NvDsMsgApiHandle *h_ptr, NvDsMsgApiEventType ds_evt)
@@ -33,7 +33,7 @@ int main()
    NvDsMsgApiHandle (*msgapi_connect_ptr)(char *connection_str, nvds_msgapi_connect_cb_t connect_cb, char *config_path);
    NvDsMsgApiErrorType (*msgapi_send_ptr)(NvDsMsgApiHandle conn, char *topic, const uint8_t *payload, size_t nbuf);
    NvDsMsgApiErrorType (*msgapi_disconnect_ptr)(NvDsMsgApiHandle h_ptr);
-   void *so_handle = dlopen(KAFKA_PROTO_PATH, RTLD_LAZY);
+   void *so_handle = dlopen(MQTT_PROTO_PATH, RTLD_LAZY);
    char *error;
    //   const char SEND_MSG[]="Hello World";
    const char SEND_MSG[]= "{ \
@@ -103,8 +103,8 @@ int main()
 	exit(-1);
     }
 
-    // set kafka broker appropriately
-   conn_handle = msgapi_connect_ptr((char *)"yourserver.yourdomain.net;9092;yourtopic",(nvds_msgapi_connect_cb_t) sample_msgapi_connect_cb, (char *)CFG_FILE);
+    // set mqtt broker appropriately
+   conn_handle = msgapi_connect_ptr((char *)"localhost;1883;yourtopic",(nvds_msgapi_connect_cb_t) sample_msgapi_connect_cb, (char *)CFG_FILE);
     
     if (!conn_handle) {
       printf("Connect failed. Exiting\n");
@@ -118,7 +118,7 @@ int main()
 	printf("send [%d] failed\n", i);
       else {
 	printf("send [%d] completed\n", i);
-	nvds_log("TEST_KAFKA_PROTO", LOG_ERR, "send [%d] completed\n", i);
+	nvds_log("TEST_MQTT_PROTO", LOG_ERR, "send [%d] completed\n", i);
       sleep(1);
       }
     }
@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "nvdsinfer_cluster.h"
+
+using namespace std;
+
+/* Rectangle of an object, as converted to cv::Rect. */
+typedef struct
+{
+    int x, y, width, height;
+} ClusterRect;
+
+/* Sums of the rectangles of a cluster. */
+typedef struct
+{
+    ClusterRect sum;
+    int count;
+    unsigned int classId;
+    float confidence;
+} ClusterSum;
+
+/* Cluster rectangle inflated by eps, another cluster inside it is dropped. */
+typedef struct
+{
+    int left, top, right, bottom;
+    int count;
+    unsigned int cluster;
+} ClusterBounds;
+
+/* Per thread buffers, reused by the calls. */
+typedef struct
+{
+    vector<ClusterRect> rects;
+    vector<ClusterRect> sorted;
+    vector<unsigned int> order;
+    vector<int> reach;
+    vector<int> band;
+    vector<int> parent;
+    vector<int> label;
+    vector<ClusterSum> sums;
+    vector<ClusterRect> averages;
+    vector<unsigned int> big;
+    vector<ClusterBounds> bounds;
+} ClusterScratch;
+
+/* SimilarRects predicate of groupRectangles. */
+static inline bool
+similarRects(ClusterRect const &r1, ClusterRect const &r2, double eps)
+{
+    double delta = eps * (min(r1.width, r2.width) + min(r1.height, r2.height)) * 0.5;
+    return abs(r1.x - r2.x) <= delta &&
+        abs(r1.y - r2.y) <= delta &&
+        abs(r1.x + r1.width - r2.x - r2.width) <= delta &&
+        abs(r1.y + r1.height - r2.y - r2.height) <= delta;
+}
+
+/* Largest distance on x or y of a rectangle similar to @r. */
+static inline int
+reachOf(ClusterRect const &r, double eps)
+{
+    return min(floor(eps * (r.width + r.height) * 0.5), (double) INT_MAX / 4);
+}
+
+static inline int
+findRoot(vector<int> &parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void
+NvDsInferGroupRectangles(vector<NvDsInferObjectDetectionInfo> &objects,
+        int groupThreshold, double eps)
+{
+    static thread_local ClusterScratch scratch;
+    int numObjects = objects.size();
+    int numClusters = 0;
+
+    if (groupThreshold <= 0 || objects.empty())
+        return;
+
+    vector<ClusterRect> &rects = scratch.rects;
+    vector<ClusterRect> &sorted = scratch.sorted;
+    vector<unsigned int> &order = scratch.order;
+    vector<int> &parent = scratch.parent;
+    vector<int> &reach = scratch.reach;
+    vector<int> &band = scratch.band;
+    int bandHeight = 1;
+    int minY = INT_MAX;
+
+    /* Similar rectangles differ on x and y by at most eps * (w + h) / 2 of
+     * either of them, the reach of a rectangle. */
+    rects.resize(numObjects);
+    order.resize(numObjects);
+    parent.resize(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        ClusterRect &r = rects[i];
+        r = { (int) objects[i].left, (int) objects[i].top,
+            (int) objects[i].width, (int) objects[i].height };
+        bandHeight = max(bandHeight, reachOf(r, eps));
+        minY = min(minY, r.y);
+        order[i] = i;
+        parent[i] = i;
+    }
+
+    /* Rectangles are sorted by horizontal bands as high as the largest reach,
+     * then by x: a rectangle is only compared with the rectangles after it in
+     * its band and the ones of the next band, within its reach on x. They are
+     * copied in this order for the scans to read memory sequentially. */
+    auto bandOf = [minY, bandHeight](ClusterRect const &r) {
+        return (int) (((int64_t) r.y - minY) / bandHeight);
+    };
+    sort(order.begin(), order.end(), [&rects, &bandOf](unsigned int a, unsigned int b) {
+        int bandA = bandOf(rects[a]);
+        int bandB = bandOf(rects[b]);
+        if (bandA != bandB)
+            return bandA < bandB;
+        return rects[a].x < rects[b].x || (rects[a].x == rects[b].x && a < b);
+    });
+    sorted.resize(numObjects);
+    reach.resize(numObjects);
+    band.resize(numObjects + 1);
+    for (int p = 0; p < numObjects; p++)
+    {
+        sorted[p] = rects[order[p]];
+        reach[p] = reachOf(sorted[p], eps);
+        band[p] = bandOf(sorted[p]);
+    }
+    band[numObjects] = INT_MAX;
+
+    auto unite = [&parent, &order](int p, int q) {
+        int root1 = findRoot(parent, order[p]);
+        int root2 = findRoot(parent, order[q]);
+        if (root1 != root2)
+            parent[max(root1, root2)] = min(root1, root2);
+    };
+
+    int nextBand = 0;
+    int nextBandEnd = 0;
+    for (int p = 0; p < numObjects; p++)
+    {
+        ClusterRect const &r1 = sorted[p];
+        int q;
+
+        for (q = p + 1; band[q] == band[p] && sorted[q].x - r1.x <= reach[p]; q++)
+        {
+            if (abs(sorted[q].y - r1.y) <= reach[p] &&
+                similarRects(r1, sorted[q], eps))
+                unite(p, q);
+        }
+
+        if (nextBand <= p)
+        {
+            for (nextBand = p + 1; band[nextBand] == band[p]; nextBand++)
+                ;
+            for (nextBandEnd = nextBand; band[nextBandEnd] == band[nextBand]; nextBandEnd++)
+                ;
+        }
+        if (band[nextBand] != band[p] + 1)
+            continue;
+
+        q = lower_bound(sorted.begin() + nextBand, sorted.begin() + nextBandEnd,
+                r1.x - reach[p], [](ClusterRect const &r, int x) { return r.x < x; }) -
+            sorted.begin();
+        for (; q < nextBandEnd && sorted[q].x - r1.x <= reach[p]; q++)
+        {
+            if (abs(sorted[q].y - r1.y) <= reach[p] &&
+                similarRects(r1, sorted[q], eps))
+                unite(p, q);
+        }
+    }
+
+    /* Clusters are numbered by their first object, as by cv::partition. */
+    scratch.label.assign(numObjects, -1);
+    scratch.sums.clear();
+    for (int i = 0; i < numObjects; i++)
+    {
+        int root = findRoot(parent, i);
+        if (scratch.label[root] < 0)
+        {
+            scratch.label[root] = numClusters++;
+            scratch.sums.push_back({ { 0, 0, 0, 0 }, 0, objects[i].classId,
+                    objects[i].detectionConfidence });
+        }
+
+        ClusterSum &sum = scratch.sums[scratch.label[root]];
+        sum.sum.x += rects[i].x;
+        sum.sum.y += rects[i].y;
+        sum.sum.width += rects[i].width;
+        sum.sum.height += rects[i].height;
+        sum.count++;
+        sum.confidence = max(sum.confidence, objects[i].detectionConfidence);
+    }
+
+    /* Average rectangles, rounded as saturate_cast<int>(float). */
+    scratch.averages.resize(numClusters);
+    scratch.big.clear();
+    scratch.bounds.clear();
+    for (int c = 0; c < numClusters; c++)
+    {
+        ClusterSum const &sum = scratch.sums[c];
+        float s = 1.f / sum.count;
+        ClusterRect &r = scratch.averages[c];
+
+        r = { (int) lrintf(sum.sum.x * s), (int) lrintf(sum.sum.y * s),
+            (int) lrintf(sum.sum.width * s), (int) lrintf(sum.sum.height * s) };
+        if (sum.count <= groupThreshold)
+            continue;
+
+        int dx = lrint(r.width * eps);
+        int dy = lrint(r.height * eps);
+        scratch.big.push_back(c);
+        scratch.bounds.push_back({ r.x - dx, r.y - dy, r.x + r.width + dx,
+                r.y + r.height + dy, sum.count, (unsigned int) c });
+    }
+
+    /* A cluster can only be inside the bounds starting left of it and
+     * ending right of it: with the bounds sorted by left edge, the ones to
+     * check are within the widest bounds of its left edge. */
+    vector<ClusterBounds> &bounds = scratch.bounds;
+    int maxSpan = 0;
+    sort(bounds.begin(), bounds.end(), [](ClusterBounds const &a, ClusterBounds const &b) {
+        return a.left < b.left;
+    });
+    for (auto const &b : bounds)
+        maxSpan = max(maxSpan, b.right - b.left);
+
+    /* Keep the clusters of more than groupThreshold rectangles, except the
+     * ones inside another such cluster of more rectangles. */
+    objects.clear();
+    for (unsigned int i : scratch.big)
+    {
+        ClusterRect const &r1 = scratch.averages[i];
+        int n1 = scratch.sums[i].count;
+        int minLeft = r1.x + r1.width - maxSpan;
+        bool inside = false;
+
+        auto b = lower_bound(bounds.begin(), bounds.end(), minLeft,
+                [](ClusterBounds const &a, int left) { return a.left < left; });
+        for (; b != bounds.end() && b->left <= r1.x; ++b)
+        {
+            if (b->cluster != i &&
+                r1.y >= b->top &&
+                r1.x + r1.width <= b->right &&
+                r1.y + r1.height <= b->bottom &&
+                (b->count > max(3, n1) || n1 < 3))
+            {
+                inside = true;
+                break;
+            }
+        }
+        if (inside)
+            continue;
+
+        NvDsInferObjectDetectionInfo object;
+        object.classId = scratch.sums[i].classId;
+        object.left = r1.x;
+        object.top = r1.y;
+        object.width = r1.width;
+        object.height = r1.height;
+        object.detectionConfidence = scratch.sums[i].confidence;
+        objects.push_back(object);
+    }
+}
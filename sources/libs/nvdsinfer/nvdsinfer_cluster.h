@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __NVDSINFER_CLUSTER_H__
+#define __NVDSINFER_CLUSTER_H__
+
+#include <vector>
+
+#include <nvdsinfer.h>
+
+/**
+ * Groups the objects of one class as cv::groupRectangles groups their
+ * rectangles, without OpenCV.
+ *
+ * Objects are similar if their edges differ by at most
+ * eps * (min widths + min heights) / 2. Clusters are the connected components
+ * of similar objects and an output object is the rounded average of a
+ * cluster. Clusters of at most @a groupThreshold objects are dropped, as well
+ * as clusters inside a bigger one. Output objects are in the order of
+ * groupRectangles, with the class of the cluster and the highest confidence of
+ * its objects. Nothing is done if @a groupThreshold <= 0.
+ *
+ * Objects are sorted by left edge and only the ones within the largest
+ * possible distance on x are compared: O(n log n) when objects are spread.
+ */
+void NvDsInferGroupRectangles(std::vector<NvDsInferObjectDetectionInfo> &objects,
+        int groupThreshold, double eps);
+
+#endif
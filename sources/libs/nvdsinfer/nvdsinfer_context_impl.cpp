@@ -9,6 +9,7 @@
  *
  */
 
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <iostream>
@@ -183,9 +184,11 @@ NvDsInferContextImpl::NvDsInferLogger::log(Severity severity, const char *msg)
 NvDsInferContextImpl::NvDsInferContextImpl() :
         INvDsInferContext(),
         m_UniqueID(0),
-        m_DBScanHandle(nullptr),
         m_CustomLibHandle(nullptr),
         m_CustomBBoxParseFunc(nullptr),
+        m_CustomParserCreateFunc(nullptr),
+        m_CustomParserParseFunc(nullptr),
+        m_CustomParserDestroyFunc(nullptr),
         m_CustomClassifierParseFunc(nullptr),
         m_RuntimePluginFactory(nullptr),
         m_GpuID (0),
@@ -198,6 +201,7 @@ NvDsInferContextImpl::NvDsInferContextImpl() :
         m_BufferCopyStream(nullptr),
         m_MeanDataBuffer(nullptr),
         m_Batches(NVDSINFER_MIN_OUTPUT_BUFFERPOOL_SIZE),
+        m_LegacyOutputAllocation(false),
         m_InputConsumedEvent(nullptr),
         m_PreProcessCompleteEvent(nullptr),
         m_InferCompleteEvent(nullptr),
@@ -214,36 +218,33 @@ NvDsInferStatus
 NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
         void *userCtx, NvDsInferContextLoggingFunc logFunc)
 {
-    cudaError_t cudaReturn;
-    bool generateModel = true;
-    std::string nvtx_name;
-
     m_LoggingFunc = logFunc;
     m_UserCtx = userCtx;
 
-    /* Synchronization using once_flag and call_once to ensure TensorRT plugin
-     * initialization function is called only once in case of multiple instances
-     * of this constructor being called from different threads. */
-    {
-        static once_flag pluginInitFlag;
-        call_once(pluginInitFlag,
-                [this]() { initLibNvInferPlugins(&this->m_Logger, ""); } );
-    }
-
     m_UniqueID = initParams.uniqueID;
     m_MaxBatchSize = initParams.maxBatchSize;
     m_NetworkScaleFactor = initParams.networkScaleFactor;
     m_NetworkInputFormat = initParams.networkInputFormat;
     m_NetworkType = initParams.networkType;
-    m_UseDBScan = initParams.useDBScan;
+    m_ClusterMode = initParams.useDBScan ? NvDsInferClusterMode_DBSCAN :
+        initParams.clusterMode;
 
     m_ClassifierThreshold = initParams.classifierThreshold;
+    m_ClassifierActivation = initParams.classifierActivation;
+    m_ClassifierTopK = std::max(1u, initParams.classifierTopK);
     m_SegmentationThreshold = initParams.segmentationThreshold;
+    m_SegmentationMapScale = std::max(1u, initParams.segmentationMapScale);
+    m_SegmentationMapRLE = initParams.segmentationMapRLE;
     m_GpuID = initParams.gpuID;
     m_CopyInputToHostBuffers = initParams.copyInputToHostBuffers;
+    m_LegacyOutputAllocation = initParams.legacyOutputAllocation;
     m_OutputBufferPoolSize = initParams.outputBufferPoolSize;
     m_Batches.resize(m_OutputBufferPoolSize);
 
+    /* No more workers than frames in a batch. */
+    m_ParseScratch.resize(std::max(1u,
+                std::min(initParams.outputParseWorkers, m_MaxBatchSize)));
+
     if (m_UniqueID == 0)
     {
         printError("Unique ID not set");
@@ -272,6 +273,11 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
                 printError("NumDetectedClasses > 0 but PerClassDetectionParams array not specified");
                 return NVDSINFER_CONFIG_FAILED;
             }
+            if (m_ClusterMode > NvDsInferClusterMode_Native)
+            {
+                printError("Unknown cluster mode (%d)", m_ClusterMode);
+                return NVDSINFER_CONFIG_FAILED;
+            }
 
             m_PerClassDetectionParams.assign(initParams.perClassDetectionParams,
                     initParams.perClassDetectionParams + m_NumDetectedClasses);
@@ -279,10 +285,13 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
             m_DetectionParams.perClassThreshold.resize(initParams.numDetectedClasses);
 
             /* Resize the per class vector to the number of detected classes. */
-            m_PerClassObjectList.resize(initParams.numDetectedClasses);
-            if (!m_UseDBScan)
+            for (auto & scratch:m_ParseScratch)
             {
-                m_PerClassCvRectList.resize(initParams.numDetectedClasses);
+                scratch.m_PerClassObjectList.resize(initParams.numDetectedClasses);
+                if (m_ClusterMode == NvDsInferClusterMode_OpenCV)
+                {
+                    scratch.m_PerClassCvRectList.resize(initParams.numDetectedClasses);
+                }
             }
 
             /* Fill the class thresholds in the m_DetectionParams structure. This
@@ -322,6 +331,220 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
         return NVDSINFER_CONFIG_FAILED;
     }
 
+    /* Load the custom library if specified. */
+    if (!string_empty(initParams.customLibPath))
+    {
+        m_CustomLibHandle = dlopen (initParams.customLibPath, RTLD_LAZY);
+        if (!m_CustomLibHandle)
+        {
+            printError("Could not open custom lib: %s", dlerror());
+            return NVDSINFER_CUSTOM_LIB_FAILED;
+        }
+    }
+
+    NvDsInferStatus status = initInferenceEngine(initParams);
+    if (status != NVDSINFER_SUCCESS)
+        return status;
+
+    switch (m_NetworkInputFormat)
+    {
+        case NvDsInferFormat_RGB:
+        case NvDsInferFormat_BGR:
+            if (m_NetworkInfo.channels != 3)
+            {
+                printError("RGB/BGR input format specified but network input"
+                    " channels is not 3");
+                return NVDSINFER_CONFIG_FAILED;
+            }
+            break;
+        case NvDsInferFormat_GRAY:
+            if (m_NetworkInfo.channels != 1)
+            {
+                printError("GRAY input format specified but network input "
+                    "channels is not 1.");
+                return NVDSINFER_CONFIG_FAILED;
+            }
+            break;
+        default:
+            printError("Unknown input format");
+            return NVDSINFER_CONFIG_FAILED;
+    }
+
+    /* Parse the labels file if specified. */
+    if (!string_empty(initParams.labelsFilePath))
+    {
+        if (!file_accessible(initParams.labelsFilePath))
+        {
+            printError("Could not access labels file '%s'", initParams.labelsFilePath);
+            return NVDSINFER_CONFIG_FAILED;
+        }
+        status = parseLabelsFile(initParams.labelsFilePath);
+        if (status != NVDSINFER_SUCCESS)
+        {
+            printError("Failed to read labels file");
+            return status;
+        }
+    }
+
+    /* If custom parse function is specified get the function address from the
+     * custom library, or the functions of the stateful parser of that name if
+     * the library defines one. */
+    if (m_CustomLibHandle && m_NetworkType == NvDsInferNetworkType_Detector &&
+            !string_empty(initParams.customBBoxParseFuncName))
+    {
+        string name = initParams.customBBoxParseFuncName;
+        m_CustomParserCreateFunc = (NvDsInferParserCreateFunc) dlsym(
+                m_CustomLibHandle, (name + "Create").c_str());
+        if (m_CustomParserCreateFunc)
+        {
+            m_CustomParserParseFunc = (NvDsInferParserParseFunc) dlsym(
+                    m_CustomLibHandle, (name + "Parse").c_str());
+            m_CustomParserDestroyFunc = (NvDsInferParserDestroyFunc) dlsym(
+                    m_CustomLibHandle, (name + "Destroy").c_str());
+            if (!m_CustomParserParseFunc || !m_CustomParserDestroyFunc)
+            {
+                printError("Could not find %sParse or %sDestroy in custom "
+                        "library", name.c_str(), name.c_str());
+                return NVDSINFER_CONFIG_FAILED;
+            }
+        }
+        else
+        {
+            m_CustomBBoxParseFunc =
+                (NvDsInferParseCustomFunc) dlsym(m_CustomLibHandle,
+                        initParams.customBBoxParseFuncName);
+            if (!m_CustomBBoxParseFunc)
+            {
+                printError("Could not find parse func '%s' in custom library",
+                    initParams.customBBoxParseFuncName);
+                return NVDSINFER_CONFIG_FAILED;
+            }
+        }
+    }
+
+    if (m_CustomLibHandle && m_NetworkType == NvDsInferNetworkType_Classifier &&
+            !string_empty(initParams.customClassifierParseFuncName))
+    {
+        m_CustomClassifierParseFunc =
+            (NvDsInferClassiferParseCustomFunc) dlsym(m_CustomLibHandle,
+                    initParams.customClassifierParseFuncName);
+        if (!m_CustomClassifierParseFunc)
+        {
+            printError("Could not find parse func '%s' in custom library",
+                initParams.customClassifierParseFuncName);
+            return NVDSINFER_CONFIG_FAILED;
+        }
+    }
+
+    /* If there are more than one input layers (non-image input) and custom
+     * library is specified, try to initialize these layers. */
+    if (m_AllLayerInfo.size() > 1 + m_OutputLayerInfo.size())
+    {
+        NvDsInferStatus status = initNonImageInputLayers();
+        if (status != NVDSINFER_SUCCESS)
+        {
+            printError("Failed to initialize non-image input layers");
+            return status;
+        }
+    }
+
+    if (m_NetworkType == NvDsInferNetworkType_Segmentation &&
+            m_SegmentationMapScale > 1 && !m_OutputLayerInfo.empty())
+    {
+        NvDsInferDimsCHW dims;
+        getDimsCHWFromDims(dims, m_OutputLayerInfo[0].dims);
+        if (dims.w % m_SegmentationMapScale || dims.h % m_SegmentationMapScale)
+        {
+            printError("Segmentation map scale (%u) does not divide the output "
+                    "dims (%ux%u)", m_SegmentationMapScale, dims.w, dims.h);
+            return NVDSINFER_CONFIG_FAILED;
+        }
+    }
+
+    if (m_NetworkType == NvDsInferNetworkType_Classifier &&
+            m_ClassifierActivation != NvDsInferClassifierActivation_None)
+    {
+        for (auto const & layerInfo:m_OutputLayerInfo)
+        {
+            if (layerInfo.dataType != FLOAT)
+            {
+                printError("Classifier activation needs float output layers, "
+                        "%s is not", layerInfo.layerName);
+                return NVDSINFER_CONFIG_FAILED;
+            }
+        }
+        for (auto & scratch:m_ParseScratch)
+        {
+            scratch.m_ClassifierProbabilities.resize(m_OutputLayerInfo.size());
+            for (unsigned int l = 0; l < m_OutputLayerInfo.size(); l++)
+                scratch.m_ClassifierProbabilities[l].resize(
+                        m_OutputLayerInfo[l].dims.numElements);
+        }
+    }
+
+    if (m_NetworkType == NvDsInferNetworkType_Detector &&
+            m_ClusterMode == NvDsInferClusterMode_DBSCAN)
+    {
+        for (auto & scratch:m_ParseScratch)
+            scratch.m_DBScanHandle = NvDsInferDBScanCreate();
+    }
+
+    /* One instance of the stateful custom parser per worker, so that the
+     * instances need no locking. */
+    if (m_CustomParserCreateFunc)
+    {
+        NvDsInferParserInitParams parserParams;
+        parserParams.outputLayersInfo = m_OutputLayerInfo;
+        parserParams.networkInfo = m_NetworkInfo;
+        parserParams.detectionParams = m_DetectionParams;
+        for (unsigned int i = 0; i < initParams.numCustomParserProperties; i++)
+            parserParams.properties.push_back(
+                    initParams.customParserProperties[i]);
+
+        for (auto & scratch:m_ParseScratch)
+        {
+            scratch.m_CustomParser = m_CustomParserCreateFunc(parserParams);
+            if (!scratch.m_CustomParser)
+            {
+                printError("Failed to create the custom parser %s",
+                        initParams.customBBoxParseFuncName);
+                /* The instances already created are destroyed with the
+                 * context. */
+                return NVDSINFER_CUSTOM_LIB_FAILED;
+            }
+        }
+    }
+
+    if (m_ParseScratch.size() > 1)
+    {
+        m_ParsePool.reset(new NvDsInferParsePool(m_ParseScratch.size()));
+        printInfo("Parsing the outputs of a batch with %zu workers",
+                m_ParseScratch.size());
+    }
+
+    m_Initialized = true;
+
+    return NVDSINFER_SUCCESS;
+}
+
+/* Create the TensorRT engine and execution context of the network and the
+ * cuda resources to run it. */
+NvDsInferStatus
+NvDsInferContextImpl::initInferenceEngine(NvDsInferContextInitParams &initParams)
+{
+    cudaError_t cudaReturn;
+    bool generateModel = true;
+    std::string nvtx_name;
+
+    /* Synchronization using once_flag and call_once to ensure TensorRT plugin
+     * initialization function is called only once in case of multiple instances
+     * of this constructor being called from different threads. */
+    {
+        static once_flag pluginInitFlag;
+        call_once(pluginInitFlag,
+                [this]() { initLibNvInferPlugins(&this->m_Logger, ""); } );
+    }
+
     /* Set the cuda device to be used. */
     cudaReturn = cudaSetDevice(m_GpuID);
     if (cudaReturn != cudaSuccess)
@@ -338,17 +561,6 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
         return NVDSINFER_TENSORRT_ERROR;
     }
 
-    /* Load the custom library if specified. */
-    if (!string_empty(initParams.customLibPath))
-    {
-        m_CustomLibHandle = dlopen (initParams.customLibPath, RTLD_LAZY);
-        if (!m_CustomLibHandle)
-        {
-            printError("Could not open custom lib: %s", dlerror());
-            return NVDSINFER_CUSTOM_LIB_FAILED;
-        }
-    }
-
     /* If the custom library is specified, check if PluginFactory instance is
      * required during deserialization of cuda engine. */
     NvDsInferPluginFactoryRuntimeGetFcn fcn = nullptr;
@@ -423,30 +635,6 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
     m_NetworkInfo.height = inputDims.h();
     m_NetworkInfo.channels = inputDims.c();
 
-    switch (m_NetworkInputFormat)
-    {
-        case NvDsInferFormat_RGB:
-        case NvDsInferFormat_BGR:
-            if (m_NetworkInfo.channels != 3)
-            {
-                printError("RGB/BGR input format specified but network input"
-                    " channels is not 3");
-                return NVDSINFER_CONFIG_FAILED;
-            }
-            break;
-        case NvDsInferFormat_GRAY:
-            if (m_NetworkInfo.channels != 1)
-            {
-                printError("GRAY input format specified but network input "
-                    "channels is not 1.");
-                return NVDSINFER_CONFIG_FAILED;
-            }
-            break;
-        default:
-            printError("Unknown input format");
-            return NVDSINFER_CONFIG_FAILED;
-    }
-
     /* Create the mean data buffer from mean image file or per color component
      * offsets if either are specified. */
     if (!string_empty(initParams.meanImageFilePath) || initParams.numOffsets > 0)
@@ -569,22 +757,6 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
         return status;
     }
 
-    /* Parse the labels file if specified. */
-    if (!string_empty(initParams.labelsFilePath))
-    {
-        if (!file_accessible(initParams.labelsFilePath))
-        {
-            printError("Could not access labels file '%s'", initParams.labelsFilePath);
-            return NVDSINFER_CONFIG_FAILED;
-        }
-        NvDsInferStatus status = parseLabelsFile(initParams.labelsFilePath);
-        if (status != NVDSINFER_SUCCESS)
-        {
-            printError("Failed to read labels file");
-            return status;
-        }
-    }
-
     /* Cuda event to synchronize between consumption of input binding buffer by
      * the cuda engine and the pre-processing kernel which writes to the input
      * binding buffer. */
@@ -622,55 +794,6 @@ NvDsInferContextImpl::initialize(NvDsInferContextInitParams &initParams,
     nvtx_name = "nvdsinfer_infer_complete_uid=" + to_string(m_UniqueID);
     nvtxNameCudaEventA (m_InferCompleteEvent, nvtx_name.c_str());
 
-    /* If custom parse function is specified get the function address from the
-     * custom library. */
-    if (m_CustomLibHandle && m_NetworkType == NvDsInferNetworkType_Detector &&
-            !string_empty(initParams.customBBoxParseFuncName))
-    {
-        m_CustomBBoxParseFunc =
-            (NvDsInferParseCustomFunc) dlsym(m_CustomLibHandle,
-                    initParams.customBBoxParseFuncName);
-        if (!m_CustomBBoxParseFunc)
-        {
-            printError("Could not find parse func '%s' in custom library",
-                initParams.customBBoxParseFuncName);
-            return NVDSINFER_CONFIG_FAILED;
-        }
-    }
-
-    if (m_CustomLibHandle && m_NetworkType == NvDsInferNetworkType_Classifier &&
-            !string_empty(initParams.customClassifierParseFuncName))
-    {
-        m_CustomClassifierParseFunc =
-            (NvDsInferClassiferParseCustomFunc) dlsym(m_CustomLibHandle,
-                    initParams.customClassifierParseFuncName);
-        if (!m_CustomClassifierParseFunc)
-        {
-            printError("Could not find parse func '%s' in custom library",
-                initParams.customClassifierParseFuncName);
-            return NVDSINFER_CONFIG_FAILED;
-        }
-    }
-
-    /* If there are more than one input layers (non-image input) and custom
-     * library is specified, try to initialize these layers. */
-    if (m_AllLayerInfo.size() > 1 + m_OutputLayerInfo.size())
-    {
-        NvDsInferStatus status = initNonImageInputLayers();
-        if (status != NVDSINFER_SUCCESS)
-        {
-            printError("Failed to initialize non-image input layers");
-            return status;
-        }
-    }
-
-    if (m_UseDBScan)
-    {
-        m_DBScanHandle = NvDsInferDBScanCreate();
-    }
-
-    m_Initialized = true;
-
     return NVDSINFER_SUCCESS;
 }
 
@@ -1135,12 +1258,7 @@ NvDsInferContextImpl::queueInputBatch(NvDsInferContextBatchInput &batchInput)
      * free queue. Wait if queue is empty. */
     {
         unique_lock<mutex> lock(m_QueueMutex);
-        while (m_FreeIndexQueue.empty())
-        {
-            m_QueueCondition.wait(lock);
-        }
-        batchIndex = m_FreeIndexQueue.front();
-        m_FreeIndexQueue.pop();
+        batchIndex = m_FreeIndexQueue.pop(lock);
     }
 
     /* Inputs can be returned back once pre-processing is complete. */
@@ -1276,7 +1394,6 @@ NvDsInferContextImpl::queueInputBatch(NvDsInferContextBatchInput &batchInput)
     {
         unique_lock<mutex> lock(m_QueueMutex);
         m_ProcessIndexQueue.push(batchIndex);
-        m_QueueCondition.notify_one();
     }
     return NVDSINFER_SUCCESS;
 
@@ -1288,101 +1405,180 @@ error:
     return status;
 }
 
-/* Dequeue batch output of the inference engine for each batch input. */
-NvDsInferStatus
-NvDsInferContextImpl::dequeueOutputBatch(NvDsInferContextBatchOutput &batchOutput)
+/* Parse the output of the frame at frameIndex in a batch, with the scratch
+ * state of the calling worker. */
+void
+NvDsInferContextImpl::fillFrameOutput(NvDsInferParseScratch &scratch,
+        unsigned int batchIndex, unsigned int frameIndex,
+        NvDsInferFrameOutput &frameOutput)
 {
-    unsigned int batchIndex;
+    NvDsInferBatch & batch = m_Batches[batchIndex];
 
-    /* Set the cuda device */
+    frameOutput.outputType = NvDsInferNetworkType_Other;
+    scratch.m_FrameObjects = m_LegacyOutputAllocation ? nullptr :
+        &batch.m_FrameObjects[frameIndex];
+    scratch.m_FrameClassMap = m_LegacyOutputAllocation ? nullptr :
+        &batch.m_FrameClassMaps[frameIndex];
+    scratch.m_FrameAttributes = m_LegacyOutputAllocation ? nullptr :
+        &batch.m_FrameAttributes[frameIndex];
+    scratch.m_FrameLabel = m_LegacyOutputAllocation ? nullptr :
+        &batch.m_FrameLabels[frameIndex];
+
+    /* Calculate the pointer to the output for each frame in the batch for
+     * each output layer buffer. The NvDsInferLayerInfo vector for output
+     * layers is passed to the output parsing function. */
+    scratch.m_OutputLayerInfo = m_OutputLayerInfo;
+    for (unsigned int i = 0; i < scratch.m_OutputLayerInfo.size(); i++)
+    {
+        NvDsInferLayerInfo & info = scratch.m_OutputLayerInfo[i];
+        info.buffer =
+            (void *)(batch.m_HostBuffers[info.bindingIndex].data() +
+                     info.dims.numElements *
+                     getElementSize(info.dataType) * frameIndex);
+    }
+
+    switch (m_NetworkType)
+    {
+        case NvDsInferNetworkType_Detector:
+            fillDetectionOutput(scratch, frameOutput.detectionOutput);
+            frameOutput.outputType = NvDsInferNetworkType_Detector;
+            break;
+        case NvDsInferNetworkType_Classifier:
+            fillClassificationOutput(scratch, frameOutput.classificationOutput);
+            frameOutput.outputType = NvDsInferNetworkType_Classifier;
+            break;
+        case NvDsInferNetworkType_Segmentation:
+            fillSegmentationOutput(scratch, frameOutput.segmentationOutput);
+            frameOutput.outputType = NvDsInferNetworkType_Segmentation;
+            break;
+        default:
+            break;
+    }
+}
+
+NvDsInferStatus
+NvDsInferContextImpl::setDevice()
+{
     cudaError_t cudaReturn = cudaSetDevice(m_GpuID);
     if (cudaReturn != cudaSuccess)
     {
         printError("Failed to set cuda device (%s)", cudaGetErrorName(cudaReturn));
         return NVDSINFER_CUDA_ERROR;
     }
+    return NVDSINFER_SUCCESS;
+}
+
+NvDsInferStatus
+NvDsInferContextImpl::waitForOutput(NvDsInferBatch &batch)
+{
+    cudaError_t cudaReturn = cudaEventSynchronize(batch.m_CopyCompleteEvent);
+    if (cudaReturn != cudaSuccess)
+    {
+        printError("Failed to synchronize on cuda event (%s)",
+                cudaGetErrorName(cudaReturn));
+        return NVDSINFER_CUDA_ERROR;
+    }
+    return NVDSINFER_SUCCESS;
+}
+
+/* Dequeue batch output of the inference engine for each batch input. */
+NvDsInferStatus
+NvDsInferContextImpl::dequeueOutputBatch(NvDsInferContextBatchOutput &batchOutput)
+{
+    unsigned int batchIndex;
+
+    /* Set the cuda device */
+    NvDsInferStatus status = setDevice();
+    if (status != NVDSINFER_SUCCESS)
+        return status;
 
     /* Pop a batch index from the process queue. Wait if
      * the queue is empty. */
     {
         unique_lock<mutex> lock(m_QueueMutex);
-        while (m_ProcessIndexQueue.empty())
-        {
-            m_QueueCondition.wait(lock);
-        }
-        batchIndex = m_ProcessIndexQueue.front();
-        m_ProcessIndexQueue.pop();
+        batchIndex = m_ProcessIndexQueue.pop(lock);
     }
     NvDsInferBatch & batch = m_Batches[batchIndex];
 
     /* Wait for the copy to the current set of host buffers to complete. */
-    cudaReturn = cudaEventSynchronize (batch.m_CopyCompleteEvent);
-    if (cudaReturn != cudaSuccess)
+    status = waitForOutput(batch);
+    if (status != NVDSINFER_SUCCESS)
     {
-        printError("Failed to synchronize on cuda event (%s)",
-                cudaGetErrorName(cudaReturn));
         {
             unique_lock<std::mutex> lock(m_QueueMutex);
             m_FreeIndexQueue.push(batchIndex);
-            m_QueueCondition.notify_one();
         }
-        return NVDSINFER_CUDA_ERROR;
+        return status;
     }
 
-    batchOutput.frames = new NvDsInferFrameOutput[batch.m_BatchSize];
+    if (m_LegacyOutputAllocation)
+    {
+        batchOutput.frames = new NvDsInferFrameOutput[batch.m_BatchSize];
+    }
+    else
+    {
+        /* Arrays only grow, the objects of the previous outputs of the batch
+         * are overwritten. */
+        if (batch.m_FrameOutputs.size() < batch.m_BatchSize)
+        {
+            batch.m_FrameOutputs.resize(batch.m_BatchSize);
+            batch.m_FrameObjects.resize(batch.m_BatchSize);
+            batch.m_FrameClassMaps.resize(batch.m_BatchSize);
+            batch.m_FrameAttributes.resize(batch.m_BatchSize);
+            batch.m_FrameLabels.resize(batch.m_BatchSize);
+        }
+        batchOutput.frames = batch.m_FrameOutputs.data();
+    }
     batchOutput.numFrames = batch.m_BatchSize;
     /* For each frame in the current batch, parse the output and add the frame
      * output to the batch output. The number of frames output in one batch
      * will be equal to the number of frames present in the batch during queuing
      * at the input.
      */
-    for (unsigned int index = 0; index < batch.m_BatchSize; index++)
+    if (m_ParsePool)
     {
-        NvDsInferFrameOutput &frameOutput = batchOutput.frames[index];
-        frameOutput.outputType = NvDsInferNetworkType_Other;
-
-        /* Calculate the pointer to the output for each frame in the batch for
-         * each output layer buffer. The NvDsInferLayerInfo vector for output
-         * layers is passed to the output parsing function. */
-        for (unsigned int i = 0; i < m_OutputLayerInfo.size(); i++)
-        {
-            NvDsInferLayerInfo & info = m_OutputLayerInfo[i];
-            info.buffer =
-                (void *)(batch.m_HostBuffers[info.bindingIndex].data() +
-                         info.dims.numElements *
-                         getElementSize(info.dataType) * index);
-        }
-
-        switch (m_NetworkType)
+        m_ParsePool->run(batch.m_BatchSize,
+                [this, &batchOutput, batchIndex](unsigned int index, unsigned int worker) {
+                    fillFrameOutput(m_ParseScratch[worker], batchIndex, index,
+                            batchOutput.frames[index]);
+                });
+    }
+    else
+    {
+        for (unsigned int index = 0; index < batch.m_BatchSize; index++)
         {
-            case NvDsInferNetworkType_Detector:
-                fillDetectionOutput(frameOutput.detectionOutput);
-                frameOutput.outputType = NvDsInferNetworkType_Detector;
-                break;
-            case NvDsInferNetworkType_Classifier:
-                fillClassificationOutput(frameOutput.classificationOutput);
-                frameOutput.outputType = NvDsInferNetworkType_Classifier;
-                break;
-            case NvDsInferNetworkType_Segmentation:
-                fillSegmentationOutput(frameOutput.segmentationOutput);
-                frameOutput.outputType = NvDsInferNetworkType_Segmentation;
-                break;
-            default:
-                break;
+            fillFrameOutput(m_ParseScratch[0], batchIndex, index,
+                    batchOutput.frames[index]);
         }
     }
 
     /* Fill the host buffers information in the output. */
     batchOutput.outputBatchID = batchIndex;
     batchOutput.numHostBuffers = m_AllLayerInfo.size();
-    batchOutput.hostBuffers = new void*[m_AllLayerInfo.size()];
+    if (m_LegacyOutputAllocation)
+    {
+        batchOutput.hostBuffers = new void*[m_AllLayerInfo.size()];
+    }
+    else
+    {
+        batch.m_HostBufferPtrs.resize(m_AllLayerInfo.size());
+        batchOutput.hostBuffers = batch.m_HostBufferPtrs.data();
+    }
     for (size_t i = 0; i < batchOutput.numHostBuffers; i++)
     {
         batchOutput.hostBuffers[i] = m_Batches[batchIndex].m_HostBuffers[i].data();
     }
 
     batchOutput.numOutputDeviceBuffers = m_OutputLayerInfo.size();
-    batchOutput.outputDeviceBuffers = new void*[m_OutputLayerInfo.size()];
+    if (m_LegacyOutputAllocation)
+    {
+        batchOutput.outputDeviceBuffers = new void*[m_OutputLayerInfo.size()];
+    }
+    else
+    {
+        batch.m_OutputDeviceBufferPtrs.resize(m_OutputLayerInfo.size());
+        batchOutput.outputDeviceBuffers = batch.m_OutputDeviceBufferPtrs.data();
+    }
     for (size_t i = 0; i < batchOutput.numOutputDeviceBuffers; i++)
     {
         batchOutput.outputDeviceBuffers[i] =
@@ -1418,7 +1614,6 @@ NvDsInferContextImpl::releaseBatchOutput(NvDsInferContextBatchOutput &batchOutpu
     }
     m_Batches[outputBatchID].m_BuffersWithContext = true;
     m_FreeIndexQueue.push (outputBatchID);
-    m_QueueCondition.notify_one ();
 
     /* Free memory allocated in dequeueOutputBatch */
     for (unsigned int i = 0; i < batchOutput.numFrames; i++)
@@ -1426,9 +1621,13 @@ NvDsInferContextImpl::releaseBatchOutput(NvDsInferContextBatchOutput &batchOutpu
         releaseFrameOutput(batchOutput.frames[i]);
     }
 
-    delete[] batchOutput.frames;
-    delete[] batchOutput.hostBuffers;
-    delete[] batchOutput.outputDeviceBuffers;
+    /* Otherwise the arrays belong to the batch and are reused. */
+    if (m_LegacyOutputAllocation)
+    {
+        delete[] batchOutput.frames;
+        delete[] batchOutput.hostBuffers;
+        delete[] batchOutput.outputDeviceBuffers;
+    }
 }
 
 /**
@@ -1942,8 +2141,10 @@ NvDsInferContextImpl::generateTRTModel(
  */
 NvDsInferContextImpl::~NvDsInferContextImpl()
 {
-    /* Set the cuda device to be used. */
-    cudaError_t cudaReturn = cudaSetDevice(m_GpuID);
+    /* Set the cuda device to be used. Nothing is on the device without an
+     * engine. */
+    cudaError_t cudaReturn = m_CudaEngine ? cudaSetDevice(m_GpuID) :
+        cudaSuccess;
     if (cudaReturn != cudaSuccess)
     {
         printError("Failed to set cuda device %d (%s).", m_GpuID,
@@ -1953,6 +2154,19 @@ NvDsInferContextImpl::~NvDsInferContextImpl()
 
     unique_lock < std::mutex > lock (m_QueueMutex);
 
+    /* Report how long the threads waited on each other. */
+    NvDsInferIndexQueue const *queues[] = { &m_FreeIndexQueue,
+        &m_ProcessIndexQueue };
+    const char *queueNames[] = { "free", "process" };
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        NvDsInferIndexQueueStats const &stats = queues[i]->stats();
+        printDebug("Batch %s queue: %lu batches, max depth %u, "
+                "%lu pops waited %.3f ms", queueNames[i],
+                (unsigned long) stats.pushed, stats.maxDepth,
+                (unsigned long) stats.popWaits, stats.popWaitNs / 1e6);
+    }
+
     /* Clean up other cuda resources. */
     if (m_PreProcessStream)
     {
@@ -1997,8 +2211,16 @@ NvDsInferContextImpl::~NvDsInferContextImpl()
     }
 
 
-    if (m_DBScanHandle)
-        NvDsInferDBScanDestroy(m_DBScanHandle);
+    /* Stop the parsing workers before their scratch state goes away. */
+    m_ParsePool.reset();
+    for (auto & scratch:m_ParseScratch)
+    {
+        if (scratch.m_DBScanHandle)
+            NvDsInferDBScanDestroy(scratch.m_DBScanHandle);
+        /* Before the custom library is closed. */
+        if (scratch.m_CustomParser)
+            m_CustomParserDestroyFunc(scratch.m_CustomParser);
+    }
 
     if (m_InferExecutionContext)
         m_InferExecutionContext->destroy();
@@ -2057,7 +2279,8 @@ createNvDsInferContext(NvDsInferContextHandle *handle,
         NvDsInferContextLoggingFunc logFunc)
 {
     NvDsInferStatus status;
-    NvDsInferContextImpl *ctx = new NvDsInferContextImpl();
+    NvDsInferContextImpl *ctx = string_empty(initParams.replayTensorDir) ?
+        new NvDsInferContextImpl() : new NvDsInferReplayContextImpl();
 
     status = ctx->initialize(initParams, userCtx, logFunc);
     if (status == NVDSINFER_SUCCESS)
@@ -2093,6 +2316,7 @@ NvDsInferContext_ResetInitParams (NvDsInferContextInitParams *initParams)
     initParams->networkScaleFactor = 1.0;
     initParams->networkType = NvDsInferNetworkType_Detector;
     initParams->outputBufferPoolSize = NVDSINFER_MIN_OUTPUT_BUFFERPOOL_SIZE;
+    initParams->classifierTopK = 1;
 }
 
 const char *
@@ -12,8 +12,6 @@
 #ifndef __NVDSINFER_CONTEXT_IMPL_H__
 #define __NVDSINFER_CONTEXT_IMPL_H__
 
-#include <condition_variable>
-#include <queue>
 #include <memory>
 #include <mutex>
 #include <stdarg.h>
@@ -28,6 +26,14 @@
 #include <nvdsinfer_custom_impl.h>
 #include <nvdsinfer_utils.h>
 
+#include "nvdsinfer_classifierparser.h"
+#include "nvdsinfer_cluster.h"
+#include "nvdsinfer_gridparser.h"
+#include "nvdsinfer_index_queue.h"
+#include "nvdsinfer_parse_pool.h"
+#include "nvdsinfer_segmentation.h"
+#include "nvdsinfer_tensor_replay.h"
+
 
 /**
  * Implementation of the INvDsInferContext interface.
@@ -47,11 +53,11 @@ public:
     NvDsInferStatus initialize(NvDsInferContextInitParams &initParams,
             void *userCtx, NvDsInferContextLoggingFunc logFunc);
 
-private:
+protected:
     /**
      * Free up resouces and deinitialize the inference engine.
      */
-    ~NvDsInferContextImpl();
+    virtual ~NvDsInferContextImpl();
 
     /* Implementation of the public methods of INvDsInferContext interface. */
     NvDsInferStatus queueInputBatch(NvDsInferContextBatchInput &batchInput) override;
@@ -70,23 +76,79 @@ private:
     NvDsInferStatus readMeanImageFile(char *meanImageFilePath);
     NvDsInferStatus getBoundLayersInfo();
     NvDsInferStatus allocateBuffers();
+    virtual NvDsInferStatus initInferenceEngine(
+            NvDsInferContextInitParams &initParams);
     NvDsInferStatus parseLabelsFile(char *labelsFilePath);
+
+    /**
+     * Per worker state of the output parsing, for the frames of a batch to be
+     * parsed in parallel.
+     */
+    typedef struct
+    {
+        /* Output layers with the buffers of the frame being parsed. */
+        std::vector<NvDsInferLayerInfo> m_OutputLayerInfo;
+        /* Vector for all parsed objects. */
+        std::vector<NvDsInferObjectDetectionInfo> m_ObjectList;
+        /* Grid cells meeting the threshold, for parseBoundingBox. */
+        NvDsInferGridCandidates m_GridCandidates;
+        /* Vector of cv::Rect vectors for each class. */
+        std::vector<std::vector<cv::Rect>> m_PerClassCvRectList;
+        /* Vector of NvDsInferObjectDetectionInfo vectors for each class. */
+        std::vector<std::vector<NvDsInferObjectDetectionInfo>> m_PerClassObjectList;
+        NvDsInferDBScanHandle m_DBScanHandle = nullptr;
+        /* Instance of the stateful custom bounding box parser. */
+        NvDsInferParserHandle m_CustomParser = nullptr;
+        /* Reused object array of the frame being parsed, nullptr if the
+         * objects are allocated for each frame. */
+        std::vector<NvDsInferObject> *m_FrameObjects = nullptr;
+        /* Reused class map or runs of the frame being parsed, nullptr if they
+         * are allocated for each frame. */
+        std::vector<int> *m_FrameClassMap = nullptr;
+        /* Class map to run-length encode, and runs to copy when allocated. */
+        std::vector<int> m_ClassMap;
+        std::vector<int> m_ClassMapRuns;
+        /* Activated classifier output layers, one per layer. */
+        std::vector<std::vector<float>> m_ClassifierProbabilities;
+        /* Reused attributes and label of the frame being parsed, nullptr if
+         * they are allocated for each frame. */
+        std::vector<NvDsInferAttribute> *m_FrameAttributes = nullptr;
+        std::string *m_FrameLabel = nullptr;
+        /* Attributes and label to copy when allocated. */
+        std::vector<NvDsInferAttribute> m_Attributes;
+        std::string m_AttrString;
+    } NvDsInferParseScratch;
+
     bool parseBoundingBox(
         std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
         NvDsInferNetworkInfo const &networkInfo,
         NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+        std::vector<NvDsInferObjectDetectionInfo> &objectList,
+        NvDsInferGridCandidates &gridCandidates);
     bool parseAttributesFromSoftmaxLayers(
         std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
         NvDsInferNetworkInfo  const &networkInfo,
         float classifierThreshold,
         std::vector<NvDsInferAttribute> &attrList,
         std::string &attrString);
-    void clusterAndFillDetectionOutputCV(NvDsInferDetectionOutput &output);
-    void clusterAndFillDetectionOutputDBSCAN(NvDsInferDetectionOutput &output);
-    NvDsInferStatus fillDetectionOutput(NvDsInferDetectionOutput &output);
-    NvDsInferStatus fillClassificationOutput(NvDsInferClassificationOutput &output);
-    NvDsInferStatus fillSegmentationOutput(NvDsInferSegmentationOutput &output);
+    NvDsInferObject *allocateObjects(NvDsInferParseScratch &scratch,
+            size_t numObjects);
+    char *objectLabel(unsigned int classIndex);
+    void activateClassifierLayers(NvDsInferParseScratch &scratch);
+    void clusterAndFillDetectionOutputCV(NvDsInferParseScratch &scratch,
+            NvDsInferDetectionOutput &output);
+    void clusterAndFillDetectionOutputDBSCAN(NvDsInferParseScratch &scratch,
+            NvDsInferDetectionOutput &output);
+    void clusterAndFillDetectionOutputNative(NvDsInferParseScratch &scratch,
+            NvDsInferDetectionOutput &output);
+    NvDsInferStatus fillDetectionOutput(NvDsInferParseScratch &scratch,
+            NvDsInferDetectionOutput &output);
+    NvDsInferStatus fillClassificationOutput(NvDsInferParseScratch &scratch,
+            NvDsInferClassificationOutput &output);
+    NvDsInferStatus fillSegmentationOutput(NvDsInferParseScratch &scratch,
+            NvDsInferSegmentationOutput &output);
+    void fillFrameOutput(NvDsInferParseScratch &scratch, unsigned int batchIndex,
+            unsigned int frameIndex, NvDsInferFrameOutput &frameOutput);
     void releaseFrameOutput(NvDsInferFrameOutput &frameOutput);
     NvDsInferStatus initNonImageInputLayers();
 
@@ -112,9 +174,7 @@ private:
     /* Network input information. */
     NvDsInferNetworkInfo m_NetworkInfo;
 
-    bool m_UseDBScan;
-
-    NvDsInferDBScanHandle m_DBScanHandle;
+    NvDsInferClusterMode m_ClusterMode;
 
     /* Number of classes detected by the model. */
     unsigned int m_NumDetectedClasses;
@@ -123,19 +183,24 @@ private:
     std::vector<NvDsInferDetectionParams> m_PerClassDetectionParams;
     NvDsInferParseDetectionParams m_DetectionParams;
 
-    /* Vector for all parsed objects. */
-    std::vector<NvDsInferObjectDetectionInfo> m_ObjectList;
-    /* Vector of cv::Rect vectors for each class. */
-    std::vector<std::vector<cv::Rect>> m_PerClassCvRectList;
-    /* Vector of NvDsInferObjectDetectionInfo vectors for each class. */
-    std::vector<std::vector<NvDsInferObjectDetectionInfo>> m_PerClassObjectList;
+    /* Parsing state of each worker, the frames of a batch are spread on
+     * m_ParsePool if there is more than one. */
+    std::vector<NvDsInferParseScratch> m_ParseScratch;
+    std::unique_ptr<NvDsInferParsePool> m_ParsePool;
 
     float m_ClassifierThreshold;
+    NvDsInferClassifierActivation m_ClassifierActivation;
+    unsigned int m_ClassifierTopK;
     float m_SegmentationThreshold;
+    unsigned int m_SegmentationMapScale;
+    bool m_SegmentationMapRLE;
 
     /* Custom library implementation. */
     void *m_CustomLibHandle;
     NvDsInferParseCustomFunc m_CustomBBoxParseFunc;
+    NvDsInferParserCreateFunc m_CustomParserCreateFunc;
+    NvDsInferParserParseFunc m_CustomParserParseFunc;
+    NvDsInferParserDestroyFunc m_CustomParserDestroyFunc;
     NvDsInferClassiferParseCustomFunc m_CustomClassifierParseFunc;
     nvinfer1::IPluginFactory *m_RuntimePluginFactory;
 
@@ -186,22 +251,41 @@ private:
         cudaEvent_t m_CopyCompleteEvent = nullptr;
         bool m_BuffersWithContext = true;
 
+        /* Arrays of the batch output, reused each time the batch is dequeued
+         * unless m_LegacyOutputAllocation is set. */
+        std::vector<NvDsInferFrameOutput> m_FrameOutputs;
+        std::vector<std::vector<NvDsInferObject>> m_FrameObjects;
+        std::vector<std::vector<int>> m_FrameClassMaps;
+        std::vector<std::vector<NvDsInferAttribute>> m_FrameAttributes;
+        std::vector<std::string> m_FrameLabels;
+        std::vector<void *> m_HostBufferPtrs;
+        std::vector<void *> m_OutputDeviceBufferPtrs;
+
         //NvDsInferContextReturnInputAsyncFunc m_ReturnFunc = nullptr;
         //void *m_ReturnFuncData = nullptr;
     } NvDsInferBatch;
 
+    /* Make the GPU of the context current for the calling thread. */
+    virtual NvDsInferStatus setDevice();
+    /* Wait for the output of the batch to be in its host buffers. */
+    virtual NvDsInferStatus waitForOutput(NvDsInferBatch &batch);
+
     std::vector<NvDsInferBatch> m_Batches;
 
     /* Queues and synchronization members for processing multiple batches
-     * in parallel.
+     * in parallel: the batches free for queueInputBatch, pushed back by
+     * releaseBatchOutput from any thread, and the batches queued for
+     * dequeueOutputBatch. Both are guarded by m_QueueMutex.
      */
     std::mutex m_QueueMutex;
-    std::condition_variable m_QueueCondition;
-    std::queue<unsigned int> m_ProcessIndexQueue;
-    std::queue<unsigned int> m_FreeIndexQueue;
+    NvDsInferIndexQueue m_ProcessIndexQueue;
+    NvDsInferIndexQueue m_FreeIndexQueue;
 
     bool m_CopyInputToHostBuffers;
 
+    /* Allocate the outputs of each batch and duplicate the object labels. */
+    bool m_LegacyOutputAllocation;
+
     /* Cuda Event for synchronizing input consumption by TensorRT CUDA engine. */
     cudaEvent_t m_InputConsumedEvent;
     /* Cuda Event for synchronizing completion of pre-processing. */
@@ -216,6 +300,26 @@ private:
     bool m_Initialized;
 };
 
+/**
+ * Context serving the layer tensors recorded by nvinfer in place of the
+ * inference. The model is not loaded and nothing is put on the device.
+ */
+class NvDsInferReplayContextImpl : public NvDsInferContextImpl
+{
+public:
+    NvDsInferReplayContextImpl() = default;
+
+private:
+    NvDsInferStatus initInferenceEngine(
+            NvDsInferContextInitParams &initParams) override;
+    NvDsInferStatus queueInputBatch(
+            NvDsInferContextBatchInput &batchInput) override;
+    NvDsInferStatus setDevice() override;
+    NvDsInferStatus waitForOutput(NvDsInferBatch &batch) override;
+
+    NvDsInferTensorReplay m_Replay;
+};
+
 /* Calls clients logging callback function. */
 static inline void
 callLogFunc(NvDsInferContextImpl *ctx, unsigned int uniqueID, NvDsInferLogLevel level,
@@ -30,7 +30,8 @@ NvDsInferContextImpl::parseBoundingBox(
     vector < NvDsInferLayerInfo > const &outputLayersInfo,
     NvDsInferNetworkInfo const &networkInfo,
     NvDsInferParseDetectionParams const &detectionParams,
-    vector < NvDsInferObjectDetectionInfo > &objectList)
+    vector < NvDsInferObjectDetectionInfo > &objectList,
+    NvDsInferGridCandidates &gridCandidates)
 {
 
     int outputCoverageLayerIndex = -1;
@@ -106,85 +107,114 @@ NvDsInferContextImpl::parseBoundingBox(
         float *outputX2 = outputY1 + gridSize;
         float *outputY2 = outputX2 + gridSize;
 
-        /* Iterate through each point in the grid and check if the rectangle at that
-         * point meets the minimum threshold criteria. */
-        for (unsigned int h = 0; h < outputCoverageDims.h; h++)
+        /* Find the points in the grid meeting the minimum threshold
+         * criteria and parse the rectangles at these points. */
+        unsigned int numCandidates = NvDsInferGridThreshold(
+                outputCoverageBuffer + classIndex * gridSize, gridSize,
+                detectionParams.perClassThreshold[classIndex],
+                gridCandidates);
+
+        objectList.reserve(objectList.size() + numCandidates);
+        for (unsigned int j = 0; j < numCandidates; j++)
         {
-            for (unsigned int w = 0; w < outputCoverageDims.w; w++)
-            {
-                int i = w + h * outputCoverageDims.w;
-                float confidence = outputCoverageBuffer[classIndex * gridSize + i];
-
-                if (confidence < detectionParams.perClassThreshold[classIndex])
-                    continue;
-
-                int rectX1, rectY1, rectX2, rectY2;
-                float rectX1Float, rectY1Float, rectX2Float, rectY2Float;
-
-                /* Centering and normalization of the rectangle. */
-                rectX1Float =
-                    outputX1[w + h * outputCoverageDims.w] - gcCenters0[w];
-                rectY1Float =
-                    outputY1[w + h * outputCoverageDims.w] - gcCenters1[h];
-                rectX2Float =
-                    outputX2[w + h * outputCoverageDims.w] + gcCenters0[w];
-                rectY2Float =
-                    outputY2[w + h * outputCoverageDims.w] + gcCenters1[h];
-
-                rectX1Float *= -bboxNorm[0];
-                rectY1Float *= -bboxNorm[1];
-                rectX2Float *= bboxNorm[0];
-                rectY2Float *= bboxNorm[1];
-
-                rectX1 = rectX1Float;
-                rectY1 = rectY1Float;
-                rectX2 = rectX2Float;
-                rectY2 = rectY2Float;
-
-                /* Clip parsed rectangles to frame bounds. */
-                if (rectX1 >= (int)m_NetworkInfo.width)
-                    rectX1 = m_NetworkInfo.width - 1;
-                if (rectX2 >= (int)m_NetworkInfo.width)
-                    rectX2 = m_NetworkInfo.width - 1;
-                if (rectY1 >= (int)m_NetworkInfo.height)
-                    rectY1 = m_NetworkInfo.height - 1;
-                if (rectY2 >= (int)m_NetworkInfo.height)
-                    rectY2 = m_NetworkInfo.height - 1;
-
-                if (rectX1 < 0)
-                    rectX1 = 0;
-                if (rectX2 < 0)
-                    rectX2 = 0;
-                if (rectY1 < 0)
-                    rectY1 = 0;
-                if (rectY2 < 0)
-                    rectY2 = 0;
-
-                objectList.push_back({ classIndex, (unsigned int) rectX1,
-                        (unsigned int) rectY1, (unsigned int) (rectX2 - rectX1),
-                        (unsigned int) (rectY2 - rectY1), confidence});
-            }
+            int i = gridCandidates.cells[j];
+            unsigned int h = i / outputCoverageDims.w;
+            unsigned int w = i - h * outputCoverageDims.w;
+            float confidence = gridCandidates.confidence[j];
+
+            int rectX1, rectY1, rectX2, rectY2;
+            float rectX1Float, rectY1Float, rectX2Float, rectY2Float;
+
+            /* Centering and normalization of the rectangle. */
+            rectX1Float = outputX1[i] - gcCenters0[w];
+            rectY1Float = outputY1[i] - gcCenters1[h];
+            rectX2Float = outputX2[i] + gcCenters0[w];
+            rectY2Float = outputY2[i] + gcCenters1[h];
+
+            rectX1Float *= -bboxNorm[0];
+            rectY1Float *= -bboxNorm[1];
+            rectX2Float *= bboxNorm[0];
+            rectY2Float *= bboxNorm[1];
+
+            rectX1 = rectX1Float;
+            rectY1 = rectY1Float;
+            rectX2 = rectX2Float;
+            rectY2 = rectY2Float;
+
+            /* Clip parsed rectangles to frame bounds. */
+            if (rectX1 >= (int)m_NetworkInfo.width)
+                rectX1 = m_NetworkInfo.width - 1;
+            if (rectX2 >= (int)m_NetworkInfo.width)
+                rectX2 = m_NetworkInfo.width - 1;
+            if (rectY1 >= (int)m_NetworkInfo.height)
+                rectY1 = m_NetworkInfo.height - 1;
+            if (rectY2 >= (int)m_NetworkInfo.height)
+                rectY2 = m_NetworkInfo.height - 1;
+
+            if (rectX1 < 0)
+                rectX1 = 0;
+            if (rectX2 < 0)
+                rectX2 = 0;
+            if (rectY1 < 0)
+                rectY1 = 0;
+            if (rectY2 < 0)
+                rectY2 = 0;
+
+            objectList.push_back({ classIndex, (unsigned int) rectX1,
+                    (unsigned int) rectY1, (unsigned int) (rectX2 - rectX1),
+                    (unsigned int) (rectY2 - rectY1), confidence});
         }
     }
     return true;
 }
 
+/**
+ * Array for the objects of a frame output: the reused array of the frame in
+ * the batch, or a new one released by releaseFrameOutput.
+ */
+NvDsInferObject *
+NvDsInferContextImpl::allocateObjects(NvDsInferParseScratch &scratch,
+        size_t numObjects)
+{
+    if (!scratch.m_FrameObjects)
+        return new NvDsInferObject[numObjects];
+
+    scratch.m_FrameObjects->resize(numObjects);
+    return scratch.m_FrameObjects->data();
+}
+
+/**
+ * Label of the objects of a class: the string of m_Labels itself, or a copy
+ * freed by releaseFrameOutput.
+ */
+char *
+NvDsInferContextImpl::objectLabel(unsigned int classIndex)
+{
+    if (classIndex >= m_Labels.size() || m_Labels[classIndex].empty())
+        return nullptr;
+    if (m_LegacyOutputAllocation)
+        return strdup(m_Labels[classIndex][0].c_str());
+    return (char *) m_Labels[classIndex][0].c_str();
+}
+
 /**
  * Cluster objects using OpenCV groupRectangles and fill the output structure.
  */
 void
-NvDsInferContextImpl::clusterAndFillDetectionOutputCV(NvDsInferDetectionOutput &output)
+NvDsInferContextImpl::clusterAndFillDetectionOutputCV(NvDsInferParseScratch &scratch,
+        NvDsInferDetectionOutput &output)
 {
     size_t totalObjects = 0;
+    vector<vector<cv::Rect>> &perClassCvRectList = scratch.m_PerClassCvRectList;
 
-    for (auto & list:m_PerClassCvRectList)
+    for (auto & list:perClassCvRectList)
         list.clear();
 
     /* The above functions will add all objects in the m_ObjectList vector.
      * Need to seperate them per class for grouping. */
-    for (auto & object:m_ObjectList)
+    for (auto & object:scratch.m_ObjectList)
     {
-        m_PerClassCvRectList[object.classId].emplace_back(object.left,
+        perClassCvRectList[object.classId].emplace_back(object.left,
                 object.top, object.width, object.height);
     }
 
@@ -195,20 +225,20 @@ NvDsInferContextImpl::clusterAndFillDetectionOutputCV(NvDsInferDetectionOutput &
          * to opencv documentation of groupRectangles for more
          * information about the tuning parameters for grouping. */
         if (m_PerClassDetectionParams[c].groupThreshold > 0)
-            cv::groupRectangles(m_PerClassCvRectList[c],
+            cv::groupRectangles(perClassCvRectList[c],
                     m_PerClassDetectionParams[c].groupThreshold,
                     m_PerClassDetectionParams[c].eps);
-        totalObjects += m_PerClassCvRectList[c].size();
+        totalObjects += perClassCvRectList[c].size();
     }
 
-    output.objects = new NvDsInferObject[totalObjects];
+    output.objects = allocateObjects(scratch, totalObjects);
     output.numObjects = 0;
 
     for (unsigned int c = 0; c < m_NumDetectedClasses; c++)
     {
         /* Add coordinates and class ID and the label of all objects
          * detected in the frame to the frame output. */
-        for (auto & rect:m_PerClassCvRectList[c])
+        for (auto & rect:perClassCvRectList[c])
         {
             NvDsInferObject &object = output.objects[output.numObjects];
             object.left = rect.x;
@@ -216,9 +246,8 @@ NvDsInferContextImpl::clusterAndFillDetectionOutputCV(NvDsInferDetectionOutput &
             object.width = rect.width;
             object.height = rect.height;
             object.classIndex = c;
-            object.label = nullptr;
-            if (c < m_Labels.size() && m_Labels[c].size() > 0)
-                object.label = strdup(m_Labels[c][0].c_str());
+            object.confidence = 0;
+            object.label = objectLabel(c);
             output.numObjects++;
         }
     }
@@ -228,28 +257,31 @@ NvDsInferContextImpl::clusterAndFillDetectionOutputCV(NvDsInferDetectionOutput &
  * Cluster objects using DBSCAN and fill the output structure.
  */
 void
-NvDsInferContextImpl::clusterAndFillDetectionOutputDBSCAN(NvDsInferDetectionOutput &output)
+NvDsInferContextImpl::clusterAndFillDetectionOutputDBSCAN(NvDsInferParseScratch &scratch,
+        NvDsInferDetectionOutput &output)
 {
     size_t totalObjects = 0;
+    vector<vector<NvDsInferObjectDetectionInfo>> &perClassObjectList =
+        scratch.m_PerClassObjectList;
     NvDsInferDBScanClusteringParams clusteringParams;
     clusteringParams.enableATHRFilter = ATHR_ENABLED;
     clusteringParams.thresholdATHR = ATHR_THRESHOLD;
     vector<size_t> numObjectsList(m_NumDetectedClasses);
 
-    for (auto & list:m_PerClassObjectList)
+    for (auto & list:perClassObjectList)
         list.clear();
 
     /* The above functions will add all objects in the m_ObjectList vector.
      * Need to seperate them per class for grouping. */
-    for (auto & object:m_ObjectList)
+    for (auto & object:scratch.m_ObjectList)
     {
-        m_PerClassObjectList[object.classId].emplace_back(object);
+        perClassObjectList[object.classId].emplace_back(object);
     }
 
     for (unsigned int c = 0; c < m_NumDetectedClasses; c++)
     {
-        NvDsInferObjectDetectionInfo *objArray = m_PerClassObjectList[c].data();
-        size_t numObjects = m_PerClassObjectList[c].size();
+        NvDsInferObjectDetectionInfo *objArray = perClassObjectList[c].data();
+        size_t numObjects = perClassObjectList[c].size();
 
         clusteringParams.eps = m_PerClassDetectionParams[c].eps;
         clusteringParams.minBoxes = m_PerClassDetectionParams[c].minBoxes;
@@ -258,13 +290,13 @@ NvDsInferContextImpl::clusterAndFillDetectionOutputDBSCAN(NvDsInferDetectionOutp
          * since these rectangles might represent the same object using
          * DBSCAN. */
         if (m_PerClassDetectionParams[c].minBoxes > 0)
-            NvDsInferDBScanCluster(m_DBScanHandle, &clusteringParams,
+            NvDsInferDBScanCluster(scratch.m_DBScanHandle, &clusteringParams,
                     objArray, &numObjects);
         totalObjects += numObjects;
         numObjectsList[c] = numObjects;
     }
 
-    output.objects = new NvDsInferObject[totalObjects];
+    output.objects = allocateObjects(scratch, totalObjects);
     output.numObjects = 0;
 
     for (unsigned int c = 0; c < m_NumDetectedClasses; c++)
@@ -274,14 +306,67 @@ NvDsInferContextImpl::clusterAndFillDetectionOutputDBSCAN(NvDsInferDetectionOutp
         for (size_t i = 0; i < numObjectsList[c]; i++)
         {
             NvDsInferObject &object = output.objects[output.numObjects];
-            object.left = m_PerClassObjectList[c][i].left;
-            object.top = m_PerClassObjectList[c][i].top;
-            object.width = m_PerClassObjectList[c][i].width;
-            object.height = m_PerClassObjectList[c][i].height;
+            object.left = perClassObjectList[c][i].left;
+            object.top = perClassObjectList[c][i].top;
+            object.width = perClassObjectList[c][i].width;
+            object.height = perClassObjectList[c][i].height;
+            object.classIndex = c;
+            object.confidence = perClassObjectList[c][i].detectionConfidence;
+            object.label = objectLabel(c);
+            output.numObjects++;
+        }
+    }
+}
+
+/**
+ * Cluster objects with the built-in equivalent of groupRectangles and fill
+ * the output structure.
+ */
+void
+NvDsInferContextImpl::clusterAndFillDetectionOutputNative(NvDsInferParseScratch &scratch,
+        NvDsInferDetectionOutput &output)
+{
+    size_t totalObjects = 0;
+    vector<vector<NvDsInferObjectDetectionInfo>> &perClassObjectList =
+        scratch.m_PerClassObjectList;
+
+    for (auto & list:perClassObjectList)
+        list.clear();
+
+    /* The above functions will add all objects in the m_ObjectList vector.
+     * Need to seperate them per class for grouping. */
+    for (auto & object:scratch.m_ObjectList)
+    {
+        perClassObjectList[object.classId].emplace_back(object);
+    }
+
+    for (unsigned int c = 0; c < m_NumDetectedClasses; c++)
+    {
+        /* Cluster together rectangles with similar locations and sizes, with
+         * the tuning parameters of groupRectangles. */
+        NvDsInferGroupRectangles(perClassObjectList[c],
+                m_PerClassDetectionParams[c].groupThreshold,
+                m_PerClassDetectionParams[c].eps);
+        totalObjects += perClassObjectList[c].size();
+    }
+
+    output.objects = allocateObjects(scratch, totalObjects);
+    output.numObjects = 0;
+
+    for (unsigned int c = 0; c < m_NumDetectedClasses; c++)
+    {
+        /* Add coordinates and class ID and the label of all objects
+         * detected in the frame to the frame output. */
+        for (auto & clustered:perClassObjectList[c])
+        {
+            NvDsInferObject &object = output.objects[output.numObjects];
+            object.left = clustered.left;
+            object.top = clustered.top;
+            object.width = clustered.width;
+            object.height = clustered.height;
             object.classIndex = c;
-            object.label = nullptr;
-            if (c < m_Labels.size() && m_Labels[c].size() > 0)
-                object.label = strdup(m_Labels[c][0].c_str());
+            object.confidence = clustered.detectionConfidence;
+            object.label = objectLabel(c);
             output.numObjects++;
         }
     }
@@ -296,52 +381,36 @@ NvDsInferContextImpl::parseAttributesFromSoftmaxLayers(
         std::string &attrString)
 {
     /* Get the number of attributes supported by the classifier. */
-    unsigned int numAttributes = m_OutputLayerInfo.size();
+    unsigned int numAttributes = outputLayersInfo.size();
 
     /* Iterate through all the output coverage layers of the classifier.
     */
     for (unsigned int l = 0; l < numAttributes; l++)
     {
-        /* outputCoverageBuffer for classifiers is usually a softmax layer.
+        /* outputCoverageBuffer for classifiers is usually a softmax layer,
+         * or the layer activated by activateClassifierLayers.
          * The layer is an array of probabilities of the object belonging
-         * to each class with each probability being in the range [0,1] and
-         * sum all probabilities will be 1.
+         * to each class with each probability being in the range [0,1].
          */
         NvDsInferDimsCHW dims;
 
-        getDimsCHWFromDims(dims, m_OutputLayerInfo[l].dims);
+        getDimsCHWFromDims(dims, outputLayersInfo[l].dims);
         unsigned int numClasses = dims.c;
         float *outputCoverageBuffer =
-            (float *)m_OutputLayerInfo[l].buffer;
-        float maxProbability = 0;
-        bool attrFound = false;
-        NvDsInferAttribute attr;
-
-        /* Iterate through all the probabilities that the object belongs to
-         * each class. Find the maximum probability and the corresponding class
-         * which meets the minimum threshold. */
-        for (unsigned int c = 0; c < numClasses; c++)
-        {
-            float probability = outputCoverageBuffer[c];
-            if (probability > m_ClassifierThreshold
-                    && probability > maxProbability)
-            {
-                maxProbability = probability;
-                attrFound = true;
-                attr.attributeIndex = l;
-                attr.attributeValue = c;
-                attr.attributeConfidence = probability;
-            }
-        }
-        if (attrFound)
+            (float *)outputLayersInfo[l].buffer;
+
+        /* Find the classes of highest probability which meet the minimum
+         * threshold, the maximum one only unless m_ClassifierTopK is set. */
+        size_t first = attrList.size();
+        NvDsInferClassifierTopK(outputCoverageBuffer, numClasses,
+                m_ClassifierTopK, classifierThreshold, l, attrList);
+        for (size_t i = first; i < attrList.size(); i++)
         {
+            NvDsInferAttribute &attr = attrList[i];
             if (m_Labels.size() > attr.attributeIndex &&
                     attr.attributeValue < m_Labels[attr.attributeIndex].size())
                 attr.attributeLabel =
                     m_Labels[attr.attributeIndex][attr.attributeValue].c_str();
-            else
-                attr.attributeLabel = nullptr;
-            attrList.push_back(attr);
             if (attr.attributeLabel)
                 attrString.append(attr.attributeLabel).append(" ");
         }
@@ -351,17 +420,27 @@ NvDsInferContextImpl::parseAttributesFromSoftmaxLayers(
 }
 
 NvDsInferStatus
-NvDsInferContextImpl::fillDetectionOutput(NvDsInferDetectionOutput &output)
+NvDsInferContextImpl::fillDetectionOutput(NvDsInferParseScratch &scratch,
+        NvDsInferDetectionOutput &output)
 {
     /* Clear the object lists. */
-    m_ObjectList.clear();
+    scratch.m_ObjectList.clear();
 
-    /* Call custom parsing function if specified otherwise use the one
-     * written along with this implementation. */
-    if (m_CustomBBoxParseFunc)
+    /* Call custom parser instance or parsing function if specified otherwise
+     * use the one written along with this implementation. */
+    if (scratch.m_CustomParser)
+    {
+        if (!m_CustomParserParseFunc(scratch.m_CustomParser,
+                    scratch.m_OutputLayerInfo, scratch.m_ObjectList))
+        {
+            printError("Failed to parse bboxes using custom parser");
+            return NVDSINFER_CUSTOM_LIB_FAILED;
+        }
+    }
+    else if (m_CustomBBoxParseFunc)
     {
-        if (!m_CustomBBoxParseFunc(m_OutputLayerInfo, m_NetworkInfo,
-                    m_DetectionParams, m_ObjectList))
+        if (!m_CustomBBoxParseFunc(scratch.m_OutputLayerInfo, m_NetworkInfo,
+                    m_DetectionParams, scratch.m_ObjectList))
         {
             printError("Failed to parse bboxes using custom parse function");
             return NVDSINFER_CUSTOM_LIB_FAILED;
@@ -369,33 +448,72 @@ NvDsInferContextImpl::fillDetectionOutput(NvDsInferDetectionOutput &output)
     }
     else
     {
-        if (!parseBoundingBox(m_OutputLayerInfo, m_NetworkInfo,
-                    m_DetectionParams, m_ObjectList))
+        if (!parseBoundingBox(scratch.m_OutputLayerInfo, m_NetworkInfo,
+                    m_DetectionParams, scratch.m_ObjectList,
+                    scratch.m_GridCandidates))
         {
             printError("Failed to parse bboxes");
             return NVDSINFER_OUTPUT_PARSING_FAILED;
         }
     }
 
-    if (m_UseDBScan)
-        clusterAndFillDetectionOutputDBSCAN(output);
-    else
-        clusterAndFillDetectionOutputCV(output);
+    switch (m_ClusterMode)
+    {
+        case NvDsInferClusterMode_DBSCAN:
+            clusterAndFillDetectionOutputDBSCAN(scratch, output);
+            break;
+        case NvDsInferClusterMode_Native:
+            clusterAndFillDetectionOutputNative(scratch, output);
+            break;
+        default:
+            clusterAndFillDetectionOutputCV(scratch, output);
+            break;
+    }
 
     return NVDSINFER_SUCCESS;
 }
 
+/**
+ * Apply m_ClassifierActivation to the output layers of the frame, pointing the
+ * layers passed to the parsing functions to the activated copies.
+ */
+void
+NvDsInferContextImpl::activateClassifierLayers(NvDsInferParseScratch &scratch)
+{
+    for (unsigned int l = 0; l < scratch.m_OutputLayerInfo.size(); l++)
+    {
+        NvDsInferLayerInfo &info = scratch.m_OutputLayerInfo[l];
+        vector<float> &probabilities = scratch.m_ClassifierProbabilities[l];
+
+        NvDsInferClassifierActivate((const float *) info.buffer,
+                info.dims.numElements, m_ClassifierActivation,
+                probabilities.data());
+        info.buffer = probabilities.data();
+    }
+}
+
 NvDsInferStatus
-NvDsInferContextImpl::fillClassificationOutput(NvDsInferClassificationOutput &output)
+NvDsInferContextImpl::fillClassificationOutput(NvDsInferParseScratch &scratch,
+        NvDsInferClassificationOutput &output)
 {
-    string attrString;
-    vector<NvDsInferAttribute> attributes;
+    /* Attributes and label of the frame in the batch when reused, kept by the
+     * scratch state otherwise. Either way their capacity is kept. */
+    vector<NvDsInferAttribute> &attributes = scratch.m_FrameAttributes ?
+        *scratch.m_FrameAttributes : scratch.m_Attributes;
+    string &attrString = scratch.m_FrameLabel ? *scratch.m_FrameLabel :
+        scratch.m_AttrString;
+
+    attributes.clear();
+    attrString.clear();
+
+    if (m_ClassifierActivation != NvDsInferClassifierActivation_None)
+        activateClassifierLayers(scratch);
 
     /* Call custom parsing function if specified otherwise use the one
      * written along with this implementation. */
     if (m_CustomClassifierParseFunc)
     {
-        if (!m_CustomClassifierParseFunc(m_OutputLayerInfo, m_NetworkInfo,
+        if (!m_CustomClassifierParseFunc(scratch.m_OutputLayerInfo, m_NetworkInfo,
                     m_ClassifierThreshold, attributes, attrString))
         {
             printError("Failed to parse classification attributes using "
@@ -405,7 +523,7 @@ NvDsInferContextImpl::fillClassificationOutput(NvDsInferClassificationOutput &ou
     }
     else
     {
-        if (!parseAttributesFromSoftmaxLayers(m_OutputLayerInfo, m_NetworkInfo,
+        if (!parseAttributesFromSoftmaxLayers(scratch.m_OutputLayerInfo, m_NetworkInfo,
                     m_ClassifierThreshold, attributes, attrString))
         {
             printError("Failed to parse bboxes");
@@ -414,8 +532,15 @@ NvDsInferContextImpl::fillClassificationOutput(NvDsInferClassificationOutput &ou
     }
 
     /* Fill the output structure with the parsed attributes. */
-    output.label = strdup(attrString.c_str());
     output.numAttributes = attributes.size();
+    if (scratch.m_FrameAttributes)
+    {
+        output.label = &attrString[0];
+        output.attributes = attributes.data();
+        return NVDSINFER_SUCCESS;
+    }
+
+    output.label = strdup(attrString.c_str());
     output.attributes = new NvDsInferAttribute[output.numAttributes];
     for (size_t i = 0; i < output.numAttributes; i++)
     {
@@ -428,34 +553,60 @@ NvDsInferContextImpl::fillClassificationOutput(NvDsInferClassificationOutput &ou
 }
 
 NvDsInferStatus
-NvDsInferContextImpl::fillSegmentationOutput(NvDsInferSegmentationOutput &output)
+NvDsInferContextImpl::fillSegmentationOutput(NvDsInferParseScratch &scratch,
+        NvDsInferSegmentationOutput &output)
 {
     NvDsInferDimsCHW outputDimsCHW;
-    getDimsCHWFromDims(outputDimsCHW, m_OutputLayerInfo[0].dims);
+    getDimsCHWFromDims(outputDimsCHW, scratch.m_OutputLayerInfo[0].dims);
 
-    output.width = outputDimsCHW.w;
-    output.height = outputDimsCHW.h;
+    output.width = NvDsInferSegmentationMapDim(outputDimsCHW.w, m_SegmentationMapScale);
+    output.height = NvDsInferSegmentationMapDim(outputDimsCHW.h, m_SegmentationMapScale);
     output.classes = outputDimsCHW.c;
+    output.map_scale = m_SegmentationMapScale;
+    output.num_runs = 0;
+    output.class_map_runs = nullptr;
 
-    output.class_map = new int [output.width * output.height];
-    output.class_probability_map = (float *) m_OutputLayerInfo[0].buffer;
+    output.class_probability_map = (float *) scratch.m_OutputLayerInfo[0].buffer;
+    size_t mapSize = (size_t) output.width * output.height;
 
-    for (unsigned int y = 0; y < output.height; y++)
+    /* The class of a pixel is the one of highest probability above the
+     * threshold, -1 if there is none. */
+    if (!m_SegmentationMapRLE)
     {
-        for (unsigned int x = 0; x < output.width; x++)
+        if (scratch.m_FrameClassMap)
         {
-            float max_prob = -1;
-            int &cls = output.class_map[y * output.width + x] = -1;
-            for (unsigned int c = 0; c < output.classes; c++)
-            {
-                float prob = output.class_probability_map[c * output.width * output.height + y * output.width + x];
-                if (prob > max_prob && prob > m_SegmentationThreshold)
-                {
-                    cls = c;
-                    max_prob = prob;
-                }
-            }
+            scratch.m_FrameClassMap->resize(mapSize);
+            output.class_map = scratch.m_FrameClassMap->data();
         }
+        else
+        {
+            output.class_map = new int [mapSize];
+        }
+        NvDsInferSegmentationArgmax(output.class_probability_map,
+                outputDimsCHW.w, outputDimsCHW.h, output.classes,
+                m_SegmentationThreshold, m_SegmentationMapScale, output.class_map);
+        return NVDSINFER_SUCCESS;
+    }
+
+    output.class_map = nullptr;
+    scratch.m_ClassMap.resize(mapSize);
+    NvDsInferSegmentationArgmax(output.class_probability_map,
+            outputDimsCHW.w, outputDimsCHW.h, output.classes,
+            m_SegmentationThreshold, m_SegmentationMapScale,
+            scratch.m_ClassMap.data());
+
+    vector<int> &runs = scratch.m_FrameClassMap ? *scratch.m_FrameClassMap :
+        scratch.m_ClassMapRuns;
+    output.num_runs = NvDsInferSegmentationEncodeRuns(scratch.m_ClassMap.data(),
+            mapSize, runs);
+    if (scratch.m_FrameClassMap)
+    {
+        output.class_map_runs = runs.data();
+    }
+    else
+    {
+        output.class_map_runs = new int [runs.size()];
+        copy(runs.begin(), runs.end(), output.class_map_runs);
     }
     return NVDSINFER_SUCCESS;
 }
@@ -466,6 +617,9 @@ NvDsInferContextImpl::releaseFrameOutput(NvDsInferFrameOutput &frameOutput)
     switch (m_NetworkType)
     {
         case NvDsInferNetworkType_Detector:
+            /* Objects and labels are reused otherwise. */
+            if (!m_LegacyOutputAllocation)
+                break;
             for (unsigned int j = 0; j < frameOutput.detectionOutput.numObjects; j++)
             {
                 free(frameOutput.detectionOutput.objects[j].label);
@@ -473,11 +627,18 @@ NvDsInferContextImpl::releaseFrameOutput(NvDsInferFrameOutput &frameOutput)
             delete[] frameOutput.detectionOutput.objects;
             break;
         case NvDsInferNetworkType_Classifier:
+            /* Attributes and labels are reused otherwise. */
+            if (!m_LegacyOutputAllocation)
+                break;
             free(frameOutput.classificationOutput.label);
             delete[] frameOutput.classificationOutput.attributes;
             break;
         case NvDsInferNetworkType_Segmentation:
+            /* Class maps are reused otherwise. */
+            if (!m_LegacyOutputAllocation)
+                break;
             delete[] frameOutput.segmentationOutput.class_map;
+            delete[] frameOutput.segmentationOutput.class_map_runs;
             break;
         default:
             break;
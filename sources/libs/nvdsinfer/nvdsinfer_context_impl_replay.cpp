@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "nvdsinfer_context_impl.h"
+
+using namespace std;
+
+/* Load the recorded tensors to replay in place of the inference and fill the
+ * layers information from them. Only host buffers are used. */
+NvDsInferStatus
+NvDsInferReplayContextImpl::initInferenceEngine(
+        NvDsInferContextInitParams &initParams)
+{
+    vector<string> layerSpecs(initParams.replayLayers,
+            initParams.replayLayers + initParams.numReplayLayers);
+    string error;
+
+    if (!m_Replay.open(initParams.replayTensorDir, m_UniqueID, layerSpecs,
+                error))
+    {
+        printError("Failed to load the tensors to replay: %s", error.c_str());
+        return NVDSINFER_CONFIG_FAILED;
+    }
+    m_Replay.setBatchRate(initParams.replayBatchRate);
+
+    m_AllLayerInfo = m_Replay.layers();
+    for (auto const & layerInfo:m_AllLayerInfo)
+    {
+        if (!layerInfo.isInput)
+            m_OutputLayerInfo.push_back(layerInfo);
+    }
+
+    NvDsInferDimsCHW inputDims;
+    getDimsCHWFromDims(inputDims, m_AllLayerInfo[INPUT_LAYER_INDEX].dims);
+    m_NetworkInfo.width = inputDims.w;
+    m_NetworkInfo.height = inputDims.h;
+    m_NetworkInfo.channels = inputDims.c;
+
+    for (unsigned int i = 0; i < m_Batches.size(); i++)
+    {
+        NvDsInferBatch & batch = m_Batches[i];
+        batch.m_HostBuffers.resize(m_AllLayerInfo.size());
+        batch.m_DeviceBuffers.assign(m_AllLayerInfo.size(), nullptr);
+
+        for (unsigned int j = 0; j < m_AllLayerInfo.size(); j++)
+        {
+            if (m_AllLayerInfo[j].isInput && !m_CopyInputToHostBuffers)
+                continue;
+            batch.m_HostBuffers[j].resize(m_MaxBatchSize *
+                    m_AllLayerInfo[j].dims.numElements *
+                    getElementSize(m_AllLayerInfo[j].dataType));
+        }
+        m_FreeIndexQueue.push(i);
+    }
+
+    printInfo("Replaying %u recorded batches (%u frames) from %s",
+            m_Replay.numBatches(), m_Replay.numFrames(),
+            initParams.replayTensorDir);
+    return NVDSINFER_SUCCESS;
+}
+
+/* Serve the next recorded frames as the output of a batch. The input frames
+ * are not used and are returned right away. */
+NvDsInferStatus
+NvDsInferReplayContextImpl::queueInputBatch(
+        NvDsInferContextBatchInput &batchInput)
+{
+    unsigned int batchIndex;
+
+    /* Check that current batch size does not exceed max batch size. */
+    if (batchInput.numInputFrames > m_MaxBatchSize)
+    {
+        printError("Not inferring on batch since it's size(%d) exceeds max batch"
+                " size(%d)", batchInput.numInputFrames, m_MaxBatchSize);
+        return NVDSINFER_INVALID_PARAMS;
+    }
+
+    m_Replay.pace();
+
+    {
+        unique_lock<mutex> lock(m_QueueMutex);
+        batchIndex = m_FreeIndexQueue.pop(lock);
+    }
+
+    NvDsInferBatch &batch = m_Batches[batchIndex];
+    batch.m_BatchSize = batchInput.numInputFrames;
+    m_Replay.readFrames(batch.m_BatchSize, batch.m_HostBuffers);
+
+    if (batchInput.returnInputFunc)
+        batchInput.returnInputFunc(batchInput.returnFuncData);
+
+    {
+        unique_lock<mutex> lock(m_QueueMutex);
+        m_ProcessIndexQueue.push(batchIndex);
+    }
+    return NVDSINFER_SUCCESS;
+}
+
+/* Nothing is on the device, the recorded output is in the host buffers as
+ * soon as the batch is queued. */
+NvDsInferStatus
+NvDsInferReplayContextImpl::setDevice()
+{
+    return NVDSINFER_SUCCESS;
+}
+
+NvDsInferStatus
+NvDsInferReplayContextImpl::waitForOutput(NvDsInferBatch &batch)
+{
+    return NVDSINFER_SUCCESS;
+}
@@ -0,0 +1,298 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * DBSCAN clustering of the objects of one class, implementing
+ * nvdsinfer_dbscan.h.
+ *
+ * Two objects are neighbors if their edges differ by at most
+ * eps * (min widths + min heights) / 2, the similarity of groupRectangles, so
+ * that the per class eps means the same for all the clustering modes. An
+ * object with at least minBoxes neighbors, itself included, is a core object.
+ * Clusters are the connected components of the core objects, each border
+ * object (not core but neighbor of a core object) joining the cluster of its
+ * first core neighbor. Other objects are noise and dropped. An output object
+ * is the rounded average of a cluster with the highest confidence of its
+ * objects.
+ *
+ * The neighbors of an object are within its reach eps * (width + height) / 2
+ * on x and y: they are found with a range query in a 2-d tree of the top left
+ * corners, O(log n + k) instead of comparing every pair of objects.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "nvdsinfer_dbscan.h"
+
+using namespace std;
+
+/* Object rectangle, in tree order. */
+typedef struct
+{
+    float left, top, right, bottom;
+    float reach;
+    unsigned int index;
+} DBScanRect;
+
+/* Sums of the rectangles of a cluster. */
+typedef struct
+{
+    uint64_t left, top, width, height;
+    unsigned int count;
+    unsigned int classId;
+    float confidence;
+} DBScanCluster;
+
+/* Clustering context: buffers reused by the calls. */
+struct NvDsInferDBScan
+{
+    vector<DBScanRect> tree;
+    vector<unsigned int> position;
+    vector<unsigned int> neighbors;
+    vector<bool> core;
+    vector<int> parent;
+    vector<int> owner;
+    vector<int> label;
+    vector<DBScanCluster> clusters;
+};
+
+static inline bool
+neighborRects(DBScanRect const &r1, DBScanRect const &r2, float eps)
+{
+    float delta = eps * (min(r1.right - r1.left, r2.right - r2.left) +
+            min(r1.bottom - r1.top, r2.bottom - r2.top)) * 0.5f;
+    return fabsf(r1.left - r2.left) <= delta &&
+        fabsf(r1.top - r2.top) <= delta &&
+        fabsf(r1.right - r2.right) <= delta &&
+        fabsf(r1.bottom - r2.bottom) <= delta;
+}
+
+/* Balanced 2-d tree in place: the median of a range on x (even depth) or y
+ * (odd depth) is at its middle, the smaller ones before it. */
+static void
+buildTree(DBScanRect *rects, unsigned int begin, unsigned int end,
+        unsigned int depth)
+{
+    while (end - begin > 1)
+    {
+        unsigned int mid = begin + (end - begin) / 2;
+        bool onX = !(depth & 1);
+
+        nth_element(rects + begin, rects + mid, rects + end,
+                [onX](DBScanRect const &a, DBScanRect const &b) {
+                    return onX ? a.left < b.left : a.top < b.top;
+                });
+        buildTree(rects, begin, mid, depth + 1);
+        begin = mid + 1;
+        depth++;
+    }
+}
+
+/* Appends to @neighbors the positions in the tree of the neighbors of the
+ * rectangle at @p. */
+static void
+queryNeighbors(vector<DBScanRect> const &tree, unsigned int p, float eps,
+        vector<unsigned int> &neighbors)
+{
+    typedef struct { unsigned int begin, end, depth; } Range;
+    /* Depth of the tree is at most 32 for 32-bit sizes, one pending range
+     * per level. */
+    Range stack[64];
+    unsigned int top = 0;
+    DBScanRect const &r = tree[p];
+    /* One more pixel, for the rounding of the bounds. */
+    float minX = r.left - r.reach - 1, maxX = r.left + r.reach + 1;
+    float minY = r.top - r.reach - 1, maxY = r.top + r.reach + 1;
+
+    neighbors.clear();
+    stack[top++] = { 0, (unsigned int) tree.size(), 0 };
+    while (top)
+    {
+        Range range = stack[--top];
+        while (range.begin < range.end)
+        {
+            unsigned int mid = range.begin + (range.end - range.begin) / 2;
+            DBScanRect const &m = tree[mid];
+            float key = (range.depth & 1) ? m.top : m.left;
+            float lo = (range.depth & 1) ? minY : minX;
+            float hi = (range.depth & 1) ? maxY : maxX;
+
+            if (neighborRects(r, m, eps))
+                neighbors.push_back(mid);
+
+            bool goLeft = lo <= key;
+            bool goRight = hi >= key;
+            if (goLeft && goRight)
+                stack[top++] = { mid + 1, range.end, range.depth + 1 };
+            if (goLeft)
+                range = { range.begin, mid, range.depth + 1 };
+            else if (goRight)
+                range = { mid + 1, range.end, range.depth + 1 };
+            else
+                break;
+        }
+    }
+}
+
+static inline int
+findRoot(vector<int> &parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/* Exported under the names of libnvds_inferutils, which libnvds_infer also
+ * links: protected so that libnvds_infer calls these and not the first
+ * definition found by the dynamic linker. */
+#pragma GCC visibility push(protected)
+
+NvDsInferDBScanHandle
+NvDsInferDBScanCreate()
+{
+    return new (nothrow) NvDsInferDBScan;
+}
+
+void
+NvDsInferDBScanDestroy(NvDsInferDBScanHandle handle)
+{
+    delete handle;
+}
+
+void
+NvDsInferDBScanCluster(NvDsInferDBScanHandle handle,
+        NvDsInferDBScanClusteringParams *params,
+        NvDsInferObjectDetectionInfo *objects, size_t *numObjects)
+{
+    if (!handle || !params || !objects || !numObjects || *numObjects == 0)
+        return;
+
+    unsigned int n = *numObjects;
+    float eps = params->eps;
+    vector<DBScanRect> &tree = handle->tree;
+    vector<unsigned int> &position = handle->position;
+    vector<unsigned int> &neighbors = handle->neighbors;
+    vector<int> &parent = handle->parent;
+    vector<int> &owner = handle->owner;
+
+    tree.resize(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        NvDsInferObjectDetectionInfo const &o = objects[i];
+        DBScanRect &r = tree[i];
+        r = { (float) o.left, (float) o.top, (float) o.left + o.width,
+            (float) o.top + o.height, 0, i };
+        /* From the edges as the neighbor distance, so that it bounds it. */
+        r.reach = eps * ((r.right - r.left) + (r.bottom - r.top)) * 0.5f;
+    }
+    buildTree(tree.data(), 0, n, 0);
+    position.resize(n);
+    for (unsigned int p = 0; p < n; p++)
+        position[tree[p].index] = p;
+
+    /* Core objects, by object index. */
+    handle->core.assign(n, false);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        queryNeighbors(tree, position[i], eps, neighbors);
+        handle->core[i] = neighbors.size() >= params->minBoxes;
+    }
+
+    /* Core neighbors are in the same cluster, border objects go to their
+     * first core neighbor in object order. */
+    parent.resize(n);
+    owner.assign(n, -1);
+    for (unsigned int i = 0; i < n; i++)
+        parent[i] = i;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (!handle->core[i])
+            continue;
+        queryNeighbors(tree, position[i], eps, neighbors);
+        for (unsigned int p : neighbors)
+        {
+            unsigned int j = tree[p].index;
+            if (handle->core[j])
+            {
+                int root1 = findRoot(parent, i);
+                int root2 = findRoot(parent, j);
+                if (root1 != root2)
+                    parent[max(root1, root2)] = min(root1, root2);
+            }
+            else if (owner[j] < 0)
+            {
+                owner[j] = i;
+            }
+        }
+    }
+
+    /* Clusters are numbered by their first object. */
+    vector<int> &label = handle->label;
+    vector<DBScanCluster> &clusters = handle->clusters;
+    label.assign(n, -1);
+    clusters.clear();
+    for (unsigned int i = 0; i < n; i++)
+    {
+        int root;
+        if (handle->core[i])
+            root = findRoot(parent, i);
+        else if (owner[i] >= 0)
+            root = findRoot(parent, owner[i]);
+        else
+            continue;
+
+        if (label[root] < 0)
+        {
+            label[root] = clusters.size();
+            clusters.push_back({ 0, 0, 0, 0, 0, objects[i].classId,
+                    objects[i].detectionConfidence });
+        }
+        DBScanCluster &cluster = clusters[label[root]];
+        cluster.left += objects[i].left;
+        cluster.top += objects[i].top;
+        cluster.width += objects[i].width;
+        cluster.height += objects[i].height;
+        cluster.count++;
+        cluster.confidence = max(cluster.confidence, objects[i].detectionConfidence);
+    }
+
+    /* Average of each cluster, dropped if its area is too large for its
+     * number of objects. */
+    size_t numClusters = 0;
+    for (DBScanCluster const &cluster : clusters)
+    {
+        double s = 1.0 / cluster.count;
+        NvDsInferObjectDetectionInfo object;
+
+        object.classId = cluster.classId;
+        object.left = lrint(cluster.left * s);
+        object.top = lrint(cluster.top * s);
+        object.width = lrint(cluster.width * s);
+        object.height = lrint(cluster.height * s);
+        object.detectionConfidence = cluster.confidence;
+
+        if (params->enableATHRFilter &&
+            sqrtf((float) object.width * object.height) / cluster.count >
+                params->thresholdATHR)
+            continue;
+        objects[numClusters++] = object;
+    }
+    *numObjects = numClusters;
+}
+
+#pragma GCC visibility pop
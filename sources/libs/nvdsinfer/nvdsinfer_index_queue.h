@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __NVDSINFER_INDEX_QUEUE_H__
+#define __NVDSINFER_INDEX_QUEUE_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+
+/**
+ * Counters of an NvDsInferIndexQueue.
+ */
+struct NvDsInferIndexQueueStats
+{
+    /** Indexes pushed. */
+    uint64_t pushed = 0;
+    /** Largest number of queued indexes. */
+    unsigned int maxDepth = 0;
+    /** Pops which found the queue empty and waited. */
+    uint64_t popWaits = 0;
+    /** Total time waited by these pops. */
+    uint64_t popWaitNs = 0;
+};
+
+/**
+ * Queue of batch indexes guarded by a mutex shared with other queues.
+ *
+ * Each queue has its own condition, so that a push wakes one thread waiting
+ * on this queue and never a thread waiting on another queue sharing the
+ * mutex. The caller holds the mutex around push() and pop().
+ */
+class NvDsInferIndexQueue
+{
+public:
+    bool empty() const { return m_Indexes.empty(); }
+
+    /** Queues index and wakes a thread waiting to pop. */
+    void push(unsigned int index)
+    {
+        m_Indexes.push(index);
+        m_Stats.pushed++;
+        if (m_Indexes.size() > m_Stats.maxDepth)
+            m_Stats.maxDepth = m_Indexes.size();
+        m_Condition.notify_one();
+    }
+
+    /** Pops the oldest index, waiting with lock until there is one. */
+    unsigned int pop(std::unique_lock<std::mutex> &lock)
+    {
+        if (m_Indexes.empty())
+        {
+            auto start = std::chrono::steady_clock::now();
+            while (m_Indexes.empty())
+                m_Condition.wait(lock);
+            m_Stats.popWaits++;
+            m_Stats.popWaitNs += std::chrono::duration_cast<
+                std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                    start).count();
+        }
+        unsigned int index = m_Indexes.front();
+        m_Indexes.pop();
+        return index;
+    }
+
+    NvDsInferIndexQueueStats const &stats() const { return m_Stats; }
+
+private:
+    std::queue<unsigned int> m_Indexes;
+    std::condition_variable m_Condition;
+    NvDsInferIndexQueueStats m_Stats;
+};
+
+#endif
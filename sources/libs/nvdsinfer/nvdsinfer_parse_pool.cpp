@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "nvdsinfer_parse_pool.h"
+
+using namespace std;
+
+NvDsInferParsePool::NvDsInferParsePool(unsigned int numWorkers) :
+        m_Func(nullptr),
+        m_NumTasks(0),
+        m_NextTask(0),
+        m_Generation(0),
+        m_NumBusy(0),
+        m_Stop(false)
+{
+    for (unsigned int worker = 1; worker < numWorkers; worker++)
+        m_Threads.emplace_back(&NvDsInferParsePool::workerLoop, this, worker);
+}
+
+NvDsInferParsePool::~NvDsInferParsePool()
+{
+    {
+        unique_lock<mutex> lock(m_Mutex);
+        m_Stop = true;
+        m_StartCondition.notify_all();
+    }
+    for (auto & thread:m_Threads)
+        thread.join();
+}
+
+/* Takes tasks of the current run until there are none left. */
+void
+NvDsInferParsePool::runTasks(unsigned int worker)
+{
+    unsigned int task;
+
+    while ((task = m_NextTask.fetch_add(1)) < m_NumTasks)
+        (*m_Func)(task, worker);
+}
+
+void
+NvDsInferParsePool::run(unsigned int numTasks, TaskFunc const &func)
+{
+    /* Not worth waking the pool threads for a single task. */
+    if (numTasks <= 1 || m_Threads.empty())
+    {
+        for (unsigned int task = 0; task < numTasks; task++)
+            func(task, 0);
+        return;
+    }
+
+    {
+        unique_lock<mutex> lock(m_Mutex);
+        m_Func = &func;
+        m_NumTasks = numTasks;
+        m_NextTask = 0;
+        m_NumBusy = m_Threads.size();
+        m_Generation++;
+        m_StartCondition.notify_all();
+    }
+
+    runTasks(0);
+
+    /* Every pool thread goes through each run, even when the tasks are all
+     * taken, so that none is left in this run when the next one starts. */
+    unique_lock<mutex> lock(m_Mutex);
+    while (m_NumBusy > 0)
+        m_DoneCondition.wait(lock);
+    m_Func = nullptr;
+}
+
+void
+NvDsInferParsePool::workerLoop(unsigned int worker)
+{
+    unsigned long generation = 0;
+
+    for (;;)
+    {
+        {
+            unique_lock<mutex> lock(m_Mutex);
+            while (!m_Stop && m_Generation == generation)
+                m_StartCondition.wait(lock);
+            if (m_Stop)
+                return;
+            generation = m_Generation;
+        }
+
+        runTasks(worker);
+
+        unique_lock<mutex> lock(m_Mutex);
+        if (--m_NumBusy == 0)
+            m_DoneCondition.notify_one();
+    }
+}
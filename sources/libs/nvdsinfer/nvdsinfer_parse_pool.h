@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __NVDSINFER_PARSE_POOL_H__
+#define __NVDSINFER_PARSE_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of threads running the output parsing of the frames of a batch.
+ *
+ * The thread calling run() is worker 0 and the pool threads are workers 1 to
+ * numWorkers - 1, so that a worker index can select per worker scratch state.
+ */
+class NvDsInferParsePool
+{
+public:
+    typedef std::function<void(unsigned int task, unsigned int worker)> TaskFunc;
+
+    /** Starts numWorkers - 1 threads. */
+    NvDsInferParsePool(unsigned int numWorkers);
+    ~NvDsInferParsePool();
+
+    unsigned int numWorkers() const { return m_Threads.size() + 1; }
+
+    /**
+     * Calls func for the tasks 0 to numTasks - 1, spread on the workers, and
+     * returns when all the calls have returned. Not reentrant: a single thread
+     * may call run() at a time.
+     */
+    void run(unsigned int numTasks, TaskFunc const &func);
+
+private:
+    void runTasks(unsigned int worker);
+    void workerLoop(unsigned int worker);
+
+    std::vector<std::thread> m_Threads;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_StartCondition;
+    std::condition_variable m_DoneCondition;
+
+    /* Current run, started when m_Generation changes. */
+    TaskFunc const *m_Func;
+    unsigned int m_NumTasks;
+    std::atomic<unsigned int> m_NextTask;
+    unsigned long m_Generation;
+    /* Pool threads still running tasks of the current run. */
+    unsigned int m_NumBusy;
+    bool m_Stop;
+};
+
+#endif
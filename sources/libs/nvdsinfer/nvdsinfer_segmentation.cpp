@@ -0,0 +1,238 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include <algorithm>
+
+#include "nvdsinfer_segmentation.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SEG_HAVE_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define SEG_HAVE_NEON 1
+#endif
+
+using namespace std;
+
+/* Pixels of a tile: the running maxima (4 KB) and the class map entries of a
+ * tile stay in L1 while all the planes are read. */
+#define SEG_TILE 1024
+
+/* A pixel takes class c if its probability is above both the threshold and
+ * the probability of the class it has: the running maximum starts at the
+ * threshold, or -1 as the original loop, and each update is a strict
+ * comparison, so ties and NaNs keep the earlier class. */
+static inline float
+initialMax(float threshold)
+{
+    return max(threshold, -1.0f);
+}
+
+static void
+argmaxTileScalar(const float *probabilities, size_t planeSize,
+        unsigned int classes, unsigned int count, float threshold,
+        float *maxima, int *classMap)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        maxima[i] = initialMax(threshold);
+        classMap[i] = -1;
+    }
+    for (unsigned int c = 0; c < classes; c++)
+    {
+        const float *plane = probabilities + c * planeSize;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (plane[i] > maxima[i])
+            {
+                maxima[i] = plane[i];
+                classMap[i] = c;
+            }
+        }
+    }
+}
+
+#ifdef SEG_HAVE_AVX2
+__attribute__((target("avx2")))
+static void
+argmaxTileAvx2(const float *probabilities, size_t planeSize,
+        unsigned int classes, unsigned int count, float threshold,
+        float *maxima, int *classMap)
+{
+    unsigned int vectorCount = count & ~7u;
+    const __m256 initial = _mm256_set1_ps(initialMax(threshold));
+    const __m256i none = _mm256_set1_epi32(-1);
+
+    for (unsigned int i = 0; i < vectorCount; i += 8)
+    {
+        _mm256_storeu_ps(maxima + i, initial);
+        _mm256_storeu_si256((__m256i *) (classMap + i), none);
+    }
+    for (unsigned int c = 0; c < classes; c++)
+    {
+        const float *plane = probabilities + c * planeSize;
+        const __m256 vclass = _mm256_castsi256_ps(_mm256_set1_epi32(c));
+        for (unsigned int i = 0; i < vectorCount; i += 8)
+        {
+            __m256 p = _mm256_loadu_ps(plane + i);
+            __m256 m = _mm256_loadu_ps(maxima + i);
+            __m256 greater = _mm256_cmp_ps(p, m, _CMP_GT_OQ);
+            __m256 cls = _mm256_loadu_ps((const float *) (classMap + i));
+            _mm256_storeu_ps(maxima + i, _mm256_blendv_ps(m, p, greater));
+            _mm256_storeu_ps((float *) (classMap + i),
+                    _mm256_blendv_ps(cls, vclass, greater));
+        }
+    }
+    if (vectorCount < count)
+        argmaxTileScalar(probabilities + vectorCount, planeSize, classes,
+                count - vectorCount, threshold, maxima + vectorCount,
+                classMap + vectorCount);
+}
+#endif
+
+#ifdef SEG_HAVE_NEON
+static void
+argmaxTileNeon(const float *probabilities, size_t planeSize,
+        unsigned int classes, unsigned int count, float threshold,
+        float *maxima, int *classMap)
+{
+    unsigned int vectorCount = count & ~3u;
+    const float32x4_t initial = vdupq_n_f32(initialMax(threshold));
+    const int32x4_t none = vdupq_n_s32(-1);
+
+    for (unsigned int i = 0; i < vectorCount; i += 4)
+    {
+        vst1q_f32(maxima + i, initial);
+        vst1q_s32(classMap + i, none);
+    }
+    for (unsigned int c = 0; c < classes; c++)
+    {
+        const float *plane = probabilities + c * planeSize;
+        const int32x4_t vclass = vdupq_n_s32(c);
+        for (unsigned int i = 0; i < vectorCount; i += 4)
+        {
+            float32x4_t p = vld1q_f32(plane + i);
+            float32x4_t m = vld1q_f32(maxima + i);
+            uint32x4_t greater = vcgtq_f32(p, m);
+            vst1q_f32(maxima + i, vbslq_f32(greater, p, m));
+            vst1q_s32(classMap + i, vbslq_s32(greater, vclass,
+                        vld1q_s32(classMap + i)));
+        }
+    }
+    if (vectorCount < count)
+        argmaxTileScalar(probabilities + vectorCount, planeSize, classes,
+                count - vectorCount, threshold, maxima + vectorCount,
+                classMap + vectorCount);
+}
+#endif
+
+/* Downsampled map: the sampled pixels are strided, the planes are still read
+ * one after the other for a row of the map. */
+static void
+argmaxDownsampled(const float *probabilities, unsigned int width,
+        unsigned int height, unsigned int classes, float threshold,
+        unsigned int scale, int *classMap)
+{
+    size_t planeSize = (size_t) width * height;
+    unsigned int mapWidth = NvDsInferSegmentationMapDim(width, scale);
+    unsigned int mapHeight = NvDsInferSegmentationMapDim(height, scale);
+    float maxima[SEG_TILE];
+
+    for (unsigned int y = 0; y < mapHeight; y++)
+    {
+        unsigned int sy = min(y * scale + scale / 2, height - 1);
+        const float *row = probabilities + (size_t) sy * width;
+        int *mapRow = classMap + (size_t) y * mapWidth;
+
+        for (unsigned int x0 = 0; x0 < mapWidth; x0 += SEG_TILE)
+        {
+            unsigned int count = min(mapWidth - x0, (unsigned int) SEG_TILE);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                maxima[i] = initialMax(threshold);
+                mapRow[x0 + i] = -1;
+            }
+            for (unsigned int c = 0; c < classes; c++)
+            {
+                const float *plane = row + c * planeSize;
+                for (unsigned int i = 0; i < count; i++)
+                {
+                    unsigned int sx = min((x0 + i) * scale + scale / 2, width - 1);
+                    if (plane[sx] > maxima[i])
+                    {
+                        maxima[i] = plane[sx];
+                        mapRow[x0 + i] = c;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void
+NvDsInferSegmentationArgmax(const float *probabilities, unsigned int width,
+        unsigned int height, unsigned int classes, float threshold,
+        unsigned int scale, int *classMap, NvDsInferGridIsa isa)
+{
+    size_t planeSize = (size_t) width * height;
+    float maxima[SEG_TILE];
+
+    if (scale > 1)
+    {
+        argmaxDownsampled(probabilities, width, height, classes, threshold,
+                scale, classMap);
+        return;
+    }
+
+    for (size_t start = 0; start < planeSize; start += SEG_TILE)
+    {
+        unsigned int count = min(planeSize - start, (size_t) SEG_TILE);
+        switch (isa)
+        {
+#ifdef SEG_HAVE_AVX2
+            case NVDSINFER_GRID_ISA_AVX2:
+                argmaxTileAvx2(probabilities + start, planeSize, classes, count,
+                        threshold, maxima, classMap + start);
+                break;
+#endif
+#ifdef SEG_HAVE_NEON
+            case NVDSINFER_GRID_ISA_NEON:
+                argmaxTileNeon(probabilities + start, planeSize, classes, count,
+                        threshold, maxima, classMap + start);
+                break;
+#endif
+            default:
+                argmaxTileScalar(probabilities + start, planeSize, classes,
+                        count, threshold, maxima, classMap + start);
+                break;
+        }
+    }
+}
+
+unsigned int
+NvDsInferSegmentationEncodeRuns(const int *classMap, size_t numPixels,
+        vector<int> &runs)
+{
+    runs.clear();
+    for (size_t i = 0; i < numPixels;)
+    {
+        size_t end = i + 1;
+        while (end < numPixels && classMap[end] == classMap[i])
+            end++;
+        runs.push_back(classMap[i]);
+        runs.push_back(end - i);
+        i = end;
+    }
+    return runs.size() / 2;
+}
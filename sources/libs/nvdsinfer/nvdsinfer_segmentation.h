@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __NVDSINFER_SEGMENTATION_H__
+#define __NVDSINFER_SEGMENTATION_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "nvdsinfer_gridparser.h"
+
+/** Size of a class map side downsampled by @a scale. */
+static inline unsigned int
+NvDsInferSegmentationMapDim(unsigned int dim, unsigned int scale)
+{
+    return (dim + scale - 1) / scale;
+}
+
+/**
+ * Fills @a classMap with the class of highest probability of each pixel of
+ * @a probabilities (@a classes planes of @a width x @a height floats), or -1
+ * if no probability is above @a threshold. Ties go to the lowest class.
+ *
+ * With @a scale > 1 the map is downsampled: entry (x, y) of the
+ * NvDsInferSegmentationMapDim(width, scale) x
+ * NvDsInferSegmentationMapDim(height, scale) map is the class of the center
+ * pixel of the scale x scale block at (x * scale, y * scale).
+ *
+ * The planes are read one after the other over tiles of pixels, keeping the
+ * running maximum and class of the pixels of a tile in cache, 8 (AVX2) or 4
+ * (NEON) pixels at a time. The instruction set is selected as for the grid
+ * parser (NVDSINFER_GRID_ISA).
+ */
+void NvDsInferSegmentationArgmax(const float *probabilities, unsigned int width,
+        unsigned int height, unsigned int classes, float threshold,
+        unsigned int scale, int *classMap,
+        NvDsInferGridIsa isa = NvDsInferGridDefaultIsa());
+
+/**
+ * Run-length encodes the @a numPixels entries of @a classMap in row-major
+ * order, runs crossing rows. @a runs is set to (class, length) pairs.
+ *
+ * @return number of runs.
+ */
+unsigned int NvDsInferSegmentationEncodeRuns(const int *classMap,
+        size_t numPixels, std::vector<int> &runs);
+
+#endif
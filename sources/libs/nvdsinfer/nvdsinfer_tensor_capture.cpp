@@ -0,0 +1,534 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Tensor capture files, implementing nvdsinfer_tensor_capture.h.
+ *
+ * Layout, in the byte order of the writer (little-endian on the supported
+ * platforms):
+ *   CaptureFileHeader
+ *   CaptureLayerRecord and name (padded to 8 bytes) of each layer
+ *   padding to 64 bytes (CaptureFileHeader::headerSize)
+ *   one segment per batch:
+ *     CaptureSegmentHeader
+ *     NvDsInferTensorCaptureFrameInfo of each frame
+ *     padding to 64 bytes
+ *     tensors of each layer for all the frames, each padded to 64 bytes
+ * The size of a segment follows from its number of frames and the layers; a
+ * segment of another size is the end of the file.
+ *
+ * A segment is built in a buffer by the thread queueing the batch and written
+ * with one write() by the writer thread. Buffers are recycled, nothing is
+ * allocated once there are maxQueuedBatches buffers of the largest batch.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nvdsinfer_tensor_capture.h"
+
+using namespace std;
+
+static const char kFileMagic[8] = { 'N', 'V', 'D', 'S', 'T', 'C', 'A', 'P' };
+static const char kSegmentMagic[4] = { 'B', 'T', 'C', 'H' };
+static const size_t kAlignment = 64;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t uniqueID;
+    uint32_t numLayers;
+    /* Offset of the first segment. */
+    uint32_t headerSize;
+} CaptureFileHeader;
+
+typedef struct
+{
+    uint32_t dataType;
+    uint32_t isInput;
+    uint32_t numDims;
+    uint32_t d[NVDSINFER_MAX_DIMS];
+    /* Length of the name following the record, without terminating NUL. */
+    uint32_t nameLength;
+} CaptureLayerRecord;
+
+typedef struct
+{
+    char magic[4];
+    uint32_t numFrames;
+    uint64_t batchNumber;
+    uint64_t segmentSize;
+} CaptureSegmentHeader;
+
+static inline size_t
+align(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static size_t
+elementSize(NvDsInferDataType t)
+{
+    switch (t)
+    {
+        case INT32:
+        case FLOAT:
+            return 4;
+        case HALF:
+            return 2;
+        case INT8:
+            return 1;
+    }
+    return 0;
+}
+
+/* Size of a segment of numFrames frames, and offsets of the layer tensors in
+ * it. */
+static size_t
+segmentLayout(unsigned int numFrames, vector<size_t> const &frameSizes,
+        vector<size_t> &layerOffsets)
+{
+    size_t size = align(sizeof(CaptureSegmentHeader) +
+            numFrames * sizeof(NvDsInferTensorCaptureFrameInfo), kAlignment);
+
+    layerOffsets.resize(frameSizes.size());
+    for (size_t i = 0; i < frameSizes.size(); i++)
+    {
+        layerOffsets[i] = size;
+        size += align(numFrames * frameSizes[i], kAlignment);
+    }
+    return size;
+}
+
+/* Writes all of buffer, retrying on interruptions and partial writes. */
+static bool
+writeAll(int fd, uint8_t const *buffer, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, buffer, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buffer += written;
+        size -= written;
+    }
+    return true;
+}
+
+struct NvDsInferTensorCaptureWriter
+{
+    int fd = -1;
+    vector<size_t> frameSizes;
+    unsigned int maxQueuedBatches = 1;
+
+    mutex queueMutex;
+    condition_variable queueCondition;
+    /* Segments to write, in batch order. */
+    deque<vector<uint8_t>> queue;
+    vector<vector<uint8_t>> freeBuffers;
+    /* Batches being built or queued. */
+    unsigned int numPending = 0;
+    uint64_t nextBatchNumber = 0;
+    bool stop = false;
+    NvDsInferTensorCaptureWriterStats stats = {};
+
+    thread writerThread;
+    /* Scratch of the queueing thread. */
+    vector<size_t> layerOffsets;
+};
+
+static void
+writerLoop(NvDsInferTensorCaptureWriter *writer)
+{
+    unique_lock<mutex> lock(writer->queueMutex);
+    while (true)
+    {
+        while (writer->queue.empty() && !writer->stop)
+            writer->queueCondition.wait(lock);
+        if (writer->queue.empty())
+            break;
+
+        vector<uint8_t> segment = move(writer->queue.front());
+        writer->queue.pop_front();
+        lock.unlock();
+        bool ok = writeAll(writer->fd, segment.data(), segment.size());
+        lock.lock();
+
+        if (ok)
+        {
+            writer->stats.writtenBatches++;
+            writer->stats.writtenBytes += segment.size();
+        }
+        else
+        {
+            writer->stats.failedBatches++;
+        }
+        writer->freeBuffers.push_back(move(segment));
+        writer->numPending--;
+    }
+}
+
+NvDsInferTensorCaptureWriterHandle
+NvDsInferTensorCaptureWriterCreate(const char *filePath, unsigned int uniqueID,
+        const NvDsInferLayerInfo *layers, unsigned int numLayers,
+        unsigned int maxQueuedBatches)
+{
+    if (!filePath || !layers || numLayers == 0)
+        return nullptr;
+
+    vector<uint8_t> header(sizeof(CaptureFileHeader));
+    CaptureFileHeader fileHeader;
+    memcpy(fileHeader.magic, kFileMagic, sizeof(kFileMagic));
+    fileHeader.version = NVDSINFER_TENSOR_CAPTURE_VERSION;
+    fileHeader.uniqueID = uniqueID;
+    fileHeader.numLayers = numLayers;
+
+    NvDsInferTensorCaptureWriter *writer =
+        new (nothrow) NvDsInferTensorCaptureWriter;
+    if (!writer)
+        return nullptr;
+    writer->maxQueuedBatches = max(1u, maxQueuedBatches);
+    writer->frameSizes.resize(numLayers);
+
+    for (unsigned int i = 0; i < numLayers; i++)
+    {
+        NvDsInferLayerInfo const &layer = layers[i];
+        CaptureLayerRecord record = {};
+        string name = layer.layerName ? layer.layerName : "";
+        size_t numElements = 1;
+
+        record.dataType = layer.dataType;
+        record.isInput = layer.isInput;
+        record.numDims = min(layer.dims.numDims, (unsigned int) NVDSINFER_MAX_DIMS);
+        for (unsigned int d = 0; d < record.numDims; d++)
+        {
+            record.d[d] = layer.dims.d[d];
+            numElements *= layer.dims.d[d];
+        }
+        record.nameLength = name.size();
+        /* As the reader computes it. */
+        writer->frameSizes[i] = numElements * elementSize(layer.dataType);
+
+        size_t offset = header.size();
+        header.resize(align(offset + sizeof(record) + name.size(), 8));
+        memcpy(header.data() + offset, &record, sizeof(record));
+        memcpy(header.data() + offset + sizeof(record), name.data(),
+                name.size());
+    }
+    header.resize(align(header.size(), kAlignment));
+    fileHeader.headerSize = header.size();
+    memcpy(header.data(), &fileHeader, sizeof(fileHeader));
+
+    writer->fd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0 || !writeAll(writer->fd, header.data(), header.size()))
+    {
+        if (writer->fd >= 0)
+            close(writer->fd);
+        delete writer;
+        return nullptr;
+    }
+    writer->stats.writtenBytes = header.size();
+    writer->writerThread = thread(writerLoop, writer);
+    return writer;
+}
+
+int
+NvDsInferTensorCaptureWriterQueueBatch(NvDsInferTensorCaptureWriterHandle handle,
+        const NvDsInferTensorCaptureFrameInfo *frames, unsigned int numFrames,
+        void * const *layerBuffers)
+{
+    if (!handle || !frames || numFrames == 0 || !layerBuffers)
+        return 0;
+
+    vector<uint8_t> segment;
+    uint64_t batchNumber;
+    {
+        unique_lock<mutex> lock(handle->queueMutex);
+        if (handle->numPending >= handle->maxQueuedBatches)
+        {
+            handle->stats.droppedBatches++;
+            return 0;
+        }
+        handle->numPending++;
+        batchNumber = handle->nextBatchNumber++;
+        if (!handle->freeBuffers.empty())
+        {
+            segment = move(handle->freeBuffers.back());
+            handle->freeBuffers.pop_back();
+        }
+    }
+
+    /* Batches are queued by one thread at a time, in batch order. */
+    vector<size_t> &layerOffsets = handle->layerOffsets;
+    size_t size = segmentLayout(numFrames, handle->frameSizes, layerOffsets);
+    segment.resize(size);
+
+    CaptureSegmentHeader segmentHeader;
+    memcpy(segmentHeader.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    segmentHeader.numFrames = numFrames;
+    segmentHeader.batchNumber = batchNumber;
+    segmentHeader.segmentSize = size;
+
+    uint8_t *data = segment.data();
+    size_t framesEnd = sizeof(segmentHeader) +
+        numFrames * sizeof(NvDsInferTensorCaptureFrameInfo);
+    memcpy(data, &segmentHeader, sizeof(segmentHeader));
+    memcpy(data + sizeof(segmentHeader), frames,
+            numFrames * sizeof(NvDsInferTensorCaptureFrameInfo));
+    memset(data + framesEnd, 0, layerOffsets.empty() ?
+            size - framesEnd : layerOffsets[0] - framesEnd);
+
+    for (size_t i = 0; i < layerOffsets.size(); i++)
+    {
+        size_t tensorSize = numFrames * handle->frameSizes[i];
+        size_t end = i + 1 < layerOffsets.size() ? layerOffsets[i + 1] : size;
+        if (layerBuffers[i])
+        {
+            memcpy(data + layerOffsets[i], layerBuffers[i], tensorSize);
+            memset(data + layerOffsets[i] + tensorSize, 0,
+                    end - layerOffsets[i] - tensorSize);
+        }
+        else
+        {
+            memset(data + layerOffsets[i], 0, end - layerOffsets[i]);
+        }
+    }
+
+    {
+        unique_lock<mutex> lock(handle->queueMutex);
+        handle->queue.push_back(move(segment));
+        handle->queueCondition.notify_one();
+    }
+    return 1;
+}
+
+void
+NvDsInferTensorCaptureWriterGetStats(NvDsInferTensorCaptureWriterHandle handle,
+        NvDsInferTensorCaptureWriterStats *stats)
+{
+    if (!handle || !stats)
+        return;
+
+    unique_lock<mutex> lock(handle->queueMutex);
+    *stats = handle->stats;
+}
+
+void
+NvDsInferTensorCaptureWriterDestroy(NvDsInferTensorCaptureWriterHandle handle)
+{
+    if (!handle)
+        return;
+
+    {
+        unique_lock<mutex> lock(handle->queueMutex);
+        handle->stop = true;
+        handle->queueCondition.notify_one();
+    }
+    handle->writerThread.join();
+    close(handle->fd);
+    delete handle;
+}
+
+struct NvDsInferTensorCaptureReader
+{
+    uint8_t const *data = nullptr;
+    size_t size = 0;
+    unsigned int uniqueID = 0;
+    vector<string> layerNames;
+    vector<NvDsInferLayerInfo> layers;
+    vector<size_t> frameSizes;
+    /* Offset of the segment of each batch. */
+    vector<size_t> segments;
+};
+
+/* Reads the layers of the header, false if it is not a valid one. */
+static bool
+readHeader(NvDsInferTensorCaptureReader *reader)
+{
+    CaptureFileHeader fileHeader;
+    if (reader->size < sizeof(fileHeader))
+        return false;
+    memcpy(&fileHeader, reader->data, sizeof(fileHeader));
+    if (memcmp(fileHeader.magic, kFileMagic, sizeof(kFileMagic)) ||
+            fileHeader.version != NVDSINFER_TENSOR_CAPTURE_VERSION ||
+            fileHeader.numLayers == 0 ||
+            fileHeader.headerSize > reader->size ||
+            fileHeader.headerSize % kAlignment)
+        return false;
+
+    reader->uniqueID = fileHeader.uniqueID;
+    size_t offset = sizeof(fileHeader);
+    for (unsigned int i = 0; i < fileHeader.numLayers; i++)
+    {
+        CaptureLayerRecord record;
+        NvDsInferLayerInfo layer = {};
+        if (offset + sizeof(record) > fileHeader.headerSize)
+            return false;
+        memcpy(&record, reader->data + offset, sizeof(record));
+        offset += sizeof(record);
+        if (record.dataType > INT32 || record.numDims > NVDSINFER_MAX_DIMS ||
+                offset + record.nameLength > fileHeader.headerSize)
+            return false;
+
+        layer.dataType = (NvDsInferDataType) record.dataType;
+        layer.isInput = record.isInput;
+        layer.bindingIndex = i;
+        layer.dims.numDims = record.numDims;
+        layer.dims.numElements = 1;
+        for (unsigned int d = 0; d < record.numDims; d++)
+        {
+            layer.dims.d[d] = record.d[d];
+            layer.dims.numElements *= record.d[d];
+        }
+        reader->layerNames.emplace_back(
+                (char const *) reader->data + offset, record.nameLength);
+        reader->layers.push_back(layer);
+        reader->frameSizes.push_back(layer.dims.numElements *
+                elementSize(layer.dataType));
+        offset = align(offset + record.nameLength, 8);
+    }
+    for (size_t i = 0; i < reader->layers.size(); i++)
+        reader->layers[i].layerName = reader->layerNames[i].c_str();
+
+    /* Index the complete segments. */
+    vector<size_t> layerOffsets;
+    offset = fileHeader.headerSize;
+    while (offset + sizeof(CaptureSegmentHeader) <= reader->size)
+    {
+        CaptureSegmentHeader segmentHeader;
+        memcpy(&segmentHeader, reader->data + offset, sizeof(segmentHeader));
+        if (memcmp(segmentHeader.magic, kSegmentMagic, sizeof(kSegmentMagic)) ||
+                segmentHeader.numFrames == 0)
+            break;
+        size_t size = segmentLayout(segmentHeader.numFrames,
+                reader->frameSizes, layerOffsets);
+        if (segmentHeader.segmentSize != size || size > reader->size - offset)
+            break;
+        reader->segments.push_back(offset);
+        offset += size;
+    }
+    return true;
+}
+
+NvDsInferTensorCaptureReaderHandle
+NvDsInferTensorCaptureReaderOpen(const char *filePath)
+{
+    struct stat fileStat;
+    int fd = filePath ? open(filePath, O_RDONLY) : -1;
+    if (fd < 0)
+        return nullptr;
+    if (fstat(fd, &fileStat) || fileStat.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void *data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    /* The mapping holds a reference to the file. */
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    NvDsInferTensorCaptureReader *reader =
+        new (nothrow) NvDsInferTensorCaptureReader;
+    if (!reader)
+    {
+        munmap(data, fileStat.st_size);
+        return nullptr;
+    }
+    reader->data = (uint8_t const *) data;
+    reader->size = fileStat.st_size;
+    if (!readHeader(reader))
+    {
+        NvDsInferTensorCaptureReaderClose(reader);
+        return nullptr;
+    }
+    return reader;
+}
+
+unsigned int
+NvDsInferTensorCaptureReaderGetUniqueID(
+        NvDsInferTensorCaptureReaderHandle handle)
+{
+    return handle ? handle->uniqueID : 0;
+}
+
+unsigned int
+NvDsInferTensorCaptureReaderGetLayers(NvDsInferTensorCaptureReaderHandle handle,
+        const NvDsInferLayerInfo **layers)
+{
+    if (!handle || !layers)
+        return 0;
+
+    *layers = handle->layers.data();
+    return handle->layers.size();
+}
+
+uint64_t
+NvDsInferTensorCaptureReaderGetNumBatches(
+        NvDsInferTensorCaptureReaderHandle handle)
+{
+    return handle ? handle->segments.size() : 0;
+}
+
+unsigned int
+NvDsInferTensorCaptureReaderGetBatch(NvDsInferTensorCaptureReaderHandle handle,
+        uint64_t batchIndex, const NvDsInferTensorCaptureFrameInfo **frames,
+        const void **layerBuffers)
+{
+    if (!handle || batchIndex >= handle->segments.size() || !frames ||
+            !layerBuffers)
+        return 0;
+
+    uint8_t const *segment = handle->data + handle->segments[batchIndex];
+    CaptureSegmentHeader segmentHeader;
+    memcpy(&segmentHeader, segment, sizeof(segmentHeader));
+    unsigned int numFrames = segmentHeader.numFrames;
+
+    /* As segmentLayout(), without allocating. */
+    size_t offset = align(sizeof(segmentHeader) +
+            numFrames * sizeof(NvDsInferTensorCaptureFrameInfo), kAlignment);
+    *frames = (NvDsInferTensorCaptureFrameInfo const *)
+        (segment + sizeof(segmentHeader));
+    for (size_t i = 0; i < handle->frameSizes.size(); i++)
+    {
+        layerBuffers[i] = segment + offset;
+        offset += align(numFrames * handle->frameSizes[i], kAlignment);
+    }
+    return numFrames;
+}
+
+void
+NvDsInferTensorCaptureReaderClose(NvDsInferTensorCaptureReaderHandle handle)
+{
+    if (!handle)
+        return;
+
+    munmap((void *) handle->data, handle->size);
+    delete handle;
+}
@@ -0,0 +1,344 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "nvdsinfer_tensor_replay.h"
+
+using namespace std;
+
+static size_t
+elementSize(NvDsInferDataType t)
+{
+    switch (t)
+    {
+        case INT32:
+        case FLOAT:
+            return 4;
+        case HALF:
+            return 2;
+        case INT8:
+            return 1;
+    }
+    return 0;
+}
+
+/* Parses "name:CxHxW[:float|half|int8|int32]". */
+static bool
+parseLayerSpec(string const &spec, string &name, NvDsInferLayerInfo &info)
+{
+    static const pair<const char *, NvDsInferDataType> types[] = {
+        { "float", FLOAT }, { "half", HALF }, { "int8", INT8 }, { "int32", INT32 }
+    };
+    string rest = spec;
+    size_t colon = rest.rfind(':');
+
+    info.dataType = FLOAT;
+    if (colon != string::npos)
+    {
+        for (auto const &type : types)
+        {
+            if (rest.compare(colon + 1, string::npos, type.first) == 0)
+            {
+                info.dataType = type.second;
+                rest.resize(colon);
+                colon = rest.rfind(':');
+                break;
+            }
+        }
+    }
+    if (colon == string::npos || colon == 0)
+        return false;
+
+    const char *dims = rest.c_str() + colon + 1;
+    info.dims.numDims = 0;
+    info.dims.numElements = 1;
+    while (true)
+    {
+        char *end;
+        unsigned long d = strtoul(dims, &end, 10);
+        if (end == dims || d == 0 || info.dims.numDims == NVDSINFER_MAX_DIMS)
+            return false;
+        info.dims.d[info.dims.numDims++] = d;
+        info.dims.numElements *= d;
+        if (*end == '\0')
+            break;
+        if (*end != 'x')
+            return false;
+        dims = end + 1;
+    }
+    name = rest.substr(0, colon);
+    return true;
+}
+
+/* File name of a layer of a batch, as written by nvinfer. */
+static string
+tensorFileName(unsigned int uniqueID, string const &layerName,
+        unsigned long batch, unsigned int batchSize)
+{
+    char fileName[256];
+    snprintf(fileName, sizeof(fileName),
+            "gstnvdsinfer_uid-%02u_layer-%s_batch-%010lu_batchsize-%02u.bin",
+            uniqueID, layerName.c_str(), batch, batchSize);
+    for (char *c = fileName; *c; c++)
+    {
+        if (*c == '/')
+            *c = '_';
+    }
+    return fileName;
+}
+
+NvDsInferTensorReplay::NvDsInferTensorReplay() :
+        m_Capture(nullptr),
+        m_NumBatches(0),
+        m_NumFrames(0),
+        m_NextFrame(0),
+        m_BatchPeriod(0)
+{
+}
+
+NvDsInferTensorReplay::~NvDsInferTensorReplay()
+{
+    NvDsInferTensorCaptureReaderClose(m_Capture);
+}
+
+bool
+NvDsInferTensorReplay::open(string const &path, unsigned int uniqueID,
+        vector<string> const &layerSpecs, string &error)
+{
+    struct stat pathStat;
+    if (stat(path.c_str(), &pathStat))
+    {
+        error = "cannot access '" + path + "'";
+        return false;
+    }
+    bool opened = S_ISREG(pathStat.st_mode) ?
+        openCapture(path, uniqueID, error) :
+        openDirectory(path, uniqueID, layerSpecs, error);
+    if (!opened)
+        return false;
+
+    m_NextFrame = 0;
+    m_NextBatchTime = chrono::steady_clock::now();
+    return true;
+}
+
+bool
+NvDsInferTensorReplay::openCapture(string const &path, unsigned int uniqueID,
+        string &error)
+{
+    m_Capture = NvDsInferTensorCaptureReaderOpen(path.c_str());
+    if (!m_Capture)
+    {
+        error = "'" + path + "' is not a tensor capture file";
+        return false;
+    }
+    if (NvDsInferTensorCaptureReaderGetUniqueID(m_Capture) != uniqueID)
+    {
+        error = "'" + path + "' is a capture of unique ID " +
+            to_string(NvDsInferTensorCaptureReaderGetUniqueID(m_Capture));
+        return false;
+    }
+
+    const NvDsInferLayerInfo *layers;
+    unsigned int numLayers = NvDsInferTensorCaptureReaderGetLayers(m_Capture,
+            &layers);
+    m_Layers.assign(layers, layers + numLayers);
+    for (unsigned int i = 0; i < numLayers; i++)
+    {
+        if (m_Layers[i].isInput != (i == 0))
+        {
+            error = "the capture does not have a single input layer first";
+            return false;
+        }
+        m_FrameSizes.push_back(m_Layers[i].dims.numElements *
+                elementSize(m_Layers[i].dataType));
+    }
+
+    m_NumBatches = NvDsInferTensorCaptureReaderGetNumBatches(m_Capture);
+    if (m_NumBatches == 0)
+    {
+        error = "no batch in '" + path + "'";
+        return false;
+    }
+    m_Frames.resize(numLayers);
+    vector<const void *> buffers(numLayers);
+    for (unsigned int b = 0; b < m_NumBatches; b++)
+    {
+        const NvDsInferTensorCaptureFrameInfo *frames;
+        unsigned int numFrames = NvDsInferTensorCaptureReaderGetBatch(
+                m_Capture, b, &frames, buffers.data());
+        for (unsigned int i = 0; i < numLayers; i++)
+        {
+            for (unsigned int f = 0; f < numFrames; f++)
+                m_Frames[i].push_back((uint8_t const *) buffers[i] +
+                        f * m_FrameSizes[i]);
+        }
+        m_NumFrames += numFrames;
+    }
+    return true;
+}
+
+bool
+NvDsInferTensorReplay::openDirectory(string const &directory,
+        unsigned int uniqueID, vector<string> const &layerSpecs,
+        string &error)
+{
+    if (layerSpecs.size() < 2)
+    {
+        error = "an input and at least one output layer are needed";
+        return false;
+    }
+    m_LayerNames.resize(layerSpecs.size());
+    m_Layers.resize(layerSpecs.size());
+    m_FrameSizes.resize(layerSpecs.size());
+    for (unsigned int i = 0; i < layerSpecs.size(); i++)
+    {
+        NvDsInferLayerInfo &info = m_Layers[i];
+        if (!parseLayerSpec(layerSpecs[i], m_LayerNames[i], info))
+        {
+            error = "invalid layer '" + layerSpecs[i] +
+                "', expected name:CxHxW[:float|half|int8|int32]";
+            return false;
+        }
+        info.isInput = (i == 0);
+        info.bindingIndex = i;
+        info.buffer = nullptr;
+        m_FrameSizes[i] = info.dims.numElements * elementSize(info.dataType);
+    }
+    /* The vector of names does not change any more. */
+    for (unsigned int i = 0; i < m_Layers.size(); i++)
+        m_Layers[i].layerName = m_LayerNames[i].c_str();
+
+    /* Batches of the first output layer. */
+    string prefix = tensorFileName(uniqueID, m_LayerNames[1], 0, 0);
+    prefix.resize(prefix.find("_batch-") + strlen("_batch-"));
+    vector<pair<unsigned long, unsigned int>> batches;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        error = "cannot open directory '" + directory + "'";
+        return false;
+    }
+    while (struct dirent *entry = readdir(dir))
+    {
+        unsigned long batch;
+        unsigned int batchSize;
+        int length = 0;
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0 &&
+            sscanf(entry->d_name + prefix.size(), "%lu_batchsize-%u.bin%n",
+                &batch, &batchSize, &length) == 2 &&
+            entry->d_name[prefix.size() + length] == '\0' && batchSize > 0)
+            batches.emplace_back(batch, batchSize);
+    }
+    closedir(dir);
+    if (batches.empty())
+    {
+        error = "no " + prefix + "* file in '" + directory + "'";
+        return false;
+    }
+    sort(batches.begin(), batches.end());
+
+    m_NumBatches = batches.size();
+    m_NumFrames = 0;
+    for (auto const &batch : batches)
+        m_NumFrames += batch.second;
+    m_Tensors.resize(m_Layers.size());
+    for (unsigned int i = 0; i < m_Layers.size(); i++)
+        m_Tensors[i].assign(m_NumFrames * m_FrameSizes[i], 0);
+
+    unsigned int frame = 0;
+    for (auto const &batch : batches)
+    {
+        for (unsigned int i = 0; i < m_Layers.size(); i++)
+        {
+            string path = directory + "/" + tensorFileName(uniqueID,
+                    m_LayerNames[i], batch.first, batch.second);
+            size_t size = m_FrameSizes[i] * batch.second;
+            FILE *file = fopen(path.c_str(), "rb");
+            if (!file)
+            {
+                /* Input tensors are only written if asked for. */
+                if (m_Layers[i].isInput)
+                    continue;
+                error = "cannot open '" + path + "'";
+                return false;
+            }
+            bool sizeOk = fread(m_Tensors[i].data() + frame * m_FrameSizes[i],
+                    1, size, file) == size && fgetc(file) == EOF;
+            fclose(file);
+            if (!sizeOk)
+            {
+                error = "'" + path + "' is not of " + to_string(size) +
+                    " bytes";
+                return false;
+            }
+        }
+        frame += batch.second;
+    }
+
+    m_Frames.resize(m_Layers.size());
+    for (unsigned int i = 0; i < m_Layers.size(); i++)
+    {
+        for (unsigned int f = 0; f < m_NumFrames; f++)
+            m_Frames[i].push_back(m_Tensors[i].data() + f * m_FrameSizes[i]);
+    }
+    return true;
+}
+
+void
+NvDsInferTensorReplay::readFrames(unsigned int numFrames,
+        vector<vector<uint8_t>> &buffers)
+{
+    for (unsigned int f = 0; f < numFrames; f++)
+    {
+        for (unsigned int i = 0; i < m_Layers.size() && i < buffers.size(); i++)
+        {
+            if (buffers[i].size() < (f + 1) * m_FrameSizes[i])
+                continue;
+            memcpy(buffers[i].data() + f * m_FrameSizes[i],
+                    m_Frames[i][m_NextFrame], m_FrameSizes[i]);
+        }
+        if (++m_NextFrame == m_NumFrames)
+            m_NextFrame = 0;
+    }
+}
+
+void
+NvDsInferTensorReplay::setBatchRate(double batchesPerSecond)
+{
+    m_BatchPeriod = batchesPerSecond > 0 ?
+        chrono::duration_cast<chrono::steady_clock::duration>(
+                chrono::duration<double>(1.0 / batchesPerSecond)) :
+        chrono::steady_clock::duration(0);
+}
+
+void
+NvDsInferTensorReplay::pace()
+{
+    if (m_BatchPeriod.count() == 0)
+        return;
+
+    auto now = chrono::steady_clock::now();
+    if (m_NextBatchTime > now)
+    {
+        this_thread::sleep_until(m_NextBatchTime);
+        now = m_NextBatchTime;
+    }
+    m_NextBatchTime = now + m_BatchPeriod;
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef __NVDSINFER_TENSOR_REPLAY_H__
+#define __NVDSINFER_TENSOR_REPLAY_H__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nvdsinfer.h>
+#include <nvdsinfer_tensor_capture.h>
+
+/**
+ * Layer tensors recorded by nvinfer, served frame by frame in place of the
+ * inference of a batch.
+ *
+ * They are read from a capture file (raw-output-capture-file, see
+ * nvdsinfer_tensor_capture.h), which describes the layers, or from a
+ * directory of the files written by raw-output-file-write. The files of a
+ * recorded batch are named gstnvdsinfer_uid-<uid>_layer-<layer name, '/'
+ * replaced by '_'>_batch-<batch number>_batchsize-<frames>.bin and hold the
+ * raw tensors of the frames of the batch. They do not hold the layer
+ * dimensions, so the layers are described as
+ * "name:CxHxW[:float|half|int8|int32]", the input layer first as binding 0 of
+ * an engine. The batches are those of the first output layer, in batch number
+ * order; the input layer files are optional.
+ */
+class NvDsInferTensorReplay
+{
+public:
+    NvDsInferTensorReplay();
+    ~NvDsInferTensorReplay();
+    NvDsInferTensorReplay(NvDsInferTensorReplay const &) = delete;
+    NvDsInferTensorReplay &operator=(NvDsInferTensorReplay const &) = delete;
+
+    /**
+     * Maps the capture file @a path, or loads the recorded batches of
+     * @a uniqueID in the directory @a path for the layers @a layerSpecs
+     * (not used for a capture file). Returns false with a message in
+     * @a error if a layer spec is invalid, no batch is found, a file is
+     * missing or of the wrong size, or the capture is not of @a uniqueID or
+     * does not have a single input layer first.
+     */
+    bool open(std::string const &path, unsigned int uniqueID,
+            std::vector<std::string> const &layerSpecs, std::string &error);
+
+    /** Bound layers, the input one first. The names are owned by the replay. */
+    std::vector<NvDsInferLayerInfo> const &layers() const { return m_Layers; }
+
+    unsigned int numBatches() const { return m_NumBatches; }
+    unsigned int numFrames() const { return m_NumFrames; }
+
+    /**
+     * Copies the tensors of the next @a numFrames recorded frames, looping
+     * back to the first one after the last one, to @a buffers (one per layer
+     * binding index, of at least numFrames frames; empty ones are skipped).
+     */
+    void readFrames(unsigned int numFrames,
+            std::vector<std::vector<uint8_t>> &buffers);
+
+    /** Batches per second served, 0 (default) for no pacing. */
+    void setBatchRate(double batchesPerSecond);
+
+    /**
+     * Waits until the next batch is due at the batch rate. Batches are not
+     * served faster to catch up with late ones.
+     */
+    void pace();
+
+private:
+    bool openCapture(std::string const &path, unsigned int uniqueID,
+            std::string &error);
+    bool openDirectory(std::string const &directory, unsigned int uniqueID,
+            std::vector<std::string> const &layerSpecs, std::string &error);
+
+    std::vector<std::string> m_LayerNames;
+    std::vector<NvDsInferLayerInfo> m_Layers;
+    /* Tensors of all the frames of each layer, in frame order, for a
+     * directory. */
+    std::vector<std::vector<uint8_t>> m_Tensors;
+    NvDsInferTensorCaptureReaderHandle m_Capture;
+    /* Tensor of each frame of each layer, in m_Tensors or m_Capture. */
+    std::vector<std::vector<uint8_t const *>> m_Frames;
+    std::vector<size_t> m_FrameSizes;
+    unsigned int m_NumBatches;
+    unsigned int m_NumFrames;
+    unsigned int m_NextFrame;
+
+    std::chrono::steady_clock::duration m_BatchPeriod;
+    std::chrono::steady_clock::time_point m_NextBatchTime;
+};
+
+#endif
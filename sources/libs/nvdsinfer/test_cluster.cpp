@@ -0,0 +1,286 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks that NvDsInferGroupRectangles gives the rectangles of
+ * cv::groupRectangles for the objects parsed from resnet10 detector tensors,
+ * then times both for growing numbers of objects.
+ *
+ * Usage: test_cluster [coverage.bin bbox.bin]
+ *
+ * The tensors are synthetic unless recorded ones are given: raw float32
+ * dumps of consecutive frames of the conv2d_cov/Sigmoid (4x34x60) and
+ * conv2d_bbox (16x34x60) layers of the sample resnet10 model, e.g. written
+ * from the output tensor meta of deepstream-infer-tensor-meta-test.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_cluster.h"
+
+/* Resnet10 sample model at 960x544 */
+#define NET_WIDTH 960
+#define NET_HEIGHT 544
+#define GRID_W 60
+#define GRID_H 34
+#define GRID_STRIDE 16
+#define BBOX_NORM 35.0f
+#define NUM_CLASSES 4
+
+using namespace std;
+
+extern "C"
+bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+/* Tensors of a frame with @numObjects objects, each covering the cells
+ * around its center with jittered box regressions. */
+static void
+fillTensors(mt19937 &rng, vector<float> &coverage, vector<float> &bbox,
+        unsigned int numObjects)
+{
+    uniform_real_distribution<float> uniform(0, 1);
+    normal_distribution<float> jitter(0, 3);
+    unsigned int gridSize = GRID_W * GRID_H;
+
+    for (float &c : coverage)
+        c = uniform(rng) * 0.1f;
+    for (float &b : bbox)
+        b = uniform(rng);
+
+    for (unsigned int o = 0; o < numObjects; o++)
+    {
+        unsigned int c = rng() % NUM_CLASSES;
+        float w = 20 + uniform(rng) * 200;
+        float h = 20 + uniform(rng) * 200;
+        float x1 = uniform(rng) * (NET_WIDTH - w);
+        float y1 = uniform(rng) * (NET_HEIGHT - h);
+        int cx = (x1 + w / 2) / GRID_STRIDE;
+        int cy = (y1 + h / 2) / GRID_STRIDE;
+        int rx = 1 + w / GRID_STRIDE / 4;
+        int ry = 1 + h / GRID_STRIDE / 4;
+
+        for (int gy = max(0, cy - ry); gy <= min(GRID_H - 1, cy + ry); gy++)
+        {
+            for (int gx = max(0, cx - rx); gx <= min(GRID_W - 1, cx + rx); gx++)
+            {
+                unsigned int i = gx + gy * GRID_W;
+                float centerX = (gx * GRID_STRIDE + 0.5f) / BBOX_NORM;
+                float centerY = (gy * GRID_STRIDE + 0.5f) / BBOX_NORM;
+                float *outputX1 = bbox.data() + c * 4 * gridSize;
+
+                coverage[c * gridSize + i] = 0.3f + uniform(rng) * 0.7f;
+                outputX1[i] = centerX - (x1 + jitter(rng)) / BBOX_NORM;
+                outputX1[gridSize + i] = centerY - (y1 + jitter(rng)) / BBOX_NORM;
+                outputX1[2 * gridSize + i] = (x1 + w + jitter(rng)) / BBOX_NORM - centerX;
+                outputX1[3 * gridSize + i] = (y1 + h + jitter(rng)) / BBOX_NORM - centerY;
+            }
+        }
+    }
+}
+
+/* Groups @objects of class @c with both implementations, false if the
+ * rectangles differ. */
+static bool
+checkClass(vector<NvDsInferObjectDetectionInfo> const &objects, unsigned int c,
+        int groupThreshold, double eps, float threshold)
+{
+    vector<cv::Rect> rects;
+    vector<NvDsInferObjectDetectionInfo> grouped;
+
+    for (auto const &object : objects)
+    {
+        if (object.classId != c)
+            continue;
+        rects.emplace_back(object.left, object.top, object.width, object.height);
+        grouped.push_back(object);
+    }
+
+    cv::groupRectangles(rects, groupThreshold, eps);
+    NvDsInferGroupRectangles(grouped, groupThreshold, eps);
+
+    if (rects.size() != grouped.size())
+    {
+        printf("class %u, group-threshold %d, eps %.2f: %zu objects instead of %zu\n",
+                c, groupThreshold, eps, grouped.size(), rects.size());
+        return false;
+    }
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        NvDsInferObjectDetectionInfo const &object = grouped[i];
+        if ((int) object.left != rects[i].x || (int) object.top != rects[i].y ||
+            (int) object.width != rects[i].width ||
+            (int) object.height != rects[i].height || object.classId != c ||
+            !(object.detectionConfidence >= threshold))
+        {
+            printf("class %u, group-threshold %d, eps %.2f: object %zu differs\n",
+                    c, groupThreshold, eps, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Func>
+static double
+timeUs(unsigned int iterations, Func func)
+{
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; i++)
+        func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int gridSize = GRID_W * GRID_H;
+    mt19937 rng(1234);
+    vector<float> coverage(NUM_CLASSES * gridSize);
+    vector<float> bbox(NUM_CLASSES * 4 * gridSize);
+    vector<NvDsInferLayerInfo> layers(2);
+    NvDsInferNetworkInfo networkInfo = { NET_WIDTH, NET_HEIGHT, 3 };
+    NvDsInferParseDetectionParams detectionParams;
+    vector<NvDsInferObjectDetectionInfo> objects;
+    FILE *coverageFile = nullptr;
+    FILE *bboxFile = nullptr;
+    unsigned int numFrames = 0;
+    bool ok = true;
+
+    if (argc == 3)
+    {
+        coverageFile = fopen(argv[1], "rb");
+        bboxFile = fopen(argv[2], "rb");
+        if (!coverageFile || !bboxFile)
+        {
+            printf("Could not open %s or %s\n", argv[1], argv[2]);
+            return -1;
+        }
+    }
+
+    detectionParams.numClassesConfigured = NUM_CLASSES;
+    detectionParams.perClassThreshold = { 0.2f, 0.2f, 0.2f, 0.2f };
+    layers[0].layerName = "conv2d_bbox";
+    layers[0].buffer = bbox.data();
+    layers[0].dims = { 3, { NUM_CLASSES * 4, GRID_H, GRID_W }, NUM_CLASSES * 4 * gridSize };
+    layers[1].layerName = "conv2d_cov/Sigmoid";
+    layers[1].buffer = coverage.data();
+    layers[1].dims = { 3, { NUM_CLASSES, GRID_H, GRID_W }, NUM_CLASSES * gridSize };
+
+    for (;;)
+    {
+        if (coverageFile)
+        {
+            if (fread(coverage.data(), sizeof(float), coverage.size(), coverageFile) !=
+                    coverage.size() ||
+                fread(bbox.data(), sizeof(float), bbox.size(), bboxFile) != bbox.size())
+                break;
+        }
+        else
+        {
+            if (numFrames == 200)
+                break;
+            fillTensors(rng, coverage, bbox, numFrames % 40);
+        }
+        numFrames++;
+
+        objects.clear();
+        NvDsInferParseCustomResnet(layers, networkInfo, detectionParams, objects);
+        for (unsigned int c = 0; c < NUM_CLASSES && ok; c++)
+        {
+            for (int groupThreshold : { 0, 1, 2, 3 })
+            {
+                for (double eps : { 0.0, 0.1, 0.2, 0.5, 1.0 })
+                {
+                    if (!checkClass(objects, c, groupThreshold, eps, 0.2f))
+                        ok = false;
+                }
+            }
+        }
+    }
+
+    if (coverageFile)
+        fclose(coverageFile);
+    if (bboxFile)
+        fclose(bboxFile);
+    if (!ok)
+    {
+        printf("FAILED in frame %u\n", numFrames - 1);
+        return -1;
+    }
+    printf("groupRectangles equivalence on %u %s frames: OK\n", numFrames,
+            coverageFile ? "recorded" : "synthetic");
+
+    /* Objects of one class: boxes around 1/8 as many objects */
+    printf("group-threshold 1, eps 0.2:\n");
+    for (unsigned int numObjects : { 100, 1000, 10000, 50000 })
+    {
+        uniform_real_distribution<float> uniform(0, 1);
+        normal_distribution<float> jitter(0, 0.03f);
+        vector<NvDsInferObjectDetectionInfo> boxes, grouped;
+        vector<cv::Rect> rects, cvGrouped;
+        unsigned int iterations = max(1u, 100000 / numObjects);
+
+        for (unsigned int o = 0; o < numObjects / 8; o++)
+        {
+            float w = 10 + uniform(rng) * 300;
+            float h = 10 + uniform(rng) * 300;
+            float x = uniform(rng) * 3840;
+            float y = uniform(rng) * 2160;
+            for (unsigned int b = 0; b < 8; b++)
+            {
+                NvDsInferObjectDetectionInfo box;
+                box.classId = 0;
+                box.left = max(0.0f, x + jitter(rng) * w);
+                box.top = max(0.0f, y + jitter(rng) * h);
+                box.width = w * (1 + jitter(rng));
+                box.height = h * (1 + jitter(rng));
+                box.detectionConfidence = uniform(rng);
+                boxes.push_back(box);
+                rects.emplace_back(box.left, box.top, box.width, box.height);
+            }
+        }
+
+        double cvUs = timeUs(iterations, [&]() {
+            cvGrouped = rects;
+            cv::groupRectangles(cvGrouped, 1, 0.2);
+        });
+        double nativeUs = timeUs(iterations, [&]() {
+            grouped = boxes;
+            NvDsInferGroupRectangles(grouped, 1, 0.2);
+        });
+        printf("  %5u objects: groupRectangles %10.1f us, native %8.1f us (%zu clusters)\n",
+                numObjects, cvUs, nativeUs, grouped.size());
+        bool same = grouped.size() == cvGrouped.size();
+        for (size_t i = 0; same && i < grouped.size(); i++)
+        {
+            same = (int) grouped[i].left == cvGrouped[i].x &&
+                (int) grouped[i].top == cvGrouped[i].y &&
+                (int) grouped[i].width == cvGrouped[i].width &&
+                (int) grouped[i].height == cvGrouped[i].height;
+        }
+        if (!same)
+        {
+            printf("FAILED\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks NvDsInferDBScanCluster against a DBSCAN comparing every pair of
+ * objects, on scenes of jittered boxes around objects of mixed sizes with
+ * noise boxes, then times both up to 10k boxes.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "nvdsinfer_dbscan.h"
+
+using namespace std;
+
+/* Neighbor predicate of nvdsinfer_dbscan.cpp. */
+static bool
+neighbors(NvDsInferObjectDetectionInfo const &a,
+        NvDsInferObjectDetectionInfo const &b, float eps)
+{
+    float aLeft = a.left, aTop = a.top, bLeft = b.left, bTop = b.top;
+    float aRight = aLeft + a.width, aBottom = aTop + a.height;
+    float bRight = bLeft + b.width, bBottom = bTop + b.height;
+    float delta = eps * (min(aRight - aLeft, bRight - bLeft) +
+            min(aBottom - aTop, bBottom - bTop)) * 0.5f;
+    return fabsf(aLeft - bLeft) <= delta && fabsf(aTop - bTop) <= delta &&
+        fabsf(aRight - bRight) <= delta && fabsf(aBottom - bBottom) <= delta;
+}
+
+/* Textbook DBSCAN: clusters grown from the core objects in object order, a
+ * border object taken by the first cluster reaching it, i.e. of its first
+ * core neighbor. */
+static vector<NvDsInferObjectDetectionInfo>
+referenceDBScan(vector<NvDsInferObjectDetectionInfo> const &objects,
+        NvDsInferDBScanClusteringParams const &params)
+{
+    size_t n = objects.size();
+    vector<vector<size_t>> adjacency(n);
+    vector<bool> core(n);
+    vector<int> cluster(n, -1);
+    int numClusters = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            if (neighbors(objects[i], objects[j], params.eps))
+                adjacency[i].push_back(j);
+        }
+        core[i] = adjacency[i].size() >= params.minBoxes;
+    }
+
+    /* Components of the core objects. */
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!core[i] || cluster[i] >= 0)
+            continue;
+        vector<size_t> stack = { i };
+        cluster[i] = numClusters;
+        while (!stack.empty())
+        {
+            size_t p = stack.back();
+            stack.pop_back();
+            for (size_t q : adjacency[p])
+            {
+                if (core[q] && cluster[q] < 0)
+                {
+                    cluster[q] = numClusters;
+                    stack.push_back(q);
+                }
+            }
+        }
+        numClusters++;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (core[i])
+            continue;
+        for (size_t q : adjacency[i])
+        {
+            if (core[q])
+            {
+                cluster[i] = cluster[q];
+                break;
+            }
+        }
+    }
+
+    /* Averages, in the order of the first object of each cluster. */
+    vector<int> order(numClusters, -1);
+    vector<vector<uint64_t>> sums;
+    vector<NvDsInferObjectDetectionInfo> first;
+    vector<unsigned int> counts;
+    for (size_t i = 0; i < n; i++)
+    {
+        int c = cluster[i];
+        if (c < 0)
+            continue;
+        if (order[c] < 0)
+        {
+            order[c] = sums.size();
+            sums.push_back(vector<uint64_t>(4));
+            first.push_back(objects[i]);
+            counts.push_back(0);
+        }
+        vector<uint64_t> &sum = sums[order[c]];
+        sum[0] += objects[i].left;
+        sum[1] += objects[i].top;
+        sum[2] += objects[i].width;
+        sum[3] += objects[i].height;
+        first[order[c]].detectionConfidence = max(
+                first[order[c]].detectionConfidence,
+                objects[i].detectionConfidence);
+        counts[order[c]]++;
+    }
+
+    vector<NvDsInferObjectDetectionInfo> output;
+    for (size_t c = 0; c < sums.size(); c++)
+    {
+        NvDsInferObjectDetectionInfo object = first[c];
+        object.left = lrint((double) sums[c][0] / counts[c]);
+        object.top = lrint((double) sums[c][1] / counts[c]);
+        object.width = lrint((double) sums[c][2] / counts[c]);
+        object.height = lrint((double) sums[c][3] / counts[c]);
+        if (params.enableATHRFilter &&
+            sqrtf((float) object.width * object.height) / counts[c] > params.thresholdATHR)
+            continue;
+        output.push_back(object);
+    }
+    return output;
+}
+
+/* Pixel coordinate of a box. */
+static unsigned int
+pixel(float x)
+{
+    return x > 0 ? (unsigned int) lrintf(x) : 0;
+}
+
+/* @numObjects objects of 10 to 400 pixels, each detected as a few jittered
+ * boxes, and as many noise boxes. */
+static void
+fillScene(mt19937 &rng, vector<NvDsInferObjectDetectionInfo> &boxes,
+        unsigned int numObjects)
+{
+    uniform_real_distribution<float> uniform(0, 1);
+    normal_distribution<float> jitter(0, 1);
+
+    boxes.clear();
+    for (unsigned int o = 0; o < numObjects; o++)
+    {
+        float w = 10 + 390 * uniform(rng) * uniform(rng);
+        float h = w * (0.5f + uniform(rng));
+        float x = uniform(rng) * 4000, y = uniform(rng) * 2000;
+        unsigned int numBoxes = 1 + rng() % 8;
+        for (unsigned int b = 0; b < numBoxes; b++)
+        {
+            float s = 0.05f * w;
+            boxes.push_back({ 0, pixel(x + s * jitter(rng)),
+                    pixel(y + s * jitter(rng)), pixel(w + s * jitter(rng)),
+                    pixel(h + s * jitter(rng)), uniform(rng) });
+        }
+        boxes.push_back({ 0, pixel(uniform(rng) * 4000),
+                pixel(uniform(rng) * 2000), pixel(10 + uniform(rng) * 100),
+                pixel(10 + uniform(rng) * 100), uniform(rng) });
+    }
+}
+
+static bool
+sameObjects(NvDsInferObjectDetectionInfo const *a, size_t numA,
+        vector<NvDsInferObjectDetectionInfo> const &b)
+{
+    if (numA != b.size())
+        return false;
+    for (size_t i = 0; i < numA; i++)
+    {
+        if (a[i].classId != b[i].classId || a[i].left != b[i].left ||
+            a[i].top != b[i].top || a[i].width != b[i].width ||
+            a[i].height != b[i].height ||
+            a[i].detectionConfidence != b[i].detectionConfidence)
+            return false;
+    }
+    return true;
+}
+
+template <typename Func>
+static double
+timeUs(unsigned int iterations, Func func)
+{
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; i++)
+        func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    mt19937 rng(1234);
+    NvDsInferDBScanHandle handle = NvDsInferDBScanCreate();
+    vector<NvDsInferObjectDetectionInfo> boxes, clustered;
+    bool ok = true;
+
+    for (unsigned int numObjects : { 0u, 1u, 5u, 50u, 300u })
+    {
+        for (float eps : { 0.0f, 0.2f, 0.7f })
+        {
+            for (unsigned int minBoxes : { 0u, 1u, 3u })
+            {
+                for (int athr : { 0, 1 })
+                {
+                    NvDsInferDBScanClusteringParams params = { eps, minBoxes,
+                        athr, 60.0f };
+                    fillScene(rng, boxes, numObjects);
+                    /* Identical boxes */
+                    if (numObjects == 5)
+                        boxes.insert(boxes.end(), 4, boxes[0]);
+
+                    vector<NvDsInferObjectDetectionInfo> expected =
+                        referenceDBScan(boxes, params);
+                    clustered = boxes;
+                    size_t numClustered = clustered.size();
+                    NvDsInferDBScanCluster(handle, &params, clustered.data(),
+                            &numClustered);
+                    if (!sameObjects(clustered.data(), numClustered, expected))
+                    {
+                        printf("%zu boxes, eps %.1f, minBoxes %u, ATHR %d: "
+                                "%zu clusters instead of %zu or different\n",
+                                boxes.size(), eps, minBoxes, athr, numClustered,
+                                expected.size());
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    if (!ok)
+    {
+        printf("FAILED\n");
+        NvDsInferDBScanDestroy(handle);
+        return -1;
+    }
+    printf("DBSCAN equivalence: OK\n");
+
+    NvDsInferDBScanClusteringParams params = { 0.2f, 3, 1, 60.0f };
+    for (unsigned int numObjects : { 20u, 180u, 1820u })
+    {
+        fillScene(rng, boxes, numObjects);
+        unsigned int iterations = max(1u, 2000000u / (numObjects * numObjects));
+        size_t numClustered = 0;
+
+        double referenceUs = timeUs(max(1u, iterations / 10), [&]() {
+            referenceDBScan(boxes, params);
+        });
+        double treeUs = timeUs(iterations, [&]() {
+            clustered = boxes;
+            numClustered = clustered.size();
+            NvDsInferDBScanCluster(handle, &params, clustered.data(),
+                    &numClustered);
+        });
+        printf("%6zu boxes -> %5zu: pairwise %10.1f us, 2-d tree %8.1f us\n",
+                boxes.size(), numClustered, referenceUs, treeUs);
+    }
+
+    NvDsInferDBScanDestroy(handle);
+    return 0;
+}
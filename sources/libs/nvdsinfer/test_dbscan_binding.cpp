@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks that a library built with nvdsinfer_dbscan.cpp calls its own DBSCAN
+ * even when a library loaded before it, as libnvds_inferutils can be, exports
+ * the same NvDsInferDBScan* names.
+ *
+ * Built three times by Makefile.test:
+ *  - with DBSCAN_BINDING_INFERUTILS, a stand-in for libnvds_inferutils
+ *    counting the calls to its NvDsInferDBScan* functions;
+ *  - with DBSCAN_BINDING_CALLER, added to nvdsinfer_dbscan.cpp in a stand-in
+ *    for libnvds_infer, calling the functions from another translation unit
+ *    as nvdsinfer_context_impl*.cpp do;
+ *  - without either, the application linked with the stand-in
+ *    libnvds_inferutils first.
+ */
+
+#include <cstdio>
+
+#include "nvdsinfer_dbscan.h"
+
+/* Counts the calls to the NvDsInferDBScan* functions of the libnvds_inferutils
+ * stand-in. */
+extern "C" unsigned int testInferUtilsDBScanCalls();
+
+/* Creates a handle, clusters objects and destroys the handle in the
+ * libnvds_infer stand-in, returning the number of output objects. */
+extern "C" size_t testInferDBScanCluster(NvDsInferObjectDetectionInfo *objects,
+        size_t numObjects);
+
+#if defined(DBSCAN_BINDING_INFERUTILS)
+
+static unsigned int calls = 0;
+
+NvDsInferDBScanHandle
+NvDsInferDBScanCreate()
+{
+    calls++;
+    return nullptr;
+}
+
+void
+NvDsInferDBScanDestroy(NvDsInferDBScanHandle handle)
+{
+    calls++;
+}
+
+void
+NvDsInferDBScanCluster(NvDsInferDBScanHandle handle,
+        NvDsInferDBScanClusteringParams *params,
+        NvDsInferObjectDetectionInfo *objects, size_t *numObjects)
+{
+    calls++;
+}
+
+unsigned int
+testInferUtilsDBScanCalls()
+{
+    return calls;
+}
+
+#elif defined(DBSCAN_BINDING_CALLER)
+
+size_t
+testInferDBScanCluster(NvDsInferObjectDetectionInfo *objects,
+        size_t numObjects)
+{
+    NvDsInferDBScanClusteringParams params = { 0.2f, 2, 0, 0.0f };
+    NvDsInferDBScanHandle handle = NvDsInferDBScanCreate();
+    if (!handle)
+        return 0;
+    NvDsInferDBScanCluster(handle, &params, objects, &numObjects);
+    NvDsInferDBScanDestroy(handle);
+    return numObjects;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+    /* Two overlapping boxes clustered into one, a noise box dropped. */
+    NvDsInferObjectDetectionInfo objects[3] = {
+        { 0, 100, 100, 50, 50, 0.5f },
+        { 0, 102, 101, 50, 50, 0.6f },
+        { 0, 400, 300, 20, 20, 0.7f },
+    };
+    size_t numClustered = testInferDBScanCluster(objects, 3);
+    unsigned int inferUtilsCalls = testInferUtilsDBScanCalls();
+
+    if (inferUtilsCalls != 0 || numClustered != 1)
+    {
+        printf("FAILED: %u calls to the libnvds_inferutils DBSCAN, "
+                "%zu objects instead of 1\n", inferUtilsCalls, numClustered);
+        return 1;
+    }
+    printf("PASSED: the in-tree DBSCAN is called\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,281 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Times the output parsing of batches of resnet10 detector frames, as done by
+ * dequeueOutputBatch, with 1 to 8 parse workers (output-parse-workers) and
+ * checks that the objects do not depend on the number of workers.
+ *
+ * Usage: test_parse_workers [batch-size [coverage.bin bbox.bin]]
+ *
+ * The tensors are synthetic unless recorded ones are given, in the format of
+ * test_cluster: raw float32 dumps of consecutive frames of the
+ * conv2d_cov/Sigmoid (4x34x60) and conv2d_bbox (16x34x60) layers.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_cluster.h"
+#include "nvdsinfer_parse_pool.h"
+
+/* Resnet10 sample model at 960x544 */
+#define NET_WIDTH 960
+#define NET_HEIGHT 544
+#define GRID_W 60
+#define GRID_H 34
+#define GRID_STRIDE 16
+#define BBOX_NORM 35.0f
+#define NUM_CLASSES 4
+
+/* Grouping of the sample configs */
+#define GROUP_THRESHOLD 1
+#define EPS 0.2
+
+using namespace std;
+
+extern "C"
+bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+typedef struct
+{
+    vector<float> coverage;
+    vector<float> bbox;
+} Frame;
+
+/* Parsing state of a worker, as NvDsInferParseScratch of the context. */
+typedef struct
+{
+    vector<NvDsInferLayerInfo> layers;
+    vector<NvDsInferObjectDetectionInfo> objects;
+    vector<vector<NvDsInferObjectDetectionInfo>> perClassObjects;
+} Scratch;
+
+/* Tensors of a frame with @numObjects objects, each covering the cells
+ * around its center with jittered box regressions. */
+static void
+fillTensors(mt19937 &rng, Frame &frame, unsigned int numObjects)
+{
+    uniform_real_distribution<float> uniform(0, 1);
+    normal_distribution<float> jitter(0, 3);
+    unsigned int gridSize = GRID_W * GRID_H;
+
+    frame.coverage.resize(NUM_CLASSES * gridSize);
+    frame.bbox.resize(NUM_CLASSES * 4 * gridSize);
+    for (float &c : frame.coverage)
+        c = uniform(rng) * 0.1f;
+    for (float &b : frame.bbox)
+        b = uniform(rng);
+
+    for (unsigned int o = 0; o < numObjects; o++)
+    {
+        unsigned int c = rng() % NUM_CLASSES;
+        float w = 20 + uniform(rng) * 200;
+        float h = 20 + uniform(rng) * 200;
+        float x1 = uniform(rng) * (NET_WIDTH - w);
+        float y1 = uniform(rng) * (NET_HEIGHT - h);
+        int cx = (x1 + w / 2) / GRID_STRIDE;
+        int cy = (y1 + h / 2) / GRID_STRIDE;
+        int rx = 1 + w / GRID_STRIDE / 4;
+        int ry = 1 + h / GRID_STRIDE / 4;
+
+        for (int gy = max(0, cy - ry); gy <= min(GRID_H - 1, cy + ry); gy++)
+        {
+            for (int gx = max(0, cx - rx); gx <= min(GRID_W - 1, cx + rx); gx++)
+            {
+                unsigned int i = gx + gy * GRID_W;
+                float centerX = (gx * GRID_STRIDE + 0.5f) / BBOX_NORM;
+                float centerY = (gy * GRID_STRIDE + 0.5f) / BBOX_NORM;
+                float *outputX1 = frame.bbox.data() + c * 4 * gridSize;
+
+                frame.coverage[c * gridSize + i] = 0.3f + uniform(rng) * 0.7f;
+                outputX1[i] = centerX - (x1 + jitter(rng)) / BBOX_NORM;
+                outputX1[gridSize + i] = centerY - (y1 + jitter(rng)) / BBOX_NORM;
+                outputX1[2 * gridSize + i] = (x1 + w + jitter(rng)) / BBOX_NORM - centerX;
+                outputX1[3 * gridSize + i] = (y1 + h + jitter(rng)) / BBOX_NORM - centerY;
+            }
+        }
+    }
+}
+
+/* Parses and clusters a frame, as fillDetectionOutput with cluster-mode=2. */
+static void
+parseFrame(Scratch &scratch, Frame &frame,
+        NvDsInferParseDetectionParams const &detectionParams,
+        vector<NvDsInferObjectDetectionInfo> &output)
+{
+    static const NvDsInferNetworkInfo networkInfo = { NET_WIDTH, NET_HEIGHT, 3 };
+
+    scratch.layers[0].buffer = frame.bbox.data();
+    scratch.layers[1].buffer = frame.coverage.data();
+    scratch.objects.clear();
+    NvDsInferParseCustomResnet(scratch.layers, networkInfo, detectionParams,
+            scratch.objects);
+
+    for (auto &list : scratch.perClassObjects)
+        list.clear();
+    for (auto const &object : scratch.objects)
+        scratch.perClassObjects[object.classId].push_back(object);
+
+    output.clear();
+    for (auto &list : scratch.perClassObjects)
+    {
+        NvDsInferGroupRectangles(list, GROUP_THRESHOLD, EPS);
+        output.insert(output.end(), list.begin(), list.end());
+    }
+}
+
+static bool
+sameObjects(vector<NvDsInferObjectDetectionInfo> const &a,
+        vector<NvDsInferObjectDetectionInfo> const &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].classId != b[i].classId || a[i].left != b[i].left ||
+            a[i].top != b[i].top || a[i].width != b[i].width ||
+            a[i].height != b[i].height ||
+            a[i].detectionConfidence != b[i].detectionConfidence)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int gridSize = GRID_W * GRID_H;
+    unsigned int batchSize = argc > 1 ? atoi(argv[1]) : 16;
+    mt19937 rng(1234);
+    vector<Frame> frames;
+    NvDsInferParseDetectionParams detectionParams;
+    vector<NvDsInferLayerInfo> layers(2);
+
+    if (batchSize == 0)
+    {
+        printf("Usage: %s [batch-size [coverage.bin bbox.bin]]\n", argv[0]);
+        return -1;
+    }
+
+    if (argc == 4)
+    {
+        FILE *coverageFile = fopen(argv[2], "rb");
+        FILE *bboxFile = fopen(argv[3], "rb");
+        if (!coverageFile || !bboxFile)
+        {
+            printf("Could not open %s or %s\n", argv[2], argv[3]);
+            return -1;
+        }
+        for (;;)
+        {
+            Frame frame;
+            frame.coverage.resize(NUM_CLASSES * gridSize);
+            frame.bbox.resize(NUM_CLASSES * 4 * gridSize);
+            if (fread(frame.coverage.data(), sizeof(float), frame.coverage.size(),
+                        coverageFile) != frame.coverage.size() ||
+                fread(frame.bbox.data(), sizeof(float), frame.bbox.size(),
+                        bboxFile) != frame.bbox.size())
+                break;
+            frames.push_back(frame);
+        }
+        fclose(coverageFile);
+        fclose(bboxFile);
+        if (frames.empty())
+        {
+            printf("No frame in %s and %s\n", argv[2], argv[3]);
+            return -1;
+        }
+    }
+    else
+    {
+        frames.resize(64);
+        for (unsigned int f = 0; f < frames.size(); f++)
+            fillTensors(rng, frames[f], 10 + f % 40);
+    }
+
+    detectionParams.numClassesConfigured = NUM_CLASSES;
+    detectionParams.perClassThreshold = { 0.2f, 0.2f, 0.2f, 0.2f };
+    layers[0].layerName = "conv2d_bbox";
+    layers[0].dims = { 3, { NUM_CLASSES * 4, GRID_H, GRID_W }, NUM_CLASSES * 4 * gridSize };
+    layers[1].layerName = "conv2d_cov/Sigmoid";
+    layers[1].dims = { 3, { NUM_CLASSES, GRID_H, GRID_W }, NUM_CLASSES * gridSize };
+
+    /* Reference objects of each frame, parsed one by one. */
+    vector<vector<NvDsInferObjectDetectionInfo>> expected(frames.size());
+    {
+        Scratch scratch = { layers, {}, vector<vector<NvDsInferObjectDetectionInfo>>(NUM_CLASSES) };
+        for (size_t f = 0; f < frames.size(); f++)
+            parseFrame(scratch, frames[f], detectionParams, expected[f]);
+    }
+
+    unsigned int numBatches = (frames.size() + batchSize - 1) / batchSize;
+    unsigned int iterations = max(1u, 20000 / (numBatches * batchSize));
+    double sequentialUs = 0;
+
+    printf("%zu %s frames, batches of %u:\n", frames.size(),
+            argc == 4 ? "recorded" : "synthetic", batchSize);
+    for (unsigned int numWorkers : { 1, 2, 4, 8 })
+    {
+        if (numWorkers > batchSize)
+            break;
+
+        NvDsInferParsePool pool(numWorkers);
+        vector<Scratch> scratch(numWorkers,
+                { layers, {}, vector<vector<NvDsInferObjectDetectionInfo>>(NUM_CLASSES) });
+        vector<vector<NvDsInferObjectDetectionInfo>> outputs(batchSize);
+        bool ok = true;
+
+        auto start = chrono::steady_clock::now();
+        for (unsigned int it = 0; it < iterations; it++)
+        {
+            for (unsigned int b = 0; b < numBatches; b++)
+            {
+                /* The last batch wraps around to the first frames. */
+                pool.run(batchSize, [&](unsigned int index, unsigned int worker) {
+                    size_t f = (b * batchSize + index) % frames.size();
+                    parseFrame(scratch[worker], frames[f], detectionParams,
+                            outputs[index]);
+                });
+
+                if (it > 0)
+                    continue;
+                for (unsigned int index = 0; index < batchSize; index++)
+                {
+                    if (!sameObjects(outputs[index],
+                                expected[(b * batchSize + index) % frames.size()]))
+                        ok = false;
+                }
+            }
+        }
+        auto end = chrono::steady_clock::now();
+
+        if (!ok)
+        {
+            printf("FAILED: objects differ with %u workers\n", numWorkers);
+            return -1;
+        }
+
+        double batchUs = chrono::duration<double, micro>(end - start).count() /
+            (iterations * numBatches);
+        if (numWorkers == 1)
+            sequentialUs = batchUs;
+        printf("  %u workers: %8.1f us per batch, x%.2f\n", numWorkers, batchUs,
+                sequentialUs / batchUs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks the ordering and counters of NvDsInferIndexQueue, then times batches
+ * going through pipelines of three threads and two queues sharing a mutex, as
+ * in nvinfer and NvDsInferContextImpl, for 1 to 16 instances: with a
+ * condition per queue signalled on push, and with one condition broadcast on
+ * every push and pop as before.
+ *
+ * Usage: test_queue [numBatches]
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nvdsinfer_index_queue.h"
+
+using namespace std;
+
+/* A producer pushes 0 to count - 1 in order. */
+static bool
+testOrder(unsigned int count)
+{
+    mutex queueMutex;
+    NvDsInferIndexQueue queue;
+    thread producer([&]() {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queue.push(i);
+        }
+    });
+    bool ok = true;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unique_lock<mutex> lock(queueMutex);
+        unsigned int index = queue.pop(lock);
+        if (index != i)
+        {
+            printf("FAILED: index %u popped instead of %u\n", index, i);
+            ok = false;
+            break;
+        }
+    }
+    producer.join();
+
+    NvDsInferIndexQueueStats const &stats = queue.stats();
+    if (ok && (stats.pushed != count || !queue.empty() ||
+                stats.maxDepth == 0 || stats.maxDepth > count))
+    {
+        printf("FAILED: %lu pushed, max depth %u\n",
+                (unsigned long) stats.pushed, stats.maxDepth);
+        ok = false;
+    }
+    return ok;
+}
+
+/* A pop on an empty queue is counted as a wait of about the time until the
+ * push. */
+static bool
+testWaitCounters()
+{
+    mutex queueMutex;
+    NvDsInferIndexQueue queue;
+    thread producer([&]() {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        unique_lock<mutex> lock(queueMutex);
+        queue.push(7);
+    });
+    unsigned int index;
+    {
+        unique_lock<mutex> lock(queueMutex);
+        index = queue.pop(lock);
+    }
+    producer.join();
+
+    NvDsInferIndexQueueStats const &stats = queue.stats();
+    if (index != 7 || stats.popWaits != 1 || stats.popWaitNs < 10000000)
+    {
+        printf("FAILED: index %u, %lu pop waits of %lu ns\n", index,
+                (unsigned long) stats.popWaits,
+                (unsigned long) stats.popWaitNs);
+        return false;
+    }
+    return true;
+}
+
+/* Two queues sharing one mutex. */
+class Queues
+{
+public:
+    virtual ~Queues() {}
+    virtual void push(unsigned int q, unsigned int index) = 0;
+    virtual unsigned int pop(unsigned int q) = 0;
+};
+
+/* With NvDsInferIndexQueue: a condition per queue, signalled on push. */
+class SignalQueues : public Queues
+{
+public:
+    void push(unsigned int q, unsigned int index) override
+    {
+        unique_lock<mutex> lock(m_Mutex);
+        m_Queues[q].push(index);
+    }
+    unsigned int pop(unsigned int q) override
+    {
+        unique_lock<mutex> lock(m_Mutex);
+        return m_Queues[q].pop(lock);
+    }
+    NvDsInferIndexQueueStats const &stats(unsigned int q) const
+    {
+        return m_Queues[q].stats();
+    }
+private:
+    mutex m_Mutex;
+    NvDsInferIndexQueue m_Queues[2];
+};
+
+/* As before: one condition broadcast on every push and pop, waking the
+ * threads waiting on either queue. */
+class BroadcastQueues : public Queues
+{
+public:
+    void push(unsigned int q, unsigned int index) override
+    {
+        unique_lock<mutex> lock(m_Mutex);
+        m_Queues[q].push_back(index);
+        m_Condition.notify_all();
+    }
+    unsigned int pop(unsigned int q) override
+    {
+        unique_lock<mutex> lock(m_Mutex);
+        while (m_Queues[q].empty())
+            m_Condition.wait(lock);
+        unsigned int index = m_Queues[q].front();
+        m_Queues[q].pop_front();
+        m_Condition.notify_all();
+        return index;
+    }
+private:
+    mutex m_Mutex;
+    condition_variable m_Condition;
+    deque<unsigned int> m_Queues[2];
+};
+
+/* Source thread -> queue 0 -> input thread -> queue 1 -> output thread, for
+ * each instance; returns the time per batch in microseconds. */
+static double
+timePipelines(unsigned int numInstances, unsigned int numBatches,
+        bool broadcast)
+{
+    vector<unique_ptr<Queues>> queues;
+    for (unsigned int n = 0; n < numInstances; n++)
+    {
+        if (broadcast)
+            queues.emplace_back(new BroadcastQueues);
+        else
+            queues.emplace_back(new SignalQueues);
+    }
+
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (unsigned int n = 0; n < numInstances; n++)
+    {
+        Queues *q = queues[n].get();
+        threads.emplace_back([=]() {
+            for (unsigned int b = 0; b < numBatches; b++)
+                q->push(0, b);
+        });
+        threads.emplace_back([=]() {
+            for (unsigned int b = 0; b < numBatches; b++)
+                q->push(1, q->pop(0));
+        });
+        threads.emplace_back([=]() {
+            for (unsigned int b = 0; b < numBatches; b++)
+                q->pop(1);
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    double us = chrono::duration<double, micro>(
+            chrono::steady_clock::now() - start).count();
+
+    if (!broadcast && numInstances == 1)
+    {
+        const char *names[] = { "input", "process" };
+        SignalQueues *q = static_cast<SignalQueues *>(queues[0].get());
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            NvDsInferIndexQueueStats const &stats = q->stats(i);
+            printf("  %s queue: max depth %u, %lu pops waited %.1f ms\n",
+                    names[i], stats.maxDepth, (unsigned long) stats.popWaits,
+                    stats.popWaitNs / 1e6);
+        }
+    }
+    return us / ((double) numInstances * numBatches);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int numBatches = argc > 1 ? atoi(argv[1]) : 20000;
+    bool ok = testOrder(200000) && testWaitCounters();
+    if (ok)
+        printf("Queue ordering and counters: OK\n");
+
+    for (unsigned int numInstances : { 1, 4, 16 })
+    {
+        double broadcastUs = timePipelines(numInstances, numBatches, true);
+        double signalUs = timePipelines(numInstances, numBatches, false);
+        printf("%2u pipelines: %.2f us per batch with a broadcast condition, "
+                "%.2f us with a signalled condition per queue\n",
+                numInstances, broadcastUs, signalUs);
+    }
+
+    if (!ok)
+    {
+        printf("FAILED\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Checks NvDsInferSegmentationArgmax against the per pixel loop of
+ * fillSegmentationOutput for each supported instruction set, with the
+ * downsampled and run-length encoded maps, then times them at 512x512x20 and
+ * 1024x2048x19.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "nvdsinfer_segmentation.h"
+
+using namespace std;
+
+/* Class map as computed by fillSegmentationOutput before. */
+static void
+referenceArgmax(const float *probabilities, unsigned int width,
+        unsigned int height, unsigned int classes, float threshold, int *classMap)
+{
+    for (unsigned int y = 0; y < height; y++)
+    {
+        for (unsigned int x = 0; x < width; x++)
+        {
+            float max_prob = -1;
+            int &cls = classMap[y * width + x] = -1;
+            for (unsigned int c = 0; c < classes; c++)
+            {
+                float prob = probabilities[c * width * height + y * width + x];
+                if (prob > max_prob && prob > threshold)
+                {
+                    cls = c;
+                    max_prob = prob;
+                }
+            }
+        }
+    }
+}
+
+/* Square blobs of classes over quantized noise, so that ties occur. */
+static void
+fillProbabilities(mt19937 &rng, vector<float> &probabilities,
+        unsigned int width, unsigned int height, unsigned int classes)
+{
+    uniform_real_distribution<float> uniform(0, 1);
+    size_t planeSize = (size_t) width * height;
+
+    probabilities.resize(planeSize * classes);
+    for (float &p : probabilities)
+        p = (int) (uniform(rng) * 16) / 64.0f;
+    for (unsigned int b = 0; b < 50; b++)
+    {
+        unsigned int c = rng() % classes;
+        unsigned int cx = rng() % width, cy = rng() % height;
+        unsigned int r = 4 + rng() % (width / 8 + 1);
+        float p = 0.5f + uniform(rng) / 2;
+        for (unsigned int y = cy > r ? cy - r : 0; y < min(height, cy + r); y++)
+        {
+            for (unsigned int x = cx > r ? cx - r : 0; x < min(width, cx + r); x++)
+                probabilities[c * planeSize + y * width + x] = p;
+        }
+    }
+}
+
+static bool
+check(vector<float> const &probabilities, unsigned int width,
+        unsigned int height, unsigned int classes, float threshold)
+{
+    size_t planeSize = (size_t) width * height;
+    vector<int> expected(planeSize), classMap(planeSize), runs;
+
+    referenceArgmax(probabilities.data(), width, height, classes, threshold,
+            expected.data());
+
+    for (NvDsInferGridIsa isa : { NVDSINFER_GRID_ISA_SCALAR,
+            NVDSINFER_GRID_ISA_AVX2, NVDSINFER_GRID_ISA_NEON })
+    {
+        if (!NvDsInferGridIsaSupported(isa))
+            continue;
+        NvDsInferSegmentationArgmax(probabilities.data(), width, height,
+                classes, threshold, 1, classMap.data(), isa);
+        if (classMap != expected)
+        {
+            printf("%ux%ux%u threshold %.2f: class map differs with isa %d\n",
+                    width, height, classes, threshold, isa);
+            return false;
+        }
+    }
+
+    for (unsigned int scale : { 2, 3, 4, 8 })
+    {
+        unsigned int mapWidth = NvDsInferSegmentationMapDim(width, scale);
+        unsigned int mapHeight = NvDsInferSegmentationMapDim(height, scale);
+        NvDsInferSegmentationArgmax(probabilities.data(), width, height,
+                classes, threshold, scale, classMap.data());
+        for (unsigned int y = 0; y < mapHeight; y++)
+        {
+            for (unsigned int x = 0; x < mapWidth; x++)
+            {
+                unsigned int sx = min(x * scale + scale / 2, width - 1);
+                unsigned int sy = min(y * scale + scale / 2, height - 1);
+                if (classMap[y * mapWidth + x] != expected[sy * width + sx])
+                {
+                    printf("%ux%ux%u: downsampled map differs at scale %u\n",
+                            width, height, classes, scale);
+                    return false;
+                }
+            }
+        }
+    }
+
+    unsigned int numRuns = NvDsInferSegmentationEncodeRuns(expected.data(),
+            planeSize, runs);
+    size_t pixel = 0;
+    for (unsigned int r = 0; r < numRuns; r++)
+    {
+        for (int i = 0; i < runs[2 * r + 1]; i++)
+        {
+            if (pixel >= planeSize || expected[pixel++] != runs[2 * r])
+            {
+                printf("%ux%ux%u: runs do not decode to the map\n", width,
+                        height, classes);
+                return false;
+            }
+        }
+    }
+    return pixel == planeSize;
+}
+
+template <typename Func>
+static double
+timeUs(unsigned int iterations, Func func)
+{
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; i++)
+        func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    mt19937 rng(1234);
+    vector<float> probabilities;
+    bool ok = true;
+
+    /* Odd sizes exercise the ends of the tiles and vectors. */
+    for (auto const &size : { make_pair(1u, 1u), make_pair(7u, 3u),
+            make_pair(33u, 17u), make_pair(125u, 61u), make_pair(512u, 512u) })
+    {
+        for (unsigned int classes : { 1u, 4u, 20u })
+        {
+            fillProbabilities(rng, probabilities, size.first, size.second, classes);
+            for (float threshold : { 0.0f, 0.2f, 0.5f, 2.0f })
+                ok = ok && check(probabilities, size.first, size.second,
+                        classes, threshold);
+        }
+    }
+    if (!ok)
+    {
+        printf("FAILED\n");
+        return -1;
+    }
+    printf("Segmentation argmax equivalence: OK\n");
+
+    struct { unsigned int width, height, classes; } sizes[] = {
+        { 512, 512, 20 }, { 2048, 1024, 19 } };
+    for (auto const &size : sizes)
+    {
+        size_t planeSize = (size_t) size.width * size.height;
+        vector<int> classMap(planeSize), runs;
+        unsigned int iterations = max(1u, (unsigned int) (100000000 /
+                    (planeSize * size.classes)));
+
+        fillProbabilities(rng, probabilities, size.width, size.height, size.classes);
+        printf("%ux%ux%u:\n", size.width, size.height, size.classes);
+        printf("  per pixel loop   %9.1f us\n", timeUs(iterations, [&]() {
+            referenceArgmax(probabilities.data(), size.width, size.height,
+                    size.classes, 0.5f, classMap.data());
+        }));
+        for (NvDsInferGridIsa isa : { NVDSINFER_GRID_ISA_SCALAR,
+                NVDSINFER_GRID_ISA_AVX2, NVDSINFER_GRID_ISA_NEON })
+        {
+            if (!NvDsInferGridIsaSupported(isa))
+                continue;
+            printf("  tiled (isa %d)    %9.1f us\n", isa, timeUs(iterations, [&]() {
+                NvDsInferSegmentationArgmax(probabilities.data(), size.width,
+                        size.height, size.classes, 0.5f, 1, classMap.data(), isa);
+            }));
+        }
+        printf("  downsampled x4   %9.1f us\n", timeUs(iterations, [&]() {
+            NvDsInferSegmentationArgmax(probabilities.data(), size.width,
+                    size.height, size.classes, 0.5f, 4, classMap.data());
+        }));
+        NvDsInferSegmentationArgmax(probabilities.data(), size.width,
+                size.height, size.classes, 0.5f, 1, classMap.data());
+        unsigned int numRuns = 0;
+        double rleUs = timeUs(iterations, [&]() {
+            numRuns = NvDsInferSegmentationEncodeRuns(classMap.data(),
+                    planeSize, runs);
+        });
+        printf("  run-length encode %8.1f us, %u runs (%.1f%% of the map size)\n",
+                rleUs, numRuns, 100.0 * numRuns * 2 / planeSize);
+    }
+
+    return 0;
+}
@@ -0,0 +1,331 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Writes batches of resnet10 sized tensors to a capture file and checks that
+ * the reader gives back the frames and tensors of each batch, ignores a
+ * truncated last batch and that NvDsInferTensorReplay serves the captured
+ * frames. Then times queueing a batch for the writer thread against writing
+ * a file per layer as raw-output-file-write does.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "nvdsinfer_tensor_capture.h"
+#include "nvdsinfer_tensor_replay.h"
+
+using namespace std;
+
+static const unsigned int kUniqueID = 1;
+static const unsigned int kMaxBatchSize = 4;
+
+static vector<NvDsInferLayerInfo>
+resnetLayers()
+{
+    NvDsInferLayerInfo input = { FLOAT, { 3, { 3, 368, 640 }, 3 * 368 * 640 },
+        0, "input_1", nullptr, 1 };
+    NvDsInferLayerInfo bbox = { FLOAT, { 3, { 16, 23, 40 }, 16 * 23 * 40 },
+        1, "conv2d_bbox", nullptr, 0 };
+    NvDsInferLayerInfo cov = { HALF, { 3, { 4, 23, 40 }, 4 * 23 * 40 },
+        2, "conv2d_cov/Sigmoid", nullptr, 0 };
+    return { input, bbox, cov };
+}
+
+static size_t
+frameSize(NvDsInferLayerInfo const &layer)
+{
+    return layer.dims.numElements * (layer.dataType == HALF ? 2 : 4);
+}
+
+/* Byte of a frame of a layer of a batch. */
+static uint8_t
+tensorByte(unsigned int batch, unsigned int layer, size_t offset)
+{
+    return (uint8_t) (batch * 31 + layer * 7 + offset % 251);
+}
+
+static NvDsInferTensorCaptureFrameInfo
+frameInfo(unsigned int batch, unsigned int frame)
+{
+    NvDsInferTensorCaptureFrameInfo info;
+    info.pts = (uint64_t) batch * 33333333 + frame;
+    info.objectId = (uint64_t) -1;
+    info.sourceId = frame;
+    info.frameNum = batch;
+    return info;
+}
+
+static unsigned int
+batchSize(unsigned int batch)
+{
+    return batch % kMaxBatchSize + 1;
+}
+
+static bool
+fileSize(string const &path, long &size)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    char dirTemplate[] = "/tmp/test_tensor_capture.XXXXXX";
+    if (!mkdtemp(dirTemplate))
+    {
+        printf("FAILED: cannot create a temporary directory\n");
+        return -1;
+    }
+    string dir = dirTemplate;
+    string path = dir + "/capture.bin";
+    vector<NvDsInferLayerInfo> layers = resnetLayers();
+    const unsigned int numBatches = 10;
+    bool ok = true;
+
+    /* Batch 3 without its input tensors. */
+    vector<vector<uint8_t>> tensors(layers.size());
+    for (unsigned int l = 0; l < layers.size(); l++)
+        tensors[l].resize(kMaxBatchSize * frameSize(layers[l]));
+    NvDsInferTensorCaptureWriterHandle writer =
+        NvDsInferTensorCaptureWriterCreate(path.c_str(), kUniqueID,
+                layers.data(), layers.size(), numBatches);
+    if (!writer)
+    {
+        printf("FAILED: cannot create %s\n", path.c_str());
+        return -1;
+    }
+    for (unsigned int b = 0; b < numBatches; b++)
+    {
+        vector<NvDsInferTensorCaptureFrameInfo> frames;
+        void *buffers[3];
+        for (unsigned int f = 0; f < batchSize(b); f++)
+            frames.push_back(frameInfo(b, f));
+        for (unsigned int l = 0; l < layers.size(); l++)
+        {
+            for (size_t i = 0; i < tensors[l].size(); i++)
+                tensors[l][i] = tensorByte(b, l, i);
+            buffers[l] = (l == 0 && b == 3) ? nullptr : tensors[l].data();
+        }
+        if (!NvDsInferTensorCaptureWriterQueueBatch(writer, frames.data(),
+                    frames.size(), buffers))
+        {
+            printf("FAILED: batch %u dropped\n", b);
+            ok = false;
+        }
+    }
+    NvDsInferTensorCaptureWriterDestroy(writer);
+
+    NvDsInferTensorCaptureReaderHandle reader =
+        NvDsInferTensorCaptureReaderOpen(path.c_str());
+    const NvDsInferLayerInfo *readLayers = nullptr;
+    if (!reader ||
+            NvDsInferTensorCaptureReaderGetUniqueID(reader) != kUniqueID ||
+            NvDsInferTensorCaptureReaderGetLayers(reader, &readLayers) != 3 ||
+            NvDsInferTensorCaptureReaderGetNumBatches(reader) != numBatches)
+    {
+        printf("FAILED: cannot read back %s\n", path.c_str());
+        return -1;
+    }
+    for (unsigned int l = 0; l < layers.size(); l++)
+    {
+        if (strcmp(readLayers[l].layerName, layers[l].layerName) ||
+                readLayers[l].dataType != layers[l].dataType ||
+                readLayers[l].isInput != layers[l].isInput ||
+                readLayers[l].dims.numElements != layers[l].dims.numElements)
+        {
+            printf("FAILED: layer %u\n", l);
+            ok = false;
+        }
+    }
+    for (unsigned int b = numBatches; ok && b-- > 0;)
+    {
+        const NvDsInferTensorCaptureFrameInfo *frames;
+        const void *buffers[3];
+        unsigned int numFrames = NvDsInferTensorCaptureReaderGetBatch(reader,
+                b, &frames, buffers);
+        if (numFrames != batchSize(b))
+        {
+            printf("FAILED: batch %u has %u frames\n", b, numFrames);
+            ok = false;
+            break;
+        }
+        for (unsigned int f = 0; f < numFrames; f++)
+        {
+            NvDsInferTensorCaptureFrameInfo expected = frameInfo(b, f);
+            if (memcmp(&frames[f], &expected, sizeof(expected)))
+            {
+                printf("FAILED: batch %u frame %u index\n", b, f);
+                ok = false;
+            }
+        }
+        for (unsigned int l = 0; l < layers.size(); l++)
+        {
+            uint8_t const *tensor = (uint8_t const *) buffers[l];
+            if ((uintptr_t) tensor % 64)
+            {
+                printf("FAILED: batch %u layer %u not aligned\n", b, l);
+                ok = false;
+            }
+            for (size_t i = 0; i < numFrames * frameSize(layers[l]); i++)
+            {
+                uint8_t expected = (l == 0 && b == 3) ? 0 : tensorByte(b, l, i);
+                if (tensor[i] != expected)
+                {
+                    printf("FAILED: batch %u layer %u byte %zu\n", b, l, i);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    NvDsInferTensorCaptureReaderClose(reader);
+    if (ok)
+        printf("Tensor capture read back: OK\n");
+
+    /* The replay serves the frames of all the batches in order. */
+    NvDsInferTensorReplay replay;
+    string error;
+    unsigned int numFrames = 0;
+    for (unsigned int b = 0; b < numBatches; b++)
+        numFrames += batchSize(b);
+    if (!replay.open(path, kUniqueID, {}, error) ||
+            replay.numBatches() != numBatches ||
+            replay.numFrames() != numFrames)
+    {
+        printf("FAILED: replay: %s\n", error.c_str());
+        ok = false;
+    }
+    else
+    {
+        vector<vector<uint8_t>> buffers(layers.size());
+        for (unsigned int l = 1; l < layers.size(); l++)
+            buffers[l].resize(frameSize(layers[l]));
+        for (unsigned int b = 0; b < numBatches; b++)
+        {
+            for (unsigned int f = 0; f < batchSize(b); f++)
+            {
+                replay.readFrames(1, buffers);
+                for (unsigned int l = 1; l < layers.size(); l++)
+                {
+                    size_t offset = f * frameSize(layers[l]);
+                    if (buffers[l][0] != tensorByte(b, l, offset) ||
+                            buffers[l].back() != tensorByte(b, l,
+                                offset + frameSize(layers[l]) - 1))
+                    {
+                        printf("FAILED: replay batch %u frame %u\n", b, f);
+                        ok = false;
+                    }
+                }
+            }
+        }
+        NvDsInferTensorReplay other;
+        if (other.open(path, kUniqueID + 1, {}, error))
+        {
+            printf("FAILED: replay of another unique ID\n");
+            ok = false;
+        }
+    }
+    if (ok)
+        printf("Tensor capture replay: OK\n");
+
+    /* A crash while writing the last batch leaves it out. */
+    long size;
+    if (!fileSize(path, size) || truncate(path.c_str(), size - 100))
+    {
+        printf("FAILED: cannot truncate %s\n", path.c_str());
+        return -1;
+    }
+    reader = NvDsInferTensorCaptureReaderOpen(path.c_str());
+    if (!reader ||
+            NvDsInferTensorCaptureReaderGetNumBatches(reader) != numBatches - 1)
+    {
+        printf("FAILED: truncated capture\n");
+        ok = false;
+    }
+    NvDsInferTensorCaptureReaderClose(reader);
+    if (NvDsInferTensorCaptureReaderOpen(argv[0]))
+    {
+        printf("FAILED: %s read as a capture\n", argv[0]);
+        ok = false;
+    }
+    if (ok)
+        printf("Tensor capture errors: OK\n");
+
+    /* Time 200 batches of 4 frames. The writer may drop batches if the disk
+     * does not keep up. */
+    const unsigned int numTimed = 200;
+    vector<NvDsInferTensorCaptureFrameInfo> frames(kMaxBatchSize);
+    void *buffers[3] = { tensors[0].data(), tensors[1].data(), tensors[2].data() };
+    writer = NvDsInferTensorCaptureWriterCreate(path.c_str(), kUniqueID,
+            layers.data(), layers.size(), 16);
+    auto start = chrono::steady_clock::now();
+    for (unsigned int b = 0; b < numTimed; b++)
+        NvDsInferTensorCaptureWriterQueueBatch(writer, frames.data(),
+                kMaxBatchSize, buffers);
+    double queueUs = chrono::duration<double, micro>(
+            chrono::steady_clock::now() - start).count() / numTimed;
+    NvDsInferTensorCaptureWriterStats stats;
+    NvDsInferTensorCaptureWriterGetStats(writer, &stats);
+    uint64_t dropped = stats.droppedBatches;
+    NvDsInferTensorCaptureWriterDestroy(writer);
+    unlink(path.c_str());
+
+    start = chrono::steady_clock::now();
+    for (unsigned int b = 0; b < numTimed; b++)
+    {
+        for (unsigned int l = 0; l < layers.size(); l++)
+        {
+            char fileName[256];
+            snprintf(fileName, sizeof(fileName), "%s/layer-%u_batch-%010u.bin",
+                    dir.c_str(), l, b);
+            FILE *file = fopen(fileName, "w");
+            if (file)
+            {
+                fwrite(tensors[l].data(), 1, tensors[l].size(), file);
+                fclose(file);
+            }
+        }
+    }
+    double filesUs = chrono::duration<double, micro>(
+            chrono::steady_clock::now() - start).count() / numTimed;
+    for (unsigned int b = 0; b < numTimed; b++)
+    {
+        for (unsigned int l = 0; l < layers.size(); l++)
+        {
+            char fileName[256];
+            snprintf(fileName, sizeof(fileName), "%s/layer-%u_batch-%010u.bin",
+                    dir.c_str(), l, b);
+            unlink(fileName);
+        }
+    }
+    rmdir(dir.c_str());
+    printf("batch of %u frames: queued for capture %.1f us (%lu dropped), "
+            "file per layer %.1f us\n", kMaxBatchSize, queueUs,
+            (unsigned long) dropped, filesUs);
+
+    if (!ok)
+    {
+        printf("FAILED\n");
+        return -1;
+    }
+    return 0;
+}
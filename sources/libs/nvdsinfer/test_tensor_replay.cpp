@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Writes batches of tensors as nvinfer raw-output-file-write does, some with
+ * and some without the input layer, then checks that NvDsInferTensorReplay
+ * serves their frames in order, looping, rejects bad layers and files, and
+ * paces the batches at the given rate.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "nvdsinfer_tensor_replay.h"
+
+using namespace std;
+
+static const unsigned int kUniqueID = 3;
+static const unsigned long kBatchNumbers[] = { 5, 20, 100 };
+static const unsigned int kBatchSizes[] = { 4, 2, 3 };
+/* Input 1x2x2 float, outputs 2x1x1 float and 3 int8. */
+static const size_t kFrameSizes[] = { 16, 8, 3 };
+static const char *kFileLayers[] = { "input", "out_cov", "out/bbox" };
+
+static string
+fileName(string const &dir, unsigned int layer, unsigned long batch,
+        unsigned int batchSize)
+{
+    string layerName = kFileLayers[layer];
+    char name[256];
+    for (char &c : layerName)
+    {
+        if (c == '/')
+            c = '_';
+    }
+    snprintf(name, sizeof(name),
+            "/gstnvdsinfer_uid-%02u_layer-%s_batch-%010lu_batchsize-%02u.bin",
+            kUniqueID, layerName.c_str(), batch, batchSize);
+    return dir + name;
+}
+
+/* Byte of a frame of a layer, unique enough to check the frame order. */
+static uint8_t
+frameByte(unsigned int layer, unsigned int frame, size_t offset)
+{
+    return (uint8_t) (layer * 64 + frame * 8 + offset + 1);
+}
+
+static bool
+writeFile(string const &path, size_t size, unsigned int layer,
+        unsigned int firstFrame, size_t frameSize)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    for (size_t i = 0; i < size; i++)
+        fputc(frameByte(layer, firstFrame + i / frameSize, i % frameSize), file);
+    fclose(file);
+    return true;
+}
+
+/* Batches 5, 20 and 100, batch 20 without its input. */
+static bool
+writeRecording(string const &dir)
+{
+    unsigned int firstFrame = 0;
+    for (unsigned int b = 0; b < 3; b++)
+    {
+        for (unsigned int l = 0; l < 3; l++)
+        {
+            if (l == 0 && kBatchNumbers[b] == 20)
+                continue;
+            if (!writeFile(fileName(dir, l, kBatchNumbers[b], kBatchSizes[b]),
+                        kFrameSizes[l] * kBatchSizes[b], l, firstFrame,
+                        kFrameSizes[l]))
+                return false;
+        }
+        firstFrame += kBatchSizes[b];
+    }
+    return true;
+}
+
+static const vector<string> kSpecs = {
+    "input:1x2x2", "out_cov:2x1x1:float", "out/bbox:3:int8"
+};
+
+int main(int argc, char *argv[])
+{
+    char dirTemplate[] = "/tmp/test_tensor_replay.XXXXXX";
+    if (!mkdtemp(dirTemplate))
+    {
+        printf("FAILED: cannot create a temporary directory\n");
+        return -1;
+    }
+    string dir = dirTemplate;
+    bool ok = writeRecording(dir);
+    string error;
+
+    NvDsInferTensorReplay replay;
+    if (!ok || !replay.open(dir, kUniqueID, kSpecs, error))
+    {
+        printf("FAILED: open: %s\n", error.c_str());
+        ok = false;
+    }
+    if (ok && (replay.numBatches() != 3 || replay.numFrames() != 9 ||
+                replay.layers().size() != 3 || !replay.layers()[0].isInput ||
+                replay.layers()[2].isInput ||
+                replay.layers()[2].dataType != INT8 ||
+                replay.layers()[2].dims.numElements != 3 ||
+                string(replay.layers()[2].layerName) != "out/bbox"))
+    {
+        printf("FAILED: %u batches, %u frames or layers\n",
+                replay.numBatches(), replay.numFrames());
+        ok = false;
+    }
+
+    /* 4 batches of 4 frames: 0-3, 4-7, 8 0 1 2, 3-6. Frames 4 and 5 are those
+     * of batch 20, without input. */
+    vector<vector<uint8_t>> buffers(3);
+    for (unsigned int l = 0; l < 3; l++)
+        buffers[l].resize(4 * kFrameSizes[l]);
+    for (unsigned int b = 0; ok && b < 4; b++)
+    {
+        replay.readFrames(4, buffers);
+        for (unsigned int f = 0; f < 4; f++)
+        {
+            unsigned int frame = (b * 4 + f) % 9;
+            for (unsigned int l = 0; l < 3; l++)
+            {
+                for (size_t i = 0; i < kFrameSizes[l]; i++)
+                {
+                    uint8_t expected = (l == 0 && (frame == 4 || frame == 5)) ?
+                        0 : frameByte(l, frame, i);
+                    if (buffers[l][f * kFrameSizes[l] + i] != expected)
+                    {
+                        printf("FAILED: batch %u frame %u layer %u\n", b, f, l);
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    if (ok)
+        printf("Tensor replay frames: OK\n");
+
+    struct
+    {
+        vector<string> specs;
+        unsigned int uniqueID;
+    } errorCases[] = {
+        { { "input:1x2x2" }, kUniqueID },
+        { { "input:1x2x2", "out_cov" }, kUniqueID },
+        { { "input:1x2x2", "out_cov:2x0x1" }, kUniqueID },
+        { { "input:1x2x2", "out_cov:2x1y1" }, kUniqueID },
+        { { "input:1x2x2", "out_cov:2x1x1:double" }, kUniqueID },
+        /* Wrong size. */
+        { { "input:1x2x2", "out_cov:2x1x1", "out/bbox:3:half" }, kUniqueID },
+        /* Missing output. */
+        { { "input:1x2x2", "out_cov:2x1x1", "other:3" }, kUniqueID },
+        /* No batch. */
+        { kSpecs, kUniqueID + 1 },
+    };
+    for (auto const &errorCase : errorCases)
+    {
+        NvDsInferTensorReplay bad;
+        error.clear();
+        if (bad.open(dir, errorCase.uniqueID, errorCase.specs, error) ||
+                error.empty())
+        {
+            printf("FAILED: %s accepted\n", errorCase.specs.back().c_str());
+            ok = false;
+        }
+    }
+    if (ok)
+        printf("Tensor replay errors: OK\n");
+
+    /* 20 batches at 200 per second take 95 ms after the first one. */
+    replay.setBatchRate(200);
+    auto start = chrono::steady_clock::now();
+    for (unsigned int b = 0; b < 20; b++)
+        replay.pace();
+    double ms = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - start).count();
+    printf("20 batches at 200/s: %.1f ms\n", ms);
+    if (ms < 90 || ms > 200)
+    {
+        printf("FAILED: pacing\n");
+        ok = false;
+    }
+
+    for (unsigned int b = 0; b < 3; b++)
+    {
+        for (unsigned int l = 0; l < 3; l++)
+            unlink(fileName(dir, l, kBatchNumbers[b], kBatchSizes[b]).c_str());
+    }
+    rmdir(dir.c_str());
+
+    if (!ok)
+    {
+        printf("FAILED\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "nvdsinfer_classifierparser.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLASSIFIER_HAVE_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define CLASSIFIER_HAVE_NEON 1
+#endif
+
+/* Up to this many classes kept, the best ones are kept sorted by insertion.
+ * Above, the candidates are sorted once. */
+#define CLASSIFIER_INSERTION_TOPK 16
+
+/* Range of the polynomial exponential: e^x is neither 0 nor infinite and the
+ * exponent of 2^n stays normal. */
+#define EXP_MIN -87.0f
+#define EXP_MAX 88.0f
+
+/* e^x = 2^n * e^r with n = round(x / ln 2) and r = x - n * ln 2, ln 2 split in
+ * two constants for precision, e^r by a degree 7 polynomial (Cephes expf). */
+#define EXP_LOG2E 1.44269504088896341f
+#define EXP_LN2_HI 0.693359375f
+#define EXP_LN2_LO -2.12194440e-4f
+#define EXP_P0 1.9875691500e-4f
+#define EXP_P1 1.3981999507e-3f
+#define EXP_P2 8.3334519073e-3f
+#define EXP_P3 4.1665795894e-2f
+#define EXP_P4 1.6666665459e-1f
+#define EXP_P5 5.0000001201e-1f
+
+using namespace std;
+
+static void
+activateScalar(const float *input, unsigned int count,
+    NvDsInferClassifierActivation activation, float *output)
+{
+  if (activation == NvDsInferClassifierActivation_Sigmoid)
+  {
+    for (unsigned int i = 0; i < count; i++)
+      output[i] = 1.0f / (1.0f + expf(-input[i]));
+    return;
+  }
+
+  float maxInput = *max_element(input, input + count);
+  float sum = 0;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    output[i] = expf(input[i] - maxInput);
+    sum += output[i];
+  }
+  float scale = 1.0f / sum;
+  for (unsigned int i = 0; i < count; i++)
+    output[i] *= scale;
+}
+
+#ifdef CLASSIFIER_HAVE_AVX2
+__attribute__((target("avx2")))
+static inline __m256
+expAvx2(__m256 x)
+{
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)),
+      _mm256_set1_ps(EXP_MAX));
+  __m256 n = _mm256_floor_ps(_mm256_add_ps(
+        _mm256_mul_ps(x, _mm256_set1_ps(EXP_LOG2E)), _mm256_set1_ps(0.5f)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(EXP_LN2_HI)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(EXP_LN2_LO)));
+
+  __m256 y = _mm256_set1_ps(EXP_P0);
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P1));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P2));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P3));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P4));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(EXP_P5));
+  y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(x, x)), x),
+      _mm256_set1_ps(1.0f));
+
+  __m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n),
+        _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+/* Sigmoid, or the unnormalized softmax e^(x - max) of 8 inputs. */
+__attribute__((target("avx2")))
+static inline __m256
+activateVectorAvx2(__m256 x, NvDsInferClassifierActivation activation,
+    __m256 maxInput)
+{
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  if (activation == NvDsInferClassifierActivation_Sigmoid)
+    return _mm256_div_ps(one, _mm256_add_ps(one,
+          expAvx2(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+  return expAvx2(_mm256_sub_ps(x, maxInput));
+}
+
+__attribute__((target("avx2")))
+static void
+activateAvx2(const float *input, unsigned int count,
+    NvDsInferClassifierActivation activation, float *output)
+{
+  unsigned int vectorCount = count & ~7u;
+  unsigned int tailCount = count - vectorCount;
+  float tail[8] = { 0 };
+  float maxInput = 0;
+  __m256 vmax = _mm256_setzero_ps();
+
+  /* The last inputs go through the vector code in a padded copy. */
+  memcpy(tail, input + vectorCount, tailCount * sizeof(float));
+
+  if (activation == NvDsInferClassifierActivation_Softmax)
+  {
+    maxInput = -INFINITY;
+    for (unsigned int i = vectorCount; i < count; i++)
+      maxInput = max(maxInput, input[i]);
+    if (vectorCount)
+    {
+      __m256 m = _mm256_loadu_ps(input);
+      for (unsigned int i = 8; i < vectorCount; i += 8)
+        m = _mm256_max_ps(m, _mm256_loadu_ps(input + i));
+      float lanes[8];
+      _mm256_storeu_ps(lanes, m);
+      maxInput = max(maxInput, *max_element(lanes, lanes + 8));
+    }
+    vmax = _mm256_set1_ps(maxInput);
+  }
+
+  __m256 vsum = _mm256_setzero_ps();
+  for (unsigned int i = 0; i < vectorCount; i += 8)
+  {
+    __m256 y = activateVectorAvx2(_mm256_loadu_ps(input + i), activation, vmax);
+    vsum = _mm256_add_ps(vsum, y);
+    _mm256_storeu_ps(output + i, y);
+  }
+  if (tailCount)
+  {
+    _mm256_storeu_ps(tail, activateVectorAvx2(_mm256_loadu_ps(tail),
+          activation, vmax));
+    memcpy(output + vectorCount, tail, tailCount * sizeof(float));
+  }
+
+  if (activation != NvDsInferClassifierActivation_Softmax)
+    return;
+
+  float lanes[8];
+  float sum = 0;
+  _mm256_storeu_ps(lanes, vsum);
+  for (unsigned int l = 0; l < 8; l++)
+    sum += lanes[l];
+  for (unsigned int l = 0; l < tailCount; l++)
+    sum += tail[l];
+
+  const __m256 vscale = _mm256_set1_ps(1.0f / sum);
+  for (unsigned int i = 0; i < vectorCount; i += 8)
+    _mm256_storeu_ps(output + i,
+        _mm256_mul_ps(_mm256_loadu_ps(output + i), vscale));
+  for (unsigned int i = vectorCount; i < count; i++)
+    output[i] *= 1.0f / sum;
+}
+#endif
+
+#ifdef CLASSIFIER_HAVE_NEON
+static inline float32x4_t
+expNeon(float32x4_t x)
+{
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(EXP_MIN)), vdupq_n_f32(EXP_MAX));
+  float32x4_t n = vrndmq_f32(vaddq_f32(vmulq_f32(x, vdupq_n_f32(EXP_LOG2E)),
+        vdupq_n_f32(0.5f)));
+  x = vsubq_f32(x, vmulq_f32(n, vdupq_n_f32(EXP_LN2_HI)));
+  x = vsubq_f32(x, vmulq_f32(n, vdupq_n_f32(EXP_LN2_LO)));
+
+  float32x4_t y = vdupq_n_f32(EXP_P0);
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P1));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P2));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P3));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P4));
+  y = vaddq_f32(vmulq_f32(y, x), vdupq_n_f32(EXP_P5));
+  y = vaddq_f32(vaddq_f32(vmulq_f32(y, vmulq_f32(x, x)), x), vdupq_n_f32(1.0f));
+
+  int32x4_t pow2n = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)),
+      23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(pow2n));
+}
+
+/* Sigmoid, or the unnormalized softmax e^(x - max) of 4 inputs. */
+static inline float32x4_t
+activateVectorNeon(float32x4_t x, NvDsInferClassifierActivation activation,
+    float32x4_t maxInput)
+{
+  const float32x4_t one = vdupq_n_f32(1.0f);
+
+  if (activation == NvDsInferClassifierActivation_Sigmoid)
+    return vdivq_f32(one, vaddq_f32(one, expNeon(vnegq_f32(x))));
+  return expNeon(vsubq_f32(x, maxInput));
+}
+
+static void
+activateNeon(const float *input, unsigned int count,
+    NvDsInferClassifierActivation activation, float *output)
+{
+  unsigned int vectorCount = count & ~3u;
+  unsigned int tailCount = count - vectorCount;
+  float tail[4] = { 0 };
+  float maxInput = 0;
+  float32x4_t vmax = vdupq_n_f32(0);
+
+  /* The last inputs go through the vector code in a padded copy. */
+  memcpy(tail, input + vectorCount, tailCount * sizeof(float));
+
+  if (activation == NvDsInferClassifierActivation_Softmax)
+  {
+    maxInput = -INFINITY;
+    for (unsigned int i = vectorCount; i < count; i++)
+      maxInput = max(maxInput, input[i]);
+    if (vectorCount)
+    {
+      float32x4_t m = vld1q_f32(input);
+      for (unsigned int i = 4; i < vectorCount; i += 4)
+        m = vmaxq_f32(m, vld1q_f32(input + i));
+      maxInput = max(maxInput, vmaxvq_f32(m));
+    }
+    vmax = vdupq_n_f32(maxInput);
+  }
+
+  float32x4_t vsum = vdupq_n_f32(0);
+  for (unsigned int i = 0; i < vectorCount; i += 4)
+  {
+    float32x4_t y = activateVectorNeon(vld1q_f32(input + i), activation, vmax);
+    vsum = vaddq_f32(vsum, y);
+    vst1q_f32(output + i, y);
+  }
+  if (tailCount)
+  {
+    vst1q_f32(tail, activateVectorNeon(vld1q_f32(tail), activation, vmax));
+    memcpy(output + vectorCount, tail, tailCount * sizeof(float));
+  }
+
+  if (activation != NvDsInferClassifierActivation_Softmax)
+    return;
+
+  float sum = vaddvq_f32(vsum);
+  for (unsigned int l = 0; l < tailCount; l++)
+    sum += tail[l];
+
+  const float32x4_t vscale = vdupq_n_f32(1.0f / sum);
+  for (unsigned int i = 0; i < vectorCount; i += 4)
+    vst1q_f32(output + i, vmulq_f32(vld1q_f32(output + i), vscale));
+  for (unsigned int i = vectorCount; i < count; i++)
+    output[i] *= 1.0f / sum;
+}
+#endif
+
+void
+NvDsInferClassifierActivate(const float *input, unsigned int count,
+    NvDsInferClassifierActivation activation, float *output,
+    NvDsInferGridIsa isa)
+{
+  if (activation == NvDsInferClassifierActivation_None)
+  {
+    if (output != input)
+      memcpy(output, input, count * sizeof(float));
+    return;
+  }
+  if (!count)
+    return;
+
+  switch (isa)
+  {
+#ifdef CLASSIFIER_HAVE_AVX2
+    case NVDSINFER_GRID_ISA_AVX2:
+      activateAvx2(input, count, activation, output);
+      break;
+#endif
+#ifdef CLASSIFIER_HAVE_NEON
+    case NVDSINFER_GRID_ISA_NEON:
+      activateNeon(input, count, activation, output);
+      break;
+#endif
+    default:
+      activateScalar(input, count, activation, output);
+      break;
+  }
+}
+
+/* Higher confidence first, then lower class. */
+static bool
+attributeBefore(NvDsInferAttribute const &a, NvDsInferAttribute const &b)
+{
+  if (a.attributeConfidence != b.attributeConfidence)
+    return a.attributeConfidence > b.attributeConfidence;
+  return a.attributeValue < b.attributeValue;
+}
+
+unsigned int
+NvDsInferClassifierTopK(const float *probabilities, unsigned int numClasses,
+    unsigned int topK, float threshold, unsigned int attributeIndex,
+    std::vector<NvDsInferAttribute> &attrList)
+{
+  size_t first = attrList.size();
+  /* The single label parsers kept a class above both the threshold and 0. */
+  float minProbability = max(threshold, 0.0f);
+  unsigned int count = 0;
+
+  topK = max(topK, 1u);
+
+  if (topK > CLASSIFIER_INSERTION_TOPK)
+  {
+    for (unsigned int c = 0; c < numClasses; c++)
+    {
+      if (probabilities[c] > minProbability)
+        attrList.push_back({ attributeIndex, c, probabilities[c], nullptr });
+    }
+    count = attrList.size() - first;
+    if (count > topK)
+    {
+      partial_sort(attrList.begin() + first, attrList.begin() + first + topK,
+          attrList.end(), attributeBefore);
+      attrList.resize(first + topK);
+      return topK;
+    }
+    sort(attrList.begin() + first, attrList.end(), attributeBefore);
+    return count;
+  }
+
+  for (unsigned int c = 0; c < numClasses; c++)
+  {
+    float probability = probabilities[c];
+
+    /* Strict comparisons keep the lower class of equal probabilities, and
+     * skip NaNs. */
+    if (!(probability > minProbability))
+      continue;
+
+    if (count < topK)
+    {
+      attrList.emplace_back();
+      count++;
+    }
+    NvDsInferAttribute *best = attrList.data() + first;
+    unsigned int i = count - 1;
+    for (; i > 0 && best[i - 1].attributeConfidence < probability; i--)
+      best[i] = best[i - 1];
+    best[i] = { attributeIndex, c, probability, nullptr };
+
+    if (count == topK)
+      minProbability = best[topK - 1].attributeConfidence;
+  }
+  return count;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Parsing of classifier output layers, shared by the parser of nvinfer and the
+ * sample custom parser: softmax or sigmoid of layers output as logits, and
+ * selection of the classes of highest confidence of a layer.
+ *
+ * The activations compute 8 (AVX2) or 4 (NEON) exponentials at a time with a
+ * polynomial approximation, within a few ulps of expf. The instruction set is
+ * picked as for the grid parser (NVDSINFER_GRID_ISA).
+ */
+
+#ifndef __NVDSINFER_CLASSIFIERPARSER_H__
+#define __NVDSINFER_CLASSIFIERPARSER_H__
+
+#include <vector>
+
+#include "nvdsinfer_context.h"
+#include "nvdsinfer_gridparser.h"
+
+/* Built into several libraries, keep each library's copy private to it */
+#pragma GCC visibility push(hidden)
+
+/**
+ * Writes to @a output the @a activation of the @a count floats of @a input.
+ * The softmax subtracts the maximum input before the exponentials, so that
+ * large logits do not overflow. @a output may be @a input.
+ */
+void NvDsInferClassifierActivate(const float *input, unsigned int count,
+    NvDsInferClassifierActivation activation, float *output,
+    NvDsInferGridIsa isa = NvDsInferGridDefaultIsa());
+
+/**
+ * Appends to @a attrList the at most @a topK classes of @a probabilities
+ * (@a numClasses floats) whose probability is above @a threshold and 0,
+ * highest first, ties going to the lowest class. The attributes get
+ * @a attributeIndex and no label. With @a topK of 0 or 1, the class is the
+ * one the single label parsers of earlier releases output.
+ *
+ * @return number of attributes appended.
+ */
+unsigned int NvDsInferClassifierTopK(const float *probabilities,
+    unsigned int numClasses, unsigned int topK, float threshold,
+    unsigned int attributeIndex, std::vector<NvDsInferAttribute> &attrList);
+
+#pragma GCC visibility pop
+
+#endif
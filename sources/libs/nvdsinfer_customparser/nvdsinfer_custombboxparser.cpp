@@ -20,107 +20,134 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 #include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_gridparser.h"
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #define CLIP(a,min,max) (MAX(MIN(a, max), min))
 #define DIVIDE_AND_ROUND_UP(a, b) ((a + b - 1) / b)
 
-/* This is a sample bounding box parsing function for the sample Resnet10
- * detector model provided with the SDK. */
+/* This is a sample bounding box parser for the sample Resnet10 detector
+ * model provided with the SDK, as a stateful parser (NvDsInferParseCustomResnet
+ * Create/Parse/Destroy) and as a parsing function. */
 
-/* C-linkage to prevent name-mangling */
-extern "C"
-bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-        NvDsInferNetworkInfo  const &networkInfo,
-        NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList);
-
-extern "C"
-bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-        NvDsInferNetworkInfo  const &networkInfo,
-        NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList)
+/* Layout of the output layers and parameters of the parsing. */
+typedef struct
 {
-  static NvDsInferDimsCHW covLayerDims;
-  static NvDsInferDimsCHW bboxLayerDims;
-  static int bboxLayerIndex = -1;
-  static int covLayerIndex = -1;
-  static bool classMismatchWarn = false;
-  int numClassesToParse;
+  unsigned int bboxLayerIndex;
+  unsigned int covLayerIndex;
+  NvDsInferDimsCHW bboxLayerDims;
+  NvDsInferDimsCHW covLayerDims;
+  unsigned int numClassesToParse;
+  NvDsInferNetworkInfo networkInfo;
+  std::vector<float> perClassThreshold;
+  std::vector<float> gcCentersX;
+  std::vector<float> gcCentersY;
+  /* Cells above the threshold, reused by the calls */
+  NvDsInferGridCandidates candidates;
+} ResnetParser;
+
+static const float bboxNormX = 35.0;
+static const float bboxNormY = 35.0;
+
+/* Looks the layers up and computes what does not depend on the frame. */
+static bool
+setupResnetParser (ResnetParser &parser,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    NvDsInferNetworkInfo const &networkInfo,
+    NvDsInferParseDetectionParams const &detectionParams)
+{
+  static std::atomic<bool> classMismatchWarn(false);
+  int bboxLayerIndex = -1;
+  int covLayerIndex = -1;
 
   /* Find the bbox layer */
-  if (bboxLayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "conv2d_bbox") == 0) {
-        bboxLayerIndex = i;
-        getDimsCHWFromDims(bboxLayerDims, outputLayersInfo[i].dims);
-        break;
-      }
+  for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
+    if (strcmp(outputLayersInfo[i].layerName, "conv2d_bbox") == 0) {
+      bboxLayerIndex = i;
+      getDimsCHWFromDims(parser.bboxLayerDims, outputLayersInfo[i].dims);
+      break;
     }
-    if (bboxLayerIndex == -1) {
+  }
+  if (bboxLayerIndex == -1) {
     std::cerr << "Could not find bbox layer buffer while parsing" << std::endl;
     return false;
-    }
   }
 
   /* Find the cov layer */
-  if (covLayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "conv2d_cov/Sigmoid") == 0) {
-        covLayerIndex = i;
-        getDimsCHWFromDims(covLayerDims, outputLayersInfo[i].dims);
-        break;
-      }
+  for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
+    if (strcmp(outputLayersInfo[i].layerName, "conv2d_cov/Sigmoid") == 0) {
+      covLayerIndex = i;
+      getDimsCHWFromDims(parser.covLayerDims, outputLayersInfo[i].dims);
+      break;
     }
-    if (covLayerIndex == -1) {
+  }
+  if (covLayerIndex == -1) {
     std::cerr << "Could not find bbox layer buffer while parsing" << std::endl;
     return false;
-    }
   }
+  parser.bboxLayerIndex = bboxLayerIndex;
+  parser.covLayerIndex = covLayerIndex;
 
   /* Warn in case of mismatch in number of classes */
-  if (!classMismatchWarn) {
-    if (covLayerDims.c != detectionParams.numClassesConfigured) {
+  if (!classMismatchWarn.exchange(true)) {
+    if (parser.covLayerDims.c != detectionParams.numClassesConfigured) {
       std::cerr << "WARNING: Num classes mismatch. Configured:" <<
         detectionParams.numClassesConfigured << ", detected by network: " <<
-        covLayerDims.c << std::endl;
+        parser.covLayerDims.c << std::endl;
     }
-    classMismatchWarn = true;
   }
 
   /* Calculate the number of classes to parse */
-  numClassesToParse = MIN (covLayerDims.c, detectionParams.numClassesConfigured);
-
-  int gridW = covLayerDims.w;
-  int gridH = covLayerDims.h;
-  int gridSize = gridW * gridH;
-  float gcCentersX[gridW];
-  float gcCentersY[gridH];
-  float bboxNormX = 35.0;
-  float bboxNormY = 35.0;
-  float *outputCovBuf = (float *) outputLayersInfo[covLayerIndex].buffer;
-  float *outputBboxBuf = (float *) outputLayersInfo[bboxLayerIndex].buffer;
-  int strideX = DIVIDE_AND_ROUND_UP(networkInfo.width, bboxLayerDims.w);
-  int strideY = DIVIDE_AND_ROUND_UP(networkInfo.height, bboxLayerDims.h);
-
+  parser.numClassesToParse = MIN (parser.covLayerDims.c,
+      detectionParams.numClassesConfigured);
+  parser.networkInfo = networkInfo;
+  parser.perClassThreshold = detectionParams.perClassThreshold;
+
+  int gridW = parser.covLayerDims.w;
+  int gridH = parser.covLayerDims.h;
+  int strideX = DIVIDE_AND_ROUND_UP(networkInfo.width, parser.bboxLayerDims.w);
+  int strideY = DIVIDE_AND_ROUND_UP(networkInfo.height, parser.bboxLayerDims.h);
+
+  parser.gcCentersX.resize(gridW);
+  parser.gcCentersY.resize(gridH);
   for (int i = 0; i < gridW; i++)
   {
-    gcCentersX[i] = (float)(i * strideX + 0.5);
-    gcCentersX[i] /= (float)bboxNormX;
+    parser.gcCentersX[i] = (float)(i * strideX + 0.5);
+    parser.gcCentersX[i] /= (float)bboxNormX;
 
   }
   for (int i = 0; i < gridH; i++)
   {
-    gcCentersY[i] = (float)(i * strideY + 0.5);
-    gcCentersY[i] /= (float)bboxNormY;
+    parser.gcCentersY[i] = (float)(i * strideY + 0.5);
+    parser.gcCentersY[i] /= (float)bboxNormY;
 
   }
+  return true;
+}
 
-  for (int c = 0; c < numClassesToParse; c++)
+static void
+parseResnet (ResnetParser &parser,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  NvDsInferDimsCHW const &bboxLayerDims = parser.bboxLayerDims;
+  NvDsInferNetworkInfo const &networkInfo = parser.networkInfo;
+  NvDsInferGridCandidates &candidates = parser.candidates;
+  int gridW = parser.covLayerDims.w;
+  int gridSize = gridW * parser.covLayerDims.h;
+  const float *gcCentersX = parser.gcCentersX.data();
+  const float *gcCentersY = parser.gcCentersY.data();
+  float *outputCovBuf =
+      (float *) outputLayersInfo[parser.covLayerIndex].buffer;
+  float *outputBboxBuf =
+      (float *) outputLayersInfo[parser.bboxLayerIndex].buffer;
+
+  for (unsigned int c = 0; c < parser.numClassesToParse; c++)
   {
     float *outputX1 = outputBboxBuf + (c * 4 * bboxLayerDims.h * bboxLayerDims.w);
 
@@ -128,40 +155,98 @@ bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLa
     float *outputX2 = outputY1 + gridSize;
     float *outputY2 = outputX2 + gridSize;
 
-    float threshold = detectionParams.perClassThreshold[c];
-    for (int h = 0; h < gridH; h++)
+    float threshold = parser.perClassThreshold[c];
+    unsigned int numCandidates = NvDsInferGridThreshold(
+        outputCovBuf + c * gridSize, gridSize, threshold, candidates);
+
+    objectList.reserve(objectList.size() + numCandidates);
+    for (unsigned int j = 0; j < numCandidates; j++)
     {
-      for (int w = 0; w < gridW; w++)
-      {
-        int i = w + h * gridW;
-        if (outputCovBuf[c * gridSize + i] >= threshold)
-        {
-          NvDsInferObjectDetectionInfo object;
-          float rectX1f, rectY1f, rectX2f, rectY2f;
-
-          rectX1f = (outputX1[w + h * gridW] - gcCentersX[w]) * -bboxNormX;
-          rectY1f = (outputY1[w + h * gridW] - gcCentersY[h]) * -bboxNormY;
-          rectX2f = (outputX2[w + h * gridW] + gcCentersX[w]) * bboxNormX;
-          rectY2f = (outputY2[w + h * gridW] + gcCentersY[h]) * bboxNormY;
-
-          object.classId = c;
-          object.detectionConfidence = outputCovBuf[c * gridSize + i];
-
-          /* Clip object box co-ordinates to network resolution */
-          object.left = CLIP(rectX1f, 0, networkInfo.width - 1);
-          object.top = CLIP(rectY1f, 0, networkInfo.height - 1);
-          object.width = CLIP(rectX2f, 0, networkInfo.width - 1) -
-                             object.left + 1;
-          object.height = CLIP(rectY2f, 0, networkInfo.height - 1) -
-                             object.top + 1;
-
-          objectList.push_back(object);
-        }
-      }
+      int i = candidates.cells[j];
+      int h = i / gridW;
+      int w = i - h * gridW;
+      NvDsInferObjectDetectionInfo object;
+      float rectX1f, rectY1f, rectX2f, rectY2f;
+
+      rectX1f = (outputX1[i] - gcCentersX[w]) * -bboxNormX;
+      rectY1f = (outputY1[i] - gcCentersY[h]) * -bboxNormY;
+      rectX2f = (outputX2[i] + gcCentersX[w]) * bboxNormX;
+      rectY2f = (outputY2[i] + gcCentersY[h]) * bboxNormY;
+
+      object.classId = c;
+      object.detectionConfidence = candidates.confidence[j];
+
+      /* Clip object box co-ordinates to network resolution */
+      object.left = CLIP(rectX1f, 0, networkInfo.width - 1);
+      object.top = CLIP(rectY1f, 0, networkInfo.height - 1);
+      object.width = CLIP(rectX2f, 0, networkInfo.width - 1) -
+                         object.left + 1;
+      object.height = CLIP(rectY2f, 0, networkInfo.height - 1) -
+                         object.top + 1;
+
+      objectList.push_back(object);
     }
   }
+}
+
+/* C-linkage to prevent name-mangling */
+extern "C"
+NvDsInferParserHandle NvDsInferParseCustomResnetCreate (
+    NvDsInferParserInitParams const &initParams)
+{
+  ResnetParser *parser = new ResnetParser;
+
+  if (!setupResnetParser (*parser, initParams.outputLayersInfo,
+          initParams.networkInfo, initParams.detectionParams)) {
+    delete parser;
+    return nullptr;
+  }
+  return parser;
+}
+
+extern "C"
+bool NvDsInferParseCustomResnetParse (NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  parseResnet (*(ResnetParser *) handle, outputLayersInfo, objectList);
+  return true;
+}
+
+extern "C"
+void NvDsInferParseCustomResnetDestroy (NvDsInferParserHandle handle)
+{
+  delete (ResnetParser *) handle;
+}
+
+extern "C"
+bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+extern "C"
+bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  /* The layers are looked up once, in a parser of the thread: the frames of
+   * a batch can be parsed by several threads (output-parse-workers). */
+  static thread_local ResnetParser parser;
+  static thread_local NvDsInferParserCallParams parserParams;
+  static thread_local bool parserValid;
+
+  if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+          networkInfo, detectionParams))
+    parserValid = setupResnetParser (parser, outputLayersInfo, networkInfo,
+        detectionParams);
+  if (!parserValid)
+    return false;
+  parseResnet (parser, outputLayersInfo, objectList);
   return true;
 }
 
-/* Check that the custom function has been defined correctly */
+/* Check that the custom functions have been defined correctly */
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomResnet);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomResnet);
@@ -23,6 +23,7 @@
 #include <cstring>
 #include <iostream>
 #include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_classifierparser.h"
 
 /* This is a sample classifier output parsing function from softmax layers for
  * the vehicle type classifier model provided with the SDK. */
@@ -62,35 +63,19 @@ bool NvDsInferClassiferParseCustomSoftmax (std::vector<NvDsInferLayerInfo> const
         getDimsCHWFromDims(dims, outputLayersInfo[l].dims);
         unsigned int numClasses = dims.c;
         float *outputCoverageBuffer = (float *)outputLayersInfo[l].buffer;
-        float maxProbability = 0;
-        bool attrFound = false;
-        NvDsInferAttribute attr;
 
-        /* Iterate through all the probabilities that the object belongs to
-         * each class. Find the maximum probability and the corresponding class
-         * which meets the minimum threshold. */
-        for (unsigned int c = 0; c < numClasses; c++)
-        {
-            float probability = outputCoverageBuffer[c];
-            if (probability > classifierThreshold
-                    && probability > maxProbability)
-            {
-                maxProbability = probability;
-                attrFound = true;
-                attr.attributeIndex = l;
-                attr.attributeValue = c;
-                attr.attributeConfidence = probability;
-            }
-        }
-        if (attrFound)
+        /* Find the class of maximum probability which meets the minimum
+         * threshold. */
+        size_t first = attrList.size();
+        NvDsInferClassifierTopK(outputCoverageBuffer, numClasses, 1,
+                classifierThreshold, l, attrList);
+        for (size_t i = first; i < attrList.size(); i++)
         {
+            NvDsInferAttribute &attr = attrList[i];
             if (labels.size() > attr.attributeIndex &&
                     attr.attributeValue < labels[attr.attributeIndex].size())
                 attr.attributeLabel =
                     labels[attr.attributeIndex][attr.attributeValue].c_str();
-            else
-                attr.attributeLabel = nullptr;
-            attrList.push_back(attr);
             if (attr.attributeLabel)
                 descString.append(attr.attributeLabel).append(" ");
         }
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include "nvdsinfer_gridparser.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GRID_HAVE_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define GRID_HAVE_NEON 1
+#endif
+
+/* Vector kernels store full vectors at the end of the candidate list. */
+#define GRID_PADDING 8
+
+/* For each mask of 8 cells, the lanes of the cells set in the mask, packed
+ * to the front. Entries of masks < 16 also serve the 4 lane NEON kernel. */
+typedef struct GridPackTable
+{
+  uint8_t lanes[256][8];
+  GridPackTable()
+  {
+    memset(lanes, 0, sizeof(lanes));
+    for (unsigned int mask = 0; mask < 256; mask++)
+    {
+      unsigned int n = 0;
+      for (unsigned int lane = 0; lane < 8; lane++)
+      {
+        if (mask & (1 << lane))
+          lanes[mask][n++] = lane;
+      }
+    }
+  }
+} GridPackTable;
+
+static const GridPackTable s_PackTable;
+
+static unsigned int
+gridThresholdScalar(const float *coverage, unsigned int begin, unsigned int end,
+    float threshold, unsigned int *cells, float *confidence, unsigned int count)
+{
+  /* Branchless: every cell is stored and kept only if it meets the
+   * threshold, there is room for it as count <= i. */
+  for (unsigned int i = begin; i < end; i++)
+  {
+    cells[count] = i;
+    confidence[count] = coverage[i];
+    count += coverage[i] >= threshold;
+  }
+  return count;
+}
+
+#ifdef GRID_HAVE_AVX2
+__attribute__((target("avx2,popcnt")))
+static inline unsigned int
+gridPackAvx2(__m256 coverage, int mask, unsigned int base,
+    unsigned int *cells, float *confidence, unsigned int count)
+{
+  if (!mask)
+    return count;
+
+  __m256i lanes = _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64((const __m128i *) s_PackTable.lanes[mask]));
+  _mm256_storeu_ps(confidence + count,
+      _mm256_permutevar8x32_ps(coverage, lanes));
+  _mm256_storeu_si256((__m256i *) (cells + count),
+      _mm256_add_epi32(_mm256_set1_epi32(base), lanes));
+  return count + __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2,popcnt")))
+static unsigned int
+gridThresholdAvx2(const float *coverage, unsigned int numCells, float threshold,
+    unsigned int *cells, float *confidence)
+{
+  const __m256 vthreshold = _mm256_set1_ps(threshold);
+  unsigned int count = 0;
+  unsigned int i = 0;
+
+  /* Two vectors per iteration, most blocks have no candidate at all. */
+  for (; i + 16 <= numCells; i += 16)
+  {
+    __m256 c0 = _mm256_loadu_ps(coverage + i);
+    __m256 c1 = _mm256_loadu_ps(coverage + i + 8);
+    int m0 = _mm256_movemask_ps(_mm256_cmp_ps(c0, vthreshold, _CMP_GE_OQ));
+    int m1 = _mm256_movemask_ps(_mm256_cmp_ps(c1, vthreshold, _CMP_GE_OQ));
+
+    if (!(m0 | m1))
+      continue;
+    count = gridPackAvx2(c0, m0, i, cells, confidence, count);
+    count = gridPackAvx2(c1, m1, i + 8, cells, confidence, count);
+  }
+  for (; i + 8 <= numCells; i += 8)
+  {
+    __m256 c = _mm256_loadu_ps(coverage + i);
+    int m = _mm256_movemask_ps(_mm256_cmp_ps(c, vthreshold, _CMP_GE_OQ));
+    count = gridPackAvx2(c, m, i, cells, confidence, count);
+  }
+  return gridThresholdScalar(coverage, i, numCells, threshold, cells,
+      confidence, count);
+}
+#endif
+
+#ifdef GRID_HAVE_NEON
+/* For each mask of 4 cells, byte indices packing the 32 bit lanes set in
+ * the mask to the front. */
+typedef struct GridPackTableNeon
+{
+  uint8_t bytes[16][16];
+  GridPackTableNeon()
+  {
+    memset(bytes, 0, sizeof(bytes));
+    for (unsigned int mask = 0; mask < 16; mask++)
+    {
+      for (unsigned int n = 0; n < 4; n++)
+      {
+        for (unsigned int b = 0; b < 4; b++)
+          bytes[mask][n * 4 + b] = s_PackTable.lanes[mask][n] * 4 + b;
+      }
+    }
+  }
+} GridPackTableNeon;
+
+static const GridPackTableNeon s_PackTableNeon;
+
+static inline unsigned int
+gridPackNeon(float32x4_t coverage, uint32x4_t cmp, uint32x4_t bits,
+    unsigned int base, unsigned int *cells, float *confidence,
+    unsigned int count)
+{
+  unsigned int mask = vaddvq_u32(vandq_u32(cmp, bits));
+  if (!mask)
+    return count;
+
+  uint8x16_t shuffle = vld1q_u8(s_PackTableNeon.bytes[mask]);
+  uint32x4_t lanes = vmovl_u16(vget_low_u16(vmovl_u8(
+      vld1_u8(s_PackTable.lanes[mask]))));
+  vst1q_f32(confidence + count, vreinterpretq_f32_u8(
+      vqtbl1q_u8(vreinterpretq_u8_f32(coverage), shuffle)));
+  vst1q_u32(cells + count, vaddq_u32(vdupq_n_u32(base), lanes));
+  return count + __builtin_popcount(mask);
+}
+
+static unsigned int
+gridThresholdNeon(const float *coverage, unsigned int numCells, float threshold,
+    unsigned int *cells, float *confidence)
+{
+  static const uint32_t bitsInit[4] = { 1, 2, 4, 8 };
+  const uint32x4_t bits = vld1q_u32(bitsInit);
+  const float32x4_t vthreshold = vdupq_n_f32(threshold);
+  unsigned int count = 0;
+  unsigned int i = 0;
+
+  /* Four vectors per iteration, most blocks have no candidate at all. */
+  for (; i + 16 <= numCells; i += 16)
+  {
+    float32x4_t c0 = vld1q_f32(coverage + i);
+    float32x4_t c1 = vld1q_f32(coverage + i + 4);
+    float32x4_t c2 = vld1q_f32(coverage + i + 8);
+    float32x4_t c3 = vld1q_f32(coverage + i + 12);
+    uint32x4_t m0 = vcgeq_f32(c0, vthreshold);
+    uint32x4_t m1 = vcgeq_f32(c1, vthreshold);
+    uint32x4_t m2 = vcgeq_f32(c2, vthreshold);
+    uint32x4_t m3 = vcgeq_f32(c3, vthreshold);
+
+    if (!vmaxvq_u32(vorrq_u32(vorrq_u32(m0, m1), vorrq_u32(m2, m3))))
+      continue;
+    count = gridPackNeon(c0, m0, bits, i, cells, confidence, count);
+    count = gridPackNeon(c1, m1, bits, i + 4, cells, confidence, count);
+    count = gridPackNeon(c2, m2, bits, i + 8, cells, confidence, count);
+    count = gridPackNeon(c3, m3, bits, i + 12, cells, confidence, count);
+  }
+  for (; i + 4 <= numCells; i += 4)
+  {
+    float32x4_t c = vld1q_f32(coverage + i);
+    count = gridPackNeon(c, vcgeq_f32(c, vthreshold), bits, i, cells,
+        confidence, count);
+  }
+  return gridThresholdScalar(coverage, i, numCells, threshold, cells,
+      confidence, count);
+}
+#endif
+
+bool
+NvDsInferGridIsaSupported(NvDsInferGridIsa isa)
+{
+  switch (isa)
+  {
+    case NVDSINFER_GRID_ISA_SCALAR:
+      return true;
+#ifdef GRID_HAVE_AVX2
+    case NVDSINFER_GRID_ISA_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+#ifdef GRID_HAVE_NEON
+    case NVDSINFER_GRID_ISA_NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+static NvDsInferGridIsa
+gridDetectIsa()
+{
+  const char *env = getenv("NVDSINFER_GRID_ISA");
+
+  if (env)
+  {
+    if (!strcmp(env, "scalar"))
+      return NVDSINFER_GRID_ISA_SCALAR;
+    if (!strcmp(env, "avx2") && NvDsInferGridIsaSupported(NVDSINFER_GRID_ISA_AVX2))
+      return NVDSINFER_GRID_ISA_AVX2;
+    if (!strcmp(env, "neon") && NvDsInferGridIsaSupported(NVDSINFER_GRID_ISA_NEON))
+      return NVDSINFER_GRID_ISA_NEON;
+  }
+
+  if (NvDsInferGridIsaSupported(NVDSINFER_GRID_ISA_AVX2))
+    return NVDSINFER_GRID_ISA_AVX2;
+  if (NvDsInferGridIsaSupported(NVDSINFER_GRID_ISA_NEON))
+    return NVDSINFER_GRID_ISA_NEON;
+  return NVDSINFER_GRID_ISA_SCALAR;
+}
+
+NvDsInferGridIsa
+NvDsInferGridDefaultIsa()
+{
+  static const NvDsInferGridIsa isa = gridDetectIsa();
+  return isa;
+}
+
+unsigned int
+NvDsInferGridThreshold(const float *coverage, unsigned int numCells,
+    float threshold, NvDsInferGridCandidates &candidates, NvDsInferGridIsa isa)
+{
+  size_t size = numCells + GRID_PADDING;
+
+  if (candidates.cells.size() < size)
+  {
+    candidates.cells.resize(size);
+    candidates.confidence.resize(size);
+  }
+
+  unsigned int *cells = candidates.cells.data();
+  float *confidence = candidates.confidence.data();
+
+  switch (isa)
+  {
+#ifdef GRID_HAVE_AVX2
+    case NVDSINFER_GRID_ISA_AVX2:
+      candidates.count = gridThresholdAvx2(coverage, numCells, threshold,
+          cells, confidence);
+      break;
+#endif
+#ifdef GRID_HAVE_NEON
+    case NVDSINFER_GRID_ISA_NEON:
+      candidates.count = gridThresholdNeon(coverage, numCells, threshold,
+          cells, confidence);
+      break;
+#endif
+    default:
+      candidates.count = gridThresholdScalar(coverage, 0, numCells, threshold,
+          cells, confidence, 0);
+      break;
+  }
+  return candidates.count;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Thresholding of the coverage grid of DetectNet style detectors (e.g. the
+ * sample Resnet10 model), shared by the parser of nvinfer and the sample
+ * custom parser.
+ *
+ * Most cells of a coverage grid are below the detection threshold. The cells
+ * of a class are compared 8 (AVX2) or 4 (NEON) at a time and the cells
+ * meeting the threshold are packed into a candidate list, leaving only these
+ * to decode into boxes. The instruction set is picked at runtime; setting
+ * NVDSINFER_GRID_ISA=scalar|avx2|neon in the environment overrides it.
+ */
+
+#ifndef __NVDSINFER_GRIDPARSER_H__
+#define __NVDSINFER_GRIDPARSER_H__
+
+#include <vector>
+
+/* Built into several libraries, keep each library's copy private to it */
+#pragma GCC visibility push(hidden)
+
+typedef enum
+{
+  NVDSINFER_GRID_ISA_SCALAR = 0,
+  NVDSINFER_GRID_ISA_AVX2,
+  NVDSINFER_GRID_ISA_NEON
+} NvDsInferGridIsa;
+
+/**
+ * Cells of a grid meeting the threshold, in increasing cell order, as a
+ * structure of arrays. The arrays are kept across calls and only grow.
+ */
+typedef struct
+{
+  /** Index of the cell in the grid, i.e. x + y * grid width. */
+  std::vector<unsigned int> cells;
+  /** Coverage of the cell. */
+  std::vector<float> confidence;
+  /** Number of valid entries. */
+  unsigned int count;
+} NvDsInferGridCandidates;
+
+/**
+ * Returns the instruction set used by default: the one set by
+ * NVDSINFER_GRID_ISA, else the best one supported by the CPU.
+ */
+NvDsInferGridIsa NvDsInferGridDefaultIsa();
+
+/**
+ * Returns true if @a isa can be used on this CPU.
+ */
+bool NvDsInferGridIsaSupported(NvDsInferGridIsa isa);
+
+/**
+ * Fills @a candidates with the cells of @a coverage (@a numCells floats)
+ * whose coverage is >= @a threshold. Cells with a NaN coverage are skipped.
+ *
+ * @return number of candidates.
+ */
+unsigned int NvDsInferGridThreshold(const float *coverage, unsigned int numCells,
+    float threshold, NvDsInferGridCandidates &candidates,
+    NvDsInferGridIsa isa = NvDsInferGridDefaultIsa());
+
+#pragma GCC visibility pop
+
+#endif
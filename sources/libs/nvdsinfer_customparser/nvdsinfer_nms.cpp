@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "nvdsinfer_nms.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NMS_HAVE_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define NMS_HAVE_NEON 1
+#endif
+
+/* Vector kernels read full vectors past the last box. */
+#define NMS_PADDING 8
+
+/* A box as compared by the IoU */
+typedef struct
+{
+  float x1, y1, x2, y2, area;
+} NmsBox;
+
+/* Boxes as structure of arrays, for the vector kernels */
+typedef struct
+{
+  std::vector<float> x1, y1, x2, y2, area;
+  unsigned int count;
+} NmsBoxes;
+
+/* Per thread buffers, reused by the calls */
+typedef struct
+{
+  std::vector<unsigned int> order;
+  std::vector<unsigned int> classCount;
+  std::vector<unsigned int> grouped;
+  NmsBoxes boxes;
+  std::vector<uint64_t> overlaps;
+  std::vector<uint64_t> removed;
+  std::vector<float> scores;
+  std::vector<unsigned int> alive;
+  std::vector<NvDsInferObjectDetectionInfo> result;
+} NmsScratch;
+
+static inline NmsBox
+nmsBox(NvDsInferObjectDetectionInfo const &object)
+{
+  NmsBox b;
+  b.x1 = object.left;
+  b.y1 = object.top;
+  b.x2 = object.left + object.width;
+  b.y2 = object.top + object.height;
+  b.area = object.width * object.height;
+  return b;
+}
+
+static inline float
+nmsIoU(NmsBox const &a, NmsBox const &b)
+{
+  float overlapX = std::max(0.0f, std::min(a.x2, b.x2) - std::max(a.x1, b.x1));
+  float overlapY = std::max(0.0f, std::min(a.y2, b.y2) - std::max(a.y1, b.y1));
+  float overlap = overlapX * overlapY;
+  float u = a.area + b.area - overlap;
+  return u == 0 ? 0 : overlap / u;
+}
+
+static void
+nmsBoxesReset(NmsBoxes &boxes, unsigned int capacity)
+{
+  if (boxes.x1.size() < capacity + NMS_PADDING)
+  {
+    size_t size = capacity + NMS_PADDING;
+    boxes.x1.resize(size);
+    boxes.y1.resize(size);
+    boxes.x2.resize(size);
+    boxes.y2.resize(size);
+    boxes.area.resize(size);
+  }
+  boxes.count = 0;
+}
+
+static inline void
+nmsBoxesAppend(NmsBoxes &boxes, NmsBox const &b)
+{
+  unsigned int i = boxes.count++;
+  boxes.x1[i] = b.x1;
+  boxes.y1[i] = b.y1;
+  boxes.x2[i] = b.x2;
+  boxes.y2[i] = b.y2;
+  boxes.area[i] = b.area;
+}
+
+static inline NmsBox
+nmsBoxesGet(NmsBoxes const &boxes, unsigned int i)
+{
+  NmsBox b = { boxes.x1[i], boxes.y1[i], boxes.x2[i], boxes.y2[i],
+    boxes.area[i] };
+  return b;
+}
+
+/* Overlap kernels. nmsOverlapsAny* return true if @b overlaps one of @boxes
+ * by more than @threshold. nmsOverlapMask* return the mask of the boxes
+ * [begin, begin + 8) of @boxes that @b overlaps by more than @threshold. */
+
+static bool
+nmsOverlapsAnyScalar(NmsBox const &b, NmsBoxes const &boxes, float threshold)
+{
+  for (unsigned int i = 0; i < boxes.count; i++)
+  {
+    if (nmsIoU(b, nmsBoxesGet(boxes, i)) > threshold)
+      return true;
+  }
+  return false;
+}
+
+static unsigned int
+nmsOverlapMaskScalar(NmsBox const &b, NmsBoxes const &boxes, unsigned int begin,
+    float threshold)
+{
+  unsigned int mask = 0;
+  for (unsigned int lane = 0; lane < 8; lane++)
+  {
+    if (nmsIoU(b, nmsBoxesGet(boxes, begin + lane)) > threshold)
+      mask |= 1 << lane;
+  }
+  return mask;
+}
+
+#ifdef NMS_HAVE_AVX2
+__attribute__((target("avx2")))
+static inline int
+nmsOverlapAvx2(NmsBox const &b, NmsBoxes const &boxes, unsigned int begin,
+    __m256 threshold)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  __m256 overlapX = _mm256_max_ps(zero, _mm256_sub_ps(
+      _mm256_min_ps(_mm256_set1_ps(b.x2), _mm256_loadu_ps(&boxes.x2[begin])),
+      _mm256_max_ps(_mm256_set1_ps(b.x1), _mm256_loadu_ps(&boxes.x1[begin]))));
+  __m256 overlapY = _mm256_max_ps(zero, _mm256_sub_ps(
+      _mm256_min_ps(_mm256_set1_ps(b.y2), _mm256_loadu_ps(&boxes.y2[begin])),
+      _mm256_max_ps(_mm256_set1_ps(b.y1), _mm256_loadu_ps(&boxes.y1[begin]))));
+  __m256 overlap = _mm256_mul_ps(overlapX, overlapY);
+  __m256 u = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps(b.area),
+      _mm256_loadu_ps(&boxes.area[begin])), overlap);
+  __m256 iou = _mm256_div_ps(overlap, u);
+  iou = _mm256_blendv_ps(iou, zero, _mm256_cmp_ps(u, zero, _CMP_EQ_OQ));
+  return _mm256_movemask_ps(_mm256_cmp_ps(iou, threshold, _CMP_GT_OQ));
+}
+
+__attribute__((target("avx2")))
+static bool
+nmsOverlapsAnyAvx2(NmsBox const &b, NmsBoxes const &boxes, float threshold)
+{
+  const __m256 vthreshold = _mm256_set1_ps(threshold);
+
+  for (unsigned int i = 0; i < boxes.count; i += 8)
+  {
+    int mask = nmsOverlapAvx2(b, boxes, i, vthreshold);
+    if (boxes.count - i < 8)
+      mask &= (1 << (boxes.count - i)) - 1;
+    if (mask)
+      return true;
+  }
+  return false;
+}
+
+__attribute__((target("avx2")))
+static unsigned int
+nmsOverlapMaskAvx2(NmsBox const &b, NmsBoxes const &boxes, unsigned int begin,
+    float threshold)
+{
+  return nmsOverlapAvx2(b, boxes, begin, _mm256_set1_ps(threshold));
+}
+#endif
+
+#ifdef NMS_HAVE_NEON
+static inline unsigned int
+nmsOverlapNeon(NmsBox const &b, NmsBoxes const &boxes, unsigned int begin,
+    float32x4_t threshold)
+{
+  static const uint32_t bitsInit[4] = { 1, 2, 4, 8 };
+  const float32x4_t zero = vdupq_n_f32(0);
+  float32x4_t overlapX = vmaxq_f32(zero, vsubq_f32(
+      vminq_f32(vdupq_n_f32(b.x2), vld1q_f32(&boxes.x2[begin])),
+      vmaxq_f32(vdupq_n_f32(b.x1), vld1q_f32(&boxes.x1[begin]))));
+  float32x4_t overlapY = vmaxq_f32(zero, vsubq_f32(
+      vminq_f32(vdupq_n_f32(b.y2), vld1q_f32(&boxes.y2[begin])),
+      vmaxq_f32(vdupq_n_f32(b.y1), vld1q_f32(&boxes.y1[begin]))));
+  float32x4_t overlap = vmulq_f32(overlapX, overlapY);
+  float32x4_t u = vsubq_f32(vaddq_f32(vdupq_n_f32(b.area),
+      vld1q_f32(&boxes.area[begin])), overlap);
+  float32x4_t iou = vdivq_f32(overlap, u);
+  iou = vbslq_f32(vceqq_f32(u, zero), zero, iou);
+  return vaddvq_u32(vandq_u32(vcgtq_f32(iou, threshold), vld1q_u32(bitsInit)));
+}
+
+static bool
+nmsOverlapsAnyNeon(NmsBox const &b, NmsBoxes const &boxes, float threshold)
+{
+  const float32x4_t vthreshold = vdupq_n_f32(threshold);
+
+  for (unsigned int i = 0; i < boxes.count; i += 4)
+  {
+    unsigned int mask = nmsOverlapNeon(b, boxes, i, vthreshold);
+    if (boxes.count - i < 4)
+      mask &= (1 << (boxes.count - i)) - 1;
+    if (mask)
+      return true;
+  }
+  return false;
+}
+
+static unsigned int
+nmsOverlapMaskNeon(NmsBox const &b, NmsBoxes const &boxes, unsigned int begin,
+    float threshold)
+{
+  const float32x4_t vthreshold = vdupq_n_f32(threshold);
+  return nmsOverlapNeon(b, boxes, begin, vthreshold) |
+      nmsOverlapNeon(b, boxes, begin + 4, vthreshold) << 4;
+}
+#endif
+
+typedef bool (*NmsOverlapsAnyFunc)(NmsBox const &b, NmsBoxes const &boxes,
+    float threshold);
+typedef unsigned int (*NmsOverlapMaskFunc)(NmsBox const &b,
+    NmsBoxes const &boxes, unsigned int begin, float threshold);
+
+typedef struct NmsKernels
+{
+  NmsOverlapsAnyFunc overlapsAny;
+  NmsOverlapMaskFunc overlapMask;
+  NmsKernels()
+  {
+    overlapsAny = nmsOverlapsAnyScalar;
+    overlapMask = nmsOverlapMaskScalar;
+#ifdef NMS_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      overlapsAny = nmsOverlapsAnyAvx2;
+      overlapMask = nmsOverlapMaskAvx2;
+    }
+#endif
+#ifdef NMS_HAVE_NEON
+    overlapsAny = nmsOverlapsAnyNeon;
+    overlapMask = nmsOverlapMaskNeon;
+#endif
+  }
+} NmsKernels;
+
+static const NmsKernels s_Kernels;
+
+/* Greedy NMS of the boxes @group (sorted), kept boxes appended to @result */
+static void
+nmsGreedy(std::vector<NvDsInferObjectDetectionInfo> const &objects,
+    unsigned int const *group, unsigned int count,
+    NvDsInferNmsParams const &params, NmsScratch &scratch)
+{
+  unsigned int maxKept = params.topK ? std::min(params.topK, count) : count;
+
+  nmsBoxesReset(scratch.boxes, maxKept);
+  for (unsigned int i = 0; i < count && scratch.boxes.count < maxKept; i++)
+  {
+    NvDsInferObjectDetectionInfo const &object = objects[group[i]];
+    NmsBox b = nmsBox(object);
+
+    if (s_Kernels.overlapsAny(b, scratch.boxes, params.iouThreshold))
+      continue;
+    nmsBoxesAppend(scratch.boxes, b);
+    scratch.result.push_back(object);
+  }
+}
+
+/* Bitmask NMS: row i of the overlaps bitmask holds the boxes after i that
+ * box i overlaps. Boxes removed by the boxes kept are or-ed in @removed. */
+static void
+nmsBitmask(std::vector<NvDsInferObjectDetectionInfo> const &objects,
+    unsigned int const *group, unsigned int count,
+    NvDsInferNmsParams const &params, NmsScratch &scratch)
+{
+  unsigned int words = (count + 63) / 64;
+  unsigned int kept = 0;
+  unsigned int maxKept = params.topK ? params.topK : count;
+
+  nmsBoxesReset(scratch.boxes, count);
+  for (unsigned int i = 0; i < count; i++)
+    nmsBoxesAppend(scratch.boxes, nmsBox(objects[group[i]]));
+
+  scratch.overlaps.assign((size_t) count * words, 0);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    NmsBox b = nmsBoxesGet(scratch.boxes, i);
+    uint64_t *row = &scratch.overlaps[(size_t) i * words];
+
+    for (unsigned int j = (i + 1) & ~7u; j < count; j += 8)
+    {
+      uint64_t mask = s_Kernels.overlapMask(b, scratch.boxes, j,
+          params.iouThreshold);
+      if (j <= i)
+        mask &= ~((2ull << (i - j)) - 1);
+      if (count - j < 8)
+        mask &= (1ull << (count - j)) - 1;
+      row[j / 64] |= mask << (j % 64);
+    }
+  }
+
+  scratch.removed.assign(words, 0);
+  for (unsigned int i = 0; i < count && kept < maxKept; i++)
+  {
+    if (scratch.removed[i / 64] & (1ull << (i % 64)))
+      continue;
+    uint64_t const *row = &scratch.overlaps[(size_t) i * words];
+    for (unsigned int w = i / 64; w < words; w++)
+      scratch.removed[w] |= row[w];
+    scratch.result.push_back(objects[group[i]]);
+    kept++;
+  }
+}
+
+/* Soft-NMS: the box of highest confidence is kept and the confidence of the
+ * others decays with their IoU with it, until no box is left. */
+static void
+nmsSoft(std::vector<NvDsInferObjectDetectionInfo> const &objects,
+    unsigned int const *group, unsigned int count,
+    NvDsInferNmsParams const &params, NmsScratch &scratch)
+{
+  unsigned int maxKept = params.topK ? params.topK : count;
+  unsigned int kept = 0;
+  unsigned int numAlive = count;
+
+  nmsBoxesReset(scratch.boxes, count);
+  scratch.scores.resize(count);
+  scratch.alive.resize(count);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    nmsBoxesAppend(scratch.boxes, nmsBox(objects[group[i]]));
+    scratch.scores[i] = objects[group[i]].detectionConfidence;
+    scratch.alive[i] = i;
+  }
+
+  while (numAlive && kept < maxKept)
+  {
+    /* first box of highest score, boxes stay in confidence order */
+    unsigned int best = 0;
+    for (unsigned int a = 1; a < numAlive; a++)
+    {
+      if (scratch.scores[scratch.alive[a]] > scratch.scores[scratch.alive[best]])
+        best = a;
+    }
+    unsigned int k = scratch.alive[best];
+    NmsBox b = nmsBoxesGet(scratch.boxes, k);
+    NvDsInferObjectDetectionInfo object = objects[group[k]];
+
+    object.detectionConfidence = scratch.scores[k];
+    scratch.result.push_back(object);
+    kept++;
+
+    unsigned int n = 0;
+    for (unsigned int a = 0; a < numAlive; a++)
+    {
+      unsigned int i = scratch.alive[a];
+      if (a == best)
+        continue;
+
+      float iou = nmsIoU(b, nmsBoxesGet(scratch.boxes, i));
+      if (params.method == NVDSINFER_NMS_SOFT_GAUSSIAN)
+        scratch.scores[i] *= std::exp(-iou * iou / params.sigma);
+      else if (iou > params.iouThreshold)
+        scratch.scores[i] *= 1 - iou;
+
+      if (scratch.scores[i] >= params.scoreThreshold)
+        scratch.alive[n++] = i;
+    }
+    numAlive = n;
+  }
+}
+
+NvDsInferNmsParams
+NvDsInferNmsDefaultParams(float iouThreshold)
+{
+  NvDsInferNmsParams params;
+
+  params.method = NVDSINFER_NMS_GREEDY;
+  params.iouThreshold = iouThreshold;
+  params.classAware = true;
+  params.preNmsTopK = 0;
+  params.topK = 0;
+  params.sigma = 0.5f;
+  params.scoreThreshold = 0.001f;
+  return params;
+}
+
+float
+NvDsInferNmsIoU(NvDsInferObjectDetectionInfo const &a,
+    NvDsInferObjectDetectionInfo const &b)
+{
+  return nmsIoU(nmsBox(a), nmsBox(b));
+}
+
+void
+NvDsInferNms(std::vector<NvDsInferObjectDetectionInfo> &objects,
+    NvDsInferNmsParams const &params)
+{
+  static thread_local NmsScratch scratch;
+  unsigned int numObjects = objects.size();
+  unsigned int numGroups = 1;
+
+  if (!numObjects)
+    return;
+
+  /* Group the boxes by class, keeping their order */
+  scratch.order.resize(numObjects);
+  if (params.classAware)
+  {
+    for (auto const &object : objects)
+      numGroups = std::max(numGroups, object.classId + 1);
+    scratch.classCount.assign(numGroups + 1, 0);
+    for (auto const &object : objects)
+      scratch.classCount[object.classId + 1]++;
+    for (unsigned int c = 0; c < numGroups; c++)
+      scratch.classCount[c + 1] += scratch.classCount[c];
+    scratch.grouped.assign(scratch.classCount.begin(), scratch.classCount.end());
+    for (unsigned int i = 0; i < numObjects; i++)
+      scratch.order[scratch.grouped[objects[i].classId]++] = i;
+  }
+  else
+  {
+    scratch.classCount.assign({ 0, numObjects });
+    for (unsigned int i = 0; i < numObjects; i++)
+      scratch.order[i] = i;
+  }
+
+  /* Decreasing confidence, ties in input order as with a stable sort */
+  auto byConfidence = [&objects] (unsigned int a, unsigned int b) {
+    if (objects[a].detectionConfidence != objects[b].detectionConfidence)
+      return objects[a].detectionConfidence > objects[b].detectionConfidence;
+    return a < b;
+  };
+
+  scratch.result.clear();
+  for (unsigned int c = 0; c < numGroups; c++)
+  {
+    unsigned int *group = scratch.order.data() + scratch.classCount[c];
+    unsigned int count = scratch.classCount[c + 1] - scratch.classCount[c];
+
+    if (!count)
+      continue;
+    if (params.preNmsTopK && params.preNmsTopK < count)
+    {
+      std::partial_sort(group, group + params.preNmsTopK, group + count,
+          byConfidence);
+      count = params.preNmsTopK;
+    }
+    else
+    {
+      std::sort(group, group + count, byConfidence);
+    }
+
+    switch (params.method)
+    {
+      case NVDSINFER_NMS_BITMASK:
+        if (count <= NVDSINFER_NMS_BITMASK_MAX_BOXES)
+        {
+          nmsBitmask(objects, group, count, params, scratch);
+          break;
+        }
+        nmsGreedy(objects, group, count, params, scratch);
+        break;
+      case NVDSINFER_NMS_SOFT_LINEAR:
+      case NVDSINFER_NMS_SOFT_GAUSSIAN:
+        nmsSoft(objects, group, count, params, scratch);
+        break;
+      default:
+        nmsGreedy(objects, group, count, params, scratch);
+        break;
+    }
+  }
+
+  objects.assign(scratch.result.begin(), scratch.result.end());
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Non maximum suppression of parsed objects, for custom bounding box parsers.
+ * The sources are to be built along with the parser, as done by the sample
+ * detectors (objectDetector_Yolo, objectDetector_FasterRCNN).
+ *
+ * Boxes are visited by decreasing confidence and a box is suppressed if its
+ * IoU with a box kept before is > iouThreshold. IoUs with the kept boxes are
+ * computed 8 (AVX2) or 4 (NEON) at a time. The IoU of two boxes is the one of
+ * the rectangles [left, left + width] x [top, top + height].
+ */
+
+#ifndef __NVDSINFER_NMS_H__
+#define __NVDSINFER_NMS_H__
+
+#include <vector>
+#include "nvdsinfer.h"
+
+/* Built into several libraries, keep each library's copy private to it */
+#pragma GCC visibility push(hidden)
+
+typedef enum
+{
+  /** Greedy NMS, compares each box with the boxes kept so far. */
+  NVDSINFER_NMS_GREEDY = 0,
+  /** Computes a bitmask of the overlapping pairs, then sweeps it. Same result
+   * as greedy. The IoUs do not depend on the boxes kept, but all pairs are
+   * computed: on a single thread greedy is usually faster. Classes (or all
+   * boxes if not class aware) of more than NVDSINFER_NMS_BITMASK_MAX_BOXES
+   * boxes use greedy NMS. */
+  NVDSINFER_NMS_BITMASK,
+  /** Soft-NMS with linear decay: the confidence of a box overlapping a kept
+   * box by IoU > iouThreshold is scaled by 1 - IoU. */
+  NVDSINFER_NMS_SOFT_LINEAR,
+  /** Soft-NMS with gaussian decay: the confidence of every box is scaled by
+   * exp(-IoU^2 / sigma) for each kept box. */
+  NVDSINFER_NMS_SOFT_GAUSSIAN
+} NvDsInferNmsMethod;
+
+#define NVDSINFER_NMS_BITMASK_MAX_BOXES 8192
+
+typedef struct
+{
+  NvDsInferNmsMethod method;
+  /** Boxes overlapping a kept box by more than this IoU are suppressed. */
+  float iouThreshold;
+  /** Only boxes of the same class suppress each other. The result is then
+   * ordered by class, then by decreasing confidence. Otherwise it is ordered
+   * by decreasing confidence. */
+  bool classAware;
+  /** Boxes considered per class (all boxes if not class aware), the ones of
+   * highest confidence. 0 for all. */
+  unsigned int preNmsTopK;
+  /** Max boxes kept per class (all boxes if not class aware). 0 for no limit. */
+  unsigned int topK;
+  /** Soft-NMS: gaussian decay parameter. */
+  float sigma;
+  /** Soft-NMS: boxes whose confidence decays below this are dropped. */
+  float scoreThreshold;
+} NvDsInferNmsParams;
+
+/**
+ * Returns greedy, class aware NMS parameters for @a iouThreshold.
+ */
+NvDsInferNmsParams NvDsInferNmsDefaultParams(float iouThreshold);
+
+/**
+ * Applies NMS to @a objects, which are replaced by the boxes kept. Soft-NMS
+ * updates the confidence of the boxes kept.
+ */
+void NvDsInferNms(std::vector<NvDsInferObjectDetectionInfo> &objects,
+    NvDsInferNmsParams const &params);
+
+/**
+ * Returns the IoU of two boxes, as computed by NvDsInferNms.
+ */
+float NvDsInferNmsIoU(NvDsInferObjectDetectionInfo const &a,
+    NvDsInferObjectDetectionInfo const &b);
+
+#pragma GCC visibility pop
+
+#endif
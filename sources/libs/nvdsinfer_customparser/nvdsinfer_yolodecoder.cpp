@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "nvdsinfer_yolodecoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YOLO_HAVE_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define YOLO_HAVE_NEON 1
+#endif
+
+/* Cells whose objectness is compared at a time, for all the instruction
+ * sets. */
+#define YOLO_LANES 8
+
+/* Kernels over the cells [cell, cell + lanes) of a layer. The vector ones
+ * handle full groups of YOLO_LANES cells and fall back to the scalar ones
+ * for the last cells of a plane. */
+
+/* Returns the mask of the cells whose objectness is above @threshold. */
+typedef unsigned int (*YoloObjectnessMaskFunc)(const float *objectness,
+    unsigned int lanes, float threshold);
+/* Writes the highest class score of the cells of @mask and its class, the
+ * first class of that score, -1 if no score is above 0. */
+typedef void (*YoloClassMaxFunc)(const float *scores, unsigned int numCells,
+    unsigned int numClasses, unsigned int lanes, unsigned int mask,
+    float *maxProb, int *maxIndex);
+
+static unsigned int
+objectnessMaskScalar(const float *objectness, unsigned int lanes,
+    float threshold)
+{
+  unsigned int mask = 0;
+  for (unsigned int lane = 0; lane < lanes; lane++)
+  {
+    if (objectness[lane] > threshold)
+      mask |= 1 << lane;
+  }
+  return mask;
+}
+
+static void
+classMaxScalar(const float *scores, unsigned int numCells,
+    unsigned int numClasses, unsigned int lanes, unsigned int mask,
+    float *maxProb, int *maxIndex)
+{
+  for (unsigned int lane = 0; lane < lanes; lane++)
+  {
+    if (!(mask & (1 << lane)))
+      continue;
+
+    const float *score = scores + lane;
+    float best = 0.0f;
+    int index = -1;
+    for (unsigned int i = 0; i < numClasses; i++, score += numCells)
+    {
+      if (*score > best)
+      {
+        best = *score;
+        index = i;
+      }
+    }
+    maxProb[lane] = best;
+    maxIndex[lane] = index;
+  }
+}
+
+#ifdef YOLO_HAVE_AVX2
+__attribute__((target("avx2")))
+static unsigned int
+objectnessMaskAvx2(const float *objectness, unsigned int lanes,
+    float threshold)
+{
+  if (lanes < YOLO_LANES)
+    return objectnessMaskScalar(objectness, lanes, threshold);
+  return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(objectness),
+      _mm256_set1_ps(threshold), _CMP_GT_OQ));
+}
+
+__attribute__((target("avx2")))
+static void
+classMaxAvx2(const float *scores, unsigned int numCells,
+    unsigned int numClasses, unsigned int lanes, unsigned int mask,
+    float *maxProb, int *maxIndex)
+{
+  if (lanes < YOLO_LANES)
+  {
+    classMaxScalar(scores, numCells, numClasses, lanes, mask, maxProb,
+        maxIndex);
+    return;
+  }
+
+  __m256 best = _mm256_setzero_ps();
+  __m256i index = _mm256_set1_epi32(-1);
+  for (unsigned int i = 0; i < numClasses; i++, scores += numCells)
+  {
+    __m256 score = _mm256_loadu_ps(scores);
+    __m256 greater = _mm256_cmp_ps(score, best, _CMP_GT_OQ);
+    best = _mm256_blendv_ps(best, score, greater);
+    index = _mm256_blendv_epi8(index, _mm256_set1_epi32(i),
+        _mm256_castps_si256(greater));
+  }
+  _mm256_storeu_ps(maxProb, best);
+  _mm256_storeu_si256((__m256i *) maxIndex, index);
+}
+#endif
+
+#ifdef YOLO_HAVE_NEON
+static unsigned int
+objectnessMaskNeon(const float *objectness, unsigned int lanes,
+    float threshold)
+{
+  static const uint32_t bitsInit[4] = { 1, 2, 4, 8 };
+  const float32x4_t vthreshold = vdupq_n_f32(threshold);
+  const uint32x4_t bits = vld1q_u32(bitsInit);
+
+  if (lanes < YOLO_LANES)
+    return objectnessMaskScalar(objectness, lanes, threshold);
+  return vaddvq_u32(vandq_u32(vcgtq_f32(vld1q_f32(objectness), vthreshold),
+          bits)) |
+      vaddvq_u32(vandq_u32(vcgtq_f32(vld1q_f32(objectness + 4), vthreshold),
+          bits)) << 4;
+}
+
+static void
+classMaxNeon(const float *scores, unsigned int numCells,
+    unsigned int numClasses, unsigned int lanes, unsigned int mask,
+    float *maxProb, int *maxIndex)
+{
+  if (lanes < YOLO_LANES)
+  {
+    classMaxScalar(scores, numCells, numClasses, lanes, mask, maxProb,
+        maxIndex);
+    return;
+  }
+
+  float32x4_t best0 = vdupq_n_f32(0), best1 = vdupq_n_f32(0);
+  int32x4_t index0 = vdupq_n_s32(-1), index1 = vdupq_n_s32(-1);
+  for (unsigned int i = 0; i < numClasses; i++, scores += numCells)
+  {
+    float32x4_t score0 = vld1q_f32(scores), score1 = vld1q_f32(scores + 4);
+    uint32x4_t greater0 = vcgtq_f32(score0, best0);
+    uint32x4_t greater1 = vcgtq_f32(score1, best1);
+    int32x4_t vi = vdupq_n_s32(i);
+    best0 = vbslq_f32(greater0, score0, best0);
+    best1 = vbslq_f32(greater1, score1, best1);
+    index0 = vbslq_s32(greater0, vi, index0);
+    index1 = vbslq_s32(greater1, vi, index1);
+  }
+  vst1q_f32(maxProb, best0);
+  vst1q_f32(maxProb + 4, best1);
+  vst1q_s32(maxIndex, index0);
+  vst1q_s32(maxIndex + 4, index1);
+}
+#endif
+
+static unsigned int
+clampCoordinate(unsigned int val, unsigned int minVal, unsigned int maxVal)
+{
+  return std::min(maxVal, std::max(minVal, val));
+}
+
+/* Box of a cell in pixels of the network input, as the Yolo sample parser
+ * converts it. */
+static void
+addBox(float bx, float by, float bw, float bh, unsigned int stride,
+    unsigned int netW, unsigned int netH, int maxIndex, float maxProb,
+    std::vector<NvDsInferParseObjectInfo> &objects)
+{
+  NvDsInferParseObjectInfo b;
+  float x = bx * stride;
+  float y = by * stride;
+
+  b.left = x - bw / 2;
+  b.width = bw;
+  b.top = y - bh / 2;
+  b.height = bh;
+
+  b.left = clampCoordinate(b.left, 0, netW);
+  b.width = clampCoordinate(b.width, 0, netW);
+  b.top = clampCoordinate(b.top, 0, netH);
+  b.height = clampCoordinate(b.height, 0, netH);
+  if (((b.left + b.width) > netW) || ((b.top + b.height) > netH))
+    return;
+
+  b.detectionConfidence = maxProb;
+  b.classId = maxIndex;
+  objects.push_back(b);
+}
+
+NvDsInferYoloLayer
+NvDsInferYoloLayerV2(unsigned int gridSize, unsigned int stride,
+    unsigned int numBBoxes, unsigned int numClasses,
+    std::vector<float> const &anchors)
+{
+  NvDsInferYoloLayer layer = {};
+
+  layer.gridSize = gridSize;
+  layer.stride = stride;
+  layer.numClasses = numClasses;
+  layer.logSizes = true;
+  if (numBBoxes > NVDSINFER_YOLO_MAX_BBOXES || anchors.size() < 2 * numBBoxes)
+    return layer;
+
+  layer.numBBoxes = numBBoxes;
+  std::copy(anchors.begin(), anchors.begin() + 2 * numBBoxes, layer.anchors);
+  return layer;
+}
+
+NvDsInferYoloLayer
+NvDsInferYoloLayerV3(unsigned int gridSize, unsigned int stride,
+    unsigned int numClasses, std::vector<float> const &anchors,
+    std::vector<int> const &mask)
+{
+  NvDsInferYoloLayer layer = {};
+
+  layer.gridSize = gridSize;
+  layer.stride = stride;
+  layer.numClasses = numClasses;
+  layer.logSizes = false;
+  if (mask.size() > NVDSINFER_YOLO_MAX_BBOXES)
+    return layer;
+  for (int anchor : mask)
+  {
+    if (anchor < 0 || 2 * (size_t) anchor + 1 >= anchors.size())
+      return layer;
+  }
+
+  layer.numBBoxes = mask.size();
+  for (unsigned int b = 0; b < layer.numBBoxes; b++)
+  {
+    layer.anchors[2 * b] = anchors[mask[b] * 2];
+    layer.anchors[2 * b + 1] = anchors[mask[b] * 2 + 1];
+  }
+  return layer;
+}
+
+unsigned int
+NvDsInferYoloDecode(const float *detections, NvDsInferYoloLayer const &layer,
+    float probThresh, unsigned int netW, unsigned int netH,
+    std::vector<NvDsInferParseObjectInfo> &objects, NvDsInferGridIsa isa)
+{
+  YoloObjectnessMaskFunc objectnessMask = objectnessMaskScalar;
+  YoloClassMaxFunc classMax = classMaxScalar;
+  unsigned int numCells = layer.gridSize * layer.gridSize;
+  size_t boxSize = (size_t) (5 + layer.numClasses) * numCells;
+  size_t numObjects = objects.size();
+  unsigned int candidates[NVDSINFER_YOLO_MAX_BBOXES];
+  float maxProb[NVDSINFER_YOLO_MAX_BBOXES][YOLO_LANES];
+  int maxIndex[NVDSINFER_YOLO_MAX_BBOXES][YOLO_LANES];
+
+#ifdef YOLO_HAVE_AVX2
+  if (isa == NVDSINFER_GRID_ISA_AVX2)
+  {
+    objectnessMask = objectnessMaskAvx2;
+    classMax = classMaxAvx2;
+  }
+#endif
+#ifdef YOLO_HAVE_NEON
+  if (isa == NVDSINFER_GRID_ISA_NEON)
+  {
+    objectnessMask = objectnessMaskNeon;
+    classMax = classMaxNeon;
+  }
+#endif
+
+  for (unsigned int cell = 0; cell < numCells; cell += YOLO_LANES)
+  {
+    unsigned int lanes = std::min((unsigned int) YOLO_LANES, numCells - cell);
+    unsigned int any = 0;
+
+    for (unsigned int b = 0; b < layer.numBBoxes; b++)
+    {
+      const float *box = detections + b * boxSize;
+      candidates[b] = objectnessMask(box + 4 * numCells + cell, lanes,
+          probThresh);
+      any |= candidates[b];
+    }
+    if (!any)
+      continue;
+
+    for (unsigned int b = 0; b < layer.numBBoxes; b++)
+    {
+      if (candidates[b])
+        classMax(detections + b * boxSize + 5 * numCells + cell, numCells,
+            layer.numClasses, lanes, candidates[b], maxProb[b], maxIndex[b]);
+    }
+
+    /* Boxes in the order of the cells, as the parser decoded them */
+    for (unsigned int lane = 0; lane < lanes; lane++)
+    {
+      unsigned int c = cell + lane;
+      unsigned int x = c % layer.gridSize;
+      unsigned int y = c / layer.gridSize;
+
+      for (unsigned int b = 0; b < layer.numBBoxes; b++)
+      {
+        if (!(candidates[b] & (1 << lane)))
+          continue;
+
+        const float *box = detections + b * boxSize + c;
+        const float pw = layer.anchors[b * 2];
+        const float ph = layer.anchors[b * 2 + 1];
+        const float bx = x + box[0];
+        const float by = y + box[numCells];
+        /* exp of double, as the parser computed it */
+        const float bw = layer.logSizes ?
+            pw * std::exp((double) box[2 * numCells]) : pw * box[2 * numCells];
+        const float bh = layer.logSizes ?
+            ph * std::exp((double) box[3 * numCells]) : ph * box[3 * numCells];
+        const float prob = box[4 * numCells] * maxProb[b][lane];
+
+        if (prob > probThresh)
+          addBox(bx, by, bw, bh, layer.stride, netW, netH,
+              maxIndex[b][lane], prob, objects);
+      }
+    }
+  }
+  return objects.size() - numObjects;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Decoding of the output layers of Yolo networks (region layer of YoloV2,
+ * yolo layers of YoloV3) into boxes, for the Yolo sample parser. The sources
+ * are to be built along with the parser, as the NMS.
+ *
+ * A layer holds, for each box of each cell, x, y, w, h, the objectness and
+ * the class scores, each as a plane of gridSize x gridSize floats. The
+ * confidence of a box is its objectness times its highest class score, so a
+ * box whose objectness is not above the threshold cannot meet it: the
+ * objectness of 8 cells is compared at a time and the class scores are only
+ * read for the cells meeting it, 8 (AVX2) or 4 (NEON) cells at a time. The
+ * instruction set is picked as for the grid parser (NVDSINFER_GRID_ISA).
+ */
+
+#ifndef __NVDSINFER_YOLODECODER_H__
+#define __NVDSINFER_YOLODECODER_H__
+
+#include <vector>
+
+#include "nvdsinfer.h"
+#include "nvdsinfer_gridparser.h"
+
+/* Built into several libraries, keep each library's copy private to it */
+#pragma GCC visibility push(hidden)
+
+#define NVDSINFER_YOLO_MAX_BBOXES 16
+
+/**
+ * Output layer of a Yolo network, with the anchors of its boxes looked up.
+ */
+typedef struct
+{
+  /** Cells per row and per column. */
+  unsigned int gridSize;
+  /** Pixels of the network input per cell. */
+  unsigned int stride;
+  unsigned int numBBoxes;
+  unsigned int numClasses;
+  /** Width and height of the anchor of each box, in pixels. */
+  float anchors[2 * NVDSINFER_YOLO_MAX_BBOXES];
+  /** The sizes are logs of anchor scales (region layer of YoloV2), else the
+   * scales themselves (the yolo layer plugin of YoloV3 computes them). */
+  bool logSizes;
+} NvDsInferYoloLayer;
+
+/**
+ * Returns the YoloV2 region layer of @a numBBoxes boxes of anchors
+ * @a anchors (width, height of each box, in cells) with @a numClasses
+ * classes, or a layer of 0 boxes if there are more than
+ * NVDSINFER_YOLO_MAX_BBOXES.
+ */
+NvDsInferYoloLayer NvDsInferYoloLayerV2(unsigned int gridSize,
+    unsigned int stride, unsigned int numBBoxes, unsigned int numClasses,
+    std::vector<float> const &anchors);
+
+/**
+ * Returns the YoloV3 layer whose boxes have the anchors @a mask of
+ * @a anchors (width, height of each anchor, in pixels).
+ */
+NvDsInferYoloLayer NvDsInferYoloLayerV3(unsigned int gridSize,
+    unsigned int stride, unsigned int numClasses,
+    std::vector<float> const &anchors, std::vector<int> const &mask);
+
+/**
+ * Appends to @a objects the boxes of @a layer (@a detections) of confidence
+ * above @a probThresh, clamped to the network input @a netW x @a netH, in the
+ * order of the cells then of the boxes of a cell. The class scores must be
+ * probabilities (at most 1) and @a probThresh must be >= 0.
+ *
+ * @return number of boxes appended.
+ */
+unsigned int NvDsInferYoloDecode(const float *detections,
+    NvDsInferYoloLayer const &layer, float probThresh, unsigned int netW,
+    unsigned int netH, std::vector<NvDsInferParseObjectInfo> &objects,
+    NvDsInferGridIsa isa = NvDsInferGridDefaultIsa());
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks the top-K selection against the single label parsing loop it
+ * replaces and against a full sort, and the softmax and sigmoid of every
+ * instruction set supported by the CPU against double precision, then times
+ * them on 1000 class layers.
+ *
+ * Usage: test_classifierparser [iterations]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include "nvdsinfer_classifierparser.h"
+
+#define NUM_CLASSES 1000
+#define DEFAULT_ITERATIONS 20000
+
+static const char *isaNames[] = { "scalar", "avx2", "neon" };
+
+/* Class kept by parseAttributesFromSoftmaxLayers before. */
+static bool
+referenceTop1 (const float *probabilities, unsigned int numClasses,
+    float threshold, NvDsInferAttribute &attr)
+{
+  float maxProbability = 0;
+  bool attrFound = false;
+
+  for (unsigned int c = 0; c < numClasses; c++)
+  {
+    float probability = probabilities[c];
+    if (probability > threshold && probability > maxProbability)
+    {
+      maxProbability = probability;
+      attrFound = true;
+      attr.attributeIndex = 0;
+      attr.attributeValue = c;
+      attr.attributeConfidence = probability;
+    }
+  }
+  return attrFound;
+}
+
+/* Every class above the threshold, sorted, truncated to topK. */
+static std::vector<NvDsInferAttribute>
+referenceTopK (const float *probabilities, unsigned int numClasses,
+    unsigned int topK, float threshold)
+{
+  std::vector<NvDsInferAttribute> attributes;
+
+  for (unsigned int c = 0; c < numClasses; c++)
+  {
+    if (probabilities[c] > threshold && probabilities[c] > 0)
+      attributes.push_back ({ 0, c, probabilities[c], nullptr });
+  }
+  std::stable_sort (attributes.begin (), attributes.end (),
+      [](NvDsInferAttribute const &a, NvDsInferAttribute const &b) {
+        return a.attributeConfidence > b.attributeConfidence;
+      });
+  if (attributes.size () > topK)
+    attributes.resize (topK);
+  return attributes;
+}
+
+static bool
+sameAttributes (std::vector<NvDsInferAttribute> const &a,
+    std::vector<NvDsInferAttribute> const &b)
+{
+  if (a.size () != b.size ())
+    return false;
+  for (size_t i = 0; i < a.size (); i++)
+  {
+    if (a[i].attributeIndex != b[i].attributeIndex ||
+        a[i].attributeValue != b[i].attributeValue ||
+        a[i].attributeConfidence != b[i].attributeConfidence)
+      return false;
+  }
+  return true;
+}
+
+/* Probabilities quantized so that ties occur, with a few NaNs. */
+static void
+fillProbabilities (std::mt19937 &rng, std::vector<float> &probabilities)
+{
+  std::uniform_real_distribution<float> uniform (0, 1);
+
+  for (float &p : probabilities)
+    p = (int) (uniform (rng) * 64) / 64.0f;
+  if (rng () % 4 == 0)
+    probabilities[rng () % probabilities.size ()] =
+        std::numeric_limits<float>::quiet_NaN ();
+}
+
+static bool
+checkTopK (std::mt19937 &rng)
+{
+  for (unsigned int numClasses : { 1u, 6u, 37u, (unsigned int) NUM_CLASSES })
+  {
+    std::vector<float> probabilities (numClasses);
+    for (unsigned int trial = 0; trial < 50; trial++)
+    {
+      fillProbabilities (rng, probabilities);
+      for (float threshold : { 0.0f, 0.3f, 0.9f, 1.0f })
+      {
+        std::vector<NvDsInferAttribute> attributes;
+        NvDsInferAttribute attr;
+
+        NvDsInferClassifierTopK (probabilities.data (), numClasses, 1,
+            threshold, 0, attributes);
+        bool found = referenceTop1 (probabilities.data (), numClasses,
+            threshold, attr);
+        if (attributes.size () != found || (found &&
+              !sameAttributes (attributes, { attr })))
+        {
+          printf ("%u classes threshold %.2f: top-1 differs from the "
+              "single label parsing\n", numClasses, threshold);
+          return false;
+        }
+
+        for (unsigned int topK : { 2u, 5u, 16u, 17u, 100u, numClasses })
+        {
+          attributes.clear ();
+          NvDsInferClassifierTopK (probabilities.data (), numClasses, topK,
+              threshold, 0, attributes);
+          if (!sameAttributes (attributes, referenceTopK (probabilities.data (),
+                    numClasses, topK, threshold)))
+          {
+            printf ("%u classes threshold %.2f: top-%u differs from the "
+                "sorted classes\n", numClasses, threshold, topK);
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static bool
+checkActivation (std::mt19937 &rng, NvDsInferGridIsa isa)
+{
+  std::normal_distribution<float> logit (0, 4);
+
+  for (unsigned int count : { 1u, 3u, 7u, 8u, 9u, 31u, (unsigned int) NUM_CLASSES,
+      NUM_CLASSES + 3u })
+  {
+    std::vector<float> input (count), output (count);
+    for (unsigned int trial = 0; trial < 20; trial++)
+    {
+      for (float &x : input)
+        x = logit (rng);
+      /* Logits whose exponentials overflow a float */
+      if (trial % 4 == 0)
+        input[rng () % count] = trial % 8 ? 200.0f : -200.0f;
+
+      double maxInput = *std::max_element (input.begin (), input.end ());
+      double sum = 0;
+      for (float x : input)
+        sum += exp (x - maxInput);
+
+      NvDsInferClassifierActivate (input.data (), count,
+          NvDsInferClassifierActivation_Softmax, output.data (), isa);
+      for (unsigned int i = 0; i < count; i++)
+      {
+        double expected = exp (input[i] - maxInput) / sum;
+        if (fabs (output[i] - expected) > 1e-6 + 1e-5 * expected)
+        {
+          printf ("%s: softmax of %u logits is %g instead of %g\n",
+              isaNames[isa], count, output[i], expected);
+          return false;
+        }
+      }
+
+      /* In place */
+      output = input;
+      NvDsInferClassifierActivate (output.data (), count,
+          NvDsInferClassifierActivation_Sigmoid, output.data (), isa);
+      for (unsigned int i = 0; i < count; i++)
+      {
+        double expected = 1 / (1 + exp (-(double) input[i]));
+        if (fabs (output[i] - expected) > 1e-6 + 1e-5 * expected)
+        {
+          printf ("%s: sigmoid of %g is %g instead of %g\n", isaNames[isa],
+              input[i], output[i], expected);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <typename Func>
+static double
+timeNs (unsigned int iterations, Func func)
+{
+  auto start = std::chrono::steady_clock::now ();
+  for (unsigned int i = 0; i < iterations; i++)
+    func ();
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::nano> (end - start).count () /
+      iterations;
+}
+
+int main (int argc, char *argv[])
+{
+  unsigned int iterations = argc > 1 ? atoi (argv[1]) : DEFAULT_ITERATIONS;
+  std::mt19937 rng (1234);
+  std::normal_distribution<float> logit (0, 4);
+  std::vector<float> logits (NUM_CLASSES), probabilities (NUM_CLASSES);
+  std::vector<NvDsInferAttribute> attributes;
+  std::string attrString;
+  NvDsInferAttribute attr;
+  bool ok = checkTopK (rng);
+
+  for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+  {
+    if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+      continue;
+    if (!checkActivation (rng, (NvDsInferGridIsa) isa))
+      ok = false;
+  }
+  if (!ok)
+  {
+    printf ("FAILED\n");
+    return -1;
+  }
+  printf ("Top-K and activations: OK\n");
+
+  for (float &x : logits)
+    x = logit (rng);
+  NvDsInferClassifierActivate (logits.data (), NUM_CLASSES,
+      NvDsInferClassifierActivation_Softmax, probabilities.data (),
+      NVDSINFER_GRID_ISA_SCALAR);
+
+  printf ("%d class layer, %u iterations:\n", NUM_CLASSES, iterations);
+  printf ("  single label loop  %8.1f ns\n", timeNs (iterations, [&]() {
+        referenceTop1 (probabilities.data (), NUM_CLASSES, 0.01f, attr);
+        asm volatile ("" : : "r" (&attr) : "memory");
+      }));
+  for (unsigned int topK : { 1u, 5u, 100u })
+  {
+    printf ("  top-%-3u            %8.1f ns\n", topK, timeNs (iterations, [&]() {
+          attributes.clear ();
+          NvDsInferClassifierTopK (probabilities.data (), NUM_CLASSES, topK,
+              0.01f, 0, attributes);
+        }));
+  }
+  for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+  {
+    if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+      continue;
+    printf ("  softmax (%-6s)   %8.1f ns\n", isaNames[isa],
+        timeNs (iterations, [&]() {
+          NvDsInferClassifierActivate (logits.data (), NUM_CLASSES,
+              NvDsInferClassifierActivation_Softmax, probabilities.data (),
+              (NvDsInferGridIsa) isa);
+        }));
+    printf ("  sigmoid (%-6s)   %8.1f ns\n", isaNames[isa],
+        timeNs (iterations, [&]() {
+          NvDsInferClassifierActivate (logits.data (), NUM_CLASSES,
+              NvDsInferClassifierActivation_Sigmoid, probabilities.data (),
+              (NvDsInferGridIsa) isa);
+        }));
+  }
+
+  /* Description of the attributes: built anew for each object as the parsers
+   * did, or in a reused string. */
+  attributes.assign (5, { 0, 0, 0.5f, "largevehicle" });
+  printf ("  label, new string  %8.1f ns\n", timeNs (iterations, [&]() {
+        std::string descString;
+        for (auto const &a : attributes)
+          descString.append (a.attributeLabel).append (" ");
+        char *label = strdup (descString.c_str ());
+        asm volatile ("" : : "r" (label) : "memory");
+        free (label);
+      }));
+  printf ("  label, reused      %8.1f ns\n", timeNs (iterations, [&]() {
+        attrString.clear ();
+        for (auto const &a : attributes)
+          attrString.append (a.attributeLabel).append (" ");
+        asm volatile ("" : : "r" (&attrString[0]) : "memory");
+      }));
+
+  return 0;
+}
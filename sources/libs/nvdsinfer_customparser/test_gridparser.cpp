@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that the grid thresholding of every instruction set supported by
+ * the CPU, and NvDsInferParseCustomResnet using it, as a parsing function and
+ * as a parser instance, give bit-exact results of the scalar per-cell parsing
+ * they replace, then times them.
+ *
+ * Usage: test_gridparser [iterations]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_gridparser.h"
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+#define CLIP(a,min,max) (MAX(MIN(a, max), min))
+#define DIVIDE_AND_ROUND_UP(a, b) ((a + b - 1) / b)
+
+/* Resnet10 sample model at 960x544 */
+#define NET_WIDTH 960
+#define NET_HEIGHT 544
+#define GRID_W 60
+#define GRID_H 34
+#define NUM_CLASSES 4
+#define DEFAULT_ITERATIONS 20000
+
+extern "C"
+bool NvDsInferParseCustomResnet (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+extern "C"
+NvDsInferParserHandle NvDsInferParseCustomResnetCreate (
+    NvDsInferParserInitParams const &initParams);
+
+extern "C"
+bool NvDsInferParseCustomResnetParse (NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+extern "C"
+void NvDsInferParseCustomResnetDestroy (NvDsInferParserHandle handle);
+
+static const char *isaNames[] = { "scalar", "avx2", "neon" };
+
+/* Parsing loop of NvDsInferParseCustomResnet before the grid thresholding */
+static void
+parseResnetReference (const float *outputCovBuf, const float *outputBboxBuf,
+    NvDsInferNetworkInfo const &networkInfo,
+    NvDsInferParseDetectionParams const &detectionParams,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  int gridW = GRID_W;
+  int gridH = GRID_H;
+  int gridSize = gridW * gridH;
+  float gcCentersX[gridW];
+  float gcCentersY[gridH];
+  float bboxNormX = 35.0;
+  float bboxNormY = 35.0;
+  int strideX = DIVIDE_AND_ROUND_UP(networkInfo.width, GRID_W);
+  int strideY = DIVIDE_AND_ROUND_UP(networkInfo.height, GRID_H);
+
+  for (int i = 0; i < gridW; i++)
+  {
+    gcCentersX[i] = (float)(i * strideX + 0.5);
+    gcCentersX[i] /= (float)bboxNormX;
+  }
+  for (int i = 0; i < gridH; i++)
+  {
+    gcCentersY[i] = (float)(i * strideY + 0.5);
+    gcCentersY[i] /= (float)bboxNormY;
+  }
+
+  for (int c = 0; c < NUM_CLASSES; c++)
+  {
+    const float *outputX1 = outputBboxBuf + (c * 4 * GRID_H * GRID_W);
+    const float *outputY1 = outputX1 + gridSize;
+    const float *outputX2 = outputY1 + gridSize;
+    const float *outputY2 = outputX2 + gridSize;
+
+    float threshold = detectionParams.perClassThreshold[c];
+    for (int h = 0; h < gridH; h++)
+    {
+      for (int w = 0; w < gridW; w++)
+      {
+        int i = w + h * gridW;
+        if (outputCovBuf[c * gridSize + i] >= threshold)
+        {
+          NvDsInferObjectDetectionInfo object;
+          float rectX1f, rectY1f, rectX2f, rectY2f;
+
+          rectX1f = (outputX1[w + h * gridW] - gcCentersX[w]) * -bboxNormX;
+          rectY1f = (outputY1[w + h * gridW] - gcCentersY[h]) * -bboxNormY;
+          rectX2f = (outputX2[w + h * gridW] + gcCentersX[w]) * bboxNormX;
+          rectY2f = (outputY2[w + h * gridW] + gcCentersY[h]) * bboxNormY;
+
+          object.classId = c;
+          object.detectionConfidence = outputCovBuf[c * gridSize + i];
+
+          object.left = CLIP(rectX1f, 0, networkInfo.width - 1);
+          object.top = CLIP(rectY1f, 0, networkInfo.height - 1);
+          object.width = CLIP(rectX2f, 0, networkInfo.width - 1) -
+                             object.left + 1;
+          object.height = CLIP(rectY2f, 0, networkInfo.height - 1) -
+                             object.top + 1;
+
+          objectList.push_back(object);
+        }
+      }
+    }
+  }
+}
+
+/* Coverage with @density of the cells around @threshold, including values
+ * equal to it and special values. */
+static void
+fillCoverage (std::mt19937 &rng, float *coverage, unsigned int numCells,
+    float threshold, float density)
+{
+  std::uniform_real_distribution<float> uniform (0, 1);
+  static const float special[] = { 0.0f, -0.0f, 1.0f,
+    std::numeric_limits<float>::quiet_NaN (),
+    std::numeric_limits<float>::infinity (),
+    -std::numeric_limits<float>::infinity (),
+    std::numeric_limits<float>::denorm_min () };
+
+  for (unsigned int i = 0; i < numCells; i++)
+  {
+    float r = uniform (rng);
+    if (r < density)
+      coverage[i] = threshold + (1 - threshold) * uniform (rng);
+    else if (r < density * 2)
+      coverage[i] = threshold;
+    else if (r < density * 2 + 0.01f)
+      coverage[i] = special[rng () % (sizeof (special) / sizeof (special[0]))];
+    else
+      coverage[i] = threshold * uniform (rng);
+  }
+}
+
+static bool
+sameBits (float a, float b)
+{
+  return !memcmp (&a, &b, sizeof (float));
+}
+
+static bool
+checkThreshold (std::mt19937 &rng, NvDsInferGridIsa isa)
+{
+  NvDsInferGridCandidates candidates;
+  static const float thresholds[] = { 0.0f, 0.2f, 0.5f, 1.0f };
+  std::vector<float> coverage;
+
+  for (unsigned int numCells = 0; numCells < 300; numCells++)
+  {
+    for (float threshold : thresholds)
+    {
+      for (float density : { 0.0f, 0.01f, 0.3f, 1.0f })
+      {
+        coverage.resize (numCells);
+        fillCoverage (rng, coverage.data (), numCells, threshold, density);
+        /* offset to test unaligned rows */
+        unsigned int offset = numCells & 3;
+        unsigned int count = NvDsInferGridThreshold (coverage.data () + offset,
+            numCells - MIN (offset, numCells), threshold, candidates, isa);
+        unsigned int j = 0;
+
+        for (unsigned int i = 0; i + offset < numCells; i++)
+        {
+          if (!(coverage[i + offset] >= threshold))
+            continue;
+          if (j >= count || candidates.cells[j] != i ||
+              !sameBits (candidates.confidence[j], coverage[i + offset]))
+          {
+            printf ("%s: candidate %u of %u cells differs\n", isaNames[isa], j,
+                numCells);
+            return false;
+          }
+          j++;
+        }
+        if (j != count)
+        {
+          printf ("%s: %u candidates instead of %u for %u cells\n",
+              isaNames[isa], count, j, numCells);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static bool
+sameObjects (std::vector<NvDsInferObjectDetectionInfo> const &a,
+    std::vector<NvDsInferObjectDetectionInfo> const &b)
+{
+  if (a.size () != b.size ())
+    return false;
+  for (size_t i = 0; i < a.size (); i++)
+  {
+    if (a[i].classId != b[i].classId || a[i].left != b[i].left ||
+        a[i].top != b[i].top || a[i].width != b[i].width ||
+        a[i].height != b[i].height ||
+        !sameBits (a[i].detectionConfidence, b[i].detectionConfidence))
+      return false;
+  }
+  return true;
+}
+
+template <typename Func>
+static double
+timeNs (unsigned int iterations, Func func)
+{
+  auto start = std::chrono::steady_clock::now ();
+  for (unsigned int i = 0; i < iterations; i++)
+    func ();
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::nano> (end - start).count () / iterations;
+}
+
+int main (int argc, char *argv[])
+{
+  unsigned int iterations = argc > 1 ? atoi (argv[1]) : DEFAULT_ITERATIONS;
+  unsigned int gridSize = GRID_W * GRID_H;
+  std::mt19937 rng (1234);
+  std::uniform_real_distribution<float> uniform (-2, 2);
+  std::vector<float> coverage (NUM_CLASSES * gridSize);
+  std::vector<float> bbox (NUM_CLASSES * 4 * gridSize);
+  std::vector<NvDsInferLayerInfo> layers (2);
+  NvDsInferNetworkInfo networkInfo = { NET_WIDTH, NET_HEIGHT, 3 };
+  NvDsInferParseDetectionParams detectionParams;
+  NvDsInferParserInitParams parserParams;
+  NvDsInferParserHandle parser;
+  std::vector<NvDsInferObjectDetectionInfo> objects, instanceObjects, reference;
+  NvDsInferGridCandidates candidates;
+  bool ok = true;
+
+  for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+  {
+    if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+      continue;
+    if (!checkThreshold (rng, (NvDsInferGridIsa) isa))
+      ok = false;
+  }
+
+  /* Full parser, with the default instruction set */
+  detectionParams.numClassesConfigured = NUM_CLASSES;
+  detectionParams.perClassThreshold = { 0.2f, 0.5f, 0.0f, 1.0f };
+  layers[0].layerName = "conv2d_bbox";
+  layers[0].buffer = bbox.data ();
+  layers[0].dims = { 3, { NUM_CLASSES * 4, GRID_H, GRID_W }, NUM_CLASSES * 4 * gridSize };
+  layers[1].layerName = "conv2d_cov/Sigmoid";
+  layers[1].buffer = coverage.data ();
+  layers[1].dims = { 3, { NUM_CLASSES, GRID_H, GRID_W }, NUM_CLASSES * gridSize };
+
+  parserParams.outputLayersInfo = layers;
+  parserParams.networkInfo = networkInfo;
+  parserParams.detectionParams = detectionParams;
+  parser = NvDsInferParseCustomResnetCreate (parserParams);
+  if (!parser)
+  {
+    printf ("NvDsInferParseCustomResnetCreate failed\nFAILED\n");
+    return -1;
+  }
+
+  for (unsigned int round = 0; round < 50 && ok; round++)
+  {
+    for (unsigned int c = 0; c < NUM_CLASSES; c++)
+      fillCoverage (rng, coverage.data () + c * gridSize, gridSize,
+          detectionParams.perClassThreshold[c], round % 2 ? 0.01f : 0.2f);
+    for (float &v : bbox)
+      v = uniform (rng) * (round % 3 ? 1 : 100);
+
+    objects.clear ();
+    instanceObjects.clear ();
+    reference.clear ();
+    NvDsInferParseCustomResnet (layers, networkInfo, detectionParams, objects);
+    NvDsInferParseCustomResnetParse (parser, layers, instanceObjects);
+    parseResnetReference (coverage.data (), bbox.data (), networkInfo,
+        detectionParams, reference);
+    if (!sameObjects (objects, reference))
+    {
+      printf ("NvDsInferParseCustomResnet: objects differ in round %u\n", round);
+      ok = false;
+    }
+    if (!sameObjects (instanceObjects, reference))
+    {
+      printf ("NvDsInferParseCustomResnetParse: objects differ in round %u\n",
+          round);
+      ok = false;
+    }
+  }
+  NvDsInferParseCustomResnetDestroy (parser);
+
+  if (!ok)
+  {
+    printf ("FAILED\n");
+    return -1;
+  }
+  printf ("bit-exact: OK (default %s)\n", isaNames[NvDsInferGridDefaultIsa ()]);
+
+  /* Typical frame: about 1% of the cells above the threshold */
+  detectionParams.perClassThreshold = { 0.2f, 0.2f, 0.2f, 0.2f };
+  for (unsigned int c = 0; c < NUM_CLASSES; c++)
+    fillCoverage (rng, coverage.data () + c * gridSize, gridSize, 0.2f, 0.005f);
+
+  printf ("%ux%u grid, %u classes, %u iterations:\n", GRID_W, GRID_H,
+      NUM_CLASSES, iterations);
+  for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+  {
+    if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+      continue;
+    double ns = timeNs (iterations, [&] () {
+      for (unsigned int c = 0; c < NUM_CLASSES; c++)
+        NvDsInferGridThreshold (coverage.data () + c * gridSize, gridSize,
+            0.2f, candidates, (NvDsInferGridIsa) isa);
+    });
+    printf ("  threshold %-6s  %8.0f ns/frame\n", isaNames[isa], ns);
+  }
+  double ns = timeNs (iterations, [&] () {
+    reference.clear ();
+    parseResnetReference (coverage.data (), bbox.data (), networkInfo,
+        detectionParams, reference);
+  });
+  printf ("  parse per cell    %8.0f ns/frame\n", ns);
+  ns = timeNs (iterations, [&] () {
+    objects.clear ();
+    NvDsInferParseCustomResnet (layers, networkInfo, detectionParams, objects);
+  });
+  printf ("  parse grid        %8.0f ns/frame (%zu objects)\n", ns, objects.size ());
+
+  /* Same thresholds for the instance as for the parsing function */
+  parserParams.detectionParams = detectionParams;
+  parser = NvDsInferParseCustomResnetCreate (parserParams);
+  ns = timeNs (iterations, [&] () {
+    objects.clear ();
+    NvDsInferParseCustomResnetParse (parser, layers, objects);
+  });
+  NvDsInferParseCustomResnetDestroy (parser);
+  printf ("  parse instance    %8.0f ns/frame (%zu objects)\n", ns, objects.size ());
+
+  return 0;
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that the greedy and bitmask NMS give the results of the NMS of the
+ * Yolo sample parser they replace, and soft-NMS the ones of a plain
+ * implementation, then times them for 1k, 10k and 50k boxes.
+ *
+ * Usage: test_nms [scale of the iterations]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "nvdsinfer_nms.h"
+
+#define FRAME_WIDTH 1920
+#define FRAME_HEIGHT 1080
+#define NUM_CLASSES 80
+
+/* NMS of nvdsparsebbox_Yolo.cpp before the NMS library */
+static std::vector<NvDsInferParseObjectInfo>
+nonMaximumSuppressionReference (const float nmsThresh,
+    std::vector<NvDsInferParseObjectInfo> binfo)
+{
+  auto overlap1D = [](float x1min, float x1max, float x2min, float x2max) -> float {
+    if (x1min > x2min)
+    {
+      std::swap (x1min, x2min);
+      std::swap (x1max, x2max);
+    }
+    return x1max < x2min ? 0 : std::min (x1max, x2max) - x2min;
+  };
+  auto computeIoU = [&overlap1D](NvDsInferParseObjectInfo& bbox1,
+      NvDsInferParseObjectInfo& bbox2) -> float {
+    float overlapX = overlap1D (bbox1.left, bbox1.left + bbox1.width,
+        bbox2.left, bbox2.left + bbox2.width);
+    float overlapY = overlap1D (bbox1.top, bbox1.top + bbox1.height,
+        bbox2.top, bbox2.top + bbox2.height);
+    float area1 = (bbox1.width) * (bbox1.height);
+    float area2 = (bbox2.width) * (bbox2.height);
+    float overlap2D = overlapX * overlapY;
+    float u = area1 + area2 - overlap2D;
+    return u == 0 ? 0 : overlap2D / u;
+  };
+
+  std::stable_sort (binfo.begin (), binfo.end (),
+      [](const NvDsInferParseObjectInfo& b1, const NvDsInferParseObjectInfo& b2) {
+        return b1.detectionConfidence > b2.detectionConfidence;
+      });
+  std::vector<NvDsInferParseObjectInfo> out;
+  for (auto i : binfo)
+  {
+    bool keep = true;
+    for (auto j : out)
+    {
+      if (keep)
+      {
+        float overlap = computeIoU (i, j);
+        keep = overlap <= nmsThresh;
+      }
+      else
+        break;
+    }
+    if (keep) out.push_back (i);
+  }
+  return out;
+}
+
+/* NMS with the options of NvDsInferNmsParams, on top of the reference */
+static std::vector<NvDsInferParseObjectInfo>
+nmsReference (std::vector<NvDsInferParseObjectInfo> const &binfo,
+    NvDsInferNmsParams const &params)
+{
+  std::vector<NvDsInferParseObjectInfo> result;
+  std::vector<std::vector<NvDsInferParseObjectInfo>> splitBoxes (NUM_CLASSES);
+
+  for (auto& box : binfo)
+    splitBoxes.at (params.classAware ? box.classId : 0).push_back (box);
+
+  for (auto& boxes : splitBoxes)
+  {
+    if (params.preNmsTopK && params.preNmsTopK < boxes.size ())
+    {
+      std::stable_sort (boxes.begin (), boxes.end (),
+          [](const NvDsInferParseObjectInfo& b1, const NvDsInferParseObjectInfo& b2) {
+            return b1.detectionConfidence > b2.detectionConfidence;
+          });
+      boxes.resize (params.preNmsTopK);
+    }
+    boxes = nonMaximumSuppressionReference (params.iouThreshold, boxes);
+    if (params.topK && params.topK < boxes.size ())
+      boxes.resize (params.topK);
+    result.insert (result.end (), boxes.begin (), boxes.end ());
+  }
+  return result;
+}
+
+/* Plain soft-NMS */
+static std::vector<NvDsInferParseObjectInfo>
+softNmsReference (std::vector<NvDsInferParseObjectInfo> const &binfo,
+    NvDsInferNmsParams const &params)
+{
+  std::vector<NvDsInferParseObjectInfo> result;
+  std::vector<std::vector<NvDsInferParseObjectInfo>> splitBoxes (NUM_CLASSES);
+
+  for (auto& box : binfo)
+    splitBoxes.at (params.classAware ? box.classId : 0).push_back (box);
+
+  for (auto& boxes : splitBoxes)
+  {
+    std::stable_sort (boxes.begin (), boxes.end (),
+        [](const NvDsInferParseObjectInfo& b1, const NvDsInferParseObjectInfo& b2) {
+          return b1.detectionConfidence > b2.detectionConfidence;
+        });
+    unsigned int kept = 0;
+    while (!boxes.empty () && (!params.topK || kept < params.topK))
+    {
+      auto best = boxes.begin ();
+      for (auto it = boxes.begin (); it != boxes.end (); ++it)
+      {
+        if (it->detectionConfidence > best->detectionConfidence)
+          best = it;
+      }
+      NvDsInferParseObjectInfo box = *best;
+      boxes.erase (best);
+      result.push_back (box);
+      kept++;
+
+      for (auto it = boxes.begin (); it != boxes.end ();)
+      {
+        float iou = NvDsInferNmsIoU (box, *it);
+        if (params.method == NVDSINFER_NMS_SOFT_GAUSSIAN)
+          it->detectionConfidence *= std::exp (-iou * iou / params.sigma);
+        else if (iou > params.iouThreshold)
+          it->detectionConfidence *= 1 - iou;
+        if (it->detectionConfidence < params.scoreThreshold)
+          it = boxes.erase (it);
+        else
+          ++it;
+      }
+    }
+  }
+  return result;
+}
+
+/* @numBoxes boxes around @numBoxes / 16 objects, with confidence ties */
+static void
+fillBoxes (std::mt19937 &rng, std::vector<NvDsInferParseObjectInfo> &boxes,
+    unsigned int numBoxes, unsigned int numClasses)
+{
+  std::uniform_real_distribution<float> uniform (0, 1);
+  std::normal_distribution<float> jitter (0, 0.08f);
+  unsigned int numObjects = std::max (1u, numBoxes / 16);
+  std::vector<NvDsInferParseObjectInfo> objects (numObjects);
+
+  for (auto &object : objects)
+  {
+    object.classId = rng () % numClasses;
+    object.width = 8 + uniform (rng) * 300;
+    object.height = 8 + uniform (rng) * 300;
+    object.left = uniform (rng) * (FRAME_WIDTH - object.width);
+    object.top = uniform (rng) * (FRAME_HEIGHT - object.height);
+  }
+
+  boxes.resize (numBoxes);
+  for (auto &box : boxes)
+  {
+    NvDsInferParseObjectInfo const &object = objects[rng () % numObjects];
+    float dx = jitter (rng) * object.width;
+    float dy = jitter (rng) * object.height;
+
+    box.classId = rng () % 8 ? object.classId : rng () % numClasses;
+    box.left = std::max (0.0f, object.left + dx);
+    box.top = std::max (0.0f, object.top + dy);
+    box.width = std::max (0.0f, object.width * (1 + jitter (rng)));
+    box.height = std::max (0.0f, object.height * (1 + jitter (rng)));
+    box.detectionConfidence = uniform (rng);
+    if (rng () % 4 == 0)
+      box.detectionConfidence = roundf (box.detectionConfidence * 8) / 8;
+    if (rng () % 64 == 0)
+      box.width = box.height = 0;
+  }
+}
+
+static bool
+sameBits (float a, float b)
+{
+  return !memcmp (&a, &b, sizeof (float));
+}
+
+static bool
+sameObjects (std::vector<NvDsInferParseObjectInfo> const &a,
+    std::vector<NvDsInferParseObjectInfo> const &b)
+{
+  if (a.size () != b.size ())
+    return false;
+  for (size_t i = 0; i < a.size (); i++)
+  {
+    if (a[i].classId != b[i].classId || a[i].left != b[i].left ||
+        a[i].top != b[i].top || a[i].width != b[i].width ||
+        a[i].height != b[i].height ||
+        !sameBits (a[i].detectionConfidence, b[i].detectionConfidence))
+      return false;
+  }
+  return true;
+}
+
+static const char *methodNames[] = { "greedy", "bitmask", "soft-linear",
+  "soft-gaussian" };
+
+static bool
+checkNms (std::mt19937 &rng, NvDsInferNmsMethod method)
+{
+  static const float thresholds[] = { 0.0f, 0.3f, 0.5f, 1.0f };
+  std::vector<NvDsInferParseObjectInfo> boxes, objects, reference;
+  bool soft = method == NVDSINFER_NMS_SOFT_LINEAR ||
+      method == NVDSINFER_NMS_SOFT_GAUSSIAN;
+
+  for (unsigned int numBoxes = 0; numBoxes < 600; numBoxes += 1 + numBoxes / 8)
+  {
+    for (float threshold : thresholds)
+    {
+      for (unsigned int options = 0; options < 8; options++)
+      {
+        NvDsInferNmsParams params = NvDsInferNmsDefaultParams (threshold);
+        params.method = method;
+        params.classAware = options & 1;
+        params.topK = options & 2 ? 5 : 0;
+        params.preNmsTopK = options & 4 && !soft ? 40 : 0;
+
+        fillBoxes (rng, boxes, numBoxes, params.classAware ? 4 : 1);
+        objects = boxes;
+        NvDsInferNms (objects, params);
+        reference = soft ? softNmsReference (boxes, params) :
+            nmsReference (boxes, params);
+        if (!sameObjects (objects, reference))
+        {
+          printf ("%s: %zu objects instead of %zu for %u boxes, threshold %.1f, "
+              "options %u\n", methodNames[method], objects.size (),
+              reference.size (), numBoxes, threshold, options);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <typename Func>
+static double
+timeUs (unsigned int iterations, Func func)
+{
+  auto start = std::chrono::steady_clock::now ();
+  for (unsigned int i = 0; i < iterations; i++)
+    func ();
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::micro> (end - start).count () / iterations;
+}
+
+int main (int argc, char *argv[])
+{
+  unsigned int scale = argc > 1 ? atoi (argv[1]) : 1;
+  std::mt19937 rng (1234);
+  std::vector<NvDsInferParseObjectInfo> boxes, objects, reference;
+  bool ok = true;
+
+  for (int method = NVDSINFER_NMS_GREEDY; method <= NVDSINFER_NMS_SOFT_GAUSSIAN;
+      method++)
+  {
+    if (!checkNms (rng, (NvDsInferNmsMethod) method))
+      ok = false;
+  }
+
+  /* Classes of more than NVDSINFER_NMS_BITMASK_MAX_BOXES boxes */
+  NvDsInferNmsParams params = NvDsInferNmsDefaultParams (0.5f);
+  params.method = NVDSINFER_NMS_BITMASK;
+  params.classAware = false;
+  fillBoxes (rng, boxes, NVDSINFER_NMS_BITMASK_MAX_BOXES + 100, 1);
+  objects = boxes;
+  NvDsInferNms (objects, params);
+  if (!sameObjects (objects, nmsReference (boxes, params)))
+  {
+    printf ("bitmask: objects differ above %u boxes\n",
+        NVDSINFER_NMS_BITMASK_MAX_BOXES);
+    ok = false;
+  }
+
+  if (!ok)
+  {
+    printf ("FAILED\n");
+    return -1;
+  }
+  printf ("results: OK\n");
+
+  printf ("%ux%u frame, boxes around 1/16 as many objects:\n", FRAME_WIDTH,
+      FRAME_HEIGHT);
+  for (unsigned int numBoxes : { 1000, 10000, 50000 })
+  {
+    unsigned int iterations = std::max (1u, scale * 50000 / numBoxes);
+
+    for (bool classAware : { true, false })
+    {
+      fillBoxes (rng, boxes, numBoxes, classAware ? NUM_CLASSES : 1);
+      params = NvDsInferNmsDefaultParams (0.5f);
+      params.classAware = classAware;
+      printf ("  %5u boxes, %s:\n", numBoxes,
+          classAware ? "80 classes" : "class agnostic");
+
+      double us = timeUs (iterations, [&] () {
+        reference = nmsReference (boxes, params);
+      });
+      printf ("    reference      %10.1f us (%zu kept)\n", us, reference.size ());
+      for (int method = NVDSINFER_NMS_GREEDY;
+          method <= NVDSINFER_NMS_SOFT_GAUSSIAN; method++)
+      {
+        /* soft-NMS is quadratic in the boxes of a class */
+        if (method >= NVDSINFER_NMS_SOFT_LINEAR && !classAware && numBoxes > 10000)
+          continue;
+        params.method = (NvDsInferNmsMethod) method;
+        us = timeUs (iterations, [&] () {
+          objects = boxes;
+          NvDsInferNms (objects, params);
+        });
+        printf ("    %-14s %10.1f us (%zu kept)\n", methodNames[method], us,
+            objects.size ());
+      }
+      params.method = NVDSINFER_NMS_GREEDY;
+      params.preNmsTopK = 1000;
+      params.topK = 100;
+      us = timeUs (iterations, [&] () {
+        objects = boxes;
+        NvDsInferNms (objects, params);
+      });
+      printf ("    greedy top-K   %10.1f us (%zu kept)\n", us, objects.size ());
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that the Yolo decoder gives the boxes of the decoding of the Yolo
+ * sample parser it replaces, before and after the NMS, for every instruction
+ * set supported by the CPU, then times both for YoloV2 and YoloV3 at 416x416.
+ *
+ * The YoloV3 layers are generated, or read from files of float tensors of the
+ * 13x13, 26x26 and 52x52 layers (255 channels), one or more frames each.
+ *
+ * Usage: test_yolodecoder [iterations [yolo13.bin yolo26.bin yolo52.bin]]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include "nvdsinfer_nms.h"
+#include "nvdsinfer_yolodecoder.h"
+
+#define NET_SIZE 416
+#define NUM_CLASSES 80
+#define DEFAULT_ITERATIONS 200
+
+static const char *isaNames[] = { "scalar", "avx2", "neon" };
+
+static const std::vector<float> kANCHORS_V2 = {
+  18.3273602, 21.6763191, 59.9827194, 66.0009613,
+  106.829758, 175.178879, 252.250244, 112.888962,
+  312.656647, 293.384949 };
+static const unsigned int kNUM_BBOXES_V2 = 5;
+
+static const std::vector<float> kANCHORS_V3 = {
+  10.0, 13.0, 16.0,  30.0,  33.0, 23.0,  30.0,  61.0,  62.0,
+  45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0 };
+static const std::vector<std::vector<int>> kMASKS_V3 = {
+  { 6, 7, 8 },
+  { 3, 4, 5 },
+  { 0, 1, 2 } };
+static const unsigned int kGRIDS_V3[] = { 13, 26, 52 };
+
+/* Boxes compared by the checks */
+static size_t s_NumChecked = 0;
+
+/* Decoding of nvdsparsebbox_Yolo.cpp before the Yolo decoder */
+static unsigned
+clampReference (const uint val, const uint minVal, const uint maxVal)
+{
+  return std::min (maxVal, std::max (minVal, val));
+}
+
+static NvDsInferParseObjectInfo
+convertBBoxReference (const float& bx, const float& by, const float& bw,
+    const float& bh, const int& stride, const uint& netW, const uint& netH)
+{
+  NvDsInferParseObjectInfo b;
+  float x = bx * stride;
+  float y = by * stride;
+
+  b.left = x - bw / 2;
+  b.width = bw;
+
+  b.top = y - bh / 2;
+  b.height = bh;
+
+  b.left = clampReference (b.left, 0, netW);
+  b.width = clampReference (b.width, 0, netW);
+  b.top = clampReference (b.top, 0, netH);
+  b.height = clampReference (b.height, 0, netH);
+
+  return b;
+}
+
+static void
+addBBoxProposalReference (const float bx, const float by, const float bw,
+    const float bh, const uint stride, const uint& netW, const uint& netH,
+    const int maxIndex, const float maxProb,
+    std::vector<NvDsInferParseObjectInfo>& binfo)
+{
+  NvDsInferParseObjectInfo bbi = convertBBoxReference (bx, by, bw, bh, stride,
+      netW, netH);
+  if (((bbi.left + bbi.width) > netW) || ((bbi.top + bbi.height) > netH))
+    return;
+
+  bbi.detectionConfidence = maxProb;
+  bbi.classId = maxIndex;
+  binfo.push_back (bbi);
+}
+
+static std::vector<NvDsInferParseObjectInfo>
+decodeYoloTensorReference (const float* detections, bool v2,
+    const std::vector<int> &mask, const std::vector<float> &anchors,
+    const uint gridSize, const uint stride, const uint numBBoxes,
+    const uint numOutputClasses, const float probThresh, const uint& netW,
+    const uint& netH)
+{
+  std::vector<NvDsInferParseObjectInfo> binfo;
+  for (uint y = 0; y < gridSize; ++y)
+  {
+    for (uint x = 0; x < gridSize; ++x)
+    {
+      for (uint b = 0; b < numBBoxes; ++b)
+      {
+        const float pw = v2 ? anchors[b * 2] : anchors[mask[b] * 2];
+        const float ph = v2 ? anchors[b * 2 + 1] : anchors[mask[b] * 2 + 1];
+
+        const int numGridCells = gridSize * gridSize;
+        const int bbindex = y * gridSize + x;
+        const float bx
+            = x + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 0)];
+        const float by
+            = y + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 1)];
+        /* exp of a float is the exp of double outside of namespace std */
+        const float bw = v2
+            ? pw * exp ((double) detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 2)])
+            : pw * detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 2)];
+        const float bh = v2
+            ? ph * exp ((double) detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 3)])
+            : ph * detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 3)];
+
+        const float objectness
+            = detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 4)];
+
+        float maxProb = 0.0f;
+        int maxIndex = -1;
+
+        for (uint i = 0; i < numOutputClasses; ++i)
+        {
+          float prob
+              = (detections[bbindex
+                  + numGridCells * (b * (5 + numOutputClasses) + (5 + i))]);
+
+          if (prob > maxProb)
+          {
+            maxProb = prob;
+            maxIndex = i;
+          }
+        }
+        maxProb = objectness * maxProb;
+
+        if (maxProb > probThresh)
+        {
+          addBBoxProposalReference (bx, by, bw, bh, stride, netW, netH,
+              maxIndex, maxProb, binfo);
+        }
+      }
+    }
+  }
+  return binfo;
+}
+
+static std::vector<NvDsInferParseObjectInfo>
+parseYoloV3Reference (std::vector<const float *> const &layers,
+    float probThresh, float nmsThresh, bool nms = true)
+{
+  std::vector<NvDsInferParseObjectInfo> objects;
+
+  for (unsigned int idx = 0; idx < layers.size (); idx++)
+  {
+    std::vector<NvDsInferParseObjectInfo> outObjs = decodeYoloTensorReference (
+        layers[idx], false, kMASKS_V3[idx], kANCHORS_V3, kGRIDS_V3[idx],
+        NET_SIZE / kGRIDS_V3[idx], 3, NUM_CLASSES, probThresh, NET_SIZE,
+        NET_SIZE);
+    objects.insert (objects.end (), outObjs.begin (), outObjs.end ());
+  }
+  if (nms)
+    NvDsInferNms (objects, NvDsInferNmsDefaultParams (nmsThresh));
+  return objects;
+}
+
+static void
+parseYoloV3 (std::vector<const float *> const &layers, float probThresh,
+    float nmsThresh, std::vector<NvDsInferParseObjectInfo> &objects,
+    NvDsInferGridIsa isa, bool nms = true)
+{
+  objects.clear ();
+  for (unsigned int idx = 0; idx < layers.size (); idx++)
+  {
+    NvDsInferYoloDecode (layers[idx], NvDsInferYoloLayerV3 (kGRIDS_V3[idx],
+          NET_SIZE / kGRIDS_V3[idx], NUM_CLASSES, kANCHORS_V3, kMASKS_V3[idx]),
+        probThresh, NET_SIZE, NET_SIZE, objects, isa);
+  }
+  if (nms)
+    NvDsInferNms (objects, NvDsInferNmsDefaultParams (nmsThresh));
+}
+
+static bool
+sameObjects (std::vector<NvDsInferParseObjectInfo> const &a,
+    std::vector<NvDsInferParseObjectInfo> const &b)
+{
+  if (a.size () != b.size ())
+    return false;
+  for (size_t i = 0; i < a.size (); i++)
+  {
+    if (a[i].classId != b[i].classId || a[i].left != b[i].left ||
+        a[i].top != b[i].top || a[i].width != b[i].width ||
+        a[i].height != b[i].height ||
+        a[i].detectionConfidence != b[i].detectionConfidence)
+      return false;
+  }
+  return true;
+}
+
+static float
+sigmoid (float x)
+{
+  return 1 / (1 + std::exp (-x));
+}
+
+/* Output of a Yolo layer: few cells of high objectness, class scores
+ * quantized so that ties occur, a few NaNs, objectness equal to the
+ * thresholds. Class scores are sigmoids (YoloV3) or softmaxes (YoloV2), sizes
+ * anchor scales (YoloV3) or their logs (YoloV2). */
+static void
+fillLayer (std::mt19937 &rng, std::vector<float> &layer, unsigned int gridSize,
+    unsigned int numBBoxes, bool v2, float density)
+{
+  std::uniform_real_distribution<float> uniform (0, 1);
+  std::normal_distribution<float> normal (0, 1);
+  unsigned int numCells = gridSize * gridSize;
+  static const float thresholds[] = { 0.6f, 0.7f };
+
+  layer.resize ((size_t) numBBoxes * (5 + NUM_CLASSES) * numCells);
+  for (unsigned int b = 0; b < numBBoxes; b++)
+  {
+    float *box = layer.data () + (size_t) b * (5 + NUM_CLASSES) * numCells;
+    for (unsigned int c = 0; c < numCells; c++)
+    {
+      bool object = uniform (rng) < density;
+      float scores[NUM_CLASSES];
+      float sum = 0;
+
+      box[c] = uniform (rng);
+      box[numCells + c] = uniform (rng);
+      for (unsigned int k = 2; k < 4; k++)
+      {
+        float logScale = -1 + 0.5f * normal (rng);
+        box[k * numCells + c] = v2 ? logScale : std::exp (logScale);
+      }
+      box[4 * numCells + c] = object ? 0.5f + 0.5f * uniform (rng) :
+          sigmoid (-7 + 3 * normal (rng));
+      if (rng () % 500 == 0)
+        box[4 * numCells + c] = thresholds[rng () % 2];
+
+      for (unsigned int i = 0; i < NUM_CLASSES; i++)
+      {
+        scores[i] = v2 ? std::exp (2 * normal (rng)) :
+            sigmoid (-6 + 2 * normal (rng));
+        sum += scores[i];
+      }
+      if (object)
+      {
+        unsigned int i = rng () % NUM_CLASSES;
+        float score = 0.6f + 0.4f * uniform (rng);
+        scores[i] = v2 ? score * sum * 10 : score;
+        sum += v2 ? scores[i] : 0;
+      }
+      for (unsigned int i = 0; i < NUM_CLASSES; i++)
+      {
+        float score = v2 ? scores[i] / sum : scores[i];
+        if (rng () % 4 == 0)
+          score = (int) (score * 16) / 16.0f;
+        box[(5 + i) * numCells + c] = score;
+      }
+      if (rng () % 1000 == 0)
+        box[(4 + rng () % 2) * numCells + c] =
+            std::numeric_limits<float>::quiet_NaN ();
+    }
+  }
+}
+
+static bool
+checkV2 (std::mt19937 &rng, NvDsInferGridIsa isa)
+{
+  std::vector<float> layer;
+  std::vector<NvDsInferParseObjectInfo> objects, reference;
+
+  for (unsigned int gridSize : { 1u, 3u, 13u, 19u })
+  {
+    for (float threshold : { 0.0f, 0.6f, 0.7f })
+    {
+      fillLayer (rng, layer, gridSize, kNUM_BBOXES_V2, true, 0.02f);
+      unsigned int stride = NET_SIZE / gridSize;
+
+      reference = decodeYoloTensorReference (layer.data (), true, {},
+          kANCHORS_V2, gridSize, stride, kNUM_BBOXES_V2, NUM_CLASSES,
+          threshold, NET_SIZE, NET_SIZE);
+      objects.clear ();
+      NvDsInferYoloDecode (layer.data (), NvDsInferYoloLayerV2 (gridSize,
+            stride, kNUM_BBOXES_V2, NUM_CLASSES, kANCHORS_V2), threshold,
+          NET_SIZE, NET_SIZE, objects, isa);
+      s_NumChecked += reference.size ();
+      if (!sameObjects (objects, reference))
+      {
+        printf ("%s: YoloV2 %ux%u threshold %.1f: %zu boxes instead of %zu or "
+            "different\n", isaNames[isa], gridSize, gridSize, threshold,
+            objects.size (), reference.size ());
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool
+checkV3 (std::vector<const float *> const &layers, NvDsInferGridIsa isa)
+{
+  std::vector<NvDsInferParseObjectInfo> objects, reference;
+
+  for (float threshold : { 0.0f, 0.6f, 0.7f })
+  {
+    for (bool nms : { false, true })
+    {
+      reference = parseYoloV3Reference (layers, threshold, 0.3f, nms);
+      parseYoloV3 (layers, threshold, 0.3f, objects, isa, nms);
+      s_NumChecked += reference.size ();
+      if (!sameObjects (objects, reference))
+      {
+        printf ("%s: YoloV3 threshold %.1f%s: %zu boxes instead of %zu or "
+            "different\n", isaNames[isa], threshold, nms ? " NMS" : "",
+            objects.size (), reference.size ());
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/* Reads @numFrames frames of the YoloV3 layers from @paths. */
+static bool
+readLayers (char **paths, std::vector<std::vector<float>> &frames,
+    unsigned int &numFrames)
+{
+  numFrames = std::numeric_limits<unsigned int>::max ();
+  for (unsigned int idx = 0; idx < 3; idx++)
+  {
+    size_t frameSize = (size_t) 3 * (5 + NUM_CLASSES) * kGRIDS_V3[idx] *
+        kGRIDS_V3[idx];
+    FILE *file = fopen (paths[idx], "rb");
+    if (!file)
+    {
+      printf ("Could not open %s\n", paths[idx]);
+      return false;
+    }
+    frames[idx].clear ();
+    std::vector<float> frame (frameSize);
+    while (fread (frame.data (), sizeof (float), frameSize, file) == frameSize)
+      frames[idx].insert (frames[idx].end (), frame.begin (), frame.end ());
+    fclose (file);
+    numFrames = std::min (numFrames,
+        (unsigned int) (frames[idx].size () / frameSize));
+  }
+  if (!numFrames)
+  {
+    printf ("No frame of 13x13, 26x26 and 52x52 layers in the files\n");
+    return false;
+  }
+  return true;
+}
+
+template <typename Func>
+static double
+timeUs (unsigned int iterations, Func func)
+{
+  auto start = std::chrono::steady_clock::now ();
+  for (unsigned int i = 0; i < iterations; i++)
+    func ();
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::micro> (end - start).count () /
+      iterations;
+}
+
+int main (int argc, char *argv[])
+{
+  unsigned int iterations = argc > 1 ? atoi (argv[1]) : DEFAULT_ITERATIONS;
+  std::mt19937 rng (1234);
+  std::vector<std::vector<float>> frames (3);
+  std::vector<const float *> layers (3);
+  std::vector<float> layerV2;
+  std::vector<NvDsInferParseObjectInfo> objects;
+  unsigned int numFrames = 10;
+  bool recorded = argc == 5;
+  bool ok = true;
+
+  if (recorded && !readLayers (argv + 2, frames, numFrames))
+    return -1;
+
+  for (unsigned int f = 0; f < numFrames && ok; f++)
+  {
+    for (unsigned int idx = 0; idx < 3; idx++)
+    {
+      size_t frameSize = (size_t) 3 * (5 + NUM_CLASSES) * kGRIDS_V3[idx] *
+          kGRIDS_V3[idx];
+      if (!recorded)
+        fillLayer (rng, frames[idx], kGRIDS_V3[idx], 3, false,
+            f % 2 ? 0.002f : 0.05f);
+      layers[idx] = frames[idx].data () + (recorded ? f * frameSize : 0);
+    }
+    for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+    {
+      if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+        continue;
+      if (!checkV3 (layers, (NvDsInferGridIsa) isa) ||
+          !checkV2 (rng, (NvDsInferGridIsa) isa))
+        ok = false;
+    }
+  }
+  if (!ok)
+  {
+    printf ("FAILED\n");
+    return -1;
+  }
+  printf ("bit-exact: OK (%u %s frames, %zu boxes)\n", numFrames,
+      recorded ? "recorded" : "generated", s_NumChecked);
+
+  /* Typical frame: a few objects */
+  if (!recorded)
+  {
+    for (unsigned int idx = 0; idx < 3; idx++)
+    {
+      fillLayer (rng, frames[idx], kGRIDS_V3[idx], 3, false, 0.002f);
+      layers[idx] = frames[idx].data ();
+    }
+  }
+  fillLayer (rng, layerV2, 13, kNUM_BBOXES_V2, true, 0.01f);
+
+  printf ("%ux%u input, %u iterations:\n", NET_SIZE, NET_SIZE, iterations);
+  printf ("  YoloV3 reference  %8.1f us\n", timeUs (iterations, [&] () {
+        objects = parseYoloV3Reference (layers, 0.7f, 0.3f);
+      }));
+  for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+  {
+    if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+      continue;
+    printf ("  YoloV3 %-6s     %8.1f us (%zu boxes)\n", isaNames[isa],
+        timeUs (iterations, [&] () {
+          parseYoloV3 (layers, 0.7f, 0.3f, objects, (NvDsInferGridIsa) isa);
+        }), objects.size ());
+  }
+  printf ("  YoloV2 reference  %8.1f us\n", timeUs (iterations, [&] () {
+        objects = decodeYoloTensorReference (layerV2.data (), true, {},
+            kANCHORS_V2, 13, NET_SIZE / 13, kNUM_BBOXES_V2, NUM_CLASSES, 0.6f,
+            NET_SIZE, NET_SIZE);
+        NvDsInferNms (objects, NvDsInferNmsDefaultParams (0.3f));
+      }));
+  for (int isa = NVDSINFER_GRID_ISA_SCALAR; isa <= NVDSINFER_GRID_ISA_NEON; isa++)
+  {
+    if (!NvDsInferGridIsaSupported ((NvDsInferGridIsa) isa))
+      continue;
+    printf ("  YoloV2 %-6s     %8.1f us (%zu boxes)\n", isaNames[isa],
+        timeUs (iterations, [&] () {
+          objects.clear ();
+          NvDsInferYoloDecode (layerV2.data (), NvDsInferYoloLayerV2 (13,
+                NET_SIZE / 13, kNUM_BBOXES_V2, NUM_CLASSES, kANCHORS_V2), 0.6f,
+              NET_SIZE, NET_SIZE, objects, (NvDsInferGridIsa) isa);
+          NvDsInferNms (objects, NvDsInferNmsDefaultParams (0.3f));
+        }), objects.size ());
+  }
+
+  return 0;
+}
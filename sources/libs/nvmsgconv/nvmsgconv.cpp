@@ -10,12 +10,12 @@
  */
 
 #include "nvmsgconv.h"
-#include <json-glib/json-glib.h>
+#include "nvmsgconv_json.h"
+#include "nvmsgconv_binary_priv.h"
 #include <uuid.h>
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <cstring>
 #include <vector>
 #include <unordered_map>
@@ -92,6 +92,16 @@ struct NvDsPayloadPriv {
   unordered_map<int, NvDsSensorObject> sensorObj;
   unordered_map<int, NvDsPlaceObject> placeObj;
   unordered_map<int, NvDsAnalyticsObject> analyticsObj;
+  /** static properties were read from configuration / CSV file. */
+  bool hasConfig = false;
+  /** generate indented JSON, same as json_to_string (node, TRUE). */
+  bool prettyJson = true;
+  /** message is serialized here; buffer is reused across calls. */
+  NvDsJsonWriter writer;
+  /** scratch buffer for minimal schema object strings. */
+  string scratch;
+  /** binary payloads are encoded here; buffer is reused across calls. */
+  string binary;
 };
 
 static void
@@ -115,14 +125,13 @@ get_csv_tokens (const string &text, vector<string> &tokens)
   g_strfreev (csv_tokens);
 }
 
-static JsonObject*
-generate_place_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
+static void
+generate_place_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta,
+                       NvDsJsonWriter &writer)
 {
   NvDsPayloadPriv *privObj = NULL;
   NvDsPlaceObject *dsPlaceObj = NULL;
-  JsonObject *placeObj;
-  JsonObject *jobject;
-  JsonObject *jobject2;
+  const gchar *subObjName = NULL;
 
   privObj = (NvDsPayloadPriv *) ctx->privData;
   auto idMap = privObj->placeObj.find (meta->placeId);
@@ -132,7 +141,8 @@ generate_place_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
   } else {
     cout << "No entry for " CONFIG_GROUP_PLACE << meta->placeId
         << " in configuration file" << endl;
-    return NULL;
+    writer.addNull ("place");
+    return;
   }
 
   /* place object
@@ -141,7 +151,7 @@ generate_place_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
        "id": "string",
        "name": "endeavor",
        “type”: “garage”,
-       "location": {
+       "location": {
          "lat": 30.333,
          "lon": -40.555,
          "alt": 100.00
@@ -159,48 +169,50 @@ generate_place_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
      }
    */
 
-  placeObj = json_object_new ();
-  json_object_set_string_member (placeObj, "id", dsPlaceObj->id.c_str());
-  json_object_set_string_member (placeObj, "name", dsPlaceObj->name.c_str());
-  json_object_set_string_member (placeObj, "type", dsPlaceObj->type.c_str());
+  writer.beginObject ("place");
+  writer.addString ("id", dsPlaceObj->id.c_str());
+  writer.addString ("name", dsPlaceObj->name.c_str());
+  writer.addString ("type", dsPlaceObj->type.c_str());
 
   // location sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "lat", dsPlaceObj->location[0]);
-  json_object_set_double_member (jobject, "lon", dsPlaceObj->location[1]);
-  json_object_set_double_member (jobject, "alt", dsPlaceObj->location[2]);
-  json_object_set_object_member (placeObj, "location", jobject);
+  writer.beginObject ("location");
+  writer.addDouble ("lat", dsPlaceObj->location[0]);
+  writer.addDouble ("lon", dsPlaceObj->location[1]);
+  writer.addDouble ("alt", dsPlaceObj->location[2]);
+  writer.endObject ();
 
   // parkingSpot / aisle /entrance sub object
-  jobject = json_object_new ();
-
   switch (meta->type) {
     case NVDS_EVENT_MOVING:
     case NVDS_EVENT_STOPPED:
-      json_object_set_string_member (jobject, "id", dsPlaceObj->subObj.field1.c_str());
-      json_object_set_string_member (jobject, "name", dsPlaceObj->subObj.field2.c_str());
-      json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-      json_object_set_object_member (placeObj, "aisle", jobject);
+      writer.beginObject ("aisle");
+      writer.addString ("id", dsPlaceObj->subObj.field1.c_str());
+      writer.addString ("name", dsPlaceObj->subObj.field2.c_str());
+      writer.addString ("level", dsPlaceObj->subObj.field3.c_str());
+      subObjName = "aisle";
       break;
     case NVDS_EVENT_EMPTY:
     case NVDS_EVENT_PARKED:
-      json_object_set_string_member (jobject, "id", dsPlaceObj->subObj.field1.c_str());
-      json_object_set_string_member (jobject, "type", dsPlaceObj->subObj.field2.c_str());
-      json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-      json_object_set_object_member (placeObj, "parkingSpot", jobject);
+      writer.beginObject ("parkingSpot");
+      writer.addString ("id", dsPlaceObj->subObj.field1.c_str());
+      writer.addString ("type", dsPlaceObj->subObj.field2.c_str());
+      writer.addString ("level", dsPlaceObj->subObj.field3.c_str());
+      subObjName = "parkingSpot";
       break;
     case NVDS_EVENT_ENTRY:
     case NVDS_EVENT_EXIT:
       if (meta->objType == NVDS_OBJECT_TYPE_VEHICLE) {
-        json_object_set_string_member (jobject, "id", dsPlaceObj->subObj.field1.c_str());
-        json_object_set_string_member (jobject, "name", dsPlaceObj->subObj.field2.c_str());
-        json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-        json_object_set_object_member (placeObj, "aisle", jobject);
+        writer.beginObject ("aisle");
+        writer.addString ("id", dsPlaceObj->subObj.field1.c_str());
+        writer.addString ("name", dsPlaceObj->subObj.field2.c_str());
+        writer.addString ("level", dsPlaceObj->subObj.field3.c_str());
+        subObjName = "aisle";
       } else {
-        json_object_set_string_member (jobject, "name", dsPlaceObj->subObj.field1.c_str());
-        json_object_set_string_member (jobject, "lane", dsPlaceObj->subObj.field2.c_str());
-        json_object_set_string_member (jobject, "level", dsPlaceObj->subObj.field3.c_str());
-        json_object_set_object_member (placeObj, "entrance", jobject);
+        writer.beginObject ("entrance");
+        writer.addString ("name", dsPlaceObj->subObj.field1.c_str());
+        writer.addString ("lane", dsPlaceObj->subObj.field2.c_str());
+        writer.addString ("level", dsPlaceObj->subObj.field3.c_str());
+        subObjName = "entrance";
       }
       break;
     default:
@@ -208,23 +220,25 @@ generate_place_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
       break;
   }
 
-  // coordinate sub sub object
-  jobject2 = json_object_new ();
-  json_object_set_double_member (jobject2, "x", dsPlaceObj->coordinate[0]);
-  json_object_set_double_member (jobject2, "y", dsPlaceObj->coordinate[1]);
-  json_object_set_double_member (jobject2, "z", dsPlaceObj->coordinate[2]);
-  json_object_set_object_member (jobject, "coordinate", jobject2);
+  if (subObjName) {
+    // coordinate sub sub object
+    writer.beginObject ("coordinate");
+    writer.addDouble ("x", dsPlaceObj->coordinate[0]);
+    writer.addDouble ("y", dsPlaceObj->coordinate[1]);
+    writer.addDouble ("z", dsPlaceObj->coordinate[2]);
+    writer.endObject ();
+    writer.endObject ();
+  }
 
-  return placeObj;
+  writer.endObject ();
 }
 
-static JsonObject*
-generate_sensor_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
+static void
+generate_sensor_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta,
+                        NvDsJsonWriter &writer)
 {
   NvDsPayloadPriv *privObj = NULL;
   NvDsSensorObject *dsSensorObj = NULL;
-  JsonObject *sensorObj;
-  JsonObject *jobject;
 
   privObj = (NvDsPayloadPriv *) ctx->privData;
   auto idMap = privObj->sensorObj.find (meta->sensorId);
@@ -234,7 +248,8 @@ generate_sensor_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
   } else {
     cout << "No entry for " CONFIG_GROUP_SENSOR << meta->sensorId
          << " in configuration file" << endl;
-    return NULL;
+    writer.addNull ("sensor");
+    return;
   }
 
   /* sensor object
@@ -256,34 +271,34 @@ generate_sensor_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
    */
 
   // sensor object
-  sensorObj = json_object_new ();
-  json_object_set_string_member (sensorObj, "id", dsSensorObj->id.c_str());
-  json_object_set_string_member (sensorObj, "type", dsSensorObj->type.c_str());
-  json_object_set_string_member (sensorObj, "description", dsSensorObj->desc.c_str());
+  writer.beginObject ("sensor");
+  writer.addString ("id", dsSensorObj->id.c_str());
+  writer.addString ("type", dsSensorObj->type.c_str());
+  writer.addString ("description", dsSensorObj->desc.c_str());
 
   // location sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "lat", dsSensorObj->location[0]);
-  json_object_set_double_member (jobject, "lon", dsSensorObj->location[1]);
-  json_object_set_double_member (jobject, "alt", dsSensorObj->location[2]);
-  json_object_set_object_member (sensorObj, "location", jobject);
+  writer.beginObject ("location");
+  writer.addDouble ("lat", dsSensorObj->location[0]);
+  writer.addDouble ("lon", dsSensorObj->location[1]);
+  writer.addDouble ("alt", dsSensorObj->location[2]);
+  writer.endObject ();
 
   // coordinate sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "x", dsSensorObj->coordinate[0]);
-  json_object_set_double_member (jobject, "y", dsSensorObj->coordinate[1]);
-  json_object_set_double_member (jobject, "z", dsSensorObj->coordinate[2]);
-  json_object_set_object_member (sensorObj, "coordinate", jobject);
+  writer.beginObject ("coordinate");
+  writer.addDouble ("x", dsSensorObj->coordinate[0]);
+  writer.addDouble ("y", dsSensorObj->coordinate[1]);
+  writer.addDouble ("z", dsSensorObj->coordinate[2]);
+  writer.endObject ();
 
-  return sensorObj;
+  writer.endObject ();
 }
 
-static JsonObject*
-generate_analytics_module_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
+static void
+generate_analytics_module_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta,
+                                  NvDsJsonWriter &writer)
 {
   NvDsPayloadPriv *privObj = NULL;
   NvDsAnalyticsObject *dsObj = NULL;
-  JsonObject *analyticsObj;
 
   privObj = (NvDsPayloadPriv *) ctx->privData;
 
@@ -294,7 +309,8 @@ generate_analytics_module_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
   } else {
     cout << "No entry for " CONFIG_GROUP_ANALYTICS << meta->moduleId
         << " in configuration file" << endl;
-    return NULL;
+    writer.addNull ("analyticsModule");
+    return;
   }
 
   /* analytics object
@@ -308,20 +324,19 @@ generate_analytics_module_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
    */
 
   // analytics object
-  analyticsObj = json_object_new ();
-  json_object_set_string_member (analyticsObj, "id", dsObj->id.c_str());
-  json_object_set_string_member (analyticsObj, "description", dsObj->desc.c_str());
-  json_object_set_string_member (analyticsObj, "source", dsObj->source.c_str());
-  json_object_set_string_member (analyticsObj, "version", dsObj->version.c_str());
-  json_object_set_double_member (analyticsObj, "confidence", meta->confidence);
-
-  return analyticsObj;
+  writer.beginObject ("analyticsModule");
+  writer.addString ("id", dsObj->id.c_str());
+  writer.addString ("description", dsObj->desc.c_str());
+  writer.addString ("source", dsObj->source.c_str());
+  writer.addString ("version", dsObj->version.c_str());
+  writer.addDouble ("confidence", meta->confidence);
+  writer.endObject ();
 }
 
-static JsonObject*
-generate_event_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
+static void
+generate_event_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta,
+                       NvDsJsonWriter &writer)
 {
-  JsonObject *eventObj;
   uuid_t uuid;
   gchar uuidStr[37];
 
@@ -335,199 +350,192 @@ generate_event_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
   uuid_generate_random (uuid);
   uuid_unparse_lower(uuid, uuidStr);
 
-  eventObj = json_object_new ();
-  json_object_set_string_member (eventObj, "id", uuidStr);
+  writer.beginObject ("event");
+  writer.addString ("id", uuidStr);
 
   switch (meta->type) {
     case NVDS_EVENT_ENTRY:
-      json_object_set_string_member (eventObj, "type", "entry");
+      writer.addString ("type", "entry");
       break;
     case NVDS_EVENT_EXIT:
-      json_object_set_string_member (eventObj, "type", "exit");
+      writer.addString ("type", "exit");
       break;
     case NVDS_EVENT_MOVING:
-      json_object_set_string_member (eventObj, "type", "moving");
+      writer.addString ("type", "moving");
       break;
     case NVDS_EVENT_STOPPED:
-      json_object_set_string_member (eventObj, "type", "stopped");
+      writer.addString ("type", "stopped");
       break;
     case NVDS_EVENT_PARKED:
-      json_object_set_string_member (eventObj, "type", "parked");
+      writer.addString ("type", "parked");
       break;
     case NVDS_EVENT_EMPTY:
-      json_object_set_string_member (eventObj, "type", "empty");
+      writer.addString ("type", "empty");
       break;
     case NVDS_EVENT_RESET:
-      json_object_set_string_member (eventObj, "type", "reset");
+      writer.addString ("type", "reset");
       break;
     default:
       cout << "Unknown event type " << endl;
       break;
   }
 
-  return eventObj;
+  writer.endObject ();
 }
 
-static JsonObject*
-generate_object_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
+static void
+generate_object_object (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta,
+                        NvDsJsonWriter &writer)
 {
-  JsonObject *objectObj;
-  JsonObject *jobject;
   guint i;
   gchar tracking_id[64];
 
   // object object
-  objectObj = json_object_new ();
+  writer.beginObject ("object");
   if (snprintf (tracking_id, sizeof(tracking_id), "%d", meta->trackingId)
       >= (int) sizeof(tracking_id))
     g_warning("Not enough space to copy trackingId");
-  json_object_set_string_member (objectObj, "id", tracking_id);
-  json_object_set_double_member (objectObj, "speed", 0);
-  json_object_set_double_member (objectObj, "direction", 0);
-  json_object_set_double_member (objectObj, "orientation", 0);
+  writer.addString ("id", tracking_id);
+  writer.addDouble ("speed", 0);
+  writer.addDouble ("direction", 0);
+  writer.addDouble ("orientation", 0);
 
   switch (meta->objType) {
     case NVDS_OBJECT_TYPE_VEHICLE:
       // vehicle sub object
-      jobject = json_object_new ();
+      writer.beginObject ("vehicle");
 
       if (meta->extMsgSize) {
         NvDsVehicleObject *dsObj = (NvDsVehicleObject *) meta->extMsg;
         if (dsObj) {
-          json_object_set_string_member (jobject, "type", dsObj->type);
-          json_object_set_string_member (jobject, "make", dsObj->make);
-          json_object_set_string_member (jobject, "model", dsObj->model);
-          json_object_set_string_member (jobject, "color", dsObj->color);
-          json_object_set_string_member (jobject, "licenseState", dsObj->region);
-          json_object_set_string_member (jobject, "license", dsObj->license);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          writer.addString ("type", dsObj->type);
+          writer.addString ("make", dsObj->make);
+          writer.addString ("model", dsObj->model);
+          writer.addString ("color", dsObj->color);
+          writer.addString ("licenseState", dsObj->region);
+          writer.addString ("license", dsObj->license);
+          writer.addDouble ("confidence", meta->confidence);
         }
       } else {
         // No vehicle object in meta data. Attach empty vehicle sub object.
-        json_object_set_string_member (jobject, "type", "");
-        json_object_set_string_member (jobject, "make", "");
-        json_object_set_string_member (jobject, "model", "");
-        json_object_set_string_member (jobject, "color", "");
-        json_object_set_string_member (jobject, "licenseState", "");
-        json_object_set_string_member (jobject, "license", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        writer.addString ("type", "");
+        writer.addString ("make", "");
+        writer.addString ("model", "");
+        writer.addString ("color", "");
+        writer.addString ("licenseState", "");
+        writer.addString ("license", "");
+        writer.addDouble ("confidence", 1.0);
       }
-      json_object_set_object_member (objectObj, "vehicle", jobject);
+      writer.endObject ();
       break;
     case NVDS_OBJECT_TYPE_PERSON:
       // person sub object
-      jobject = json_object_new ();
+      writer.beginObject ("person");
 
       if (meta->extMsgSize) {
         NvDsPersonObject *dsObj = (NvDsPersonObject *) meta->extMsg;
         if (dsObj) {
-          json_object_set_int_member (jobject, "age", dsObj->age);
-          json_object_set_string_member (jobject, "gender", dsObj->gender);
-          json_object_set_string_member (jobject, "hair", dsObj->hair);
-          json_object_set_string_member (jobject, "cap", dsObj->cap);
-          json_object_set_string_member (jobject, "apparel", dsObj->apparel);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          writer.addInt ("age", dsObj->age);
+          writer.addString ("gender", dsObj->gender);
+          writer.addString ("hair", dsObj->hair);
+          writer.addString ("cap", dsObj->cap);
+          writer.addString ("apparel", dsObj->apparel);
+          writer.addDouble ("confidence", meta->confidence);
         }
       } else {
         // No person object in meta data. Attach empty person sub object.
-        json_object_set_int_member (jobject, "age", 0);
-        json_object_set_string_member (jobject, "gender", "");
-        json_object_set_string_member (jobject, "hair", "");
-        json_object_set_string_member (jobject, "cap", "");
-        json_object_set_string_member (jobject, "apparel", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        writer.addInt ("age", 0);
+        writer.addString ("gender", "");
+        writer.addString ("hair", "");
+        writer.addString ("cap", "");
+        writer.addString ("apparel", "");
+        writer.addDouble ("confidence", 1.0);
       }
-      json_object_set_object_member (objectObj, "person", jobject);
+      writer.endObject ();
       break;
     case NVDS_OBJECT_TYPE_FACE:
       // face sub object
-      jobject = json_object_new ();
+      writer.beginObject ("face");
 
       if (meta->extMsgSize) {
         NvDsFaceObject *dsObj = (NvDsFaceObject *) meta->extMsg;
         if (dsObj) {
-          json_object_set_int_member (jobject, "age", dsObj->age);
-          json_object_set_string_member (jobject, "gender", dsObj->gender);
-          json_object_set_string_member (jobject, "hair", dsObj->hair);
-          json_object_set_string_member (jobject, "cap", dsObj->cap);
-          json_object_set_string_member (jobject, "glasses", dsObj->glasses);
-          json_object_set_string_member (jobject, "facialhair", dsObj->facialhair);
-          json_object_set_string_member (jobject, "name", dsObj->name);
-          json_object_set_string_member (jobject, "eyecolor", dsObj->eyecolor);
-          json_object_set_double_member (jobject, "confidence", meta->confidence);
+          writer.addInt ("age", dsObj->age);
+          writer.addString ("gender", dsObj->gender);
+          writer.addString ("hair", dsObj->hair);
+          writer.addString ("cap", dsObj->cap);
+          writer.addString ("glasses", dsObj->glasses);
+          writer.addString ("facialhair", dsObj->facialhair);
+          writer.addString ("name", dsObj->name);
+          writer.addString ("eyecolor", dsObj->eyecolor);
+          writer.addDouble ("confidence", meta->confidence);
         }
       } else {
         // No face object in meta data. Attach empty face sub object.
-        json_object_set_int_member (jobject, "age", 0);
-        json_object_set_string_member (jobject, "gender", "");
-        json_object_set_string_member (jobject, "hair", "");
-        json_object_set_string_member (jobject, "cap", "");
-        json_object_set_string_member (jobject, "glasses", "");
-        json_object_set_string_member (jobject, "facialhair", "");
-        json_object_set_string_member (jobject, "name", "");
-        json_object_set_string_member (jobject, "eyecolor", "");
-        json_object_set_double_member (jobject, "confidence", 1.0);
+        writer.addInt ("age", 0);
+        writer.addString ("gender", "");
+        writer.addString ("hair", "");
+        writer.addString ("cap", "");
+        writer.addString ("glasses", "");
+        writer.addString ("facialhair", "");
+        writer.addString ("name", "");
+        writer.addString ("eyecolor", "");
+        writer.addDouble ("confidence", 1.0);
       }
-      json_object_set_object_member (objectObj, "face", jobject);
+      writer.endObject ();
       break;
     case NVDS_OBJECT_TYPE_UNKNOWN:
       if(!meta->objectId) {
         break;
       }
       /** No information to add; object type unknown within NvDsEventMsgMeta */
-      jobject = json_object_new ();
-      json_object_set_object_member (objectObj, meta->objectId, jobject);
+      writer.beginObject (meta->objectId);
+      writer.endObject ();
       break;
     default:
       cout << "Object type not implemented" << endl;
   }
 
   // bbox sub object
-  jobject = json_object_new ();
-  json_object_set_int_member (jobject, "topleftx", meta->bbox.left);
-  json_object_set_int_member (jobject, "toplefty", meta->bbox.top);
-  json_object_set_int_member (jobject, "bottomrightx", meta->bbox.left + meta->bbox.width);
-  json_object_set_int_member (jobject, "bottomrighty", meta->bbox.top + meta->bbox.height);
-  json_object_set_object_member (objectObj, "bbox", jobject);
+  writer.beginObject ("bbox");
+  writer.addInt ("topleftx", meta->bbox.left);
+  writer.addInt ("toplefty", meta->bbox.top);
+  writer.addInt ("bottomrightx", meta->bbox.left + meta->bbox.width);
+  writer.addInt ("bottomrighty", meta->bbox.top + meta->bbox.height);
+  writer.endObject ();
 
   // signature sub array
   if (meta->objSignature.size) {
-    JsonArray *jArray = json_array_sized_new (meta->objSignature.size);
+    writer.beginArray ("signature");
 
     for (i = 0; i < meta->objSignature.size; i++) {
-      json_array_add_double_element (jArray, meta->objSignature.signature[i]);
+      writer.addDouble (NULL, meta->objSignature.signature[i]);
     }
-    json_object_set_array_member (objectObj, "signature", jArray);
+    writer.endArray ();
   }
 
   // location sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "lat", meta->location.lat);
-  json_object_set_double_member (jobject, "lon", meta->location.lon);
-  json_object_set_double_member (jobject, "alt", meta->location.alt);
-  json_object_set_object_member (objectObj, "location", jobject);
+  writer.beginObject ("location");
+  writer.addDouble ("lat", meta->location.lat);
+  writer.addDouble ("lon", meta->location.lon);
+  writer.addDouble ("alt", meta->location.alt);
+  writer.endObject ();
 
   // coordinate sub object
-  jobject = json_object_new ();
-  json_object_set_double_member (jobject, "x", meta->coordinate.x);
-  json_object_set_double_member (jobject, "y", meta->coordinate.y);
-  json_object_set_double_member (jobject, "z", meta->coordinate.z);
-  json_object_set_object_member (objectObj, "coordinate", jobject);
+  writer.beginObject ("coordinate");
+  writer.addDouble ("x", meta->coordinate.x);
+  writer.addDouble ("y", meta->coordinate.y);
+  writer.addDouble ("z", meta->coordinate.z);
+  writer.endObject ();
 
-  return objectObj;
+  writer.endObject ();
 }
 
-static gchar*
+static bool
 generate_schema_message (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
 {
-  JsonNode *rootNode;
-  JsonObject *rootObj;
-  JsonObject *placeObj;
-  JsonObject *sensorObj;
-  JsonObject *analyticsObj;
-  JsonObject *eventObj;
-  JsonObject *objectObj;
-  gchar *message;
+  NvDsPayloadPriv *privObj = (NvDsPayloadPriv *) ctx->privData;
+  NvDsJsonWriter &writer = privObj->writer;
 
   uuid_t msgId;
   gchar msgIdStr[37];
@@ -535,45 +543,37 @@ generate_schema_message (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
   uuid_generate_random (msgId);
   uuid_unparse_lower(msgId, msgIdStr);
 
+  writer.reset (privObj->prettyJson);
+
+  // root object
+  writer.beginObject ();
+  writer.addString ("messageid", msgIdStr);
+  writer.addString ("mdsversion", "1.0");
+  writer.addString ("@timestamp", meta->ts);
+
   // place object
-  placeObj = generate_place_object (ctx, meta);
+  generate_place_object (ctx, meta, writer);
 
   // sensor object
-  sensorObj = generate_sensor_object (ctx, meta);
+  generate_sensor_object (ctx, meta, writer);
 
   // analytics object
-  analyticsObj = generate_analytics_module_object (ctx, meta);
+  generate_analytics_module_object (ctx, meta, writer);
 
   // object object
-  objectObj = generate_object_object (ctx, meta);
+  generate_object_object (ctx, meta, writer);
 
   // event object
-  eventObj = generate_event_object (ctx, meta);
-
-  // root object
-  rootObj = json_object_new ();
-  json_object_set_string_member (rootObj, "messageid", msgIdStr);
-  json_object_set_string_member (rootObj, "mdsversion", "1.0");
-  json_object_set_string_member (rootObj, "@timestamp", meta->ts);
-  json_object_set_object_member (rootObj, "place", placeObj);
-  json_object_set_object_member (rootObj, "sensor", sensorObj);
-  json_object_set_object_member (rootObj, "analyticsModule", analyticsObj);
-  json_object_set_object_member (rootObj, "object", objectObj);
-  json_object_set_object_member (rootObj, "event", eventObj);
+  generate_event_object (ctx, meta, writer);
 
   if (meta->videoPath)
-    json_object_set_string_member (rootObj, "videoPath", meta->videoPath);
+    writer.addString ("videoPath", meta->videoPath);
   else
-    json_object_set_string_member (rootObj, "videoPath", "");
+    writer.addString ("videoPath", "");
 
-  rootNode = json_node_new (JSON_NODE_OBJECT);
-  json_node_set_object (rootNode, rootObj);
+  writer.endObject ();
 
-  message = json_to_string (rootNode, TRUE);
-  json_node_free (rootNode);
-  json_object_unref (rootObj);
-
-  return message;
+  return true;
 }
 
 static const gchar*
@@ -629,7 +629,47 @@ sensor_id_to_str (NvDsMsg2pCtx *ctx, gint sensorId)
   }
 }
 
-static gchar*
+/**
+ * Returns the key of the payload generated for the event, same as the
+ * sensor id written in the payload so that the protocol adaptors don't need
+ * to look it up in the payload again.
+ */
+static const gchar *
+payload_key (NvDsMsg2pCtx *ctx, NvDsEventMsgMeta *meta)
+{
+  NvDsPayloadPriv *privObj = (NvDsPayloadPriv *) ctx->privData;
+
+  if (ctx->payloadType != NVDS_PAYLOAD_DEEPSTREAM && meta->sensorStr)
+    return meta->sensorStr;
+
+  if (!privObj->hasConfig)
+    return NULL;
+
+  auto idMap = privObj->sensorObj.find (meta->sensorId);
+  if (idMap != privObj->sensorObj.end())
+    return idMap->second.id.c_str();
+
+  return NULL;
+}
+
+static void
+append_int (string &str, gint64 value)
+{
+  gchar buf[32];
+  gint len = snprintf (buf, sizeof (buf), "%" G_GINT64_FORMAT, value);
+  str.append (buf, len);
+}
+
+static void
+append_double (string &str, gdouble value)
+{
+  /* Same as default formatting of std::ostream. */
+  gchar buf[32];
+  gint len = snprintf (buf, sizeof (buf), "%g", value);
+  str.append (buf, len);
+}
+
+static bool
 generate_deepstream_message_minimal (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size)
 {
   /*
@@ -661,22 +701,45 @@ generate_deepstream_message_minimal (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint
   }
    */
 
-  JsonNode *rootNode;
-  JsonObject *jobject;
-  JsonArray *jArray;
+  NvDsPayloadPriv *privObj = (NvDsPayloadPriv *) ctx->privData;
+  NvDsJsonWriter &writer = privObj->writer;
+  string &ss = privObj->scratch;
   guint i;
-  stringstream ss;
-  gchar *message = NULL;
 
-  jArray = json_array_new ();
+  writer.reset (privObj->prettyJson);
+
+  // It is assumed that all events / objects are associated with same frame.
+  // Therefore ts / sensorId / frameId of first object can be used.
+
+  writer.beginObject ();
+  writer.addString ("version", "4.0");
+  writer.addInt ("id", events[0].metadata->frameId);
+  writer.addString ("@timestamp", events[0].metadata->ts);
+  if (events[0].metadata->sensorStr) {
+    writer.addString ("sensorId", events[0].metadata->sensorStr);
+  } else if (privObj->hasConfig) {
+    writer.addString ("sensorId",
+        to_str((gchar *) sensor_id_to_str (ctx, events[0].metadata->sensorId)));
+  } else {
+    writer.addString ("sensorId", "0");
+  }
+
+  writer.beginArray ("objects");
   for (i = 0; i < size; i++) {
-    ss.str("");
     ss.clear();
 
     NvDsEventMsgMeta *meta = events[i].metadata;
-    ss << meta->trackingId << "|" << meta->bbox.left << "|" << meta->bbox.top
-        << "|" << meta->bbox.left + meta->bbox.width << "|" << meta->bbox.top + meta->bbox.height
-        << "|" << object_enum_to_str (meta->objType, meta->objectId);
+    append_int (ss, meta->trackingId);
+    ss += "|";
+    append_int (ss, meta->bbox.left);
+    ss += "|";
+    append_int (ss, meta->bbox.top);
+    ss += "|";
+    append_int (ss, meta->bbox.left + meta->bbox.width);
+    ss += "|";
+    append_int (ss, meta->bbox.top + meta->bbox.height);
+    ss += "|";
+    ss += object_enum_to_str (meta->objType, meta->objectId);
 
     if (meta->extMsg && meta->extMsgSize) {
       // Attach secondary inference attributes.
@@ -684,28 +747,40 @@ generate_deepstream_message_minimal (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint
         case NVDS_OBJECT_TYPE_VEHICLE: {
           NvDsVehicleObject *dsObj = (NvDsVehicleObject *) meta->extMsg;
           if (dsObj) {
-            ss << "|#|" << to_str(dsObj->type) << "|" << to_str(dsObj->make) << "|"
-               << to_str(dsObj->model) << "|" << to_str(dsObj->color) << "|" << to_str(dsObj->license)
-               << "|" << to_str(dsObj->region) << "|" << meta->confidence;
+            ss += "|#|"; ss += to_str(dsObj->type);
+            ss += "|"; ss += to_str(dsObj->make);
+            ss += "|"; ss += to_str(dsObj->model);
+            ss += "|"; ss += to_str(dsObj->color);
+            ss += "|"; ss += to_str(dsObj->license);
+            ss += "|"; ss += to_str(dsObj->region);
+            ss += "|"; append_double (ss, meta->confidence);
           }
         }
           break;
         case NVDS_OBJECT_TYPE_PERSON: {
           NvDsPersonObject *dsObj = (NvDsPersonObject *) meta->extMsg;
           if (dsObj) {
-            ss << "|#|" << to_str(dsObj->gender) << "|" << dsObj->age << "|"
-                << to_str(dsObj->hair) << "|" << to_str(dsObj->cap) << "|" << to_str(dsObj->apparel)
-                << "|" << meta->confidence;
+            ss += "|#|"; ss += to_str(dsObj->gender);
+            ss += "|"; append_int (ss, dsObj->age);
+            ss += "|"; ss += to_str(dsObj->hair);
+            ss += "|"; ss += to_str(dsObj->cap);
+            ss += "|"; ss += to_str(dsObj->apparel);
+            ss += "|"; append_double (ss, meta->confidence);
           }
         }
           break;
         case NVDS_OBJECT_TYPE_FACE: {
           NvDsFaceObject *dsObj = (NvDsFaceObject *) meta->extMsg;
           if (dsObj) {
-            ss << "|#|" << to_str(dsObj->gender) << "|" << dsObj->age << "|"
-                << to_str(dsObj->hair) << "|" << to_str(dsObj->cap) << "|" << to_str(dsObj->glasses)
-                << "|" << to_str(dsObj->facialhair) << "|" << to_str(dsObj->name) << "|"
-                << "|" << to_str(dsObj->eyecolor) << "|" << meta->confidence;
+            ss += "|#|"; ss += to_str(dsObj->gender);
+            ss += "|"; append_int (ss, dsObj->age);
+            ss += "|"; ss += to_str(dsObj->hair);
+            ss += "|"; ss += to_str(dsObj->cap);
+            ss += "|"; ss += to_str(dsObj->glasses);
+            ss += "|"; ss += to_str(dsObj->facialhair);
+            ss += "|"; ss += to_str(dsObj->name);
+            ss += "|"; ss += "|"; ss += to_str(dsObj->eyecolor);
+            ss += "|"; append_double (ss, meta->confidence);
           }
         }
           break;
@@ -715,35 +790,13 @@ generate_deepstream_message_minimal (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint
       }
     }
 
-    json_array_add_string_element (jArray, ss.str().c_str());
-  }
-
-  // It is assumed that all events / objects are associated with same frame.
-  // Therefore ts / sensorId / frameId of first object can be used.
-
-  jobject = json_object_new ();
-  json_object_set_string_member (jobject, "version", "4.0");
-  json_object_set_int_member (jobject, "id", events[0].metadata->frameId);
-  json_object_set_string_member (jobject, "@timestamp", events[0].metadata->ts);
-  if (events[0].metadata->sensorStr) {
-    json_object_set_string_member (jobject, "sensorId", events[0].metadata->sensorStr);
-  } else if (ctx->privData) {
-    json_object_set_string_member (jobject, "sensorId",
-        to_str((gchar *) sensor_id_to_str (ctx, events[0].metadata->sensorId)));
-  } else {
-    json_object_set_string_member (jobject, "sensorId", "0");
+    writer.addString (NULL, ss.c_str());
   }
+  writer.endArray ();
 
-  json_object_set_array_member (jobject, "objects", jArray);
+  writer.endObject ();
 
-  rootNode = json_node_new (JSON_NODE_OBJECT);
-  json_node_set_object (rootNode, jobject);
-
-  message = json_to_string (rootNode, TRUE);
-  json_node_free (rootNode);
-  json_object_unref (jobject);
-
-  return message;
+  return true;
 }
 
 static bool
@@ -1202,6 +1255,7 @@ done:
 NvDsMsg2pCtx* nvds_msg2p_ctx_create (const gchar *file, NvDsPayloadType type)
 {
   NvDsMsg2pCtx *ctx = NULL;
+  NvDsPayloadPriv *privObj = NULL;
   string str;
   bool retVal = true;
 
@@ -1211,25 +1265,30 @@ NvDsMsg2pCtx* nvds_msg2p_ctx_create (const gchar *file, NvDsPayloadType type)
    */
   if (type == NVDS_PAYLOAD_DEEPSTREAM) {
     g_return_val_if_fail (file, NULL);
+  }
 
-    ctx = new NvDsMsg2pCtx;
-    ctx->privData = (void *) new NvDsPayloadPriv;
+  /* Private data is always allocated as it also holds the buffers
+   * message payloads are serialized into.
+   */
+  ctx = new NvDsMsg2pCtx;
+  privObj = new NvDsPayloadPriv;
+  ctx->privData = (void *) privObj;
 
+  if (type == NVDS_PAYLOAD_DEEPSTREAM) {
     if (g_str_has_suffix (file, ".csv")) {
       retVal = nvds_msg2p_parse_csv (ctx, file);
     } else {
       retVal = nvds_msg2p_parse_key_value (ctx, file);
     }
+    privObj->hasConfig = true;
   } else {
-    ctx = new NvDsMsg2pCtx;
     /* If configuration file is provided for minimal schema,
      * parse it for static values.
      */
     if (file) {
-      ctx->privData = (void *) new NvDsPayloadPriv;
       retVal = nvds_msg2p_parse_key_value (ctx, file);
+      privObj->hasConfig = true;
     } else {
-      ctx->privData = nullptr;
       retVal = true;
     }
   }
@@ -1260,36 +1319,47 @@ void nvds_msg2p_ctx_destroy (NvDsMsg2pCtx *ctx)
 NvDsPayload*
 nvds_msg2p_generate (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size)
 {
-  gchar *message = NULL;
-  gint len = 0;
+  NvDsPayloadPriv *privObj = (NvDsPayloadPriv *) ctx->privData;
+  bool generated = false;
   NvDsPayload *payload = (NvDsPayload *) g_malloc0 (sizeof (NvDsPayload));
   if (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM) {
-    message = generate_schema_message (ctx, events->metadata);
-    if (message) {
-      len = strlen (message);
-      // Remove '\0' character at the end of string and just copy the content.
-      payload->payload = g_memdup (message, len);
-      payload->payloadSize = len;
-      g_free (message);
-    }
+    generated = generate_schema_message (ctx, events->metadata);
   } else if (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM_MINIMAL) {
-    message = generate_deepstream_message_minimal (ctx, events, size);
-    if (message) {
-      len = strlen (message);
-      // Remove '\0' character at the end of string and just copy the content.
-      payload->payload = g_memdup (message, len);
-      payload->payloadSize = len;
-      g_free (message);
-    }
+    generated = generate_deepstream_message_minimal (ctx, events, size);
+  } else if (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM_BINARY) {
+    nvds_binary_payload_encode (privObj->binary, events, size);
+    payload->payload = g_memdup (privObj->binary.data (), privObj->binary.size ());
+    payload->payloadSize = privObj->binary.size ();
   } else if (ctx->payloadType == NVDS_PAYLOAD_CUSTOM) {
     payload->payload = (gpointer) g_strdup ("CUSTOM Schema");
     payload->payloadSize = strlen ((char *)payload->payload) + 1;
   } else
     payload->payload = NULL;
 
+  if (generated) {
+    // Message is not '\0' terminated, just copy the content.
+    payload->payload = g_memdup (privObj->writer.data (), privObj->writer.size ());
+    payload->payloadSize = privObj->writer.size ();
+  }
+
   return payload;
 }
 
+gboolean
+nvds_msg2p_payload_transferable (NvDsMsg2pCtx *ctx)
+{
+  return TRUE;
+}
+
+gchar *
+nvds_msg2p_generate_key (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size)
+{
+  if (!size || ctx->payloadType == NVDS_PAYLOAD_CUSTOM)
+    return NULL;
+
+  return g_strdup (payload_key (ctx, events[0].metadata));
+}
+
 void
 nvds_msg2p_release (NvDsMsg2pCtx *ctx, NvDsPayload *payload)
 {
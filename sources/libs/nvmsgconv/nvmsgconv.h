@@ -74,11 +74,40 @@ void nvds_msg2p_ctx_destroy (NvDsMsg2pCtx *ctx);
  * @param[in] size number of objects in array.
  *
  * @return pointer to @ref NvDsPayload generated or NULL in case of error.
- * This payload should be freed with @ref nvds_msg2p_release
+ * This payload should be freed with @ref nvds_msg2p_release.
  */
 NvDsPayload*
 nvds_msg2p_generate (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size);
 
+/**
+ * Optional entry point returning the key the payload generated for @a events
+ * can be partitioned / routed with, e.g. sensor id. The key is attached by
+ * nvmsgconv as @ref NvDsPayloadExt next to the payload, custom libraries
+ * don't need to implement it.
+ *
+ * @param[in] ctx pointer to library context.
+ * @param[in] events pointer to array of event objects.
+ * @param[in] size number of objects in array.
+ *
+ * @return '\0' terminated key allocated with g_malloc(), or NULL if the
+ * payload has no key.
+ */
+gchar *
+nvds_msg2p_generate_key (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size);
+
+/**
+ * Optional entry point telling whether payload data generated by
+ * @ref nvds_msg2p_generate is allocated with g_malloc() and can be taken over
+ * by consumers of the payload meta. Payload data is then set to NULL when
+ * the payload is passed to @ref nvds_msg2p_release. Consumers copy the
+ * payload data of libraries not implementing it.
+ *
+ * @param[in] ctx pointer to library context.
+ *
+ * @return TRUE if payload data can be taken over.
+ */
+gboolean nvds_msg2p_payload_transferable (NvDsMsg2pCtx *ctx);
+
 /**
  * This function should be called to release memory allocated for payload.
  *
@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "nvmsgconv_binary.h"
+#include "nvmsgconv_binary_priv.h"
+#include <cstring>
+
+using namespace std;
+
+struct NvDsBinaryReader {
+  const guint8 *cur;
+  const guint8 *end;
+  bool error;
+
+  NvDsBinaryReader (const guint8 *data, gsize size)
+      : cur (data), end (data + size), error (false) {}
+
+  bool more () const { return !error && cur < end; }
+
+  guint64 varint ()
+  {
+    guint64 value = 0;
+    for (guint shift = 0; shift < 64; shift += 7) {
+      if (cur >= end)
+        break;
+      guint8 byte = *cur++;
+      value |= (guint64) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+    error = true;
+    return 0;
+  }
+
+  gint64 svarint ()
+  {
+    guint64 value = varint ();
+    return (gint64) (value >> 1) ^ -(gint64) (value & 1);
+  }
+
+  gdouble fixed64 ()
+  {
+    guint64 bits = 0;
+    gdouble value;
+    if (end - cur < 8) {
+      error = true;
+      return 0;
+    }
+    for (guint i = 0; i < 8; i++)
+      bits |= (guint64) cur[i] << (8 * i);
+    cur += 8;
+    memcpy (&value, &bits, sizeof (value));
+    return value;
+  }
+
+  /** Returns a reader limited to the length delimited field. */
+  NvDsBinaryReader sub ()
+  {
+    guint64 len = varint ();
+    if (error || len > (guint64) (end - cur)) {
+      error = true;
+      return NvDsBinaryReader (cur, 0);
+    }
+    NvDsBinaryReader reader (cur, len);
+    cur += len;
+    return reader;
+  }
+
+  gchar *string ()
+  {
+    NvDsBinaryReader reader = sub ();
+    if (error)
+      return NULL;
+    return g_strndup ((const gchar *) reader.cur, reader.end - reader.cur);
+  }
+
+  void skip (guint wireType)
+  {
+    switch (wireType) {
+      case NVDS_WIRE_VARINT:
+        varint ();
+        break;
+      case NVDS_WIRE_FIXED64:
+        fixed64 ();
+        break;
+      case NVDS_WIRE_LENGTH:
+        sub ();
+        break;
+      case NVDS_WIRE_FIXED32:
+        if (end - cur < 4)
+          error = true;
+        else
+          cur += 4;
+        break;
+      default:
+        error = true;
+        break;
+    }
+  }
+};
+
+static void
+decode_vec3 (NvDsBinaryReader reader, gdouble *x, gdouble *y, gdouble *z,
+    bool &error)
+{
+  while (reader.more ()) {
+    guint64 tag = reader.varint ();
+    guint field = tag >> 3;
+    if ((tag & 7) != NVDS_WIRE_FIXED64) {
+      reader.skip (tag & 7);
+      continue;
+    }
+    gdouble value = reader.fixed64 ();
+    if (field == 1)
+      *x = value;
+    else if (field == 2)
+      *y = value;
+    else if (field == 3)
+      *z = value;
+  }
+  error |= reader.error;
+}
+
+/* Decodes sub message with string fields 1..n and an optional uint age. */
+static void
+decode_strings (NvDsBinaryReader reader, gchar **fields[], guint numFields,
+    guint ageField, guint *age, bool &error)
+{
+  while (reader.more ()) {
+    guint64 tag = reader.varint ();
+    guint field = tag >> 3;
+    guint wireType = tag & 7;
+    if (wireType == NVDS_WIRE_LENGTH && field >= 1 && field <= numFields) {
+      g_free (*fields[field - 1]);
+      *fields[field - 1] = reader.string ();
+    } else if (wireType == NVDS_WIRE_VARINT && age && field == ageField) {
+      *age = reader.varint ();
+    } else {
+      reader.skip (wireType);
+    }
+  }
+  error |= reader.error;
+}
+
+static void
+free_event (NvDsEventMsgMeta *meta)
+{
+  g_free (meta->objSignature.signature);
+  g_free (meta->ts);
+  g_free (meta->objectId);
+  g_free (meta->sensorStr);
+  g_free (meta->otherAttrs);
+  g_free (meta->videoPath);
+
+  if (meta->extMsg) {
+    switch (meta->objType) {
+      case NVDS_OBJECT_TYPE_VEHICLE: {
+        NvDsVehicleObject *obj = (NvDsVehicleObject *) meta->extMsg;
+        g_free (obj->type);
+        g_free (obj->make);
+        g_free (obj->model);
+        g_free (obj->color);
+        g_free (obj->region);
+        g_free (obj->license);
+      }
+        break;
+      case NVDS_OBJECT_TYPE_PERSON: {
+        NvDsPersonObject *obj = (NvDsPersonObject *) meta->extMsg;
+        g_free (obj->gender);
+        g_free (obj->hair);
+        g_free (obj->cap);
+        g_free (obj->apparel);
+      }
+        break;
+      case NVDS_OBJECT_TYPE_FACE: {
+        NvDsFaceObject *obj = (NvDsFaceObject *) meta->extMsg;
+        g_free (obj->gender);
+        g_free (obj->hair);
+        g_free (obj->cap);
+        g_free (obj->glasses);
+        g_free (obj->facialhair);
+        g_free (obj->name);
+        g_free (obj->eyecolor);
+      }
+        break;
+      default:
+        break;
+    }
+    g_free (meta->extMsg);
+  }
+}
+
+/* Wire type of each Event field. */
+static guint
+event_wire_type (guint field)
+{
+  switch (field) {
+    case NVDS_BIN_EVENT_CONFIDENCE:
+      return NVDS_WIRE_FIXED64;
+    case NVDS_BIN_EVENT_BBOX:
+    case NVDS_BIN_EVENT_LOCATION:
+    case NVDS_BIN_EVENT_COORDINATE:
+    case NVDS_BIN_EVENT_SIGNATURE:
+    case NVDS_BIN_EVENT_TS:
+    case NVDS_BIN_EVENT_OBJECT_ID:
+    case NVDS_BIN_EVENT_SENSOR_STR:
+    case NVDS_BIN_EVENT_OTHER_ATTRS:
+    case NVDS_BIN_EVENT_VIDEO_PATH:
+    case NVDS_BIN_EVENT_VEHICLE:
+    case NVDS_BIN_EVENT_PERSON:
+    case NVDS_BIN_EVENT_FACE:
+      return NVDS_WIRE_LENGTH;
+    default:
+      return NVDS_WIRE_VARINT;
+  }
+}
+
+static bool
+decode_event (NvDsBinaryReader reader, NvDsEventMsgMeta *meta)
+{
+  bool error = false;
+  NvDsObjectType extType = NVDS_OBJECT_TYPE_UNKNOWN;
+
+  while (reader.more () && !error) {
+    guint64 tag = reader.varint ();
+    guint field = tag >> 3;
+    guint wireType = tag & 7;
+
+    /* A field of another wire type than expected is skipped as an unknown
+     * one, rather than read with the wrong length. */
+    if (wireType != event_wire_type (field)) {
+      reader.skip (wireType);
+      continue;
+    }
+
+    switch (field) {
+      case NVDS_BIN_EVENT_TYPE:
+        meta->type = (NvDsEventType) reader.varint ();
+        break;
+      case NVDS_BIN_EVENT_OBJ_TYPE:
+        meta->objType = (NvDsObjectType) reader.varint ();
+        break;
+      case NVDS_BIN_EVENT_BBOX: {
+        NvDsBinaryReader bbox = reader.sub ();
+        while (bbox.more ()) {
+          guint64 t = bbox.varint ();
+          if ((t & 7) != NVDS_WIRE_VARINT) {
+            bbox.skip (t & 7);
+            continue;
+          }
+          gint value = bbox.svarint ();
+          switch (t >> 3) {
+            case 1: meta->bbox.top = value; break;
+            case 2: meta->bbox.left = value; break;
+            case 3: meta->bbox.width = value; break;
+            case 4: meta->bbox.height = value; break;
+            default: break;
+          }
+        }
+        error |= bbox.error;
+      }
+        break;
+      case NVDS_BIN_EVENT_LOCATION:
+        decode_vec3 (reader.sub (), &meta->location.lat, &meta->location.lon,
+            &meta->location.alt, error);
+        break;
+      case NVDS_BIN_EVENT_COORDINATE:
+        decode_vec3 (reader.sub (), &meta->coordinate.x, &meta->coordinate.y,
+            &meta->coordinate.z, error);
+        break;
+      case NVDS_BIN_EVENT_SIGNATURE: {
+        NvDsBinaryReader sig = reader.sub ();
+        guint count = (sig.end - sig.cur) / sizeof (gdouble);
+        g_free (meta->objSignature.signature);
+        meta->objSignature.signature = g_new (gdouble, count);
+        meta->objSignature.size = count;
+        for (guint i = 0; i < count; i++)
+          meta->objSignature.signature[i] = sig.fixed64 ();
+        error |= sig.error;
+      }
+        break;
+      case NVDS_BIN_EVENT_OBJ_CLASS_ID:
+        meta->objClassId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_SENSOR_ID:
+        meta->sensorId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_MODULE_ID:
+        meta->moduleId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_PLACE_ID:
+        meta->placeId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_COMPONENT_ID:
+        meta->componentId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_FRAME_ID:
+        meta->frameId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_CONFIDENCE:
+        meta->confidence = reader.fixed64 ();
+        break;
+      case NVDS_BIN_EVENT_TRACKING_ID:
+        meta->trackingId = reader.svarint ();
+        break;
+      case NVDS_BIN_EVENT_TS:
+        g_free (meta->ts);
+        meta->ts = reader.string ();
+        break;
+      case NVDS_BIN_EVENT_OBJECT_ID:
+        g_free (meta->objectId);
+        meta->objectId = reader.string ();
+        break;
+      case NVDS_BIN_EVENT_SENSOR_STR:
+        g_free (meta->sensorStr);
+        meta->sensorStr = reader.string ();
+        break;
+      case NVDS_BIN_EVENT_OTHER_ATTRS:
+        g_free (meta->otherAttrs);
+        meta->otherAttrs = reader.string ();
+        break;
+      case NVDS_BIN_EVENT_VIDEO_PATH:
+        g_free (meta->videoPath);
+        meta->videoPath = reader.string ();
+        break;
+      case NVDS_BIN_EVENT_VEHICLE:
+      case NVDS_BIN_EVENT_PERSON:
+      case NVDS_BIN_EVENT_FACE:
+        if (meta->extMsg) {
+          /* Only one ext object per event. */
+          reader.skip (wireType);
+        } else if (field == NVDS_BIN_EVENT_VEHICLE) {
+          NvDsVehicleObject *obj = g_new0 (NvDsVehicleObject, 1);
+          gchar **fields[] = {&obj->type, &obj->make, &obj->model,
+            &obj->color, &obj->region, &obj->license};
+          meta->extMsg = obj;
+          meta->extMsgSize = sizeof (NvDsVehicleObject);
+          extType = NVDS_OBJECT_TYPE_VEHICLE;
+          decode_strings (reader.sub (), fields, G_N_ELEMENTS (fields), 0,
+              NULL, error);
+        } else if (field == NVDS_BIN_EVENT_PERSON) {
+          NvDsPersonObject *obj = g_new0 (NvDsPersonObject, 1);
+          gchar **fields[] = {&obj->gender, &obj->hair, &obj->cap,
+            &obj->apparel};
+          meta->extMsg = obj;
+          meta->extMsgSize = sizeof (NvDsPersonObject);
+          extType = NVDS_OBJECT_TYPE_PERSON;
+          decode_strings (reader.sub (), fields, G_N_ELEMENTS (fields), 5,
+              &obj->age, error);
+        } else {
+          NvDsFaceObject *obj = g_new0 (NvDsFaceObject, 1);
+          gchar **fields[] = {&obj->gender, &obj->hair, &obj->cap,
+            &obj->glasses, &obj->facialhair, &obj->name, &obj->eyecolor};
+          meta->extMsg = obj;
+          meta->extMsgSize = sizeof (NvDsFaceObject);
+          extType = NVDS_OBJECT_TYPE_FACE;
+          decode_strings (reader.sub (), fields, G_N_ELEMENTS (fields), 8,
+              &obj->age, error);
+        }
+        break;
+      default:
+        reader.skip (wireType);
+        break;
+    }
+  }
+
+  if (meta->extMsg && meta->objType != extType) {
+    /* ext object must match the object type. Restore the type so that
+     * free_event() releases the ext object correctly.
+     */
+    meta->objType = extType;
+    error = true;
+  }
+
+  return !error && !reader.error;
+}
+
+NvDsBinaryPayload *
+nvds_binary_payload_decode (const guint8 *data, gsize size)
+{
+  NvDsBinaryReader reader (data, size);
+  vector<NvDsEventMsgMeta> events;
+  NvDsBinaryPayload *payload;
+  guint version = 0;
+  bool ok = true;
+
+  g_return_val_if_fail (data || !size, NULL);
+
+  while (reader.more () && ok) {
+    guint64 tag = reader.varint ();
+    guint field = tag >> 3;
+    guint wireType = tag & 7;
+
+    if (field == NVDS_BIN_PAYLOAD_VERSION && wireType == NVDS_WIRE_VARINT) {
+      version = reader.varint ();
+    } else if (field == NVDS_BIN_PAYLOAD_EVENTS && wireType == NVDS_WIRE_LENGTH) {
+      NvDsEventMsgMeta meta;
+      memset (&meta, 0, sizeof (meta));
+      ok = decode_event (reader.sub (), &meta);
+      events.push_back (meta);
+    } else {
+      reader.skip (wireType);
+    }
+  }
+
+  if (!ok || reader.error || version == 0 ||
+      version > NVDS_BINARY_PAYLOAD_VERSION) {
+    for (auto &meta : events)
+      free_event (&meta);
+    return NULL;
+  }
+
+  payload = g_new0 (NvDsBinaryPayload, 1);
+  payload->version = version;
+  payload->numEvents = events.size ();
+  if (payload->numEvents) {
+    payload->events = g_new (NvDsEventMsgMeta, payload->numEvents);
+    memcpy (payload->events, events.data (),
+        payload->numEvents * sizeof (NvDsEventMsgMeta));
+  }
+  return payload;
+}
+
+void
+nvds_binary_payload_free (NvDsBinaryPayload *payload)
+{
+  if (!payload)
+    return;
+
+  for (guint i = 0; i < payload->numEvents; i++)
+    free_event (&payload->events[i]);
+  g_free (payload->events);
+  g_free (payload);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/**
+ * @file
+ * <b>NVIDIA DeepStream: Binary Message Payload Interface</b>
+ *
+ * @b Description: This file specifies the layout of payloads generated for
+ * @ref NVDS_PAYLOAD_DEEPSTREAM_BINARY and the decoder interface to be used by
+ * message consumers (libnvds_msgconv_decoder.so).
+ *
+ * Payloads use the protocol buffers wire format, so they can also be decoded
+ * with any protobuf implementation using the following definition.
+ * Fields with zero / empty values are not written. Unknown fields, and fields
+ * of another wire type than in the definition, are skipped by the decoder, so
+ * fields can be added in a compatible way.
+ *
+ * @code
+ *   message Payload {
+ *     uint32 version = 1;
+ *     repeated Event events = 2;
+ *   }
+ *   message Rect { sint32 top = 1; sint32 left = 2; sint32 width = 3; sint32 height = 4; }
+ *   message Vec3 { double x = 1; double y = 2; double z = 3; }   // lat / lon / alt
+ *   message Vehicle {
+ *     string type = 1; string make = 2; string model = 3; string color = 4;
+ *     string region = 5; string license = 6;
+ *   }
+ *   message Person {
+ *     string gender = 1; string hair = 2; string cap = 3; string apparel = 4;
+ *     uint32 age = 5;
+ *   }
+ *   message Face {
+ *     string gender = 1; string hair = 2; string cap = 3; string glasses = 4;
+ *     string facialhair = 5; string name = 6; string eyecolor = 7; uint32 age = 8;
+ *   }
+ *   message Event {
+ *     uint32 type = 1;  uint32 objType = 2;  Rect bbox = 3;
+ *     Vec3 location = 4;  Vec3 coordinate = 5;  repeated double signature = 6;
+ *     sint32 objClassId = 7;  sint32 sensorId = 8;  sint32 moduleId = 9;
+ *     sint32 placeId = 10;  sint32 componentId = 11;  sint32 frameId = 12;
+ *     double confidence = 13;  sint32 trackingId = 14;  string ts = 15;
+ *     string objectId = 16;  string sensorStr = 17;  string otherAttrs = 18;
+ *     string videoPath = 19;
+ *     oneof ext { Vehicle vehicle = 20; Person person = 21; Face face = 22; }
+ *   }
+ * @endcode
+ */
+
+#ifndef NVMSGCONV_BINARY_H_
+#define NVMSGCONV_BINARY_H_
+
+#include "nvdsmeta_schema.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Version of binary payload layout written in each payload. */
+#define NVDS_BINARY_PAYLOAD_VERSION 1
+
+/**
+ * Holds events decoded from a binary payload.
+ *
+ * Ext objects (vehicle, person, face) are allocated and set to
+ * @a extMsg of each event. Strings absent from the payload are set to NULL.
+ */
+typedef struct NvDsBinaryPayload {
+  /** version of payload layout. */
+  guint version;
+  /** array of decoded events. */
+  NvDsEventMsgMeta *events;
+  /** number of events in the array. */
+  guint numEvents;
+} NvDsBinaryPayload;
+
+/**
+ * Decodes payload generated with @ref NVDS_PAYLOAD_DEEPSTREAM_BINARY.
+ *
+ * @param[in] data pointer to payload.
+ * @param[in] size size of payload in bytes.
+ *
+ * @return decoded payload or NULL if payload is malformed. It should be
+ * freed with @ref nvds_binary_payload_free
+ */
+NvDsBinaryPayload *nvds_binary_payload_decode (const guint8 *data, gsize size);
+
+/**
+ * Release the memory allocated for decoded payload.
+ *
+ * @param[in] payload pointer to decoded payload.
+ */
+void nvds_binary_payload_free (NvDsBinaryPayload *payload);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* NVMSGCONV_BINARY_H_ */
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "nvmsgconv_binary.h"
+#include "nvmsgconv_binary_priv.h"
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+void
+NvDsBinaryWriter::addVarint (guint64 value)
+{
+  while (value >= 0x80) {
+    m_Buffer->push_back ((gchar) (value | 0x80));
+    value >>= 7;
+  }
+  m_Buffer->push_back ((gchar) value);
+}
+
+void
+NvDsBinaryWriter::addTag (guint field, guint wireType)
+{
+  addVarint ((field << 3) | wireType);
+}
+
+void
+NvDsBinaryWriter::addUint (guint field, guint64 value)
+{
+  if (!value)
+    return;
+  addTag (field, NVDS_WIRE_VARINT);
+  addVarint (value);
+}
+
+void
+NvDsBinaryWriter::addSint (guint field, gint64 value)
+{
+  if (!value)
+    return;
+  addTag (field, NVDS_WIRE_VARINT);
+  /* zig-zag encoding to keep small negative values small. */
+  addVarint (((guint64) value << 1) ^ (guint64) (value >> 63));
+}
+
+void
+NvDsBinaryWriter::appendDouble (gdouble value)
+{
+  guint64 bits;
+  memcpy (&bits, &value, sizeof (bits));
+  for (guint i = 0; i < sizeof (bits); i++) {
+    m_Buffer->push_back ((gchar) (bits & 0xff));
+    bits >>= 8;
+  }
+}
+
+void
+NvDsBinaryWriter::addDouble (guint field, gdouble value)
+{
+  if (value == 0 && !signbit (value))
+    return;
+  addTag (field, NVDS_WIRE_FIXED64);
+  appendDouble (value);
+}
+
+void
+NvDsBinaryWriter::addString (guint field, const gchar *value)
+{
+  if (!value || !*value)
+    return;
+  gsize len = strlen (value);
+  addTag (field, NVDS_WIRE_LENGTH);
+  addVarint (len);
+  m_Buffer->append (value, len);
+}
+
+void
+NvDsBinaryWriter::addPackedDoubles (guint field, const gdouble *values,
+    guint count)
+{
+  if (!count)
+    return;
+  addTag (field, NVDS_WIRE_LENGTH);
+  addVarint ((guint64) count * sizeof (gdouble));
+  for (guint i = 0; i < count; i++)
+    appendDouble (values[i]);
+}
+
+void
+NvDsBinaryWriter::beginMessage (guint field)
+{
+  addTag (field, NVDS_WIRE_LENGTH);
+  /* Length is patched in endMessage(). Reserve the maximum size of a
+   * 32 bit varint and shrink the gap afterwards.
+   */
+  m_Open.push_back (m_Buffer->size ());
+  m_Buffer->append (5, '\0');
+}
+
+void
+NvDsBinaryWriter::endMessage ()
+{
+  gsize start = m_Open.back ();
+  m_Open.pop_back ();
+
+  gsize len = m_Buffer->size () - start - 5;
+  gchar varint[5];
+  guint n = 0;
+  guint64 value = len;
+  while (value >= 0x80) {
+    varint[n++] = (gchar) (value | 0x80);
+    value >>= 7;
+  }
+  varint[n++] = (gchar) value;
+
+  m_Buffer->replace (start, 5, varint, n);
+}
+
+static void
+encode_vec3 (NvDsBinaryWriter &writer, guint field, gdouble x, gdouble y,
+    gdouble z)
+{
+  if (x == 0 && y == 0 && z == 0)
+    return;
+  writer.beginMessage (field);
+  writer.addDouble (1, x);
+  writer.addDouble (2, y);
+  writer.addDouble (3, z);
+  writer.endMessage ();
+}
+
+static void
+encode_event (NvDsBinaryWriter &writer, NvDsEventMsgMeta *meta)
+{
+  writer.beginMessage (NVDS_BIN_PAYLOAD_EVENTS);
+
+  writer.addUint (NVDS_BIN_EVENT_TYPE, meta->type);
+  writer.addUint (NVDS_BIN_EVENT_OBJ_TYPE, meta->objType);
+
+  writer.beginMessage (NVDS_BIN_EVENT_BBOX);
+  writer.addSint (1, meta->bbox.top);
+  writer.addSint (2, meta->bbox.left);
+  writer.addSint (3, meta->bbox.width);
+  writer.addSint (4, meta->bbox.height);
+  writer.endMessage ();
+
+  encode_vec3 (writer, NVDS_BIN_EVENT_LOCATION, meta->location.lat,
+      meta->location.lon, meta->location.alt);
+  encode_vec3 (writer, NVDS_BIN_EVENT_COORDINATE, meta->coordinate.x,
+      meta->coordinate.y, meta->coordinate.z);
+  if (meta->objSignature.signature)
+    writer.addPackedDoubles (NVDS_BIN_EVENT_SIGNATURE,
+        meta->objSignature.signature, meta->objSignature.size);
+
+  writer.addSint (NVDS_BIN_EVENT_OBJ_CLASS_ID, meta->objClassId);
+  writer.addSint (NVDS_BIN_EVENT_SENSOR_ID, meta->sensorId);
+  writer.addSint (NVDS_BIN_EVENT_MODULE_ID, meta->moduleId);
+  writer.addSint (NVDS_BIN_EVENT_PLACE_ID, meta->placeId);
+  writer.addSint (NVDS_BIN_EVENT_COMPONENT_ID, meta->componentId);
+  writer.addSint (NVDS_BIN_EVENT_FRAME_ID, meta->frameId);
+  writer.addDouble (NVDS_BIN_EVENT_CONFIDENCE, meta->confidence);
+  writer.addSint (NVDS_BIN_EVENT_TRACKING_ID, meta->trackingId);
+  writer.addString (NVDS_BIN_EVENT_TS, meta->ts);
+  writer.addString (NVDS_BIN_EVENT_OBJECT_ID, meta->objectId);
+  writer.addString (NVDS_BIN_EVENT_SENSOR_STR, meta->sensorStr);
+  writer.addString (NVDS_BIN_EVENT_OTHER_ATTRS, meta->otherAttrs);
+  writer.addString (NVDS_BIN_EVENT_VIDEO_PATH, meta->videoPath);
+
+  if (meta->extMsg && meta->extMsgSize) {
+    switch (meta->objType) {
+      case NVDS_OBJECT_TYPE_VEHICLE: {
+        NvDsVehicleObject *dsObj = (NvDsVehicleObject *) meta->extMsg;
+        writer.beginMessage (NVDS_BIN_EVENT_VEHICLE);
+        writer.addString (1, dsObj->type);
+        writer.addString (2, dsObj->make);
+        writer.addString (3, dsObj->model);
+        writer.addString (4, dsObj->color);
+        writer.addString (5, dsObj->region);
+        writer.addString (6, dsObj->license);
+        writer.endMessage ();
+      }
+        break;
+      case NVDS_OBJECT_TYPE_PERSON: {
+        NvDsPersonObject *dsObj = (NvDsPersonObject *) meta->extMsg;
+        writer.beginMessage (NVDS_BIN_EVENT_PERSON);
+        writer.addString (1, dsObj->gender);
+        writer.addString (2, dsObj->hair);
+        writer.addString (3, dsObj->cap);
+        writer.addString (4, dsObj->apparel);
+        writer.addUint (5, dsObj->age);
+        writer.endMessage ();
+      }
+        break;
+      case NVDS_OBJECT_TYPE_FACE: {
+        NvDsFaceObject *dsObj = (NvDsFaceObject *) meta->extMsg;
+        writer.beginMessage (NVDS_BIN_EVENT_FACE);
+        writer.addString (1, dsObj->gender);
+        writer.addString (2, dsObj->hair);
+        writer.addString (3, dsObj->cap);
+        writer.addString (4, dsObj->glasses);
+        writer.addString (5, dsObj->facialhair);
+        writer.addString (6, dsObj->name);
+        writer.addString (7, dsObj->eyecolor);
+        writer.addUint (8, dsObj->age);
+        writer.endMessage ();
+      }
+        break;
+      default:
+        /* Custom ext objects are opaque; nothing can be encoded. */
+        break;
+    }
+  }
+
+  writer.endMessage ();
+}
+
+void
+nvds_binary_payload_encode (string &buffer, NvDsEvent *events, guint size)
+{
+  NvDsBinaryWriter writer (buffer);
+
+  buffer.clear ();
+  writer.addUint (NVDS_BIN_PAYLOAD_VERSION, NVDS_BINARY_PAYLOAD_VERSION);
+  for (guint i = 0; i < size; i++)
+    encode_event (writer, events[i].metadata);
+}
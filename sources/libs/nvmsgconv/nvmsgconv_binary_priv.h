@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#ifndef NVMSGCONV_BINARY_PRIV_H_
+#define NVMSGCONV_BINARY_PRIV_H_
+
+#include <glib.h>
+#include <string>
+#include <vector>
+#include "nvdsmeta_schema.h"
+
+/* protobuf wire types */
+enum {
+  NVDS_WIRE_VARINT = 0,
+  NVDS_WIRE_FIXED64 = 1,
+  NVDS_WIRE_LENGTH = 2,
+  NVDS_WIRE_FIXED32 = 5
+};
+
+/* Field numbers, refer the message definitions in nvmsgconv_binary.h */
+enum {
+  NVDS_BIN_PAYLOAD_VERSION = 1,
+  NVDS_BIN_PAYLOAD_EVENTS = 2
+};
+
+enum {
+  NVDS_BIN_EVENT_TYPE = 1,
+  NVDS_BIN_EVENT_OBJ_TYPE,
+  NVDS_BIN_EVENT_BBOX,
+  NVDS_BIN_EVENT_LOCATION,
+  NVDS_BIN_EVENT_COORDINATE,
+  NVDS_BIN_EVENT_SIGNATURE,
+  NVDS_BIN_EVENT_OBJ_CLASS_ID,
+  NVDS_BIN_EVENT_SENSOR_ID,
+  NVDS_BIN_EVENT_MODULE_ID,
+  NVDS_BIN_EVENT_PLACE_ID,
+  NVDS_BIN_EVENT_COMPONENT_ID,
+  NVDS_BIN_EVENT_FRAME_ID,
+  NVDS_BIN_EVENT_CONFIDENCE,
+  NVDS_BIN_EVENT_TRACKING_ID,
+  NVDS_BIN_EVENT_TS,
+  NVDS_BIN_EVENT_OBJECT_ID,
+  NVDS_BIN_EVENT_SENSOR_STR,
+  NVDS_BIN_EVENT_OTHER_ATTRS,
+  NVDS_BIN_EVENT_VIDEO_PATH,
+  NVDS_BIN_EVENT_VEHICLE,
+  NVDS_BIN_EVENT_PERSON,
+  NVDS_BIN_EVENT_FACE
+};
+
+/**
+ * Appends protobuf encoded fields to a caller owned buffer. Fields with
+ * default (zero / empty) values are skipped.
+ */
+class NvDsBinaryWriter
+{
+public:
+  NvDsBinaryWriter (std::string &buffer) : m_Buffer (&buffer) {}
+
+  void addUint (guint field, guint64 value);
+  void addSint (guint field, gint64 value);
+  void addDouble (guint field, gdouble value);
+  void addString (guint field, const gchar *value);
+  void addPackedDoubles (guint field, const gdouble *values, guint count);
+
+  /** Nested messages, length is filled in when the message is closed. */
+  void beginMessage (guint field);
+  void endMessage ();
+
+private:
+  void addVarint (guint64 value);
+  void addTag (guint field, guint wireType);
+  void appendDouble (gdouble value);
+
+  std::string *m_Buffer;
+  std::vector<gsize> m_Open;
+};
+
+/** Encode @a size events into @a buffer replacing its contents. */
+void nvds_binary_payload_encode (std::string &buffer, NvDsEvent *events,
+    guint size);
+
+#endif /* NVMSGCONV_BINARY_PRIV_H_ */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+#include "nvmsgconv_json.h"
+#include <cstdio>
+#include <cstring>
+
+/* Same values json-glib generator uses by default. */
+#define JSON_INDENT 2
+#define JSON_INDENT_CHAR ' '
+#define JSON_DEFAULT_CAPACITY 4096
+
+NvDsJsonWriter::NvDsJsonWriter (bool pretty) : m_Pretty (pretty)
+{
+  m_Buffer.reserve (JSON_DEFAULT_CAPACITY);
+  m_Members.reserve (8);
+}
+
+void
+NvDsJsonWriter::reset (bool pretty)
+{
+  m_Pretty = pretty;
+  m_Buffer.clear ();
+  m_Members.clear ();
+}
+
+void
+NvDsJsonWriter::appendIndent (guint level)
+{
+  if (m_Pretty)
+    m_Buffer.append (level * JSON_INDENT, JSON_INDENT_CHAR);
+}
+
+void
+NvDsJsonWriter::appendEscaped (const gchar *str)
+{
+  /* Mirrors json_strescape() of json-glib, including the characters it
+   * leaves as is, so that the output doesn't differ.
+   */
+  const gchar *p = str;
+  const gchar *run = str;
+
+  for (; *p; p++) {
+    gchar c = *p;
+    if (c == '\\' || c == '"' || (c > 0 && c < 0x1f) || c == 0x7f) {
+      m_Buffer.append (run, p - run);
+      run = p + 1;
+      switch (c) {
+        case '\\':
+          m_Buffer.append ("\\\\", 2);
+          break;
+        case '"':
+          m_Buffer.append ("\\\"", 2);
+          break;
+        case '\b':
+          m_Buffer.append ("\\b", 2);
+          break;
+        case '\f':
+          m_Buffer.append ("\\f", 2);
+          break;
+        case '\n':
+          m_Buffer.append ("\\n", 2);
+          break;
+        case '\r':
+          m_Buffer.append ("\\r", 2);
+          break;
+        case '\t':
+          m_Buffer.append ("\\t", 2);
+          break;
+        default: {
+          gchar esc[8];
+          gint len = snprintf (esc, sizeof (esc), "\\u00%.2x", c);
+          m_Buffer.append (esc, len);
+        }
+          break;
+      }
+    }
+  }
+  m_Buffer.append (run, p - run);
+}
+
+void
+NvDsJsonWriter::beginMember (const gchar *name)
+{
+  if (!m_Members.empty ()) {
+    if (m_Members.back ()++ > 0)
+      m_Buffer.push_back (',');
+    if (m_Pretty)
+      m_Buffer.push_back ('\n');
+  }
+
+  appendIndent (m_Members.size ());
+
+  if (name) {
+    m_Buffer.push_back ('"');
+    appendEscaped (name);
+    m_Buffer.push_back ('"');
+    if (m_Pretty)
+      m_Buffer.append (" : ", 3);
+    else
+      m_Buffer.push_back (':');
+  }
+}
+
+void
+NvDsJsonWriter::beginContainer (const gchar *name, gchar open)
+{
+  beginMember (name);
+  m_Buffer.push_back (open);
+  m_Members.push_back (0);
+}
+
+void
+NvDsJsonWriter::endContainer (gchar close)
+{
+  g_return_if_fail (!m_Members.empty ());
+
+  m_Members.pop_back ();
+  if (m_Pretty)
+    m_Buffer.push_back ('\n');
+  appendIndent (m_Members.size ());
+  m_Buffer.push_back (close);
+}
+
+void
+NvDsJsonWriter::beginObject (const gchar *name)
+{
+  beginContainer (name, '{');
+}
+
+void
+NvDsJsonWriter::endObject ()
+{
+  endContainer ('}');
+}
+
+void
+NvDsJsonWriter::beginArray (const gchar *name)
+{
+  beginContainer (name, '[');
+}
+
+void
+NvDsJsonWriter::endArray ()
+{
+  endContainer (']');
+}
+
+void
+NvDsJsonWriter::addString (const gchar *name, const gchar *value)
+{
+  if (!value) {
+    addNull (name);
+    return;
+  }
+
+  beginMember (name);
+  m_Buffer.push_back ('"');
+  appendEscaped (value);
+  m_Buffer.push_back ('"');
+}
+
+void
+NvDsJsonWriter::addInt (const gchar *name, gint64 value)
+{
+  gchar buf[32];
+  gint len = snprintf (buf, sizeof (buf), "%" G_GINT64_FORMAT, value);
+
+  beginMember (name);
+  m_Buffer.append (buf, len);
+}
+
+void
+NvDsJsonWriter::addDouble (const gchar *name, gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  beginMember (name);
+  g_ascii_dtostr (buf, sizeof (buf), value);
+  m_Buffer.append (buf);
+  /* json-glib makes sure doubles are always printed as doubles, checking
+   * for the decimal point only, exponents included ("1e+20.0"). */
+  if (!strchr (buf, '.'))
+    m_Buffer.append (".0", 2);
+}
+
+void
+NvDsJsonWriter::addNull (const gchar *name)
+{
+  beginMember (name);
+  m_Buffer.append ("null", 4);
+}
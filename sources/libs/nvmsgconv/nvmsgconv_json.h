@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/**
+ * @file
+ * <b>NVIDIA DeepStream: Streaming JSON Writer</b>
+ *
+ * @b Description: Serializes JSON directly into a reusable buffer. The output
+ * is byte-identical to json_to_string() of json-glib for the same sequence
+ * of members, in both pretty (2 space indent) and compact modes, so message
+ * payloads can be generated without building a JsonNode tree per event.
+ */
+
+#ifndef NVMSGCONV_JSON_H_
+#define NVMSGCONV_JSON_H_
+
+#include <glib.h>
+#include <string>
+#include <vector>
+
+class NvDsJsonWriter
+{
+public:
+  NvDsJsonWriter (bool pretty = true);
+
+  /** Discard the contents but keep the allocated capacity for reuse. */
+  void reset (bool pretty);
+
+  /**
+   * Open an object / array. @a name must be NULL for the root value and
+   * for array elements, and non-NULL for object members.
+   */
+  void beginObject (const gchar *name = nullptr);
+  void endObject ();
+  void beginArray (const gchar *name = nullptr);
+  void endArray ();
+
+  /** A NULL @a value is written as JSON null, like json-glib does. */
+  void addString (const gchar *name, const gchar *value);
+  void addInt (const gchar *name, gint64 value);
+  void addDouble (const gchar *name, gdouble value);
+  void addNull (const gchar *name);
+
+  const gchar *data () const { return m_Buffer.data (); }
+  gsize size () const { return m_Buffer.size (); }
+
+private:
+  void beginMember (const gchar *name);
+  void beginContainer (const gchar *name, gchar open);
+  void endContainer (gchar close);
+  void appendIndent (guint level);
+  void appendEscaped (const gchar *str);
+
+  bool m_Pretty;
+  std::string m_Buffer;
+  /** Number of members written so far, one entry per open container. */
+  std::vector<guint> m_Members;
+};
+
+#endif /* NVMSGCONV_JSON_H_ */
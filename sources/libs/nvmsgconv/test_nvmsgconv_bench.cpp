@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2019 NVIDIA Corporation.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ *
+ */
+
+/*
+ * Micro-benchmark for payload generation of nvmsgconv.
+ *
+ * Usage: test_nvmsgconv_bench <msgconv config> [baseline lib] [iterations]
+ *
+ * Synthetic batches of NvDsEventMsgMeta are converted with the library
+ * built in this directory and, if given, with a baseline build of the
+ * library (e.g. the json-glib based one shipped with the SDK) loaded side
+ * by side with dlopen. Payloads of both are compared after masking the
+ * random message / event uuids.
+ * Every generated payload is also parsed with json-glib and re-serialized
+ * in pretty and compact modes, to check NvDsJsonWriter output is identical
+ * to json_to_string().
+ * Binary payloads are compared against the JSON ones for size, encode and
+ * decode time, and decoded events are checked against the input.
+ */
+
+#include <stdio.h>
+#include <dlfcn.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <json-glib/json-glib.h>
+#include "nvmsgconv.h"
+#include "nvmsgconv_json.h"
+#include "nvmsgconv_binary.h"
+
+#define NEW_LIB "./libnvds_msgconv.so"
+#define BATCH_SIZE 32
+#define DEFAULT_ITERATIONS 2000
+#define SIGNATURE_SIZE 16
+
+typedef NvDsMsg2pCtx* (*nvds_msg2p_ctx_create_ptr) (const gchar *file, NvDsPayloadType type);
+typedef void (*nvds_msg2p_ctx_destroy_ptr) (NvDsMsg2pCtx *ctx);
+typedef NvDsPayload* (*nvds_msg2p_generate_ptr) (NvDsMsg2pCtx *ctx, NvDsEvent *events, guint size);
+typedef void (*nvds_msg2p_release_ptr) (NvDsMsg2pCtx *ctx, NvDsPayload *payload);
+
+struct MsgConvLib {
+  void *handle;
+  nvds_msg2p_ctx_create_ptr ctx_create;
+  nvds_msg2p_ctx_destroy_ptr ctx_destroy;
+  nvds_msg2p_generate_ptr generate;
+  nvds_msg2p_release_ptr release;
+};
+
+static bool
+load_lib (const char *path, MsgConvLib &lib)
+{
+  /* RTLD_LOCAL so that baseline and new library can be loaded together. */
+  lib.handle = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+  if (!lib.handle) {
+    fprintf (stderr, "%s\n", dlerror ());
+    return false;
+  }
+  *(void **) (&lib.ctx_create) = dlsym (lib.handle, "nvds_msg2p_ctx_create");
+  *(void **) (&lib.ctx_destroy) = dlsym (lib.handle, "nvds_msg2p_ctx_destroy");
+  *(void **) (&lib.generate) = dlsym (lib.handle, "nvds_msg2p_generate");
+  *(void **) (&lib.release) = dlsym (lib.handle, "nvds_msg2p_release");
+  return lib.ctx_create && lib.ctx_destroy && lib.generate && lib.release;
+}
+
+struct SyntheticBatch {
+  NvDsEventMsgMeta meta[BATCH_SIZE];
+  NvDsEvent events[BATCH_SIZE];
+  NvDsVehicleObject vehicle;
+  NvDsPersonObject person;
+  NvDsFaceObject face;
+  gdouble signature[SIGNATURE_SIZE];
+};
+
+static void
+fill_batch (SyntheticBatch &b)
+{
+  static gchar ts[] = "2019-08-21T10:17:23.376Z";
+  static gchar str[][16] = {"sedan", "Bugatti", "M", "blue", "CA", "CA 444",
+    "male", "black", "none", "formal", "Jon \"J\" Doe", "brown"};
+
+  memset (&b, 0, sizeof (b));
+  b.vehicle = {str[0], str[1], str[2], str[3], str[4], str[5]};
+  b.person = {str[6], str[7], str[8], str[9], 45};
+  b.face = {str[6], str[7], str[8], str[8], str[8], str[10], str[11], 31};
+  for (guint i = 0; i < SIGNATURE_SIZE; i++)
+    b.signature[i] = i / 7.0;
+
+  for (guint i = 0; i < BATCH_SIZE; i++) {
+    NvDsEventMsgMeta *m = &b.meta[i];
+    m->type = (NvDsEventType) (i % (NVDS_EVENT_RESET + 1));
+    m->objType = (NvDsObjectType) (i % 3);
+    m->bbox = {(gint) (10 + i), (gint) (20 + i), 100, 50};
+    m->location = {45.293701447, -75.8303914499, 48.1557479338};
+    m->coordinate = {5.2 * i, 10.1, 11.2};
+    if (i % 4 == 0) {
+      m->objSignature.signature = b.signature;
+      m->objSignature.size = SIGNATURE_SIZE;
+    }
+    m->frameId = 1234;
+    m->confidence = 0.1 * (i % 10);
+    m->trackingId = 1000 + i;
+    m->ts = ts;
+    if (i % 5 != 0) {
+      switch (m->objType) {
+        case NVDS_OBJECT_TYPE_VEHICLE:
+          m->extMsg = &b.vehicle;
+          m->extMsgSize = sizeof (b.vehicle);
+          break;
+        case NVDS_OBJECT_TYPE_PERSON:
+          m->extMsg = &b.person;
+          m->extMsgSize = sizeof (b.person);
+          break;
+        default:
+          m->extMsg = &b.face;
+          m->extMsgSize = sizeof (b.face);
+          break;
+      }
+    }
+    b.events[i].eventType = m->type;
+    b.events[i].metadata = m;
+  }
+}
+
+static void
+mask_uuids (std::string &str)
+{
+  /* uuid: 8-4-4-4-12 hex digits */
+  static const char pattern[] = "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx";
+  const size_t len = sizeof (pattern) - 1;
+
+  for (size_t i = 0; i + len <= str.size (); i++) {
+    size_t j = 0;
+    for (; j < len; j++) {
+      char c = str[i + j];
+      if (pattern[j] == '-' ? c != '-' : !isxdigit (c))
+        break;
+    }
+    if (j == len)
+      str.replace (i, len, pattern);
+  }
+}
+
+static void
+write_node (NvDsJsonWriter &writer, const gchar *name, JsonNode *node)
+{
+  switch (JSON_NODE_TYPE (node)) {
+    case JSON_NODE_OBJECT: {
+      JsonObject *object = json_node_get_object (node);
+      GList *members = json_object_get_members (object);
+      writer.beginObject (name);
+      for (GList *l = members; l; l = l->next) {
+        const gchar *member = (const gchar *) l->data;
+        write_node (writer, member, json_object_get_member (object, member));
+      }
+      writer.endObject ();
+      g_list_free (members);
+    }
+      break;
+    case JSON_NODE_ARRAY: {
+      JsonArray *array = json_node_get_array (node);
+      writer.beginArray (name);
+      for (guint i = 0; i < json_array_get_length (array); i++)
+        write_node (writer, NULL, json_array_get_element (array, i));
+      writer.endArray ();
+    }
+      break;
+    case JSON_NODE_NULL:
+      writer.addNull (name);
+      break;
+    case JSON_NODE_VALUE:
+      switch (json_node_get_value_type (node)) {
+        case G_TYPE_INT64:
+          writer.addInt (name, json_node_get_int (node));
+          break;
+        case G_TYPE_DOUBLE:
+          writer.addDouble (name, json_node_get_double (node));
+          break;
+        default:
+          writer.addString (name, json_node_get_string (node));
+          break;
+      }
+      break;
+  }
+}
+
+/* Returns number of mismatches between writer and json-glib generator. */
+static int
+verify_writer (const NvDsPayload *payload)
+{
+  std::string text ((const char *) payload->payload, payload->payloadSize);
+  JsonParser *parser = json_parser_new ();
+  NvDsJsonWriter writer;
+  int errors = 0;
+
+  if (!json_parser_load_from_data (parser, text.c_str (), text.size (), NULL)) {
+    g_object_unref (parser);
+    return 1;
+  }
+
+  JsonNode *root = json_parser_get_root (parser);
+  for (int pretty = 1; pretty >= 0; pretty--) {
+    gchar *expected = json_to_string (root, pretty);
+    writer.reset (pretty);
+    write_node (writer, NULL, root);
+    if (writer.size () != strlen (expected) ||
+        memcmp (writer.data (), expected, writer.size ())) {
+      fprintf (stderr, "%s output differs from json-glib:\n%s\n",
+          pretty ? "pretty" : "compact", expected);
+      errors++;
+    }
+    g_free (expected);
+  }
+  g_object_unref (parser);
+  return errors;
+}
+
+/* Doubles json-glib prints without a decimal point or with an exponent. */
+static int
+verify_writer_doubles ()
+{
+  static const gchar text[] =
+      "{\"big\":1e+20,\"small\":1.5e-07,\"whole\":3.0,\"half\":0.5}";
+  NvDsPayload payload = {(gpointer) text, (guint) strlen (text), 0};
+
+  return verify_writer (&payload);
+}
+
+static double
+now_us ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Full schema generates one payload per event, minimal one per batch. */
+static double
+run (MsgConvLib &lib, NvDsMsg2pCtx *ctx, SyntheticBatch &b, int iterations,
+     std::vector<std::string> *out, gsize *bytes)
+{
+  double start = now_us ();
+  *bytes = 0;
+  for (int it = 0; it < iterations; it++) {
+    if (ctx->payloadType == NVDS_PAYLOAD_DEEPSTREAM) {
+      for (guint i = 0; i < BATCH_SIZE; i++) {
+        NvDsPayload *payload = lib.generate (ctx, &b.events[i], 1);
+        if (it == 0) {
+          out->push_back (std::string ((char *) payload->payload, payload->payloadSize));
+          *bytes += payload->payloadSize;
+        }
+        lib.release (ctx, payload);
+      }
+    } else {
+      NvDsPayload *payload = lib.generate (ctx, b.events, BATCH_SIZE);
+      if (it == 0) {
+        out->push_back (std::string ((char *) payload->payload, payload->payloadSize));
+        *bytes += payload->payloadSize;
+      }
+      lib.release (ctx, payload);
+    }
+  }
+  return (now_us () - start) / ((double) iterations * BATCH_SIZE);
+}
+
+static bool
+str_equal (const gchar *a, const gchar *b)
+{
+  /* empty strings are not written in binary payload. */
+  return !g_strcmp0 (a && *a ? a : NULL, b && *b ? b : NULL);
+}
+
+/* Returns number of events not matching the input batch. */
+static int
+verify_binary (const NvDsBinaryPayload *decoded, SyntheticBatch &b)
+{
+  int errors = 0;
+
+  if (decoded->numEvents != BATCH_SIZE)
+    return 1;
+
+  for (guint i = 0; i < BATCH_SIZE; i++) {
+    NvDsEventMsgMeta *in = &b.meta[i];
+    NvDsEventMsgMeta *out = &decoded->events[i];
+    bool ok = in->type == out->type && in->objType == out->objType &&
+        !memcmp (&in->bbox, &out->bbox, sizeof (in->bbox)) &&
+        !memcmp (&in->location, &out->location, sizeof (in->location)) &&
+        !memcmp (&in->coordinate, &out->coordinate, sizeof (in->coordinate)) &&
+        in->objSignature.size == out->objSignature.size &&
+        (!in->objSignature.size || !memcmp (in->objSignature.signature,
+            out->objSignature.signature, in->objSignature.size * sizeof (gdouble))) &&
+        in->frameId == out->frameId && in->trackingId == out->trackingId &&
+        in->confidence == out->confidence && str_equal (in->ts, out->ts) &&
+        (in->extMsg != NULL) == (out->extMsg != NULL);
+
+    if (ok && in->extMsg) {
+      switch (in->objType) {
+        case NVDS_OBJECT_TYPE_VEHICLE: {
+          NvDsVehicleObject *x = (NvDsVehicleObject *) in->extMsg;
+          NvDsVehicleObject *y = (NvDsVehicleObject *) out->extMsg;
+          ok = str_equal (x->type, y->type) && str_equal (x->make, y->make) &&
+              str_equal (x->model, y->model) && str_equal (x->color, y->color) &&
+              str_equal (x->region, y->region) && str_equal (x->license, y->license);
+        }
+          break;
+        case NVDS_OBJECT_TYPE_PERSON: {
+          NvDsPersonObject *x = (NvDsPersonObject *) in->extMsg;
+          NvDsPersonObject *y = (NvDsPersonObject *) out->extMsg;
+          ok = x->age == y->age && str_equal (x->gender, y->gender) &&
+              str_equal (x->hair, y->hair) && str_equal (x->cap, y->cap) &&
+              str_equal (x->apparel, y->apparel);
+        }
+          break;
+        default: {
+          NvDsFaceObject *x = (NvDsFaceObject *) in->extMsg;
+          NvDsFaceObject *y = (NvDsFaceObject *) out->extMsg;
+          ok = x->age == y->age && str_equal (x->gender, y->gender) &&
+              str_equal (x->hair, y->hair) && str_equal (x->cap, y->cap) &&
+              str_equal (x->glasses, y->glasses) &&
+              str_equal (x->facialhair, y->facialhair) &&
+              str_equal (x->name, y->name) && str_equal (x->eyecolor, y->eyecolor);
+        }
+          break;
+      }
+    }
+    if (!ok) {
+      fprintf (stderr, "binary payload event %u differs from input\n", i);
+      errors++;
+    }
+  }
+  return errors;
+}
+
+/* Consumer side cost: time to get events back from the payloads. */
+static double
+decode_us (std::vector<std::string> &payloads, NvDsPayloadType type,
+    int iterations)
+{
+  double start = now_us ();
+  for (int it = 0; it < iterations; it++) {
+    for (auto &text : payloads) {
+      if (type == NVDS_PAYLOAD_DEEPSTREAM_BINARY) {
+        nvds_binary_payload_free (nvds_binary_payload_decode (
+            (const guint8 *) text.data (), text.size ()));
+      } else {
+        JsonParser *parser = json_parser_new ();
+        json_parser_load_from_data (parser, text.data (), text.size (), NULL);
+        g_object_unref (parser);
+      }
+    }
+  }
+  return (now_us () - start) / ((double) iterations * BATCH_SIZE);
+}
+
+int main (int argc, char *argv[])
+{
+  MsgConvLib newLib, baseLib;
+  bool haveBase = false;
+  int iterations = DEFAULT_ITERATIONS;
+  int errors = 0;
+  static SyntheticBatch batch;
+  NvDsPayloadType types[] = {NVDS_PAYLOAD_DEEPSTREAM,
+    NVDS_PAYLOAD_DEEPSTREAM_MINIMAL, NVDS_PAYLOAD_DEEPSTREAM_BINARY};
+
+  if (argc < 2) {
+    printf ("Usage: %s <msgconv config> [baseline lib] [iterations]\n", argv[0]);
+    return -1;
+  }
+  if (argc > 3)
+    iterations = atoi (argv[3]);
+
+  if (!load_lib (NEW_LIB, newLib)) {
+    printf ("unable to open %s\n", NEW_LIB);
+    return -1;
+  }
+  if (argc > 2) {
+    if (!load_lib (argv[2], baseLib)) {
+      printf ("unable to open %s\n", argv[2]);
+      return -1;
+    }
+    haveBase = true;
+  }
+
+  fill_batch (batch);
+  errors += verify_writer_doubles ();
+
+  for (NvDsPayloadType type : types) {
+    const char *name = type == NVDS_PAYLOAD_DEEPSTREAM ? "full" :
+        type == NVDS_PAYLOAD_DEEPSTREAM_MINIMAL ? "minimal" : "binary";
+    std::vector<std::string> newOut, baseOut;
+    gsize bytes;
+
+    NvDsMsg2pCtx *newCtx = newLib.ctx_create (argv[1], type);
+    if (!newCtx) {
+      printf ("Failed to create context with %s\n", argv[1]);
+      return -1;
+    }
+    double newUs = run (newLib, newCtx, batch, iterations, &newOut, &bytes);
+    printf ("%-8s schema: encode %8.3f us/event, decode %8.3f us/event, "
+        "%6.1f bytes/event\n", name, newUs,
+        decode_us (newOut, type, iterations / 10 + 1),
+        (double) bytes / BATCH_SIZE);
+
+    if (type == NVDS_PAYLOAD_DEEPSTREAM_BINARY) {
+      NvDsBinaryPayload *decoded = nvds_binary_payload_decode (
+          (const guint8 *) newOut[0].data (), newOut[0].size ());
+      errors += decoded ? verify_binary (decoded, batch) : 1;
+      nvds_binary_payload_free (decoded);
+      newLib.ctx_destroy (newCtx);
+      continue;
+    }
+
+    /* Compare writer against json-glib generator on first batch. */
+    for (auto &text : newOut) {
+      NvDsPayload payload = {(gpointer) text.data (), (guint) text.size (), 0};
+      errors += verify_writer (&payload);
+    }
+
+    if (haveBase) {
+      NvDsMsg2pCtx *baseCtx = baseLib.ctx_create (argv[1], type);
+      double baseUs = run (baseLib, baseCtx, batch, iterations, &baseOut, &bytes);
+      printf ("%-8s schema: baseline encode %8.3f us/event (x%.2f)\n", name,
+          baseUs, baseUs / newUs);
+
+      for (size_t i = 0; i < newOut.size () && i < baseOut.size (); i++) {
+        mask_uuids (newOut[i]);
+        mask_uuids (baseOut[i]);
+        if (newOut[i] != baseOut[i]) {
+          fprintf (stderr, "payload %zu differs from baseline:\n%s\n---\n%s\n",
+              i, baseOut[i].c_str (), newOut[i].c_str ());
+          errors++;
+        }
+      }
+      baseLib.ctx_destroy (baseCtx);
+    }
+    newLib.ctx_destroy (newCtx);
+  }
+
+  printf ("%s\n", errors ? "FAILED" : "PASSED");
+  return errors ? -1 : 0;
+}
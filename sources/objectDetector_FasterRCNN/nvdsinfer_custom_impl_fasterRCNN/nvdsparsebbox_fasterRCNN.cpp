@@ -20,94 +20,92 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <iostream>
 #include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_nms.h"
 #include "nvdssample_fasterRCNN_common.h"
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #define CLIP(a,min,max) (MAX(MIN(a, max), min))
 
-/* This is a sample bounding box parsing function for the sample FasterRCNN
- * detector model provided with the TensorRT samples. */
+/* This is a sample bounding box parser for the sample FasterRCNN detector
+ * model provided with the TensorRT samples, as a stateful parser
+ * (NvDsInferParseCustomFasterRCNN Create/Parse/Destroy) and as a parsing
+ * function. */
 
-extern "C"
-bool NvDsInferParseCustomFasterRCNN (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-        NvDsInferNetworkInfo  const &networkInfo,
-        NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+static const int NUM_CLASSES_FASTER_RCNN = 21;
 
-/* C-linkage to prevent name-mangling */
-extern "C"
-bool NvDsInferParseCustomFasterRCNN (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-        NvDsInferNetworkInfo  const &networkInfo,
-        NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList)
+/* Layout of the output layers and parameters of the parsing. */
+typedef struct
 {
-  static int bboxPredLayerIndex = -1;
-  static int clsProbLayerIndex = -1;
-  static int roisLayerIndex = -1;
-  static const int NUM_CLASSES_FASTER_RCNN = 21;
-  static bool classMismatchWarn = false;
+  int bboxPredLayerIndex;
+  int clsProbLayerIndex;
+  int roisLayerIndex;
   int numClassesToParse;
-
-  if (bboxPredLayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "bbox_pred") == 0) {
-        bboxPredLayerIndex = i;
-        break;
-      }
-    }
-    if (bboxPredLayerIndex == -1) {
-    std::cerr << "Could not find bbox_pred layer buffer while parsing" << std::endl;
-    return false;
-    }
+  NvDsInferNetworkInfo networkInfo;
+  std::vector<float> perClassThreshold;
+  /* IoU threshold of the per class NMS, 0 if disabled */
+  float nmsThreshold;
+} FasterRCNNParser;
+
+static int
+findLayer (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    const char *name)
+{
+  for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
+    if (strcmp(outputLayersInfo[i].layerName, name) == 0)
+      return i;
   }
+  std::cerr << "Could not find " << name << " layer buffer while parsing" <<
+    std::endl;
+  return -1;
+}
 
-  if (clsProbLayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "cls_prob") == 0) {
-        clsProbLayerIndex = i;
-        break;
-      }
-    }
-    if (clsProbLayerIndex == -1) {
-    std::cerr << "Could not find cls_prob layer buffer while parsing" << std::endl;
-    return false;
-    }
-  }
+static bool
+setupFasterRCNNParser (FasterRCNNParser &parser,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    NvDsInferNetworkInfo const &networkInfo,
+    NvDsInferParseDetectionParams const &detectionParams)
+{
+  static std::atomic<bool> classMismatchWarn(false);
 
-  if (roisLayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "rois") == 0) {
-        roisLayerIndex = i;
-        break;
-      }
-    }
-    if (roisLayerIndex == -1) {
-    std::cerr << "Could not find rois layer buffer while parsing" << std::endl;
+  parser.bboxPredLayerIndex = findLayer (outputLayersInfo, "bbox_pred");
+  parser.clsProbLayerIndex = findLayer (outputLayersInfo, "cls_prob");
+  parser.roisLayerIndex = findLayer (outputLayersInfo, "rois");
+  if (parser.bboxPredLayerIndex == -1 || parser.clsProbLayerIndex == -1 ||
+      parser.roisLayerIndex == -1)
     return false;
-    }
-  }
 
-  if (!classMismatchWarn) {
+  if (!classMismatchWarn.exchange(true)) {
     if (NUM_CLASSES_FASTER_RCNN !=
         detectionParams.numClassesConfigured) {
       std::cerr << "WARNING: Num classes mismatch. Configured:" <<
         detectionParams.numClassesConfigured << ", detected by network: " <<
         NUM_CLASSES_FASTER_RCNN << std::endl;
     }
-    classMismatchWarn = true;
   }
 
-  numClassesToParse = MIN (NUM_CLASSES_FASTER_RCNN,
+  parser.numClassesToParse = MIN (NUM_CLASSES_FASTER_RCNN,
       detectionParams.numClassesConfigured);
+  parser.networkInfo = networkInfo;
+  parser.perClassThreshold = detectionParams.perClassThreshold;
+  parser.nmsThreshold = 0.f;
+  return true;
+}
 
-  float *rois = (float *) outputLayersInfo[roisLayerIndex].buffer;
-  float *deltas = (float *) outputLayersInfo[bboxPredLayerIndex].buffer;
-  float *scores = (float *) outputLayersInfo[clsProbLayerIndex].buffer;
+static void
+parseFasterRCNN (FasterRCNNParser const &parser,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  NvDsInferNetworkInfo const &networkInfo = parser.networkInfo;
+  float *rois = (float *) outputLayersInfo[parser.roisLayerIndex].buffer;
+  float *deltas = (float *) outputLayersInfo[parser.bboxPredLayerIndex].buffer;
+  float *scores = (float *) outputLayersInfo[parser.clsProbLayerIndex].buffer;
 
   for (int i = 0; i < nmsMaxOut; ++i)
   {
@@ -116,10 +114,10 @@ bool NvDsInferParseCustomFasterRCNN (std::vector<NvDsInferLayerInfo> const &outp
     float ctr_x = rois[i * 4] + 0.5f * width;
     float ctr_y = rois[i * 4 + 1] + 0.5f * height;
     float *deltas_offset = deltas + i * NUM_CLASSES_FASTER_RCNN * 4;
-    for (int j = 0; j < numClassesToParse; ++j)
+    for (int j = 0; j < parser.numClassesToParse; ++j)
     {
       float confidence = scores[i * NUM_CLASSES_FASTER_RCNN + j];
-      if (confidence < detectionParams.perClassThreshold[j])
+      if (confidence < parser.perClassThreshold[j])
         continue;
       NvDsInferObjectDetectionInfo object;
 
@@ -149,8 +147,73 @@ bool NvDsInferParseCustomFasterRCNN (std::vector<NvDsInferLayerInfo> const &outp
       objectList.push_back(object);
     }
   }
+
+  /* Each roi gives a box per class, keep the best of the overlapping ones
+   * if enabled, otherwise they're clustered by nvinfer. */
+  if (parser.nmsThreshold > 0.f)
+    NvDsInferNms(objectList, NvDsInferNmsDefaultParams(parser.nmsThreshold));
+}
+
+/* C-linkage to prevent name-mangling */
+extern "C"
+NvDsInferParserHandle NvDsInferParseCustomFasterRCNNCreate (
+    NvDsInferParserInitParams const &initParams)
+{
+  FasterRCNNParser *parser = new FasterRCNNParser;
+
+  if (!setupFasterRCNNParser (*parser, initParams.outputLayersInfo,
+          initParams.networkInfo, initParams.detectionParams)) {
+    delete parser;
+    return nullptr;
+  }
+  /* custom-parser-properties=nms-threshold=<IoU> enables the NMS */
+  parser->nmsThreshold = NvDsInferParserGetPropertyFloat (initParams,
+      "nms-threshold", 0.f);
+  return parser;
+}
+
+extern "C"
+bool NvDsInferParseCustomFasterRCNNParse (NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  parseFasterRCNN (*(FasterRCNNParser *) handle, outputLayersInfo, objectList);
+  return true;
+}
+
+extern "C"
+void NvDsInferParseCustomFasterRCNNDestroy (NvDsInferParserHandle handle)
+{
+  delete (FasterRCNNParser *) handle;
+}
+
+extern "C"
+bool NvDsInferParseCustomFasterRCNN (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+extern "C"
+bool NvDsInferParseCustomFasterRCNN (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  /* Layers are looked up once, in a parser of the thread. */
+  static thread_local FasterRCNNParser parser;
+  static thread_local NvDsInferParserCallParams parserParams;
+  static thread_local bool parserValid;
+
+  if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+          networkInfo, detectionParams))
+    parserValid = setupFasterRCNNParser (parser, outputLayersInfo,
+        networkInfo, detectionParams);
+  if (!parserValid)
+    return false;
+  parseFasterRCNN (parser, outputLayersInfo, objectList);
   return true;
 }
 
-/* Check that the custom function has been defined correctly */
+/* Check that the custom functions have been defined correctly */
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomFasterRCNN);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomFasterRCNN);
@@ -21,6 +21,7 @@
  */
 
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 #include "nvdsinfer_custom_impl.h"
@@ -29,79 +30,88 @@
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #define CLIP(a,min,max) (MAX(MIN(a, max), min))
 
-/* This is a sample bounding box parsing function for the sample SSD UFF
- * detector model provided with the TensorRT samples. */
+/* This is a sample bounding box parser for the sample SSD UFF detector model
+ * provided with the TensorRT samples, as a stateful parser
+ * (NvDsInferParseCustomSSD Create/Parse/Destroy) and as a parsing function. */
 
-extern "C"
-bool NvDsInferParseCustomSSD (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-        NvDsInferNetworkInfo  const &networkInfo,
-        NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+static const int NUM_CLASSES_SSD = 91;
 
-/* C-linkage to prevent name-mangling */
-extern "C"
-bool NvDsInferParseCustomSSD (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
-        NvDsInferNetworkInfo  const &networkInfo,
-        NvDsInferParseDetectionParams const &detectionParams,
-        std::vector<NvDsInferObjectDetectionInfo> &objectList)
+/* Layout of the output layers and parameters of the parsing. */
+typedef struct
 {
-  static int nmsLayerIndex = -1;
-  static int nms1LayerIndex = -1;
-  static bool classMismatchWarn = false;
+  int nmsLayerIndex;
+  int nms1LayerIndex;
   int numClassesToParse;
-  static const int NUM_CLASSES_SSD = 91;
-
-  if (nmsLayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "NMS") == 0) {
-        nmsLayerIndex = i;
-        break;
-      }
+  NvDsInferNetworkInfo networkInfo;
+  std::vector<float> perClassThreshold;
+} SsdParser;
+
+static bool
+setupSsdParser (SsdParser &parser,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    NvDsInferNetworkInfo const &networkInfo,
+    NvDsInferParseDetectionParams const &detectionParams)
+{
+  static std::atomic<bool> classMismatchWarn(false);
+
+  parser.nmsLayerIndex = -1;
+  for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
+    if (strcmp(outputLayersInfo[i].layerName, "NMS") == 0) {
+      parser.nmsLayerIndex = i;
+      break;
     }
-    if (nmsLayerIndex == -1) {
+  }
+  if (parser.nmsLayerIndex == -1) {
     std::cerr << "Could not find NMS layer buffer while parsing" << std::endl;
     return false;
-    }
   }
 
-  if (nms1LayerIndex == -1) {
-    for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
-      if (strcmp(outputLayersInfo[i].layerName, "NMS_1") == 0) {
-        nms1LayerIndex = i;
-        break;
-      }
+  parser.nms1LayerIndex = -1;
+  for (unsigned int i = 0; i < outputLayersInfo.size(); i++) {
+    if (strcmp(outputLayersInfo[i].layerName, "NMS_1") == 0) {
+      parser.nms1LayerIndex = i;
+      break;
     }
-    if (nms1LayerIndex == -1) {
+  }
+  if (parser.nms1LayerIndex == -1) {
     std::cerr << "Could not find NMS_1 layer buffer while parsing" << std::endl;
     return false;
-    }
   }
 
-  if (!classMismatchWarn) {
+  if (!classMismatchWarn.exchange(true)) {
     if (NUM_CLASSES_SSD !=
         detectionParams.numClassesConfigured) {
       std::cerr << "WARNING: Num classes mismatch. Configured:" <<
         detectionParams.numClassesConfigured << ", detected by network: " <<
         NUM_CLASSES_SSD << std::endl;
     }
-    classMismatchWarn = true;
   }
 
-  numClassesToParse = MIN (NUM_CLASSES_SSD,
+  parser.numClassesToParse = MIN (NUM_CLASSES_SSD,
       detectionParams.numClassesConfigured);
+  parser.networkInfo = networkInfo;
+  parser.perClassThreshold = detectionParams.perClassThreshold;
+  return true;
+}
 
-  int keepCount = *((int *) outputLayersInfo[nms1LayerIndex].buffer);
-  float *detectionOut = (float *) outputLayersInfo[nmsLayerIndex].buffer;
+static void
+parseSsd (SsdParser const &parser,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  NvDsInferNetworkInfo const &networkInfo = parser.networkInfo;
+  int keepCount = *((int *) outputLayersInfo[parser.nms1LayerIndex].buffer);
+  float *detectionOut = (float *) outputLayersInfo[parser.nmsLayerIndex].buffer;
 
   for (int i = 0; i < keepCount; ++i)
   {
     float* det = detectionOut + i * 7;
     int classId = det[1];
 
-    if (classId >= numClassesToParse)
+    if (classId >= parser.numClassesToParse)
       continue;
 
-    float threshold = detectionParams.perClassThreshold[classId];
+    float threshold = parser.perClassThreshold[classId];
 
     if (det[2] < threshold)
       continue;
@@ -127,9 +137,65 @@ bool NvDsInferParseCustomSSD (std::vector<NvDsInferLayerInfo> const &outputLayer
 
     objectList.push_back(object);
   }
+}
+
+/* C-linkage to prevent name-mangling */
+extern "C"
+NvDsInferParserHandle NvDsInferParseCustomSSDCreate (
+    NvDsInferParserInitParams const &initParams)
+{
+  SsdParser *parser = new SsdParser;
+
+  if (!setupSsdParser (*parser, initParams.outputLayersInfo,
+          initParams.networkInfo, initParams.detectionParams)) {
+    delete parser;
+    return nullptr;
+  }
+  return parser;
+}
 
+extern "C"
+bool NvDsInferParseCustomSSDParse (NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+    std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  parseSsd (*(SsdParser *) handle, outputLayersInfo, objectList);
+  return true;
+}
+
+extern "C"
+void NvDsInferParseCustomSSDDestroy (NvDsInferParserHandle handle)
+{
+  delete (SsdParser *) handle;
+}
+
+extern "C"
+bool NvDsInferParseCustomSSD (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList);
+
+extern "C"
+bool NvDsInferParseCustomSSD (std::vector<NvDsInferLayerInfo> const &outputLayersInfo,
+        NvDsInferNetworkInfo  const &networkInfo,
+        NvDsInferParseDetectionParams const &detectionParams,
+        std::vector<NvDsInferObjectDetectionInfo> &objectList)
+{
+  /* Layers are looked up once, in a parser of the thread. */
+  static thread_local SsdParser parser;
+  static thread_local NvDsInferParserCallParams parserParams;
+  static thread_local bool parserValid;
+
+  if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+          networkInfo, detectionParams))
+    parserValid = setupSsdParser (parser, outputLayersInfo, networkInfo,
+        detectionParams);
+  if (!parserValid)
+    return false;
+  parseSsd (parser, outputLayersInfo, objectList);
   return true;
 }
 
-/* Check that the custom function has been defined correctly */
+/* Check that the custom functions have been defined correctly */
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomSSD);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomSSD);
@@ -21,6 +21,8 @@
  */
 
 #include "nvdsinfer_custom_impl.h"
+#include "nvdsinfer_nms.h"
+#include "nvdsinfer_yolodecoder.h"
 #include <algorithm>
 #include <cassert>
 #include <cmath>
@@ -31,6 +33,45 @@
 
 static const int NUM_CLASSES_YOLO = 80;
 
+/* Anchors and masks of the yolo layers of each network */
+static const std::vector<float> kANCHORS_V3 = {
+    10.0, 13.0, 16.0,  30.0,  33.0, 23.0,  30.0,  61.0,  62.0,
+    45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0};
+static const std::vector<std::vector<int>> kMASKS_V3 = {
+    {6, 7, 8},
+    {3, 4, 5},
+    {0, 1, 2}};
+static const std::vector<float> kANCHORS_V3_TINY = {
+    10, 14, 23, 27, 37, 58, 81, 82, 135, 169, 344, 319};
+static const std::vector<std::vector<int>> kMASKS_V3_TINY = {
+    {3, 4, 5},
+    //{0, 1, 2}}; // as per output result, select {1,2,3}
+    {1, 2, 3}};
+static const std::vector<float> kANCHORS_V2 = {
+    18.3273602, 21.6763191, 59.9827194, 66.0009613,
+    106.829758, 175.178879, 252.250244, 112.888962,
+    312.656647, 293.384949 };
+static const uint kNUM_BBOXES_V2 = 5;
+
+/* Default thresholds, which custom-parser-properties can override
+ * (nms-threshold, prob-threshold) */
+static const float kNMS_THRESH_V3 = 0.3f;
+static const float kPROB_THRESH_V3 = 0.7f;
+static const float kNMS_THRESH_V2 = 0.3f;
+static const float kPROB_THRESH_V2 = 0.6f;
+static const float kNMS_THRESH_V2_TINY = 0.2f;
+static const float kPROB_THRESH_V2_TINY = 0.6f;
+
+/* Output layers to decode and parameters of the parsing. */
+struct YoloParser
+{
+    /* Index in the output layers and decoding of each layer. */
+    std::vector<std::pair<uint, NvDsInferYoloLayer>> layers;
+    NvDsInferNetworkInfo networkInfo;
+    float nmsThreshold;
+    float probThreshold;
+};
+
 extern "C" bool NvDsInferParseCustomYoloV3(
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
     NvDsInferNetworkInfo const& networkInfo,
@@ -55,260 +96,40 @@ extern "C" bool NvDsInferParseCustomYoloV2Tiny(
     NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList);
 
-static unsigned clamp(const uint val, const uint minVal, const uint maxVal)
-{
-    assert(minVal <= maxVal);
-    return std::min(maxVal, std::max(minVal, val));
-}
-
-/* This is a sample bounding box parsing function for the sample YoloV3 detector model */
-static NvDsInferParseObjectInfo convertBBox(const float& bx, const float& by, const float& bw,
-                                     const float& bh, const int& stride, const uint& netW,
-                                     const uint& netH)
-{
-    NvDsInferParseObjectInfo b;
-    // Restore coordinates to network input resolution
-    float x = bx * stride;
-    float y = by * stride;
-
-    b.left = x - bw / 2;
-    b.width = bw;
-
-    b.top = y - bh / 2;
-    b.height = bh;
-
-    b.left = clamp(b.left, 0, netW);
-    b.width = clamp(b.width, 0, netW);
-    b.top = clamp(b.top, 0, netH);
-    b.height = clamp(b.height, 0, netH);
-
-    return b;
-}
-
-static void addBBoxProposal(const float bx, const float by, const float bw, const float bh,
-                     const uint stride, const uint& netW, const uint& netH, const int maxIndex,
-                     const float maxProb, std::vector<NvDsInferParseObjectInfo>& binfo)
-{
-    NvDsInferParseObjectInfo bbi = convertBBox(bx, by, bw, bh, stride, netW, netH);
-    if (((bbi.left + bbi.width) > netW) || ((bbi.top + bbi.height) > netH)) return;
-
-    bbi.detectionConfidence = maxProb;
-    bbi.classId = maxIndex;
-    binfo.push_back(bbi);
-}
-
-static std::vector<NvDsInferParseObjectInfo>
-nonMaximumSuppression(const float nmsThresh, std::vector<NvDsInferParseObjectInfo> binfo)
-{
-    auto overlap1D = [](float x1min, float x1max, float x2min, float x2max) -> float {
-        if (x1min > x2min)
-        {
-            std::swap(x1min, x2min);
-            std::swap(x1max, x2max);
-        }
-        return x1max < x2min ? 0 : std::min(x1max, x2max) - x2min;
-    };
-    auto computeIoU
-        = [&overlap1D](NvDsInferParseObjectInfo& bbox1, NvDsInferParseObjectInfo& bbox2) -> float {
-        float overlapX
-            = overlap1D(bbox1.left, bbox1.left + bbox1.width, bbox2.left, bbox2.left + bbox2.width);
-        float overlapY
-            = overlap1D(bbox1.top, bbox1.top + bbox1.height, bbox2.top, bbox2.top + bbox2.height);
-        float area1 = (bbox1.width) * (bbox1.height);
-        float area2 = (bbox2.width) * (bbox2.height);
-        float overlap2D = overlapX * overlapY;
-        float u = area1 + area2 - overlap2D;
-        return u == 0 ? 0 : overlap2D / u;
-    };
-
-    std::stable_sort(binfo.begin(), binfo.end(),
-                     [](const NvDsInferParseObjectInfo& b1, const NvDsInferParseObjectInfo& b2) {
-                         return b1.detectionConfidence > b2.detectionConfidence;
-                     });
-    std::vector<NvDsInferParseObjectInfo> out;
-    for (auto i : binfo)
-    {
-        bool keep = true;
-        for (auto j : out)
-        {
-            if (keep)
-            {
-                float overlap = computeIoU(i, j);
-                keep = overlap <= nmsThresh;
-            }
-            else
-                break;
-        }
-        if (keep) out.push_back(i);
-    }
-    return out;
-}
-
-static std::vector<NvDsInferParseObjectInfo>
-nmsAllClasses(const float nmsThresh,
-        std::vector<NvDsInferParseObjectInfo>& binfo,
-        const uint numClasses)
-{
-    std::vector<NvDsInferParseObjectInfo> result;
-    std::vector<std::vector<NvDsInferParseObjectInfo>> splitBoxes(numClasses);
-    for (auto& box : binfo)
-    {
-        splitBoxes.at(box.classId).push_back(box);
-    }
-
-    for (auto& boxes : splitBoxes)
-    {
-        boxes = nonMaximumSuppression(nmsThresh, boxes);
-        result.insert(result.end(), boxes.begin(), boxes.end());
-    }
-    return result;
-}
-
-static std::vector<NvDsInferParseObjectInfo>
-decodeYoloV2Tensor(
-    const float* detections, const std::vector<float> &anchors,
-    const uint gridSize, const uint stride, const uint numBBoxes,
-    const uint numOutputClasses, const float probThresh, const uint& netW,
-    const uint& netH)
+static inline std::vector<uint>
+SortLayers(const std::vector<NvDsInferLayerInfo> & outputLayersInfo)
 {
-    std::vector<NvDsInferParseObjectInfo> binfo;
-    for (uint y = 0; y < gridSize; ++y)
-    {
-        for (uint x = 0; x < gridSize; ++x)
-        {
-            for (uint b = 0; b < numBBoxes; ++b)
-            {
-                const float pw = anchors[b * 2];
-                const float ph = anchors[b * 2 + 1];
-
-                const int numGridCells = gridSize * gridSize;
-                const int bbindex = y * gridSize + x;
-                const float bx
-                    = x + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 0)];
-                const float by
-                    = y + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 1)];
-                const float bw
-                    = pw * exp (detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 2)]);
-                const float bh
-                    = ph * exp (detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 3)]);
-
-                const float objectness
-                    = detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 4)];
-
-                float maxProb = 0.0f;
-                int maxIndex = -1;
-
-                for (uint i = 0; i < numOutputClasses; ++i)
-                {
-                    float prob
-                        = (detections[bbindex
-                                      + numGridCells * (b * (5 + numOutputClasses) + (5 + i))]);
-
-                    if (prob > maxProb)
-                    {
-                        maxProb = prob;
-                        maxIndex = i;
-                    }
-                }
-                maxProb = objectness * maxProb;
-
-                if (maxProb > probThresh)
-                {
-                    addBBoxProposal(bx, by, bw, bh, stride, netW, netH, maxIndex, maxProb, binfo);
-                }
-            }
-        }
+    std::vector<uint> outLayers;
+    for (uint i = 0; i < outputLayersInfo.size(); i++) {
+        outLayers.push_back (i);
     }
-    return binfo;
+    std::sort (outLayers.begin(), outLayers.end(),
+      [&outputLayersInfo](uint a, uint b){
+          return outputLayersInfo[a].dims.d[1] < outputLayersInfo[b].dims.d[1];
+      });
+    return outLayers;
 }
 
-
-static std::vector<NvDsInferParseObjectInfo>
-decodeYoloV3Tensor(
-    const float* detections, const std::vector<int> &mask, const std::vector<float> &anchors,
-    const uint gridSize, const uint stride, const uint numBBoxes,
-    const uint numOutputClasses, const float probThresh, const uint& netW,
-    const uint& netH)
+static void WarnClassMismatch(
+    NvDsInferParseDetectionParams const& detectionParams)
 {
-    std::vector<NvDsInferParseObjectInfo> binfo;
-    for (uint y = 0; y < gridSize; ++y)
+    if (NUM_CLASSES_YOLO != detectionParams.numClassesConfigured)
     {
-        for (uint x = 0; x < gridSize; ++x)
-        {
-            for (uint b = 0; b < numBBoxes; ++b)
-            {
-                const float pw = anchors[mask[b] * 2];
-                const float ph = anchors[mask[b] * 2 + 1];
-
-                const int numGridCells = gridSize * gridSize;
-                const int bbindex = y * gridSize + x;
-                const float bx
-                    = x + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 0)];
-                const float by
-                    = y + detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 1)];
-                const float bw
-                    = pw * detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 2)];
-                const float bh
-                    = ph * detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 3)];
-
-                const float objectness
-                    = detections[bbindex + numGridCells * (b * (5 + numOutputClasses) + 4)];
-
-                float maxProb = 0.0f;
-                int maxIndex = -1;
-
-                for (uint i = 0; i < numOutputClasses; ++i)
-                {
-                    float prob
-                        = (detections[bbindex
-                                      + numGridCells * (b * (5 + numOutputClasses) + (5 + i))]);
-
-                    if (prob > maxProb)
-                    {
-                        maxProb = prob;
-                        maxIndex = i;
-                    }
-                }
-                maxProb = objectness * maxProb;
-
-                if (maxProb > probThresh)
-                {
-                    addBBoxProposal(bx, by, bw, bh, stride, netW, netH, maxIndex, maxProb, binfo);
-                }
-            }
-        }
-    }
-    return binfo;
-}
-
-static inline std::vector<const NvDsInferLayerInfo*>
-SortLayers(const std::vector<NvDsInferLayerInfo> & outputLayersInfo)
-{
-    std::vector<const NvDsInferLayerInfo*> outLayers;
-    for (auto const &layer : outputLayersInfo) {
-        outLayers.push_back (&layer);
+        std::cerr << "WARNING: Num classes mismatch. Configured:"
+                  << detectionParams.numClassesConfigured
+                  << ", detected by network: " << NUM_CLASSES_YOLO << std::endl;
     }
-    std::sort (outLayers.begin(), outLayers.end(),
-      [](const NvDsInferLayerInfo *a, const NvDsInferLayerInfo *b){
-          return a->dims.d[1] < b->dims.d[1];
-      });
-    return outLayers;
 }
 
-static bool NvDsInferParseYoloV3(
+static bool SetupYoloV3(
+    YoloParser& parser,
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
     NvDsInferNetworkInfo const& networkInfo,
     NvDsInferParseDetectionParams const& detectionParams,
-    std::vector<NvDsInferParseObjectInfo>& objectList,
     const std::vector<float> &anchors,
     const std::vector<std::vector<int>> &masks)
 {
-    const uint kNUM_BBOXES = 3;
-    static const float kNMS_THRESH = 0.3f;
-    static const float kPROB_THRESH = 0.7f;
-
-    const std::vector<const NvDsInferLayerInfo*> sortedLayers =
-        SortLayers (outputLayersInfo);
+    const std::vector<uint> sortedLayers = SortLayers (outputLayersInfo);
 
     if (sortedLayers.size() != masks.size()) {
         std::cerr << "ERROR: yoloV3 output layer.size: " << sortedLayers.size()
@@ -316,33 +137,76 @@ static bool NvDsInferParseYoloV3(
         return false;
     }
 
-    if (NUM_CLASSES_YOLO != detectionParams.numClassesConfigured)
-    {
-        std::cerr << "WARNING: Num classes mismatch. Configured:"
-                  << detectionParams.numClassesConfigured
-                  << ", detected by network: " << NUM_CLASSES_YOLO << std::endl;
-    }
-
-    std::vector<NvDsInferParseObjectInfo> objects;
+    WarnClassMismatch (detectionParams);
 
+    parser.layers.clear();
     for (uint idx = 0; idx < masks.size(); ++idx) {
-        const NvDsInferLayerInfo &layer = *sortedLayers[idx]; // 255 x Grid x Grid
+        const NvDsInferLayerInfo &layer = outputLayersInfo[sortedLayers[idx]]; // 255 x Grid x Grid
         assert (layer.dims.numDims == 3);
         const uint gridSize = layer.dims.d[1];
         const uint stride = networkInfo.width / gridSize;
 
-        std::vector<NvDsInferParseObjectInfo> outObjs =
-            decodeYoloV3Tensor((const float*)(layer.buffer), masks[idx], anchors, gridSize, stride, kNUM_BBOXES,
-                       NUM_CLASSES_YOLO, kPROB_THRESH, networkInfo.width, networkInfo.height);
-        objects.insert(objects.end(), outObjs.begin(), outObjs.end());
+        parser.layers.emplace_back (sortedLayers[idx],
+            NvDsInferYoloLayerV3(gridSize, stride, NUM_CLASSES_YOLO, anchors, masks[idx]));
     }
+    parser.networkInfo = networkInfo;
+    parser.nmsThreshold = kNMS_THRESH_V3;
+    parser.probThreshold = kPROB_THRESH_V3;
+    return true;
+}
 
-    objectList.clear();
-    objectList = nmsAllClasses(kNMS_THRESH, objects, NUM_CLASSES_YOLO);
+static bool SetupYoloV2(
+    YoloParser& parser,
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    const float nmsThreshold, const float probthreshold)
+{
+    if (outputLayersInfo.empty()) {
+        std::cerr << "Could not find output layer in bbox parsing" << std::endl;;
+        return false;
+    }
+    const NvDsInferLayerInfo &layer = outputLayersInfo[0];
 
+    WarnClassMismatch (detectionParams);
+
+    assert (layer.dims.numDims == 3);
+    const uint gridSize = layer.dims.d[1];
+    const uint stride = networkInfo.width / gridSize;
+    parser.layers.clear();
+    parser.layers.emplace_back (0,
+        NvDsInferYoloLayerV2(gridSize, stride, kNUM_BBOXES_V2, NUM_CLASSES_YOLO, kANCHORS_V2));
+    parser.networkInfo = networkInfo;
+    parser.nmsThreshold = nmsThreshold;
+    parser.probThreshold = probthreshold;
     return true;
 }
 
+static void ParseYolo(
+    YoloParser const& parser,
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    objectList.clear();
+    for (auto const &layer : parser.layers) {
+        NvDsInferYoloDecode((const float*)(outputLayersInfo[layer.first].buffer),
+            layer.second, parser.probThreshold, parser.networkInfo.width,
+            parser.networkInfo.height, objectList);
+    }
+
+    NvDsInferNms(objectList, NvDsInferNmsDefaultParams(parser.nmsThreshold));
+}
+
+/* Reads the thresholds of the properties of a parser instance. */
+static YoloParser* ReadYoloProperties(
+    YoloParser* parser, NvDsInferParserInitParams const& initParams)
+{
+    parser->nmsThreshold = NvDsInferParserGetPropertyFloat (initParams,
+        "nms-threshold", parser->nmsThreshold);
+    parser->probThreshold = NvDsInferParserGetPropertyFloat (initParams,
+        "prob-threshold", parser->probThreshold);
+    return parser;
+}
 
 /* C-linkage to prevent name-mangling */
 extern "C" bool NvDsInferParseCustomYoloV3(
@@ -351,16 +215,19 @@ extern "C" bool NvDsInferParseCustomYoloV3(
     NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const std::vector<float> kANCHORS = {
-        10.0, 13.0, 16.0,  30.0,  33.0, 23.0,  30.0,  61.0,  62.0,
-        45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0};
-    static const std::vector<std::vector<int>> kMASKS = {
-        {6, 7, 8},
-        {3, 4, 5},
-        {0, 1, 2}};
-    return NvDsInferParseYoloV3 (
-        outputLayersInfo, networkInfo, detectionParams, objectList,
-        kANCHORS, kMASKS);
+    /* Layers are looked up once, in a parser of the thread. */
+    static thread_local YoloParser parser;
+    static thread_local NvDsInferParserCallParams parserParams;
+    static thread_local bool parserValid;
+
+    if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+            networkInfo, detectionParams))
+        parserValid = SetupYoloV3 (parser, outputLayersInfo, networkInfo,
+            detectionParams, kANCHORS_V3, kMASKS_V3);
+    if (!parserValid)
+        return false;
+    ParseYolo (parser, outputLayersInfo, objectList);
+    return true;
 }
 
 extern "C" bool NvDsInferParseCustomYoloV3Tiny(
@@ -369,86 +236,185 @@ extern "C" bool NvDsInferParseCustomYoloV3Tiny(
     NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const std::vector<float> kANCHORS = {
-        10, 14, 23, 27, 37, 58, 81, 82, 135, 169, 344, 319};
-    static const std::vector<std::vector<int>> kMASKS = {
-        {3, 4, 5},
-        //{0, 1, 2}}; // as per output result, select {1,2,3}
-        {1, 2, 3}};
-
-    return NvDsInferParseYoloV3 (
-        outputLayersInfo, networkInfo, detectionParams, objectList,
-        kANCHORS, kMASKS);
+    static thread_local YoloParser parser;
+    static thread_local NvDsInferParserCallParams parserParams;
+    static thread_local bool parserValid;
+
+    if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+            networkInfo, detectionParams))
+        parserValid = SetupYoloV3 (parser, outputLayersInfo, networkInfo,
+            detectionParams, kANCHORS_V3_TINY, kMASKS_V3_TINY);
+    if (!parserValid)
+        return false;
+    ParseYolo (parser, outputLayersInfo, objectList);
+    return true;
 }
 
-static bool NvDsInferParseYoloV2(
+extern "C" bool NvDsInferParseCustomYoloV2(
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
     NvDsInferNetworkInfo const& networkInfo,
     NvDsInferParseDetectionParams const& detectionParams,
-    std::vector<NvDsInferParseObjectInfo>& objectList,
-    const float nmsThreshold, const float probthreshold)
+    std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const std::vector<float> kANCHORS = {
-        18.3273602, 21.6763191, 59.9827194, 66.0009613,
-        106.829758, 175.178879, 252.250244, 112.888962,
-        312.656647, 293.384949 };
-    const uint kNUM_BBOXES = 5;
+    static thread_local YoloParser parser;
+    static thread_local NvDsInferParserCallParams parserParams;
+    static thread_local bool parserValid;
+
+    if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+            networkInfo, detectionParams))
+        parserValid = SetupYoloV2 (parser, outputLayersInfo, networkInfo,
+            detectionParams, kNMS_THRESH_V2, kPROB_THRESH_V2);
+    if (!parserValid)
+        return false;
+    ParseYolo (parser, outputLayersInfo, objectList);
+    return true;
+}
 
-    if (outputLayersInfo.empty()) {
-        std::cerr << "Could not find output layer in bbox parsing" << std::endl;;
+extern "C" bool NvDsInferParseCustomYoloV2Tiny(
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    NvDsInferNetworkInfo const& networkInfo,
+    NvDsInferParseDetectionParams const& detectionParams,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    static thread_local YoloParser parser;
+    static thread_local NvDsInferParserCallParams parserParams;
+    static thread_local bool parserValid;
+
+    if (NvDsInferParserParamsChanged (parserParams, outputLayersInfo,
+            networkInfo, detectionParams))
+        parserValid = SetupYoloV2 (parser, outputLayersInfo, networkInfo,
+            detectionParams, kNMS_THRESH_V2_TINY, kPROB_THRESH_V2_TINY);
+    if (!parserValid)
         return false;
+    ParseYolo (parser, outputLayersInfo, objectList);
+    return true;
+}
+
+/* Parser instances: the layers are sorted and their anchors looked up once. */
+extern "C" NvDsInferParserHandle NvDsInferParseCustomYoloV3Create(
+    NvDsInferParserInitParams const& initParams)
+{
+    YoloParser* parser = new YoloParser;
+
+    if (!SetupYoloV3 (*parser, initParams.outputLayersInfo,
+            initParams.networkInfo, initParams.detectionParams,
+            kANCHORS_V3, kMASKS_V3)) {
+        delete parser;
+        return nullptr;
     }
-    const NvDsInferLayerInfo &layer = outputLayersInfo[0];
+    return ReadYoloProperties (parser, initParams);
+}
 
-    if (NUM_CLASSES_YOLO != detectionParams.numClassesConfigured)
-    {
-        std::cerr << "WARNING: Num classes mismatch. Configured:"
-                  << detectionParams.numClassesConfigured
-                  << ", detected by network: " << NUM_CLASSES_YOLO << std::endl;
+extern "C" NvDsInferParserHandle NvDsInferParseCustomYoloV3TinyCreate(
+    NvDsInferParserInitParams const& initParams)
+{
+    YoloParser* parser = new YoloParser;
+
+    if (!SetupYoloV3 (*parser, initParams.outputLayersInfo,
+            initParams.networkInfo, initParams.detectionParams,
+            kANCHORS_V3_TINY, kMASKS_V3_TINY)) {
+        delete parser;
+        return nullptr;
     }
+    return ReadYoloProperties (parser, initParams);
+}
 
-    assert (layer.dims.numDims == 3);
-    const uint gridSize = layer.dims.d[1];
-    const uint stride = networkInfo.width / gridSize;
-    std::vector<NvDsInferParseObjectInfo> objects =
-        decodeYoloV2Tensor((const float*)(layer.buffer), kANCHORS, gridSize, stride, kNUM_BBOXES,
-                   NUM_CLASSES_YOLO, probthreshold, networkInfo.width, networkInfo.height);
+extern "C" NvDsInferParserHandle NvDsInferParseCustomYoloV2Create(
+    NvDsInferParserInitParams const& initParams)
+{
+    YoloParser* parser = new YoloParser;
 
-    objectList.clear();
-    objectList = nmsAllClasses(nmsThreshold, objects, NUM_CLASSES_YOLO);
+    if (!SetupYoloV2 (*parser, initParams.outputLayersInfo,
+            initParams.networkInfo, initParams.detectionParams,
+            kNMS_THRESH_V2, kPROB_THRESH_V2)) {
+        delete parser;
+        return nullptr;
+    }
+    return ReadYoloProperties (parser, initParams);
+}
+
+extern "C" NvDsInferParserHandle NvDsInferParseCustomYoloV2TinyCreate(
+    NvDsInferParserInitParams const& initParams)
+{
+    YoloParser* parser = new YoloParser;
 
+    if (!SetupYoloV2 (*parser, initParams.outputLayersInfo,
+            initParams.networkInfo, initParams.detectionParams,
+            kNMS_THRESH_V2_TINY, kPROB_THRESH_V2_TINY)) {
+        delete parser;
+        return nullptr;
+    }
+    return ReadYoloProperties (parser, initParams);
+}
+
+/* Parsing and destruction are the same for all the networks. */
+static bool ParseYoloInstance(
+    NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    ParseYolo (*(YoloParser*) handle, outputLayersInfo, objectList);
     return true;
 }
 
-extern "C" bool NvDsInferParseCustomYoloV2(
+extern "C" bool NvDsInferParseCustomYoloV3Parse(
+    NvDsInferParserHandle handle,
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
-    NvDsInferNetworkInfo const& networkInfo,
-    NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const float kNMS_THRESH = 0.3f;
-    static const float kPROB_THRESH = 0.6f;
+    return ParseYoloInstance (handle, outputLayersInfo, objectList);
+}
 
-    return NvDsInferParseYoloV2 (
-        outputLayersInfo, networkInfo, detectionParams, objectList,
-        kNMS_THRESH, kPROB_THRESH);
+extern "C" bool NvDsInferParseCustomYoloV3TinyParse(
+    NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    return ParseYoloInstance (handle, outputLayersInfo, objectList);
 }
 
-extern "C" bool NvDsInferParseCustomYoloV2Tiny(
+extern "C" bool NvDsInferParseCustomYoloV2Parse(
+    NvDsInferParserHandle handle,
+    std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
+    std::vector<NvDsInferParseObjectInfo>& objectList)
+{
+    return ParseYoloInstance (handle, outputLayersInfo, objectList);
+}
+
+extern "C" bool NvDsInferParseCustomYoloV2TinyParse(
+    NvDsInferParserHandle handle,
     std::vector<NvDsInferLayerInfo> const& outputLayersInfo,
-    NvDsInferNetworkInfo const& networkInfo,
-    NvDsInferParseDetectionParams const& detectionParams,
     std::vector<NvDsInferParseObjectInfo>& objectList)
 {
-    static const float kNMS_THRESH = 0.2f;
-    static const float kPROB_THRESH = 0.6f;
-    return NvDsInferParseYoloV2 (
-        outputLayersInfo, networkInfo, detectionParams, objectList,
-        kNMS_THRESH, kPROB_THRESH);
+    return ParseYoloInstance (handle, outputLayersInfo, objectList);
+}
+
+extern "C" void NvDsInferParseCustomYoloV3Destroy(NvDsInferParserHandle handle)
+{
+    delete (YoloParser*) handle;
+}
+
+extern "C" void NvDsInferParseCustomYoloV3TinyDestroy(NvDsInferParserHandle handle)
+{
+    delete (YoloParser*) handle;
+}
+
+extern "C" void NvDsInferParseCustomYoloV2Destroy(NvDsInferParserHandle handle)
+{
+    delete (YoloParser*) handle;
+}
+
+extern "C" void NvDsInferParseCustomYoloV2TinyDestroy(NvDsInferParserHandle handle)
+{
+    delete (YoloParser*) handle;
 }
 
-/* Check that the custom function has been defined correctly */
+/* Check that the custom functions have been defined correctly */
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV3);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV3Tiny);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV2);
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseCustomYoloV2Tiny);
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomYoloV3);
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomYoloV3Tiny);
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomYoloV2);
+CHECK_CUSTOM_PARSER_PROTOTYPE(NvDsInferParseCustomYoloV2Tiny);